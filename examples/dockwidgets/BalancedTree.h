@@ -0,0 +1,42 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <kddockwidgets/MainWindow.h>
+
+#include <cmath>
+
+/**
+ * @brief Docks @p dock into @p mainWindow as the next group of a balanced tree, alternating the
+ * orientation at each level. @p groups has the first dock widget of each group docked so far.
+ *
+ * Also used by tests/bench_interaction.cpp, so the benchmark measures the layouts --stress makes.
+ */
+inline void addBalancedGroup(KDDockWidgets::MainWindowBase *mainWindow, KDDockWidgets::DockWidgetBase *dock,
+                             KDDockWidgets::DockWidgetBase::List &groups)
+{
+    const int index = groups.size();
+    const int depth = int(std::log2(index + 1));
+    KDDockWidgets::DockWidgetBase *relativeTo = index == 0 ? nullptr : groups.at((index - 1) / 2);
+    mainWindow->addDockWidget(dock, depth % 2 == 0 ? KDDockWidgets::Location_OnRight
+                                                   : KDDockWidgets::Location_OnBottom, relativeTo);
+    groups.push_back(dock);
+}
@@ -0,0 +1,266 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StressMode.h"
+#include "BalancedTree.h"
+#include "MyWidget.h"
+
+#include <kddockwidgets/LayoutSaver.h>
+
+#include <QApplication>
+#include <QDebug>
+#include <QMouseEvent>
+
+
+using namespace KDDockWidgets;
+
+static QString msecs(qint64 usecs)
+{
+    return QString::number(usecs / 1000.0, 'f', 1);
+}
+
+PerformanceOverlay::PerformanceOverlay(QWidget *parent)
+    : QLabel(parent)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setStyleSheet(QStringLiteral("background: rgba(0, 0, 0, 160); color: white; padding: 4px;"));
+    qApp->installEventFilter(this);
+
+    m_secondTimer.setInterval(1000);
+    connect(&m_secondTimer, &QTimer::timeout, this, &PerformanceOverlay::updateText);
+    m_secondTimer.start();
+
+    // A zero timer only fires when the event loop is idle, so the time between two is how long it was stalled
+    m_stallTimer.setInterval(0);
+    connect(&m_stallTimer, &QTimer::timeout, this, [this] {
+        m_maxStallUsecs = qMax(m_maxStallUsecs, m_stallClock.nsecsElapsed() / 1000);
+        m_stallClock.restart();
+    });
+    m_stallClock.start();
+    m_stallTimer.start();
+
+    updateText();
+}
+
+void PerformanceOverlay::recordStep(qint64 usecs)
+{
+    m_maxStepUsecs = qMax(m_maxStepUsecs, usecs);
+}
+
+bool PerformanceOverlay::eventFilter(QObject *watched, QEvent *event)
+{
+    // Each top-level repaint is one UpdateRequest, whichever the window
+    if (event->type() == QEvent::UpdateRequest && watched->isWidgetType() && static_cast<QWidget*>(watched)->isWindow())
+        m_frames++;
+
+    return false;
+}
+
+void PerformanceOverlay::updateText()
+{
+    setText(QStringLiteral("%1 frames/s | slowest step %2 ms | longest stall %3 ms")
+            .arg(m_frames).arg(msecs(m_maxStepUsecs), msecs(m_maxStallUsecs)));
+    adjustSize();
+    if (parentWidget())
+        move(parentWidget()->width() - width(), 0);
+    raise();
+
+    m_allTimeMaxStepUsecs = qMax(m_allTimeMaxStepUsecs, m_maxStepUsecs);
+    m_allTimeMaxStallUsecs = qMax(m_allTimeMaxStallUsecs, m_maxStallUsecs);
+    if (m_frames > 0)
+        m_allTimeMinFps = m_allTimeMinFps == -1 ? m_frames : qMin(m_allTimeMinFps, m_frames);
+
+    m_frames = 0;
+    m_maxStepUsecs = 0;
+    m_maxStallUsecs = 0;
+}
+
+StressTest::StressTest(const StressOptions &options, QObject *parent)
+    : QObject(parent)
+    , m_options(options)
+    , m_mainWindow(new MainWindow(QStringLiteral("StressMainWindow")))
+    , m_overlay(new PerformanceOverlay(m_mainWindow))
+{
+    m_mainWindow->setWindowTitle(QStringLiteral("Stress test, %1 dock widgets").arg(options.numDockWidgets));
+    m_mainWindow->resize(1800, 1000);
+    m_mainWindow->show();
+
+    QElapsedTimer timer;
+    timer.start();
+    createDockWidgets();
+    qDebug() << "Created" << m_dockWidgets.size() << "dock widgets in" << msecs(timer.nsecsElapsed() / 1000) << "ms";
+
+    if (options.scripted) {
+        // About a frame apart, so what's measured includes painting the previous step
+        m_stepTimer.setInterval(16);
+        connect(&m_stepTimer, &QTimer::timeout, this, &StressTest::runStep);
+        m_stepTimer.start();
+    }
+}
+
+StressTest::~StressTest()
+{
+    qDeleteAll(m_dockWidgets);
+    delete m_mainWindow;
+}
+
+void StressTest::createDockWidgets()
+{
+    // Docked groups go into a balanced tree, alternating the orientation at each level
+    const int maxDockedGroups = (1 << (m_options.maxDepth + 1)) - 1;
+    const int tabsPerGroup = qMax(1, m_options.tabsPerGroup);
+    DockWidgetBase *currentGroup = nullptr;
+
+    for (int i = 0; i < m_options.numDockWidgets; ++i) {
+        auto dock = new DockWidget(QStringLiteral("stress-%1").arg(i));
+        dock->setTitle(QStringLiteral("Stress #%1").arg(i));
+        switch (i % 3) {
+        case 0:
+            dock->setWidget(new MyWidget1());
+            break;
+        case 1:
+            dock->setWidget(new MyWidget2());
+            break;
+        default:
+            dock->setWidget(new MyWidget3());
+            break;
+        }
+        m_dockWidgets.push_back(dock);
+
+        const int group = i / tabsPerGroup;
+        if (currentGroup && i % tabsPerGroup != 0) {
+            currentGroup->addDockWidgetAsTab(dock);
+        } else if (m_options.floatingEvery > 0 && group % m_options.floatingEvery == m_options.floatingEvery - 1) {
+            dock->show();
+            dock->window()->move(100 + 30 * (group % 20), 100 + 30 * (group % 20));
+            currentGroup = dock;
+        } else if (m_dockedGroups.size() < maxDockedGroups) {
+            addBalancedGroup(m_mainWindow, dock, m_dockedGroups);
+            currentGroup = dock;
+        } else {
+            // Too deep already, the rest are tabbed into the docked groups
+            currentGroup = m_dockedGroups.at(group % m_dockedGroups.size());
+            currentGroup->addDockWidgetAsTab(dock);
+        }
+    }
+}
+
+void StressTest::runStep()
+{
+    if (m_options.numSteps > 0 && m_step >= m_options.numSteps) {
+        m_stepTimer.stop();
+        printSummary();
+        qApp->quit();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Each interaction runs for a while before the next one
+    switch ((m_step / 20) % 4) {
+    case 0:
+        detachAndRedock();
+        break;
+    case 1:
+        sweepSeparator();
+        break;
+    case 2:
+        saveAndRestore();
+        break;
+    default:
+        resizeMainWindow();
+        break;
+    }
+
+    m_overlay->recordStep(timer.nsecsElapsed() / 1000);
+    m_step++;
+}
+
+void StressTest::detachAndRedock()
+{
+    // Like dragging a dock widget out and then back to where it was
+    if (m_detached) {
+        m_detached->setFloating(false);
+        m_detached.clear();
+    } else if (!m_dockedGroups.isEmpty()) {
+        m_detached = m_dockedGroups.at(m_step % m_dockedGroups.size());
+        m_detached->setFloating(true);
+    }
+}
+
+void StressTest::sweepSeparator()
+{
+    // Drags the separator of the root, which resizes the most dock widgets
+    QWidget *separator = nullptr;
+    const QList<QWidget*> children = m_mainWindow->findChildren<QWidget*>();
+    for (QWidget *child : children) {
+        if (child->inherits("Layouting::Separator") && child->isVisible()) {
+            separator = child;
+            break;
+        }
+    }
+
+    if (!separator)
+        return;
+
+    const QPoint from = separator->rect().center();
+    const QPoint delta = separator->width() > separator->height() ? QPoint(0, 10 * m_sweepDirection)
+                                                                  : QPoint(10 * m_sweepDirection, 0);
+    const QPoint to = from + delta;
+    const QPoint globalFrom = separator->mapToGlobal(from);
+
+    QMouseEvent press(QEvent::MouseButtonPress, from, globalFrom, Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    QApplication::sendEvent(separator, &press);
+    QMouseEvent move(QEvent::MouseMove, to, globalFrom + delta, Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    QApplication::sendEvent(separator, &move);
+    QMouseEvent release(QEvent::MouseButtonRelease, to, globalFrom + delta, Qt::LeftButton, Qt::NoButton, Qt::NoModifier);
+    QApplication::sendEvent(separator, &release);
+
+    if (m_step % 10 == 9)
+        m_sweepDirection = -m_sweepDirection;
+}
+
+void StressTest::saveAndRestore()
+{
+    if (m_detached) {
+        m_detached->setFloating(false);
+        m_detached.clear();
+    }
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout(LayoutSaver::Format::Binary);
+    if (!saver.restoreLayout(saved))
+        qWarning() << "Failed to restore the stress layout";
+}
+
+void StressTest::resizeMainWindow()
+{
+    m_mainWindow->resize(m_mainWindow->size() + (m_grow ? QSize(20, 10) : QSize(-20, -10)));
+    if (m_step % 10 == 9)
+        m_grow = !m_grow;
+}
+
+void StressTest::printSummary()
+{
+    qDebug().noquote() << QStringLiteral("Stress test done: %1 steps, lowest %2 frames/s, slowest step %3 ms, longest stall %4 ms")
+                          .arg(m_step).arg(m_overlay->minFps())
+                          .arg(msecs(m_overlay->maxStepUsecs()), msecs(m_overlay->maxStallUsecs()));
+}
@@ -0,0 +1,107 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <kddockwidgets/DockWidget.h>
+#include <kddockwidgets/MainWindow.h>
+
+#include <QElapsedTimer>
+#include <QLabel>
+#include <QPointer>
+#include <QTimer>
+
+struct StressOptions
+{
+    int numDockWidgets = 100;
+    int tabsPerGroup = 4;
+    int floatingEvery = 5; // One in each this many groups is floating. 0 for none
+    int maxDepth = 4; // Of the nested groups in the main window, the others are tabbed into them
+    static const int s_maxDepth = 16; // Already more docked groups than a main window can fit
+    bool scripted = false;
+    int numSteps = 0; // Scripted steps to run before quitting. 0 runs forever
+};
+
+/**
+ * Shows how many frames per second the top-levels are painting, and how long the slowest
+ * scripted step and event loop stall were, in the last second.
+ */
+class PerformanceOverlay : public QLabel
+{
+    Q_OBJECT
+public:
+    explicit PerformanceOverlay(QWidget *parent);
+
+    ///@brief Records the duration of a scripted step
+    void recordStep(qint64 usecs);
+
+    qint64 maxStepUsecs() const { return m_allTimeMaxStepUsecs; }
+    qint64 maxStallUsecs() const { return m_allTimeMaxStallUsecs; }
+    int minFps() const { return m_allTimeMinFps; }
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void updateText();
+
+    QTimer m_secondTimer;
+    QTimer m_stallTimer; // Fires on each event loop iteration that has nothing else to do
+    QElapsedTimer m_stallClock;
+    int m_frames = 0;
+    qint64 m_maxStepUsecs = 0;
+    qint64 m_maxStallUsecs = 0;
+    qint64 m_allTimeMaxStepUsecs = 0;
+    qint64 m_allTimeMaxStallUsecs = 0;
+    int m_allTimeMinFps = -1;
+};
+
+/**
+ * A reproducible scenario with many dock widgets, for comparing performance on real windowing
+ * systems. Optionally runs scripted interactions: detaching and re-docking, separator sweeps,
+ * save and restore and main window resizes.
+ */
+class StressTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StressTest(const StressOptions &options, QObject *parent = nullptr);
+    ~StressTest() override;
+
+private:
+    void createDockWidgets();
+    void runStep();
+    void detachAndRedock();
+    void sweepSeparator();
+    void saveAndRestore();
+    void resizeMainWindow();
+    void printSummary();
+
+    const StressOptions m_options;
+    KDDockWidgets::MainWindow *const m_mainWindow;
+    PerformanceOverlay *const m_overlay;
+    KDDockWidgets::DockWidget::List m_dockWidgets;
+    KDDockWidgets::DockWidget::List m_dockedGroups; // The first dock widget of each docked group
+    QTimer m_stepTimer;
+    int m_step = 0;
+    QPointer<KDDockWidgets::DockWidgetBase> m_detached;
+    int m_sweepDirection = 1;
+    bool m_grow = true;
+};
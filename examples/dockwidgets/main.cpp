@@ -21,8 +21,10 @@
 #include "MyWidget.h"
 #include "MyMainWindow.h"
 #include "MyFrameworkWidgetFactory.h"
+#include "StressMode.h"
 
 #include <kddockwidgets/Config.h>
+#include <kddockwidgets/ProcessDockWidget.h>
 
 #include <QStyleFactory>
 #include <QApplication>
@@ -82,6 +84,30 @@ int main(int argc, char **argv)
     QCommandLineOption maximizeButton("b", QCoreApplication::translate("main", "DockWidgets have maximize/restore buttons instead of float/dock button"));
     parser.addOption(maximizeButton);
 
+    QCommandLineOption stressOption("stress", QCoreApplication::translate("main", "Instead of the normal windows, shows <docks> dock widgets and a performance overlay"), QStringLiteral("docks"));
+    parser.addOption(stressOption);
+
+    QCommandLineOption stressTabsOption("stress-tabs", QCoreApplication::translate("main", "Only usable with --stress. How many dock widgets each tab group has"), QStringLiteral("count"));
+    parser.addOption(stressTabsOption);
+
+    QCommandLineOption stressFloatingOption("stress-floating", QCoreApplication::translate("main", "Only usable with --stress. One in each <count> tab groups is floating, 0 for none"), QStringLiteral("count"));
+    parser.addOption(stressFloatingOption);
+
+    QCommandLineOption stressDepthOption("stress-depth", QCoreApplication::translate("main", "Only usable with --stress. How deep the docked tab groups are nested"), QStringLiteral("depth"));
+    parser.addOption(stressDepthOption);
+
+    QCommandLineOption stressScriptOption("stress-script", QCoreApplication::translate("main", "Only usable with --stress. Keeps detaching, re-docking, resizing, saving and restoring"));
+    parser.addOption(stressScriptOption);
+
+    QCommandLineOption stressStepsOption("stress-steps", QCoreApplication::translate("main", "Only usable with --stress-script. Prints a summary and quits after <steps> scripted steps"), QStringLiteral("steps"));
+    parser.addOption(stressStepsOption);
+
+    QCommandLineOption processPanelOption("process-panel", QCoreApplication::translate("main", "Adds a dock widget whose content runs in a separate process (Illustrates ProcessDockWidget)"));
+    parser.addOption(processPanelOption);
+
+    QCommandLineOption processPanelChildOption("process-panel-child", QCoreApplication::translate("main", "Internal. Runs as the content of the --process-panel dock widget"));
+    parser.addOption(processPanelChildOption);
+
     QCommandLineOption dockableMainWindows("j", QCoreApplication::translate("main", "Allow main windows to be docked inside other main windows (this feature is work in progress)"));
     QCommandLineOption maxSizeOption("g", QCoreApplication::translate("main", "Make dock #8 have a max-size of 200x200. (this feature is work in progress)"));
     QCommandLineOption centralFrame("f", QCoreApplication::translate("main", "Persistent central frame"));
@@ -98,6 +124,15 @@ int main(int argc, char **argv)
 
     parser.process(app);
 
+    if (parser.isSet(processPanelChildOption)) {
+        // We're the separate process. The window is embedded into the dock widget in the parent.
+        MyWidget1 panel;
+        panel.winId();
+        ProcessDockWidget::announceWindow(panel.windowHandle());
+        panel.show();
+        return app.exec();
+    }
+
     if (parser.isSet(customStyle)) {
         Config::self().setFrameworkWidgetFactory(new CustomWidgetFactory()); // Sets our custom factory
 
@@ -138,6 +173,32 @@ int main(int argc, char **argv)
 
     KDDockWidgets::Config::self().setFlags(flags);
 
+    if (parser.isSet(stressOption)) {
+        StressOptions stressOptions;
+        stressOptions.numDockWidgets = parser.value(stressOption).toInt();
+        if (parser.isSet(stressTabsOption))
+            stressOptions.tabsPerGroup = parser.value(stressTabsOption).toInt();
+        if (parser.isSet(stressFloatingOption))
+            stressOptions.floatingEvery = parser.value(stressFloatingOption).toInt();
+        if (parser.isSet(stressDepthOption))
+            stressOptions.maxDepth = parser.value(stressDepthOption).toInt();
+        stressOptions.scripted = parser.isSet(stressScriptOption);
+        stressOptions.numSteps = parser.value(stressStepsOption).toInt();
+
+        if (stressOptions.numDockWidgets <= 0) {
+            qWarning() << "Error: --stress requires a positive number of dock widgets";
+            return 1;
+        }
+
+        if (stressOptions.maxDepth < 0 || stressOptions.maxDepth > StressOptions::s_maxDepth) {
+            qWarning() << "Error: --stress-depth must be between 0 and" << StressOptions::s_maxDepth;
+            return 1;
+        }
+
+        StressTest stressTest(stressOptions);
+        return app.exec();
+    }
+
     const bool nonClosableDockWidget0 = parser.isSet(nonClosableDockWidget);
     const bool restoreIsRelative = parser.isSet(relativeRestore);
     const bool nonDockableDockWidget9 = parser.isSet(nonDockable);
@@ -151,6 +212,13 @@ int main(int argc, char **argv)
     mainWindow.resize(1200, 1200);
     mainWindow.show();
 
+    if (parser.isSet(processPanelOption)) {
+        auto processPanel = new ProcessDockWidget(QStringLiteral("ProcessPanel"), QCoreApplication::applicationFilePath(),
+                                                  { QStringLiteral("--process-panel-child") });
+        processPanel->setTitle(QStringLiteral("Out of process"));
+        mainWindow.addDockWidget(processPanel, Location_OnBottom);
+    }
+
     if (usesMainWindowsWithAffinity) {
         if (usesDockableMainWindows) {
             qWarning() << "MainWindows with affinity option is incompatible with Dockable Main Windows option";
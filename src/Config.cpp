@@ -28,12 +28,26 @@
 #include "Config.h"
 #include "DockRegistry_p.h"
 #include "FrameworkWidgetFactory.h"
+#include "multisplitter/Item_p.h"
 #include "multisplitter/Separator_p.h"
+#include "multisplitter/Tracing_p.h"
+#include "multisplitter/PointerInput_p.h"
+#include "FloatingWindowPool_p.h"
+#include "FramePool_p.h"
+
+#ifdef KDDOCKWIDGETS_QTQUICK
+# include "quick/QmlComponentCache_p.h"
+# include "quick/QuickWindowPool_p.h"
+#endif
 
 #include <QApplication>
 #include <QDebug>
 #include <QOperatingSystemVersion>
 
+#if defined(Q_OS_WIN)
+# include <windows.h>
+#endif
+
 using namespace KDDockWidgets;
 
 class Config::Private
@@ -50,18 +64,25 @@ public:
     }
 
     void fixFlags();
+    ///@brief Sets and fixes the flags, and forwards them to the layouting engine
+    void setFlags(Flags flags);
 
     QQmlEngine *m_qmlEngine = nullptr;
     DockWidgetFactoryFunc m_dockWidgetFactoryFunc = nullptr;
+    AsyncDockWidgetFactoryFunc m_asyncDockWidgetFactoryFunc = nullptr;
     MainWindowFactoryFunc m_mainWindowFactoryFunc = nullptr;
     FrameworkWidgetFactory *m_frameworkWidgetFactory;
     Flags m_flags = Flag_Default;
+    int m_floatingWindowPoolSize = 0;
+    int m_framePoolSize = 0;
+    bool m_layoutLocked = false;
+    int m_hiddenFloatingWindowReleaseDelay = -1;
 };
 
 Config::Config()
     : d(new Private())
 {
-    d->fixFlags();
+    d->setFlags(Flag_Default);
 
     // stuff in multisplitter/ can't include the framework widget factory, so set it here
     auto separatorCreator = [](QWidget *parent){
@@ -94,10 +115,35 @@ void Config::setFlags(Flags f)
         return;
     }
 
-    Layouting::Separator::usesLazyResize = f & Flag_LazyResize; // TODO: We'll soon have Layouting::Config and rely less on static members
+    d->setFlags(f);
+}
+
+bool Config::isRemoteDesktopSession()
+{
+    const QByteArray forced = qgetenv("KDDOCKWIDGETS_LOW_BANDWIDTH");
+    if (!forced.isEmpty())
+        return forced != "0";
+
+#if defined(Q_OS_WIN)
+    if (GetSystemMetrics(SM_REMOTESESSION))
+        return true;
+#endif
+
+    // "RDP-Tcp#1" for RDP and "ICA-tcp#1" for Citrix. "Console" when local
+    const QByteArray sessionName = qgetenv("SESSIONNAME").toUpper();
+    if (sessionName.startsWith("RDP-") || sessionName.startsWith("ICA-"))
+        return true;
+
+    if (!qEnvironmentVariableIsEmpty("XRDP_SESSION") || !qEnvironmentVariableIsEmpty("CITRIX_REMOTE_DISPLAY"))
+        return true;
 
-    d->m_flags = f;
-    d->fixFlags();
+    if (qApp && qApp->platformName() == QLatin1String("xcb")) {
+        // Forwarded X11 has a host name, like "localhost:10.0", a local display is just ":0"
+        const QByteArray display = qgetenv("DISPLAY");
+        return !display.isEmpty() && !display.startsWith(':') && !display.startsWith("unix:");
+    }
+
+    return false;
 }
 
 void Config::setDockWidgetFactoryFunc(DockWidgetFactoryFunc func)
@@ -110,6 +156,16 @@ DockWidgetFactoryFunc Config::dockWidgetFactoryFunc() const
     return d->m_dockWidgetFactoryFunc;
 }
 
+void Config::setAsyncDockWidgetFactoryFunc(AsyncDockWidgetFactoryFunc func)
+{
+    d->m_asyncDockWidgetFactoryFunc = func;
+}
+
+AsyncDockWidgetFactoryFunc Config::asyncDockWidgetFactoryFunc() const
+{
+    return d->m_asyncDockWidgetFactoryFunc;
+}
+
 void Config::setMainWindowFactoryFunc(MainWindowFactoryFunc func)
 {
     d->m_mainWindowFactoryFunc = func;
@@ -152,6 +208,80 @@ void Config::setSeparatorThickness(int value)
     Layouting::Item::separatorThickness = value;
 }
 
+int Config::floatingWindowPoolSize() const
+{
+    return d->m_floatingWindowPoolSize;
+}
+
+void Config::setFloatingWindowPoolSize(int size)
+{
+    if (size < 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid value" << size;
+        return;
+    }
+
+    d->m_floatingWindowPoolSize = size;
+    FloatingWindowPool::self()->scheduleRefill();
+#ifdef KDDOCKWIDGETS_QTQUICK
+    QuickWindowPool::self()->scheduleRefill();
+#endif
+}
+
+int Config::framePoolSize() const
+{
+    return d->m_framePoolSize;
+}
+
+void Config::setFramePoolSize(int size)
+{
+    if (size < 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid value" << size;
+        return;
+    }
+
+    d->m_framePoolSize = size;
+    FramePool::self()->trim();
+}
+
+void Config::setLayoutLocked(bool locked)
+{
+    if (locked == d->m_layoutLocked)
+        return;
+
+    d->m_layoutLocked = locked;
+    DockRegistry::self()->updateLayoutLocked();
+}
+
+bool Config::isLayoutLocked() const
+{
+    return d->m_layoutLocked;
+}
+
+int Config::pointerPredictionInterval() const
+{
+    return Layouting::MotionPredictor::predictionInterval;
+}
+
+void Config::setPointerPredictionInterval(int ms)
+{
+    if (ms < 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid value" << ms;
+        return;
+    }
+
+    Layouting::MotionPredictor::predictionInterval = ms;
+}
+
+int Config::hiddenFloatingWindowReleaseDelay() const
+{
+    return d->m_hiddenFloatingWindowReleaseDelay;
+}
+
+void Config::setHiddenFloatingWindowReleaseDelay(int ms)
+{
+    d->m_hiddenFloatingWindowReleaseDelay = ms < 0 ? -1 : ms;
+}
+
 void Config::setQmlEngine(QQmlEngine *qmlEngine)
 {
     if (d->m_qmlEngine) {
@@ -160,6 +290,12 @@ void Config::setQmlEngine(QQmlEngine *qmlEngine)
     }
 
     d->m_qmlEngine = qmlEngine;
+
+#ifdef KDDOCKWIDGETS_QTQUICK
+    // Compile the QML once, instead of per separator and frame
+    if (qmlEngine)
+        QmlComponentCache::forEngine(qmlEngine)->preload();
+#endif
 }
 
 QQmlEngine *Config::qmlEngine() const
@@ -167,8 +303,70 @@ QQmlEngine *Config::qmlEngine() const
     return d->m_qmlEngine;
 }
 
+void Config::setTraceBackend(Layouting::TraceBackend *backend)
+{
+    Layouting::Tracing::setBackend(backend);
+}
+
+Layouting::TraceBackend *Config::traceBackend() const
+{
+    return Layouting::Tracing::backend();
+}
+
+PerformanceCounters Config::performanceCounters() const
+{
+    // The layouting code keeps its own, as it can't depend on us
+    PerformanceCounters counters = DockRegistry::self()->performanceCounters();
+    const Layouting::Counters &layouting = Layouting::Tracing::counters();
+    counters.relayouts = layouting.relayouts;
+    counters.itemGeometryChanges = layouting.itemGeometryChanges;
+    counters.widgetGeometryChanges = layouting.widgetGeometryChanges;
+    counters.separatorsCreated = layouting.separatorsCreated;
+    counters.separatorsDestroyed = layouting.separatorsDestroyed;
+
+    return counters;
+}
+
+void Config::resetPerformanceCounters()
+{
+    DockRegistry::self()->performanceCounters() = PerformanceCounters();
+    Layouting::Tracing::counters() = Layouting::Counters();
+}
+
+MemoryUsage Config::memoryUsage(const MainWindowBase *mainWindow) const
+{
+    return DockRegistry::self()->memoryUsage(mainWindow);
+}
+
+std::shared_ptr<const DockingState> Config::dockingState()
+{
+    // Not through self(), which isn't meant for other threads
+    return DockRegistry::dockingState();
+}
+
+void Config::Private::setFlags(Flags flags)
+{
+    m_flags = flags;
+    fixFlags();
+
+    Layouting::Separator::usesLazyResize = m_flags & Flag_LazyResize; // TODO: We'll soon have Layouting::Config and rely less on static members
+    Layouting::Separator::usesCoalescedMoves = m_flags & Flag_CoalesceSeparatorMoves;
+    Layouting::Separator::usesHostPainting = m_flags & Flag_HostPaintedSeparators;
+    Layouting::Separator::usesSnapshotResize = m_flags & Flag_SnapshotResize;
+    Layouting::Separator::usesNativeTouchInput = m_flags & Flag_TouchAndPenInput;
+    Layouting::Item::usesCoalescedMinSizeUpdates = m_flags & Flag_CoalesceMinSizeChanges;
+}
+
 void Config::Private::fixFlags()
 {
+    if (qgetenv("KDDOCKWIDGETS_LOW_BANDWIDTH") == "1")
+        m_flags |= Flag_LowBandwidth;
+
+    if (m_flags & Flag_LowBandwidth) {
+        // No live window during detaching nor during resizing, and fewer moves
+        m_flags |= Flag_LazyResize | Flag_DragWithPreview | Flag_CoalesceDragMoves;
+    }
+
 #if defined(Q_OS_WIN)
     if (QOperatingSystemVersion::current().majorVersion() < 10) {
         // Aero-snap requires Windows 10
@@ -194,3 +392,4 @@ void Config::Private::fixFlags()
     m_flags = m_flags & ~Flag_AeroSnapWithClientDecos;
 #endif
 }
+
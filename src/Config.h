@@ -29,11 +29,25 @@
 #define KD_DOCKWIDGETS_CONFIG_H
 
 #include "docks_export.h"
+#include "QWidgetAdapter.h"
+
+#include <QFuture>
+#include <QRect>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 class QQmlEngine;
+class QWidget;
 QT_END_NAMESPACE
 
+namespace Layouting {
+class TraceBackend;
+}
+
 namespace KDDockWidgets
 {
 
@@ -44,6 +58,84 @@ class FrameworkWidgetFactory;
 typedef KDDockWidgets::DockWidgetBase* (*DockWidgetFactoryFunc)(const QString &name);
 typedef KDDockWidgets::MainWindowBase* (*MainWindowFactoryFunc)(const QString &name);
 
+///@brief Creates the content of a dock widget restored with an AsyncDockWidgetFactoryFunc. Called in the GUI thread.
+typedef std::function<QWidgetOrQuick*(KDDockWidgets::DockWidgetBase *dockWidget)> DockWidgetContentFunc;
+
+///@brief Starts loading what the dock widget called @p name shows, see Config::setAsyncDockWidgetFactoryFunc()
+typedef QFuture<KDDockWidgets::DockWidgetContentFunc> (*AsyncDockWidgetFactoryFunc)(const QString &name);
+
+///@brief Process-wide counters of the work done by the framework, see Config::performanceCounters()
+struct PerformanceCounters
+{
+    quint64 relayouts = 0; ///< Layout containers positioning their children
+    quint64 itemGeometryChanges = 0; ///< Layout items whose geometry changed
+    quint64 widgetGeometryChanges = 0; ///< QWidget::setGeometry() calls issued to frames and separators
+    quint64 separatorsCreated = 0;
+    quint64 separatorsDestroyed = 0;
+    quint64 framesCreated = 0;
+    quint64 framesDestroyed = 0;
+    quint64 dragHovers = 0; ///< Drop area hover evaluations while dragging
+    quint64 eventsFiltered = 0; ///< Events of our own windows and widgets inspected by the registry
+    quint64 restores = 0; ///< Layouts restored by LayoutSaver
+    qint64 lastRestoreUsecs = 0; ///< Duration of the last restore
+    qint64 totalRestoreUsecs = 0; ///< Duration of all restores
+};
+
+///@brief An immutable copy of which dock widgets are open, where and in which tabs, see Config::dockingState()
+struct DockingState
+{
+    struct DockWidgetState {
+        QString uniqueName;
+        QString title;
+        bool isOpen = false;
+        bool isFloating = false;
+        QRect geometry; ///< Of its frame, in global coordinates. Null if closed
+        int frameIndex = -1; ///< Index into frames, -1 if closed
+        int tabIndex = -1; ///< Position within its frame, -1 if closed
+    };
+
+    struct FrameState {
+        QRect geometry; ///< In global coordinates
+        QStringList dockWidgets; ///< Unique names, in tab order
+        int currentTabIndex = -1;
+        bool isFloating = false;
+    };
+
+    QVector<DockWidgetState> dockWidgets; ///< In registration order
+    QVector<FrameState> frames;
+    quint64 layoutGeneration = 0; ///< The DockRegistry layout generation it was taken at
+};
+
+///@brief How many objects of one kind exist and roughly what they cost, see Config::memoryUsage()
+struct MemoryCategory
+{
+    quint64 count = 0;
+    quint64 bytes = 0; ///< The objects plus an estimate of what Qt allocates for them, like widget privates and backing stores
+};
+
+///@brief The memory used by the framework's own objects, by kind, see Config::memoryUsage()
+struct MemoryUsage
+{
+    MemoryCategory frames; ///< Including the pooled ones
+    MemoryCategory titleBars; ///< With their buttons
+    MemoryCategory tabWidgets; ///< With their tab bars
+    MemoryCategory items; ///< Layout items and containers, placeholder items included
+    MemoryCategory separators;
+    MemoryCategory floatingWindows; ///< Including the pooled ones, and the backing stores of the visible ones
+    MemoryCategory placeholders; ///< The references to layout items remembering where closed dock widgets go back to
+    MemoryCategory indicators; ///< The drop indicator overlays and their windows
+    MemoryCategory actions; ///< The toggle and float actions of each dock widget
+    MemoryCategory pixmaps; ///< Cached pixmaps, like the drop indicator icons and the resize snapshots
+    quint64 pooledFrames = 0; ///< How many of the frames are in the pool
+    quint64 pooledFloatingWindows = 0; ///< How many of the floating windows are in the pool
+
+    quint64 totalBytes() const
+    {
+        return frames.bytes + titleBars.bytes + tabWidgets.bytes + items.bytes + separators.bytes +
+               floatingWindows.bytes + placeholders.bytes + indicators.bytes + actions.bytes + pixmaps.bytes;
+    }
+};
+
 /**
  * @brief Singleton to allow to choose certain behaviours of the framework.
  *
@@ -72,6 +164,20 @@ public:
         Flag_TabsHaveCloseButton = 64, /// Tabs will have a close button. Equivalent to QTabWidget::setTabsClosable(true).
         Flag_DoubleClickMaximizes = 128, /// Double clicking the titlebar will maximize a floating window instead of re-docking it
         Flag_TitleBarHasMaximizeButton = 256, /// The title bar will have a maximize/restore button when floating. This is mutually-exclusive with the floating button (since many apps behave that way).
+        Flag_CoalesceSeparatorMoves = 512, /// While dragging a separator the dock widgets are resized at most once per event loop iteration, instead of once per mouse event. The separator still follows the mouse. Ignored with Flag_LazyResize.
+        Flag_CoalesceDragMoves = 1024, /// While dragging a dock widget only the latest mouse position per event loop iteration is processed. Helps when mouse events back up, for example with some compositors or over remote desktop.
+        Flag_DragWithPreview = 2048, /// When detaching a docked dock widget a translucent preview follows the mouse instead of a real window. The dock widget is only reparented when the drag ends. Ignored with Flag_NativeTitleBar and with QtQuick.
+        Flag_SharedIndicatorWindow = 4096, /// All drop areas share a single top-level window for the classic drop indicators, instead of one per main window and per floating window. Must be set before any drop area is created.
+        Flag_SuspendHiddenContent = 8192, /// While a dock widget isn't visible to the user (closed, background tab, minimized or non-exposed window) its widget doesn't repaint and its update sources are paused. See DockWidgetBase::addUpdateSource().
+        Flag_SystemMoveResize = 16384, /// Moving and resizing floating windows is handed to the window manager with QWindow::startSystemMove() and startSystemResize(), instead of setting the geometry on each mouse move. Drop indicators follow the cursor position. Requires Qt >= 5.15, ignored with Flag_DragWithPreview previews.
+        Flag_HostPaintedSeparators = 32768, /// Separators aren't shown as individual widgets. Each layout paints all its separators itself and hit-tests the mouse for them. Reduces the number of widgets and of repainted regions in big layouts. With QtQuick all separators are drawn as a single scene graph node. Must be set before any dock widget is created.
+        Flag_CoalesceMinSizeChanges = 65536, /// The min size changes the guest widgets request are applied once per event loop iteration, deepest first, with a single relayout and a single min size update of the window. Helps when guests rebuild their contents at runtime.
+        Flag_SnapshotResize = 131072, /// While a separator is dragged, or a floating window resized with the mouse, the dock widgets are shown as scaled snapshots and only resized once the gesture ends. A middle ground between live resizing and Flag_LazyResize, which takes precedence. Ignored with QtQuick.
+        Flag_LowBandwidth = 262144, /// Tunes for remote desktop sessions (RDP, Citrix, forwarded X11), where translucency and big repaints are expensive. Uses the opaque drop indicators, shows the dock widgets being detached as an outline instead of a live window, and implies Flag_LazyResize, Flag_DragWithPreview and Flag_CoalesceDragMoves. Forced with KDDOCKWIDGETS_LOW_BANDWIDTH=1. See isRemoteDesktopSession().
+        Flag_ScalableTabs = 524288, /// For frames with many tabs. Tab bars cache the size of each tab, so inserting or removing one doesn't measure all the others again, and a button lists all tabs in a searchable popup. Ignored with QtQuick.
+        Flag_FastShutdown = 1048576, /// On QCoreApplication::aboutToQuit() the autosaves are flushed and the layouts stop being maintained, so destroying the windows doesn't relay out, delete emptied frames or emit layout signals. See also LayoutSaver::setAutoSaveFile(). The layout can still be saved after exec() returns, but shouldn't be changed anymore.
+        Flag_PaintedRubberBand = 2097152, /// The classic drop indicators paint the drop rect in the drop area's own overlay, with the style's rubber band look, instead of moving a QRubberBand widget around. Hovering only repaints the old and new rects, with no widget or native window being moved or resized. Ignored with QtQuick.
+        Flag_TouchAndPenInput = 4194304, /// For touch screens and pens, which send many more samples than mice. Separators and the edges of floating windows handle the touch and tablet events themselves, instead of the mouse events Qt synthesizes from them, and apply at most one move per event loop iteration. Dock widget drags keep using the synthesized mouse events, so taps still click tabs and title bar buttons, but coalesce them like Flag_CoalesceDragMoves. See also setPointerPredictionInterval(). Must be set before any dock widget is created. Ignored with QtQuick.
         Flag_Default = Flag_AeroSnapWithClientDecos ///> The defaults
     };
     Q_DECLARE_FLAGS(Flags, Flag)
@@ -85,6 +191,11 @@ public:
     ///Call @ref flags() after the setter if you need to know what was really set
     void setFlags(Flags flags);
 
+    ///@brief Returns whether the application is displayed over a remote desktop session, where
+    ///Flag_LowBandwidth helps. Detects RDP and Citrix sessions, and X11 forwarded to another host.
+    ///KDDOCKWIDGETS_LOW_BANDWIDTH=1 or 0 overrides the detection.
+    static bool isRemoteDesktopSession();
+
     /**
      * @brief Registers a DockWidgetFactoryFunc.
      *
@@ -104,6 +215,26 @@ public:
     ///nullptr by default
     DockWidgetFactoryFunc dockWidgetFactoryFunc() const;
 
+    /**
+     * @brief Registers an AsyncDockWidgetFactoryFunc, for dock widgets whose content takes a while to load.
+     *
+     * This is optional, the default is nullptr. It's used during restore for the dock widgets that
+     * don't exist, and that the DockWidgetFactoryFunc, if any, didn't create.
+     *
+     * The framework creates a placeholder DockWidget showing that it's loading and restores it into
+     * its frame and tab right away, so the restore doesn't wait. The function returns a future,
+     * for example from QtConcurrent::run(), doing the slow part in any thread. Once it finishes,
+     * the DockWidgetContentFunc it resulted in is called in the GUI thread, to create the widget
+     * from what was loaded. That widget then replaces the placeholder's.
+     *
+     * If the future is canceled or results in nothing, the placeholder says it failed to load.
+     */
+    void setAsyncDockWidgetFactoryFunc(AsyncDockWidgetFactoryFunc);
+
+    ///@brief Returns the AsyncDockWidgetFactoryFunc.
+    ///nullptr by default
+    AsyncDockWidgetFactoryFunc asyncDockWidgetFactoryFunc() const;
+
     ///@brief counter-part of DockWidgetFactoryFunc but for the main window.
     /// Should be rarely used. It's good practice to have the main window before restoring a layout.
     /// It's here so we can use it in the linter executable
@@ -139,10 +270,127 @@ public:
     ///Note: Only use this function at startup before creating any DockWidget or MainWindow.
     void setSeparatorThickness(int value);
 
+    ///@brief Returns the number of hidden FloatingWindows kept ready for detaching dock widgets.
+    ///Default is 0, which disables pooling.
+    int floatingWindowPoolSize() const;
+
+    /**
+     * @brief setter for @ref floatingWindowPoolSize
+     *
+     * Detaching a dock widget then reuses a pre-created FloatingWindow, instead of creating one
+     * and its native window while the drag starts. Emptied windows are returned to the pool
+     * instead of deleted, if they're reusable.
+     *
+     * With QtQuick it's the QQuickWindows hosting the floating windows that are pooled, they
+     * keep their OpenGL context and scene graph while hidden. Set Qt::AA_ShareOpenGLContexts
+     * before creating the QGuiApplication so their contexts share resources, and use the "basic"
+     * render loop (QSG_RENDER_LOOP=basic) to share one glyph cache and texture atlas between them.
+     */
+    void setFloatingWindowPoolSize(int size);
+
+    ///@brief Returns the maximum number of emptied Frames kept for reuse.
+    ///Default is 0, which disables pooling.
+    int framePoolSize() const;
+
+    /**
+     * @brief setter for @ref framePoolSize
+     *
+     * When the last dock widget leaves a Frame, the Frame, its TitleBar and its TabWidget are kept
+     * hidden and reused the next time a Frame is needed, instead of being deleted and created again.
+     * Useful if your FrameworkWidgetFactory creates expensive widgets. Only supported with QtWidgets.
+     */
+    void setFramePoolSize(int size);
+
+    /**
+     * @brief Locks or unlocks the layouts of all main windows and floating windows.
+     *
+     * For fixed layouts, like kiosks. When set before creating the windows, the drag and drop
+     * infrastructure isn't created at all: no drop indicators, no draggable title bars and tab
+     * bars, no resize handlers on floating windows. Can be changed at any time.
+     * @sa MainWindowBase::setLayoutLocked() to lock a single main window
+     */
+    void setLayoutLocked(bool locked);
+
+    ///@brief Returns whether all layouts are locked. false by default.
+    bool isLayoutLocked() const;
+
+    ///@brief Returns by how many ms touch and pen drags are extrapolated. Default is 0, which disables prediction.
+    int pointerPredictionInterval() const;
+
+    /**
+     * @brief setter for @ref pointerPredictionInterval
+     *
+     * With Flag_TouchAndPenInput, separators, floating window resizes and dock widget drags
+     * aim where the finger or pen will be in @p ms, from the velocity of the latest samples,
+     * instead of where it was. Hides some of the lag of a layout pass. A frame or two, 16 to 32,
+     * is usually enough, more overshoots when the finger stops. Drops and releases always use
+     * the actual position.
+     */
+    void setPointerPredictionInterval(int ms);
+
+    ///@brief Returns how long, in ms, a FloatingWindow stays hidden before its native resources are released.
+    ///Default is -1, which never releases them.
+    int hiddenFloatingWindowReleaseDelay() const;
+
+    /**
+     * @brief setter for @ref hiddenFloatingWindowReleaseDelay
+     *
+     * A FloatingWindow hidden for longer than @p ms, for example because all its dock widgets were
+     * closed, destroys its native window and backing store. They're created again when it's shown.
+     * The layout and its placeholders are kept. Windows kept by the floating window pool aren't
+     * released. Only supported with QtWidgets.
+     */
+    void setHiddenFloatingWindowReleaseDelay(int ms);
+
     ///@brief Sets the QQmlEngine to use. Applicable only when using QtQuick.
     void setQmlEngine(QQmlEngine *);
     QQmlEngine* qmlEngine() const;
 
+    /**
+     * @brief Sets the backend receiving begin/end events for layouting, dragging, dropping and
+     * restoring layouts. For example a Layouting::ChromeTraceBackend.
+     *
+     * Ownership isn't transferred. Tracing is disabled by default, and costs a pointer check then.
+     * Pass nullptr to disable it again.
+     */
+    void setTraceBackend(Layouting::TraceBackend *);
+    Layouting::TraceBackend *traceBackend() const;
+
+    /**
+     * @brief Returns the counters accumulated since startup or since the last call to
+     * resetPerformanceCounters(). Cheap, they're always collected.
+     *
+     * Useful to catch layout churn in automated tests, by comparing them before and after an operation.
+     */
+    PerformanceCounters performanceCounters() const;
+
+    ///@brief Sets all counters to 0
+    void resetPerformanceCounters();
+
+    /**
+     * @brief Returns the latest snapshot of the docking state. Can be called from any thread.
+     *
+     * The snapshot is immutable and replaced atomically, never modified, so background threads
+     * (accessibility, telemetry, remote control, ...) can hold and read it without locking and
+     * without touching any widget. It's taken on the GUI thread once per event loop turn in which
+     * the layout changed, so it lags behind by at most one turn. Apps that never call this don't
+     * pay for it: snapshots are only taken after the first call, which returns an empty one. If
+     * that call is made from the GUI thread the first snapshot follows on the next turn, otherwise
+     * on the next layout change.
+     */
+    static std::shared_ptr<const DockingState> dockingState();
+
+    /**
+     * @brief Returns how many framework objects of each kind exist and an estimate of their bytes.
+     *
+     * With @p mainWindow only the ones in it and in its floating windows are reported. The pools
+     * and the caches shared by all windows are only reported when it's nullptr, the default.
+     *
+     * The estimates are for setting budgets and comparing before and after, not exact accounting.
+     * What the dock widgets host isn't included. Walks all the objects, so not for hot paths.
+     */
+    MemoryUsage memoryUsage(const MainWindowBase *mainWindow = nullptr) const;
+
 private:
     Q_DISABLE_COPY(Config)
     Config();
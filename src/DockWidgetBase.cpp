@@ -28,14 +28,27 @@
 #include "DockRegistry_p.h"
 #include "WidgetResizeHandler_p.h"
 #include "DropArea_p.h"
+#include "FramePool_p.h"
 #include "multisplitter/Item_p.h"
+#include "multisplitter/Tracing_p.h"
 #include "Config.h"
 #include "FrameworkWidgetFactory.h"
+#include "FloatingWindowPool_p.h"
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+# include "DockWidget.h"
+# include <QLabel>
+#else
+# include "quick/DockWidgetQuick.h"
+#endif
 
 #include <QAction>
 #include <QEvent>
+#include <QFutureWatcher>
 #include <QCloseEvent>
 #include <QTimer>
+#include <QWindow>
+#include <QPointer>
 #include <QScopedValueRollback>
 
 /**
@@ -55,12 +68,21 @@ public:
         , title(dockName)
         , q(qq)
         , options(options_)
-        , toggleAction(new QAction(q))
-        , floatAction(new QAction(q))
     {
         q->connect(q, &DockWidgetBase::shown, q, [this] { onDockWidgetShown(); } );
         q->connect(q, &DockWidgetBase::hidden, q, [this] { onDockWidgetHidden(); } );
+    }
+
+    ///@brief The actions are only created when the application asks for them, most are never used
+    QAction *ensureToggleAction()
+    {
+        if (toggleAction)
+            return toggleAction;
 
+        toggleAction = new QAction(q);
+        toggleAction->setCheckable(true);
+        toggleAction->setChecked(isOpen);
+        toggleAction->setText(title);
         q->connect(toggleAction, &QAction::toggled, q, [this] (bool enabled) {
             if (!m_updatingToggleAction) { // guard against recursiveness
                 toggleAction->blockSignals(true); // and don't emit spurious toggle. Like when a dock widget is inserted into a tab widget it might get hide events, ignore those. The Dock Widget is open.
@@ -69,14 +91,24 @@ public:
             }
         });
 
+        return toggleAction;
+    }
+
+    QAction *ensureFloatAction()
+    {
+        if (floatAction)
+            return floatAction;
+
+        floatAction = new QAction(q);
+        floatAction->setCheckable(true);
+        updateFloatAction();
         q->connect(floatAction, &QAction::toggled, q, [this] (bool enabled) {
             if (!m_updatingFloatAction) { // guard against recursiveness
                 q->setFloating(enabled);
             }
         });
 
-        toggleAction->setCheckable(true);
-        floatAction->setCheckable(true);
+        return floatAction;
     }
 
     void init()
@@ -93,11 +125,39 @@ public:
     void updateFloatAction();
     void onDockWidgetShown();
     void onDockWidgetHidden();
+
+    ///@brief Creates the widget with widgetFactory, if there's one and no widget yet
+    void maybeCreateWidget();
+
+    ///@brief Deletes the widget created by widgetFactory, if still hidden. See setWidgetFactory()
+    void unloadWidget();
+
+    ///@brief Starts counting down to unloadWidget(), if the unload policy applies
+    void maybeScheduleUnload();
+
+    ///@brief Creates the dock widget shown while the content from an AsyncDockWidgetFactoryFunc loads
+    static DockWidgetBase *createLoadingPlaceholder(const QString &name);
+
+    ///@brief Replaces the placeholder's widget with what @p future results in, once finished
+    void loadContent(const QFuture<DockWidgetContentFunc> &future);
+    void onContentLoaded(const QFuture<DockWidgetContentFunc> &future);
+
+    ///@brief Watches the window containing the dock widget, for minimize and expose changes.
+    /// Only with Flag_SuspendHiddenContent, so the other apps don't pay for the event filters.
+    void updateWatchedWindow();
+
+    ///@brief Recomputes isVisibleToUser and applies Flag_SuspendHiddenContent
+    void updateVisibleToUser();
+    void setContentSuspended(bool suspended);
     TabWidget *parentTabWidget() const;
     void show();
     void close();
     void restoreToPreviousPosition();
     void maybeRestoreToPreviousPosition();
+    ///@brief Returns whether being shown now restores it to its placeholder in a main window
+    bool shouldRestoreToPreviousPosition() const;
+    ///@brief Like restoreToPreviousPosition() for each of @p dockWidgets, but each layout restores all of its placeholders at once
+    static void restoreToPreviousPositions(const DockWidgetBase::List &dockWidgets);
     int currentTabIndex() const;
 
     /**
@@ -113,18 +173,38 @@ public:
     QWidget *widget = nullptr;
     DockWidgetBase *const q;
     DockWidgetBase::Options options;
-    QAction *const toggleAction;
-    QAction *const floatAction;
+    QAction *toggleAction = nullptr; // See ensureToggleAction()
+    QAction *floatAction = nullptr;
+    bool isOpen = false; // What toggleAction's checked state is, or would be
     LastPositions m_lastPositions;
     bool m_updatingToggleAction = false;
     bool m_updatingFloatAction = false;
     bool m_isForceClosing = false;
+    quint64 restoreGeneration = 0; // The LayoutSaver restore that last restored it, see markRestored()
+
+    // For setWidgetFactory()
+    WidgetFactoryFunc widgetFactory;
+    QTimer *unloadTimer = nullptr;
+    UnloadPolicy unloadPolicy = UnloadPolicy_WhenHidden;
+
+    // For Config::setAsyncDockWidgetFactoryFunc()
+    QFutureWatcher<DockWidgetContentFunc> *contentWatcher = nullptr;
+
+    // For isVisibleToUser()
+    bool isVisibleToUser = false;
+    bool contentSuspended = false;
+    bool updatesEnabledBeforeSuspend = true; // What the widget had, restored when resuming
+    QPointer<QObject> watchedWindow;
+    QPointer<QWindow> watchedWindowHandle;
+    QVector<QPointer<QTimer>> updateSources;
+    QVector<QPointer<QTimer>> pausedUpdateSources;
 };
 
 DockWidgetBase::DockWidgetBase(const QString &name, Options options)
     : QWidgetOrQuick(nullptr, Qt::Tool)
     , d(new Private(name, options, this))
 {
+    KDDW_TRACE_SCOPE("dock", "DockWidgetBase::DockWidgetBase");
     d->init();
     DragController::instance();
     DockRegistry::self()->registerDockWidget(this);
@@ -222,6 +302,10 @@ void DockWidgetBase::setWidget(QWidget *w)
     qCDebug(addwidget) << Q_FUNC_INFO << w;
 
     d->widget = w;
+    if (d->contentSuspended) {
+        d->updatesEnabledBeforeSuspend = w->updatesEnabled();
+        w->setUpdatesEnabled(false);
+    }
     Q_EMIT widgetChanged(w);
     setWindowTitle(uniqueName());
 }
@@ -231,6 +315,57 @@ QWidget *DockWidgetBase::widget() const
     return d->widget;
 }
 
+bool DockWidgetBase::isVisibleToUser() const
+{
+    return d->isVisibleToUser;
+}
+
+bool DockWidgetBase::isLoadingContent() const
+{
+    return d->contentWatcher != nullptr;
+}
+
+void DockWidgetBase::addUpdateSource(QTimer *timer)
+{
+    if (!timer || d->updateSources.contains(timer))
+        return;
+
+    d->updateSources.push_back(timer);
+    if (d->contentSuspended && timer->isActive()) {
+        timer->stop();
+        d->pausedUpdateSources.push_back(timer);
+    }
+}
+
+bool DockWidgetBase::eventFilter(QObject *watched, QEvent *e)
+{
+    if (watched == d->watchedWindow || watched == d->watchedWindowHandle) {
+        if (e->type() == QEvent::WindowStateChange || e->type() == QEvent::Expose)
+            d->updateVisibleToUser();
+    }
+
+    return QWidgetOrQuick::eventFilter(watched, e);
+}
+
+void DockWidgetBase::setWidgetFactory(const WidgetFactoryFunc &factory, int unloadAfterMs,
+                                      UnloadPolicy policy)
+{
+    d->widgetFactory = factory;
+    d->unloadPolicy = policy;
+
+    delete d->unloadTimer;
+    d->unloadTimer = nullptr;
+    if (unloadAfterMs != -1) {
+        d->unloadTimer = new QTimer(this);
+        d->unloadTimer->setSingleShot(true);
+        d->unloadTimer->setInterval(unloadAfterMs);
+        connect(d->unloadTimer, &QTimer::timeout, this, [this] { d->unloadWidget(); });
+    }
+
+    if (isVisible())
+        d->maybeCreateWidget();
+}
+
 bool DockWidgetBase::isFloating() const
 {
     if (isWindow())
@@ -277,10 +412,20 @@ void DockWidgetBase::setFloating(bool floats)
 
 QAction *DockWidgetBase::toggleAction() const
 {
-    return d->toggleAction;
+    return d->ensureToggleAction();
 }
 
 QAction *DockWidgetBase::floatAction() const
+{
+    return d->ensureFloatAction();
+}
+
+QAction *DockWidgetBase::existingToggleAction() const
+{
+    return d->toggleAction;
+}
+
+QAction *DockWidgetBase::existingFloatAction() const
 {
     return d->floatAction;
 }
@@ -300,6 +445,7 @@ void DockWidgetBase::setTitle(const QString &title)
     if (title != d->title) {
         d->title = title;
         d->updateTitle();
+        DockRegistry::self()->onTitleChanged(this);
         Q_EMIT titleChanged();
     }
 }
@@ -378,7 +524,22 @@ TitleBar *DockWidgetBase::titleBar() const
 
 bool DockWidgetBase::isOpen() const
 {
-    return d->toggleAction->isChecked();
+    return d->isOpen;
+}
+
+int DockWidgetBase::tabIndex() const
+{
+    Frame *frame = this->frame();
+    return frame ? frame->tabWidget()->indexOfDockWidget(const_cast<DockWidgetBase*>(this)) : -1;
+}
+
+void DockWidgetBase::setTabIndex(int index)
+{
+    if (Frame *frame = this->frame()) {
+        frame->moveWidget(this, index);
+    } else {
+        qWarning() << Q_FUNC_INFO << "Not in a frame" << this;
+    }
 }
 
 QString DockWidgetBase::affinityName() const
@@ -388,6 +549,10 @@ QString DockWidgetBase::affinityName() const
 
 void DockWidgetBase::show()
 {
+    // Its floating window might not have been restored yet, see RestoreOption_DeferOffscreenFloatingWindows
+    if (LayoutSaver::restoreDeferredFloatingWindowFor(this))
+        return;
+
     if (isWindow() && (d->m_lastPositions.wasFloating() || !d->m_lastPositions.isValid())) {
         // Create the FloatingWindow already, instead of waiting for the show event.
         // This reduces flickering on some platforms
@@ -397,6 +562,94 @@ void DockWidgetBase::show()
     }
 }
 
+void DockWidgetBase::showDockWidgets(const DockWidgetBase::List &dockWidgets)
+{
+    KDDW_TRACE_SCOPE("dock", "DockWidgetBase::showDockWidgets");
+
+    DockWidgetBase::List toRestore;
+    DockWidgetBase::List others;
+    for (DockWidgetBase *dw : dockWidgets) {
+        if (dw->d->shouldRestoreToPreviousPosition()) {
+            toRestore.push_back(dw);
+        } else {
+            others.push_back(dw);
+        }
+    }
+
+    Private::restoreToPreviousPositions(toRestore);
+
+    // The restored ones are already in their frames, like after show()
+    for (DockWidgetBase *dw : qAsConst(others))
+        dw->show();
+
+    // The frames and floating windows they left are freed now, not on the next event loop turn
+    DockRegistry::self()->deleteScheduled();
+}
+
+void DockWidgetBase::setDockWidgetsFloating(const DockWidgetBase::List &dockWidgets, bool floats)
+{
+    KDDW_TRACE_SCOPE("dock", "DockWidgetBase::setDockWidgetsFloating");
+
+    if (!floats) {
+        DockWidgetBase::List toRestore;
+        for (DockWidgetBase *dw : dockWidgets) {
+            if (!dw->isFloating() || toRestore.contains(dw))
+                continue;
+
+            dw->saveLastFloatingGeometry();
+            if (dw->d->m_lastPositions.isValid()) {
+                toRestore.push_back(dw);
+            } else {
+                dw->d->restoreToPreviousPosition(); // Just warns, like setFloating(false)
+            }
+        }
+
+        Private::restoreToPreviousPositions(toRestore);
+        DockRegistry::self()->deleteScheduled();
+        return;
+    }
+
+    QVector<QPair<FloatingWindow*, QRect>> floatingWindows;
+    {
+        // Each layout they leave relayouts once, when its batch is committed
+        QVector<QPointer<MultiSplitterLayout>> layouts;
+        TitleBarVisibilityBatch titleBarBatch;
+
+        for (DockWidgetBase *dw : dockWidgets) {
+            Frame *frame = dw->frame();
+            if (!frame || dw->isFloating())
+                continue;
+
+            MultiSplitterLayout *layout = DockRegistry::self()->layoutForItem(frame->layoutItem());
+            if (layout && !layouts.contains(layout)) {
+                layout->beginBatch();
+                layouts.push_back(layout);
+            }
+
+            // Where the frame is now, as widget geometries are only updated when the batches are committed
+            const QRect lastGeo = dw->lastPositions().lastFloatingGeometry();
+            const QRect geometry = lastGeo.isValid() ? lastGeo
+                                                     : QRect(frame->mapToGlobal(QPoint(0, 0)), frame->size());
+
+            dw->d->saveTabIndex();
+            FloatingWindow *floatingWindow = dw->isTabbed() ? dw->d->parentTabWidget()->detachIntoFloatingWindow(dw)
+                                                            : FloatingWindowPool::self()->floatingWindowFor(frame);
+            floatingWindows.push_back({ floatingWindow, geometry });
+        }
+
+        for (MultiSplitterLayout *layout : qAsConst(layouts)) {
+            if (layout)
+                layout->commitBatch();
+        }
+    }
+
+    // Shown last, with their title bars already up to date
+    for (const auto &floatingWindow : qAsConst(floatingWindows)) {
+        floatingWindow.first->setGeometry(floatingWindow.second);
+        floatingWindow.first->show();
+    }
+}
+
 void DockWidgetBase::raise()
 {
     if (!isOpen())
@@ -423,6 +676,7 @@ void DockWidgetBase::setAffinityName(const QString &name)
     }
 
     d->affinityName = name;
+    DockRegistry::self()->onAffinityNameChanged(this, QString());
 }
 
 FloatingWindow *DockWidgetBase::morphIntoFloatingWindow()
@@ -442,9 +696,9 @@ FloatingWindow *DockWidgetBase::morphIntoFloatingWindow()
                 geo.moveCenter(center);
         }
 
-        auto frame = Config::self().frameworkWidgetFactory()->createFrame();
+        auto frame = FramePool::self()->frame();
         frame->addWidget(this);
-        auto floatingWindow = Config::self().frameworkWidgetFactory()->createFloatingWindow(frame);
+        auto floatingWindow = FloatingWindowPool::self()->floatingWindowFor(frame);
         floatingWindow->setGeometry(geo);
         floatingWindow->show();
 
@@ -509,11 +763,11 @@ QPoint DockWidgetBase::Private::defaultCenterPosForFloating()
 
 void DockWidgetBase::Private::updateTitle()
 {
-    if (q->isFloating())
+    if (q->isFloating() && q->window()->windowTitle() != title)
         q->window()->setWindowTitle(title);
 
-
-    toggleAction->setText(title);
+    if (toggleAction)
+        toggleAction->setText(title);
 }
 
 void DockWidgetBase::Private::updateIcon()
@@ -533,15 +787,16 @@ void DockWidgetBase::Private::updateToggleAction()
 {
     QScopedValueRollback<bool> recursionGuard(m_updatingToggleAction, true); // Guard against recursiveness
     m_updatingToggleAction = true;
-    if ((q->isVisible() || parentTabWidget()) && !toggleAction->isChecked()) {
-        toggleAction->setChecked(true);
-    } else if ((!q->isVisible() && !parentTabWidget()) && toggleAction->isChecked()) {
-        toggleAction->setChecked(false);
-    }
+    isOpen = q->isVisible() || parentTabWidget();
+    if (toggleAction && toggleAction->isChecked() != isOpen)
+        toggleAction->setChecked(isOpen);
 }
 
 void DockWidgetBase::Private::updateFloatAction()
 {
+    if (!floatAction)
+        return; // Updated when created
+
     QScopedValueRollback<bool> recursionGuard(m_updatingFloatAction, true); // Guard against recursiveness
 
     if (q->isFloating()) {
@@ -567,6 +822,175 @@ void DockWidgetBase::Private::onDockWidgetHidden()
     updateToggleAction();
     updateFloatAction();
     qCDebug(hiding) << Q_FUNC_INFO << "parent=" << q->parentWidget();
+
+    maybeScheduleUnload();
+}
+
+void DockWidgetBase::Private::updateWatchedWindow()
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    const bool watch = Config::self().flags() & Config::Flag_SuspendHiddenContent;
+    QWidget *window = watch ? q->window() : nullptr;
+    if (watchedWindow != window) {
+        if (watchedWindow)
+            watchedWindow->removeEventFilter(q);
+        watchedWindow = window;
+        if (window && window != q) // Our own WindowStateChange already reaches us
+            window->installEventFilter(q);
+    }
+
+    QWindow *windowHandle = window ? window->windowHandle() : nullptr;
+    if (watchedWindowHandle != windowHandle) {
+        if (watchedWindowHandle)
+            watchedWindowHandle->removeEventFilter(q);
+        watchedWindowHandle = windowHandle;
+        if (windowHandle)
+            windowHandle->installEventFilter(q);
+    }
+#endif
+}
+
+void DockWidgetBase::Private::updateVisibleToUser()
+{
+    updateWatchedWindow();
+
+    bool visible = q->isVisible();
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (visible && watchedWindow) {
+        QWidget *window = q->window();
+        visible = !window->isMinimized() && (!window->windowHandle() || window->windowHandle()->isExposed());
+    }
+#endif
+
+    if (visible != isVisibleToUser) {
+        isVisibleToUser = visible;
+        qCDebug(hiding) << Q_FUNC_INFO << q << "visibleToUser=" << visible;
+        setContentSuspended(!visible && (Config::self().flags() & Config::Flag_SuspendHiddenContent));
+        Q_EMIT q->visibleToUserChanged(visible);
+    }
+}
+
+void DockWidgetBase::Private::setContentSuspended(bool suspended)
+{
+    if (suspended == contentSuspended)
+        return;
+
+    contentSuspended = suspended;
+    if (widget) {
+        if (suspended) {
+            updatesEnabledBeforeSuspend = widget->updatesEnabled();
+            widget->setUpdatesEnabled(false);
+        } else {
+            widget->setUpdatesEnabled(updatesEnabledBeforeSuspend);
+        }
+    }
+
+    if (suspended) {
+        for (const QPointer<QTimer> &timer : qAsConst(updateSources)) {
+            if (timer && timer->isActive()) {
+                timer->stop();
+                pausedUpdateSources.push_back(timer);
+            }
+        }
+    } else {
+        for (const QPointer<QTimer> &timer : qAsConst(pausedUpdateSources)) {
+            if (timer)
+                timer->start();
+        }
+        pausedUpdateSources.clear();
+    }
+}
+
+void DockWidgetBase::Private::maybeCreateWidget()
+{
+    if (unloadTimer)
+        unloadTimer->stop();
+
+    if (widget || !widgetFactory)
+        return;
+
+    if (QWidget *w = widgetFactory()) {
+        q->setWidget(w);
+    } else {
+        qWarning() << Q_FUNC_INFO << "Widget factory returned nullptr" << q;
+    }
+}
+
+void DockWidgetBase::Private::maybeScheduleUnload()
+{
+    if (!unloadTimer || !widget)
+        return;
+
+    if (unloadPolicy == UnloadPolicy_WhenClosed && q->isOpen())
+        return;
+
+    unloadTimer->start();
+}
+
+void DockWidgetBase::Private::unloadWidget()
+{
+    if (!widget || !widgetFactory || q->isVisible())
+        return;
+
+    // Reopened meanwhile, into a background tab
+    if (unloadPolicy == UnloadPolicy_WhenClosed && q->isOpen())
+        return;
+
+    qCDebug(hiding) << Q_FUNC_INFO << "Deleting hidden widget" << widget;
+    QWidget *w = widget;
+    widget = nullptr;
+    Q_EMIT q->widgetChanged(nullptr);
+    delete w;
+}
+
+DockWidgetBase *DockWidgetBase::Private::createLoadingPlaceholder(const QString &name)
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    auto dw = new DockWidget(name);
+    auto label = new QLabel(tr("Loading..."));
+    label->setAlignment(Qt::AlignCenter);
+    dw->setWidget(label);
+#else
+    auto dw = new DockWidgetQuick(name);
+#endif
+    return dw;
+}
+
+void DockWidgetBase::Private::loadContent(const QFuture<DockWidgetContentFunc> &future)
+{
+    contentWatcher = new QFutureWatcher<DockWidgetContentFunc>(q);
+    q->connect(contentWatcher, &QFutureWatcherBase::finished, q, [this] {
+        onContentLoaded(contentWatcher->future());
+    });
+    contentWatcher->setFuture(future);
+}
+
+void DockWidgetBase::Private::onContentLoaded(const QFuture<DockWidgetContentFunc> &future)
+{
+    contentWatcher->deleteLater();
+    contentWatcher = nullptr;
+
+    const DockWidgetContentFunc contentFunc = (future.isCanceled() || future.resultCount() == 0)
+                                              ? DockWidgetContentFunc() : future.result();
+    QWidgetOrQuick *content = contentFunc ? contentFunc(q) : nullptr;
+    if (!content) {
+        qWarning() << Q_FUNC_INFO << "Couldn't load the content of" << name;
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+        if (auto label = qobject_cast<QLabel*>(widget))
+            label->setText(tr("Failed to load"));
+#endif
+        return;
+    }
+
+    // Swapped like unloadWidget() does, the frame and tab stay as restored
+    QWidgetOrQuick *placeholder = widget;
+    if (placeholder) {
+        widget = nullptr;
+        Q_EMIT q->widgetChanged(nullptr);
+        delete placeholder;
+    }
+
+    q->setWidget(content);
 }
 
 TabWidget *DockWidgetBase::Private::parentTabWidget() const
@@ -592,6 +1016,10 @@ void DockWidgetBase::Private::close()
         tabWidget->removeDockWidget(q);
         q->setParent(nullptr);
     }
+
+    // The hide might have happened while still open, before the tab was removed
+    updateToggleAction();
+    maybeScheduleUnload();
 }
 
 void DockWidgetBase::Private::restoreToPreviousPosition()
@@ -611,17 +1039,43 @@ void DockWidgetBase::Private::restoreToPreviousPosition()
 void DockWidgetBase::Private::maybeRestoreToPreviousPosition()
 {
     // This is called when we get a QEvent::Show. Let's see if we have to restore it to a previous position.
+    if (shouldRestoreToPreviousPosition())
+        restoreToPreviousPosition();
+}
 
+void DockWidgetBase::Private::restoreToPreviousPositions(const DockWidgetBase::List &dockWidgets)
+{
+    // Grouped by layout, so each restores its placeholders in one go
+    QVector<MultiSplitterLayout*> layouts;
+    QVector<DockWidgetBase::List> placeholderRestores;
+    for (DockWidgetBase *dw : dockWidgets) {
+        MultiSplitterLayout *layout = DockRegistry::self()->layoutForItem(dw->d->m_lastPositions.lastItem());
+        Q_ASSERT(layout);
+        int index = layouts.indexOf(layout);
+        if (index == -1) {
+            index = layouts.size();
+            layouts.push_back(layout);
+            placeholderRestores.push_back(DockWidgetBase::List());
+        }
+        placeholderRestores[index].push_back(dw);
+    }
+
+    for (int i = 0; i < layouts.size(); ++i)
+        layouts.at(i)->restorePlaceholders(placeholderRestores.at(i));
+}
+
+bool DockWidgetBase::Private::shouldRestoreToPreviousPosition() const
+{
     if (!m_lastPositions.isValid())
-        return;
+        return false;
 
     Layouting::Item *layoutItem = m_lastPositions.lastItem();
     qCDebug(placeholder) << Q_FUNC_INFO << layoutItem << m_lastPositions;
     if (!layoutItem)
-        return; // nothing to do, no last position
+        return false; // nothing to do, no last position
 
     if (m_lastPositions.wasFloating())
-        return; // Nothing to do, it was floating before, now it'll just get visible
+        return false; // Nothing to do, it was floating before, now it'll just get visible
 
     Frame *frame = q->frame();
 
@@ -629,7 +1083,7 @@ void DockWidgetBase::Private::maybeRestoreToPreviousPosition()
         // There's a frame already. Means the DockWidget was hidden instead of closed.
         // Nothing to do, the dock widget will simply be shown
         qCDebug(placeholder) << Q_FUNC_INFO << "Already had frame.";
-        return;
+        return false;
     }
 
     // Now we deal with the case where the DockWidget was close()ed. In this case it doesn't have a parent.
@@ -637,11 +1091,10 @@ void DockWidgetBase::Private::maybeRestoreToPreviousPosition()
     if (q->parentWidget()) {
         // The QEvent::Show is due to it being made floating. Nothing to restore.
         qCDebug(placeholder) << Q_FUNC_INFO << "Already had parentWidget";
-        return;
+        return false;
     }
 
-    // Finally, restore it
-    restoreToPreviousPosition();
+    return true;
 }
 
 int DockWidgetBase::Private::currentTabIndex() const
@@ -663,13 +1116,17 @@ void DockWidgetBase::Private::show()
 
 void DockWidgetBase::onParentChanged()
 {
+    DockRegistry::self()->updateClosedState(this);
     Q_EMIT parentChanged();
     d->updateToggleAction();
     d->updateFloatAction();
+    d->updateVisibleToUser();
 }
 
 void DockWidgetBase::onShown(bool spontaneous)
 {
+    DockRegistry::self()->updateClosedState(this);
+    d->maybeCreateWidget(); // Before 'shown', so listeners already see the widget
     Q_EMIT shown();
 
     if (Frame *f = frame()) {
@@ -679,6 +1136,7 @@ void DockWidgetBase::onShown(bool spontaneous)
     }
 
     d->maybeRestoreToPreviousPosition();
+    d->updateVisibleToUser();
 
     // Transform into a FloatingWindow if this will be a regular floating dock widget.
     QTimer::singleShot(0, this, &DockWidgetBase::maybeMorphIntoFloatingWindow);
@@ -686,6 +1144,7 @@ void DockWidgetBase::onShown(bool spontaneous)
 
 void DockWidgetBase::onHidden(bool spontaneous)
 {
+    DockRegistry::self()->updateClosedState(this);
     Q_EMIT hidden();
 
     if (Frame *f = frame()) {
@@ -693,6 +1152,8 @@ void DockWidgetBase::onHidden(bool spontaneous)
             f->onDockWidgetHidden(this);
         }
     }
+
+    d->updateVisibleToUser();
 }
 
 void DockWidgetBase::onClosed(QCloseEvent *e)
@@ -705,6 +1166,15 @@ void DockWidgetBase::onClosed(QCloseEvent *e)
         d->close();
 }
 
+bool DockWidgetBase::setRestoredBy(quint64 restoreGeneration)
+{
+    if (d->restoreGeneration == restoreGeneration)
+        return false;
+
+    d->restoreGeneration = restoreGeneration;
+    return true;
+}
+
 DockWidgetBase *DockWidgetBase::deserialize(const LayoutSaver::DockWidget::Ptr &saved)
 {
     DockWidgetBase *dw = DockRegistry::self()->dockByName(saved->uniqueName);
@@ -715,10 +1185,18 @@ DockWidgetBase *DockWidgetBase::deserialize(const LayoutSaver::DockWidget::Ptr &
         }
     }
 
+    if (!dw) {
+        if (auto asyncFactoryFunc = Config::self().asyncDockWidgetFactoryFunc()) {
+            // Restored right away, the content follows once the application has loaded it
+            dw = Private::createLoadingPlaceholder(saved->uniqueName);
+            dw->d->loadContent(asyncFactoryFunc(saved->uniqueName));
+        }
+    }
+
     if (dw) {
         if (QWidget *w = dw->widget())
             w->setVisible(true);
-        dw->setProperty("kddockwidget_was_restored", true);
+        LayoutSaver::markRestored(dw);
 
         if (dw->affinityName() != saved->affinityName) {
             qWarning() << Q_FUNC_INFO << "Affinity name changed from" << dw->affinityName()
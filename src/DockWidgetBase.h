@@ -37,8 +37,11 @@
 #include <QVector>
 #include <QWidget>
 
+#include <functional>
+
 QT_BEGIN_NAMESPACE
 class QAction;
+class QTimer;
 QT_END_NAMESPACE
 
 namespace Layouting {
@@ -70,14 +73,25 @@ class DOCKS_EXPORT DockWidgetBase : public QWidgetOrQuick
 public:
     typedef QVector<DockWidgetBase *> List;
 
+    ///@brief Creates the widget a dock widget hosts. See setWidgetFactory()
+    typedef std::function<QWidget*()> WidgetFactoryFunc;
+
     ///@brief DockWidget options to pass at construction time
     enum Option {
         Option_None = 0, ///< No option, the default
         Option_NotClosable = 1, /// The DockWidget can't be closed on the [x], only programatically
-        Option_NotDockable = 2 ///< The DockWidget can't be docked, it's always floating
+        Option_NotDockable = 2, ///< The DockWidget can't be docked, it's always floating
+        Option_StableContentWindow = 4, ///< The hosted widget lives in its own native window, embedded into the DockWidget, and is never reparented when docking, undocking or tabbing. Avoids recreating the GL contexts and surfaces of QOpenGLWidget, QQuickWidget and native children. Focus and stacking follow the QWidget::createWindowContainer() rules. Only supported with QtWidgets.
+        Option_FixedOnParentResize = 8 ///< When the layout it's docked in is resized, its frame keeps its width or height and the other frames absorb the change, as long as they can. For tool panels around a flexible central area. Tabbed dock widgets share the frame, so one of them having it is enough.
     };
     Q_DECLARE_FLAGS(Options, Option)
 
+    ///@brief When a widget created by setWidgetFactory() is deleted again
+    enum UnloadPolicy {
+        UnloadPolicy_WhenHidden = 0, ///< Once hidden for a while, for any reason. Includes background tabs and minimized windows
+        UnloadPolicy_WhenClosed ///< Only once closed for a while. Panels the user can see by switching tabs stay loaded
+    };
+
     /**
      * @brief constructs a new DockWidget
      * @param name the name of the dockwidget, should be unique. Use title for user visible text.
@@ -134,9 +148,26 @@ public:
 
     /**
      * @brief returns the widget which this dock widget hosts
+     *
+     * With setWidgetFactory() it's nullptr until the dock widget is first shown.
      */
     QWidget *widget() const;
 
+    /**
+     * @brief Sets a function that creates the hosted widget on demand, instead of calling setWidget()
+     *
+     * @p factory is called the first time the dock widget is shown, which includes its tab becoming
+     * current. Useful when there's many dock widgets that start closed or in background tabs.
+     *
+     * @param factory The function returning the widget to host.
+     * @param unloadAfterMs If not -1, the widget is deleted once the dock widget has been hidden for
+     *        this many milliseconds, and @p factory is called again the next time it's shown.
+     * @param policy Whether any hiding starts the countdown, or only closing. Either way the dock
+     *        widget itself, its last positions and its saved state are kept.
+     */
+    void setWidgetFactory(const WidgetFactoryFunc &factory, int unloadAfterMs = -1,
+                          UnloadPolicy policy = UnloadPolicy_WhenHidden);
+
     /**
      * @brief Returns whether the dock widget is floating.
      * Floating means it's not docked and has a window of its own.
@@ -154,13 +185,13 @@ public:
 
     /**
      * @brief Returns the QAction that allows to hide/show the dock widget
-     * Useful to put in menus.
+     * Useful to put in menus. Created on the first call.
      */
     QAction *toggleAction() const;
 
     /**
      * @brief Returns the QAction that allows to dock/undock the dock widget
-     * Useful to put in menus.
+     * Useful to put in menus. Created on the first call.
      */
     QAction *floatAction() const;
 
@@ -253,6 +284,17 @@ public:
      */
     bool isOpen() const;
 
+    ///@brief Returns the position of this dock widget among the tabs of its frame, or -1 if it has no frame
+    int tabIndex() const;
+
+    /**
+     * @brief Moves this dock widget to position @p index among the tabs of its frame.
+     *
+     * Only the tab order changes, the dock widget isn't removed and reinserted, so its widget,
+     * geometry and placeholders are left untouched. The current tab stays current.
+     */
+    void setTabIndex(int index);
+
     /**
      * @brief Sets the affinity name. Dock widgets can only dock into dock widgets of the same affinity.
      *
@@ -280,6 +322,48 @@ public:
     /// @brief Equivalent to QWidget::show(), but it's optimized to reduce flickering on some platforms
     void show();
 
+    /**
+     * @brief Shows several dock widgets at once. Equivalent to calling show() on each of them.
+     *
+     * The ones that were closed while docked are restored to their previous positions in a single
+     * layout transaction, so each affected part of the layout is resized once, instead of once per
+     * dock widget. Useful for reopening a set of dock widgets, like the ones of a previous session.
+     */
+    static void showDockWidgets(const DockWidgetBase::List &dockWidgets);
+
+    /**
+     * @brief Equivalent to calling setFloating() on each of @p dockWidgets.
+     *
+     * Detaching removes all of them from their layouts first, with a single relayout per layout,
+     * and only then shows the new floating windows. Docking them back restores them like
+     * showDockWidgets(). See also Config::setFloatingWindowPoolSize().
+     */
+    static void setDockWidgetsFloating(const DockWidgetBase::List &dockWidgets, bool floats);
+
+    /**
+     * @brief Returns whether the user can currently see this dock widget.
+     *
+     * Unlike isVisible() this is also false if the window containing it is minimized or not
+     * exposed, for example because it's fully occluded, on platforms that report that. The window
+     * is only watched for that with Config::Flag_SuspendHiddenContent.
+     * @sa visibleToUserChanged()
+     */
+    bool isVisibleToUser() const;
+
+    /**
+     * @brief Returns whether this is a placeholder restored with Config::setAsyncDockWidgetFactoryFunc()
+     * whose content is still loading. widgetChanged() is emitted once it's there.
+     */
+    bool isLoadingContent() const;
+
+    /**
+     * @brief Registers a timer that drives updates of this dock widget's content.
+     *
+     * With Config::Flag_SuspendHiddenContent the timer is stopped while the dock widget isn't
+     * visible to the user, and restarted when it becomes visible again, if it was running.
+     */
+    void addUpdateSource(QTimer *timer);
+
     /// @brief Brings the dock widget to the front.
     ///
     /// This means:
@@ -308,6 +392,9 @@ Q_SIGNALS:
     ///@brief emitted when the hosted widget changed
     void widgetChanged(QWidget*);
 
+    ///@brief emitted when isVisibleToUser() changes
+    void visibleToUserChanged(bool visible);
+
     ///@brief emitted when the options change
     ///@sa setOptions(), options()
     void optionsChanged(KDDockWidgets::DockWidgetBase::Options);
@@ -317,6 +404,7 @@ protected:
     void onShown(bool spontaneous);
     void onHidden(bool spontaneous);
     void onClosed(QCloseEvent *e);
+    bool eventFilter(QObject *, QEvent *) override;
 
 #if defined(DOCKS_DEVELOPER_MODE)
 public Q_SLOTS:
@@ -339,6 +427,11 @@ public:
 private:
 #endif
     Q_DISABLE_COPY(DockWidgetBase)
+
+    ///@brief Returns the toggle and float actions, or nullptr for those not created yet. Unlike
+    ///toggleAction() and floatAction(), doesn't create them. For DockRegistry::memoryUsage()
+    QAction *existingToggleAction() const;
+    QAction *existingFloatAction() const;
     friend class MultiSplitterLayout;
     friend class Frame;
     friend class DropArea;
@@ -377,6 +470,10 @@ private:
     ///@brief If this dock widget is floating, then it saves its geometry
     void saveLastFloatingGeometry();
 
+    ///@brief Called by LayoutSaver for each dock widget the restore @p restoreGeneration restores.
+    ///Returns false if that restore already did, so it's only recorded once
+    bool setRestoredBy(quint64 restoreGeneration);
+
     class Private;
     Private *const d;
 };
@@ -25,9 +25,11 @@
 #include "multisplitter/Separator_p.h"
 #include "FloatingWindow_p.h"
 #include "Config.h"
+#include "multisplitter/Tracing_p.h"
 
 #ifdef KDDOCKWIDGETS_QTWIDGETS
 # include "indicators/ClassicIndicators_p.h"
+# include "indicators/AnimatedIndicators_p.h"
 # include "widgets/FrameWidget_p.h"
 # include "widgets/TitleBarWidget_p.h"
 # include "widgets/TabBarWidget_p.h"
@@ -46,6 +48,8 @@
 
 using namespace KDDockWidgets;
 
+DropIndicatorType DefaultWidgetFactory::s_dropIndicatorType = DropIndicatorType::Classic;
+
 FrameworkWidgetFactory::~FrameworkWidgetFactory()
 {
 }
@@ -53,92 +57,117 @@ FrameworkWidgetFactory::~FrameworkWidgetFactory()
 #ifdef KDDOCKWIDGETS_QTWIDGETS
 Frame *DefaultWidgetFactory::createFrame(QWidgetOrQuick *parent, FrameOptions options) const
 {
+    KDDW_TRACE_SCOPE("factory", "createFrame");
     return new FrameWidget(parent, options);
 }
 
 TitleBar *DefaultWidgetFactory::createTitleBar(Frame *frame) const
 {
+    KDDW_TRACE_SCOPE("factory", "createTitleBar");
     return new TitleBarWidget(frame);
 }
 
 TitleBar *DefaultWidgetFactory::createTitleBar(FloatingWindow *fw) const
 {
+    KDDW_TRACE_SCOPE("factory", "createTitleBar");
     return new TitleBarWidget(fw);
 }
 
 TabBar *DefaultWidgetFactory::createTabBar(TabWidget *parent) const
 {
+    KDDW_TRACE_SCOPE("factory", "createTabBar");
     return new TabBarWidget(parent);
 }
 
 TabWidget *DefaultWidgetFactory::createTabWidget(Frame *parent) const
 {
+    KDDW_TRACE_SCOPE("factory", "createTabWidget");
     return new TabWidgetWidget(parent);
 }
 
 Layouting::Separator *DefaultWidgetFactory::createSeparator(QWidget *parent) const
 {
+    KDDW_TRACE_SCOPE("factory", "createSeparator");
     return new SeparatorWidget(parent);
 }
 
 FloatingWindow *DefaultWidgetFactory::createFloatingWindow(MainWindowBase *parent) const
 {
+    KDDW_TRACE_SCOPE("factory", "createFloatingWindow");
     return new FloatingWindowWidget(parent);
 }
 
 FloatingWindow *DefaultWidgetFactory::createFloatingWindow(Frame *frame, MainWindowBase *parent) const
 {
+    KDDW_TRACE_SCOPE("factory", "createFloatingWindow");
     return new FloatingWindowWidget(frame, parent);
 }
 
 DropIndicatorOverlayInterface *DefaultWidgetFactory::createDropIndicatorOverlay(DropArea *dropArea) const
 {
+    KDDW_TRACE_SCOPE("factory", "createDropIndicatorOverlay");
+    switch (s_dropIndicatorType) {
+    case DropIndicatorType::Classic:
+        return new ClassicIndicators(dropArea);
+    case DropIndicatorType::Animated:
+        return new AnimatedIndicators(dropArea);
+    }
+
     return new ClassicIndicators(dropArea);
 }
 #else
 
 Frame *DefaultWidgetFactory::createFrame(QWidgetOrQuick *parent, Frame::Options options) const
 {
+    KDDW_TRACE_SCOPE("factory", "createFrame");
     return new FrameQuick(parent, options);
 }
 
 TitleBar *DefaultWidgetFactory::createTitleBar(Frame *frame) const
 {
+    KDDW_TRACE_SCOPE("factory", "createTitleBar");
     return new TitleBarQuick(frame);
 }
 
 TitleBar *DefaultWidgetFactory::createTitleBar(FloatingWindow *fw) const
 {
+    KDDW_TRACE_SCOPE("factory", "createTitleBar");
     return new TitleBarQuick(fw);
 }
 
 TabBar *DefaultWidgetFactory::createTabBar(TabWidget *tb) const
 {
+    KDDW_TRACE_SCOPE("factory", "createTabBar");
     return new TabBarQuick(tb);
 }
 
 TabWidget *DefaultWidgetFactory::createTabWidget(Frame *frame) const
 {
+    KDDW_TRACE_SCOPE("factory", "createTabWidget");
     return new TabWidgetQuick(frame);
 }
 
 Separator *DefaultWidgetFactory::createSeparator(QWidgetAdapter *parent) const
 {
+    KDDW_TRACE_SCOPE("factory", "createSeparator");
     return new SeparatorQuick(parent);
 }
 
 FloatingWindow *DefaultWidgetFactory::createFloatingWindow(QWidgetOrQuick *parent) const
 {
+    KDDW_TRACE_SCOPE("factory", "createFloatingWindow");
     return new FloatingWindowQuick(parent);
 }
 
 FloatingWindow *DefaultWidgetFactory::createFloatingWindow(Frame *frame, QWidgetOrQuick *parent) const
 {
+    KDDW_TRACE_SCOPE("factory", "createFloatingWindow");
     return new FloatingWindowQuick(frame, parent);
 }
 
 DropIndicatorOverlayInterface *DefaultWidgetFactory::createDropIndicatorOverlay(DropArea *) const
 {
+    KDDW_TRACE_SCOPE("factory", "createDropIndicatorOverlay");
     return nullptr;
 }
 #endif
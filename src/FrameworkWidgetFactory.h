@@ -146,6 +146,9 @@ public:
     FloatingWindow *createFloatingWindow(MainWindowBase *parent = nullptr) const override;
     FloatingWindow *createFloatingWindow(Frame *frame, MainWindowBase *parent = nullptr) const override;
     DropIndicatorOverlayInterface *createDropIndicatorOverlay(DropArea*) const override;
+
+    ///@brief The drop indicators createDropIndicatorOverlay() creates. Set it before creating any main window.
+    static DropIndicatorType s_dropIndicatorType;
 private:
     Q_DISABLE_COPY(DefaultWidgetFactory)
 };
@@ -42,7 +42,8 @@ namespace KDDockWidgets
 
     enum MainWindowOption {
         MainWindowOption_None = 0, ///> No option set
-        MainWindowOption_HasCentralFrame = 1 ///> Makes the MainWindow always have a central frame, for tabbing documents
+        MainWindowOption_HasCentralFrame = 1, ///> Makes the MainWindow always have a central frame, for tabbing documents
+        MainWindowOption_LockedLayout = 2 ///> Starts with the layout locked, see MainWindowBase::setLayoutLocked()
     };
     Q_DECLARE_FLAGS(MainWindowOptions, MainWindowOption)
 
@@ -63,6 +64,14 @@ namespace KDDockWidgets
         RestoreOption_None = 0,
         RestoreOption_RelativeToMainWindow = 1, ///< Skips restoring the main window geometry and the restored dock widgets will use relative sizing.
                                                 ///< Loading layouts won't change the main window geometry and just use whatever the user has at the moment.
+        RestoreOption_InPlace = 2, ///< If the saved layout has the same windows, frames and tabs as the current one, only geometries, separators
+                                   ///< and current tabs are updated, nothing is rebuilt. Otherwise it's restored as usual.
+        RestoreOption_DeferOffscreenFloatingWindows = 4, ///< Floating windows saved on screens that aren't connected are only restored when one of
+                                                         ///< their dock widgets is shown or when a screen they fit in is attached.
+        RestoreOption_Progressive = 8, ///< Only the main windows and the floating windows on the primary screen are restored right away. The other floating windows,
+                                       ///< the closed dock widgets and the placeholders follow from the event loop, a few at a time. See LayoutSaver::setRestoreFinishedCallback().
+        RestoreOption_SkipIfUnchanged = 16, ///< Nothing is restored if the saved layout is what LayoutSaver::serializeLayout() would return right now, see LayoutSaver::layoutHash().
+                                            ///< Combine with RestoreOption_InPlace so nearly identical layouts are cheap too.
     };
     Q_DECLARE_FLAGS(RestoreOptions, RestoreOption)
 
@@ -75,6 +84,12 @@ namespace KDDockWidgets
         SizePolicy, ///< Uses the item's sizeHint() and sizePolicy()
     };
 
+    ///@brief The drop indicators to use, see DefaultWidgetFactory::s_dropIndicatorType
+    enum class DropIndicatorType {
+        Classic, ///< The default. Arrows to drop on, in a top-level window above the drop area
+        Animated ///< Bands along the edges of the drop area and of the hovered frame, which inflate when hovered. QtWidgets only.
+    };
+
     ///@internal
     inline QString locationStr(Location loc)
     {
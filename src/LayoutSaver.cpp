@@ -27,6 +27,7 @@
 
 #include "LayoutSaver.h"
 #include "LayoutSaver_p.h"
+#include "LayoutStore.h"
 #include "Config.h"
 #include "DockRegistry_p.h"
 #include "DockWidgetBase.h"
@@ -34,7 +35,9 @@
 #include "Logging_p.h"
 #include "Frame_p.h"
 #include "Position_p.h"
+#include "FloatingWindowPool_p.h"
 #include "multisplitter/Item_p.h"
+#include "multisplitter/Tracing_p.h"
 #include "FrameworkWidgetFactory.h"
 #include "MainWindow.h"
 
@@ -42,8 +45,24 @@
 #include <QDebug>
 #include <QSettings>
 #include <QApplication>
+#include <QCache>
+#include <QCryptographicHash>
 #include <QFile>
-
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QPainter>
+#include <QPointer>
+#include <QScreen>
+#include <QSet>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QScopedValueRollback>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <algorithm>
 #include <memory>
 
 using namespace KDDockWidgets;
@@ -76,23 +95,564 @@ public:
     }
 
     bool matchesAffinity(const QString &affinityName) const {
-        return m_affinityNames.isEmpty() || affinityName.isEmpty() || m_affinityNames.contains(affinityName);
+        return m_affinityNames.isEmpty() || affinityName.isEmpty() || m_affinityNameSet.contains(affinityName);
+    }
+
+    ///@brief Returns the dock widgets matching our affinities, only visiting the matching registry partitions
+    DockWidgetBase::List matchingDockWidgets() const
+    {
+        if (m_affinityNames.isEmpty())
+            return m_dockRegistry->dockwidgets();
+
+        DockWidgetBase::List result = m_dockRegistry->dockWidgetsWithAffinity(QString());
+        for (const QString &affinityName : qAsConst(m_affinityNames)) {
+            if (!affinityName.isEmpty())
+                result << m_dockRegistry->dockWidgetsWithAffinity(affinityName);
+        }
+
+        return result;
     }
 
+    ///@brief A layout saved in memory with LayoutSaver::savePerspective()
+    struct Perspective
+    {
+        LayoutSaver::Layout layout;
+
+        // DockWidget entries are shared between all layouts, by name. So keep our own copy of
+        // the positions, as saving or parsing another layout overwrites them.
+        QHash<QString, LayoutSaver::Position> lastPositions;
+    };
+
+    ///@brief Shows restored windows only once the restore is done, so each is shown once, at its
+    ///final geometry and with its final contents. Their updates are disabled meanwhile.
+    struct DeferredShows
+    {
+        explicit DeferredShows(Private *d)
+            : m_d(d)
+        {
+            m_d->m_deferredShows = this;
+        }
+
+        ~DeferredShows()
+        {
+            m_d->m_deferredShows = nullptr;
+            for (const Window &window : qAsConst(m_windows)) {
+                if (QWidgetOrQuick *topLevel = window.topLevel) {
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+                    topLevel->setUpdatesEnabled(window.updatesEnabled);
+#endif
+                    topLevel->setVisible(window.visible);
+                }
+            }
+        }
+
+        struct Window {
+            QPointer<QWidgetOrQuick> topLevel;
+            bool visible;
+            bool updatesEnabled; // Before the restore disabled them
+        };
+
+        Private *const m_d;
+        QVector<Window> m_windows;
+        Q_DISABLE_COPY(DeferredShows)
+    };
+
     template <typename T>
     void deserializeWindowGeometry(const T &saved, QWidgetOrQuick *topLevel);
+    void setWindowVisible(QWidgetOrQuick *topLevel, bool visible);
     void deleteEmptyFrames();
-    void clearRestoredProperty();
+    ///@brief Starts a new restore generation, forgetting the dock widgets the previous restore restored
+    static void startRestoreGeneration();
+    void serialize(LayoutSaver::Layout &layout) const;
+    void serialize(Perspective &perspective) const;
+    QByteArray serialize(LayoutSaver::Format format) const;
+
+    ///@brief Returns the hash of serialized, uncompressed, layout @p data
+    static QByteArray contentHash(const QByteArray &data);
+    ///@brief Returns what LayoutSaver::layoutHash() returns. See s_contentHashes
+    QByteArray currentContentHash(LayoutSaver::Format format) const;
+    ///@brief Returns whether restoring @p data, with hash @p hash, wouldn't change anything
+    bool isCurrentLayout(const QByteArray &data, const QByteArray &hash) const;
+    ///@brief Remembers that the layout with @p hash was produced or validated already
+    static void trust(const QByteArray &hash);
+    bool m_trustedLayout = false; // Skips the validation in restore(), see trust()
+    bool restore(const LayoutSaver::Layout &layout);
+    bool restore(const Perspective &perspective);
+    bool canRestoreInPlace(const LayoutSaver::Layout &layout) const;
+    void restoreInPlace(const LayoutSaver::Layout &layout);
 
     std::unique_ptr<QSettings> settings() const;
     DockRegistry *const m_dockRegistry;
     const RestoreOptions m_restoreOptions;
     QStringList m_affinityNames;
+    QSet<QString> m_affinityNameSet; // Same as m_affinityNames, for lookups
+    DeferredShows *m_deferredShows = nullptr;
+    bool m_preferInPlace = false; // Like RestoreOption_InPlace, for restoreSnapshot()
+
+    ///@brief A floating window not restored yet. See RestoreOption_DeferOffscreenFloatingWindows.
+    struct DeferredFloatingWindow
+    {
+        LayoutSaver::FloatingWindow floatingWindow;
+        QPointer<MainWindowBase> parent; // The saved parentIndex goes stale
+        RestoreOptions options;
+        QStringList dockWidgets;
+    };
+
+    ///@brief Returns whether any connected screen shows part of @p geometry
+    static bool isOnConnectedScreen(QRect geometry);
+    void deferFloatingWindow(const LayoutSaver::FloatingWindow &, MainWindowBase *parent);
+    static bool restoreDeferredFloatingWindow(int index);
+
+    ///@brief Deserializes @p position into @p dockWidget. With @p remap, the floating window
+    ///placeholders are remapped from their saved index, through @p restoredFloatingWindows.
+    void restorePosition(DockWidgetBase *dockWidget, LayoutSaver::Position position, bool remap,
+                         const QVector<QPointer<KDDockWidgets::FloatingWindow>> &restoredFloatingWindows) const;
+
+    ///@brief Return @p fw and @p position scaled, with RestoreOption_RelativeToMainWindow. See m_scalingInfos
+    LayoutSaver::FloatingWindow scaled(const LayoutSaver::FloatingWindow &fw) const;
+    LayoutSaver::Position scaled(const LayoutSaver::Position &position) const;
+
+    // By saved main window index. Empty without RestoreOption_RelativeToMainWindow
+    QVector<LayoutSaver::ScalingInfo> m_scalingInfos;
+
+    struct ProgressiveRestore;
+    static void scheduleProgressiveRestoreChunk();
+    static void completeProgressiveRestore();
+    static void cancelProgressiveRestore();
+    std::function<void()> m_restoreFinishedCallback;
+
+    struct AutoSave;
+    struct Journal;
+
+    ///@brief A window's last serialization, still valid while its layout generation doesn't change
+    template <typename T>
+    struct CachedWindow
+    {
+        quint64 generation;
+        T window;
+    };
+
+    template <typename T>
+    static void pruneCache(QHash<const QObject*, CachedWindow<T>> &cache, const QVector<const QObject*> &windows);
 
     static bool s_restoreInProgress;
+    static quint64 s_restoreGeneration; // Bumped by each restore, see startRestoreGeneration()
+    static QVector<QPointer<DockWidgetBase>> s_restoredDockWidgets; // By the last restore, in restore order
+    static QHash<QString, Perspective> s_perspectives;
+    static QVector<DeferredFloatingWindow> s_deferredFloatingWindows;
+    static AutoSave *s_autoSave;
+    static Journal *s_journal;
+    static ProgressiveRestore *s_progressiveRestore;
+    static QHash<QString, Perspective> s_screenVariants; // By screenConfigurationKey()
+    struct ScreenFollower;
+    static ScreenFollower *s_screenFollower;
+    static quint64 s_progressiveRestoreSerial; // So chunks scheduled for a cancelled restore don't run
+    static QHash<const QObject*, CachedWindow<LayoutSaver::MainWindow>> s_mainWindowCache;
+    static QHash<const QObject*, CachedWindow<LayoutSaver::FloatingWindow>> s_floatingWindowCache;
+
+    ///@brief The hash of a serialization, still valid while no layout generation changes
+    struct ContentHash
+    {
+        quint64 generation;
+        LayoutSaver::Format format; // Never CompressedBinary, that one hashes the Binary data
+        QStringList affinityNames;
+        QByteArray hash;
+    };
+    static QVector<ContentHash> s_contentHashes;
+    static QVector<QByteArray> s_trustedHashes; // Most recent last
+
+    ///@brief Makes @p current share with @p previous whatever is equal in both. See takeSnapshot().
+    static void shareUnchanged(Perspective &current, const Perspective &previous);
+    static std::weak_ptr<const LayoutSaver::Snapshot::Data> s_lastSnapshot;
+};
+
+struct LayoutSaver::Snapshot::Data
+{
+    LayoutSaver::Private::Perspective perspective;
 };
 
 bool LayoutSaver::Private::s_restoreInProgress = false;
+quint64 LayoutSaver::Private::s_restoreGeneration = 0;
+QVector<QPointer<DockWidgetBase>> LayoutSaver::Private::s_restoredDockWidgets;
+QHash<QString, LayoutSaver::Private::Perspective> LayoutSaver::Private::s_perspectives;
+std::weak_ptr<const LayoutSaver::Snapshot::Data> LayoutSaver::Private::s_lastSnapshot;
+QVector<LayoutSaver::Private::DeferredFloatingWindow> LayoutSaver::Private::s_deferredFloatingWindows;
+QHash<const QObject*, LayoutSaver::Private::CachedWindow<LayoutSaver::MainWindow>> LayoutSaver::Private::s_mainWindowCache;
+QHash<const QObject*, LayoutSaver::Private::CachedWindow<LayoutSaver::FloatingWindow>> LayoutSaver::Private::s_floatingWindowCache;
+QVector<LayoutSaver::Private::ContentHash> LayoutSaver::Private::s_contentHashes;
+QVector<QByteArray> LayoutSaver::Private::s_trustedHashes;
+
+namespace {
+
+// Encodes and writes a snapshot taken on the GUI thread. Doesn't touch anything else.
+class AutoSaveJob : public QRunnable
+{
+public:
+    AutoSaveJob(const QString &filename, const QVariantMap &snapshot, const QByteArray &encoded, bool compress)
+        : m_filename(filename)
+        , m_snapshot(snapshot)
+        , m_encoded(encoded)
+        , m_compress(compress)
+    {
+    }
+
+    void run() override
+    {
+        QByteArray data = m_encoded.isEmpty() ? QJsonDocument::fromVariant(LayoutSaver::Layout::normalizedMap(m_snapshot)).toJson()
+                                              : m_encoded;
+        if (m_compress)
+            data = LayoutSaver::Layout::compressed(data);
+
+        QSaveFile f(m_filename);
+        if (!f.open(QIODevice::WriteOnly) || f.write(data) != data.size() || !f.commit())
+            qWarning() << Q_FUNC_INFO << "Failed to autosave to" << m_filename << f.errorString();
+    }
+
+private:
+    const QString m_filename;
+    const QVariantMap m_snapshot;
+    const QByteArray m_encoded;
+    const bool m_compress;
+};
+
+}
+
+struct LayoutSaver::Private::AutoSave
+{
+    AutoSave()
+    {
+        // Writes land in the order they were scheduled
+        m_pool.setMaxThreadCount(1);
+        m_timer.setSingleShot(true);
+        QObject::connect(&m_timer, &QTimer::timeout, [this] { save(); });
+    }
+
+    ~AutoSave()
+    {
+        QObject::disconnect(m_connection);
+        QObject::disconnect(m_registryDestroyedConnection);
+        m_pool.waitForDone();
+    }
+
+    void onLayoutChanged()
+    {
+        if (!m_timer.isActive()) {
+            m_dirtySince.start();
+        } else if (m_dirtySince.elapsed() > 4 * m_delay) {
+            return; // Let it fire, changes keep coming
+        }
+
+        m_timer.start(m_delay);
+    }
+
+    void save()
+    {
+        m_timer.stop();
+        if (LayoutSaver::restoreInProgress()) {
+            m_timer.start(m_delay);
+            return;
+        }
+
+        DockRegistry *registry = DockRegistry::self();
+        if (!registry->isSane()) {
+            qWarning() << Q_FUNC_INFO << "Not autosaving this layout. Check previous warnings.";
+            return;
+        }
+
+        LayoutSaver::Private d(RestoreOption_None);
+        LayoutSaver::Layout layout;
+        d.serialize(layout);
+
+        // Dock widget entries are shared with later saves, so encoding binary can't wait for the worker
+        if (m_format == LayoutSaver::Format::Json)
+            m_pool.start(new AutoSaveJob(m_filename, layout.toVariantMap(), {}, false));
+        else
+            m_pool.start(new AutoSaveJob(m_filename, {}, layout.toBinary(),
+                                         m_format == LayoutSaver::Format::CompressedBinary));
+    }
+
+    QString m_filename;
+    LayoutSaver::Format m_format = LayoutSaver::Format::Json;
+    int m_delay = 0;
+    QTimer m_timer;
+    QElapsedTimer m_dirtySince;
+    QThreadPool m_pool;
+    QMetaObject::Connection m_connection;
+    QMetaObject::Connection m_registryDestroyedConnection;
+};
+
+LayoutSaver::Private::AutoSave *LayoutSaver::Private::s_autoSave = nullptr;
+
+void LayoutSaver::setAutoSaveFile(const QString &filename, Format format, int delayMs)
+{
+    if (filename.isEmpty()) {
+        delete Private::s_autoSave;
+        Private::s_autoSave = nullptr;
+        return;
+    }
+
+    if (!Private::s_autoSave) {
+        Private::s_autoSave = new Private::AutoSave();
+        QObject::connect(qApp, &QObject::destroyed, [] {
+            delete Private::s_autoSave;
+            Private::s_autoSave = nullptr;
+        });
+    }
+
+    Private::s_autoSave->m_filename = filename;
+    Private::s_autoSave->m_format = format;
+    Private::s_autoSave->m_delay = delayMs;
+
+    DockRegistry *registry = DockRegistry::self();
+    QObject::disconnect(Private::s_autoSave->m_connection);
+    Private::s_autoSave->m_connection = QObject::connect(registry, &DockRegistry::layoutChanged, [] {
+        Private::s_autoSave->onLayoutChanged();
+    });
+
+    // An empty registry has nothing to save, only pending writes are kept
+    QObject::disconnect(Private::s_autoSave->m_registryDestroyedConnection);
+    Private::s_autoSave->m_registryDestroyedConnection = QObject::connect(registry, &QObject::destroyed, [] {
+        if (Private::s_autoSave)
+            Private::s_autoSave->m_timer.stop();
+    });
+}
+
+namespace {
+
+// The first line of a journal. Unlike the binary magic, it can't be mistaken for JSON either
+static const char s_journalMagic[] = "KDDockWidgets journal";
+
+///@brief Adds to @p record the entries of @p current, by uniqueName, that changed since @p previous.
+///And the list of names, if they aren't the same as before, since positions are stored by index.
+void diffByName(const QVariantList &previous, const QVariantList &current, QVariantMap &record,
+                const QString &listKey, const QString &namesKey)
+{
+    QHash<QString, QVariant> previousByName;
+    QStringList previousNames;
+    for (const QVariant &v : previous) {
+        const QString name = v.toMap().value(QStringLiteral("uniqueName")).toString();
+        previousByName.insert(name, v);
+        previousNames << name;
+    }
+
+    QVariantMap changed;
+    QStringList names;
+    for (const QVariant &v : current) {
+        const QString name = v.toMap().value(QStringLiteral("uniqueName")).toString();
+        names << name;
+        if (previousByName.value(name) != v)
+            changed.insert(name, v);
+    }
+
+    if (!changed.isEmpty())
+        record.insert(listKey, changed);
+    if (names != previousNames)
+        record.insert(namesKey, names);
+}
+
+///@brief The reverse of diffByName()
+void applyByName(QVariantMap &layout, const QVariantMap &record, const QString &listKey, const QString &namesKey)
+{
+    const QVariantMap changed = record.value(listKey).toMap();
+    if (changed.isEmpty() && !record.contains(namesKey))
+        return;
+
+    QHash<QString, QVariant> entries;
+    QStringList names;
+    const QVariantList list = layout.value(listKey).toList();
+    for (const QVariant &v : list) {
+        const QString name = v.toMap().value(QStringLiteral("uniqueName")).toString();
+        entries.insert(name, v);
+        names << name;
+    }
+
+    for (auto it = changed.cbegin(), end = changed.cend(); it != end; ++it) {
+        if (!entries.contains(it.key()))
+            names << it.key();
+        entries.insert(it.key(), it.value());
+    }
+
+    if (record.contains(namesKey))
+        names = record.value(namesKey).toStringList();
+
+    QVariantList result;
+    result.reserve(names.size());
+    for (const QString &name : qAsConst(names))
+        result.push_back(entries.value(name));
+    layout.insert(listKey, result);
+}
+
+// Small and only saved whole, floating windows have no unique name to diff by
+static const char *const s_wholeJournalKeys[] = { "serializationVersion", "floatingWindows",
+                                                  "closedDockWidgets", "screenInfo" };
+
+///@brief What changed between @p previous and @p current, both from Layout::toVariantMap(). Empty if nothing did.
+QVariantMap journalRecord(const QVariantMap &previous, const QVariantMap &current)
+{
+    QVariantMap record;
+    for (const char *key : s_wholeJournalKeys) {
+        const QString k = QString::fromLatin1(key);
+        if (previous.value(k) != current.value(k))
+            record.insert(k, current.value(k));
+    }
+
+    diffByName(previous.value(QStringLiteral("mainWindows")).toList(), current.value(QStringLiteral("mainWindows")).toList(),
+               record, QStringLiteral("mainWindows"), QStringLiteral("mainWindowNames"));
+    diffByName(previous.value(QStringLiteral("allDockWidgets")).toList(), current.value(QStringLiteral("allDockWidgets")).toList(),
+               record, QStringLiteral("allDockWidgets"), QStringLiteral("dockWidgetNames"));
+
+    return record;
+}
+
+void applyJournalRecord(QVariantMap &layout, const QVariantMap &record)
+{
+    for (const char *key : s_wholeJournalKeys) {
+        const QString k = QString::fromLatin1(key);
+        if (record.contains(k))
+            layout.insert(k, record.value(k));
+    }
+
+    applyByName(layout, record, QStringLiteral("mainWindows"), QStringLiteral("mainWindowNames"));
+    applyByName(layout, record, QStringLiteral("allDockWidgets"), QStringLiteral("dockWidgetNames"));
+}
+
+}
+
+struct LayoutSaver::Private::Journal
+{
+    Journal()
+    {
+        // A single operation changes the layout several times, they all go in one record
+        m_timer.setSingleShot(true);
+        m_timer.setInterval(0);
+        QObject::connect(&m_timer, &QTimer::timeout, [this] { append(); });
+    }
+
+    ~Journal()
+    {
+        QObject::disconnect(m_connection);
+        QObject::disconnect(m_registryDestroyedConnection);
+    }
+
+    void append()
+    {
+        m_timer.stop();
+        if (LayoutSaver::restoreInProgress()) {
+            m_timer.start();
+            return;
+        }
+
+        DockRegistry *registry = DockRegistry::self();
+        if (!registry->isSane()) {
+            qWarning() << Q_FUNC_INFO << "Not journaling this layout. Check previous warnings.";
+            return;
+        }
+
+        LayoutSaver::Private d(RestoreOption_None);
+        LayoutSaver::Layout layout;
+        d.serialize(layout);
+        const QVariantMap current = layout.toVariantMap();
+
+        if (m_numRecords == -1 || m_numRecords >= m_compactAfter) {
+            compact(current);
+            return;
+        }
+
+        const QVariantMap record = journalRecord(m_journaled, current);
+        if (record.isEmpty())
+            return;
+
+        const QByteArray line = QJsonDocument::fromVariant(record).toJson(QJsonDocument::Compact) + '\n';
+        QFile f(m_filename);
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Append) || f.write(line) != line.size() || !f.flush()) {
+            qWarning() << Q_FUNC_INFO << "Failed to journal to" << m_filename << f.errorString();
+            m_numRecords = -1; // Don't know what's in the file now, start over with a snapshot
+            return;
+        }
+
+        m_journaled = current;
+        m_numRecords++;
+    }
+
+    void compact(const QVariantMap &current)
+    {
+        QByteArray data = QByteArray(s_journalMagic) + '\n';
+        data += QJsonDocument::fromVariant(current).toJson(QJsonDocument::Compact) + '\n';
+
+        QSaveFile f(m_filename);
+        if (!f.open(QIODevice::WriteOnly) || f.write(data) != data.size() || !f.commit()) {
+            qWarning() << Q_FUNC_INFO << "Failed to journal to" << m_filename << f.errorString();
+            m_numRecords = -1;
+            return;
+        }
+
+        m_journaled = current;
+        m_numRecords = 0;
+    }
+
+    QString m_filename;
+    int m_compactAfter = 100;
+    int m_numRecords = -1; // Since the last snapshot. -1 if there's none yet
+    QVariantMap m_journaled; // The layout as the file has it
+    QTimer m_timer;
+    QMetaObject::Connection m_connection;
+    QMetaObject::Connection m_registryDestroyedConnection;
+};
+
+LayoutSaver::Private::Journal *LayoutSaver::Private::s_journal = nullptr;
+
+void LayoutSaver::setAutoSaveJournal(const QString &filename, int compactAfter)
+{
+    if (filename.isEmpty()) {
+        delete Private::s_journal;
+        Private::s_journal = nullptr;
+        return;
+    }
+
+    if (!Private::s_journal) {
+        Private::s_journal = new Private::Journal();
+        QObject::connect(qApp, &QObject::destroyed, [] {
+            delete Private::s_journal;
+            Private::s_journal = nullptr;
+        });
+    }
+
+    Private::Journal *journal = Private::s_journal;
+    if (journal->m_filename != filename)
+        journal->m_numRecords = -1; // Starts with a snapshot
+    journal->m_filename = filename;
+    journal->m_compactAfter = qMax(1, compactAfter);
+
+    DockRegistry *registry = DockRegistry::self();
+    QObject::disconnect(journal->m_connection);
+    journal->m_connection = QObject::connect(registry, &DockRegistry::layoutChanged, [] {
+        if (!Private::s_journal->m_timer.isActive())
+            Private::s_journal->m_timer.start();
+    });
+
+    QObject::disconnect(journal->m_registryDestroyedConnection);
+    journal->m_registryDestroyedConnection = QObject::connect(registry, &QObject::destroyed, [] {
+        if (Private::s_journal)
+            Private::s_journal->m_timer.stop();
+    });
+
+    // The file gets its snapshot right away, replacing whatever was restored from it
+    journal->m_timer.start();
+}
+
+void LayoutSaver::flushAutoSave()
+{
+    if (Private::s_journal && Private::s_journal->m_timer.isActive())
+        Private::s_journal->append();
+
+    if (!Private::s_autoSave)
+        return;
+
+    if (Private::s_autoSave->m_timer.isActive())
+        Private::s_autoSave->save();
+
+    Private::s_autoSave->m_pool.waitForDone();
+}
 
 LayoutSaver::LayoutSaver(RestoreOptions options)
     : d(new Private(options))
@@ -104,9 +664,9 @@ LayoutSaver::~LayoutSaver()
     delete d;
 }
 
-bool LayoutSaver::saveToFile(const QString &jsonFilename)
+bool LayoutSaver::saveToFile(const QString &jsonFilename, Format format)
 {
-    const QByteArray data = serializeLayout();
+    const QByteArray data = serializeLayout(format);
 
     QFile f(jsonFilename);
     if (!f.open(QIODevice::WriteOnly)) {
@@ -132,259 +692,2096 @@ bool LayoutSaver::restoreFromFile(const QString &jsonFilename)
     return result;
 }
 
-QByteArray LayoutSaver::serializeLayout() const
+bool LayoutSaver::saveToStore(LayoutStore &store, const QString &name, Format format)
+{
+    const QByteArray data = serializeLayout(format);
+    if (data.isEmpty())
+        return false;
+
+    // The affinities actually saved, so a layout picker can filter without parsing the layouts
+    QSet<QString> affinityNames;
+    const MainWindowBase::List mainWindows = d->m_dockRegistry->mainwindows();
+    for (MainWindowBase *mainWindow : mainWindows) {
+        if (d->matchesAffinity(mainWindow->affinityName()))
+            affinityNames.insert(mainWindow->affinityName());
+    }
+
+    const QVector<KDDockWidgets::FloatingWindow*> floatingWindows = d->m_dockRegistry->nestedwindows();
+    for (KDDockWidgets::FloatingWindow *floatingWindow : floatingWindows) {
+        if (d->matchesAffinity(floatingWindow->affinityName()))
+            affinityNames.insert(floatingWindow->affinityName());
+    }
+
+    QStringList sortedNames = affinityNames.values();
+    sortedNames.sort();
+    store.insert(name, data, sortedNames);
+    return true;
+}
+
+bool LayoutSaver::restoreFromStore(const LayoutStore &store, const QString &name)
+{
+    if (!store.contains(name)) {
+        qWarning() << Q_FUNC_INFO << "No layout called" << name << "in" << store.filename();
+        return false;
+    }
+
+    return restoreLayout(store.layout(name));
+}
+
+QByteArray LayoutSaver::serializeLayout(Format format) const
+{
+    KDDW_TRACE_SCOPE("restore", "LayoutSaver::serializeLayout");
+    if (!d->m_dockRegistry->isSane()) {
+        qWarning() << Q_FUNC_INFO << "Refusing to serialize this layout. Check previous warnings.";
+        return {};
+    }
+
+    if (format == Format::CompressedBinary)
+        return LayoutSaver::Layout::compressed(d->serialize(Format::Binary));
+
+    return d->serialize(format);
+}
+
+QByteArray LayoutSaver::layoutHash(Format format) const
 {
     if (!d->m_dockRegistry->isSane()) {
         qWarning() << Q_FUNC_INFO << "Refusing to serialize this layout. Check previous warnings.";
         return {};
     }
 
+    return d->currentContentHash(format);
+}
+
+QByteArray LayoutSaver::Private::serialize(LayoutSaver::Format format) const
+{
     LayoutSaver::Layout layout;
+    serialize(layout);
+    const QByteArray data = format == LayoutSaver::Format::Json ? layout.toJson() : layout.toBinary();
+
+    // Saving is frequent, with autosave, so each result is hashed for layoutHash() already
+    const quint64 generation = m_dockRegistry->lastLayoutGeneration();
+    const QByteArray hash = contentHash(data);
+    s_contentHashes.erase(std::remove_if(s_contentHashes.begin(), s_contentHashes.end(),
+                                         [this, generation, format] (const ContentHash &cached) {
+                                             return cached.generation != generation ||
+                                                    (cached.format == format && cached.affinityNames == m_affinityNames);
+                                         }), s_contentHashes.end());
+    s_contentHashes.push_back({ generation, format, m_affinityNames, hash });
+    trust(hash);
+
+    return data;
+}
+
+QByteArray LayoutSaver::Private::contentHash(const QByteArray &data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+QByteArray LayoutSaver::Private::currentContentHash(LayoutSaver::Format format) const
+{
+    if (format == LayoutSaver::Format::CompressedBinary)
+        format = LayoutSaver::Format::Binary;
+
+    const quint64 generation = m_dockRegistry->lastLayoutGeneration();
+    for (const ContentHash &cached : qAsConst(s_contentHashes)) {
+        if (cached.generation == generation && cached.format == format && cached.affinityNames == m_affinityNames)
+            return cached.hash;
+    }
+
+    serialize(format);
+    return s_contentHashes.constLast().hash;
+}
+
+bool LayoutSaver::Private::isCurrentLayout(const QByteArray &data, const QByteArray &hash) const
+{
+    // Restoring those would still change something, and journals are never what's serialized
+    if (s_progressiveRestore || !s_deferredFloatingWindows.isEmpty() || LayoutSaver::Layout::isJournal(data) ||
+        !m_dockRegistry->isSane())
+        return false;
+
+    const LayoutSaver::Format format = LayoutSaver::Layout::isBinary(data) ? LayoutSaver::Format::Binary
+                                                                          : LayoutSaver::Format::Json;
+    return currentContentHash(format) == hash;
+}
+
+void LayoutSaver::Private::trust(const QByteArray &hash)
+{
+    // Just a few, the last saved and restored ones are what's typically restored again
+    s_trustedHashes.removeOne(hash);
+    s_trustedHashes.push_back(hash);
+    if (s_trustedHashes.size() > 16)
+        s_trustedHashes.removeFirst();
+}
+
+void LayoutSaver::Private::serialize(LayoutSaver::Layout &layout) const
+{
+    KDDW_TRACE_SCOPE("restore", "LayoutSaver::serialize");
+    // Otherwise what's still pending wouldn't be saved
+    finishProgressiveRestore();
+
+    // Just a simplification. One less type of windows to handle.
+    m_dockRegistry->ensureAllFloatingWidgetsAreMorphed();
+
+    // Windows whose layout didn't change since the last save reuse what was serialized then
+    QVector<const QObject*> windows;
+
+    const MainWindowBase::List mainWindows = m_dockRegistry->mainwindows();
+    layout.mainWindows.reserve(mainWindows.size());
+    for (MainWindowBase *mainWindow : mainWindows) {
+        windows.push_back(mainWindow);
+        if (!matchesAffinity(mainWindow->affinityName()))
+            continue;
+
+        // window() as the MainWindow can be embedded
+        const quint64 generation = m_dockRegistry->layoutGeneration(mainWindow->window());
+        auto it = s_mainWindowCache.find(mainWindow);
+        if (it == s_mainWindowCache.end() || it->generation != generation)
+            it = s_mainWindowCache.insert(mainWindow, { generation, mainWindow->serialize() });
+
+        layout.mainWindows.push_back(it->window);
+    }
+
+    pruneCache(s_mainWindowCache, windows);
+    windows.clear();
+
+    const QVector<KDDockWidgets::FloatingWindow*> floatingWindows = m_dockRegistry->nestedwindows();
+    layout.floatingWindows.reserve(floatingWindows.size());
+    for (KDDockWidgets::FloatingWindow *floatingWindow : floatingWindows) {
+        windows.push_back(floatingWindow);
+        if (!matchesAffinity(floatingWindow->affinityName()))
+            continue;
+
+        const quint64 generation = m_dockRegistry->layoutGeneration(floatingWindow);
+        auto it = s_floatingWindowCache.find(floatingWindow);
+        if (it == s_floatingWindowCache.end() || it->generation != generation)
+            it = s_floatingWindowCache.insert(floatingWindow, { generation, floatingWindow->serialize() });
+
+        layout.floatingWindows.push_back(it->window);
+    }
+
+    pruneCache(s_floatingWindowCache, windows);
+
+    // Not restored yet, but still part of the layout. Their dock widgets aren't really closed.
+    QSet<QString> deferredDockWidgets;
+    for (const DeferredFloatingWindow &deferred : qAsConst(s_deferredFloatingWindows)) {
+        if (!matchesAffinity(deferred.floatingWindow.affinityName))
+            continue;
+
+        LayoutSaver::FloatingWindow fw = deferred.floatingWindow;
+        fw.parentIndex = deferred.parent ? mainWindows.indexOf(deferred.parent) : -1;
+        layout.floatingWindows.push_back(fw);
+        for (const QString &name : deferred.dockWidgets)
+            deferredDockWidgets.insert(name);
+    }
+
+    // Closed dock widgets also have interesting things to save, like geometry and placeholder info
+    const DockWidgetBase::List &closedDockWidgets = m_dockRegistry->closedDockwidgets();
+    layout.closedDockWidgets.reserve(closedDockWidgets.size());
+    for (DockWidgetBase *dockWidget : closedDockWidgets) {
+        if (matchesAffinity(dockWidget->affinityName()) && !deferredDockWidgets.contains(dockWidget->uniqueName()))
+            layout.closedDockWidgets.push_back(dockWidget->serialize());
+    }
+
+    // Save the placeholder info. We do it last, as we also restore it last, since we need all items to be created
+    // before restoring the placeholders
+
+    const DockWidgetBase::List dockWidgets = matchingDockWidgets();
+    layout.allDockWidgets.reserve(dockWidgets.size());
+    for (DockWidgetBase *dockWidget : dockWidgets) {
+        auto dw = dockWidget->serialize();
+        dw->lastPosition = dockWidget->lastPositions().serialize();
+        layout.allDockWidgets.push_back(dw);
+    }
+}
+
+template <typename T>
+void LayoutSaver::Private::pruneCache(QHash<const QObject*, CachedWindow<T>> &cache,
+                                      const QVector<const QObject*> &windows)
+{
+    // Deleted windows, their address might be reused
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (windows.contains(it.key()))
+            ++it;
+        else
+            it = cache.erase(it);
+    }
+}
+
+bool LayoutSaver::restoreLayout(const QByteArray &data)
+{
+    KDDW_TRACE_SCOPE("restore", "LayoutSaver::restoreLayout");
+    Private::startRestoreGeneration();
+    if (data.isEmpty())
+        return true;
+
+    if (LayoutSaver::Layout::isCompressed(data)) {
+        const QByteArray uncompressed = LayoutSaver::Layout::uncompressed(data);
+        if (uncompressed.isEmpty() || LayoutSaver::Layout::isCompressed(uncompressed)) {
+            qWarning() << Q_FUNC_INFO << "Failed to uncompress data";
+            return false;
+        }
+
+        return restoreLayout(uncompressed);
+    }
+
+    // For example a "reset perspective" to the perspective that's already there
+    const QByteArray hash = Private::contentHash(data);
+    if ((d->m_restoreOptions & RestoreOption_SkipIfUnchanged) && d->isCurrentLayout(data, hash)) {
+        if (d->m_restoreFinishedCallback)
+            d->m_restoreFinishedCallback();
+        return true;
+    }
+
+    LayoutSaver::Layout layout;
+    if (LayoutSaver::Layout::isJournal(data)) {
+        // Traced here, as replayJournal() is also used off the GUI thread, by renderThumbnail()
+        KDDW_TRACE_SCOPE("restore", "LayoutSaver::Layout::replayJournal");
+        QVariantMap map;
+        if (!LayoutSaver::Layout::replayJournal(data, map)) {
+            qWarning() << Q_FUNC_INFO << "Failed to replay journal";
+            return false;
+        }
+
+        layout.fromVariantMap(map);
+    } else if (LayoutSaver::Layout::isBinary(data)) {
+        if (!layout.fromBinary(data)) {
+            qWarning() << Q_FUNC_INFO << "Failed to parse binary data";
+            return false;
+        }
+    } else if (!layout.fromJson(data)) {
+        qWarning() << Q_FUNC_INFO << "Failed to parse json data";
+        return false;
+    }
+
+    // What this process serialized, or restored before, doesn't need to be validated again
+    QScopedValueRollback<bool> trusted(d->m_trustedLayout, Private::s_trustedHashes.contains(hash));
+    if (!d->restore(layout))
+        return false;
+
+    Private::trust(hash);
+    return true;
+}
+
+namespace {
+
+// Fixed colors, the application's palette can't be used outside of the GUI thread
+const QColor s_thumbnailBorderColor(0x60, 0x60, 0x60);
+const QColor s_thumbnailWindowColor(0xd0, 0xd0, 0xd0);
+const QColor s_thumbnailFrameColor(0xf4, 0xf4, 0xf4);
+const QColor s_thumbnailTabColor(0xe0, 0xe0, 0xe0);
+const QColor s_thumbnailCurrentTabColor(0xa8, 0xc8, 0xf0);
+
+///@brief Decodes any of the formats restoreLayout() accepts into toVariantMap() form, without
+///restoring anything or touching shared state
+bool thumbnailLayoutMap(const QByteArray &data, QVariantMap &map)
+{
+    if (LayoutSaver::Layout::isCompressed(data)) {
+        const QByteArray uncompressed = LayoutSaver::Layout::uncompressed(data);
+        if (uncompressed.isEmpty() || LayoutSaver::Layout::isCompressed(uncompressed))
+            return false;
+
+        return thumbnailLayoutMap(uncompressed, map);
+    }
+
+    if (LayoutSaver::Layout::isJournal(data))
+        return LayoutSaver::Layout::replayJournal(data, map);
+
+    if (LayoutSaver::Layout::isBinary(data))
+        return LayoutSaver::Layout::windowsFromBinary(data, map);
+
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject())
+        return false;
+
+    map = LayoutSaver::Layout::denormalizedMap(doc.toVariant().toMap());
+    return true;
+}
+
+///@brief Maps @p rect from @p from's coordinates into @p to, scaling each axis independently
+QRectF mapThumbnailRect(const QRectF &rect, const QRectF &from, const QRectF &to)
+{
+    const qreal sx = to.width() / from.width();
+    const qreal sy = to.height() / from.height();
+    return QRectF(to.x() + (rect.x() - from.x()) * sx, to.y() + (rect.y() - from.y()) * sy,
+                  rect.width() * sx, rect.height() * sy);
+}
+
+void paintThumbnailFrame(QPainter &p, const QRectF &rect, const QVariantMap &frame)
+{
+    p.setPen(s_thumbnailBorderColor);
+    p.setBrush(s_thumbnailFrameColor);
+    p.drawRect(rect);
+
+    const QStringList names = frame.value(QStringLiteral("dockWidgets")).toStringList();
+    const QFontMetrics fm = p.fontMetrics();
+    const qreal tabHeight = qMin(rect.height() / 3, qreal(fm.height() + 4));
+    if (names.isEmpty() || tabHeight < 3)
+        return;
+
+    const int currentTabIndex = frame.value(QStringLiteral("currentTabIndex")).toInt();
+    const qreal tabWidth = rect.width() / names.size();
+    for (int i = 0; i < names.size(); ++i) {
+        const QRectF tabRect(rect.x() + i * tabWidth, rect.y(), tabWidth, tabHeight);
+        p.setBrush(i == currentTabIndex ? s_thumbnailCurrentTabColor : s_thumbnailTabColor);
+        p.drawRect(tabRect);
+
+        // Just the tab without label when too small to read
+        if (tabHeight >= fm.height() && tabWidth > 8) {
+            const QRectF textRect = tabRect.adjusted(2, 0, -2, 0);
+            p.drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter,
+                       fm.elidedText(names.at(i), Qt::ElideRight, int(textRect.width())));
+        }
+    }
+}
+
+///@brief Paints the visible leaves of the saved item tree @p item.
+///@p offset is the position of its parent container, in @p root's coordinates
+void paintThumbnailItem(QPainter &p, const QVariantMap &item, QPoint offset, const QVariantMap &frames,
+                        const QRectF &root, const QRectF &target)
+{
+    const QVariantMap sizingInfo = item.value(QStringLiteral("sizingInfo")).toMap();
+    const QRect geometry = Layouting::mapToRect(sizingInfo.value(QStringLiteral("geometry")).toMap()).translated(offset);
+
+    if (item.value(QStringLiteral("isContainer")).toBool()) {
+        const QVariantList children = item.value(QStringLiteral("children")).toList();
+        for (const QVariant &child : children)
+            paintThumbnailItem(p, child.toMap(), geometry.topLeft(), frames, root, target);
+    } else if (item.value(QStringLiteral("isVisible")).toBool()) {
+        const QVariantMap frame = frames.value(item.value(QStringLiteral("guestId")).toString()).toMap();
+        paintThumbnailFrame(p, mapThumbnailRect(geometry, root, target), frame);
+    }
+}
+
+///@brief Paints a window and its layout. The layout is stretched over the window, as the margins
+///and the title bar aren't saved
+void paintThumbnailWindow(QPainter &p, const QRectF &rect, const QVariantMap &multiSplitterLayout)
+{
+    p.setPen(s_thumbnailBorderColor);
+    p.setBrush(s_thumbnailWindowColor);
+    p.drawRect(rect);
+
+    const QVariantMap root = multiSplitterLayout.value(QStringLiteral("layout")).toMap();
+    const QVariantMap sizingInfo = root.value(QStringLiteral("sizingInfo")).toMap();
+    const QRect rootGeometry = Layouting::mapToRect(sizingInfo.value(QStringLiteral("geometry")).toMap());
+    const QRectF target = rect.adjusted(2, 2, -2, -2);
+    if (rootGeometry.isEmpty() || target.isEmpty())
+        return;
+
+    paintThumbnailItem(p, root, QPoint(), multiSplitterLayout.value(QStringLiteral("frames")).toMap(),
+                       rootGeometry, target);
+}
+
+QImage paintThumbnail(const QVariantMap &layout, QSize size)
+{
+    QVector<QPair<QRect, QVariantMap>> windows; // The geometry and the multiSplitterLayout
+    QRect bounds;
+    auto addWindow = [&windows, &bounds] (const QVariantMap &window) {
+        const QRect geometry = Layouting::mapToRect(window.value(QStringLiteral("geometry")).toMap());
+        if (geometry.isEmpty())
+            return;
+
+        windows.push_back({ geometry, window.value(QStringLiteral("multiSplitterLayout")).toMap() });
+        bounds |= geometry;
+    };
+
+    const QVariantList mainWindows = layout.value(QStringLiteral("mainWindows")).toList();
+    for (const QVariant &mainWindow : mainWindows)
+        addWindow(mainWindow.toMap());
+
+    // Floating windows after, so they're painted on top
+    const QVariantList floatingWindows = layout.value(QStringLiteral("floatingWindows")).toList();
+    for (const QVariant &floatingWindowV : floatingWindows) {
+        const QVariantMap floatingWindow = floatingWindowV.toMap();
+        if (floatingWindow.value(QStringLiteral("isVisible")).toBool())
+            addWindow(floatingWindow);
+    }
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    if (bounds.isEmpty())
+        return image;
+
+    // Keeps the aspect ratio, centered
+    const qreal scale = qMin(qreal(size.width() - 1) / bounds.width(), qreal(size.height() - 1) / bounds.height());
+    QRectF target(0, 0, bounds.width() * scale, bounds.height() * scale);
+    target.moveCenter(QRectF(0, 0, size.width() - 1, size.height() - 1).center());
+
+    QPainter p(&image);
+    for (const auto &window : qAsConst(windows))
+        paintThumbnailWindow(p, mapThumbnailRect(window.first, bounds, target), window.second);
+
+    return image;
+}
+
+}
+
+QImage LayoutSaver::renderThumbnail(const QByteArray &data, QSize size)
+{
+    if (size.isEmpty())
+        return {};
+
+    // Pickers render the same layouts over and over, for each repaint
+    static QMutex s_cacheMutex;
+    static QCache<QByteArray, QImage> s_cache(32);
+
+    QByteArray key = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    key += QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height());
+    {
+        QMutexLocker locker(&s_cacheMutex);
+        if (const QImage *image = s_cache.object(key))
+            return *image;
+    }
+
+    QVariantMap map;
+    if (!thumbnailLayoutMap(data, map)) {
+        qWarning() << Q_FUNC_INFO << "Failed to parse layout";
+        return {};
+    }
+
+    const QImage image = paintThumbnail(map, size);
+
+    QMutexLocker locker(&s_cacheMutex);
+    s_cache.insert(key, new QImage(image));
+    return image;
+}
+
+bool LayoutSaver::savePerspective(const QString &name)
+{
+    if (!d->m_dockRegistry->isSane()) {
+        qWarning() << Q_FUNC_INFO << "Refusing to save this layout. Check previous warnings.";
+        return false;
+    }
+
+    Private::Perspective perspective;
+    d->serialize(perspective);
+    Private::s_perspectives.insert(name, perspective);
+    return true;
+}
+
+bool LayoutSaver::restorePerspective(const QString &name)
+{
+    Private::startRestoreGeneration();
+    auto it = Private::s_perspectives.find(name);
+    if (it == Private::s_perspectives.end()) {
+        qWarning() << Q_FUNC_INFO << "No perspective called" << name;
+        return false;
+    }
+
+    return d->restore(*it);
+}
+
+QStringList LayoutSaver::perspectives()
+{
+    return Private::s_perspectives.keys();
+}
+
+void LayoutSaver::removePerspective(const QString &name)
+{
+    Private::s_perspectives.remove(name);
+}
+
+LayoutSaver::Snapshot LayoutSaver::takeSnapshot() const
+{
+    Snapshot snapshot;
+    if (!d->m_dockRegistry->isSane()) {
+        qWarning() << Q_FUNC_INFO << "Refusing to snapshot this layout. Check previous warnings.";
+        return snapshot;
+    }
+
+    auto data = std::make_shared<Snapshot::Data>();
+    d->serialize(data->perspective);
+
+    // Usually the previous undo step, so most of it is the same
+    if (std::shared_ptr<const Snapshot::Data> previous = Private::s_lastSnapshot.lock())
+        Private::shareUnchanged(data->perspective, previous->perspective);
+
+    Private::s_lastSnapshot = data;
+    snapshot.d = data;
+    return snapshot;
+}
+
+bool LayoutSaver::restoreSnapshot(const Snapshot &snapshot)
+{
+    Private::startRestoreGeneration();
+    if (snapshot.isNull()) {
+        qWarning() << Q_FUNC_INFO << "Null snapshot";
+        return false;
+    }
+
+    QScopedValueRollback<bool> preferInPlace(d->m_preferInPlace, true);
+    return d->restore(snapshot.d->perspective);
+}
+
+void LayoutSaver::Private::serialize(Perspective &perspective) const
+{
+    serialize(perspective.layout);
+    for (const auto &dw : qAsConst(perspective.layout.allDockWidgets))
+        perspective.lastPositions.insert(dw->uniqueName, dw->lastPosition);
+    for (const auto &dw : qAsConst(perspective.layout.closedDockWidgets))
+        perspective.lastPositions.insert(dw->uniqueName, dw->lastPosition);
+}
+
+bool LayoutSaver::Private::restore(const Perspective &perspective)
+{
+    // Bring back the positions other layouts might have overwritten since we were saved
+    for (auto it = perspective.lastPositions.cbegin(), end = perspective.lastPositions.cend(); it != end; ++it)
+        LayoutSaver::DockWidget::dockWidgetForName(it.key())->lastPosition = it.value();
+
+    return restore(perspective.layout);
+}
+
+namespace {
+
+bool samePosition(const LayoutSaver::Position &p1, const LayoutSaver::Position &p2)
+{
+    if (p1.lastFloatingGeometry != p2.lastFloatingGeometry || p1.tabIndex != p2.tabIndex ||
+        p1.wasFloating != p2.wasFloating || p1.placeholders.size() != p2.placeholders.size())
+        return false;
+
+    for (int i = 0; i < p1.placeholders.size(); ++i) {
+        const LayoutSaver::Placeholder &ph1 = p1.placeholders.at(i);
+        const LayoutSaver::Placeholder &ph2 = p2.placeholders.at(i);
+        if (ph1.isFloatingWindow != ph2.isFloatingWindow || ph1.indexOfFloatingWindow != ph2.indexOfFloatingWindow ||
+            ph1.itemIndex != ph2.itemIndex || ph1.mainWindowUniqueName != ph2.mainWindowUniqueName)
+            return false;
+    }
+
+    return true;
+}
+
+bool sameFrame(const LayoutSaver::Frame &f1, const LayoutSaver::Frame &f2)
+{
+    return f1.isNull == f2.isNull && f1.objectName == f2.objectName && f1.geometry == f2.geometry &&
+           f1.options == f2.options && f1.currentTabIndex == f2.currentTabIndex && f1.id == f2.id &&
+           f1.dockWidgets == f2.dockWidgets;
+}
+
+/**
+ * Replaces each entry of @p current that is equal in @p previous with the previous one, so they
+ * share their data. If all are, @p current becomes a copy of @p previous, sharing the hash too.
+ */
+template <typename T, typename Equal>
+void shareEntries(QHash<QString, T> &current, const QHash<QString, T> &previous, Equal equal)
+{
+    QHash<QString, T> result;
+    bool allShared = current.size() == previous.size();
+    for (auto it = current.cbegin(), end = current.cend(); it != end; ++it) {
+        auto previousIt = previous.constFind(it.key());
+        if (previousIt != previous.cend() && equal(*it, *previousIt)) {
+            result.insert(it.key(), *previousIt);
+        } else {
+            result.insert(it.key(), *it);
+            allShared = false;
+        }
+    }
+
+    current = allShared ? previous : result;
+}
+
+uint leafSignature(const QVariantMap &item)
+{
+    return qHash(item.value(QStringLiteral("guestId")).toString()) ^ qHash(item.value(QStringLiteral("objectName")).toString());
+}
+
+///@brief Identifies a layout item across snapshots. Sub-trees with the same guests have the same signature.
+uint collectItems(const QVariantMap &item, QHash<uint, QVariantMap> &items)
+{
+    uint signature = 1;
+    if (item.value(QStringLiteral("isContainer")).toBool()) {
+        const QVariantList children = item.value(QStringLiteral("children")).toList();
+        for (const QVariant &child : children)
+            signature = 31 * signature + collectItems(child.toMap(), items);
+    } else {
+        signature = leafSignature(item);
+    }
+
+    items.insert(signature, item);
+    return signature;
+}
+
+///@brief Replaces the sub-trees of @p item equal to a sub-tree in @p previousItems with it
+uint shareItems(QVariantMap &item, const QHash<uint, QVariantMap> &previousItems)
+{
+    uint signature = 1;
+    if (item.value(QStringLiteral("isContainer")).toBool()) {
+        QVariantList children = item.value(QStringLiteral("children")).toList();
+        for (QVariant &child : children) {
+            QVariantMap childMap = child.toMap();
+            signature = 31 * signature + shareItems(childMap, previousItems);
+            child = childMap;
+        }
+
+        item.insert(QStringLiteral("children"), children);
+    } else {
+        signature = leafSignature(item);
+    }
+
+    // Cheap, the children compare by pointer when they're already shared
+    auto it = previousItems.constFind(signature);
+    if (it != previousItems.cend() && *it == item)
+        item = *it;
+
+    return signature;
+}
+
+}
+
+void LayoutSaver::Private::shareUnchanged(Perspective &current, const Perspective &previous)
+{
+    QHash<uint, QVariantMap> previousItems;
+    // Windows are matched through their frames, as floating windows don't have a name
+    QHash<QString, const LayoutSaver::MultiSplitterLayout*> previousLayoutsByFrame;
+    auto collect = [&previousItems, &previousLayoutsByFrame] (const LayoutSaver::MultiSplitterLayout &layout) {
+        collectItems(layout.layout, previousItems);
+        for (auto it = layout.frames.cbegin(), end = layout.frames.cend(); it != end; ++it)
+            previousLayoutsByFrame.insert(it.key(), &layout);
+    };
+
+    for (const LayoutSaver::MainWindow &mw : qAsConst(previous.layout.mainWindows))
+        collect(mw.multiSplitterLayout);
+    for (const LayoutSaver::FloatingWindow &fw : qAsConst(previous.layout.floatingWindows))
+        collect(fw.multiSplitterLayout);
+
+    auto shareLayout = [&previousItems, &previousLayoutsByFrame] (LayoutSaver::MultiSplitterLayout &layout) {
+        const LayoutSaver::MultiSplitterLayout *previousLayout = layout.frames.isEmpty() ? nullptr
+                                                                 : previousLayoutsByFrame.value(layout.frames.cbegin().key());
+        if (!previousLayout) {
+            shareItems(layout.layout, previousItems);
+            return;
+        }
+
+        // Windows whose serialization was reused are already shared, this is cheap for them
+        if (layout.layout == previousLayout->layout)
+            layout.layout = previousLayout->layout;
+        else
+            shareItems(layout.layout, previousItems);
+
+        shareEntries(layout.frames, previousLayout->frames, sameFrame);
+    };
+
+    for (LayoutSaver::MainWindow &mw : current.layout.mainWindows)
+        shareLayout(mw.multiSplitterLayout);
+    for (LayoutSaver::FloatingWindow &fw : current.layout.floatingWindows)
+        shareLayout(fw.multiSplitterLayout);
+
+    shareEntries(current.lastPositions, previous.lastPositions, samePosition);
+}
+
+LayoutSaver::FloatingWindow LayoutSaver::Private::scaled(const LayoutSaver::FloatingWindow &fw) const
+{
+    const LayoutSaver::ScalingInfo scalingInfo = m_scalingInfos.value(fw.parentIndex);
+    if (!scalingInfo.isValid())
+        return fw;
+
+    // Cheap, the layout and frames are implicitly shared
+    LayoutSaver::FloatingWindow result = fw;
+    result.scaleSizes(scalingInfo);
+    return result;
+}
+
+LayoutSaver::Position LayoutSaver::Private::scaled(const LayoutSaver::Position &position) const
+{
+    // TODO: Determine the best main window. This only interesting for closed dock widget geometry
+    // which was previously floating. But they still have some other main window as parent.
+    const LayoutSaver::ScalingInfo scalingInfo = m_scalingInfos.value(0);
+    if (!scalingInfo.isValid())
+        return position;
+
+    LayoutSaver::Position result = position;
+    result.scaleSizes(scalingInfo);
+    return result;
+}
+
+///@brief The part of a RestoreOption_Progressive restore left for later
+struct LayoutSaver::Private::ProgressiveRestore
+{
+    explicit ProgressiveRestore(const Private *d)
+        : options(d->m_restoreOptions)
+        , affinityNames(d->m_affinityNames)
+        , affinityNameSet(d->m_affinityNameSet)
+        , finishedCallback(d->m_restoreFinishedCallback)
+        , scalingInfos(d->m_scalingInfos)
+    {
+    }
+
+    struct PendingFloatingWindow
+    {
+        int savedIndex;
+        LayoutSaver::FloatingWindow floatingWindow;
+        QPointer<MainWindowBase> parent;
+    };
+
+    ///@brief Restores the next pending parts, in order, until @p budgetUsecs are spent, or all of
+    ///them with -1. Returns whether there's nothing left.
+    bool restoreChunk(qint64 budgetUsecs);
+
+    const RestoreOptions options;
+    const QStringList affinityNames;
+    const QSet<QString> affinityNameSet;
+    const std::function<void()> finishedCallback;
+    const QVector<LayoutSaver::ScalingInfo> scalingInfos;
+    QVector<PendingFloatingWindow> floatingWindows; // Already scaled
+    // Copies, as parsing or saving other layouts overwrites the shared DockWidget entries
+    QVector<LayoutSaver::DockWidget::Ptr> closedDockWidgets;
+    QVector<QPair<QString, LayoutSaver::Position>> positions;
+    QVector<QPointer<KDDockWidgets::FloatingWindow>> restoredFloatingWindows; // By saved index
+    int nextFloatingWindow = 0;
+    int nextClosedDockWidget = 0;
+    int nextPosition = 0;
+};
+
+// Under a display refresh, so the event loop still runs smoothly in between
+static const qint64 s_progressiveRestoreChunkUsecs = 8000;
+LayoutSaver::Private::ProgressiveRestore *LayoutSaver::Private::s_progressiveRestore = nullptr;
+quint64 LayoutSaver::Private::s_progressiveRestoreSerial = 0;
+
+bool LayoutSaver::Private::restore(const LayoutSaver::Layout &layout)
+{
+    KDDW_TRACE_SCOPE("restore", "LayoutSaver::restore");
+    RAIIIsRestoring isRestoring;
+    DeferredShows deferredShows(this);
+    TitleBarVisibilityBatch titleBarBatch; // Before the windows are shown
+
+    struct FrameCleanup {
+        FrameCleanup(LayoutSaver::Private *d)
+            : m_d(d)
+        {
+        }
+
+        ~FrameCleanup()
+        {
+            m_d->deleteEmptyFrames();
+        }
+
+        LayoutSaver::Private *const m_d;
+    };
+
+    FrameCleanup cleanup(this);
+
+    struct RestoreTimer {
+        RestoreTimer()
+        {
+            m_timer.start();
+        }
+
+        ~RestoreTimer()
+        {
+            PerformanceCounters &counters = DockRegistry::self()->performanceCounters();
+            counters.restores++;
+            counters.lastRestoreUsecs = m_timer.nsecsElapsed() / 1000;
+            counters.totalRestoreUsecs += counters.lastRestoreUsecs;
+        }
+
+        QElapsedTimer m_timer;
+    };
+
+    RestoreTimer restoreTimer;
+
+    if (!m_trustedLayout && !layout.isValid()) {
+        return false;
+    }
+
+    // The windows and positions are scaled as they're restored, so the layout is only walked once
+    m_scalingInfos.clear();
+    if (m_restoreOptions & RestoreOption_RelativeToMainWindow) {
+        m_scalingInfos.reserve(layout.mainWindows.size());
+        for (const LayoutSaver::MainWindow &mw : qAsConst(layout.mainWindows))
+            m_scalingInfos.push_back(LayoutSaver::ScalingInfo(mw.uniqueName, mw.geometry));
+    }
+
+    // Whatever it had left is about to be replaced
+    cancelProgressiveRestore();
+
+    if ((m_preferInPlace || (m_restoreOptions & RestoreOption_InPlace)) && canRestoreInPlace(layout)) {
+        restoreInPlace(layout);
+        if (m_restoreFinishedCallback)
+            m_restoreFinishedCallback();
+        return true;
+    }
+
+    std::unique_ptr<ProgressiveRestore> progressive;
+    if (m_restoreOptions & RestoreOption_Progressive)
+        progressive.reset(new ProgressiveRestore(this));
+
+    // Hide all dockwidgets and unparent them from any layout before starting restore
+    m_dockRegistry->clear(m_affinityNames);
+    // The other affinities keep theirs
+    for (int i = s_deferredFloatingWindows.size() - 1; i >= 0; --i) {
+        if (matchesAffinity(s_deferredFloatingWindows.at(i).floatingWindow.affinityName))
+            s_deferredFloatingWindows.removeAt(i);
+    }
+
+    // 1. Restore main windows
+    for (const LayoutSaver::MainWindow &mw : qAsConst(layout.mainWindows)) {
+        KDDW_TRACE_SCOPE("restore", "LayoutSaver::restoreMainWindow");
+        MainWindowBase *mainWindow = m_dockRegistry->mainWindowByName(mw.uniqueName);
+        if (!mainWindow ) {
+            if (auto mwFunc = Config::self().mainWindowFactoryFunc()) {
+                mainWindow = mwFunc(mw.uniqueName);
+            } else {
+                qWarning() << "Failed to restore layout create MainWindow with name" << mw.uniqueName << "first";
+                return false;
+            }
+        }
+
+        if (!matchesAffinity(mainWindow->affinityName()))
+            continue;
+
+        if (!(m_restoreOptions & RestoreOption_RelativeToMainWindow))
+            deserializeWindowGeometry(mw, mainWindow->window()); // window(), as the MainWindow can be embedded
+
+        if (!mainWindow->deserialize(mw))
+            return false;
+    }
+
+    // 2. Restore FloatingWindows
+    // Placeholders reference floating windows by their saved index, which deferring windows shifts
+    QVector<QPointer<KDDockWidgets::FloatingWindow>> restoredFloatingWindows;
+    restoredFloatingWindows.reserve(layout.floatingWindows.size());
+    for (const LayoutSaver::FloatingWindow &savedFw : qAsConst(layout.floatingWindows)) {
+        KDDW_TRACE_SCOPE("restore", "LayoutSaver::restoreFloatingWindow");
+        restoredFloatingWindows.push_back(nullptr);
+        if (!matchesAffinity(savedFw.affinityName))
+            continue;
+
+        const LayoutSaver::FloatingWindow fw = scaled(savedFw);
+
+        MainWindowBase *parent = fw.parentIndex == -1 ? nullptr
+                                                      : DockRegistry::self()->mainwindows().at(fw.parentIndex);
+
+        if ((m_restoreOptions & RestoreOption_DeferOffscreenFloatingWindows) && !isOnConnectedScreen(fw.geometry)) {
+            deferFloatingWindow(fw, parent);
+            continue;
+        }
+
+        QScreen *primaryScreen = qApp->primaryScreen();
+        if (progressive && primaryScreen && !primaryScreen->geometry().intersects(fw.geometry)) {
+            progressive->floatingWindows.push_back({ restoredFloatingWindows.size() - 1, fw, parent });
+            continue;
+        }
+
+        auto floatingWindow = FloatingWindowPool::self()->floatingWindow(parent);
+        deserializeWindowGeometry(fw, floatingWindow);
+        if (!floatingWindow->deserialize(fw)) {
+            qWarning() << Q_FUNC_INFO << "Failed to deserialize floating window";
+            return false;
+        }
+
+        setWindowVisible(floatingWindow, true); // Restored floating windows are always shown
+        restoredFloatingWindows.last() = floatingWindow;
+    }
+
+    if (progressive) {
+        // The rest needs the floating windows that are restored later
+        for (const auto &dw : qAsConst(layout.closedDockWidgets)) {
+            if (matchesAffinity(dw->affinityName))
+                progressive->closedDockWidgets.push_back(LayoutSaver::DockWidget::Ptr(new LayoutSaver::DockWidget(*dw)));
+        }
+
+        for (const auto &dw : qAsConst(layout.allDockWidgets)) {
+            if (matchesAffinity(dw->affinityName))
+                progressive->positions.push_back({ dw->uniqueName, dw->lastPosition });
+        }
+
+        progressive->restoredFloatingWindows = restoredFloatingWindows;
+        s_progressiveRestore = progressive.release();
+        s_progressiveRestoreSerial++;
+        scheduleProgressiveRestoreChunk();
+        return true;
+    }
+
+    // 3. Restore closed dock widgets. They remain closed but acquire geometry and placeholder properties
+    for (const auto &dw : qAsConst(layout.closedDockWidgets)) {
+        if (matchesAffinity(dw->affinityName)) {
+            DockWidgetBase::deserialize(dw);
+        }
+    }
+
+    // 4. Restore the placeholder info, now that the Items have been created
+    const bool remap = !s_deferredFloatingWindows.isEmpty();
+    for (const auto &dw : qAsConst(layout.allDockWidgets)) {
+        if (!matchesAffinity(dw->affinityName))
+            continue;
+
+        if (DockWidgetBase *dockWidget = m_dockRegistry->dockByName(dw->uniqueName)) {
+            restorePosition(dockWidget, dw->lastPosition, remap, restoredFloatingWindows);
+        } else {
+            qWarning() << Q_FUNC_INFO << "Couldn't find dock widget" << dw->uniqueName;
+        }
+    }
+
+    if (m_restoreFinishedCallback)
+        m_restoreFinishedCallback();
+
+    return true;
+}
+
+void LayoutSaver::Private::restorePosition(DockWidgetBase *dockWidget, LayoutSaver::Position position, bool remap,
+                                           const QVector<QPointer<KDDockWidgets::FloatingWindow>> &restoredFloatingWindows) const
+{
+    position = scaled(position);
+    if (remap) {
+        // Placeholders in windows that weren't restored are dropped, the others are remapped
+        for (LayoutSaver::Placeholder &placeholder : position.placeholders) {
+            if (placeholder.isFloatingWindow && placeholder.indexOfFloatingWindow != -1) {
+                KDDockWidgets::FloatingWindow *fw = restoredFloatingWindows.value(placeholder.indexOfFloatingWindow);
+                placeholder.indexOfFloatingWindow = fw ? m_dockRegistry->indexOfNestedWindow(fw) : -1;
+            }
+        }
+    }
+
+    dockWidget->lastPositions().deserialize(position);
+}
+
+bool LayoutSaver::Private::ProgressiveRestore::restoreChunk(qint64 budgetUsecs)
+{
+    KDDW_TRACE_SCOPE("restore", "LayoutSaver::restoreChunk");
+    QElapsedTimer timer;
+    timer.start();
+    auto budgetSpent = [&timer, budgetUsecs] {
+        return budgetUsecs != -1 && timer.nsecsElapsed() / 1000 >= budgetUsecs;
+    };
+
+    RAIIIsRestoring isRestoring;
+    Private d(options);
+    d.m_affinityNames = affinityNames;
+    d.m_affinityNameSet = affinityNameSet;
+    d.m_scalingInfos = scalingInfos;
+    DeferredShows deferredShows(&d);
+    TitleBarVisibilityBatch titleBarBatch; // Before the windows are shown
+
+    // In the same order as a regular restore, the placeholders reference the floating windows
+    while (nextFloatingWindow < floatingWindows.size()) {
+        const PendingFloatingWindow &pending = floatingWindows.at(nextFloatingWindow++);
+        auto floatingWindow = FloatingWindowPool::self()->floatingWindow(pending.parent);
+        d.deserializeWindowGeometry(pending.floatingWindow, floatingWindow);
+        if (floatingWindow->deserialize(pending.floatingWindow)) {
+            d.setWindowVisible(floatingWindow, true);
+            restoredFloatingWindows[pending.savedIndex] = floatingWindow;
+        } else {
+            qWarning() << Q_FUNC_INFO << "Failed to deserialize floating window";
+        }
+
+        if (budgetSpent())
+            return false;
+    }
+
+    while (nextClosedDockWidget < closedDockWidgets.size()) {
+        DockWidgetBase::deserialize(closedDockWidgets.at(nextClosedDockWidget++));
+        if (budgetSpent())
+            return false;
+    }
+
+    while (nextPosition < positions.size()) {
+        const QPair<QString, LayoutSaver::Position> &position = positions.at(nextPosition++);
+        if (DockWidgetBase *dockWidget = d.m_dockRegistry->dockByName(position.first)) {
+            d.restorePosition(dockWidget, position.second, /*remap=*/ true, restoredFloatingWindows);
+        } else {
+            qWarning() << Q_FUNC_INFO << "Couldn't find dock widget" << position.first;
+        }
+
+        if (budgetSpent())
+            return false;
+    }
+
+    d.deleteEmptyFrames();
+    return true;
+}
+
+void LayoutSaver::Private::scheduleProgressiveRestoreChunk()
+{
+    const quint64 serial = s_progressiveRestoreSerial;
+    QTimer::singleShot(0, qApp, [serial] {
+        if (!s_progressiveRestore || serial != s_progressiveRestoreSerial)
+            return;
+
+        if (s_progressiveRestore->restoreChunk(s_progressiveRestoreChunkUsecs))
+            completeProgressiveRestore();
+        else
+            scheduleProgressiveRestoreChunk();
+    });
+}
+
+void LayoutSaver::Private::completeProgressiveRestore()
+{
+    std::unique_ptr<ProgressiveRestore> restore(s_progressiveRestore);
+    s_progressiveRestore = nullptr;
+    if (restore->finishedCallback)
+        restore->finishedCallback();
+}
+
+void LayoutSaver::Private::cancelProgressiveRestore()
+{
+    delete s_progressiveRestore;
+    s_progressiveRestore = nullptr;
+}
+
+void LayoutSaver::setRestoreFinishedCallback(const std::function<void()> &callback)
+{
+    d->m_restoreFinishedCallback = callback;
+}
+
+bool LayoutSaver::progressiveRestoreInProgress()
+{
+    return Private::s_progressiveRestore != nullptr;
+}
+
+void LayoutSaver::finishProgressiveRestore()
+{
+    // Not while a chunk is being restored, saving from within it would re-enter
+    if (!Private::s_progressiveRestore || Private::s_restoreInProgress)
+        return;
+
+    Private::s_progressiveRestore->restoreChunk(-1);
+    Private::completeProgressiveRestore();
+}
+
+bool LayoutSaver::Private::isOnConnectedScreen(QRect geometry)
+{
+    const QList<QScreen*> screens = qApp->screens();
+    for (QScreen *screen : screens) {
+        if (screen->geometry().intersects(geometry))
+            return true;
+    }
+
+    return false;
+}
+
+void LayoutSaver::Private::deferFloatingWindow(const LayoutSaver::FloatingWindow &fw, MainWindowBase *parent)
+{
+    qCDebug(restoring) << Q_FUNC_INFO << "Deferring floating window at" << fw.geometry;
+
+    DeferredFloatingWindow deferred;
+    deferred.floatingWindow = fw;
+    deferred.parent = parent;
+    deferred.options = m_restoreOptions;
+    for (const LayoutSaver::Frame &frame : fw.multiSplitterLayout.frames)
+        deferred.dockWidgets += dockWidgetNameList(frame.dockWidgets);
+
+    s_deferredFloatingWindows.push_back(deferred);
+
+    static bool connected = false;
+    if (!connected) {
+        connected = true;
+        QObject::connect(qApp, &QGuiApplication::screenAdded, [] {
+            for (int i = s_deferredFloatingWindows.size() - 1; i >= 0; --i) {
+                if (isOnConnectedScreen(s_deferredFloatingWindows.at(i).floatingWindow.geometry))
+                    restoreDeferredFloatingWindow(i);
+            }
+        });
+    }
+}
+
+bool LayoutSaver::Private::restoreDeferredFloatingWindow(int index)
+{
+    const DeferredFloatingWindow deferred = s_deferredFloatingWindows.takeAt(index);
+    DockRegistry *registry = DockRegistry::self();
+
+    // The user might have shown some of its dock widgets somewhere else meanwhile
+    for (const QString &name : deferred.dockWidgets) {
+        DockWidgetBase *dw = registry->dockByName(name);
+        if (dw && dw->isOpen()) {
+            qCDebug(restoring) << Q_FUNC_INFO << "Discarding deferred floating window, already shown" << name;
+            return false;
+        }
+    }
+
+    RAIIIsRestoring isRestoring;
+    Private d(deferred.options);
+    DeferredShows deferredShows(&d);
+    auto floatingWindow = FloatingWindowPool::self()->floatingWindow(deferred.parent);
+    d.deserializeWindowGeometry(deferred.floatingWindow, floatingWindow);
+    if (!isOnConnectedScreen(floatingWindow->geometry())) {
+        // Shown because one of its dock widgets was, so bring it where it can be seen
+        QRect geometry = floatingWindow->geometry();
+        geometry.moveCenter(qApp->primaryScreen()->availableGeometry().center());
+        floatingWindow->setGeometry(geometry);
+    }
+
+    if (!floatingWindow->deserialize(deferred.floatingWindow)) {
+        qWarning() << Q_FUNC_INFO << "Failed to deserialize floating window";
+        return false;
+    }
+
+    d.setWindowVisible(floatingWindow, true);
+    return true;
+}
+
+///@brief See LayoutSaver::setFollowScreenChanges()
+struct LayoutSaver::Private::ScreenFollower
+{
+    explicit ScreenFollower(RestoreOptions options)
+        : options(options)
+        , currentKey(screenConfigurationKey())
+    {
+        // Connected to qApp, so they go away with it too
+        connections.push_back(QObject::connect(qApp, &QGuiApplication::screenAdded, qApp, [this] (QScreen *screen) {
+            watchScreen(screen);
+            onScreensChanged();
+        }));
+        connections.push_back(QObject::connect(qApp, &QGuiApplication::screenRemoved, qApp, [this] { onScreensChanged(); }));
+
+        const QList<QScreen*> screens = qApp->screens();
+        for (QScreen *screen : screens)
+            watchScreen(screen);
+    }
+
+    ~ScreenFollower()
+    {
+        for (const QMetaObject::Connection &connection : qAsConst(connections))
+            QObject::disconnect(connection);
+    }
+
+    void watchScreen(QScreen *screen)
+    {
+        // screenConfigurationKey() changes with the resolution and the scale too.
+        // Connected to the screen, so they go away with it.
+        connections.push_back(QObject::connect(screen, &QScreen::geometryChanged, screen, [this] { onScreensChanged(); }));
+        connections.push_back(QObject::connect(screen, &QScreen::logicalDotsPerInchChanged, screen, [this] { onScreensChanged(); }));
+    }
+
+    void onScreensChanged()
+    {
+        // Windows on a removed screen haven't been moved yet, so this is still the old configuration's layout.
+        // Only the first change of a burst saves, the next ones would save what Qt moved around.
+        if (switchPending)
+            return;
+
+        if (DockRegistry::self()->isSane()) {
+            Private d(options);
+            Perspective variant;
+            d.serialize(variant);
+            s_screenVariants.insert(currentKey, variant);
+        }
+
+        switchPending = true;
+        QTimer::singleShot(0, qApp, [] {
+            if (s_screenFollower)
+                s_screenFollower->switchVariant();
+        });
+    }
+
+    void switchVariant()
+    {
+        switchPending = false;
+        const QString key = screenConfigurationKey();
+        if (key == currentKey)
+            return;
+
+        currentKey = key;
+        LayoutSaver saver(options);
+        if (s_screenVariants.contains(key))
+            saver.restoreScreenVariant();
+        else
+            saver.saveScreenVariant();
+    }
+
+    const RestoreOptions options;
+    QString currentKey;
+    bool switchPending = false;
+    QVector<QMetaObject::Connection> connections;
+};
+
+QHash<QString, LayoutSaver::Private::Perspective> LayoutSaver::Private::s_screenVariants;
+LayoutSaver::Private::ScreenFollower *LayoutSaver::Private::s_screenFollower = nullptr;
+
+#if defined(DOCKS_DEVELOPER_MODE)
+static QString s_dbgScreenConfigurationKey;
+
+void LayoutSaver::dbg_setScreenConfigurationKey(const QString &key)
+{
+    s_dbgScreenConfigurationKey = key;
+    if (Private::s_screenFollower)
+        Private::s_screenFollower->onScreensChanged();
+}
+#endif
+
+QString LayoutSaver::screenConfigurationKey()
+{
+#if defined(DOCKS_DEVELOPER_MODE)
+    if (!s_dbgScreenConfigurationKey.isEmpty())
+        return s_dbgScreenConfigurationKey;
+#endif
+
+    QList<QScreen*> screens = qApp->screens();
+    std::stable_sort(screens.begin(), screens.end(), [] (QScreen *s1, QScreen *s2) {
+        if (s1->name() != s2->name())
+            return s1->name() < s2->name();
+        const QRect g1 = s1->geometry();
+        const QRect g2 = s2->geometry();
+        return g1.x() != g2.x() ? g1.x() < g2.x() : g1.y() < g2.y();
+    });
+
+    QStringList parts;
+    parts.reserve(screens.size());
+    for (QScreen *screen : qAsConst(screens)) {
+        const QRect g = screen->geometry();
+        parts << QStringLiteral("%1:%2,%3,%4x%5@%6").arg(screen->name()).arg(g.x()).arg(g.y())
+                 .arg(g.width()).arg(g.height()).arg(screen->devicePixelRatio());
+    }
+
+    return QString::fromLatin1(QCryptographicHash::hash(parts.join(QLatin1Char(';')).toUtf8(),
+                                                        QCryptographicHash::Sha1).toHex().left(16));
+}
+
+bool LayoutSaver::saveScreenVariant()
+{
+    if (!d->m_dockRegistry->isSane()) {
+        qWarning() << Q_FUNC_INFO << "Refusing to save this layout. Check previous warnings.";
+        return false;
+    }
+
+    Private::Perspective variant;
+    d->serialize(variant);
+    Private::s_screenVariants.insert(screenConfigurationKey(), variant);
+    return true;
+}
+
+bool LayoutSaver::restoreScreenVariant()
+{
+    Private::startRestoreGeneration();
+    auto it = Private::s_screenVariants.constFind(screenConfigurationKey());
+    if (it == Private::s_screenVariants.cend())
+        return false;
+
+    // Usually only the windows' geometries differ between screen configurations
+    QScopedValueRollback<bool> preferInPlace(d->m_preferInPlace, true);
+    return d->restore(*it);
+}
+
+void LayoutSaver::clearScreenVariants()
+{
+    Private::s_screenVariants.clear();
+}
+
+void LayoutSaver::setFollowScreenChanges(bool enabled, RestoreOptions options)
+{
+    delete Private::s_screenFollower;
+    Private::s_screenFollower = enabled ? new Private::ScreenFollower(options) : nullptr;
+}
+
+int LayoutSaver::numDeferredFloatingWindows()
+{
+    return Private::s_deferredFloatingWindows.size();
+}
+
+bool LayoutSaver::restoreDeferredFloatingWindowFor(const DockWidgetBase *dw)
+{
+    for (int i = 0; i < Private::s_deferredFloatingWindows.size(); ++i) {
+        if (Private::s_deferredFloatingWindows.at(i).dockWidgets.contains(dw->uniqueName()))
+            return Private::restoreDeferredFloatingWindow(i);
+    }
+
+    return false;
+}
+
+bool LayoutSaver::Private::canRestoreInPlace(const LayoutSaver::Layout &layout) const
+{
+    // A full restore clears what the layout doesn't mention, restoring in place would leave it alone
+    QSet<QString> savedMainWindows;
+    for (const LayoutSaver::MainWindow &mw : qAsConst(layout.mainWindows))
+        savedMainWindows.insert(mw.uniqueName);
+
+    for (MainWindowBase *mainWindow : m_dockRegistry->mainwindows()) {
+        if (matchesAffinity(mainWindow->affinityName()) && !savedMainWindows.contains(mainWindow->uniqueName()))
+            return false;
+    }
+
+    QSet<QString> savedDockWidgets;
+    for (const auto &dw : qAsConst(layout.allDockWidgets))
+        savedDockWidgets.insert(dw->uniqueName);
+
+    for (DockWidgetBase *dw : m_dockRegistry->dockwidgets()) {
+        if (matchesAffinity(dw->affinityName()) && !savedDockWidgets.contains(dw->uniqueName()))
+            return false;
+    }
+
+    for (const LayoutSaver::MainWindow &mw : qAsConst(layout.mainWindows)) {
+        MainWindowBase *mainWindow = m_dockRegistry->mainWindowByName(mw.uniqueName);
+        if (!mainWindow)
+            return false;
+
+        if (!matchesAffinity(mainWindow->affinityName()))
+            continue;
+
+        if (mainWindow->options() != mw.options || mainWindow->affinityName() != mw.affinityName ||
+            !mainWindow->multiSplitterLayout()->hasSameStructure(mw.multiSplitterLayout))
+            return false;
+    }
+
+    // Floating windows are saved in registry order, so compare them pairwise
+    QVector<KDDockWidgets::FloatingWindow*> floatingWindows;
+    for (KDDockWidgets::FloatingWindow *fw : m_dockRegistry->nestedwindows()) {
+        if (matchesAffinity(fw->affinityName()))
+            floatingWindows.push_back(fw);
+    }
+
+    int i = 0;
+    for (const LayoutSaver::FloatingWindow &fw : qAsConst(layout.floatingWindows)) {
+        if (!matchesAffinity(fw.affinityName))
+            continue;
+
+        if (i >= floatingWindows.size())
+            return false;
+
+        KDDockWidgets::FloatingWindow *floatingWindow = floatingWindows.at(i++);
+        MainWindowBase *parent = fw.parentIndex == -1 ? nullptr
+                                                      : m_dockRegistry->mainwindows().value(fw.parentIndex);
+        if (qobject_cast<MainWindowBase*>(floatingWindow->parentWidget()) != parent ||
+            !floatingWindow->dropArea()->multiSplitterLayout()->hasSameStructure(fw.multiSplitterLayout))
+            return false;
+    }
+
+    if (i != floatingWindows.size())
+        return false;
+
+    // Every other dock widget is in one of the frames compared above
+    QStringList closedNames;
+    for (DockWidgetBase *dw : m_dockRegistry->closedDockwidgets()) {
+        if (matchesAffinity(dw->affinityName()))
+            closedNames.push_back(dw->uniqueName());
+    }
+
+    QStringList savedClosedNames;
+    for (const auto &dw : qAsConst(layout.closedDockWidgets)) {
+        if (matchesAffinity(dw->affinityName))
+            savedClosedNames.push_back(dw->uniqueName);
+    }
+
+    closedNames.sort();
+    savedClosedNames.sort();
+    return closedNames == savedClosedNames;
+}
+
+void LayoutSaver::Private::restoreInPlace(const LayoutSaver::Layout &layout)
+{
+    qCDebug(restoring) << Q_FUNC_INFO;
+
+    for (const LayoutSaver::MainWindow &mw : qAsConst(layout.mainWindows)) {
+        MainWindowBase *mainWindow = m_dockRegistry->mainWindowByName(mw.uniqueName);
+        if (!matchesAffinity(mainWindow->affinityName()))
+            continue;
+
+        if (!(m_restoreOptions & RestoreOption_RelativeToMainWindow))
+            deserializeWindowGeometry(mw, mainWindow->window());
+
+        mainWindow->multiSplitterLayout()->deserializeInPlace(mw.multiSplitterLayout);
+    }
+
+    int i = 0;
+    const QVector<KDDockWidgets::FloatingWindow*> floatingWindows = m_dockRegistry->nestedwindows();
+    for (const LayoutSaver::FloatingWindow &fw : qAsConst(layout.floatingWindows)) {
+        if (!matchesAffinity(fw.affinityName))
+            continue;
+
+        while (!matchesAffinity(floatingWindows.at(i)->affinityName()))
+            ++i;
+
+        KDDockWidgets::FloatingWindow *floatingWindow = floatingWindows.at(i++);
+        deserializeWindowGeometry(scaled(fw), floatingWindow);
+        floatingWindow->dropArea()->multiSplitterLayout()->deserializeInPlace(fw.multiSplitterLayout);
+    }
+
+    for (const auto &dw : qAsConst(layout.allDockWidgets)) {
+        if (!matchesAffinity(dw->affinityName))
+            continue;
+
+        if (DockWidgetBase *dockWidget = m_dockRegistry->dockByName(dw->uniqueName)) {
+            markRestored(dockWidget);
+            dockWidget->lastPositions().deserialize(scaled(dw->lastPosition));
+        }
+    }
+}
+
+void LayoutSaver::setAffinityNames(const QStringList &affinityNames)
+{
+    d->m_affinityNames = affinityNames;
+    if (affinityNames.contains(QString())) {
+        // Any window with empty affinity will also be subject to save/restore
+        d->m_affinityNames << QString();
+    }
+
+    d->m_affinityNames.removeDuplicates(); // So matchingDockWidgets() visits each partition once
+    d->m_affinityNameSet.clear();
+    for (const QString &affinityName : qAsConst(d->m_affinityNames))
+        d->m_affinityNameSet.insert(affinityName);
+}
+
+DockWidgetBase::List LayoutSaver::restoredDockWidgets() const
+{
+    DockWidgetBase::List result;
+    result.reserve(Private::s_restoredDockWidgets.size());
+    for (const QPointer<DockWidgetBase> &dw : qAsConst(Private::s_restoredDockWidgets)) {
+        if (dw) // Might have been deleted since
+            result.push_back(dw);
+    }
+
+    return result;
+}
+
+void LayoutSaver::markRestored(DockWidgetBase *dw)
+{
+    if (dw->setRestoredBy(Private::s_restoreGeneration))
+        Private::s_restoredDockWidgets.push_back(dw);
+}
+
+void LayoutSaver::Private::startRestoreGeneration()
+{
+    s_restoreGeneration++;
+    s_restoredDockWidgets.clear();
+}
+
+template <typename T>
+void LayoutSaver::Private::deserializeWindowGeometry(const T &saved, QWidgetOrQuick *topLevel)
+{
+    topLevel->setGeometry(saved.geometry);
+    setWindowVisible(topLevel, saved.isVisible);
+}
+
+void LayoutSaver::Private::setWindowVisible(QWidgetOrQuick *topLevel, bool visible)
+{
+    if (!m_deferredShows) {
+        topLevel->setVisible(visible);
+        return;
+    }
+
+    for (auto &window : m_deferredShows->m_windows) {
+        if (window.topLevel == topLevel) {
+            window.visible = visible;
+            return;
+        }
+    }
+
+    bool updatesEnabled = true;
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    // Already visible windows, like main windows, aren't hidden. They just don't repaint until the end.
+    updatesEnabled = topLevel->updatesEnabled();
+    topLevel->setUpdatesEnabled(false);
+#endif
+    m_deferredShows->m_windows.push_back({ topLevel, visible, updatesEnabled });
+}
+
+void LayoutSaver::Private::deleteEmptyFrames()
+{
+    // After a restore it can happen that some DockWidgets didn't exist, so weren't restored.
+    // Delete their frame now, together with the ones emptied while restoring.
+
+    for (auto frame : m_dockRegistry->frames()) {
+        if (frame->isEmpty() && !frame->isCentralFrame())
+            delete frame;
+    }
+
+    m_dockRegistry->deleteScheduled();
+}
+
+std::unique_ptr<QSettings> LayoutSaver::Private::settings() const
+{
+    auto settings = std::unique_ptr<QSettings>(new QSettings(qApp->organizationName(),
+                                                             qApp->applicationName()));
+    settings->beginGroup(QStringLiteral("KDDockWidgets::LayoutSaver"));
+
+    return settings;
+}
+
+bool LayoutSaver::restoreInProgress()
+{
+    return Private::s_restoreInProgress;
+}
+
+bool LayoutSaver::Layout::isValid() const
+{
+    if (serializationVersion < KDDOCKWIDGETS_MIN_SERIALIZATION_VERSION ||
+        serializationVersion > KDDOCKWIDGETS_SERIALIZATION_VERSION) {
+        qWarning() << Q_FUNC_INFO << "Unsupported serialization format"
+                   << serializationVersion << "current=" << KDDOCKWIDGETS_SERIALIZATION_VERSION;
+        return false;
+    }
+
+    for (auto &m : mainWindows) {
+        if (!m.isValid())
+            return false;
+    }
+
+    for (auto &m : floatingWindows) {
+        if (!m.isValid())
+            return false;
+    }
+
+    for (auto &m : allDockWidgets) {
+        if (!m->isValid())
+            return false;
+    }
+
+    return true;
+}
+
+QByteArray LayoutSaver::Layout::toJson() const
+{
+    QJsonDocument doc = QJsonDocument::fromVariant(normalizedMap(toVariantMap()));
+    return doc.toJson();
+}
+
+bool LayoutSaver::Layout::fromJson(const QByteArray &jsonData)
+{
+    KDDW_TRACE_SCOPE("restore", "LayoutSaver::Layout::fromJson");
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(jsonData, &error);
+    if (error.error == QJsonParseError::NoError)  {
+        fromVariantMap(denormalizedMap(doc.toVariant().toMap()));
+        return true;
+    }
+
+    return false;
+}
+
+namespace {
+
+const QString s_stringsKey = QStringLiteral("strings");
+
+///@brief Returns whether the values of @p key are names, or lists of names, which the
+///normalized JSON format interns. Each shows up once per dock widget, frame or placeholder.
+bool isInternedKey(const QString &key)
+{
+    return key == QLatin1String("uniqueName") || key == QLatin1String("mainWindowUniqueName") ||
+           key == QLatin1String("affinityName") || key == QLatin1String("objectName") ||
+           key == QLatin1String("dockWidgets") || key == QLatin1String("closedDockWidgets");
+}
+
+struct StringInterner
+{
+    int indexOf(const QString &string)
+    {
+        auto it = indexes.constFind(string);
+        if (it == indexes.cend()) {
+            it = indexes.insert(string, strings.size());
+            strings.push_back(string);
+        }
+
+        return *it;
+    }
+
+    QVariantList strings;
+    QHash<QString, int> indexes;
+};
+
+QVariant normalized(const QString &key, const QVariant &value, StringInterner &interner)
+{
+    if (key == QLatin1String("sizingInfo")) {
+        // The same keys for every item otherwise
+        Layouting::SizingInfo sizing;
+        sizing.fromVariantMap(value.toMap());
+        QVariantList packed = { sizing.geometry.x(), sizing.geometry.y(), sizing.geometry.width(), sizing.geometry.height(),
+                                sizing.minSize.width(), sizing.minSize.height(), sizing.maxSize.width(), sizing.maxSize.height() };
+        if (sizing.isFixedOnParentResize)
+            packed.push_back(1);
+        return packed;
+    }
+
+    if (isInternedKey(key)) {
+        if (value.type() == QVariant::String)
+            return interner.indexOf(value.toString());
+
+        QVariantList indexes;
+        const QVariantList names = value.toList();
+        indexes.reserve(names.size());
+        for (const QVariant &name : names)
+            indexes.push_back(interner.indexOf(name.toString()));
+        return indexes;
+    }
+
+    if (value.type() == QVariant::Map) {
+        QVariantMap map = value.toMap();
+        for (auto it = map.begin(); it != map.end(); ++it)
+            *it = normalized(it.key(), *it, interner);
+        return map;
+    }
+
+    if (value.type() == QVariant::List) {
+        QVariantList list = value.toList();
+        for (QVariant &v : list)
+            v = normalized(key, v, interner);
+        return list;
+    }
+
+    return value;
+}
+
+QVariant denormalized(const QString &key, const QVariant &value, const QStringList &strings)
+{
+    auto stringAt = [&strings] (const QVariant &index) {
+        return strings.value(index.toInt());
+    };
+
+    if (key == QLatin1String("sizingInfo")) {
+        const QVariantList packed = value.toList();
+        if (packed.size() < 8)
+            return QVariantMap();
+
+        Layouting::SizingInfo sizing;
+        sizing.geometry = QRect(packed.at(0).toInt(), packed.at(1).toInt(), packed.at(2).toInt(), packed.at(3).toInt());
+        sizing.minSize = QSize(packed.at(4).toInt(), packed.at(5).toInt());
+        sizing.maxSize = QSize(packed.at(6).toInt(), packed.at(7).toInt());
+        sizing.isFixedOnParentResize = packed.size() > 8 && packed.at(8).toBool();
+        return sizing.toVariantMap();
+    }
+
+    if (isInternedKey(key)) {
+        if (value.type() != QVariant::List)
+            return stringAt(value);
+
+        QVariantList names;
+        const QVariantList indexes = value.toList();
+        names.reserve(indexes.size());
+        for (const QVariant &index : indexes)
+            names.push_back(stringAt(index));
+        return names;
+    }
+
+    if (value.type() == QVariant::Map) {
+        QVariantMap map = value.toMap();
+        for (auto it = map.begin(); it != map.end(); ++it)
+            *it = denormalized(it.key(), *it, strings);
+        return map;
+    }
+
+    if (value.type() == QVariant::List) {
+        QVariantList list = value.toList();
+        for (QVariant &v : list)
+            v = denormalized(key, v, strings);
+        return list;
+    }
+
+    return value;
+}
+
+}
+
+QVariantMap LayoutSaver::Layout::normalizedMap(const QVariantMap &map)
+{
+    StringInterner interner;
+    QVariantMap result = normalized(QString(), map, interner).toMap();
+    result.insert(s_stringsKey, interner.strings);
+    return result;
+}
+
+QVariantMap LayoutSaver::Layout::denormalizedMap(const QVariantMap &map)
+{
+    auto it = map.constFind(s_stringsKey);
+    if (it == map.cend())
+        return map;
+
+    const QStringList strings = it->toStringList();
+    QVariantMap result = map;
+    result.remove(s_stringsKey);
+    return denormalized(QString(), result, strings).toMap();
+}
+
+bool LayoutSaver::Layout::isJournal(const QByteArray &data)
+{
+    return data.startsWith(s_journalMagic);
+}
+
+bool LayoutSaver::Layout::replayJournal(const QByteArray &data, QVariantMap &map)
+{
+    QList<QByteArray> lines = data.split('\n');
+    while (!lines.isEmpty() && lines.last().isEmpty())
+        lines.removeLast();
+
+    if (lines.size() < 2)
+        return false;
+
+    QJsonParseError error;
+    const QJsonDocument snapshot = QJsonDocument::fromJson(lines.at(1), &error);
+    if (error.error != QJsonParseError::NoError || !snapshot.isObject())
+        return false;
+
+    map = snapshot.toVariant().toMap();
+    for (int i = 2; i < lines.size(); ++i) {
+        const QJsonDocument record = QJsonDocument::fromJson(lines.at(i), &error);
+        if (error.error != QJsonParseError::NoError || !record.isObject()) {
+            // Only the last one can be incomplete, from a crash while it was being written
+            if (i != lines.size() - 1)
+                qWarning() << Q_FUNC_INFO << "Ignoring corrupt journal record" << i;
+            break;
+        }
+
+        applyJournalRecord(map, record.toVariant().toMap());
+    }
+
+    return true;
+}
+
+// Binary layouts start with this, so they can't be mistaken for JSON
+static const char s_binaryMagic[] = "KDDW";
+static const QDataStream::Version s_binaryStreamVersion = QDataStream::Qt_5_9;
+// Version 3 stores each string once, in a table after the header, and refers to it by index elsewhere.
+// Version 2 streamed the strings, and the item trees, as they are.
+static const quint32 s_binaryFormatVersion = 3;
+static const quint32 s_oldestBinaryFormatVersion = 2;
+
+namespace {
+
+///@brief The string table of the binary layout being written or read, on this thread.
+///None while reading version 2.
+struct BinaryStrings
+{
+    QStringList strings;
+    QHash<QString, quint32> indexes; // While writing
+    QVector<LayoutSaver::DockWidget::Ptr> dockWidgets; // While reading, each name is only resolved once
+
+    struct Scope
+    {
+        explicit Scope(BinaryStrings *strings);
+        ~Scope();
+        BinaryStrings *const m_previous;
+        Q_DISABLE_COPY(Scope)
+    };
+};
+
+// windowsFromBinary() runs off the GUI thread too
+static thread_local BinaryStrings *s_binaryStrings = nullptr;
+
+BinaryStrings::Scope::Scope(BinaryStrings *strings)
+    : m_previous(s_binaryStrings)
+{
+    s_binaryStrings = strings;
+}
+
+BinaryStrings::Scope::~Scope()
+{
+    s_binaryStrings = m_previous;
+}
+
+///@brief While alive, readDockWidget() returns unshared instances instead of going through
+///LayoutSaver::DockWidget::s_dockWidgets, which only the GUI thread may touch
+struct DetachedDockWidgetsScope
+{
+    DetachedDockWidgetsScope();
+    ~DetachedDockWidgetsScope();
+    const bool m_previous;
+    Q_DISABLE_COPY(DetachedDockWidgetsScope)
+};
+
+static thread_local bool s_detachedDockWidgets = false;
+
+DetachedDockWidgetsScope::DetachedDockWidgetsScope()
+    : m_previous(s_detachedDockWidgets)
+{
+    s_detachedDockWidgets = true;
+}
 
-    // Just a simplification. One less type of windows to handle.
-    d->m_dockRegistry->ensureAllFloatingWidgetsAreMorphed();
+DetachedDockWidgetsScope::~DetachedDockWidgetsScope()
+{
+    s_detachedDockWidgets = m_previous;
+}
 
-    const MainWindowBase::List mainWindows = d->m_dockRegistry->mainwindows();
-    layout.mainWindows.reserve(mainWindows.size());
-    for (MainWindowBase *mainWindow : mainWindows) {
-        if (d->matchesAffinity(mainWindow->affinityName()))
-            layout.mainWindows.push_back(mainWindow->serialize());
-    }
+LayoutSaver::DockWidget::Ptr resolveDockWidget(const QString &name)
+{
+    return s_detachedDockWidgets ? LayoutSaver::DockWidget::unsharedDockWidgetForName(name)
+                                 : LayoutSaver::DockWidget::dockWidgetForName(name);
+}
 
-    const QVector<KDDockWidgets::FloatingWindow*> floatingWindows = d->m_dockRegistry->nestedwindows();
-    layout.floatingWindows.reserve(floatingWindows.size());
-    for (KDDockWidgets::FloatingWindow *floatingWindow : floatingWindows) {
-        if (d->matchesAffinity(floatingWindow->affinityName()))
-            layout.floatingWindows.push_back(floatingWindow->serialize());
+void writeString(QDataStream &stream, const QString &string)
+{
+    if (!s_binaryStrings) {
+        stream << string;
+        return;
     }
 
-    // Closed dock widgets also have interesting things to save, like geometry and placeholder info
-    const DockWidgetBase::List closedDockWidgets = d->m_dockRegistry->closedDockwidgets();
-    layout.closedDockWidgets.reserve(closedDockWidgets.size());
-    for (DockWidgetBase *dockWidget : closedDockWidgets) {
-        if (d->matchesAffinity(dockWidget->affinityName()))
-            layout.closedDockWidgets.push_back(dockWidget->serialize());
+    auto it = s_binaryStrings->indexes.constFind(string);
+    if (it == s_binaryStrings->indexes.cend()) {
+        it = s_binaryStrings->indexes.insert(string, quint32(s_binaryStrings->strings.size()));
+        s_binaryStrings->strings.push_back(string);
     }
 
-    // Save the placeholder info. We do it last, as we also restore it last, since we need all items to be created
-    // before restoring the placeholders
+    stream << *it;
+}
 
-    const DockWidgetBase::List dockWidgets = d->m_dockRegistry->dockwidgets();
-    layout.allDockWidgets.reserve(dockWidgets.size());
-    for (DockWidgetBase *dockWidget : dockWidgets) {
-        if (d->matchesAffinity(dockWidget->affinityName())) {
-            auto dw = dockWidget->serialize();
-            dw->lastPosition = dockWidget->lastPositions().serialize();
-            layout.allDockWidgets.push_back(dw);
-        }
+///@brief Returns the index of the string just read, or -1 if @p stream has no string table
+int readStringIndex(QDataStream &stream)
+{
+    if (!s_binaryStrings)
+        return -1;
+
+    quint32 index = 0;
+    stream >> index;
+    if (index >= quint32(s_binaryStrings->strings.size())) {
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return -1;
     }
 
-    return layout.toJson();
+    return int(index);
 }
 
-bool LayoutSaver::restoreLayout(const QByteArray &data)
+QString readString(QDataStream &stream)
 {
-    d->clearRestoredProperty();
-    if (data.isEmpty())
-        return true;
-
-    Private::RAIIIsRestoring isRestoring;
+    QString string;
+    if (!s_binaryStrings) {
+        stream >> string;
+    } else {
+        const int index = readStringIndex(stream);
+        if (index != -1)
+            string = s_binaryStrings->strings.at(index);
+    }
 
-    struct FrameCleanup {
-        FrameCleanup(LayoutSaver *saver)
-            : m_saver(saver)
-        {
-        }
+    return string;
+}
 
-        ~FrameCleanup()
-        {
-            m_saver->d->deleteEmptyFrames();
-        }
+// The same layout as streaming a QStringList, when there's no string table
+void writeStringList(QDataStream &stream, const QStringList &strings)
+{
+    stream << quint32(strings.size());
+    for (const QString &string : strings)
+        writeString(stream, string);
+}
 
-        LayoutSaver *const m_saver;
-    };
+LayoutSaver::DockWidget::Ptr readDockWidget(QDataStream &stream)
+{
+    if (!s_binaryStrings)
+        return resolveDockWidget(readString(stream));
 
-    FrameCleanup cleanup(this);
-    LayoutSaver::Layout layout;
-    if (!layout.fromJson(data)) {
-        qWarning() << Q_FUNC_INFO << "Failed to parse json data";
-        return false;
-    }
+    const int index = readStringIndex(stream);
+    if (index == -1)
+        return resolveDockWidget(QString());
 
-    if (!layout.isValid()) {
-        return false;
-    }
+    QVector<LayoutSaver::DockWidget::Ptr> &dockWidgets = s_binaryStrings->dockWidgets;
+    if (dockWidgets.isEmpty())
+        dockWidgets.resize(s_binaryStrings->strings.size());
 
-    if (d->m_restoreOptions & RestoreOption_RelativeToMainWindow)
-        layout.scaleSizes();
+    LayoutSaver::DockWidget::Ptr &dw = dockWidgets[index];
+    if (!dw)
+        dw = resolveDockWidget(s_binaryStrings->strings.at(index));
 
-    // Hide all dockwidgets and unparent them from any layout before starting restore
-    d->m_dockRegistry->clear(d->m_affinityNames);
+    return dw;
+}
 
-    // 1. Restore main windows
-    for (const LayoutSaver::MainWindow &mw : qAsConst(layout.mainWindows)) {
-        MainWindowBase *mainWindow = d->m_dockRegistry->mainWindowByName(mw.uniqueName);
-        if (!mainWindow ) {
-            if (auto mwFunc = Config::self().mainWindowFactoryFunc()) {
-                mainWindow = mwFunc(mw.uniqueName);
-            } else {
-                qWarning() << "Failed to restore layout create MainWindow with name" << mw.uniqueName << "first";
-                return false;
-            }
-        }
+LayoutSaver::DockWidget::List readDockWidgets(QDataStream &stream)
+{
+    quint32 count = 0;
+    stream >> count;
 
-        if (!d->matchesAffinity(mainWindow->affinityName()))
-            continue;
+    LayoutSaver::DockWidget::List result;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+        result.push_back(readDockWidget(stream));
 
-        if (!(d->m_restoreOptions & RestoreOption_RelativeToMainWindow))
-            d->deserializeWindowGeometry(mw, mainWindow->window()); // window(), as the MainWindow can be embedded
+    return result;
+}
 
-        if (!mainWindow->deserialize(mw))
-            return false;
+///@brief Writes the item tree @p item, in Layouting::Item::toVariantMap() form. Packed with a
+///string table, instead of repeating every key for every item.
+void writeItemTree(QDataStream &stream, const QVariantMap &item)
+{
+    if (!s_binaryStrings) {
+        stream << item;
+        return;
     }
 
-    // 2. Restore FloatingWindows
-    for (const LayoutSaver::FloatingWindow &fw : qAsConst(layout.floatingWindows)) {
-        if (!d->matchesAffinity(fw.affinityName))
-            continue;
-
-        MainWindowBase *parent = fw.parentIndex == -1 ? nullptr
-                                                      : DockRegistry::self()->mainwindows().at(fw.parentIndex);
-
-        auto floatingWindow = Config::self().frameworkWidgetFactory()->createFloatingWindow(parent);
-        d->deserializeWindowGeometry(fw, floatingWindow);
-        if (!floatingWindow->deserialize(fw)) {
-            qWarning() << Q_FUNC_INFO << "Failed to deserialize floating window";
-            return false;
-        }
+    Layouting::SizingInfo sizing;
+    sizing.fromVariantMap(item.value(QStringLiteral("sizingInfo")).toMap());
+    const bool isContainer = item.value(QStringLiteral("isContainer")).toBool();
+    stream << isContainer << item.value(QStringLiteral("isVisible")).toBool()
+           << sizing.geometry << sizing.minSize << sizing.maxSize << sizing.isFixedOnParentResize;
+    writeString(stream, item.value(QStringLiteral("objectName")).toString());
+    writeString(stream, item.value(QStringLiteral("guestId")).toString());
+
+    if (isContainer) {
+        const QVariantList children = item.value(QStringLiteral("children")).toList();
+        stream << qint32(item.value(QStringLiteral("orientation")).toInt()) << quint32(children.size());
+        for (const QVariant &child : children)
+            writeItemTree(stream, child.toMap());
     }
+}
 
-    // 3. Restore closed dock widgets. They remain closed but acquire geometry and placeholder properties
-    for (const auto &dw : qAsConst(layout.closedDockWidgets)) {
-        if (d->matchesAffinity(dw->affinityName)) {
-            DockWidgetBase::deserialize(dw);
-        }
+QVariantMap readItemTree(QDataStream &stream)
+{
+    QVariantMap item;
+    if (!s_binaryStrings) {
+        stream >> item;
+        return item;
     }
 
-    // 4. Restore the placeholder info, now that the Items have been created
-    for (const auto &dw : qAsConst(layout.allDockWidgets)) {
-        if (!d->matchesAffinity(dw->affinityName))
-            continue;
-
-        if (DockWidgetBase *dockWidget = d->m_dockRegistry->dockByName(dw->uniqueName)) {
-            dockWidget->lastPositions().deserialize(dw->lastPosition);
-        } else {
-            qWarning() << Q_FUNC_INFO << "Couldn't find dock widget" << dw->uniqueName;
-        }
+    bool isContainer = false;
+    bool isVisible = false;
+    Layouting::SizingInfo sizing;
+    stream >> isContainer >> isVisible >> sizing.geometry >> sizing.minSize >> sizing.maxSize
+           >> sizing.isFixedOnParentResize;
+    item.insert(QStringLiteral("sizingInfo"), sizing.toVariantMap());
+    item.insert(QStringLiteral("isContainer"), isContainer);
+    item.insert(QStringLiteral("isVisible"), isVisible);
+    item.insert(QStringLiteral("objectName"), readString(stream));
+    const QString guestId = readString(stream);
+    if (!guestId.isEmpty())
+        item.insert(QStringLiteral("guestId"), guestId);
+
+    if (isContainer) {
+        qint32 orientation = 0;
+        quint32 count = 0;
+        stream >> orientation >> count;
+        QVariantList children;
+        for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+            children.push_back(readItemTree(stream));
+        item.insert(QStringLiteral("children"), children);
+        item.insert(QStringLiteral("orientation"), orientation);
     }
 
-    return true;
+    return item;
 }
 
-void LayoutSaver::setAffinityNames(const QStringList &affinityNames)
+///@brief Reads the header of the binary layout @p stream, and its string table into @p strings.
+///@return false if it's not a binary layout of a supported version
+bool readBinaryHeader(QDataStream &stream, BinaryStrings &strings, bool *hasStringTable)
 {
-    d->m_affinityNames = affinityNames;
-    if (affinityNames.contains(QString())) {
-        // Any window with empty affinity will also be subject to save/restore
-        d->m_affinityNames << QString();
-    }
+    stream.setVersion(s_binaryStreamVersion);
+    stream.skipRawData(sizeof(s_binaryMagic) - 1);
+
+    quint32 formatVersion = 0;
+    stream >> formatVersion;
+    if (formatVersion < s_oldestBinaryFormatVersion || formatVersion > s_binaryFormatVersion)
+        return false;
+
+    *hasStringTable = formatVersion >= 3;
+    if (*hasStringTable)
+        stream >> strings.strings;
+
+    return stream.status() == QDataStream::Ok;
 }
 
-DockWidgetBase::List LayoutSaver::restoredDockWidgets() const
+}
+
+QByteArray LayoutSaver::Layout::toBinary() const
 {
-    const DockWidgetBase::List &allDockWidgets = DockRegistry::self()->dockwidgets();
-    DockWidgetBase::List result;
-    result.reserve(allDockWidgets.size());
-    for (DockWidgetBase *dw : allDockWidgets) {
-        if (dw->property("kddockwidget_was_restored").toBool())
-            result.push_back(dw);
+    // The string table goes before the rest, but is only complete once the rest is written
+    BinaryStrings strings;
+    QByteArray body;
+    {
+        QDataStream bodyStream(&body, QIODevice::WriteOnly);
+        bodyStream.setVersion(s_binaryStreamVersion);
+        BinaryStrings::Scope scope(&strings);
+        toStream(bodyStream);
     }
 
-    return result;
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(s_binaryStreamVersion);
+    stream.writeRawData(s_binaryMagic, sizeof(s_binaryMagic) - 1);
+    stream << s_binaryFormatVersion << strings.strings;
+    stream.writeRawData(body.constData(), body.size());
+
+    return data;
 }
 
-void LayoutSaver::Private::clearRestoredProperty()
+bool LayoutSaver::Layout::isBinary(const QByteArray &data)
 {
-    const DockWidgetBase::List &allDockWidgets = DockRegistry::self()->dockwidgets();
-    for (DockWidgetBase *dw : allDockWidgets) {
-        dw->setProperty("kddockwidget_was_restored", QVariant());
-    }
+    return data.startsWith(s_binaryMagic);
 }
 
-template <typename T>
-void LayoutSaver::Private::deserializeWindowGeometry(const T &saved, QWidgetOrQuick *topLevel)
+// Followed by qCompress() output
+static const char s_compressedMagic[] = "KDDZ";
+
+QByteArray LayoutSaver::Layout::compressed(const QByteArray &data)
 {
-    topLevel->setGeometry(saved.geometry);
-    topLevel->setVisible(saved.isVisible);
+    return QByteArray(s_compressedMagic) + qCompress(data);
 }
 
-void LayoutSaver::Private::deleteEmptyFrames()
+bool LayoutSaver::Layout::isCompressed(const QByteArray &data)
 {
-    // After a restore it can happen that some DockWidgets didn't exist, so weren't restored.
-    // Delete their frame now.
-
-    for (auto frame : m_dockRegistry->frames()) {
-        if (!frame->beingDeletedLater() && frame->isEmpty() && !frame->isCentralFrame())
-            delete frame;
-    }
+    return data.startsWith(s_compressedMagic);
 }
 
-std::unique_ptr<QSettings> LayoutSaver::Private::settings() const
+QByteArray LayoutSaver::Layout::uncompressed(const QByteArray &data)
 {
-    auto settings = std::unique_ptr<QSettings>(new QSettings(qApp->organizationName(),
-                                                             qApp->applicationName()));
-    settings->beginGroup(QStringLiteral("KDDockWidgets::LayoutSaver"));
+    // qUncompress() needs at least the 4 byte length header and warns otherwise
+    const QByteArray payload = data.mid(int(sizeof(s_compressedMagic)) - 1);
+    if (!isCompressed(data) || payload.size() <= 4)
+        return {};
 
-    return settings;
+    return qUncompress(payload);
 }
 
-bool LayoutSaver::restoreInProgress()
+bool LayoutSaver::Layout::windowsFromBinary(const QByteArray &data, QVariantMap &map)
 {
-    return Private::s_restoreInProgress;
-}
+    if (!isBinary(data))
+        return false;
 
-bool LayoutSaver::Layout::isValid() const
-{
-    if (serializationVersion != KDDOCKWIDGETS_SERIALIZATION_VERSION) {
-        qWarning() << Q_FUNC_INFO << "Serialization format is too old"
-                   << serializationVersion << "current=" << KDDOCKWIDGETS_SERIALIZATION_VERSION;
+    QDataStream stream(data);
+    BinaryStrings strings;
+    bool hasStringTable = false;
+    if (!readBinaryHeader(stream, strings, &hasStringTable))
         return false;
-    }
 
-    for (auto &m : mainWindows) {
-        if (!m.isValid())
-            return false;
-    }
+    BinaryStrings::Scope scope(hasStringTable ? &strings : nullptr);
+    DetachedDockWidgetsScope detached;
 
-    for (auto &m : floatingWindows) {
-        if (!m.isValid())
-            return false;
-    }
+    // The same parsing as fromStream(), but only up to the floating windows
+    qint32 version = 0;
+    stream >> version;
+    const auto mainWindows = listFromStream<LayoutSaver::MainWindow>(stream);
+    const auto floatingWindows = listFromStream<LayoutSaver::FloatingWindow>(stream);
 
-    for (auto &m : allDockWidgets) {
-        if (!m->isValid())
-            return false;
-    }
+    if (stream.status() != QDataStream::Ok)
+        return false;
 
+    map.clear();
+    map.insert(QStringLiteral("serializationVersion"), version);
+    map.insert(QStringLiteral("mainWindows"), toVariantList<LayoutSaver::MainWindow>(mainWindows));
+    map.insert(QStringLiteral("floatingWindows"), toVariantList<LayoutSaver::FloatingWindow>(floatingWindows));
     return true;
 }
 
-QByteArray LayoutSaver::Layout::toJson() const
+bool LayoutSaver::Layout::fromBinary(const QByteArray &data)
 {
-    QJsonDocument doc = QJsonDocument::fromVariant(toVariantMap());
-    return doc.toJson();
+    KDDW_TRACE_SCOPE("restore", "LayoutSaver::Layout::fromBinary");
+    if (!isBinary(data))
+        return false;
+
+    QDataStream stream(data);
+    BinaryStrings strings;
+    bool hasStringTable = false;
+    if (!readBinaryHeader(stream, strings, &hasStringTable)) {
+        qWarning() << Q_FUNC_INFO << "Unsupported binary format version";
+        return false;
+    }
+
+    BinaryStrings::Scope scope(hasStringTable ? &strings : nullptr);
+    fromStream(stream);
+    return stream.status() == QDataStream::Ok;
 }
 
-bool LayoutSaver::Layout::fromJson(const QByteArray &jsonData)
+void LayoutSaver::Layout::toStream(QDataStream &stream) const
 {
-    QJsonParseError error;
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData, &error);
-    if (error.error == QJsonParseError::NoError)  {
-        fromVariantMap(doc.toVariant().toMap());
-        return true;
+    stream << qint32(serializationVersion);
+    listToStream<LayoutSaver::MainWindow>(stream, mainWindows);
+    listToStream<LayoutSaver::FloatingWindow>(stream, floatingWindows);
+    writeStringList(stream, dockWidgetNameList(closedDockWidgets));
+
+    stream << quint32(allDockWidgets.size());
+    for (const auto &dw : allDockWidgets)
+        dw->toStream(stream);
+
+    listToStream<LayoutSaver::ScreenInfo>(stream, screenInfo);
+}
+
+void LayoutSaver::Layout::fromStream(QDataStream &stream)
+{
+    qint32 version = 0;
+    stream >> version;
+    serializationVersion = version;
+    mainWindows = listFromStream<LayoutSaver::MainWindow>(stream);
+    floatingWindows = listFromStream<LayoutSaver::FloatingWindow>(stream);
+
+    closedDockWidgets = readDockWidgets(stream);
+
+    quint32 count = 0;
+    stream >> count;
+    allDockWidgets.clear();
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        auto dw = readDockWidget(stream);
+        dw->fromStream(stream);
+        allDockWidgets.push_back(dw);
     }
 
-    return false;
+    screenInfo = listFromStream<LayoutSaver::ScreenInfo>(stream);
 }
 
 QVariantMap LayoutSaver::Layout::toVariantMap() const
@@ -425,38 +2822,6 @@ void LayoutSaver::Layout::fromVariantMap(const QVariantMap &map)
     screenInfo = fromVariantList<LayoutSaver::ScreenInfo>(map.value(QStringLiteral("screenInfo")).toList());
 }
 
-void LayoutSaver::Layout::scaleSizes()
-{
-    if (mainWindows.isEmpty())
-        return;
-
-    for (auto &mw : mainWindows)
-        mw.scaleSizes();
-
-    for (auto &fw : floatingWindows) {
-        LayoutSaver::MainWindow mw = mainWindowForIndex(fw.parentIndex);
-        if (mw.scalingInfo.isValid())
-            fw.scaleSizes(mw.scalingInfo);
-    }
-
-    const ScalingInfo firstScalingInfo = mainWindows.constFirst().scalingInfo;
-    if (firstScalingInfo.isValid()) {
-        for (auto &dw : allDockWidgets) {
-            // TODO: Determine the best main window. This only interesting for closed dock widget geometry
-            // which was previously floating. But they still have some other main window as parent.
-            dw->scaleSizes(firstScalingInfo);
-        }
-    }
-}
-
-LayoutSaver::MainWindow LayoutSaver::Layout::mainWindowForIndex(int index) const
-{
-    if (index < 0 || index >= mainWindows.size())
-        return {};
-
-    return mainWindows.at(index);
-}
-
 bool LayoutSaver::Frame::isValid() const
 {
     if (isNull)
@@ -512,6 +2877,28 @@ QVariantMap LayoutSaver::Frame::toVariantMap() const
     return map;
 }
 
+void LayoutSaver::Frame::toStream(QDataStream &stream) const
+{
+    writeString(stream, id);
+    stream << isNull;
+    writeString(stream, objectName);
+    stream << geometry << quint32(options) << qint32(currentTabIndex);
+    writeStringList(stream, dockWidgetNameList(dockWidgets));
+}
+
+void LayoutSaver::Frame::fromStream(QDataStream &stream)
+{
+    quint32 opts = 0;
+    qint32 tabIndex = 0;
+    id = readString(stream);
+    stream >> isNull;
+    objectName = readString(stream);
+    stream >> geometry >> opts >> tabIndex;
+    options = opts;
+    currentTabIndex = tabIndex;
+    dockWidgets = readDockWidgets(stream);
+}
+
 void LayoutSaver::Frame::fromVariantMap(const QVariantMap &map)
 {
     if (map.isEmpty()) {
@@ -542,11 +2929,6 @@ bool LayoutSaver::DockWidget::isValid() const
     return !uniqueName.isEmpty();
 }
 
-void LayoutSaver::DockWidget::scaleSizes(const ScalingInfo &scalingInfo)
-{
-    lastPosition.scaleSizes(scalingInfo);
-}
-
 QVariantMap LayoutSaver::DockWidget::toVariantMap() const
 {
     QVariantMap map;
@@ -558,6 +2940,21 @@ QVariantMap LayoutSaver::DockWidget::toVariantMap() const
     return map;
 }
 
+void LayoutSaver::DockWidget::toStream(QDataStream &stream) const
+{
+    // uniqueName goes first, so the reader can find the shared instance before reading the rest
+    writeString(stream, uniqueName);
+    writeString(stream, affinityName);
+    lastPosition.toStream(stream);
+}
+
+void LayoutSaver::DockWidget::fromStream(QDataStream &stream)
+{
+    // uniqueName was already read by whoever called dockWidgetForName()
+    affinityName = readString(stream);
+    lastPosition.fromStream(stream);
+}
+
 void LayoutSaver::DockWidget::fromVariantMap(const QVariantMap &map)
 {
     affinityName = map.value(QStringLiteral("affinityName")).toString();
@@ -600,6 +2997,24 @@ QVariantMap LayoutSaver::FloatingWindow::toVariantMap() const
     return map;
 }
 
+void LayoutSaver::FloatingWindow::toStream(QDataStream &stream) const
+{
+    multiSplitterLayout.toStream(stream);
+    stream << qint32(parentIndex) << geometry << qint32(screenIndex) << screenSize << isVisible;
+    writeString(stream, affinityName);
+}
+
+void LayoutSaver::FloatingWindow::fromStream(QDataStream &stream)
+{
+    multiSplitterLayout.fromStream(stream);
+    qint32 parent = -1;
+    qint32 screen = 0;
+    stream >> parent >> geometry >> screen >> screenSize >> isVisible;
+    affinityName = readString(stream);
+    parentIndex = parent;
+    screenIndex = screen;
+}
+
 void LayoutSaver::FloatingWindow::fromVariantMap(const QVariantMap &map)
 {
     multiSplitterLayout.fromVariantMap(map.value(QStringLiteral("multiSplitterLayout")).toMap());
@@ -624,20 +3039,6 @@ bool LayoutSaver::MainWindow::isValid() const
     return true;
 }
 
-void LayoutSaver::MainWindow::scaleSizes()
-{
-    if (scalingInfo.isValid()) {
-        // Doesn't happen, it's called only once
-        Q_ASSERT(false);
-        return;
-    }
-
-    scalingInfo = ScalingInfo(uniqueName, geometry);
-
-    if (scalingInfo.isValid())
-        multiSplitterLayout.scaleSizes(scalingInfo);
-}
-
 QVariantMap LayoutSaver::MainWindow::toVariantMap() const
 {
     QVariantMap map;
@@ -655,6 +3056,28 @@ QVariantMap LayoutSaver::MainWindow::toVariantMap() const
     return map;
 }
 
+void LayoutSaver::MainWindow::toStream(QDataStream &stream) const
+{
+    stream << qint32(options);
+    multiSplitterLayout.toStream(stream);
+    writeString(stream, uniqueName);
+    writeString(stream, affinityName);
+    stream << geometry << qint32(screenIndex) << screenSize << isVisible;
+}
+
+void LayoutSaver::MainWindow::fromStream(QDataStream &stream)
+{
+    qint32 opts = 0;
+    qint32 screen = 0;
+    stream >> opts;
+    multiSplitterLayout.fromStream(stream);
+    uniqueName = readString(stream);
+    affinityName = readString(stream);
+    stream >> geometry >> screen >> screenSize >> isVisible;
+    options = KDDockWidgets::MainWindowOptions(opts);
+    screenIndex = screen;
+}
+
 void LayoutSaver::MainWindow::fromVariantMap(const QVariantMap &map)
 {
     options = KDDockWidgets::MainWindowOptions(map.value(QStringLiteral("options")).toInt());
@@ -701,6 +3124,30 @@ QVariantMap LayoutSaver::MultiSplitterLayout::toVariantMap() const
     return result;
 }
 
+void LayoutSaver::MultiSplitterLayout::toStream(QDataStream &stream) const
+{
+    // The item tree is already stored as a QVariantMap, by Layouting::ItemContainer::toVariantMap()
+    writeItemTree(stream, layout);
+
+    stream << quint32(frames.size());
+    for (auto &frame : frames)
+        frame.toStream(stream);
+}
+
+void LayoutSaver::MultiSplitterLayout::fromStream(QDataStream &stream)
+{
+    layout = readItemTree(stream);
+
+    quint32 count = 0;
+    stream >> count;
+    frames.clear();
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        LayoutSaver::Frame frame;
+        frame.fromStream(stream);
+        frames.insert(frame.id, frame);
+    }
+}
+
 void LayoutSaver::MultiSplitterLayout::fromVariantMap(const QVariantMap &map)
 {
     layout = map.value(QStringLiteral("layout")).toMap();
@@ -729,6 +3176,20 @@ QVariantMap LayoutSaver::Position::toVariantMap() const
     return map;
 }
 
+void LayoutSaver::Position::toStream(QDataStream &stream) const
+{
+    stream << lastFloatingGeometry << qint32(tabIndex) << wasFloating;
+    listToStream<LayoutSaver::Placeholder>(stream, placeholders);
+}
+
+void LayoutSaver::Position::fromStream(QDataStream &stream)
+{
+    qint32 index = 0;
+    stream >> lastFloatingGeometry >> index >> wasFloating;
+    tabIndex = index;
+    placeholders = listFromStream<LayoutSaver::Placeholder>(stream);
+}
+
 void LayoutSaver::Position::fromVariantMap(const QVariantMap &map)
 {
     lastFloatingGeometry = Layouting::mapToRect(map.value(QStringLiteral("lastFloatingGeometry")).toMap());
@@ -748,6 +3209,22 @@ QVariantMap LayoutSaver::ScreenInfo::toVariantMap() const
     return map;
 }
 
+void LayoutSaver::ScreenInfo::toStream(QDataStream &stream) const
+{
+    stream << qint32(index) << geometry;
+    writeString(stream, name);
+    stream << devicePixelRatio;
+}
+
+void LayoutSaver::ScreenInfo::fromStream(QDataStream &stream)
+{
+    qint32 i = 0;
+    stream >> i >> geometry;
+    name = readString(stream);
+    stream >> devicePixelRatio;
+    index = i;
+}
+
 void LayoutSaver::ScreenInfo::fromVariantMap(const QVariantMap &map)
 {
     index = map.value(QStringLiteral("index")).toInt();
@@ -770,6 +3247,23 @@ QVariantMap LayoutSaver::Placeholder::toVariantMap() const
     return map;
 }
 
+void LayoutSaver::Placeholder::toStream(QDataStream &stream) const
+{
+    stream << isFloatingWindow << qint32(isFloatingWindow ? indexOfFloatingWindow : -1)
+           << qint32(itemIndex);
+    writeString(stream, isFloatingWindow ? QString() : mainWindowUniqueName);
+}
+
+void LayoutSaver::Placeholder::fromStream(QDataStream &stream)
+{
+    qint32 fwIndex = -1;
+    qint32 index = 0;
+    stream >> isFloatingWindow >> fwIndex >> index;
+    mainWindowUniqueName = readString(stream);
+    indexOfFloatingWindow = fwIndex;
+    itemIndex = index;
+}
+
 void LayoutSaver::Placeholder::fromVariantMap(const QVariantMap &map)
 {
     isFloatingWindow = map.value(QStringLiteral("isFloatingWindow")).toBool();
@@ -32,13 +32,19 @@
 
 #include "KDDockWidgets.h"
 
+#include <functional>
+#include <memory>
+
 QT_BEGIN_NAMESPACE
 class QByteArray;
+class QImage;
+class QSize;
 QT_END_NAMESPACE
 
 namespace KDDockWidgets {
 
 class DockWidgetBase;
+class LayoutStore;
 
 class DOCKS_EXPORT LayoutSaver
 {
@@ -49,27 +55,61 @@ public:
     ///@brief Destructor.
     ~LayoutSaver();
 
+    ///@brief The formats a layout can be saved in
+    enum class Format {
+        Json = 0, ///< Human readable JSON, the default
+        Binary, ///< A compact binary format, faster to write and parse, with fewer allocations. Prefer it for frequent autosaves.
+        CompressedBinary ///< The binary format, zlib compressed. The smallest, for layouts that are synced or sent around
+    };
+
     ///@brief returns whether a restore (@ref restoreLayout) is in progress
     static bool restoreInProgress();
 
     /**
      * @brief saves the layout to JSON file
      * @brief jsonFilename the filename where the layout will be saved to
+     * @param format The format to save in
      * @return true on success
      */
-    bool saveToFile(const QString &jsonFilename);
+    bool saveToFile(const QString &jsonFilename, Format format = Format::Json);
 
     /**
      * @brief restores the layout from a JSON file
+     * Files saved in the binary or compressed formats are detected and restored too.
      * @brief jsonFilename the filename containing a saved layout
      * @return true on success
      */
     bool restoreFromFile(const QString &jsonFilename);
 
+    /**
+     * @brief saves the layout into @p store, as the layout called @p name
+     * The affinity names of the saved windows are stored with it. Call LayoutStore::commit() to write it to disk.
+     * @param format The format to save in
+     * @return true on success
+     */
+    bool saveToStore(LayoutStore &store, const QString &name, Format format = Format::Binary);
+
+    /**
+     * @brief restores the layout called @p name from @p store
+     * None of the other layouts in the store are read.
+     * @return true on success
+     */
+    bool restoreFromStore(const LayoutStore &store, const QString &name);
+
     /**
      * @brief saves the layout into a byte array
+     * @param format The format to save in
+     */
+    QByteArray serializeLayout(Format format = Format::Json) const;
+
+    /**
+     * @brief Returns a hash of what serializeLayout() would return, for CompressedBinary the
+     * hash of the uncompressed data
+     *
+     * It's cached until the layout changes, so it's cheap to call often, for example to tell
+     * whether there's anything new to sync. See also RestoreOption_SkipIfUnchanged.
      */
-    QByteArray serializeLayout() const;
+    QByteArray layoutHash(Format format = Format::Binary) const;
 
     /**
      * @brief restores the layout from a byte array
@@ -79,6 +119,8 @@ public:
      * If not all DockWidgets can be created beforehand then make sure to set
      * a DockWidget factory via Config::setDockWidgetFactoryFunc()
      *
+     * The format (JSON, binary or compressed binary) is detected automatically.
+     *
      * @sa Config::setDockWidgetFactoryFunc()
      *
      * @return true on success
@@ -93,6 +135,179 @@ public:
      */
     QVector<DockWidgetBase *> restoredDockWidgets() const;
 
+    /**
+     * @brief Saves the current layout in memory, as the perspective called @p name
+     *
+     * Perspectives are kept already parsed, so restorePerspective() doesn't need to
+     * serialize or parse anything. An existing perspective with the same name is replaced.
+     *
+     * @return true on success
+     */
+    bool savePerspective(const QString &name);
+
+    /**
+     * @brief Restores the perspective previously saved with savePerspective()
+     *
+     * Frames and floating windows discarded by the previous restore are reused, if
+     * Config::setFramePoolSize() and Config::setFloatingWindowPoolSize() allow pooling them.
+     *
+     * @return true on success, false if there's no perspective called @p name or restoring failed
+     */
+    bool restorePerspective(const QString &name);
+
+    ///@brief Returns the names of the perspectives saved with savePerspective()
+    static QStringList perspectives();
+
+    ///@brief Forgets the perspective called @p name
+    static void removePerspective(const QString &name);
+
+    /**
+     * @brief An in-memory snapshot of the layout, see takeSnapshot()
+     *
+     * Snapshots are immutable and cheap to copy. Keep as many as needed for undo and redo.
+     */
+    class DOCKS_EXPORT Snapshot
+    {
+    public:
+        ///@brief returns whether this snapshot is default constructed, or taking it failed
+        bool isNull() const { return !d; }
+
+    private:
+        friend class LayoutSaver;
+        struct Data;
+        std::shared_ptr<const Data> d;
+    };
+
+    /**
+     * @brief Snapshots the current layout in memory, for undo and redo
+     *
+     * Like savePerspective(), nothing is encoded. Additionally, a snapshot shares with the
+     * previous one whatever didn't change between them: windows, layout sub-trees, frames and
+     * dock widget positions. So consecutive snapshots only cost what the operation in between
+     * changed, like a drop, a close or a separator move.
+     */
+    Snapshot takeSnapshot() const;
+
+    /**
+     * @brief Restores a layout saved by takeSnapshot()
+     *
+     * When only geometries, separators or current tabs changed since @p snapshot was taken,
+     * it's restored in place, as with RestoreOption_InPlace, so nothing is rebuilt.
+     *
+     * @return true on success
+     */
+    bool restoreSnapshot(const Snapshot &snapshot);
+
+    /**
+     * @brief Saves the layout to @p filename whenever it changes
+     *
+     * Bursts of changes are coalesced: the layout is saved @p delayMs after the last change, or
+     * at most 4 x @p delayMs after the first one. Only a snapshot is taken on the GUI thread, the
+     * JSON encoding and the write happen on a worker thread and the file is replaced atomically.
+     * With Format::Binary the encoding is done on the GUI thread, as it's cheap.
+     *
+     * Autosaving stops when all main windows, floating windows and dock widgets are deleted.
+     * Pass an empty @p filename to stop it explicitly.
+     */
+    static void setAutoSaveFile(const QString &filename, Format format = Format::Json, int delayMs = 1000);
+
+    /**
+     * @brief Journals each layout change into @p filename, for crash recovery
+     *
+     * An alternative to setAutoSaveFile() where the file isn't rewritten on every change. It starts
+     * with a snapshot of the whole layout, and each change appends a small record with only the
+     * main windows and dock widgets that changed, and the floating windows if any did. A change is
+     * journaled once the event loop runs again, so the changes of a single operation share a
+     * record, and at most the last operation is lost on a crash.
+     *
+     * After @p compactAfter records the file is replaced by a fresh snapshot.
+     *
+     * restoreFromFile() and restoreLayout() replay journals, ignoring a truncated last record.
+     * Journaling stops when all main windows, floating windows and dock widgets are deleted.
+     * Pass an empty @p filename to stop it explicitly.
+     */
+    static void setAutoSaveJournal(const QString &filename, int compactAfter = 100);
+
+    ///@brief Saves any pending change right away and blocks until all autosaves are written.
+    ///Journals too, see setAutoSaveJournal()
+    static void flushAutoSave();
+
+    /**
+     * @brief Renders a schematic thumbnail of the saved layout @p data, for layout pickers
+     *
+     * Draws the main windows and the visible floating windows, with their frames and tabs, from
+     * the geometries saved in @p data, scaled to fit @p size. Tabs are labelled with the dock
+     * widgets' unique names, as titles aren't saved. All formats work, journals too.
+     *
+     * Nothing is restored and no dock widget is needed, so it can be called from any thread.
+     * Thumbnails are cached by the layout's hash and @p size.
+     *
+     * @return the thumbnail, or a null image if @p data isn't a valid layout
+     */
+    static QImage renderThumbnail(const QByteArray &data, QSize size);
+
+    ///@brief Returns how many floating windows haven't been restored yet.
+    ///See RestoreOption_DeferOffscreenFloatingWindows
+    static int numDeferredFloatingWindows();
+
+    /**
+     * @brief Sets a function to call once a successful restore by this LayoutSaver is done
+     *
+     * With RestoreOption_Progressive that's after the last part was restored from the event loop,
+     * otherwise it's before the restore function returns. It isn't called if another restore starts
+     * before the progressive one is done, as that one replaces it.
+     */
+    void setRestoreFinishedCallback(const std::function<void()> &callback);
+
+    ///@brief Returns whether a RestoreOption_Progressive restore still has parts left to restore
+    static bool progressiveRestoreInProgress();
+
+    ///@brief Restores what a RestoreOption_Progressive restore has left right away.
+    ///Saving a layout calls it too, so nothing pending is lost.
+    static void finishProgressiveRestore();
+
+    /**
+     * @brief Returns a fingerprint of the connected screens: their names, geometries and device pixel ratios
+     *
+     * Screens are sorted by name first, so the order Qt reports them in doesn't matter.
+     * Also usable as a layout name for saveToStore(), to persist the variants.
+     */
+    static QString screenConfigurationKey();
+
+    /**
+     * @brief Saves the current layout in memory, as the variant for the current screen configuration
+     * See screenConfigurationKey(). Like savePerspective(), nothing is encoded.
+     * @return true on success
+     */
+    bool saveScreenVariant();
+
+    /**
+     * @brief Restores the variant saved for the current screen configuration
+     * It's restored in place when it can be, as restoreSnapshot() does.
+     * @return true on success, false if there's no variant for this screen configuration or restoring failed
+     */
+    bool restoreScreenVariant();
+
+    /**
+     * @brief Switches layout variants as monitors are plugged and unplugged
+     *
+     * When a screen is added or removed, the layout is saved as the variant of the screen
+     * configuration it was in, before any window is moved, and the variant of the new screen
+     * configuration is restored, with @p options. Without one the layout stays as it is, and
+     * becomes the new configuration's variant on the next change.
+     * Bursts of screen changes, like when connecting a docking station, only restore once.
+     * Resolution and scale changes count as screen changes too, see screenConfigurationKey().
+     */
+    static void setFollowScreenChanges(bool enabled, RestoreOptions options = RestoreOption_None);
+
+    ///@brief Forgets the variants of all screen configurations, see saveScreenVariant()
+    static void clearScreenVariants();
+
+#if defined(DOCKS_DEVELOPER_MODE)
+    ///@brief For tests. Makes screenConfigurationKey() return @p key, or the real one if empty, as if the screens changed.
+    static void dbg_setScreenConfigurationKey(const QString &key);
+#endif
+
 
     /**
      * @brief Sets the list of affinity names for which restore and save will be applied on.
@@ -115,6 +330,13 @@ public:
 private:
     Q_DISABLE_COPY(LayoutSaver)
     friend class TestDocks;
+    friend class DockWidgetBase;
+
+    ///@brief Restores the deferred floating window containing @p dw, if any. Returns true if it did.
+    static bool restoreDeferredFloatingWindowFor(const DockWidgetBase *dw);
+
+    ///@brief Records @p dw as restored by the restore in progress, see restoredDockWidgets()
+    static void markRestored(DockWidgetBase *dw);
 
     class Private;
     Private *const d;
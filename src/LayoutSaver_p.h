@@ -29,6 +29,7 @@
 #include <QScreen>
 #include <QApplication>
 #include <QJsonDocument>
+#include <QDataStream>
 
 #include <memory>
 
@@ -39,8 +40,12 @@
   * version 1: Initial version
   * version 2: Introduced MainWindow::screenSize and FloatingWindow::screenSize
   * version 3: New layouting engine
+  * version 4: Names interned into a string table, and packed sizingInfo, see Layout::normalizedMap()
   */
-#define KDDOCKWIDGETS_SERIALIZATION_VERSION 3
+#define KDDOCKWIDGETS_SERIALIZATION_VERSION 4
+
+///@brief The oldest version that can still be loaded. Only the encoding changed since
+#define KDDOCKWIDGETS_MIN_SERIALIZATION_VERSION 3
 
 
 namespace KDDockWidgets {
@@ -71,12 +76,39 @@ QVariantList toVariantList(const typename T::List &list)
     return result;
 }
 
+///@brief Typed counterparts of toVariantList()/fromVariantList(), for the binary format
+template <typename T>
+void listToStream(QDataStream &stream, const typename T::List &list)
+{
+    stream << quint32(list.size());
+    for (const T &v : list)
+        v.toStream(stream);
+}
+
+template <typename T>
+typename T::List listFromStream(QDataStream &stream)
+{
+    quint32 count = 0;
+    stream >> count;
+
+    typename T::List result;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        T t;
+        t.fromStream(stream);
+        result.push_back(t);
+    }
+
+    return result;
+}
+
 struct LayoutSaver::Placeholder
 {
     typedef QVector<LayoutSaver::Placeholder> List;
 
     QVariantMap toVariantMap() const;
     void fromVariantMap(const QVariantMap &map);
+    void toStream(QDataStream &) const;
+    void fromStream(QDataStream &);
 
     bool isFloatingWindow;
     int indexOfFloatingWindow;
@@ -119,6 +151,8 @@ struct LayoutSaver::Position
 
     QVariantMap toVariantMap() const;
     void fromVariantMap(const QVariantMap &map);
+    void toStream(QDataStream &) const;
+    void fromStream(QDataStream &);
 };
 
 struct DOCKS_EXPORT LayoutSaver::DockWidget
@@ -130,9 +164,6 @@ struct DOCKS_EXPORT LayoutSaver::DockWidget
 
     bool isValid() const;
 
-    /// Iterates throught the layout and patches all absolute sizes. See RestoreOption_RelativeToMainWindow.
-    void scaleSizes(const ScalingInfo &scalingInfo);
-
     static Ptr dockWidgetForName(const QString &name)
     {
         auto dw = s_dockWidgets.value(name);
@@ -146,8 +177,18 @@ struct DOCKS_EXPORT LayoutSaver::DockWidget
         return dw;
     }
 
+    ///@brief Like dockWidgetForName(), but not shared, and safe to call off the GUI thread
+    static Ptr unsharedDockWidgetForName(const QString &name)
+    {
+        auto dw = Ptr(new LayoutSaver::DockWidget);
+        dw->uniqueName = name;
+        return dw;
+    }
+
     QVariantMap toVariantMap() const;
     void fromVariantMap(const QVariantMap &map);
+    void toStream(QDataStream &) const;
+    void fromStream(QDataStream &);
 
     QString uniqueName;
     QString affinityName;
@@ -168,6 +209,16 @@ inline QVariantList toVariantList(const LayoutSaver::DockWidget::List &list)
     return result;
 }
 
+inline QStringList dockWidgetNameList(const LayoutSaver::DockWidget::List &list)
+{
+    QStringList result;
+    result.reserve(list.size());
+    for (auto &dw : list)
+        result.push_back(dw->uniqueName);
+
+    return result;
+}
+
 inline QVariantList dockWidgetNames(const LayoutSaver::DockWidget::List &list)
 {
     QVariantList result;
@@ -187,6 +238,8 @@ struct LayoutSaver::Frame
 
     QVariantMap toVariantMap() const;
     void fromVariantMap(const QVariantMap &map);
+    void toStream(QDataStream &) const;
+    void fromStream(QDataStream &);
 
     bool isNull = true;
     QString objectName;
@@ -206,6 +259,8 @@ struct LayoutSaver::MultiSplitterLayout
 
     QVariantMap toVariantMap() const;
     void fromVariantMap(const QVariantMap &map);
+    void toStream(QDataStream &) const;
+    void fromStream(QDataStream &);
 
     QVariantMap layout;
     QHash<QString, LayoutSaver::Frame> frames;
@@ -222,6 +277,8 @@ struct LayoutSaver::FloatingWindow
 
     QVariantMap toVariantMap() const;
     void fromVariantMap(const QVariantMap &map);
+    void toStream(QDataStream &) const;
+    void fromStream(QDataStream &);
 
     LayoutSaver::MultiSplitterLayout multiSplitterLayout;
     QString affinityName;
@@ -239,11 +296,10 @@ public:
 
     bool isValid() const;
 
-    /// Iterates throught the layout and patches all absolute sizes. See RestoreOption_RelativeToMainWindow.
-    void scaleSizes();
-
     QVariantMap toVariantMap() const;
     void fromVariantMap(const QVariantMap &map);
+    void toStream(QDataStream &) const;
+    void fromStream(QDataStream &);
 
     KDDockWidgets::MainWindowOptions options;
     LayoutSaver::MultiSplitterLayout multiSplitterLayout;
@@ -253,8 +309,6 @@ public:
     int screenIndex;
     QSize screenSize;  // for relative-size restoring
     bool isVisible;
-
-    ScalingInfo scalingInfo;
 };
 
 ///@brief we serialize some info about screens, so eventually we can make restore smarter when switching screens
@@ -265,6 +319,8 @@ struct LayoutSaver::ScreenInfo
 
     QVariantMap toVariantMap() const;
     void fromVariantMap(const QVariantMap &map);
+    void toStream(QDataStream &) const;
+    void fromStream(QDataStream &);
 
     int index;
     QRect geometry;
@@ -272,7 +328,7 @@ struct LayoutSaver::ScreenInfo
     double devicePixelRatio;
 };
 
-struct LayoutSaver::Layout
+struct DOCKS_EXPORT LayoutSaver::Layout
 {
 public:
 
@@ -296,18 +352,54 @@ public:
 
     bool isValid() const;
 
+    ///@brief JSON still goes through toVariantMap(), unlike the binary format, which streams the
+    ///structs directly. Qt 5.9 has no streaming JSON writer or reader, and the normalized format, see
+    ///normalizedMap(), is a pass over that map tree. Use the binary formats where the copies matter.
     QByteArray toJson() const;
     bool fromJson(const QByteArray &jsonData);
+    QByteArray toBinary() const;
+    bool fromBinary(const QByteArray &data);
+
+    ///@brief returns whether @p data was produced by toBinary()
+    static bool isBinary(const QByteArray &data);
+
+    ///@brief Compresses @p data, which can be in any format. See Format::CompressedBinary.
+    static QByteArray compressed(const QByteArray &data);
+
+    ///@brief returns whether @p data was produced by compressed()
+    static bool isCompressed(const QByteArray &data);
+
+    ///@brief Reverts compressed(). Returns an empty array if @p data is corrupt.
+    static QByteArray uncompressed(const QByteArray &data);
+
+    ///@brief returns whether @p data is a journal, see LayoutSaver::setAutoSaveJournal()
+    static bool isJournal(const QByteArray &data);
+
+    ///@brief Replays the snapshot and records of the journal @p data into @p map, in toVariantMap() form.
+    ///A truncated last record, from a crash while appending, is ignored.
+    ///@return false if there's no valid snapshot
+    static bool replayJournal(const QByteArray &data, QVariantMap &map);
+
+    ///@brief Reads the main and floating windows of the binary layout @p data into @p map, in
+    ///toVariantMap() form. Unlike fromBinary() the dock widget registry isn't touched, so it's thread-safe.
+    ///@return false if @p data isn't a valid binary layout
+    static bool windowsFromBinary(const QByteArray &data, QVariantMap &map);
+
+    ///@brief Returns @p map, in toVariantMap() form, as the JSON format stores it: Names are
+    ///interned into a "strings" table and referenced by index, and each sizingInfo is a plain list.
+    ///Doesn't touch any shared state, so it's thread-safe.
+    static QVariantMap normalizedMap(const QVariantMap &map);
+
+    ///@brief Reverts normalizedMap(). Maps that aren't normalized, like older layouts and
+    ///journals, are returned as they are.
+    static QVariantMap denormalizedMap(const QVariantMap &map);
     QVariantMap toVariantMap() const;
     void fromVariantMap(const QVariantMap &map);
-
-    /// Iterates throught the layout and patches all absolute sizes. See RestoreOption_RelativeToMainWindow.
-    void scaleSizes();
+    void toStream(QDataStream &) const;
+    void fromStream(QDataStream &);
 
     static LayoutSaver::Layout* s_currentLayoutBeingRestored;
 
-    LayoutSaver::MainWindow mainWindowForIndex(int index) const;
-
     int serializationVersion = KDDOCKWIDGETS_SERIALIZATION_VERSION;
     LayoutSaver::MainWindow::List mainWindows;
     LayoutSaver::FloatingWindow::List floatingWindows;
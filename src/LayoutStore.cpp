@@ -0,0 +1,252 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief A single file holding many named layouts.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "LayoutStore.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QMap>
+#include <QSaveFile>
+
+#include <cstring>
+
+using namespace KDDockWidgets;
+
+// File format: magic, version, index, then the data of each layout, in index order.
+// Offsets in the index are relative to the end of the index.
+static const char s_storeMagic[] = "KDDS";
+static const quint32 s_storeFormatVersion = 1;
+static const QDataStream::Version s_storeStreamVersion = QDataStream::Qt_5_9;
+
+class LayoutStore::Private
+{
+public:
+    struct Entry
+    {
+        QStringList affinityNames;
+        quint64 offset = 0;
+        quint64 size = 0;
+        bool isPending = false; // Not written yet, data is in pendingData
+        QByteArray pendingData;
+    };
+
+    explicit Private(const QString &filename)
+        : m_file(filename)
+    {
+    }
+
+    ~Private()
+    {
+        close();
+    }
+
+    void close()
+    {
+        if (m_map)
+            m_file.unmap(m_map);
+        m_map = nullptr;
+        m_mapSize = 0;
+        m_dataStart = 0;
+        m_file.close();
+        m_entries.clear();
+    }
+
+    bool readIndex();
+
+    QByteArray data(const Entry &entry) const
+    {
+        if (entry.isPending)
+            return entry.pendingData;
+
+        return QByteArray(reinterpret_cast<const char*>(m_map + m_dataStart + entry.offset), int(entry.size));
+    }
+
+    QFile m_file;
+    uchar *m_map = nullptr;
+    qint64 m_mapSize = 0;
+    qint64 m_dataStart = 0;
+    QMap<QString, Entry> m_entries;
+};
+
+bool LayoutStore::Private::readIndex()
+{
+    // Without copying, only the pages holding the index are read
+    const QByteArray mapped = QByteArray::fromRawData(reinterpret_cast<const char*>(m_map), int(m_mapSize));
+    QDataStream ds(mapped);
+    ds.setVersion(s_storeStreamVersion);
+
+    char magic[sizeof(s_storeMagic) - 1];
+    quint32 version = 0;
+    quint32 count = 0;
+    if (ds.readRawData(magic, sizeof(magic)) != int(sizeof(magic)) || memcmp(magic, s_storeMagic, sizeof(magic)) != 0) {
+        qWarning() << Q_FUNC_INFO << "Not a layout store" << m_file.fileName();
+        return false;
+    }
+
+    ds >> version >> count;
+    if (version != s_storeFormatVersion) {
+        qWarning() << Q_FUNC_INFO << "Unsupported layout store version" << version;
+        return false;
+    }
+
+    for (quint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+        QString name;
+        Entry entry;
+        ds >> name >> entry.affinityNames >> entry.offset >> entry.size;
+        m_entries.insert(name, entry);
+    }
+
+    m_dataStart = ds.device()->pos();
+    for (const Entry &entry : qAsConst(m_entries)) {
+        if (ds.status() != QDataStream::Ok || entry.offset + entry.size > quint64(m_mapSize - m_dataStart)) {
+            qWarning() << Q_FUNC_INFO << "Corrupt layout store" << m_file.fileName();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+LayoutStore::LayoutStore(const QString &filename)
+    : d(new Private(filename))
+{
+}
+
+LayoutStore::~LayoutStore()
+{
+    delete d;
+}
+
+QString LayoutStore::filename() const
+{
+    return d->m_file.fileName();
+}
+
+bool LayoutStore::open()
+{
+    d->close();
+    if (!d->m_file.exists())
+        return true;
+
+    if (!d->m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << Q_FUNC_INFO << "Failed to open" << d->m_file.fileName() << d->m_file.errorString();
+        return false;
+    }
+
+    d->m_mapSize = d->m_file.size();
+    d->m_map = d->m_file.map(0, d->m_mapSize);
+    if (!d->m_map) {
+        qWarning() << Q_FUNC_INFO << "Failed to map" << d->m_file.fileName() << d->m_file.errorString();
+        d->close();
+        return false;
+    }
+
+    if (!d->readIndex()) {
+        d->close();
+        return false;
+    }
+
+    return true;
+}
+
+QStringList LayoutStore::layoutNames() const
+{
+    return d->m_entries.keys();
+}
+
+bool LayoutStore::contains(const QString &name) const
+{
+    return d->m_entries.contains(name);
+}
+
+QStringList LayoutStore::affinityNames(const QString &name) const
+{
+    return d->m_entries.value(name).affinityNames;
+}
+
+QByteArray LayoutStore::layout(const QString &name) const
+{
+    auto it = d->m_entries.constFind(name);
+    if (it == d->m_entries.cend())
+        return {};
+
+    return d->data(*it);
+}
+
+void LayoutStore::insert(const QString &name, const QByteArray &data, const QStringList &affinityNames)
+{
+    Private::Entry entry;
+    entry.affinityNames = affinityNames;
+    entry.size = quint64(data.size());
+    entry.isPending = true;
+    entry.pendingData = data;
+    d->m_entries.insert(name, entry);
+}
+
+void LayoutStore::remove(const QString &name)
+{
+    d->m_entries.remove(name);
+}
+
+bool LayoutStore::commit()
+{
+    QByteArray index;
+    QDataStream ds(&index, QIODevice::WriteOnly);
+    ds.setVersion(s_storeStreamVersion);
+    ds.writeRawData(s_storeMagic, sizeof(s_storeMagic) - 1);
+    ds << s_storeFormatVersion << quint32(d->m_entries.size());
+
+    quint64 offset = 0;
+    for (auto it = d->m_entries.cbegin(), end = d->m_entries.cend(); it != end; ++it) {
+        ds << it.key() << it->affinityNames << offset << it->size;
+        offset += it->size;
+    }
+
+    QSaveFile out(d->m_file.fileName());
+    if (!out.open(QIODevice::WriteOnly)) {
+        qWarning() << Q_FUNC_INFO << "Failed to open" << out.fileName() << out.errorString();
+        return false;
+    }
+
+    out.write(index);
+    for (const Private::Entry &entry : qAsConst(d->m_entries))
+        out.write(d->data(entry));
+
+    // Unmapped before replacing the file, which some platforms refuse otherwise
+    const QMap<QString, Private::Entry> entries = d->m_entries;
+    d->close();
+    if (!out.commit()) {
+        qWarning() << Q_FUNC_INFO << "Failed to write" << out.fileName() << out.errorString();
+        // The old file is still there, so the offsets are still valid. Keep the changes, so they can be committed again
+        if (open())
+            d->m_entries = entries;
+        return false;
+    }
+
+    return open();
+}
@@ -0,0 +1,101 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KD_LAYOUTSTORE_H
+#define KD_LAYOUTSTORE_H
+
+/**
+ * @file
+ * @brief A single file holding many named layouts.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "docks_export.h"
+
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QByteArray;
+QT_END_NAMESPACE
+
+namespace KDDockWidgets {
+
+/**
+ * @brief A file with many named layouts, as saved by LayoutSaver
+ *
+ * The file starts with an index of the layout names and their affinities, followed by each
+ * layout's data. The file is memory-mapped, so listing the layouts only reads the index and
+ * loading a layout only reads that layout's data.
+ *
+ * Changes are kept in memory until commit(), which replaces the file atomically.
+ *
+ * @sa LayoutSaver::saveToStore(), LayoutSaver::restoreFromStore()
+ */
+class DOCKS_EXPORT LayoutStore
+{
+public:
+    ///@brief Constructor. Call open() to read an existing file.
+    explicit LayoutStore(const QString &filename);
+
+    ///@brief Destructor. Uncommitted changes are discarded
+    ~LayoutStore();
+
+    ///@brief Returns the file name passed in the constructor
+    QString filename() const;
+
+    /**
+     * @brief Maps the file and reads its index
+     * A file that doesn't exist yet isn't an error, the store is just empty.
+     * @return true on success
+     */
+    bool open();
+
+    ///@brief Returns the names of the stored layouts, sorted
+    QStringList layoutNames() const;
+
+    ///@brief Returns whether there's a layout called @p name
+    bool contains(const QString &name) const;
+
+    ///@brief Returns the affinity names of the windows saved in the layout called @p name
+    QStringList affinityNames(const QString &name) const;
+
+    ///@brief Returns the data of the layout called @p name, as passed to LayoutSaver::restoreLayout()
+    QByteArray layout(const QString &name) const;
+
+    ///@brief Adds the layout called @p name, or replaces it. @p data is what LayoutSaver::serializeLayout() returned.
+    void insert(const QString &name, const QByteArray &data, const QStringList &affinityNames = {});
+
+    ///@brief Removes the layout called @p name
+    void remove(const QString &name);
+
+    ///@brief Writes the changes to disk
+    ///@return true on success
+    bool commit();
+
+private:
+    Q_DISABLE_COPY(LayoutStore)
+    class Private;
+    Private *const d;
+};
+
+}
+
+#endif
@@ -94,6 +94,31 @@ MainWindow::~MainWindow()
     delete d;
 }
 
+void MainWindow::setInitialGeometry(QRect geometry)
+{
+    QWidget *win = window(); // window() as the MainWindow can be embedded
+    win->setGeometry(geometry);
+    if (win->isVisible())
+        return; // The resize events will resize the layout
+
+    // Hidden widgets don't get resize events, so lay out the drop area's ancestors now, outer-most first
+    QWidgetList ancestors;
+    for (QWidget *w = dropArea()->parentWidget(); w; w = w->parentWidget()) {
+        ancestors.prepend(w);
+        if (w == win)
+            break;
+    }
+
+    for (QWidget *w : qAsConst(ancestors)) {
+        if (QLayout *l = w->layout()) {
+            l->invalidate();
+            l->activate();
+        }
+    }
+
+    multiSplitterLayout()->setSize(dropArea()->size());
+}
+
 DropAreaWithCentralFrame *MainWindow::dropArea() const
 {
     return d->m_dropArea;
@@ -54,6 +54,12 @@ public:
     ///@brief Destructor
     ~MainWindow() override;
 
+    ///@brief Sets the geometry the window will first be shown with, and sizes the layout to it.
+    ///Call it before adding any dock widget and before showing, with the saved geometry or the
+    ///screen's available geometry for example. The layout is then computed once, at its final
+    ///size, instead of at a default size and again when the window is shown.
+    void setInitialGeometry(QRect geometry);
+
     ///@internal
     DropAreaWithCentralFrame *dropArea() const override;
 
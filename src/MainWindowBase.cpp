@@ -28,6 +28,7 @@
 
 #include "MainWindowBase.h"
 #include "DockRegistry_p.h"
+#include "Config.h"
 #include "DropArea_p.h"
 #include "Frame_p.h"
 #include "Utils_p.h"
@@ -43,6 +44,7 @@ class MainWindowBase::Private
 public:
     explicit Private(MainWindowOptions options)
         : m_options(options)
+        , m_layoutLocked(options & MainWindowOption_LockedLayout)
     {
     }
 
@@ -54,6 +56,7 @@ public:
     QString name;
     QString affinityName;
     const MainWindowOptions m_options;
+    bool m_layoutLocked;
 };
 
 MainWindowBase::MainWindowBase(const QString &uniqueName, KDDockWidgets::MainWindowOptions options,
@@ -103,6 +106,35 @@ void MainWindowBase::addDockWidget(DockWidgetBase *dw, Location location, DockWi
     dropArea()->addDockWidget(dw, location, relativeTo, option);
 }
 
+void MainWindowBase::addDockWidgets(const QVector<DockWidgetEntry> &entries, bool equally)
+{
+    // Only the item tree is touched while adding, separators and frames are updated once at the end
+    beginBatch();
+
+    for (const DockWidgetEntry &entry : entries) {
+        if (!entry.dockWidget) {
+            qWarning() << Q_FUNC_INFO << "Ignoring entry without dock widget";
+            continue;
+        }
+
+        if (entry.tabbedWith) {
+            if (entry.tabbedWith->window() != window()) {
+                qWarning() << Q_FUNC_INFO << "Tab target isn't in this main window" << entry.tabbedWith;
+                continue;
+            }
+
+            entry.tabbedWith->addDockWidgetAsTab(entry.dockWidget, entry.option);
+        } else {
+            addDockWidget(entry.dockWidget, entry.location, entry.relativeTo, entry.option);
+        }
+    }
+
+    if (equally)
+        layoutEqually();
+
+    commitBatch();
+}
+
 QString MainWindowBase::uniqueName() const
 {
     return d->name;
@@ -113,6 +145,20 @@ MainWindowOptions MainWindowBase::options() const
     return d->m_options;
 }
 
+void MainWindowBase::setLayoutLocked(bool locked)
+{
+    if (locked == d->m_layoutLocked)
+        return;
+
+    d->m_layoutLocked = locked;
+    DockRegistry::self()->updateLayoutLocked();
+}
+
+bool MainWindowBase::isLayoutLocked() const
+{
+    return d->m_layoutLocked || Config::self().isLayoutLocked();
+}
+
 MultiSplitterLayout *MainWindowBase::multiSplitterLayout() const
 {
     return dropArea()->multiSplitterLayout();
@@ -131,6 +177,7 @@ void MainWindowBase::setAffinityName(const QString &name)
     }
 
     d->affinityName = name;
+    DockRegistry::self()->onAffinityNameChanged(this, QString());
 }
 
 QString MainWindowBase::affinityName() const
@@ -148,6 +195,18 @@ void MainWindowBase::layoutParentContainerEqually(DockWidgetBase *dockWidget)
     dropArea()->layoutParentContainerEqually(dockWidget);
 }
 
+void MainWindowBase::beginBatch()
+{
+    multiSplitterLayout()->beginBatch();
+    TitleBarVisibilityBatch::begin();
+}
+
+void MainWindowBase::commitBatch()
+{
+    multiSplitterLayout()->commitBatch();
+    TitleBarVisibilityBatch::end();
+}
+
 void MainWindowBase::setUniqueName(const QString &uniqueName)
 {
     if (uniqueName.isEmpty())
@@ -174,7 +233,9 @@ bool MainWindowBase::deserialize(const LayoutSaver::MainWindow &mw)
         qWarning() << Q_FUNC_INFO << "Affinty name changed from" << d->affinityName
                    << "; to" << mw.affinityName;
 
+        const QString oldName = d->affinityName;
         d->affinityName = mw.affinityName;
+        DockRegistry::self()->onAffinityNameChanged(this, oldName);
     }
 
     return dropArea()->multiSplitterLayout()->deserialize(mw.multiSplitterLayout);
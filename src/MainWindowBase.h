@@ -81,6 +81,27 @@ public:
                        KDDockWidgets::Location location,
                        DockWidgetBase *relativeTo = nullptr, AddingOption option = {});
 
+    ///@brief Describes one dock widget to add with @ref addDockWidgets()
+    struct DockWidgetEntry {
+        DockWidgetBase *dockWidget = nullptr;
+        KDDockWidgets::Location location = KDDockWidgets::Location_None;
+        DockWidgetBase *relativeTo = nullptr; ///< Can be a dock widget added by a previous entry
+        DockWidgetBase *tabbedWith = nullptr; ///< If set, docks as a tab of this one. location and relativeTo are ignored
+        AddingOption option = {};
+    };
+
+    /**
+     * @brief Docks several dock widgets at once, as if @ref addDockWidget() was called for each entry,
+     * but laying out the main window only once, at the end.
+     *
+     * Entries are added in order, so an entry can be relative to, or tabbed with, a dock widget of
+     * a previous entry. Useful for building a default layout on startup.
+     *
+     * @param entries the dock widgets to add
+     * @param equally if true, calls @ref layoutEqually() at the end, before the frames are laid out
+     */
+    void addDockWidgets(const QVector<DockWidgetEntry> &entries, bool equally = false);
+
     /**
      * @brief Returns the unique name that was passed via constructor.
      *        Used internally by the save/restore mechanism.
@@ -92,6 +113,22 @@ public:
     /// @brief Returns the main window options that were passed via constructor.
     MainWindowOptions options() const;
 
+    /**
+     * @brief Locks or unlocks the layout of this main window and of the floating windows parented to it.
+     *
+     * A locked layout can't be changed with the mouse: its title bars and tab bars can't be dragged,
+     * it accepts no drops, and its floating windows have no resize handles. None of the drag and
+     * drop infrastructure is created for it, no drop indicators and no event filters.
+     * The dock widgets can still be added and removed programmatically, and restoring still works.
+     *
+     * Can be changed at any time, for example to let the user edit a kiosk layout.
+     * Starts locked with MainWindowOption_LockedLayout. @sa Config::setLayoutLocked()
+     */
+    void setLayoutLocked(bool locked);
+
+    ///@brief Returns whether the layout is locked, by setLayoutLocked() or by Config::setLayoutLocked()
+    bool isLayoutLocked() const;
+
     ///@internal
     ///@brief returns the drop area.
     virtual DropAreaWithCentralFrame *dropArea() const = 0;
@@ -136,6 +173,16 @@ public:
     /// sub-tree.
     void layoutParentContainerEqually(DockWidgetBase *dockWidget);
 
+    /// @brief Starts a batch of docking operations
+    ///
+    /// Dock widgets added with @ref addDockWidget() until the matching @ref commitBatch() are
+    /// only laid out once, when the batch is committed. Useful when adding many dock widgets at
+    /// startup. Calls can be nested.
+    void beginBatch();
+
+    /// @brief Ends the batch started by @ref beginBatch()
+    void commitBatch();
+
 protected:
     void setUniqueName(const QString &uniqueName);
 
@@ -0,0 +1,101 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief A dock widget whose content runs in a separate process.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_PROCESSDOCKWIDGET_H
+#define KD_PROCESSDOCKWIDGET_H
+
+#include "DockWidget.h"
+
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QProcess;
+class QWindow;
+QT_END_NAMESPACE
+
+namespace KDDockWidgets {
+
+/**
+ * @brief A dock widget whose content is the window of another process.
+ *
+ * For heavy or unreliable panels. The program is started the first time the dock widget is shown.
+ * It creates a top-level window and passes it to announceWindow(), then the window is embedded with
+ * QWindow::fromWinId() and QWidget::createWindowContainer(). The window system composites it and
+ * delivers its input directly, so a busy or hung panel only freezes its own area, and docking,
+ * tabbing, LayoutSaver and the placeholders work as with any DockWidget.
+ *
+ * If the process exits, a message is shown instead, until restart() is called.
+ *
+ * Requires a platform that can embed foreign windows, like Windows, macOS or X11, not Wayland.
+ */
+class DOCKS_EXPORT ProcessDockWidget : public DockWidget
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief constructs a new ProcessDockWidget
+     * @param uniqueName See DockWidget::DockWidget()
+     * @param program The program to start, which calls announceWindow()
+     * @param arguments The program's command line arguments
+     * @param options See DockWidget::DockWidget()
+     */
+    explicit ProcessDockWidget(const QString &uniqueName, const QString &program,
+                               const QStringList &arguments = {}, Options options = {});
+
+    ///@brief destructor. Terminates the process.
+    ~ProcessDockWidget() override;
+
+    ///@brief Returns the process, which is running or starting while the dock widget is shown
+    QProcess *process() const;
+
+    ///@brief Returns whether the process's window is embedded
+    bool isEmbedded() const;
+
+    ///@brief Starts the process again, if it exited. Otherwise it's started when shown.
+    void restart();
+
+    /**
+     * @brief To be called by the program running in the process, to have @p window embedded.
+     *
+     * Writes its native window id to stdout, where the ProcessDockWidget reads it, so the program's
+     * stdout is reserved for this. Call it once the native window is created, right before
+     * showing it.
+     */
+    static void announceWindow(QWindow *window);
+
+Q_SIGNALS:
+    ///@brief emitted once the process's window is embedded
+    void embedded();
+
+private:
+    class Private;
+    Private *const d;
+};
+
+}
+
+#endif
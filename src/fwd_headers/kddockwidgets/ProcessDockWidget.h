@@ -0,0 +1 @@
+#include "../../ProcessDockWidget.h"
@@ -1,12 +1,21 @@
 #include "LayoutSaver.h"
+#include "LayoutSaver_p.h"
 #include "Config.h"
 #include "DockWidget.h"
 #include "MainWindow.h"
+#include "Item_p.h"
 
 #include <QApplication>
 #include <QDebug>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
 #include <QString>
+#include <QTextStream>
+#include <QThread>
 
+#include <functional>
 
 using namespace KDDockWidgets;
 
@@ -27,14 +36,238 @@ static bool lint(const QString &filename)
     return restorer.restoreFromFile(filename);
 }
 
+static bool isVisibleItem(const QVariantMap &map)
+{
+    if (!map.value(QStringLiteral("isContainer")).toBool())
+        return map.value(QStringLiteral("isVisible")).toBool();
+
+    const QVariantList children = map.value(QStringLiteral("children")).toList();
+    for (const QVariant &child : children) {
+        if (isVisibleItem(child.toMap()))
+            return true;
+    }
+
+    return false;
+}
+
+///@brief Checks the saved geometries of @p map's item tree: visible items respect their min size
+///and each container's visible children fill it, with the same separator gap between them
+static bool checkSavedItem(const QVariantMap &map, const QHash<QString, LayoutSaver::Frame> &frames)
+{
+    Layouting::SizingInfo sizing;
+    sizing.fromVariantMap(map.value(QStringLiteral("sizingInfo")).toMap());
+    const QString name = map.value(QStringLiteral("objectName")).toString();
+
+    if (!map.value(QStringLiteral("isContainer")).toBool()) {
+        if (!isVisibleItem(map))
+            return true;
+
+        if (!frames.contains(map.value(QStringLiteral("guestId")).toString())) {
+            qWarning() << "Visible item without frame" << name;
+            return false;
+        }
+
+        if (sizing.geometry.width() < sizing.minSize.width() || sizing.geometry.height() < sizing.minSize.height()) {
+            qWarning() << "Item smaller than its min size" << name << sizing.geometry << sizing.minSize;
+            return false;
+        }
+
+        return true;
+    }
+
+    const auto orientation = Qt::Orientation(map.value(QStringLiteral("orientation")).toInt());
+    const int length = Layouting::length(sizing.geometry.size(), orientation);
+    const int otherLength = Layouting::length(sizing.geometry.size(), Layouting::oppositeOrientation(orientation));
+    int expectedPos = 0;
+    int separatorGap = -1; // The separator thickness used when saving isn't necessarily ours
+    bool hasVisibleChildren = false;
+
+    const QVariantList children = map.value(QStringLiteral("children")).toList();
+    for (const QVariant &childV : children) {
+        const QVariantMap childMap = childV.toMap();
+        if (!checkSavedItem(childMap, frames))
+            return false;
+
+        if (!isVisibleItem(childMap))
+            continue;
+
+        Layouting::SizingInfo child;
+        child.fromVariantMap(childMap.value(QStringLiteral("sizingInfo")).toMap());
+        const int pos = Layouting::pos(child.geometry.topLeft(), orientation);
+        if (hasVisibleChildren && separatorGap == -1)
+            separatorGap = pos - expectedPos;
+
+        if (pos != expectedPos + qMax(0, separatorGap) ||
+            Layouting::length(child.geometry.size(), Layouting::oppositeOrientation(orientation)) != otherLength) {
+            qWarning() << "Unexpected geometry for child of" << name << child.geometry
+                       << "; expected pos=" << expectedPos + qMax(0, separatorGap);
+            return false;
+        }
+
+        expectedPos = pos + child.length(orientation);
+        hasVisibleChildren = true;
+    }
+
+    if (hasVisibleChildren && expectedPos != length) {
+        qWarning() << "Children don't fill container" << name << expectedPos << length;
+        return false;
+    }
+
+    return true;
+}
+
+static bool lintMultiSplitter(const LayoutSaver::MultiSplitterLayout &l, const QString &windowName)
+{
+    if (!checkSavedItem(l.layout, l.frames)) {
+        qWarning() << "Invalid item tree in" << windowName;
+        return false;
+    }
+
+    // Load it into the layouting engine too, without any host widget
+    Layouting::ItemContainer root(nullptr);
+    root.fillFromVariantMap(l.layout, {});
+    if (root.minSize().width() > root.width() || root.minSize().height() > root.height()) {
+        qWarning() << "Layout doesn't fit" << windowName << root.size() << "; min=" << root.minSize();
+        return false;
+    }
+
+    return true;
+}
+
+///@brief Structural validation of the layout in @p filename, without creating any widget
+static bool lintHeadless(const QString &filename)
+{
+    QFile f(filename);
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open" << filename << f.errorString();
+        return false;
+    }
+
+    QByteArray data = f.readAll();
+    if (LayoutSaver::Layout::isCompressed(data))
+        data = LayoutSaver::Layout::uncompressed(data);
+
+    LayoutSaver::Layout layout;
+    const bool parsed = LayoutSaver::Layout::isBinary(data) ? layout.fromBinary(data)
+                                                            : layout.fromJson(data);
+    if (!parsed) {
+        qWarning() << "Failed to parse" << filename;
+        return false;
+    }
+
+    if (!layout.isValid()) {
+        qWarning() << "Invalid layout" << filename;
+        return false;
+    }
+
+    for (const LayoutSaver::MainWindow &mw : qAsConst(layout.mainWindows)) {
+        if (!lintMultiSplitter(mw.multiSplitterLayout, mw.uniqueName))
+            return false;
+    }
+
+    for (int i = 0; i < layout.floatingWindows.size(); ++i) {
+        if (!lintMultiSplitter(layout.floatingWindows.at(i).multiSplitterLayout, QStringLiteral("floating window %1").arg(i)))
+            return false;
+    }
+
+    return true;
+}
+
+///@brief Lints every file in @p paths, descending into directories, one headless process per core
+static int lintBatch(const QStringList &paths)
+{
+    QStringList files;
+    for (const QString &path : paths) {
+        if (QFileInfo(path).isDir()) {
+            QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext())
+                files << it.next();
+        } else {
+            files << path;
+        }
+    }
+
+    files.sort();
+    if (files.isEmpty()) {
+        qDebug() << "No layouts found in" << paths;
+        return 1;
+    }
+
+    // Separate processes, as the parsing code shares state between layouts
+    const int maxRunning = qMax(1, QThread::idealThreadCount());
+    int next = 0;
+    int running = 0;
+    int numFailed = 0;
+    QTextStream out(stdout);
+
+    std::function<void()> startNext;
+    auto onFinished = [&] (QProcess *process, const QString &file, bool ok) {
+        running--;
+        if (ok) {
+            out << "OK " << file << "\n";
+        } else {
+            numFailed++;
+            const QList<QByteArray> lines = process->readAllStandardError().trimmed().split('\n');
+            const QString reason = lines.constLast().isEmpty() ? QStringLiteral("failed")
+                                                               : QString::fromLocal8Bit(lines.constLast());
+            out << "FAIL " << file << ": " << reason << "\n";
+        }
+
+        out.flush();
+        process->deleteLater();
+        startNext();
+    };
+
+    startNext = [&] {
+        while (running < maxRunning && next < files.size()) {
+            const QString file = files.at(next++);
+            auto process = new QProcess();
+            QObject::connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                             [&, process, file] (int exitCode, QProcess::ExitStatus status) {
+                onFinished(process, file, status == QProcess::NormalExit && exitCode == 0);
+            });
+            QObject::connect(process, &QProcess::errorOccurred, [&, process, file] (QProcess::ProcessError error) {
+                if (error == QProcess::FailedToStart)
+                    onFinished(process, file, false);
+            });
+
+            running++;
+            process->start(QCoreApplication::applicationFilePath(), { QStringLiteral("--headless"), file });
+        }
+
+        if (running == 0)
+            qApp->quit();
+    };
+
+    startNext();
+    if (running > 0)
+        qApp->exec();
+
+    out << (files.size() - numFailed) << " of " << files.size() << " layouts are valid\n";
+    return numFailed == 0 ? 0 : 2;
+}
+
 int main(int argc, char *argv[])
 {
+    const bool headless = argc > 1 && (qstrcmp(argv[1], "--headless") == 0 || qstrcmp(argv[1], "--batch") == 0);
+    if (headless && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
     QApplication app(argc, argv);
+    const QStringList args = app.arguments();
+
+    if (args.size() > 2 && args.at(1) == QLatin1String("--batch"))
+        return lintBatch(args.mid(2));
+
+    if (args.size() == 3 && args.at(1) == QLatin1String("--headless"))
+        return lintHeadless(args.at(2)) ? 0 : 2;
 
-    if (app.arguments().size() != 2) {
+    if (args.size() != 2) {
         qDebug() << "Usage: kddockwidgets_linter <layout json file>";
+        qDebug() << "       kddockwidgets_linter --headless <layout file>";
+        qDebug() << "       kddockwidgets_linter --batch <layout files or directories>...";
         return 1;
     }
 
-    return lint(app.arguments().at(1)) ? 0 : 2;
+    return lint(args.at(1)) ? 0 : 2;
 }
@@ -27,9 +27,11 @@
 
 #include "DebugWindow_p.h"
 #include "ObjectViewer_p.h"
+#include "PerformancePanel_p.h"
 #include "DockRegistry_p.h"
 #include "FloatingWindow_p.h"
 #include "DropArea_p.h"
+#include "DragController_p.h"
 #include "MainWindow.h"
 #include "LayoutSaver.h"
 
@@ -38,6 +40,7 @@
 #include <QPushButton>
 #include <QLineEdit>
 #include <QSpinBox>
+#include <QTabWidget>
 #include <QMessageBox>
 #include <QApplication>
 #include <QMouseEvent>
@@ -86,7 +89,15 @@ DebugWindow::DebugWindow(QWidget *parent)
     , m_objectViewer(this)
 {
     // qApp->installNativeEventFilter(new DebugAppEventFilter());
-    auto layout = new QVBoxLayout(this);
+    auto tabWidget = new QTabWidget(this);
+    auto outerLayout = new QVBoxLayout(this);
+    outerLayout->addWidget(tabWidget);
+
+    auto generalTab = new QWidget(tabWidget);
+    tabWidget->addTab(generalTab, QStringLiteral("General"));
+    tabWidget->addTab(new PerformancePanel(tabWidget), QStringLiteral("Performance"));
+
+    auto layout = new QVBoxLayout(generalTab);
     layout->addWidget(&m_objectViewer);
 
     auto button = new QPushButton(this);
@@ -139,11 +150,12 @@ DebugWindow::DebugWindow(QWidget *parent)
     button->setText(QStringLiteral("Float all visible docks"));
     layout->addWidget(button);
     connect(button, &QPushButton::clicked, this, [] {
+        DockWidgetBase::List docks;
         for (auto dw : DockRegistry::self()->dockwidgets()) {
-            if (dw->isVisible() && !dw->isFloating()) {
-                dw->setFloating(true);
-            }
+            if (dw->isVisible() && !dw->isFloating())
+                docks.push_back(dw);
         }
+        DockWidgetBase::setDockWidgetsFloating(docks, true);
     });
 
     button = new QPushButton(this);
@@ -265,6 +277,22 @@ DebugWindow::DebugWindow(QWidget *parent)
         });
     });
 
+    button = new QPushButton(this);
+    button->setText(QStringLiteral("Toggle drag timing"));
+    layout->addWidget(button);
+    connect(button, &QPushButton::clicked, this, [] {
+        DragController *dc = DragController::instance();
+        dc->setTimingEnabled(!dc->timingEnabled());
+        qDebug() << "Drag timing enabled:" << dc->timingEnabled();
+    });
+
+    button = new QPushButton(this);
+    button->setText(QStringLiteral("Dump last drag timings"));
+    layout->addWidget(button);
+    connect(button, &QPushButton::clicked, this, [] {
+        DragController::instance()->dumpLastDragTimings();
+    });
+
 #ifdef Q_OS_WIN
     button = new QPushButton(this);
     button->setText(QStringLiteral("Dump native windows"));
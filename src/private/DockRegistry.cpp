@@ -23,22 +23,125 @@
 #include "Logging_p.h"
 #include "DebugWindow_p.h"
 #include "Position_p.h"
+#include "StartupProfiler_p.h"
+#include "FloatingWindowPool_p.h"
+#include "FramePool_p.h"
+#include "Frame_p.h"
+#include "TitleBar_p.h"
+#include "TabWidget_p.h"
+#include "DropArea_p.h"
+#include "DropAreaWithCentralFrame_p.h"
+#include "DropIndicatorOverlayInterface_p.h"
+#include "Config.h"
+#include "LayoutSaver.h"
 #include "multisplitter/MultiSplitterLayout_p.h"
 #include "multisplitter/MultiSplitter_p.h"
+#include "multisplitter/Item_p.h"
+#include "multisplitter/Separator_p.h"
+#include "multisplitter/Tracing_p.h"
 #include "quick/QmlTypes.h"
 
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+# include "indicators/ClassicIndicators_p.h"
+#endif
+
+#include <QAction>
 #include <QPointer>
 #include <QDebug>
 #include <QApplication>
+#include <QScopedValueRollback>
+#include <QScreen>
+#include <QThread>
 #include <QWindow>
 
+#include <algorithm>
+#include <atomic>
+
 using namespace KDDockWidgets;
 
+// Not a member, so generations keep increasing even if the registry is recreated
+static quint64 s_layoutGeneration = 0;
+
+// Read from any thread, so only accessed with std::atomic_load() and std::atomic_store()
+static std::shared_ptr<const DockingState> s_dockingState;
+// Snapshots are only taken once someone asked for one, they cost a walk over every frame
+static std::atomic<bool> s_dockingStateRequested(false);
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+///@brief Sends QEvent::Quit again, with @p isProcessing set, so the windows it closes know why
+class QuitEventFilter : public QObject /// clazy:exclude=missing-qobject-macro
+{
+public:
+    QuitEventFilter(bool &isProcessing, QObject *parent)
+        : QObject(parent)
+        , m_isProcessing(isProcessing)
+    {
+        qApp->installEventFilter(this);
+    }
+
+    bool eventFilter(QObject *, QEvent *event) override
+    {
+        if (event->type() != QEvent::Quit || m_isProcessing)
+            return false;
+
+        QScopedValueRollback<bool> processing(m_isProcessing, true);
+        qApp->sendEvent(qApp, event);
+        return true;
+    }
+
+private:
+    bool &m_isProcessing;
+};
+#endif
+
+template <typename T>
+static void removeFromPartition(QHash<QString, QVector<T*>> &partitions, const QString &affinityName, T *obj)
+{
+    auto it = partitions.find(affinityName);
+    if (it != partitions.end()) {
+        it->removeOne(obj);
+        if (it->isEmpty())
+            partitions.erase(it);
+    }
+}
+
 DockRegistry::DockRegistry(QObject *parent)
     : QObject(parent)
 {
+    StartupProfiler::startIfRequested();
+
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this] {
+        if (Config::self().flags() & Config::Flag_FastShutdown) {
+            // The last chance to save a complete layout
+            LayoutSaver::flushAutoSave();
+            beginShutdown();
+        }
+    });
+
+    m_deferredResizesTimer.setSingleShot(true);
+    m_deferredResizesTimer.setInterval(0);
+    connect(&m_deferredResizesTimer, &QTimer::timeout, this, &DockRegistry::applyDeferredResizes);
+
+    m_deleteScheduledTimer.setSingleShot(true);
+    m_deleteScheduledTimer.setInterval(0);
+    connect(&m_deleteScheduledTimer, &QTimer::timeout, this, &DockRegistry::deleteScheduled);
+
+    // Coalesces the many layoutChanged() of a single operation into one snapshot
+    m_publishDockingStateTimer.setSingleShot(true);
+    m_publishDockingStateTimer.setInterval(0);
+    connect(&m_publishDockingStateTimer, &QTimer::timeout, this, &DockRegistry::publishDockingState);
+
 #ifdef KDDOCKWIDGETS_QTWIDGETS
-    qApp->installEventFilter(this);
+    // A scale factor change doesn't always come with a ScreenChangeInternal event, see eventFilter()
+    auto watchScreen = [this] (QScreen *screen) {
+        connect(screen, &QScreen::logicalDotsPerInchChanged, this, [this, screen] {
+            onScreenScaleChanged(screen);
+        });
+    };
+    const QList<QScreen*> screens = qApp->screens();
+    for (QScreen *screen : screens)
+        watchScreen(screen);
+    connect(qApp, &QGuiApplication::screenAdded, this, watchScreen);
 
 # ifdef DOCKS_DEVELOPER_MODE
     if (qEnvironmentVariableIntValue("KDDOCKWIDGETS_SHOW_DEBUG_WINDOW") == 1) {
@@ -54,6 +157,285 @@ DockRegistry::DockRegistry(QObject *parent)
 
 DockRegistry::~DockRegistry()
 {
+    // publishDockingState() doesn't run anymore once shutting down. Readers mustn't keep seeing
+    // the windows that are gone.
+    auto state = new DockingState();
+    state->layoutGeneration = ++s_layoutGeneration;
+    std::atomic_store(&s_dockingState, std::shared_ptr<const DockingState>(state));
+}
+
+void DockRegistry::onLayoutChanged(const QObject *window)
+{
+    if (m_isShuttingDown)
+        return;
+
+    if (window)
+        m_layoutChanges.insert(window, ++s_layoutGeneration);
+    else
+        m_lastGlobalLayoutChange = ++s_layoutGeneration;
+
+    if (s_dockingStateRequested.load(std::memory_order_relaxed))
+        m_publishDockingStateTimer.start();
+    Q_EMIT layoutChanged();
+}
+
+quint64 DockRegistry::layoutGeneration(const QObject *window) const
+{
+    return qMax(m_lastGlobalLayoutChange, m_layoutChanges.value(window));
+}
+
+quint64 DockRegistry::lastLayoutGeneration() const
+{
+    return s_layoutGeneration;
+}
+
+std::shared_ptr<const DockingState> DockRegistry::dockingState()
+{
+    if (!s_dockingStateRequested.exchange(true)) {
+        // From the GUI thread the first snapshot can be scheduled right away. Other threads get
+        // theirs with the next layout change.
+        QCoreApplication *app = QCoreApplication::instance();
+        if (app && QThread::currentThread() == app->thread())
+            self()->m_publishDockingStateTimer.start();
+    }
+
+    std::shared_ptr<const DockingState> state = std::atomic_load(&s_dockingState);
+    return state ? state : std::shared_ptr<const DockingState>(new DockingState());
+}
+
+void DockRegistry::publishDockingState()
+{
+    if (m_isShuttingDown)
+        return;
+
+    KDDW_TRACE_SCOPE("layout", "DockRegistry::publishDockingState");
+
+    auto state = new DockingState();
+    state->layoutGeneration = s_layoutGeneration;
+    state->frames.reserve(m_frames.size());
+    QHash<const Frame*, int> frameIndexes;
+    frameIndexes.reserve(m_frames.size());
+    for (Frame *frame : qAsConst(m_frames)) {
+        DockingState::FrameState frameState;
+        frameState.geometry = QRect(frame->mapToGlobal(QPoint(0, 0)), frame->size());
+        frameState.currentTabIndex = frame->currentTabIndex();
+        frameState.isFloating = frame->isFloating();
+        const QVector<DockWidgetBase*> dockWidgets = frame->dockWidgets();
+        frameState.dockWidgets.reserve(dockWidgets.size());
+        for (DockWidgetBase *dw : dockWidgets)
+            frameState.dockWidgets.append(dw->uniqueName());
+
+        frameIndexes.insert(frame, state->frames.size());
+        state->frames.append(frameState);
+    }
+
+    state->dockWidgets.reserve(m_dockWidgets.size());
+    for (DockWidgetBase *dw : qAsConst(m_dockWidgets)) {
+        DockingState::DockWidgetState dockState;
+        dockState.uniqueName = dw->uniqueName();
+        dockState.title = dw->title();
+        dockState.isOpen = dw->isOpen();
+        dockState.isFloating = dw->isFloating();
+        Frame *frame = dw->frame();
+        const int frameIndex = frame ? frameIndexes.value(frame, -1) : -1;
+        if (dockState.isOpen && frameIndex != -1) {
+            const DockingState::FrameState &frameState = state->frames.at(frameIndex);
+            dockState.frameIndex = frameIndex;
+            dockState.tabIndex = frameState.dockWidgets.indexOf(dockState.uniqueName);
+            dockState.geometry = frameState.geometry;
+        }
+        state->dockWidgets.append(dockState);
+    }
+
+    std::atomic_store(&s_dockingState, std::shared_ptr<const DockingState>(state));
+}
+
+// Rough sizes of what Qt allocates behind each object, on 64-bit. They only need to be good enough
+// for comparing layouts and for spotting leaks, not exact.
+static const quint64 s_objectPrivateBytes = 160; // QObjectPrivate, connection lists and children list
+static const quint64 s_widgetPrivateBytes = 700; // QWidgetPrivate, QWidgetData and the extra data
+static const quint64 s_actionPrivateBytes = 250; // QActionPrivate
+static const quint64 s_nativeWindowBytes = 2000; // QWindow, QPlatformWindow and the window system's share
+
+static quint64 estimatedBytes(const QObject *object, quint64 ownSize)
+{
+    quint64 bytes = ownSize + s_objectPrivateBytes;
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (object->isWidgetType()) {
+        auto widget = static_cast<const QWidget*>(object);
+        bytes += s_widgetPrivateBytes;
+        if (widget->internalWinId())
+            bytes += s_nativeWindowBytes;
+
+        if (widget->isWindow() && widget->isVisible()) {
+            // The backing store, 32 bits per pixel
+            const qreal dpr = widget->devicePixelRatioF();
+            bytes += quint64(widget->width() * dpr) * quint64(widget->height() * dpr) * 4;
+        }
+    }
+#endif
+    return bytes;
+}
+
+///@brief Returns whether @p object is reported in its own category instead of with its parent
+static bool isCountedSeparately(const QObject *object)
+{
+    return qobject_cast<const DockWidgetBase*>(object) || qobject_cast<const Frame*>(object) ||
+           qobject_cast<const TitleBar*>(object) || qobject_cast<const FloatingWindow*>(object) ||
+           qobject_cast<const DropIndicatorOverlayInterface*>(object) ||
+           qobject_cast<const Layouting::Separator*>(object) || qobject_cast<const Layouting::Item*>(object);
+}
+
+static quint64 descendantBytes(const QObject *object, const QObject *except)
+{
+    quint64 bytes = 0;
+    for (const QObject *child : object->children()) {
+        if (child == except || isCountedSeparately(child))
+            continue;
+
+        bytes += estimatedBytes(child, child->isWidgetType() ? sizeof(QWidget) : sizeof(QObject));
+        bytes += descendantBytes(child, except);
+    }
+
+    return bytes;
+}
+
+///@brief Adds @p object to @p category, with the children that aren't counted elsewhere, skipping @p except
+static void addObject(MemoryCategory &category, const QObject *object, quint64 ownSize,
+                      const QObject *except = nullptr)
+{
+    if (!object)
+        return;
+
+    category.count++;
+    category.bytes += estimatedBytes(object, ownSize) + descendantBytes(object, except);
+}
+
+static void addItems_recursive(MemoryUsage &usage, const Layouting::Item *item)
+{
+    auto container = qobject_cast<const Layouting::ItemContainer*>(item);
+    addObject(usage.items, item, container ? sizeof(Layouting::ItemContainer) : sizeof(Layouting::Item));
+
+    if (item->isGuestFrozen()) {
+        // The snapshot shown while resizing
+        usage.pixmaps.count++;
+        usage.pixmaps.bytes += quint64(item->width()) * quint64(item->height()) * 4;
+    }
+
+    if (container) {
+        for (const Layouting::Item *child : container->childItems())
+            addItems_recursive(usage, child);
+    }
+}
+
+MemoryUsage DockRegistry::memoryUsage(const MainWindowBase *mainWindow) const
+{
+    KDDW_TRACE_SCOPE("layout", "DockRegistry::memoryUsage");
+
+    MemoryUsage usage;
+
+    // What's in scope: everything, or mainWindow and the floating windows parented to it
+    QVector<FloatingWindow*> floatingWindows;
+    QVector<MultiSplitterLayout*> layouts;
+    QVector<DropArea*> dropAreas;
+    Frame::List frames;
+    if (mainWindow) {
+        layouts.push_back(mainWindow->multiSplitterLayout());
+        dropAreas.push_back(mainWindow->dropArea());
+        for (FloatingWindow *fw : qAsConst(m_nestedWindows)) {
+            if (fw->parentWidget() == mainWindow) {
+                floatingWindows.push_back(fw);
+                layouts.push_back(fw->multiSplitterLayout());
+                dropAreas.push_back(fw->dropArea());
+            }
+        }
+
+        for (MultiSplitterLayout *layout : qAsConst(layouts))
+            frames += layout->frames();
+    } else {
+        layouts = m_layouts;
+        for (MainWindowBase *mw : qAsConst(m_mainWindows))
+            dropAreas.push_back(mw->dropArea());
+
+        const QVector<FloatingWindow*> pooledWindows = FloatingWindowPool::self()->windows();
+        usage.pooledFloatingWindows = quint64(pooledWindows.size());
+        floatingWindows = m_nestedWindows + pooledWindows;
+        for (FloatingWindow *fw : qAsConst(floatingWindows))
+            dropAreas.push_back(fw->dropArea());
+
+        const QVector<Frame*> pooledFrames = FramePool::self()->frames();
+        usage.pooledFrames = quint64(pooledFrames.size());
+        frames = m_frames + pooledFrames.toList();
+    }
+
+    QSet<const Frame*> framesInScope;
+    for (Frame *frame : qAsConst(frames)) {
+        framesInScope.insert(frame);
+        QObject *tabWidget = frame->tabWidget()->asWidget();
+        addObject(usage.frames, frame, sizeof(Frame), tabWidget);
+        addObject(usage.tabWidgets, tabWidget, sizeof(QWidgetOrQuick) + sizeof(TabWidget));
+        addObject(usage.titleBars, frame->titleBar(), sizeof(TitleBar));
+    }
+
+    for (FloatingWindow *fw : qAsConst(floatingWindows)) {
+        addObject(usage.floatingWindows, fw, sizeof(FloatingWindow));
+        addObject(usage.titleBars, fw->titleBar(), sizeof(TitleBar));
+    }
+
+    QSet<const Layouting::ItemContainer*> rootsInScope;
+    for (MultiSplitterLayout *layout : qAsConst(layouts)) {
+        Layouting::ItemContainer *root = layout->rootItem();
+        rootsInScope.insert(root);
+        addItems_recursive(usage, root);
+        const QVector<Layouting::Separator*> separators = root->separators_recursive();
+        for (const Layouting::Separator *separator : separators)
+            addObject(usage.separators, separator, sizeof(Layouting::Separator));
+    }
+
+    QSet<const QObject*> indicatorObjects; // The overlays share their window in some styles
+    for (DropArea *dropArea : qAsConst(dropAreas)) {
+        DropIndicatorOverlayInterface *overlay = dropArea ? dropArea->dropIndicatorOverlay() : nullptr;
+        if (!overlay)
+            continue;
+
+        const QObject *window = overlay->indicatorWindow();
+        if (!indicatorObjects.contains(overlay)) {
+            indicatorObjects.insert(overlay);
+            addObject(usage.indicators, overlay, sizeof(DropIndicatorOverlayInterface), window);
+        }
+
+        if (window && !indicatorObjects.contains(window)) {
+            indicatorObjects.insert(window);
+            addObject(usage.indicators, window, sizeof(QWidgetOrQuick));
+        }
+    }
+
+    for (DockWidgetBase *dw : qAsConst(m_dockWidgets)) {
+        for (const std::unique_ptr<ItemRef> &ref : dw->lastPositions().placeholders()) {
+            if (!ref->itemDestroyed && (!mainWindow || rootsInScope.contains(ref->item->root()))) {
+                usage.placeholders.count++;
+                usage.placeholders.bytes += sizeof(ItemRef) + sizeof(std::unique_ptr<ItemRef>);
+            }
+        }
+
+        if (!mainWindow || framesInScope.contains(dw->frame())) {
+            // Only the ones that exist, measuring shouldn't create the lazy actions
+            const QAction *actions[] = { dw->existingToggleAction(), dw->existingFloatAction() };
+            for (const QAction *action : actions)
+                addObject(usage.actions, action, sizeof(QAction) + s_actionPrivateBytes);
+        }
+    }
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (!mainWindow) {
+        // Shared by every main window, so only in the global numbers
+        const QPair<int, quint64> cached = ClassicIndicators::cachedPixmaps();
+        usage.pixmaps.count += quint64(cached.first);
+        usage.pixmaps.bytes += cached.second;
+    }
+#endif
+
+    return usage;
 }
 
 void DockRegistry::maybeDelete()
@@ -81,6 +463,52 @@ bool DockRegistry::isProcessingAppQuitEvent() const
     return m_isProcessingAppQuitEvent;
 }
 
+void DockRegistry::setFrameNonClosable(Frame *frame, bool nonClosable)
+{
+    if (nonClosable) {
+        m_nonClosableFrames.insert(frame);
+    } else {
+        m_nonClosableFrames.remove(frame);
+    }
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (m_nonClosableFrames.isEmpty()) {
+        delete m_quitEventFilter;
+        m_quitEventFilter = nullptr;
+    } else if (!m_quitEventFilter) {
+        m_quitEventFilter = new QuitEventFilter(m_isProcessingAppQuitEvent, this);
+    }
+#endif
+}
+
+void DockRegistry::beginShutdown()
+{
+    if (m_isShuttingDown)
+        return;
+
+    m_isShuttingDown = true;
+    for (auto layout : qAsConst(m_layouts))
+        layout->rootItem()->beginTeardown();
+}
+
+void DockRegistry::updateLayoutLocked()
+{
+    for (MainWindowBase *mw : qAsConst(m_mainWindows))
+        mw->dropArea()->setLayoutLocked(mw->isLayoutLocked());
+
+    // The pooled ones too, they would come back unlocked
+    const QVector<FloatingWindow*> floatingWindows = m_nestedWindows + FloatingWindowPool::self()->windows();
+    for (FloatingWindow *fw : floatingWindows) {
+        auto mw = qobject_cast<MainWindowBase*>(fw->parentWidget());
+        fw->setLayoutLocked(mw ? mw->isLayoutLocked() : Config::self().isLayoutLocked());
+    }
+}
+
+bool DockRegistry::isShuttingDown() const
+{
+    return m_isShuttingDown;
+}
+
 MultiSplitterLayout *DockRegistry::layoutForItem(const Layouting::Item *item) const
 {
     if (auto ms = qobject_cast<MultiSplitter*>(item->hostWidget()))
@@ -91,8 +519,10 @@ MultiSplitterLayout *DockRegistry::layoutForItem(const Layouting::Item *item) co
 
 bool DockRegistry::itemIsInMainWindow(const Layouting::Item *item) const
 {
-    if (auto layout = layoutForItem(item))
-        return layout->multiSplitter()->isInMainWindow();
+    // Re-hosting an item, like when docking a floating window, changes its host widget, so this
+    // is always up to date, while the host caches what kind of window it's in
+    if (auto ms = qobject_cast<MultiSplitter*>(item->hostWidget()))
+        return ms->isInMainWindow();
 
     return false;
 }
@@ -114,14 +544,60 @@ void DockRegistry::registerDockWidget(DockWidgetBase *dock)
         qWarning() << Q_FUNC_INFO << "DockWidget" << dock << " doesn't have an ID";
     } else if (auto other = dockByName(dock->uniqueName())) {
         qWarning() << Q_FUNC_INFO << "Another DockWidget" << other << "with name" << dock->uniqueName() << " already exists." << dock;
+    } else {
+        m_dockWidgetsByName.insert(dock->uniqueName(), dock);
     }
 
     m_dockWidgets << dock;
+    m_dockWidgetsByAffinity[dock->affinityName()].push_back(dock);
+    indexForSearch(dock);
+    updateClosedState(dock);
+    onLayoutChanged(nullptr);
+
+    const QWidget *previousGuest = dock->widget();
+    if (previousGuest)
+        m_dockWidgetsByGuest.insert(previousGuest, dock);
+
+    // The guest widget is usually set after construction
+    connect(dock, &DockWidgetBase::widgetChanged, this, [this, dock, previousGuest] (QWidget *guest) mutable {
+        // The previous guest might have been deleted, see DockWidgetBase::setWidgetFactory(). Its
+        // pointer is only used as a key.
+        auto it = m_dockWidgetsByGuest.find(previousGuest);
+        if (it != m_dockWidgetsByGuest.end() && it.value() == dock)
+            m_dockWidgetsByGuest.erase(it);
+
+        previousGuest = guest;
+        if (guest)
+            m_dockWidgetsByGuest.insert(guest, dock);
+    });
 }
 
 void DockRegistry::unregisterDockWidget(DockWidgetBase *dock)
 {
     m_dockWidgets.removeOne(dock);
+    m_closedDockWidgets.removeOne(dock);
+    removeFromPartition(m_dockWidgetsByAffinity, dock->affinityName(), dock);
+    unindexForSearch(dock);
+    onLayoutChanged(nullptr);
+
+    const QString name = dock->uniqueName();
+    if (m_dockWidgetsByName.value(name) == dock) {
+        m_dockWidgetsByName.remove(name);
+
+        // A duplicate might still be registered with the same name
+        for (auto other : qAsConst(m_dockWidgets)) {
+            if (other->uniqueName() == name) {
+                m_dockWidgetsByName.insert(name, other);
+                break;
+            }
+        }
+    }
+
+    // Keyed by the pointer only, so this works even if the guest was already deleted
+    auto guestIt = m_dockWidgetsByGuest.find(dock->widget());
+    if (guestIt != m_dockWidgetsByGuest.end() && guestIt.value() == dock)
+        m_dockWidgetsByGuest.erase(guestIt);
+
     maybeDelete();
 }
 
@@ -131,31 +607,89 @@ void DockRegistry::registerMainWindow(MainWindowBase *mainWindow)
         qWarning() << Q_FUNC_INFO << "MainWindow" << mainWindow << " doesn't have an ID";
     } else if (auto other = mainWindowByName(mainWindow->uniqueName())) {
         qWarning() << Q_FUNC_INFO << "Another MainWindow" << other << "with name" << mainWindow->uniqueName() << " already exists." << mainWindow;
+    } else {
+        m_mainWindowsByName.insert(mainWindow->uniqueName(), mainWindow);
     }
 
     m_mainWindows << mainWindow;
+    m_mainWindowsByAffinity[mainWindow->affinityName()].push_back(mainWindow);
+    watchEvents(mainWindow);
+    onTopLevelsChanged();
+    onLayoutChanged(nullptr);
+
+    if (Config::self().floatingWindowPoolSize() > 0)
+        FloatingWindowPool::self()->scheduleRefill(); // Pooled windows need a main window as parent
 }
 
 void DockRegistry::unregisterMainWindow(MainWindowBase *mainWindow)
 {
     m_mainWindows.removeOne(mainWindow);
+    removeFromPartition(m_mainWindowsByAffinity, mainWindow->affinityName(), mainWindow);
+    unwatchEvents(mainWindow);
+    onTopLevelsChanged();
+    m_layoutChanges.remove(mainWindow->window());
+    onLayoutChanged(nullptr);
+
+    const QString name = mainWindow->uniqueName();
+    if (m_mainWindowsByName.value(name) == mainWindow) {
+        m_mainWindowsByName.remove(name);
+
+        // A duplicate might still be registered with the same name
+        for (auto other : qAsConst(m_mainWindows)) {
+            if (other->uniqueName() == name) {
+                m_mainWindowsByName.insert(name, other);
+                break;
+            }
+        }
+    }
+
     maybeDelete();
 }
 
 void DockRegistry::registerNestedWindow(FloatingWindow *window)
 {
     m_nestedWindows << window;
+    watchEvents(window);
+    if (QWindow *windowHandle = window->windowHandle()) {
+        // Pooled ones already have their native window, the others get it when shown, see eventFilter()
+        watchEvents(windowHandle);
+        m_nestedWindowsByHandle.insert(windowHandle, window);
+    }
+    onTopLevelsChanged();
+    onLayoutChanged(nullptr);
 }
 
 void DockRegistry::unregisterNestedWindow(FloatingWindow *window)
 {
     m_nestedWindows.removeOne(window);
+    unwatchEvents(window);
+    QWindow *windowHandle = window->windowHandle();
+    if (windowHandle)
+        unwatchEvents(windowHandle);
+    onTopLevelsChanged();
+    m_layoutChanges.remove(window);
+    onLayoutChanged(nullptr);
+
+    auto handleIt = m_nestedWindowsByHandle.find(windowHandle);
+    if (windowHandle && handleIt != m_nestedWindowsByHandle.end() && handleIt.value() == window) {
+        m_nestedWindowsByHandle.erase(handleIt);
+    } else {
+        // The native window is already gone, so we don't know its key anymore
+        for (auto it = m_nestedWindowsByHandle.begin(); it != m_nestedWindowsByHandle.end();) {
+            if (it.value() == window)
+                it = m_nestedWindowsByHandle.erase(it);
+            else
+                ++it;
+        }
+    }
+
     maybeDelete();
 }
 
 void DockRegistry::registerLayout(MultiSplitterLayout *layout)
 {
     m_layouts << layout;
+    watchEvents(layout->multiSplitter()); // For QEvent::ScreenChangeInternal
 }
 
 void DockRegistry::unregisterLayout(MultiSplitterLayout *layout)
@@ -166,31 +700,31 @@ void DockRegistry::unregisterLayout(MultiSplitterLayout *layout)
 void DockRegistry::registerFrame(Frame *frame)
 {
     m_frames << frame;
+    watchEvents(frame);
+    connect(frame, &Frame::numDockWidgetsChanged, this, [this, frame] { onLayoutChanged(frame->window()); });
+    connect(frame, &Frame::currentDockWidgetChanged, this, [this, frame] { onLayoutChanged(frame->window()); });
+    connect(frame, &Frame::dockWidgetsReordered, this, [this, frame] { onLayoutChanged(frame->window()); });
+    onLayoutChanged(nullptr);
 }
 
 void DockRegistry::unregisterFrame(Frame *frame)
 {
     m_frames.removeOne(frame);
+    unwatchEvents(frame);
+    // Pooled frames are registered again when reused, which connects again
+    disconnect(frame, nullptr, this, nullptr);
+    setFrameNonClosable(frame, false);
+    onLayoutChanged(nullptr);
 }
 
 DockWidgetBase *DockRegistry::dockByName(const QString &name) const
 {
-    for (auto dock : qAsConst(m_dockWidgets)) {
-        if (dock->uniqueName() == name)
-            return dock;
-    }
-
-    return nullptr;
+    return m_dockWidgetsByName.value(name);
 }
 
 MainWindowBase *DockRegistry::mainWindowByName(const QString &name) const
 {
-    for (auto mainWindow : qAsConst(m_mainWindows)) {
-        if (mainWindow->uniqueName() == name)
-            return mainWindow;
-    }
-
-    return nullptr;
+    return m_mainWindowsByName.value(name);
 }
 
 DockWidgetBase *DockRegistry::dockWidgetForGuest(QWidget *guest) const
@@ -198,15 +732,24 @@ DockWidgetBase *DockRegistry::dockWidgetForGuest(QWidget *guest) const
     if (!guest)
         return nullptr;
 
-    for (DockWidgetBase *dw : m_dockWidgets) {
-        if (dw->widget() == guest)
-            return dw;
+    // The guest might have been deleted and its address reused, so double check
+    DockWidgetBase *dw = m_dockWidgetsByGuest.value(guest);
+    return dw && dw->widget() == guest ? dw : nullptr;
+}
+
+bool DockRegistry::isSane() const
+{
+    // Checking every layout is expensive. Whatever could break them bumps the layout generation.
+    if (!m_isSaneCacheValid || m_isSaneGeneration != s_layoutGeneration) {
+        m_isSane = computeIsSane();
+        m_isSaneGeneration = s_layoutGeneration;
+        m_isSaneCacheValid = true;
     }
 
-    return nullptr;
+    return m_isSane;
 }
 
-bool DockRegistry::isSane() const
+bool DockRegistry::computeIsSane() const
 {
     QSet<QString> names;
     for (auto dock : qAsConst(m_dockWidgets)) {
@@ -247,19 +790,162 @@ const DockWidgetBase::List DockRegistry::dockwidgets() const
     return m_dockWidgets;
 }
 
-const DockWidgetBase::List DockRegistry::closedDockwidgets() const
+const DockWidgetBase::List &DockRegistry::dockWidgetsWithAffinity(const QString &affinityName) const
 {
-    DockWidgetBase::List result;
-    result.reserve(m_dockWidgets.size());
+    static const DockWidgetBase::List s_empty;
+    auto it = m_dockWidgetsByAffinity.constFind(affinityName);
+    return it == m_dockWidgetsByAffinity.cend() ? s_empty : *it;
+}
 
-    for (DockWidgetBase *dw : m_dockWidgets) {
-        if (dw->parent() == nullptr && !dw->isVisible())
-            result.push_back(dw);
-    }
+const MainWindowBase::List &DockRegistry::mainWindowsWithAffinity(const QString &affinityName) const
+{
+    static const MainWindowBase::List s_empty;
+    auto it = m_mainWindowsByAffinity.constFind(affinityName);
+    return it == m_mainWindowsByAffinity.cend() ? s_empty : *it;
+}
+
+void DockRegistry::onAffinityNameChanged(DockWidgetBase *dw, const QString &oldName)
+{
+    if (!m_dockWidgets.contains(dw))
+        return;
+
+    removeFromPartition(m_dockWidgetsByAffinity, oldName, dw);
+    m_dockWidgetsByAffinity[dw->affinityName()].push_back(dw);
+}
+
+void DockRegistry::onAffinityNameChanged(MainWindowBase *mw, const QString &oldName)
+{
+    if (!m_mainWindows.contains(mw))
+        return;
+
+    removeFromPartition(m_mainWindowsByAffinity, oldName, mw);
+    m_mainWindowsByAffinity[mw->affinityName()].push_back(mw);
+}
+
+static QString searchKey(const QString &text)
+{
+    return text.toCaseFolded();
+}
 
+static QSet<QString> trigrams(const QString &key)
+{
+    QSet<QString> result;
+    for (int i = 0; i + 3 <= key.size(); ++i)
+        result.insert(key.mid(i, 3));
     return result;
 }
 
+void DockRegistry::indexForSearch(DockWidgetBase *dock)
+{
+    quint64 serial = m_nextSearchSerial;
+    auto it = m_searchEntries.constFind(dock);
+    if (it != m_searchEntries.cend()) {
+        // A title change, keep the registration order
+        serial = it->serial;
+        unindexForSearch(dock);
+    } else {
+        m_nextSearchSerial++;
+    }
+
+    // The separator can't be typed, so matches don't span the name and the title
+    const QString key = searchKey(dock->uniqueName()) + QLatin1Char('\n') + searchKey(dock->title());
+    SearchEntry entry;
+    entry.key = key;
+    entry.serial = serial;
+    m_searchEntries.insert(dock, entry);
+
+    const QSet<QString> keyTrigrams = trigrams(key);
+    for (const QString &trigram : keyTrigrams)
+        m_dockWidgetsByTrigram[trigram].insert(dock);
+}
+
+void DockRegistry::unindexForSearch(DockWidgetBase *dock)
+{
+    auto it = m_searchEntries.find(dock);
+    if (it == m_searchEntries.end())
+        return;
+
+    const QSet<QString> keyTrigrams = trigrams(it->key);
+    for (const QString &trigram : keyTrigrams) {
+        auto trigramIt = m_dockWidgetsByTrigram.find(trigram);
+        if (trigramIt != m_dockWidgetsByTrigram.end()) {
+            trigramIt->remove(dock);
+            if (trigramIt->isEmpty())
+                m_dockWidgetsByTrigram.erase(trigramIt);
+        }
+    }
+
+    m_searchEntries.erase(it);
+}
+
+void DockRegistry::onTitleChanged(DockWidgetBase *dw)
+{
+    if (m_searchEntries.contains(dw))
+        indexForSearch(dw);
+}
+
+DockWidgetBase::List DockRegistry::searchDockWidgets(const QString &query, int maxResults) const
+{
+    const QString key = searchKey(query);
+    DockWidgetBase::List candidates;
+
+    if (key.size() < 3) {
+        // Too short for the trigram index, but the keys are already folded
+        candidates.reserve(m_searchEntries.size());
+        for (auto it = m_searchEntries.cbegin(), end = m_searchEntries.cend(); it != end; ++it) {
+            if (it->key.contains(key))
+                candidates.push_back(it.key());
+        }
+    } else {
+        // Intersect the postings, starting with the smallest, then verify as trigrams can match out of order
+        QVector<const QSet<DockWidgetBase*>*> postings;
+        const QSet<QString> queryTrigrams = trigrams(key);
+        for (const QString &trigram : queryTrigrams) {
+            auto it = m_dockWidgetsByTrigram.constFind(trigram);
+            if (it == m_dockWidgetsByTrigram.cend())
+                return {};
+            postings.push_back(&*it);
+        }
+
+        std::sort(postings.begin(), postings.end(), [] (const QSet<DockWidgetBase*> *a, const QSet<DockWidgetBase*> *b) {
+            return a->size() < b->size();
+        });
+
+        for (DockWidgetBase *dw : *postings.first()) {
+            const bool inAll = std::all_of(postings.cbegin() + 1, postings.cend(), [dw] (const QSet<DockWidgetBase*> *posting) {
+                return posting->contains(dw);
+            });
+
+            if (inAll && m_searchEntries.value(dw).key.contains(key))
+                candidates.push_back(dw);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this] (DockWidgetBase *a, DockWidgetBase *b) {
+        return m_searchEntries.value(a).serial < m_searchEntries.value(b).serial;
+    });
+
+    if (maxResults >= 0 && candidates.size() > maxResults)
+        candidates.resize(maxResults);
+
+    return candidates;
+}
+
+const DockWidgetBase::List &DockRegistry::closedDockwidgets() const
+{
+    return m_closedDockWidgets;
+}
+
+void DockRegistry::updateClosedState(DockWidgetBase *dw)
+{
+    const bool isClosed = dw->parent() == nullptr && !dw->isVisible();
+    const int index = m_closedDockWidgets.indexOf(dw);
+    if (isClosed && index == -1)
+        m_closedDockWidgets.push_back(dw);
+    else if (!isClosed && index != -1)
+        m_closedDockWidgets.remove(index);
+}
+
 const MainWindowBase::List DockRegistry::mainwindows() const
 {
     return m_mainWindows;
@@ -277,19 +963,27 @@ const Frame::List DockRegistry::frames() const
 
 const QVector<FloatingWindow *> DockRegistry::nestedwindows() const
 {
-    // Returns all the FloatingWindow which aren't being deleted
-    QVector<FloatingWindow *> result;
-    result.reserve(m_nestedWindows.size());
-    for (FloatingWindow *fw : m_nestedWindows) {
-        if (!fw->beingDeleted())
-            result.push_back(fw);
-    }
+    // Emptied windows are unregistered right away, see scheduleDelete()
+    return m_nestedWindows;
+}
 
-    return result;
+int DockRegistry::indexOfNestedWindow(const FloatingWindow *fw) const
+{
+    return m_nestedWindows.indexOf(const_cast<FloatingWindow*>(fw));
+}
+
+FloatingWindow *DockRegistry::nestedWindowAt(int index) const
+{
+    return m_nestedWindows.value(index);
 }
 
 FloatingWindow *DockRegistry::floatingWindowForHandle(QWindow *windowHandle) const
 {
+    FloatingWindow *cached = m_nestedWindowsByHandle.value(windowHandle);
+    if (cached && cached->windowHandle() == windowHandle)
+        return cached;
+
+    // Not shown yet, or its handle was recreated
     for (FloatingWindow *fw : m_nestedWindows) {
         if (fw->windowHandle() == windowHandle)
             return fw;
@@ -298,28 +992,47 @@ FloatingWindow *DockRegistry::floatingWindowForHandle(QWindow *windowHandle) con
     return nullptr;
 }
 
-QVector<QWidget *> DockRegistry::topLevels(bool excludeFloatingDocks) const
+int DockRegistry::topLevelsGeneration() const
 {
-    QVector<QWidget *> windows;
-    windows.reserve(m_nestedWindows.size() + m_mainWindows.size());
+    return m_topLevelsGeneration;
+}
+
+void DockRegistry::onTopLevelsChanged()
+{
+    m_topLevelsGeneration++;
+    m_topLevelsCacheValid = false;
+}
+
+const QVector<QWidget *> &DockRegistry::topLevels(bool excludeFloatingDocks) const
+{
+    if (!m_topLevelsCacheValid) {
+        m_topLevels.clear();
+        m_mainWindowTopLevels.clear();
+        m_topLevels.reserve(m_nestedWindows.size() + m_mainWindows.size());
 
-    if (!excludeFloatingDocks) {
         for (FloatingWindow *fw : m_nestedWindows) {
             if (fw->isVisible())
-                windows << fw;
+                m_topLevels << fw;
         }
-    }
 
-    for (MainWindowBase *m : m_mainWindows) {
-        if (m->isVisible())
-            windows << m->topLevelWidget();
+        for (MainWindowBase *m : m_mainWindows) {
+            if (m->isVisible())
+                m_mainWindowTopLevels << m->topLevelWidget();
+        }
+
+        m_topLevels << m_mainWindowTopLevels;
+        m_topLevelsCacheValid = true;
     }
 
-    return windows;
+    return excludeFloatingDocks ? m_mainWindowTopLevels : m_topLevels;
 }
 
 void DockRegistry::clear()
 {
+    // The layouts are cleared below anyway, so closing doesn't need to lay them out
+    for (auto mw : qAsConst(m_mainWindows))
+        mw->multiSplitterLayout()->rootItem()->beginTeardown();
+
     for (auto dw : qAsConst(m_dockWidgets)) {
         dw->forceClose();
         dw->lastPositions().removePlaceholders();
@@ -334,6 +1047,7 @@ void DockRegistry::clear()
 
 void DockRegistry::clear(QStringList affinities)
 {
+    KDDW_TRACE_SCOPE("restore", "DockRegistry::clear");
     if (affinities.isEmpty()) {
         // Just clear everything
         clear();
@@ -342,18 +1056,27 @@ void DockRegistry::clear(QStringList affinities)
 
      // empty affinity also matches and will be closed
     affinities << QString();
+    affinities.removeDuplicates();
 
-    for (auto dw : qAsConst(m_dockWidgets)) {
-        if (affinities.contains(dw->affinityName())) {
+    for (const QString &affinity : qAsConst(affinities)) {
+        const MainWindowBase::List mainWindows = mainWindowsWithAffinity(affinity);
+        for (auto mw : mainWindows)
+            mw->multiSplitterLayout()->rootItem()->beginTeardown();
+    }
+
+    // Only the matching partitions are visited. Iterates copies, as closing can change them
+    for (const QString &affinity : qAsConst(affinities)) {
+        const DockWidgetBase::List dockWidgets = dockWidgetsWithAffinity(affinity);
+        for (auto dw : dockWidgets) {
             dw->forceClose();
             dw->lastPositions().removePlaceholders();
         }
     }
 
-    for (auto mw : qAsConst(m_mainWindows)) {
-        if (affinities.contains(mw->affinityName())) {
+    for (const QString &affinity : qAsConst(affinities)) {
+        const MainWindowBase::List mainWindows = mainWindowsWithAffinity(affinity);
+        for (auto mw : mainWindows)
             mw->multiSplitterLayout()->rootItem()->clear();
-        }
     }
 }
 
@@ -365,19 +1088,135 @@ void DockRegistry::ensureAllFloatingWidgetsAreMorphed()
     }
 }
 
+void DockRegistry::deferResizeForScreenChange(MultiSplitter *multiSplitter)
+{
+    if (m_isShuttingDown || multiSplitter->isResizeDeferred())
+        return;
+
+    multiSplitter->setResizeDeferred(true);
+    m_deferredResizes.push_back(multiSplitter);
+    m_deferredResizesTimer.start();
+}
+
+void DockRegistry::onScreenScaleChanged(QScreen *screen)
+{
+    for (MultiSplitterLayout *layout : qAsConst(m_layouts)) {
+        MultiSplitter *multiSplitter = layout->multiSplitter();
+        QWindow *windowHandle = multiSplitter->window()->windowHandle();
+        if (windowHandle && windowHandle->screen() == screen)
+            deferResizeForScreenChange(multiSplitter);
+    }
+}
+
+void DockRegistry::applyDeferredResizes()
+{
+    KDDW_TRACE_SCOPE("layout", "DockRegistry::applyDeferredResizes");
+    const QVector<QPointer<MultiSplitter>> multiSplitters = m_deferredResizes;
+    m_deferredResizes.clear();
+    for (MultiSplitter *multiSplitter : multiSplitters) {
+        if (multiSplitter)
+            multiSplitter->setResizeDeferred(false);
+    }
+}
+
+void DockRegistry::scheduleDelete(Frame *frame)
+{
+    m_framesToDelete.push_back(frame);
+    m_deleteScheduledTimer.start();
+}
+
+void DockRegistry::scheduleDelete(FloatingWindow *floatingWindow)
+{
+    m_floatingWindowsToDelete.push_back(floatingWindow);
+    m_deleteScheduledTimer.start();
+}
+
+void DockRegistry::deleteScheduled()
+{
+    KDDW_TRACE_SCOPE("dock", "DockRegistry::deleteScheduled");
+    m_deleteScheduledTimer.stop();
+
+    // Deleting might empty more of them, so loop until there's nothing left.
+    // Frames go first, as they're usually inside the floating windows.
+    while (!m_framesToDelete.isEmpty() || !m_floatingWindowsToDelete.isEmpty()) {
+        const QVector<QPointer<Frame>> frames = m_framesToDelete;
+        m_framesToDelete.clear();
+        for (Frame *frame : frames) {
+            // Might have been recycled and reused meanwhile, see TabWidget::insertDockWidget()
+            if (frame && frame->beingDeletedLater() && !FramePool::self()->recycle(frame))
+                delete frame;
+        }
+
+        const QVector<QPointer<FloatingWindow>> floatingWindows = m_floatingWindowsToDelete;
+        m_floatingWindowsToDelete.clear();
+        for (FloatingWindow *fw : floatingWindows) {
+            if (fw && !FloatingWindowPool::self()->recycle(fw))
+                delete fw;
+        }
+    }
+}
+
+void DockRegistry::watchEvents(QObject *object)
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    object->installEventFilter(this);
+#else
+    Q_UNUSED(object);
+#endif
+}
+
+void DockRegistry::unwatchEvents(QObject *object)
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    object->removeEventFilter(this);
+#else
+    Q_UNUSED(object);
+#endif
+}
+
 bool DockRegistry::eventFilter(QObject *watched, QEvent *event)
 {
-    if (event->type() == QEvent::Quit && !m_isProcessingAppQuitEvent) {
-        m_isProcessingAppQuitEvent = true;
-        qApp->sendEvent(qApp, event);
-        m_isProcessingAppQuitEvent = false;
-        return true;
+    // Only our own windows and widgets are watched, see watchEvents()
+    m_performanceCounters.eventsFiltered++;
+    if (m_isShuttingDown) {
+        // Windows being destroyed, no need to track them
+        return false;
+    } else if (event->type() == QEvent::Show) {
+        if (auto fw = qobject_cast<FloatingWindow*>(watched)) {
+            // The window handle usually only exists once shown
+            if (QWindow *windowHandle = fw->windowHandle()) {
+                if (m_nestedWindowsByHandle.value(windowHandle) != fw && m_nestedWindows.contains(fw)) {
+                    m_nestedWindowsByHandle.insert(windowHandle, fw);
+                    watchEvents(windowHandle);
+                }
+            }
+        }
+    }
+
+    if (event->type() == QEvent::Show || event->type() == QEvent::Hide) {
+        // A hidden ancestor hides the main window too, so this covers embedded ones
+        if (qobject_cast<FloatingWindow*>(watched) || qobject_cast<MainWindowBase*>(watched))
+            onTopLevelsChanged();
+    }
+
+    if (event->type() == QEvent::Move || event->type() == QEvent::Resize ||
+        event->type() == QEvent::Show || event->type() == QEvent::Hide) {
+        // Separator moves resize frames, so this catches those too
+        if (qobject_cast<Frame*>(watched) || qobject_cast<FloatingWindow*>(watched) ||
+            qobject_cast<MainWindowBase*>(watched))
+            onLayoutChanged(static_cast<QWidgetOrQuick*>(watched)->window());
+    } else if (event->type() == QEvent::ScreenChangeInternal) {
+        // Sent to every widget of a window that moved to another screen
+        if (auto multiSplitter = qobject_cast<MultiSplitter*>(watched))
+            deferResizeForScreenChange(multiSplitter);
     } else if (event->type() == QEvent::Expose) {
         if (auto windowHandle = qobject_cast<QWindow*>(watched)) {
-            if (FloatingWindow *fw = floatingWindowForHandle(windowHandle)) {
-                // This floating window was exposed
+            FloatingWindow *fw = m_nestedWindowsByHandle.value(windowHandle);
+            if (fw && fw->windowHandle() == windowHandle && m_nestedWindows.constLast() != fw) {
+                // This floating window was exposed, it's now on top
                 m_nestedWindows.removeOne(fw);
                 m_nestedWindows.append(fw);
+                onTopLevelsChanged();
             }
         }
     }
@@ -24,9 +24,18 @@
 #include "DockWidgetBase.h"
 #include "MainWindowBase.h"
 #include "FloatingWindow_p.h"
+#include "Config.h"
 
 #include <QVector>
 #include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+
+QT_BEGIN_NAMESPACE
+class QScreen;
+QT_END_NAMESPACE
 
 /**
  * DockRegistry is a singleton that knows about all DockWidgets.
@@ -36,6 +45,8 @@
 namespace KDDockWidgets
 {
 
+class MultiSplitter;
+
 class DOCKS_EXPORT DockRegistry : public QObject
 {
     Q_OBJECT
@@ -63,13 +74,41 @@ public:
     /// @brief returns the dock widget that hosts @p guest widget. Nullptr if there's none.
     DockWidgetBase *dockWidgetForGuest(QWidget *guest) const;
 
+    ///@brief Returns whether the names are unique and the layouts consistent.
+    ///Cached until lastLayoutGeneration() changes, so it's cheap to call often.
     bool isSane() const;
 
     ///@brief returns all DockWidget instances
     const DockWidgetBase::List dockwidgets() const;
 
+    ///@brief returns the DockWidget instances with affinity @p affinityName, without filtering them all
+    const DockWidgetBase::List &dockWidgetsWithAffinity(const QString &affinityName) const;
+
+    ///@brief returns the MainWindow instances with affinity @p affinityName
+    const MainWindowBase::List &mainWindowsWithAffinity(const QString &affinityName) const;
+
+    ///@brief Called by DockWidgetBase and MainWindowBase when their affinity changes from @p oldName
+    void onAffinityNameChanged(DockWidgetBase *, const QString &oldName);
+    void onAffinityNameChanged(MainWindowBase *, const QString &oldName);
+
+    /**
+     * @brief returns the dock widgets whose unique name or title contain @p query, ignoring case
+     *
+     * Closed dock widgets are included. Results are in registration order, at most @p maxResults
+     * of them, or all if -1. Backed by a trigram index, so it stays cheap with thousands of dock
+     * widgets, for example to implement a quick-open palette that queries on every keystroke.
+     */
+    DockWidgetBase::List searchDockWidgets(const QString &query, int maxResults = -1) const;
+
+    ///@brief Called by DockWidgetBase when its title changes, to update the searchDockWidgets() index
+    void onTitleChanged(DockWidgetBase *);
+
     ///@brief returns all closed DockWidget instances
-    const DockWidgetBase::List closedDockwidgets() const;
+    ///Kept up to date as dock widgets are shown, hidden and reparented, so this is cheap.
+    const DockWidgetBase::List &closedDockwidgets() const;
+
+    ///@brief Called by DockWidgetBase when it's shown, hidden or reparented, to update closedDockwidgets()
+    void updateClosedState(DockWidgetBase *);
 
     ///@brief returns all MainWindow instances
     const MainWindowBase::List mainwindows() const;
@@ -84,9 +123,19 @@ public:
     /// As there might be DockWidgets which weren't morphed yet.
     const QVector<FloatingWindow*> nestedwindows() const;
 
+    ///@brief Like nestedwindows().indexOf(@p fw), without building the list
+    int indexOfNestedWindow(const FloatingWindow *fw) const;
+
+    ///@brief Like nestedwindows().at(@p index), without building the list. Returns nullptr if out of range.
+    FloatingWindow *nestedWindowAt(int index) const;
+
     ///@brief returns the FloatingWindow with handle @p windowHandle
     FloatingWindow *floatingWindowForHandle(QWindow *windowHandle) const;
 
+    ///@brief returns a number that changes whenever a FloatingWindow or MainWindow is registered,
+    /// unregistered, shown or hidden, or the FloatingWindow z-order changes. So callers can cache @ref topLevels()
+    int topLevelsGeneration() const;
+
     ///@brief Returns the list with all visiblye top-level parents of our FloatingWindow and MainWindow instances.
     ///
     /// Typically these are the FloatingWindows and MainWindows themselves. However, since a
@@ -96,7 +145,8 @@ public:
     /// Every returned widget is either a FloatingWindow, MainWindow, or something that contains a MainWindow.
     ///
     /// If @p excludeFloatingDocks is true then FloatingWindow won't be returned
-    QVector<QWidget*> topLevels(bool excludeFloatingDocks = false) const;
+    /// The result is cached until topLevelsGeneration() changes.
+    const QVector<QWidget*> &topLevels(bool excludeFloatingDocks = false) const;
 
     /**
      * @brief Closes all dock widgets, destroys all FloatingWindow, Item and Separators.
@@ -139,23 +189,162 @@ public:
      */
     bool isProcessingAppQuitEvent() const;
 
+    /**
+     * @brief Tells whether @p frame has a dock widget that can't be closed
+     *
+     * QEvent::Quit can only be caught with an application wide event filter, which is only
+     * installed while there's such a frame, see isProcessingAppQuitEvent().
+     */
+    void setFrameNonClosable(Frame *frame, bool nonClosable);
+
+    /**
+     * @brief Stops maintaining the layouts, as everything is about to be destroyed
+     *
+     * Called on QCoreApplication::aboutToQuit() with Config::Flag_FastShutdown, once the autosaves
+     * are flushed. From then on, removing dock widgets and frames doesn't relay the layouts out,
+     * emptied frames and floating windows aren't deleted, they go with their parents, and
+     * layoutChanged() isn't emitted. Lasts until the registry is deleted, with the last window.
+     */
+    void beginShutdown();
+
+    ///@brief Applies Config::isLayoutLocked() and MainWindowBase::isLayoutLocked() to all the windows
+    void updateLayoutLocked();
+
+    ///@brief Returns whether beginShutdown() was called
+    bool isShuttingDown() const;
+
+    /**
+     * @brief Resizes the layout of @p multiSplitter once, on the next event loop turn
+     *
+     * Moving a window to a screen with another device pixel ratio, or changing the scale factor,
+     * resizes it several times in a row. Each window collects its screen changes here, so all of
+     * them are relaid out together, once each, with their final sizes.
+     */
+    void deferResizeForScreenChange(MultiSplitter *multiSplitter);
+
+    /**
+     * @brief Deletes, or recycles, an emptied frame or floating window
+     *
+     * By the time they're scheduled they already left their layout and are unregistered, so
+     * nothing else sees them. They're only kept alive until the caller, which might still be
+     * in the middle of a QTabWidget::removeTab() or a layout merge, unwinds. That's at the next
+     * deleteScheduled() call, which bulk operations do right before returning, or at the latest
+     * on the next event loop turn.
+     */
+    void scheduleDelete(Frame *frame);
+    void scheduleDelete(FloatingWindow *floatingWindow);
+
+    ///@brief Deletes, or recycles into their pools, the objects passed to scheduleDelete().
+    ///Only call it where no frame or floating window is being operated on up the stack.
+    void deleteScheduled();
+
     // TODO: docs
     MultiSplitterLayout* layoutForItem(const Layouting::Item *) const;
 
     // TODO: docs
     bool itemIsInMainWindow(const Layouting::Item *) const;
 
+    ///@brief Returns a number that changes whenever the layout of the top-level @p window might have
+    ///changed, so serialized state can be cached. See layoutChanged().
+    quint64 layoutGeneration(const QObject *window) const;
+
+    ///@brief Returns a number that changes whenever any layout might have changed
+    quint64 lastLayoutGeneration() const;
+
+    ///@brief Returns the latest snapshot published by publishDockingState(). Thread safe, and
+    ///doesn't create the registry when called from other threads. Nothing is published until
+    ///the first call. See Config::dockingState().
+    static std::shared_ptr<const DockingState> dockingState();
+
+    ///@brief See Config::memoryUsage()
+    MemoryUsage memoryUsage(const MainWindowBase *mainWindow) const;
+
+    ///@brief The counters not kept by the layouting code. See Config::performanceCounters().
+    PerformanceCounters &performanceCounters() { return m_performanceCounters; }
+
+Q_SIGNALS:
+    ///@brief emitted when windows, frames or dock widgets are added, removed, moved or resized,
+    ///or when a frame's tabs change. Used by the layout autosave.
+    void layoutChanged();
+
 protected:
     bool eventFilter(QObject *watched, QEvent *event) override;
 private:
     explicit DockRegistry(QObject *parent = nullptr);
     void maybeDelete();
+
+    ///@brief Emits layoutChanged(). @p window is the top-level that changed, or nullptr if any might have.
+    void onLayoutChanged(const QObject *window);
+
+    ///@brief Adds @p dock to the searchDockWidgets() index. Removes it first, if already there.
+    void indexForSearch(DockWidgetBase *dock);
+    void unindexForSearch(DockWidgetBase *dock);
+
+    ///@brief Bumps topLevelsGeneration() and invalidates the topLevels() cache
+    void onTopLevelsChanged();
+
+    ///@brief Defers the resizes of the layouts shown on @p screen. See deferResizeForScreenChange()
+    void onScreenScaleChanged(QScreen *screen);
+    void applyDeferredResizes();
+
+    ///@brief Replaces the dockingState() snapshot with a copy of the current state.
+    ///Called once per event loop turn in which the layout changed.
+    void publishDockingState();
+
+    bool computeIsSane() const;
+
+    ///@brief Installs or removes this as event filter of one of our own widgets or windows.
+    ///There's no application wide filter, other objects' events don't go through eventFilter()
+    void watchEvents(QObject *object);
+    void unwatchEvents(QObject *object);
+
     bool m_isProcessingAppQuitEvent = false;
+    QObject *m_quitEventFilter = nullptr; // See setFrameNonClosable()
+    QSet<Frame*> m_nonClosableFrames;
+    bool m_isShuttingDown = false;
     DockWidgetBase::List m_dockWidgets;
+    DockWidgetBase::List m_closedDockWidgets;
+    QHash<QString, DockWidgetBase::List> m_dockWidgetsByAffinity; // Registration order within each
+    QHash<QString, MainWindowBase::List> m_mainWindowsByAffinity;
     MainWindowBase::List m_mainWindows;
+
+    // Indexes for the lookups done during restore. Names are immutable after registration.
+    QHash<QString, DockWidgetBase*> m_dockWidgetsByName;
+    QHash<QString, MainWindowBase*> m_mainWindowsByName;
+    QHash<const QWidget*, DockWidgetBase*> m_dockWidgetsByGuest;
+
+    // The searchDockWidgets() index. Keys are the case folded name and title, the serial is for
+    // returning results in registration order.
+    struct SearchEntry {
+        QString key;
+        quint64 serial = 0;
+    };
+    QHash<DockWidgetBase*, SearchEntry> m_searchEntries;
+    QHash<QString, QSet<DockWidgetBase*>> m_dockWidgetsByTrigram;
+    quint64 m_nextSearchSerial = 0;
+
+    // So expose events for windows which aren't ours are dismissed quickly. Filled on show,
+    // as that's when the window handle exists.
+    QHash<const QWindow*, FloatingWindow*> m_nestedWindowsByHandle;
+    int m_topLevelsGeneration = 0;
+    mutable QVector<QWidget*> m_topLevels;
+    mutable QVector<QWidget*> m_mainWindowTopLevels;
+    mutable bool m_topLevelsCacheValid = false;
+    mutable bool m_isSaneCacheValid = false; // See isSane()
+    mutable bool m_isSane = false;
+    mutable quint64 m_isSaneGeneration = 0;
+    quint64 m_lastGlobalLayoutChange = 0;
+    QHash<const QObject*, quint64> m_layoutChanges;
     Frame::List m_frames;
     QVector<FloatingWindow*> m_nestedWindows;
     QVector<MultiSplitterLayout*> m_layouts;
+    QVector<QPointer<MultiSplitter>> m_deferredResizes;
+    QTimer m_deferredResizesTimer;
+    QVector<QPointer<Frame>> m_framesToDelete;
+    QVector<QPointer<FloatingWindow>> m_floatingWindowsToDelete;
+    QTimer m_deleteScheduledTimer;
+    QTimer m_publishDockingStateTimer;
+    PerformanceCounters m_performanceCounters;
 };
 
 }
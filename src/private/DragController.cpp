@@ -26,11 +26,23 @@
 #include "WidgetResizeHandler_p.h"
 #include "Utils_p.h"
 #include "DockRegistry_p.h"
+#include "Config.h"
+#include "MainWindowBase.h"
+#include "DropAreaWithCentralFrame_p.h"
+#include "multisplitter/Tracing_p.h"
 
 #include <QMouseEvent>
 #include <QApplication>
 #include <QCursor>
 #include <QWindow>
+#include <QElapsedTimer>
+#include <QMetaEnum>
+
+#include <algorithm>
+
+#ifndef KDDOCKWIDGETS_QTWIDGETS
+# include <QQuickWindow>
+#endif
 
 #if defined(Q_OS_WIN)
 # include <QWindow>
@@ -89,18 +101,61 @@ public:
 
 FallbackMouseGrabber::~FallbackMouseGrabber() {}
 
+///@brief Measures the scope it lives in, if DragController's timing is enabled
+class DragPhaseTimer
+{
+public:
+    DragPhaseTimer(const DragController *dc, DragController::DragPhase phase)
+        : m_dragController(dc->timingEnabled() ? dc : nullptr)
+        , m_phase(phase)
+    {
+        if (m_dragController)
+            m_timer.start();
+    }
+
+    ~DragPhaseTimer()
+    {
+        if (m_dragController)
+            m_dragController->recordPhase(m_phase, m_timer.nsecsElapsed() / 1000);
+    }
+
+private:
+    Q_DISABLE_COPY(DragPhaseTimer)
+    const DragController *const m_dragController;
+    const DragController::DragPhase m_phase;
+    QElapsedTimer m_timer;
+};
+
 }
 
-StateBase::StateBase(DragController *parent)
+static qint64 percentile(const QVector<qint64> &sortedSamples, int p)
+{
+    if (sortedSamples.isEmpty())
+        return 0;
+
+    const int index = (sortedSamples.size() - 1) * p / 100;
+    return sortedSamples.at(index);
+}
+
+StateBase::StateBase(DragController *parent, const char *traceName)
     : QState(parent)
     , q(parent)
 {
+    // Each state is a begin/end pair in the trace
+    connect(this, &QState::entered, this, [traceName] {
+        if (Layouting::TraceBackend *backend = Layouting::Tracing::backend())
+            backend->beginEvent("drag", traceName);
+    });
+    connect(this, &QState::exited, this, [traceName] {
+        if (Layouting::TraceBackend *backend = Layouting::Tracing::backend())
+            backend->endEvent("drag", traceName);
+    });
 }
 
 StateBase::~StateBase() = default;
 
 StateNone::StateNone(DragController *parent)
-    : StateBase(parent)
+    : StateBase(parent, "StateNone")
 {
 }
 
@@ -114,10 +169,24 @@ void StateNone::onEntry(QEvent *)
     WidgetResizeHandler::s_disableAllHandlers = false; // Re-enable resize handlers
 
     q->m_nonClientDrag = false;
+    q->m_pendingMoveTimer.stop();
+    q->m_hasPendingMove = false;
+    q->m_highFrequencyInput = false;
+    q->m_systemMoveTimer.stop();
+    q->m_topLevelSnapshot.clear();
+    q->m_topLevelSnapshotGeneration = -1;
+#if defined(Q_OS_WIN) && defined(KDDOCKWIDGETS_QTWIDGETS)
+    q->clearHWNDCache();
+#endif
     if (q->m_currentDropArea) {
         q->m_currentDropArea->removeHover();
         q->m_currentDropArea = nullptr;
     }
+
+    if (q->m_timingsPending) {
+        q->m_timingsPending = false;
+        Q_EMIT q->dragTimingsAvailable();
+    }
 }
 
 bool StateNone::handleMouseButtonPress(Draggable *draggable, QPoint globalPos, QPoint pos)
@@ -139,7 +208,7 @@ StateNone::~StateNone() = default;
 
 
 StatePreDrag::StatePreDrag(DragController *parent)
-    : StateBase(parent)
+    : StateBase(parent, "StatePreDrag")
 {
 }
 
@@ -167,7 +236,7 @@ bool StatePreDrag::handleMouseButtonRelease(QPoint)
 }
 
 StateDragging::StateDragging(DragController *parent)
-    : StateBase(parent)
+    : StateBase(parent, "StateDragging")
 {
 }
 
@@ -181,9 +250,15 @@ void StateDragging::onEntry(QEvent *)
             dw->saveLastFloatingGeometry();
     }
 
+    for (QVector<qint64> &samples : q->m_phaseSamples)
+        samples.clear();
+
     q->m_windowBeingDragged = q->m_draggable->makeWindow();
     if (q->m_windowBeingDragged) {
-        qCDebug(state) << "StateDragging entered. m_draggable=" << q->m_draggable << "; m_windowBeingDragged=" << q->m_windowBeingDragged->floatingWindow();
+        q->updateTopLevelSnapshot();
+        if (!q->m_nonClientDrag && (Config::self().flags() & Config::Flag_SystemMoveResize))
+            q->startSystemMove();
+        qCDebug(state) << "StateDragging entered. m_draggable=" << q->m_draggable << "; m_windowBeingDragged=" << q->m_windowBeingDragged->topLevel();
     } else {
         // Shouldn't happen
         qWarning() << Q_FUNC_INFO << "No window being dragged for " << q->m_draggable->asWidget();
@@ -195,6 +270,9 @@ bool StateDragging::handleMouseButtonRelease(QPoint globalPos)
 {
     qCDebug(state) << "StateDragging: handleMouseButtonRelease";
 
+    if (q->m_windowBeingDragged->isPreview())
+        return handlePreviewRelease();
+
     FloatingWindow *floatingWindow = q->m_windowBeingDragged->floatingWindow();
     if (!floatingWindow) {
         // It was deleted externally
@@ -210,7 +288,13 @@ bool StateDragging::handleMouseButtonRelease(QPoint globalPos)
     }
 
     if (q->m_currentDropArea) {
-        if (q->m_currentDropArea->drop(floatingWindow, globalPos)) {
+        bool accepted;
+        {
+            DragPhaseTimer timer(q, DragController::DragPhase_Drop);
+            accepted = q->m_currentDropArea->drop(floatingWindow, globalPos);
+        }
+
+        if (accepted) {
             Q_EMIT q->dropped();
         } else {
             qCDebug(state) << "StateDragging: Bailling out, drop not accepted";
@@ -223,20 +307,62 @@ bool StateDragging::handleMouseButtonRelease(QPoint globalPos)
     return true;
 }
 
+bool StateDragging::handlePreviewRelease()
+{
+    WindowBeingDragged *windowBeingDragged = q->m_windowBeingDragged.get();
+    if (!windowBeingDragged->isValid()) {
+        qCDebug(state) << "StateDragging: Bailling out, preview source deleted externally";
+        Q_EMIT q->dragCanceled();
+        return true;
+    }
+
+    // Remember where to drop before detaching, as detaching changes the layout under the cursor
+    DropArea *dropArea = windowBeingDragged->anyNonDockable() ? nullptr : q->m_currentDropArea;
+    DropIndicatorOverlayInterface::DropLocation location = DropIndicatorOverlayInterface::DropLocation_None;
+    QPointer<Frame> acceptingFrame;
+    if (dropArea && dropArea->dropIndicatorOverlay()) {
+        location = dropArea->dropIndicatorOverlay()->currentDropLocation();
+        acceptingFrame = dropArea->dropIndicatorOverlay()->hoveredFrame();
+    }
+
+    FloatingWindow *floatingWindow = windowBeingDragged->materialize();
+    if (!floatingWindow) {
+        qCDebug(state) << "StateDragging: Bailling out, couldn't detach";
+        Q_EMIT q->dragCanceled();
+        return true;
+    }
+
+    bool accepted = false;
+    if (location != DropIndicatorOverlayInterface::DropLocation_None) {
+        DragPhaseTimer timer(q, DragController::DragPhase_Drop);
+        accepted = dropArea->drop(floatingWindow, location, acceptingFrame);
+    }
+
+    if (accepted) {
+        Q_EMIT q->dropped();
+    } else {
+        // Ended over empty space, the detached window stays where the preview was
+        qCDebug(state) << "StateDragging: Not dropped, showing detached window";
+        floatingWindow->show();
+        Q_EMIT q->dragCanceled();
+    }
+
+    return true;
+}
+
 bool StateDragging::handleMouseMove(QPoint globalPos)
 {
-    FloatingWindow *fw = q->m_windowBeingDragged->floatingWindow();
-    if (!fw) {
+    WindowBeingDragged *windowBeingDragged = q->m_windowBeingDragged.get();
+    if (!windowBeingDragged->isValid()) {
         qCDebug(state) << "Canceling drag, window was deleted";
         Q_EMIT q->dragCanceled();
         return true;
     }
 
     if (!q->m_nonClientDrag)
-        fw->windowHandle()->setPosition(globalPos - q->m_offset);
+        windowBeingDragged->setPosition(globalPos - q->m_offset);
 
-
-    if (fw->anyNonDockable()) {
+    if (windowBeingDragged->anyNonDockable()) {
         qCDebug(state) << "StateDragging: Ignoring non dockable floating window";
         return true;
     }
@@ -253,7 +379,8 @@ bool StateDragging::handleMouseMove(QPoint globalPos)
             }
         }
 
-        dropArea->hover(fw, globalPos);
+        DragPhaseTimer timer(q, DragController::DragPhase_Hover);
+        dropArea->hover(windowBeingDragged, globalPos);
     }
 
     q->m_currentDropArea = dropArea;
@@ -270,6 +397,13 @@ DragController::DragController(QObject *)
 
     qCDebug(creation) << "DragController()";
 
+    m_pendingMoveTimer.setSingleShot(true);
+    m_pendingMoveTimer.setInterval(0);
+    connect(&m_pendingMoveTimer, &QTimer::timeout, this, &DragController::applyPendingMove);
+
+    m_systemMoveTimer.setInterval(16); // Hovering only needs to keep up with the display
+    connect(&m_systemMoveTimer, &QTimer::timeout, this, &DragController::pollSystemMove);
+
     auto stateNone = new StateNone(this);
     auto statepreDrag = new StatePreDrag(this);
     auto stateDragging = new StateDragging(this);
@@ -293,12 +427,14 @@ DragController *DragController::instance()
 void DragController::registerDraggable(Draggable *drg)
 {
     m_draggables << drg;
+    m_draggablesByWidget.insert(drg->asWidget(), drg);
     drg->asWidget()->installEventFilter(this);
 }
 
 void DragController::unregisterDraggable(Draggable *drg)
 {
     m_draggables.removeOne(drg);
+    m_draggablesByWidget.remove(drg->asWidget());
     drg->asWidget()->removeEventFilter(this);
 }
 
@@ -357,7 +493,7 @@ bool DragController::eventFilter(QObject *o, QEvent *e)
     if (m_nonClientDrag && e->type() == QEvent::Move) {
         // On Windows, non-client mouse moves are only sent at the end, so we must fake it:
         qCDebug(mouseevents) << "DragController::eventFilter e=" << e->type() << "; o=" << o;
-        activeState()->handleMouseMove(QCursor::pos());
+        handleMouseMove(QCursor::pos());
         return QStateMachine::eventFilter(o, e);
     }
 
@@ -371,6 +507,17 @@ bool DragController::eventFilter(QObject *o, QEvent *e)
 
     qCDebug(mouseevents) << "DragController::eventFilter e=" << e->type() << "; o=" << o;
 
+    if (e->type() == QEvent::MouseButtonPress || e->type() == QEvent::NonClientAreaMouseButtonPress) {
+        // Touch and pen drags stay on the synthesized mouse events, so taps still click the tabs and
+        // title bar buttons. They're just handled like the high-frequency input they are.
+        m_highFrequencyInput = (Config::self().flags() & Config::Flag_TouchAndPenInput) &&
+                               me->source() != Qt::MouseEventNotSynthesized;
+        m_motionPredictor.reset();
+    }
+
+    if (m_highFrequencyInput)
+        m_motionPredictor.addSample(me->globalPos(), me->timestamp());
+
     switch (e->type()) {
     case QEvent::NonClientAreaMouseButtonPress: {
         if (auto fw = qobject_cast<FloatingWindow*>(o)) {
@@ -389,10 +536,13 @@ bool DragController::eventFilter(QObject *o, QEvent *e)
         else break;
     case QEvent::MouseButtonRelease:
     case QEvent::NonClientAreaMouseButtonRelease:
+        // So we drop at the latest position, not where it was predicted to go
+        m_motionPredictor.reset();
+        applyPendingMove();
         return activeState()->handleMouseButtonRelease(me->globalPos());
     case QEvent::NonClientAreaMouseMove:
     case QEvent::MouseMove:
-        return activeState()->handleMouseMove(me->globalPos());
+        return handleMouseMove(me->globalPos());
     default:
         break;
     }
@@ -400,6 +550,124 @@ bool DragController::eventFilter(QObject *o, QEvent *e)
     return QStateMachine::eventFilter(o, e);
 }
 
+bool DragController::handleMouseMove(QPoint globalPos)
+{
+    if (!isDragging() || !(m_highFrequencyInput || (Config::self().flags() & Config::Flag_CoalesceDragMoves)))
+        return activeState()->handleMouseMove(globalPos);
+
+    // Only the latest position matters, moves queued behind it would just make the window trail the cursor
+    m_pendingMovePos = globalPos;
+    m_hasPendingMove = true;
+    if (!m_pendingMoveTimer.isActive())
+        m_pendingMoveTimer.start();
+
+    return true;
+}
+
+void DragController::applyPendingMove()
+{
+    m_pendingMoveTimer.stop();
+    if (!m_hasPendingMove)
+        return;
+
+    m_hasPendingMove = false;
+    activeState()->handleMouseMove(m_motionPredictor.predicted(m_pendingMovePos));
+}
+
+bool DragController::startSystemMove()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0) && defined(KDDOCKWIDGETS_QTWIDGETS)
+    if (m_windowBeingDragged->isPreview())
+        return false; // The preview isn't a real window, it must follow setPosition()
+
+    QWidget *topLevel = m_windowBeingDragged->topLevel();
+    if (!topLevel || !topLevel->windowHandle())
+        return false;
+
+    // The window manager grabs the pointer now
+    m_windowBeingDragged->grabMouse(false);
+    if (!topLevel->windowHandle()->startSystemMove()) {
+        m_windowBeingDragged->grabMouse(true);
+        return false;
+    }
+
+    qCDebug(state) << Q_FUNC_INFO << "Window manager is moving" << topLevel;
+    m_nonClientDrag = true; // So we stop calling setPosition()
+    m_lastSystemMovePos = QCursor::pos();
+    m_systemMoveTimer.start();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void DragController::pollSystemMove()
+{
+    if (!isDragging()) {
+        m_systemMoveTimer.stop();
+        return;
+    }
+
+    const QPoint globalPos = QCursor::pos();
+    if (!(QGuiApplication::mouseButtons() & Qt::LeftButton)) {
+        // The window manager swallowed the release
+        m_systemMoveTimer.stop();
+        applyPendingMove();
+        activeState()->handleMouseButtonRelease(globalPos);
+        return;
+    }
+
+    if (globalPos != m_lastSystemMovePos) {
+        m_lastSystemMovePos = globalPos;
+        handleMouseMove(globalPos);
+    }
+}
+
+void DragController::setTimingEnabled(bool enabled)
+{
+    m_timingEnabled = enabled;
+}
+
+bool DragController::timingEnabled() const
+{
+    return m_timingEnabled;
+}
+
+DragController::DragTimings DragController::lastDragTimings() const
+{
+    DragTimings timings(DragPhase_Count);
+    for (int i = 0; i < DragPhase_Count; ++i) {
+        QVector<qint64> samples = m_phaseSamples[i];
+        std::sort(samples.begin(), samples.end());
+
+        PhaseTiming &timing = timings[i];
+        timing.samples = samples.size();
+        timing.p50 = percentile(samples, 50);
+        timing.p99 = percentile(samples, 99);
+        timing.max = samples.isEmpty() ? 0 : samples.constLast();
+    }
+
+    return timings;
+}
+
+void DragController::dumpLastDragTimings() const
+{
+    const DragTimings timings = lastDragTimings();
+    const QMetaEnum phaseEnum = QMetaEnum::fromType<DragPhase>();
+    for (int i = 0; i < DragPhase_Count; ++i) {
+        const PhaseTiming &timing = timings.at(i);
+        qDebug() << phaseEnum.valueToKey(i) << "samples=" << timing.samples
+                 << "; p50=" << timing.p50 << "us; p99=" << timing.p99
+                 << "us; max=" << timing.max << "us";
+    }
+}
+
+void DragController::recordPhase(DragPhase phase, qint64 usecs) const
+{
+    m_phaseSamples[phase].push_back(usecs);
+    m_timingsPending = true;
+}
+
 StateBase *DragController::activeState() const
 {
     auto set = configuration();
@@ -408,47 +676,118 @@ StateBase *DragController::activeState() const
     return static_cast<StateBase *>(*(set.begin()));
 }
 
-#if defined(Q_OS_WIN)
-static QWidget *qtTopLevelForHWND(HWND hwnd)
+#if defined(Q_OS_WIN) && defined(KDDOCKWIDGETS_QTWIDGETS)
+void DragController::clearHWNDCache() const
+{
+    m_topLevelsByHWND.clear();
+    m_foreignHWNDs.clear();
+    m_qwinWidgetsByParentHWND.clear();
+    m_hwndCacheGeneration = -1;
+}
+
+void DragController::updateHWNDCache() const
+{
+    const int generation = DockRegistry::self()->topLevelsGeneration();
+    if (m_hwndCacheGeneration == generation)
+        return;
+
+    clearHWNDCache();
+    m_hwndCacheGeneration = generation;
+
+    // Index QWinWidgets by the foreign HWND hosting them, instead of comparing class names for each HWND under the cursor
+    const QWidgetList topLevelWidgets = qApp->topLevelWidgets();
+    for (QWidget *topLevel : topLevelWidgets) {
+        if (QLatin1String(topLevel->metaObject()->className()) != QLatin1String("QWinWidget") || !topLevel->windowHandle())
+            continue;
+
+        m_qwinWidgetsByParentHWND.insert(WId(GetParent(HWND(topLevel->windowHandle()->winId()))), topLevel);
+    }
+}
+
+QWidget *DragController::qtTopLevelForHWND(WId hwnd) const
 {
-    auto topLevels = qApp->topLevelWidgets();
-    for (auto topLevel : topLevels) {
-        if (hwnd == (HWND)topLevel->winId())
-            return topLevel;
+    updateHWNDCache();
+
+    if (m_foreignHWNDs.contains(hwnd))
+        return nullptr;
+
+    if (QWidget *w = m_topLevelsByHWND.value(hwnd))
+        return w;
+
+    // QWidget::find() is a hash lookup, no need to go through all top-levels
+    QWidget *w = QWidget::find(hwnd);
+    if (w && w->isWindow()) {
+        m_topLevelsByHWND.insert(hwnd, w);
+        return w;
     }
 
     qCDebug(toplevels) << Q_FUNC_INFO << "Couldn't find hwnd for top-level" << hwnd;
+    m_foreignHWNDs.insert(hwnd);
     return nullptr;
 }
+
+QList<QPointer<QWidget>> DragController::qwinWidgetsForHWND(WId hwnd) const
+{
+    updateHWNDCache();
+    return m_qwinWidgetsByParentHWND.values(hwnd);
+}
 #endif
 template <typename T>
-static QWidget* qtTopLevelUnderCursor_impl(QPoint globalPos, const QVector<T> &topLevels, T windowBeingDragged)
+static void collectTopLevels(QVector<QPointer<QWidgetOrQuick>> &result, const QVector<T> &topLevels, QWidget *windowBeingDragged)
 {
+    // topLevels is sorted by z-order, bottom-most first
     for (int i = topLevels.size() -1; i >= 0; --i) {
         auto tl = topLevels.at(i);
-        if (!tl->isVisible() || tl == windowBeingDragged || tl->isMinimized())
+        if (tl == windowBeingDragged)
             continue;
 
         if (windowBeingDragged && windowBeingDragged->window() == tl->window())
             continue;
 
-        if (tl->geometry().contains(globalPos)) {
-            qCDebug(toplevels) << Q_FUNC_INFO << "Found top-level" << tl;
-            return tl;
-        }
+        result.push_back(tl);
     }
+}
 
-    return nullptr;
+void DragController::updateTopLevelSnapshot() const
+{
+    m_topLevelSnapshot.clear();
+    m_topLevelSnapshotGeneration = DockRegistry::self()->topLevelsGeneration();
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    // On Linux we don't have API to check the z-order of top-levels. So first check the floating windows
+    // and check the MainWindow last, as the MainWindow will have lower z-order as it's a parent (TODO: How will it work with multiple MainWindows ?)
+    // The floating window list is sorted by z-order, as we catch QEvent::Expose and move it to last of the list
+    QWidget *tlwBeingDragged = m_windowBeingDragged ? m_windowBeingDragged->topLevel() : nullptr;
+    collectTopLevels(m_topLevelSnapshot, DockRegistry::self()->nestedwindows(), tlwBeingDragged);
+    collectTopLevels(m_topLevelSnapshot, DockRegistry::self()->topLevels(/*excludeFloating=*/true), tlwBeingDragged);
+#else
+    // QtQuick: Each FloatingWindow and MainWindow is the content item of its own QQuickWindow.
+    // Same order as above, floating windows first, top-most first.
+    const QWidgetOrQuick *tlBeingDragged = m_windowBeingDragged ? m_windowBeingDragged->topLevel() : nullptr;
+    const QQuickWindow *windowBeingDragged = tlBeingDragged ? tlBeingDragged->QQuickItem::window() : nullptr;
+    auto collect = [this, windowBeingDragged](QWidgetOrQuick *tl) {
+        if (!windowBeingDragged || tl->QQuickItem::window() != windowBeingDragged)
+            m_topLevelSnapshot.push_back(tl);
+    };
+
+    const QVector<FloatingWindow *> floatingWindows = DockRegistry::self()->nestedwindows();
+    for (int i = floatingWindows.size() - 1; i >= 0; --i)
+        collect(floatingWindows.at(i));
+
+    const MainWindowBase::List mainWindows = DockRegistry::self()->mainwindows();
+    for (int i = mainWindows.size() - 1; i >= 0; --i)
+        collect(mainWindows.at(i));
+#endif
 }
 
 QWidgetOrQuick *DragController::qtTopLevelUnderCursor() const
 {
+    DragPhaseTimer timer(this, DragPhase_TopLevelUnderCursor);
 #ifdef KDDOCKWIDGETS_QTWIDGETS
 
     QPoint globalPos = QCursor::pos();
 
     if (qApp->platformName() == QLatin1String("windows")) { // So -platform offscreen on Windows doesn't use this
-        auto topLevels = qApp->topLevelWidgets();
 # if defined(Q_OS_WIN)
         POINT globalNativePos;
         if (!GetCursorPos(&globalNativePos))
@@ -456,7 +795,7 @@ QWidgetOrQuick *DragController::qtTopLevelUnderCursor() const
 
         // There might be windows that don't belong to our app in between, so use win32 to travel by z-order.
         // Another solution is to set a parent on all top-levels. But this code is orthogonal.
-        HWND hwnd = HWND(m_windowBeingDragged->floatingWindow()->winId());
+        HWND hwnd = HWND(m_windowBeingDragged->topLevel()->winId());
         while (hwnd) {
             hwnd = GetWindow(hwnd, GW_HWNDNEXT);
             RECT r;
@@ -466,21 +805,18 @@ QWidgetOrQuick *DragController::qtTopLevelUnderCursor() const
             if (!PtInRect(&r, globalNativePos)) // Check if window is under cursor
                 continue;
 
-            if (auto tl = qtTopLevelForHWND(hwnd)) {
+            if (auto tl = qtTopLevelForHWND(WId(hwnd))) {
                 if (tl->geometry().contains(globalPos) && tl->objectName() != QStringLiteral("_docks_IndicatorWindow_Overlay")) {
                     qCDebug(toplevels) << Q_FUNC_INFO << "Found top-level" << tl;
                     return tl;
                 }
             } else {
                 // Maybe it's embedded in a QWinWidget:
-                for (auto topLevel : topLevels) {
-                    if (QLatin1String(topLevel->metaObject()->className()) == QLatin1String("QWinWidget")) {
-                        if (hwnd == GetParent(HWND(topLevel->windowHandle()->winId()))) {
-                            if (topLevel->rect().contains(topLevel->mapFromGlobal(globalPos)) && topLevel->objectName() != QStringLiteral("_docks_IndicatorWindow_Overlay")) {
-                                qCDebug(toplevels) << Q_FUNC_INFO << "Found top-level" << topLevel;
-                                return topLevel;
-                            }
-                        }
+                const QList<QPointer<QWidget>> qwinWidgets = qwinWidgetsForHWND(WId(hwnd));
+                for (QWidget *topLevel : qwinWidgets) {
+                    if (topLevel && topLevel->rect().contains(topLevel->mapFromGlobal(globalPos)) && topLevel->objectName() != QStringLiteral("_docks_IndicatorWindow_Overlay")) {
+                        qCDebug(toplevels) << Q_FUNC_INFO << "Found top-level" << topLevel;
+                        return topLevel;
                     }
                 }
 
@@ -493,21 +829,35 @@ QWidgetOrQuick *DragController::qtTopLevelUnderCursor() const
     } else {
         // !Windows: Linux, macOS, offscreen (offscreen on Windows too), etc.
 
-        // On Linux we don't have API to check the z-order of top-levels. So first check the floating windows
-        // and check the MainWindow last, as the MainWindow will have lower z-order as it's a parent (TODO: How will it work with multiple MainWindows ?)
-        // The floating window list is sorted by z-order, as we catch QEvent::Expose and move it to last of the list
+        if (m_topLevelSnapshotGeneration != DockRegistry::self()->topLevelsGeneration())
+            updateTopLevelSnapshot();
 
-        FloatingWindow *tlwBeingDragged = m_windowBeingDragged->floatingWindow();
-        if (auto tl = qtTopLevelUnderCursor_impl(globalPos, DockRegistry::self()->nestedwindows(), tlwBeingDragged))
-            return tl;
+        for (const QPointer<QWidgetOrQuick> &tl : qAsConst(m_topLevelSnapshot)) {
+            if (!tl || !tl->isVisible() || tl->isMinimized())
+                continue;
 
-        return qtTopLevelUnderCursor_impl<QWidget*>(globalPos,
-                                                    DockRegistry::self()->topLevels(/*excludeFloating=*/true),
-                                                    tlwBeingDragged);
+            if (tl->geometry().contains(globalPos)) {
+                qCDebug(toplevels) << Q_FUNC_INFO << "Found top-level" << tl;
+                return tl;
+            }
+        }
     }
 #else
-    // QtQuick:
-    qWarning() << Q_FUNC_INFO << "Implement me!";
+    // QtQuick: There's no native z-order walk, use the snapshot, like the non-Windows QtWidgets path
+    if (m_topLevelSnapshotGeneration != DockRegistry::self()->topLevelsGeneration())
+        updateTopLevelSnapshot();
+
+    const QPoint globalPos = QCursor::pos();
+    for (const QPointer<QWidgetOrQuick> &tl : qAsConst(m_topLevelSnapshot)) {
+        QQuickWindow *window = tl ? tl->QQuickItem::window() : nullptr;
+        if (!window || !window->isVisible() || window->windowState() == Qt::WindowMinimized)
+            continue;
+
+        if (window->geometry().contains(globalPos)) {
+            qCDebug(toplevels) << Q_FUNC_INFO << "Found top-level" << tl;
+            return tl;
+        }
+    }
 #endif
 
     qCDebug(toplevels) << Q_FUNC_INFO << "No top-level found";
@@ -516,6 +866,7 @@ QWidgetOrQuick *DragController::qtTopLevelUnderCursor() const
 
 DropArea *DragController::dropAreaUnderCursor() const
 {
+    DragPhaseTimer timer(this, DragPhase_DropAreaUnderCursor);
     auto topLevel = qtTopLevelUnderCursor();
     if (!topLevel) {
         //qCDebug(state) << "DragController::dropAreaUnderCursor: null";
@@ -530,6 +881,12 @@ DropArea *DragController::dropAreaUnderCursor() const
         return fw->dropArea();
     }
 
+#ifndef KDDOCKWIDGETS_QTWIDGETS
+    // QtQuick has no childAt(), but a MainWindow already knows its drop area
+    if (auto mw = qobject_cast<MainWindowBase *>(topLevel))
+        return mw->dropArea();
+#endif
+
     if (topLevel->objectName() == QStringLiteral("_docks_IndicatorWindow")) {
         qWarning() << "Indicator window should be hidden " << topLevel << topLevel->isVisible();
         Q_ASSERT(false);
@@ -537,7 +894,7 @@ DropArea *DragController::dropAreaUnderCursor() const
 
     if (auto dock = qobject_cast<DockWidgetBase *>(topLevel)) {
         FloatingWindow *fw = dock->morphIntoFloatingWindow();
-        m_windowBeingDragged->floatingWindow()->raise();
+        m_windowBeingDragged->topLevel()->raise();
         return fw->dropArea();
     }
 
@@ -555,10 +912,5 @@ DropArea *DragController::dropAreaUnderCursor() const
 
 Draggable *DragController::draggableForQObject(QObject *o) const
 {
-    for (auto draggable : m_draggables)
-        if (draggable->asWidget() == o) {
-            return draggable;
-        }
-
-    return nullptr;
+    return m_draggablesByWidget.value(o);
 }
@@ -24,9 +24,15 @@
 #include "TitleBar_p.h"
 #include "TabWidget_p.h"
 #include "WindowBeingDragged_p.h"
+#include "multisplitter/PointerInput_p.h"
 
 #include <QStateMachine>
 #include <QPoint>
+#include <QPointer>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QTimer>
 #include <memory>
 
 namespace KDDockWidgets {
@@ -35,8 +41,9 @@ class StateBase;
 class DropArea;
 class Draggable;
 class FallbackMouseGrabber;
+class DragPhaseTimer;
 
-class DragController : public QStateMachine
+class DOCKS_EXPORT_FOR_UNIT_TESTS DragController : public QStateMachine
 {
     Q_OBJECT
 public:
@@ -47,6 +54,27 @@ public:
     };
     Q_ENUM(State)
 
+    ///@brief The phases of a drag that can be timed. See setTimingEnabled()
+    enum DragPhase {
+        DragPhase_TopLevelUnderCursor = 0, ///< Finding the top-level under the cursor
+        DragPhase_DropAreaUnderCursor, ///< Finding the drop area under the cursor, includes DragPhase_TopLevelUnderCursor
+        DragPhase_Hover, ///< DropArea::hover(), includes updating the drop indicators
+        DragPhase_Drop, ///< DropArea::drop()
+        DragPhase_Count
+    };
+    Q_ENUM(DragPhase)
+
+    ///@brief Timing statistics for one phase of a drag, in microseconds
+    struct PhaseTiming {
+        int samples = 0;
+        qint64 p50 = 0;
+        qint64 p99 = 0;
+        qint64 max = 0;
+    };
+
+    ///@brief The timings of a drag, indexed by DragPhase
+    typedef QVector<PhaseTiming> DragTimings;
+
     static DragController *instance();
 
     // Registers something that wants to be able to be dragged
@@ -60,12 +88,26 @@ public:
     void grabMouseFor(QWidgetOrQuick *);
     void releaseMouse(QWidgetOrQuick *);
 
+    ///@brief Enables measuring how long each phase of a drag takes. Disabled by default.
+    ///When enabled, dragTimingsAvailable() is emitted at the end of each drag.
+    void setTimingEnabled(bool);
+    bool timingEnabled() const;
+
+    ///@brief Returns the per-phase timings of the last drag. Requires timingEnabled()
+    DragTimings lastDragTimings() const;
+
+    ///@brief Dumps lastDragTimings() to stderr
+    void dumpLastDragTimings() const;
+
 Q_SIGNALS:
     void mousePressed();
     void manhattanLengthMove();
     void dragCanceled();
     void dropped();
 
+    ///@brief emitted after a drag finishes, if timingEnabled(). See lastDragTimings()
+    void dragTimingsAvailable();
+
 protected:
     bool eventFilter(QObject *, QEvent *) override;
 
@@ -75,28 +117,95 @@ private:
     friend class StatePreDrag;
     friend class StateDragging;
     friend class StateDropped;
+    friend class DragPhaseTimer;
 
     DragController(QObject * = nullptr);
     StateBase *activeState() const;
     QWidgetOrQuick *qtTopLevelUnderCursor() const;
+
+    ///@brief Collects the top-levels we can drop into, top-most first, excluding the window being dragged
+    void updateTopLevelSnapshot() const;
+
+#if defined(Q_OS_WIN) && defined(KDDOCKWIDGETS_QTWIDGETS)
+    ///@brief Returns the Qt top-level for @p hwnd, or nullptr if it belongs to another app. Cached per drag.
+    QWidget *qtTopLevelForHWND(WId hwnd) const;
+
+    ///@brief Returns the QWinWidgets embedded in the foreign window @p hwnd
+    QList<QPointer<QWidget>> qwinWidgetsForHWND(WId hwnd) const;
+
+    ///@brief Clears the HWND caches, so they're rebuilt on the next lookup
+    void clearHWNDCache() const;
+
+    ///@brief Rebuilds the HWND caches if DockRegistry's top-levels changed since they were built
+    void updateHWNDCache() const;
+#endif
     DropArea *dropAreaUnderCursor() const;
     Draggable *draggableForQObject(QObject *o) const;
+
+    ///@brief Handles a mouse move, or just queues it if Flag_CoalesceDragMoves is set or if
+    ///the drag is from a touch screen or a pen
+    bool handleMouseMove(QPoint globalPos);
+
+    ///@brief Processes the move queued by handleMouseMove(), if any
+    void applyPendingMove();
+
+    ///@brief Hands moving the window being dragged to the window manager. See Flag_SystemMoveResize
+    ///Returns false if not supported, in which case we set the position ourselves.
+    bool startSystemMove();
+
+    ///@brief While the window manager moves the window we don't get mouse events. Feeds the cursor position instead.
+    void pollSystemMove();
+
+    void recordPhase(DragPhase, qint64 usecs) const;
     QPoint m_pressPos;
     QPoint m_offset;
 
     Draggable::List m_draggables;
+    QHash<const QObject *, Draggable *> m_draggablesByWidget; // So the event filter doesn't scan m_draggables
     Draggable *m_draggable = nullptr;
     std::unique_ptr<WindowBeingDragged> m_windowBeingDragged;
     DropArea *m_currentDropArea = nullptr;
     bool m_nonClientDrag = false;
     FallbackMouseGrabber *m_fallbackMouseGrabber = nullptr;
+
+    // Taken when the drag starts, refreshed only when DockRegistry's list of top-levels changes.
+    // Visibility and geometry are still checked on each mouse move.
+    mutable QVector<QPointer<QWidgetOrQuick>> m_topLevelSnapshot;
+    mutable int m_topLevelSnapshotGeneration = -1;
+
+#if defined(Q_OS_WIN) && defined(KDDOCKWIDGETS_QTWIDGETS)
+    // Same lifetime as m_topLevelSnapshot, so the z-order walk doesn't look up each HWND on every mouse move
+    mutable QHash<WId, QPointer<QWidget>> m_topLevelsByHWND;
+    mutable QSet<WId> m_foreignHWNDs;
+    mutable QMultiHash<WId, QPointer<QWidget>> m_qwinWidgetsByParentHWND;
+    mutable int m_hwndCacheGeneration = -1;
+#endif
+
+    // For Flag_CoalesceDragMoves
+    QTimer m_pendingMoveTimer;
+    QPoint m_pendingMovePos;
+    bool m_hasPendingMove = false;
+
+    // For Flag_TouchAndPenInput. Whether the mouse events are synthesized from a touch screen or a pen
+    bool m_highFrequencyInput = false;
+    Layouting::MotionPredictor m_motionPredictor;
+
+    // For Flag_SystemMoveResize
+    QTimer m_systemMoveTimer;
+    QPoint m_lastSystemMovePos;
+
+    // For timing, see setTimingEnabled()
+    bool m_timingEnabled = false;
+    mutable bool m_timingsPending = false;
+    mutable QVector<qint64> m_phaseSamples[DragPhase_Count];
 };
 
 class StateBase : public QState
 {
     Q_OBJECT
 public:
-    explicit StateBase(DragController *parent);
+    ///@param traceName the name of the state's events in the trace, see Config::setTraceBackend()
+    StateBase(DragController *parent, const char *traceName);
     ~StateBase();
 
     // Not using QEvent here, to abstract platform differences regarding production of such events
@@ -137,6 +246,10 @@ public:
     void onEntry(QEvent *) override;
     bool handleMouseButtonRelease(QPoint globalPos) override;
     bool handleMouseMove(QPoint globalPos) override;
+
+private:
+    ///@brief Detaches and drops the preview source, see Config::Flag_DragWithPreview
+    bool handlePreviewRelease();
 };
 
 }
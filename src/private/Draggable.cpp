@@ -22,6 +22,7 @@
 #include "DragController_p.h"
 #include "FloatingWindow_p.h"
 #include "WidgetResizeHandler_p.h"
+#include "Config.h"
 
 #include <QApplication>
 
@@ -40,22 +41,34 @@ public:
     QPointer<WidgetResizeHandler> widgetResizeHandler;
     QWidgetOrQuick *const thisWidget;
     const bool enabled;
+    bool registered = false; // With DragController, unless the layout is locked
 };
 
 Draggable::Draggable(QWidgetOrQuick *thisWidget, bool enabled)
     : d(new Private(thisWidget, enabled))
 {
-    if (thisWidget && d->enabled)
-        DragController::instance()->registerDraggable(this);
+    setDraggingLocked(Config::self().isLayoutLocked());
 }
 
 Draggable::~Draggable()
 {
-    if (d->thisWidget && d->enabled)
-        DragController::instance()->unregisterDraggable(this);
+    setDraggingLocked(true);
     delete d;
 }
 
+void Draggable::setDraggingLocked(bool locked)
+{
+    const bool registered = d->thisWidget && d->enabled && !locked;
+    if (registered == d->registered)
+        return;
+
+    d->registered = registered;
+    if (registered)
+        DragController::instance()->registerDraggable(this);
+    else
+        DragController::instance()->unregisterDraggable(this);
+}
+
 QWidgetOrQuick *Draggable::asWidget() const
 {
     return d->thisWidget;
@@ -74,6 +74,12 @@ public:
     WidgetResizeHandler *widgetResizeHandler() const;
     void setWidgetResizeHandler(WidgetResizeHandler *w);
 
+    /**
+     * @brief Stops or resumes listening to the mouse for drags, for locked layouts.
+     * Starts locked if Config::isLayoutLocked(). See MainWindowBase::setLayoutLocked().
+     */
+    void setDraggingLocked(bool locked);
+
 
     /**
      * @brief If this draggable contains a single dock widget, then it's returned.
@@ -23,11 +23,15 @@
 #include "DockWidgetBase.h"
 #include "Draggable_p.h"
 #include "FloatingWindow_p.h"
+#include "Frame_p.h"
+#include "FramePool_p.h"
 #include "Config.h"
+#include "DockRegistry_p.h"
 #include "DropIndicatorOverlayInterface_p.h"
 #include "FrameworkWidgetFactory.h"
 #include "MainWindowBase.h"
 #include "multisplitter/Item_p.h"
+#include "multisplitter/Tracing_p.h"
 
 // #include "indicators/AnimatedIndicators_p.h"
 #include "WindowBeingDragged_p.h"
@@ -40,11 +44,13 @@ using namespace KDDockWidgets;
  *
  * @author Sérgio Martins \<sergio.martins@kdab.com\>
  */
-DropArea::DropArea(QWidgetOrQuick *parent)
+DropArea::DropArea(QWidgetOrQuick *parent, bool layoutLocked)
     : MultiSplitter(parent)
-    , m_dropIndicatorOverlay(Config::self().frameworkWidgetFactory()->createDropIndicatorOverlay(this))
+    , m_layoutLocked(layoutLocked || Config::self().isLayoutLocked())
 {
     qCDebug(creation) << "DropArea";
+    if (!m_layoutLocked)
+        m_dropIndicatorOverlay = Config::self().frameworkWidgetFactory()->createDropIndicatorOverlay(this);
 }
 
 DropArea::~DropArea()
@@ -60,17 +66,15 @@ int DropArea::numFrames() const
 
 Frame *DropArea::frameContainingPos(QPoint globalPos) const
 {
-    const Layouting::Item::List &items = m_layout->items();
-    for (Layouting::Item *item : items) {
-        auto frame = static_cast<Frame*>(item->widget());
-        if (!frame || !frame->isVisible()) {
-            continue;
-        }
-
-        if (frame->containsMouse(globalPos))
-            return frame;
-    }
-    return nullptr;
+    // Descend the layout tree instead of testing every frame, as each container knows how its
+    // children are laid out
+    const QPoint localPos = mapFromGlobal(globalPos);
+    Layouting::Item *item = m_layout->rootItem()->itemAt_recursive(localPos);
+    auto frame = item ? static_cast<Frame*>(item->widget()) : nullptr;
+    if (!frame || !frame->isVisible())
+        return nullptr;
+
+    return frame;
 }
 
 Layouting::Item *DropArea::centralFrame() const
@@ -113,11 +117,11 @@ void DropArea::addDockWidget(DockWidgetBase *dw, Location location, DockWidgetBa
             // The frame only has this dock widget, and the frame is already in the layout. So move the frame instead
             frame = oldFrame;
         } else {
-            frame = Config::self().frameworkWidgetFactory()->createFrame();
+            frame = FramePool::self()->frame();
             frame->addWidget(dw);
         }
     } else {
-        frame = Config::self().frameworkWidgetFactory()->createFrame();
+        frame = FramePool::self()->frame();
         frame->addWidget(dw);
     }
 
@@ -149,6 +153,24 @@ QString DropArea::affinityName() const
     return QString();
 }
 
+void DropArea::setLayoutLocked(bool locked)
+{
+    if (locked != m_layoutLocked) {
+        m_layoutLocked = locked;
+        if (locked) {
+            delete m_dropIndicatorOverlay;
+            m_dropIndicatorOverlay = nullptr;
+        } else {
+            m_dropIndicatorOverlay = Config::self().frameworkWidgetFactory()->createDropIndicatorOverlay(this);
+        }
+    }
+
+    // Also when unchanged, as frames restored or moved in might not know yet
+    const auto frames = m_layout->frames();
+    for (Frame *frame : frames)
+        frame->setLayoutLocked(locked);
+}
+
 void DropArea::layoutEqually()
 {
     m_layout->layoutEqually();
@@ -171,22 +193,38 @@ void DropArea::hover(FloatingWindow *floatingWindow, QPoint globalPos)
         return;
 
     Frame *frame = frameContainingPos(globalPos); // Frame is nullptr if MainWindowOption_HasCentralFrame isn't set
-    m_dropIndicatorOverlay->setWindowBeingDragged(floatingWindow);
-    m_dropIndicatorOverlay->setHoveredFrame(frame);
-    m_dropIndicatorOverlay->hover(globalPos);
+    updateHover(floatingWindow, frame, globalPos);
 }
 
-static bool isOutterLocation(DropIndicatorOverlayInterface::DropLocation location)
+void DropArea::hover(WindowBeingDragged *windowBeingDragged, QPoint globalPos)
 {
-    switch (location) {
-    case DropIndicatorOverlayInterface::DropLocation_OutterLeft:
-    case DropIndicatorOverlayInterface::DropLocation_OutterTop:
-    case DropIndicatorOverlayInterface::DropLocation_OutterRight:
-    case DropIndicatorOverlayInterface::DropLocation_OutterBottom:
-        return true;
-    default:
-        return false;
+    if (!windowBeingDragged->isPreview()) {
+        hover(windowBeingDragged->floatingWindow(), globalPos);
+        return;
     }
+
+    if (!validateAffinity(windowBeingDragged))
+        return;
+
+    Frame *frame = frameContainingPos(globalPos);
+    if (frame == windowBeingDragged->draggedWidget()) {
+        // The previewed frame is still in the layout, it can't be dropped relative to itself
+        frame = nullptr;
+    }
+
+    updateHover(windowBeingDragged->draggedWidget(), frame, globalPos);
+}
+
+void DropArea::updateHover(const QWidgetOrQuick *windowBeingDragged, Frame *hoveredFrame, QPoint globalPos)
+{
+    KDDW_TRACE_SCOPE("dock", "DropArea::hover");
+    if (!m_dropIndicatorOverlay)
+        return;
+
+    DockRegistry::self()->performanceCounters().dragHovers++;
+    m_dropIndicatorOverlay->setWindowBeingDragged(windowBeingDragged);
+    m_dropIndicatorOverlay->setHoveredFrame(hoveredFrame);
+    m_dropIndicatorOverlay->hover(globalPos);
 }
 
 bool DropArea::drop(FloatingWindow *droppedWindow, QPoint globalPos)
@@ -196,7 +234,7 @@ bool DropArea::drop(FloatingWindow *droppedWindow, QPoint globalPos)
         return false;
     }
 
-    if (m_dropIndicatorOverlay->currentDropLocation() == DropIndicatorOverlayInterface::DropLocation_None) {
+    if (!m_dropIndicatorOverlay || m_dropIndicatorOverlay->currentDropLocation() == DropIndicatorOverlayInterface::DropLocation_None) {
         qCDebug(hovering) << "DropArea::drop: bailing out, drop location = none";
         return false;
     }
@@ -205,14 +243,27 @@ bool DropArea::drop(FloatingWindow *droppedWindow, QPoint globalPos)
 
     hover(droppedWindow, globalPos);
     Frame *acceptingFrame = m_dropIndicatorOverlay->hoveredFrame();
-    if (!(acceptingFrame || isOutterLocation(m_dropIndicatorOverlay->currentDropLocation()))) {
+    if (!(acceptingFrame || DropIndicatorOverlayInterface::isOutterLocation(m_dropIndicatorOverlay->currentDropLocation()))) {
         qWarning() << "DropArea::drop: asserted with frame=" << acceptingFrame << "; Location=" << m_dropIndicatorOverlay->currentDropLocation();
         return false;
     }
 
+    return drop(droppedWindow, m_dropIndicatorOverlay->currentDropLocation(), acceptingFrame);
+}
+
+bool DropArea::drop(FloatingWindow *droppedWindow, DropIndicatorOverlayInterface::DropLocation droploc,
+                    Frame *acceptingFrame)
+{
+    KDDW_TRACE_SCOPE("dock", "DropArea::drop");
+    if (!acceptingFrame && !DropIndicatorOverlayInterface::isOutterLocation(droploc)) {
+        qWarning() << Q_FUNC_INFO << "Inner location without frame" << droploc;
+        return false;
+    }
+
+    // Each of the dropped frames changes the frame count of both windows
+    TitleBarVisibilityBatch titleBarBatch;
     bool result = true;
 
-    auto droploc = m_dropIndicatorOverlay->currentDropLocation();
     switch (droploc) {
     case DropIndicatorOverlayInterface::DropLocation_Left:
     case DropIndicatorOverlayInterface::DropLocation_Top:
@@ -234,7 +285,7 @@ bool DropArea::drop(FloatingWindow *droppedWindow, QPoint globalPos)
         break;
 
     default:
-        qWarning() << "DropArea::drop: Unexpected drop location" << m_dropIndicatorOverlay->currentDropLocation();
+        qWarning() << "DropArea::drop: Unexpected drop location" << droploc;
         result = false;
         break;
     }
@@ -253,7 +304,7 @@ bool DropArea::drop(QWidgetOrQuick *droppedWindow, KDDockWidgets::Location locat
         if (!validateAffinity(dock))
             return false;
 
-        auto frame = Config::self().frameworkWidgetFactory()->createFrame();
+        auto frame = FramePool::self()->frame();
         frame->addWidget(dock);
         m_layout->addWidget(frame, location, relativeTo, DefaultSizeMode::FairButFloor);
     } else if (auto floatingWindow = qobject_cast<FloatingWindow *>(droppedWindow)) {
@@ -273,6 +324,9 @@ bool DropArea::drop(QWidgetOrQuick *droppedWindow, KDDockWidgets::Location locat
 
 void DropArea::removeHover()
 {
+    if (!m_dropIndicatorOverlay)
+        return;
+
     m_dropIndicatorOverlay->setWindowBeingDragged(nullptr);
     m_dropIndicatorOverlay->setCurrentDropLocation(DropIndicatorOverlayInterface::DropLocation_None);
 }
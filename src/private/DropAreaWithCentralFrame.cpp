@@ -25,7 +25,7 @@
 using namespace KDDockWidgets;
 
 DropAreaWithCentralFrame::DropAreaWithCentralFrame(QWidgetOrQuick *parent, MainWindowOptions options)
-    : DropArea(parent)
+    : DropArea(parent, options & MainWindowOption_LockedLayout)
     , m_centralFrame(createCentralFrame(options))
 {
     if (m_centralFrame)
@@ -49,17 +49,32 @@ class DOCKS_EXPORT_FOR_UNIT_TESTS DropArea : public MultiSplitter
 {
     Q_OBJECT
 public:
-    explicit DropArea(QWidgetOrQuick *parent);
+    ///@brief A locked drop area has no drop indicators and accepts no drops, see setLayoutLocked()
+    explicit DropArea(QWidgetOrQuick *parent, bool layoutLocked = false);
     ~DropArea();
 
     void removeHover();
     void hover(FloatingWindow *floatingWindow, QPoint globalPos);
+
+    ///@brief overload that also supports previews, see Config::Flag_DragWithPreview
+    void hover(WindowBeingDragged *windowBeingDragged, QPoint globalPos);
+
     bool drop(FloatingWindow *droppedWindow, QPoint globalPos);
+
+    ///@brief Drops @p droppedWindow at @p location, which was computed while hovering
+    bool drop(FloatingWindow *droppedWindow, DropIndicatorOverlayInterface::DropLocation location,
+              Frame *acceptingFrame);
     bool drop(QWidgetOrQuick *droppedwindow, KDDockWidgets::Location location, Frame *relativeTo);
     int numFrames() const;
 
     Layouting::Item *centralFrame() const;
+    ///@brief Returns the drop indicators. nullptr while the layout is locked.
     DropIndicatorOverlayInterface *dropIndicatorOverlay() const { return m_dropIndicatorOverlay; }
+
+    ///@brief Creates or deletes the drop indicators, and locks or unlocks the frames.
+    ///See MainWindowBase::setLayoutLocked()
+    void setLayoutLocked(bool locked);
+    bool isLayoutLocked() const { return m_layoutLocked; }
     void addDockWidget(DockWidgetBase *, KDDockWidgets::Location location, DockWidgetBase *relativeTo, AddingOption option = {});
 
     bool checkSanity();
@@ -77,7 +92,9 @@ private:
     template <typename T>
     bool validateAffinity(T *) const;
     Frame *frameContainingPos(QPoint globalPos) const;
+    void updateHover(const QWidgetOrQuick *windowBeingDragged, Frame *hoveredFrame, QPoint globalPos);
     bool m_inDestructor = false;
+    bool m_layoutLocked;
     QString m_affinityName;
     DropIndicatorOverlayInterface *m_dropIndicatorOverlay = nullptr;
 };
@@ -34,10 +34,11 @@ DropIndicatorOverlayInterface::DropIndicatorOverlayInterface(DropArea *dropArea)
     setObjectName(QStringLiteral("DropIndicatorOverlayInterface"));
 }
 
-void DropIndicatorOverlayInterface::setWindowBeingDragged(const FloatingWindow *window)
+void DropIndicatorOverlayInterface::setWindowBeingDragged(const QWidgetOrQuick *window)
 {
     if (window != m_windowBeingDragged) {
         m_windowBeingDragged = window;
+        m_dropArea->multiSplitterLayout()->clearDropRectCache(); // New drag session
         if (m_windowBeingDragged) {
             setGeometry(m_dropArea->rect());
             raise();
@@ -94,6 +95,19 @@ KDDockWidgets::Location DropIndicatorOverlayInterface::multisplitterLocationFor(
     return KDDockWidgets::Location_None;
 }
 
+bool DropIndicatorOverlayInterface::isOutterLocation(DropIndicatorOverlayInterface::DropLocation location)
+{
+    switch (location) {
+    case DropIndicatorOverlayInterface::DropLocation_OutterLeft:
+    case DropIndicatorOverlayInterface::DropLocation_OutterTop:
+    case DropIndicatorOverlayInterface::DropLocation_OutterRight:
+    case DropIndicatorOverlayInterface::DropLocation_OutterBottom:
+        return true;
+    default:
+        return false;
+    }
+}
+
 void DropIndicatorOverlayInterface::onFrameDestroyed()
 {
     setHoveredFrame(nullptr);
@@ -58,7 +58,7 @@ public:
 
     explicit DropIndicatorOverlayInterface(DropArea *dropArea);
     void setHoveredFrame(Frame *);
-    void setWindowBeingDragged(const FloatingWindow *);
+    void setWindowBeingDragged(const QWidgetOrQuick *);
     bool isHovered() const;
     DropLocation currentDropLocation() const { return m_currentDropLocation; }
     Frame *hoveredFrame() const { return m_hoveredFrame; }
@@ -69,8 +69,15 @@ public:
 
     virtual QPoint posForIndicator(DropLocation) const = 0; // Used by unit-tests only
 
+    ///@brief Returns the window showing the indicators, if they're not shown by this overlay itself.
+    ///It might be shared with other overlays. For Config::memoryUsage()
+    virtual QWidgetOrQuick *indicatorWindow() const { return nullptr; }
+
     static KDDockWidgets::Location multisplitterLocationFor(DropLocation);
 
+    ///@brief Returns whether @p location docks to the outter edges of the whole drop area
+    static bool isOutterLocation(DropLocation location);
+
 Q_SIGNALS:
     void hoveredFrameChanged(KDDockWidgets::Frame *);
 
@@ -82,7 +89,7 @@ protected:
     virtual void updateVisibility() = 0;
     Frame *m_hoveredFrame = nullptr;
     DropLocation m_currentDropLocation = DropLocation_None;
-    QPointer<const FloatingWindow> m_windowBeingDragged;
+    QPointer<const QWidgetOrQuick> m_windowBeingDragged; // A FloatingWindow, or the preview source, see Config::Flag_DragWithPreview
     DropArea *const m_dropArea;
 };
 }
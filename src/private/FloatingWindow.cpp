@@ -31,6 +31,7 @@
 #include "DockRegistry_p.h"
 #include "Config.h"
 #include "FrameworkWidgetFactory.h"
+#include "FloatingWindowPool_p.h"
 
 #include <QApplication>
 #include <QCloseEvent>
@@ -91,7 +92,7 @@ FloatingWindow::FloatingWindow(MainWindowBase *parent)
     : QWidgetAdapter(parent, KDDockWidgets::usesNativeDraggingAndResizing() ? Qt::Window : Qt::Tool)
     , Draggable(this, KDDockWidgets::usesNativeDraggingAndResizing()) // FloatingWindow is only draggable when using a native title bar. Otherwise the KDDockWidgets::TitleBar is the draggable
     , m_titleBar(Config::self().frameworkWidgetFactory()->createTitleBar(this))
-    , m_dropArea(new DropArea(this))
+    , m_dropArea(new DropArea(this, parent && parent->isLayoutLocked()))
 {
 #ifdef Q_OS_WIN
     if (KDDockWidgets::usesAeroSnapWithCustomDecos()) {
@@ -102,6 +103,11 @@ FloatingWindow::FloatingWindow(MainWindowBase *parent)
 
     auto ms = m_dropArea->multiSplitterLayout();
 
+    if (m_dropArea->isLayoutLocked()) {
+        m_titleBar->setDraggingLocked(true);
+        setDraggingLocked(true);
+    }
+
     DockRegistry::self()->registerNestedWindow(this);
     qCDebug(creation) << "FloatingWindow()" << this;
 
@@ -171,6 +177,11 @@ static MainWindowBase* hackFindParentHarder(Frame *frame, MainWindowBase *candid
 
 FloatingWindow::FloatingWindow(Frame *frame, MainWindowBase *parent)
     : FloatingWindow(hackFindParentHarder(frame, parent))
+{
+    adoptFrame(frame);
+}
+
+void FloatingWindow::adoptFrame(Frame *frame)
 {
     m_disableSetVisible = true;
     // Adding a widget will trigger onFrameCountChanged, which triggers a setVisible(true).
@@ -180,6 +191,11 @@ FloatingWindow::FloatingWindow(Frame *frame, MainWindowBase *parent)
     m_disableSetVisible = false;
 }
 
+MainWindowBase *FloatingWindow::parentForFrame(Frame *frame)
+{
+    return hackFindParentHarder(frame, nullptr);
+}
+
 FloatingWindow::~FloatingWindow()
 {
     disconnect(m_layoutDestroyedConnection);
@@ -207,11 +223,27 @@ void FloatingWindow::maybeCreateResizeHandler()
     if (!KDDockWidgets::usesNativeDraggingAndResizing()) {
         setFlag(Qt::FramelessWindowHint, true);
 #ifdef KDDOCKWIDGETS_QTWIDGETS
-        setWidgetResizeHandler(new WidgetResizeHandler(this));
+        if (!m_dropArea->isLayoutLocked()) // Until unlocked, see setLayoutLocked()
+            setWidgetResizeHandler(new WidgetResizeHandler(this));
 #endif
     }
 }
 
+void FloatingWindow::setLayoutLocked(bool locked)
+{
+    m_dropArea->setLayoutLocked(locked);
+    m_titleBar->setDraggingLocked(locked);
+    setDraggingLocked(locked);
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (locked) {
+        delete widgetResizeHandler();
+    } else if (!widgetResizeHandler() && !KDDockWidgets::usesNativeDraggingAndResizing()) {
+        setWidgetResizeHandler(new WidgetResizeHandler(this));
+    }
+#endif
+}
+
 std::unique_ptr<WindowBeingDragged> FloatingWindow::makeWindow()
 {
     return std::unique_ptr<WindowBeingDragged>(new WindowBeingDragged(this, this));
@@ -231,14 +263,15 @@ DockWidgetBase *FloatingWindow::singleDockWidget() const
 
 const Frame::List FloatingWindow::frames() const
 {
-    return findChildren<Frame *>(QString(), Qt::FindChildrenRecursively);
+    // From the layout, not the QObject tree, as that includes all of the guests' children
+    return m_dropArea->multiSplitterLayout()->frames();
 }
 
 void FloatingWindow::scheduleDeleteLater()
 {
     m_beingDeleted = true;
     DockRegistry::self()->unregisterNestedWindow(this);
-    deleteLater();
+    DockRegistry::self()->scheduleDelete(this);
 }
 
 MultiSplitterLayout *FloatingWindow::multiSplitterLayout() const
@@ -298,16 +331,8 @@ bool FloatingWindow::hasSingleDockWidget() const
 
 bool FloatingWindow::beingDeleted() const
 {
-    if (m_beingDeleted)
-        return true;
-
-    // TODO: Confusing logic
-    for (Frame *f : frames()) {
-        if (!f->beingDeletedLater())
-            return false;
-    }
-
-    return true;
+    // Frames leave the layout when emptied, so an empty window is one waiting to be recycled
+    return m_beingDeleted || frames().isEmpty();
 }
 
 int FloatingWindow::dbg_numFrames()
@@ -319,7 +344,7 @@ void FloatingWindow::onFrameCountChanged(int count)
 {
     qCDebug(docking) << "FloatingWindow::onFrameCountChanged" << count;
     if (count == 0) {
-        scheduleDeleteLater();
+        FloatingWindowPool::self()->recycleOrDelete(this);
     } else {
         updateTitleBarVisibility();
     }
@@ -335,6 +360,12 @@ void FloatingWindow::onVisibleFrameCountChanged(int count)
 
 void FloatingWindow::updateTitleBarVisibility()
 {
+    if (TitleBarVisibilityBatch::isActive()) {
+        TitleBarVisibilityBatch::schedule(this);
+        return;
+    }
+
+    m_titleBarVisibilityPending = false;
     updateTitleAndIcon();
 
     bool visible = true;
@@ -373,8 +404,11 @@ void FloatingWindow::updateTitleAndIcon()
     m_titleBar->setIcon(icon);
 
     if (KDDockWidgets::usesNativeTitleBar()) {
-        setWindowTitle(title);
-        setWindowIcon(icon);
+        // Avoid round-trips to the windowing system when nothing changed
+        if (windowTitle() != title)
+            setWindowTitle(title);
+        if (windowIcon().cacheKey() != icon.cacheKey())
+            setWindowIcon(icon);
     }
 }
 
@@ -400,8 +434,8 @@ void FloatingWindow::onCloseEvent(QCloseEvent *e)
 
 bool FloatingWindow::deserialize(const LayoutSaver::FloatingWindow &fw)
 {
+    // Shown by LayoutSaver, once all windows were restored
     if (dropArea()->multiSplitterLayout()->deserialize(fw.multiSplitterLayout)) {
-        show();
         return true;
     } else {
         return false;
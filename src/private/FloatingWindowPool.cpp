@@ -0,0 +1,195 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FloatingWindowPool_p.h"
+#include "FloatingWindow_p.h"
+#include "DockRegistry_p.h"
+#include "DragController_p.h"
+#include "MainWindowBase.h"
+#include "Logging_p.h"
+#include "Config.h"
+#include "FrameworkWidgetFactory.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
+
+#include <QCoreApplication>
+
+using namespace KDDockWidgets;
+
+// How long to wait before trying to refill again, if a drag is in progress
+static const int s_refillRetryInterval = 200;
+
+FloatingWindowPool::FloatingWindowPool(QObject *parent)
+    : QObject(parent)
+{
+    m_refillTimer.setSingleShot(true);
+    m_refillTimer.setInterval(0);
+    connect(&m_refillTimer, &QTimer::timeout, this, &FloatingWindowPool::refill);
+}
+
+FloatingWindowPool *FloatingWindowPool::self()
+{
+    // A child of the application, so it and its timer don't outlive it. The pooled windows are
+    // children of main windows.
+    static QPointer<FloatingWindowPool> s_pool;
+    if (!s_pool)
+        s_pool = new FloatingWindowPool(qApp);
+
+    return s_pool;
+}
+
+FloatingWindow *FloatingWindowPool::floatingWindowFor(Frame *frame)
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (capacity() > 0) {
+        scheduleRefill();
+
+        // Reparenting a window would recreate its native window, so only use a matching one
+        MainWindowBase *parent = FloatingWindow::parentForFrame(frame);
+        for (int i = 0; i < m_windows.size(); ++i) {
+            FloatingWindow *fw = m_windows.at(i);
+            if (fw && !fw->m_beingDeleted && fw->parentWidget() == parent) {
+                m_windows.remove(i);
+                qCDebug(creation) << Q_FUNC_INFO << "Reusing" << fw;
+                DockRegistry::self()->registerNestedWindow(fw);
+                fw->adoptFrame(frame);
+                return fw;
+            }
+        }
+    }
+#endif
+
+    return Config::self().frameworkWidgetFactory()->createFloatingWindow(frame);
+}
+
+FloatingWindow *FloatingWindowPool::floatingWindow(MainWindowBase *parent)
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (capacity() > 0) {
+        scheduleRefill();
+
+        for (int i = 0; i < m_windows.size(); ++i) {
+            FloatingWindow *fw = m_windows.at(i);
+            if (fw && !fw->m_beingDeleted && fw->parentWidget() == parent) {
+                m_windows.remove(i);
+                qCDebug(creation) << Q_FUNC_INFO << "Reusing" << fw;
+                DockRegistry::self()->registerNestedWindow(fw);
+                return fw;
+            }
+        }
+    }
+#endif
+
+    return Config::self().frameworkWidgetFactory()->createFloatingWindow(parent);
+}
+
+void FloatingWindowPool::recycleOrDelete(FloatingWindow *floatingWindow)
+{
+    if (m_windows.size() >= capacity()) {
+        floatingWindow->scheduleDeleteLater();
+        return;
+    }
+
+    // Unregistered right away, but recycled only once the operation that emptied it unwinds, as
+    // it might still destroy the window, for example when its layout is merged into another one.
+    DockRegistry::self()->unregisterNestedWindow(floatingWindow);
+    DockRegistry::self()->scheduleDelete(floatingWindow);
+}
+
+bool FloatingWindowPool::recycle(FloatingWindow *fw)
+{
+    // Placeholders from the previous use would end up in the new layout
+    if (fw->m_beingDeleted || fw->multiSplitterLayout()->count() > 0)
+        return false;
+
+    if (m_windows.size() >= capacity())
+        return false;
+
+    qCDebug(creation) << Q_FUNC_INFO << fw;
+    fw->hide();
+    DockRegistry::self()->unregisterNestedWindow(fw);
+    m_windows.push_back(fw);
+    return true;
+}
+
+void FloatingWindowPool::scheduleRefill()
+{
+    if (!m_refillTimer.isActive())
+        m_refillTimer.start(0);
+}
+
+QVector<FloatingWindow*> FloatingWindowPool::windows() const
+{
+    QVector<FloatingWindow*> result;
+    for (const QPointer<FloatingWindow> &fw : m_windows) {
+        if (fw)
+            result.push_back(fw);
+    }
+
+    return result;
+}
+
+int FloatingWindowPool::count() const
+{
+    int result = 0;
+    for (const QPointer<FloatingWindow> &fw : m_windows) {
+        if (fw)
+            result++;
+    }
+
+    return result;
+}
+
+void FloatingWindowPool::refill()
+{
+    m_windows.removeAll(nullptr);
+
+    while (m_windows.size() > capacity())
+        delete m_windows.takeLast();
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (m_windows.size() == capacity())
+        return;
+
+    if (DragController::instance()->isDragging()) {
+        // Creating native windows now would make the drag stutter
+        m_refillTimer.start(s_refillRetryInterval);
+        return;
+    }
+
+    // Without a main window there's nothing to parent to yet. DockRegistry calls us again
+    // when one is registered.
+    MainWindowBase *parent = FloatingWindow::parentForFrame(nullptr);
+    if (!parent)
+        return;
+
+    const FrameworkWidgetFactory *factory = Config::self().frameworkWidgetFactory();
+    while (m_windows.size() < capacity()) {
+        FloatingWindow *fw = factory->createFloatingWindow(parent);
+        DockRegistry::self()->unregisterNestedWindow(fw);
+        fw->winId(); // Creating the native window is the expensive part, do it now
+        m_windows.push_back(fw);
+    }
+#endif
+}
+
+int FloatingWindowPool::capacity() const
+{
+    return Config::self().floatingWindowPoolSize();
+}
@@ -0,0 +1,80 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KD_FLOATINGWINDOWPOOL_P_H
+#define KD_FLOATINGWINDOWPOOL_P_H
+
+#include "docks_export.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+namespace KDDockWidgets {
+
+class FloatingWindow;
+class Frame;
+class MainWindowBase;
+
+/**
+ * @brief Keeps a few hidden FloatingWindows around, so detaching a dock widget doesn't need to
+ * create a FloatingWindow and its native window. See Config::setFloatingWindowPoolSize().
+ *
+ * Pooled windows aren't registered in DockRegistry, so the rest of the framework doesn't see them.
+ */
+class DOCKS_EXPORT_FOR_UNIT_TESTS FloatingWindowPool : public QObject
+{
+    Q_OBJECT
+public:
+    static FloatingWindowPool *self();
+
+    ///@brief Returns a FloatingWindow hosting @p frame. Reuses a pooled one if possible.
+    FloatingWindow *floatingWindowFor(Frame *frame);
+
+    ///@brief Returns an empty FloatingWindow parented to @p parent, for restoring layouts. Reuses a pooled one if possible.
+    FloatingWindow *floatingWindow(MainWindowBase *parent);
+
+    ///@brief Called when @p floatingWindow has no more frames. It's either taken back into the
+    /// pool or deleted.
+    void recycleOrDelete(FloatingWindow *floatingWindow);
+
+    ///@brief Creates or deletes pooled windows until the pool matches Config::floatingWindowPoolSize()
+    ///Creation is deferred to the event loop, and postponed while dragging.
+    void scheduleRefill();
+
+    ///@brief Returns the number of windows currently in the pool
+    int count() const;
+
+    ///@brief Returns the windows currently in the pool
+    QVector<FloatingWindow*> windows() const;
+
+private:
+    explicit FloatingWindowPool(QObject *parent);
+    void refill();
+    bool recycle(FloatingWindow *);
+    int capacity() const;
+    QVector<QPointer<FloatingWindow>> m_windows;
+    QTimer m_refillTimer;
+};
+
+}
+
+#endif
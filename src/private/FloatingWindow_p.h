@@ -55,6 +55,7 @@ public:
     std::unique_ptr<WindowBeingDragged> makeWindow() override;
     DockWidgetBase *singleDockWidget() const override;
 
+    ///@brief returns the frames in this window's layout
     const Frame::List frames() const;
     DropArea *dropArea() const { return m_dropArea; }
 
@@ -65,6 +66,9 @@ public:
      */
     TitleBar *titleBar() const { return m_titleBar; }
 
+    ///@brief Locks or unlocks dragging, dropping and resizing with the mouse, see MainWindowBase::setLayoutLocked()
+    void setLayoutLocked(bool locked);
+
     bool anyNonClosable() const;
     bool anyNonDockable() const;
 
@@ -86,12 +90,13 @@ public:
     bool hasSingleDockWidget() const;
 
     /**
-     * @brief Returns whether a deleteLater has already been issued
+     * @brief Returns whether this window is waiting to be deleted or recycled
      */
     bool beingDeleted() const;
 
     /**
-     * @brief Equivalent to deleteLater() but sets beingDeleted() to true
+     * @brief Unregisters this window and has DockRegistry::deleteScheduled() delete it.
+     * Sets beingDeleted() to true
      */
     void scheduleDeleteLater();
 
@@ -111,6 +116,8 @@ public:
 
     ///@brief updates the title and the icon
     void updateTitleAndIcon();
+
+    ///@brief Shows or hides the title bar. Within a TitleBarVisibilityBatch it's only scheduled
     void updateTitleBarVisibility();
 
     QString affinityName() const;
@@ -129,11 +136,21 @@ protected:
     DropArea *const m_dropArea;
 private:
     Q_DISABLE_COPY(FloatingWindow)
+    friend class FloatingWindowPool;
+    friend class TitleBarVisibilityBatch;
     void maybeCreateResizeHandler();
+
+    ///@brief Adds @p frame to the empty layout, without showing the window
+    void adoptFrame(Frame *frame);
+
+    ///@brief Returns the main window a FloatingWindow hosting @p frame should be parented to
+    static MainWindowBase *parentForFrame(Frame *frame);
+
     void onFrameCountChanged(int count);
     void onVisibleFrameCountChanged(int count);
     bool m_disableSetVisible = false;
     bool m_beingDeleted = false;
+    bool m_titleBarVisibilityPending = false; // See TitleBarVisibilityBatch
     QMetaObject::Connection m_layoutDestroyedConnection;
     QAbstractNativeEventFilter *m_nchittestFilter = nullptr;
 };
@@ -34,6 +34,7 @@
 #include "Utils_p.h"
 #include "Position_p.h"
 #include "DockRegistry_p.h"
+#include "FramePool_p.h"
 #include "Config.h"
 #include "FrameworkWidgetFactory.h"
 
@@ -64,6 +65,7 @@ Frame::Frame(QWidgetOrQuick *parent, FrameOptions options)
     , m_options(actualOptions(options))
 {
     s_dbg_numFrames++;
+    DockRegistry::self()->performanceCounters().framesCreated++;
     DockRegistry::self()->registerFrame(this);
     qCDebug(creation) << "Frame" << ((void*)this) << s_dbg_numFrames;
 
@@ -80,11 +82,26 @@ Frame::~Frame()
 
     qCDebug(creation) << "~Frame" << static_cast<void*>(this);
     DockRegistry::self()->unregisterFrame(this);
+    DockRegistry::self()->performanceCounters().framesDestroyed++;
 
     // Run some disconnects() too, so we don't receive signals during destruction:
     setDropArea(nullptr);
 }
 
+void Frame::scheduleUpdateTitleAndIcon()
+{
+    // Dock widgets showing live status can change their title many times per event loop turn.
+    // Only the last one is worth showing.
+    if (m_titleAndIconUpdateScheduled)
+        return;
+
+    m_titleAndIconUpdateScheduled = true;
+    QTimer::singleShot(0, this, [this] {
+        m_titleAndIconUpdateScheduled = false;
+        updateTitleAndIcon();
+    });
+}
+
 void Frame::updateTitleAndIcon()
 {
     if (DockWidgetBase *dw = currentDockWidget()) {
@@ -136,7 +153,12 @@ void Frame::insertWidget(DockWidgetBase *dockWidget, int index, AddingOption add
 
     Q_ASSERT(dockWidget);
     if (contains(dockWidget)) {
-        qWarning() << "Frame::addWidget dockWidget already exists. this=" << this << "; dockWidget=" << dockWidget;
+        if (index < dockWidgetCount()) {
+            // Already here, only the tab order changes
+            moveWidget(dockWidget, index);
+        } else {
+            qWarning() << "Frame::addWidget dockWidget already exists. this=" << this << "; dockWidget=" << dockWidget;
+        }
         return;
     }
     if (m_layoutItem)
@@ -160,20 +182,42 @@ void Frame::insertWidget(DockWidgetBase *dockWidget, int index, AddingOption add
         }
     }
 
-    connect(dockWidget, &DockWidgetBase::titleChanged, this, &Frame::updateTitleAndIcon);
-    connect(dockWidget, &DockWidgetBase::iconChanged, this, &Frame::updateTitleAndIcon);
+    connect(dockWidget, &DockWidgetBase::titleChanged, this, &Frame::scheduleUpdateTitleAndIcon);
+    connect(dockWidget, &DockWidgetBase::iconChanged, this, &Frame::scheduleUpdateTitleAndIcon);
+    connect(dockWidget, &DockWidgetBase::optionsChanged, this, &Frame::updateAggregatedOptions);
 }
 
 void Frame::removeWidget(DockWidgetBase *dw)
 {
-    disconnect(dw, &DockWidgetBase::titleChanged, this, &Frame::updateTitleAndIcon);
-    disconnect(dw, &DockWidgetBase::iconChanged, this, &Frame::updateTitleAndIcon);
+    disconnect(dw, &DockWidgetBase::titleChanged, this, &Frame::scheduleUpdateTitleAndIcon);
+    disconnect(dw, &DockWidgetBase::iconChanged, this, &Frame::scheduleUpdateTitleAndIcon);
+    disconnect(dw, &DockWidgetBase::optionsChanged, this, &Frame::updateAggregatedOptions);
     m_tabWidget->removeDockWidget(dw);
 }
 
+void Frame::moveWidget(DockWidgetBase *dockWidget, int index)
+{
+    const int from = m_tabWidget->indexOfDockWidget(dockWidget);
+    if (from == -1) {
+        qWarning() << Q_FUNC_INFO << "Not in this frame" << dockWidget << this;
+        return;
+    }
+
+    const int to = qBound(0, index, dockWidgetCount() - 1);
+    if (from != to)
+        m_tabWidget->moveDockWidget(from, to);
+}
+
 void Frame::onDockWidgetCountChanged()
 {
     qCDebug(docking) << "Frame::onDockWidgetCountChanged:" << this << "; widgetCount=" << dockWidgetCount();
+    m_dockWidgetsValid = false;
+    if (DockRegistry::self()->isShuttingDown()) {
+        // Deleted with its parent anyway
+        return;
+    }
+
+    updateAggregatedOptions();
     if (isEmpty() && !isCentralFrame()) {
         scheduleDeleteLater();
     } else {
@@ -187,6 +231,12 @@ void Frame::onDockWidgetCountChanged()
     Q_EMIT numDockWidgetsChanged();
 }
 
+void Frame::onDockWidgetsReordered()
+{
+    m_dockWidgetsValid = false;
+    Q_EMIT dockWidgetsReordered();
+}
+
 void Frame::onCurrentTabChanged(int index)
 {
     if (index != -1) {
@@ -200,6 +250,17 @@ void Frame::onCurrentTabChanged(int index)
 
 void Frame::updateTitleBarVisibility()
 {
+    if (TitleBarVisibilityBatch::isActive()) {
+        TitleBarVisibilityBatch::schedule(this);
+        return;
+    }
+
+    applyTitleBarVisibility();
+}
+
+void Frame::applyTitleBarVisibility()
+{
+    m_titleBarVisibilityPending = false;
     bool visible = false;
     if (isCentralFrame()) {
         visible = false;
@@ -250,14 +311,21 @@ QIcon Frame::icon() const
 
 const DockWidgetBase::List Frame::dockWidgets() const
 {
-    DockWidgetBase::List dockWidgets;
+    // Kept until the tabs change, so callers share it instead of getting a new list each time.
+    // The count is checked too, as the tab widget signals changes after doing them.
     const int count = dockWidgetCount();
-    dockWidgets.reserve(count);
-    for (int i = 0, e = count; i != e; ++i) {
-        dockWidgets << dockWidgetAt(i);
+    if (!m_dockWidgetsValid || m_dockWidgets.size() != count) {
+        DockWidgetBase::List dockWidgets;
+        dockWidgets.reserve(count);
+        for (int i = 0, e = count; i != e; ++i) {
+            dockWidgets << dockWidgetAt(i);
+        }
+
+        m_dockWidgets = dockWidgets;
+        m_dockWidgetsValid = true;
     }
 
-    return dockWidgets;
+    return m_dockWidgets;
 }
 
 bool Frame::contains(DockWidgetBase *dockWidget) const
@@ -325,22 +393,31 @@ DockWidgetBase *Frame::currentDockWidget() const
 
 bool Frame::anyNonClosable() const
 {
-    for (auto dw : dockWidgets()) {
-        if ((dw->options() & DockWidgetBase::Option_NotClosable) && !DockRegistry::self()->isProcessingAppQuitEvent())
-            return true;
-    }
-
-    return false;
+    return m_anyNonClosable && !DockRegistry::self()->isProcessingAppQuitEvent();
 }
 
 bool Frame::anyNonDockable() const
 {
-    for (auto dw : dockWidgets()) {
-        if (dw->options() & DockWidgetBase::Option_NotDockable)
-            return true;
+    return m_anyNonDockable;
+}
+
+void Frame::updateAggregatedOptions()
+{
+    m_anyNonClosable = false;
+    m_anyNonDockable = false;
+    m_anyFixedOnParentResize = false;
+    for (int i = 0, count = dockWidgetCount(); i < count; ++i) {
+        if (DockWidgetBase *dw = dockWidgetAt(i)) {
+            m_anyNonClosable = m_anyNonClosable || (dw->options() & DockWidgetBase::Option_NotClosable);
+            m_anyNonDockable = m_anyNonDockable || (dw->options() & DockWidgetBase::Option_NotDockable);
+            m_anyFixedOnParentResize = m_anyFixedOnParentResize || (dw->options() & DockWidgetBase::Option_FixedOnParentResize);
+        }
     }
 
-    return false;
+    if (m_layoutItem)
+        m_layoutItem->setFixedOnParentResize(m_anyFixedOnParentResize);
+
+    DockRegistry::self()->setFrameNonClosable(this, m_anyNonClosable);
 }
 
 void Frame::onDockWidgetShown(DockWidgetBase *w)
@@ -378,6 +455,7 @@ void Frame::setLayoutItem(Layouting::Item *item)
 
     m_layoutItem = item;
     if (item) {
+        item->setFixedOnParentResize(m_anyFixedOnParentResize);
         for (DockWidgetBase *dw : dockWidgets())
             dw->addPlaceholderItem(item);
     } else {
@@ -445,12 +523,20 @@ void Frame::setDropArea(DropArea *dt)
             m_visibleWidgetCountChangedConnection = connect(m_dropArea->multiSplitterLayout(), &MultiSplitterLayout::visibleWidgetCountChanged,
                                                             this, &Frame::updateTitleBarVisibility);
             updateTitleBarVisibility();
+            setLayoutLocked(m_dropArea->isLayoutLocked());
             if (wasInMainWindow != isInMainWindow())
                 Q_EMIT isInMainWindowChanged();
         }
     }
 }
 
+void Frame::setLayoutLocked(bool locked)
+{
+    m_titleBar->setDraggingLocked(locked);
+    m_tabWidget->setDraggingLocked(locked);
+    m_tabWidget->tabBar()->setDraggingLocked(locked);
+}
+
 bool Frame::isTheOnlyFrame() const
 {
     qCDebug(docking) << "Frame::isTheOnlyFrame() m_dropArea=" << m_dropArea << "; numFrames"
@@ -485,6 +571,11 @@ bool Frame::event(QEvent *e)
 {
     if (e->type() == QEvent::ParentChange) {
         qCDebug(docking) << "Frame: parent changed to =" << parentWidget();
+        // All reparenting goes through here: drops, floating window creation, restore, pooling.
+        Layouting::Item *item = m_layoutItem;
+        if (item && item->guest() == this)
+            item->onGuestParentChanged();
+
         if (auto dropArea = qobject_cast<DropArea *>(parentWidget())) {
             setDropArea(dropArea);
         } else {
@@ -501,7 +592,7 @@ Frame *Frame::deserialize(const LayoutSaver::Frame &f)
     if (!f.isValid())
         return nullptr;
 
-    auto frame = Config::self().frameworkWidgetFactory()->createFrame(/*parent=*/nullptr, FrameOptions(f.options));
+    auto frame = FramePool::self()->frame(/*parent=*/nullptr, FrameOptions(f.options));
     frame->setObjectName(f.objectName);
 
     for (const auto &savedDock : qAsConst(f.dockWidgets)) {
@@ -539,9 +630,87 @@ void Frame::scheduleDeleteLater()
 {
     qCDebug(creation) << Q_FUNC_INFO << this;
     m_beingDeleted = true;
-    QTimer::singleShot(0, this, [this] {
-        // Can't use deleteLater() here due to QTBUG-83030 (deleteLater() never delivered if triggered by a sendEvent() before event loop starts)
-        delete this;
-    });
+
+    // Can't be deleted yet, we might be inside QTabWidget::removeTab(), which still accesses us.
+    // But nothing else gets to see us anymore, so there's no need to filter out frames being deleted.
+    leaveLayout();
+    hide();
+    DockRegistry::self()->unregisterFrame(this);
+    DockRegistry::self()->scheduleDelete(this);
+}
+
+void Frame::leaveLayout()
+{
+    // The same way the destructor would: The item stays as a placeholder if dock widgets still
+    // remember it, otherwise it's removed.
+    if (Layouting::Item *item = m_layoutItem) {
+        QPointer<Layouting::Item> guard = item;
+        m_layoutItem = nullptr;
+        item->unref();
+        if (guard && guard->guest() == this)
+            guard->parentContainer()->removeItem(guard, /*hardRemove=*/ false);
+    }
+}
+
+void Frame::prepareForReuse()
+{
+    leaveLayout();
+    m_beingDeleted = false;
+    hide();
+    setParent(nullptr);
+}
+
+static int s_titleBarBatchDepth = 0;
+static QVector<QPointer<Frame>> s_pendingTitleBarFrames;
+static QVector<QPointer<FloatingWindow>> s_pendingTitleBarWindows;
+
+void TitleBarVisibilityBatch::begin()
+{
+    s_titleBarBatchDepth++;
+}
+
+void TitleBarVisibilityBatch::end()
+{
+    Q_ASSERT(s_titleBarBatchDepth > 0);
+    if (s_titleBarBatchDepth > 1) {
+        s_titleBarBatchDepth--;
+        return;
+    }
+
+    // Still batching while the frames are updated, as each one asks its floating window to update
+    const QVector<QPointer<Frame>> frames = s_pendingTitleBarFrames;
+    s_pendingTitleBarFrames.clear();
+    for (Frame *frame : frames) {
+        if (frame)
+            frame->applyTitleBarVisibility();
+    }
+
+    s_titleBarBatchDepth--;
+    const QVector<QPointer<FloatingWindow>> windows = s_pendingTitleBarWindows;
+    s_pendingTitleBarWindows.clear();
+    for (FloatingWindow *fw : windows) {
+        if (fw)
+            fw->updateTitleBarVisibility();
+    }
 }
 
+bool TitleBarVisibilityBatch::isActive()
+{
+    return s_titleBarBatchDepth > 0;
+}
+
+void TitleBarVisibilityBatch::schedule(Frame *frame)
+{
+    if (!frame->m_titleBarVisibilityPending) {
+        frame->m_titleBarVisibilityPending = true;
+        s_pendingTitleBarFrames.push_back(frame);
+    }
+}
+
+void TitleBarVisibilityBatch::schedule(FloatingWindow *fw)
+{
+    if (!fw->m_titleBarVisibilityPending) {
+        fw->m_titleBarVisibilityPending = true;
+        s_pendingTitleBarWindows.push_back(fw);
+    }
+}
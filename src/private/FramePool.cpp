@@ -0,0 +1,105 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FramePool_p.h"
+#include "Frame_p.h"
+#include "DockRegistry_p.h"
+#include "Logging_p.h"
+#include "Config.h"
+#include "FrameworkWidgetFactory.h"
+
+using namespace KDDockWidgets;
+
+FramePool *FramePool::self()
+{
+    static FramePool pool;
+    return &pool;
+}
+
+Frame *FramePool::frame(QWidgetOrQuick *parent, FrameOptions options)
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    m_frames.removeAll(nullptr);
+    for (int i = 0; i < m_frames.size(); ++i) {
+        Frame *frame = m_frames.at(i);
+        if (frame->options() == options) { // Options are const, can only reuse a matching one
+            m_frames.remove(i);
+            qCDebug(creation) << Q_FUNC_INFO << "Reusing" << ((void*)frame);
+            DockRegistry::self()->registerFrame(frame);
+            if (parent)
+                frame->setParent(parent);
+            return frame;
+        }
+    }
+#endif
+
+    return Config::self().frameworkWidgetFactory()->createFrame(parent, options);
+}
+
+bool FramePool::recycle(Frame *frame)
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (m_frames.size() >= capacity() || !frame->isEmpty() || frame->isCentralFrame())
+        return false;
+
+    qCDebug(creation) << Q_FUNC_INFO << ((void*)frame);
+    frame->prepareForReuse();
+    DockRegistry::self()->unregisterFrame(frame);
+    m_frames.push_back(frame);
+    return true;
+#else
+    Q_UNUSED(frame);
+    return false;
+#endif
+}
+
+void FramePool::trim()
+{
+    m_frames.removeAll(nullptr);
+    while (m_frames.size() > capacity())
+        delete m_frames.takeLast();
+}
+
+QVector<Frame*> FramePool::frames() const
+{
+    QVector<Frame*> result;
+    for (const QPointer<Frame> &frame : m_frames) {
+        if (frame)
+            result.push_back(frame);
+    }
+
+    return result;
+}
+
+int FramePool::count() const
+{
+    int result = 0;
+    for (const QPointer<Frame> &frame : m_frames) {
+        if (frame)
+            result++;
+    }
+
+    return result;
+}
+
+int FramePool::capacity() const
+{
+    return Config::self().framePoolSize();
+}
@@ -0,0 +1,70 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KD_FRAMEPOOL_P_H
+#define KD_FRAMEPOOL_P_H
+
+#include "docks_export.h"
+#include "KDDockWidgets.h"
+#include "QWidgetAdapter.h"
+
+#include <QPointer>
+#include <QVector>
+
+namespace KDDockWidgets {
+
+class Frame;
+
+/**
+ * @brief Keeps emptied Frames around, so they can be reused instead of creating a new Frame, TitleBar,
+ * TabWidget and TabBar every time a dock widget is moved around. See Config::setFramePoolSize().
+ *
+ * Pooled frames are hidden, parentless and not registered in DockRegistry.
+ */
+class DOCKS_EXPORT_FOR_UNIT_TESTS FramePool
+{
+public:
+    static FramePool *self();
+
+    ///@brief Returns a Frame with the specified options. Reuses a pooled one if possible.
+    Frame *frame(QWidgetOrQuick *parent = nullptr, FrameOptions options = FrameOption_None);
+
+    ///@brief Called when @p frame has no more dock widgets. Returns true if it was taken into the pool,
+    /// false if the caller should delete it instead.
+    bool recycle(Frame *frame);
+
+    ///@brief Deletes pooled frames until the pool fits Config::framePoolSize()
+    void trim();
+
+    ///@brief Returns the number of frames currently in the pool
+    int count() const;
+
+    ///@brief Returns the frames currently in the pool
+    QVector<Frame*> frames() const;
+
+private:
+    FramePool() = default;
+    int capacity() const;
+    QVector<QPointer<Frame>> m_frames;
+};
+
+}
+
+#endif
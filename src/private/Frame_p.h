@@ -84,7 +84,14 @@ public:
     ///@brief removes a dockwidget from the frame
     void removeWidget(DockWidgetBase *);
 
+    ///@brief Moves @p dockWidget, which must be in this frame, to tab position @p index.
+    ///Only the tab order changes, the dock widget isn't removed and reinserted, so its content,
+    ///geometry and placeholders stay as they are.
+    void moveWidget(DockWidgetBase *dockWidget, int index);
+
     void updateTitleAndIcon();
+
+    ///@brief Shows or hides the title bar. Within a TitleBarVisibilityBatch it's only scheduled
     void updateTitleBarVisibility();
     bool containsMouse(QPoint globalPos) const;
     TitleBar *titleBar() const;
@@ -96,6 +103,9 @@ public:
     DockWidgetBase *dockWidgetAt(int index) const;
     void setDropArea(DropArea *);
 
+    ///@brief Stops or resumes dragging by the title bar and tab bar, see MainWindowBase::setLayoutLocked()
+    void setLayoutLocked(bool locked);
+
     bool isTheOnlyFrame() const;
 
     /**
@@ -164,7 +174,10 @@ public:
     DockWidgetBase *currentDockWidget() const;
 
     FrameOptions options() const { return m_options; }
+    ///@brief returns whether any of the dock widgets has Option_NotClosable. Cached, so cheap.
     bool anyNonClosable() const;
+
+    ///@brief returns whether any of the dock widgets has Option_NotDockable. Cached, so cheap.
     bool anyNonDockable() const;
 
     ///@brief returns whether there's 0 dock widgets. If not persistent then the Frame will delete itself.
@@ -186,7 +199,8 @@ public:
     static int dbg_numFrames();
 
     /**
-     * @brief Returns whether a deleteLater has already been issued
+     * @brief Returns whether this emptied frame is waiting to be deleted or recycled.
+     * It already left its layout by then, see scheduleDeleteLater()
      */
     bool beingDeletedLater() const;
 
@@ -208,6 +222,8 @@ public:
 Q_SIGNALS:
     void currentDockWidgetChanged(KDDockWidgets::DockWidgetBase *);
     void numDockWidgetsChanged();
+    ///@brief emitted when the tab order changes, see moveWidget()
+    void dockWidgetsReordered();
     void hasTabsVisibleChanged();
     void layoutInvalidated();
     void isInMainWindowChanged();
@@ -216,9 +232,30 @@ private:
     Q_DISABLE_COPY(Frame)
     friend class TestDocks;
     friend class TabWidget;
+    friend class FramePool;
+    friend class TitleBarVisibilityBatch;
     void onDockWidgetCountChanged();
+
+    ///@brief Called by TabWidget when the tabs are reordered, by the user or by moveWidget()
+    void onDockWidgetsReordered();
+    void scheduleUpdateTitleAndIcon();
+
+    void applyTitleBarVisibility();
+
+    ///@brief Updates what anyNonClosable() and anyNonDockable() return, and whether the layout
+    ///item is fixed on parent resize. Called when tabs are added or removed and when the options
+    ///of a dock widget change.
+    void updateAggregatedOptions();
     void onCurrentTabChanged(int index);
+    ///@brief Leaves the layout and unregisters this emptied frame right away. It's then deleted,
+    ///or recycled, by DockRegistry::deleteScheduled()
     void scheduleDeleteLater();
+
+    ///@brief Removes our item from the layout, or leaves it as a placeholder
+    void leaveLayout();
+
+    ///@brief Detaches this empty frame from its layout and drop area, so FramePool can reuse it
+    void prepareForReuse();
     bool event(QEvent *) override;
     TabWidget *const m_tabWidget;
     TitleBar *const m_titleBar;
@@ -226,9 +263,43 @@ private:
     const FrameOptions m_options;
     QPointer<Layouting::Item> m_layoutItem;
     bool m_beingDeleted = false;
+    bool m_titleAndIconUpdateScheduled = false;
+    bool m_anyNonClosable = false; // See updateAggregatedOptions()
+    mutable DockWidgetBase::List m_dockWidgets; // See dockWidgets()
+    mutable bool m_dockWidgetsValid = false;
+    bool m_anyNonDockable = false;
+    bool m_anyFixedOnParentResize = false; // See updateAggregatedOptions()
+    bool m_titleBarVisibilityPending = false; // See TitleBarVisibilityBatch
     QMetaObject::Connection m_visibleWidgetCountChangedConnection;
 };
 
+/**
+ * @brief Coalesces the title bar visibility updates of frames and floating windows.
+ *
+ * Each change in the number of visible frames makes every frame of that layout, and its floating
+ * window, recompute whether their title bar is shown. Between begin() and the matching end() they're
+ * only marked, and each is updated once when the outermost end() is called: the frames first, then
+ * the floating windows, whose title bar depends on them. Used by restores, drops and batches, which
+ * change the frame count many times in a row.
+ */
+class DOCKS_EXPORT TitleBarVisibilityBatch
+{
+public:
+    TitleBarVisibilityBatch() { begin(); }
+    ~TitleBarVisibilityBatch() { end(); }
+
+    static void begin();
+    static void end();
+
+    ///@brief Returns whether a batch is in progress, so updates should be scheduled instead
+    static bool isActive();
+    static void schedule(Frame *);
+    static void schedule(FloatingWindow *);
+
+private:
+    Q_DISABLE_COPY(TitleBarVisibilityBatch)
+};
+
 }
 
 inline QDebug operator<< (QDebug d, KDDockWidgets::Frame *frame)
@@ -23,6 +23,12 @@
 
 #include <QLoggingCategory>
 
+#ifdef KDDOCKWIDGETS_NO_DEBUG_LOGGING
+// Compiled out, see OPTION_NO_DEBUG_LOGGING. The arguments are still type-checked, but never evaluated.
+# undef qCDebug
+# define qCDebug(category, ...) QT_NO_QDEBUG_MACRO()
+#endif
+
 Q_DECLARE_LOGGING_CATEGORY(hovering)
 Q_DECLARE_LOGGING_CATEGORY(creation)
 Q_DECLARE_LOGGING_CATEGORY(mouseevents)
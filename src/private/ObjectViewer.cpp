@@ -48,7 +48,8 @@
 using namespace KDDockWidgets::Debug;
 
 enum Role {
-    ObjRole = Qt::UserRole
+    ObjRole = Qt::UserRole,
+    PopulatedRole // Whether the children have been added. They're added lazily, on expand.
 };
 
 
@@ -62,6 +63,13 @@ ObjectViewer::ObjectViewer(QWidget *parent)
     m_treeView.setModel(&m_model);
     connect(m_treeView.selectionModel(), &QItemSelectionModel::selectionChanged,
             this, &ObjectViewer::onSelectionChanged);
+    connect(&m_treeView, &QTreeView::expanded, this, [this] (const QModelIndex &index) {
+        populate(m_model.itemFromIndex(index));
+    });
+
+    m_pendingChildrenTimer.setSingleShot(true);
+    m_pendingChildrenTimer.setInterval(0);
+    connect(&m_pendingChildrenTimer, &QTimer::timeout, this, &ObjectViewer::addPendingChildren);
 
     QAction *action = m_menu.addAction(QStringLiteral("Refresh"));
     connect(action, &QAction::triggered, this, &ObjectViewer::refresh);
@@ -88,10 +96,11 @@ ObjectViewer::ObjectViewer(QWidget *parent)
 
 void ObjectViewer::refresh()
 {
-    const auto hashCopy = m_itemMap;
-    for (auto it = hashCopy.cbegin(), e = hashCopy.cend(); it != e; ++it)
-        remove(it.key());
+    QStandardItem *root = m_model.invisibleRootItem();
+    for (int i = 0; i < root->rowCount(); ++i)
+        forget_recursive(root->child(i));
 
+    m_pendingChildren.clear();
     m_model.clear();
 
     const auto &topLevelWidgets = qApp->topLevelWidgets();
@@ -168,37 +177,108 @@ QString ObjectViewer::nameForObj(QObject *o) const
     return name;
 }
 
-void ObjectViewer::add(QObject *obj, QStandardItem *parent)
+bool ObjectViewer::shouldShow(QObject *obj) const
 {
     if (obj == this || obj == &m_menu || obj == parentWidget() || !obj) // Ignore our stuff
-        return;
+        return false;
 
     if (m_ignoreMenus && qobject_cast<QMenu*>(obj))
-        return;
+        return false;
 
     if (m_ignoreShortcuts && qobject_cast<QShortcut*>(obj))
-        return;
+        return false;
 
     if (m_ignoreToolBars && qobject_cast<QToolBar*>(obj))
+        return false;
+
+    return true;
+}
+
+void ObjectViewer::add(QObject *obj, QStandardItem *parent)
+{
+    if (!shouldShow(obj) || m_itemMap.contains(obj))
         return;
 
-    connect(obj, &QObject::destroyed, this, &ObjectViewer::remove);
+    // Watched for ChildAdded/ChildRemoved, so the tree stays up to date without refreshing
+    connect(obj, &QObject::destroyed, this, &ObjectViewer::remove, Qt::UniqueConnection);
     obj->installEventFilter(this);
     auto item = new QStandardItem(nameForObj(obj));
     item->setData(QVariant::fromValue(obj), ObjRole);
+    item->setData(false, PopulatedRole);
     m_itemMap.insert(obj, item);
     parent->appendRow(item);
     updateItemAppearence(item);
 
-    for (auto child : obj->children())
-        add(child, item);
+    // The children are only added when expanded. A placeholder child makes the item expandable.
+    if (!obj->children().isEmpty())
+        item->appendRow(new QStandardItem());
 }
 
 void ObjectViewer::remove(QObject *obj)
 {
-    Q_ASSERT(obj);
-    obj->removeEventFilter(this);
-    m_itemMap.remove(obj);
+    QStandardItem *item = m_itemMap.value(obj);
+    if (!item)
+        return;
+
+    forget_recursive(item);
+    QStandardItem *parent = item->parent() ? item->parent() : m_model.invisibleRootItem();
+    parent->removeRow(item->row());
+}
+
+void ObjectViewer::forget_recursive(QStandardItem *item)
+{
+    if (QObject *obj = objectForItem(item)) {
+        obj->removeEventFilter(this);
+        disconnect(obj, &QObject::destroyed, this, &ObjectViewer::remove);
+        m_itemMap.remove(obj);
+    }
+
+    for (int i = 0; i < item->rowCount(); ++i)
+        forget_recursive(item->child(i));
+}
+
+void ObjectViewer::populate(QStandardItem *item)
+{
+    if (!item || item->data(PopulatedRole).toBool())
+        return;
+
+    item->setData(true, PopulatedRole);
+    item->removeRows(0, item->rowCount()); // The placeholder
+
+    if (QObject *obj = objectForItem(item)) {
+        for (auto child : obj->children())
+            add(child, item);
+    }
+}
+
+void ObjectViewer::onChildAdded(QObject *parent, QObject *child)
+{
+    QStandardItem *item = m_itemMap.value(parent);
+    if (!item)
+        return;
+
+    if (item->data(PopulatedRole).toBool()) {
+        m_pendingChildren.push_back(child);
+        m_pendingChildrenTimer.start();
+    } else if (item->rowCount() == 0) {
+        item->appendRow(new QStandardItem()); // Now it's expandable
+    }
+}
+
+void ObjectViewer::addPendingChildren()
+{
+    const auto pendingChildren = m_pendingChildren;
+    m_pendingChildren.clear();
+
+    for (const QPointer<QObject> &child : pendingChildren) {
+        if (!child)
+            continue;
+
+        // Might have been reparented meanwhile
+        QStandardItem *parentItem = m_itemMap.value(child->parent());
+        if (parentItem && parentItem->data(PopulatedRole).toBool())
+            add(child, parentItem);
+    }
 }
 
 void ObjectViewer::onSelectionChanged()
@@ -208,7 +288,8 @@ void ObjectViewer::onSelectionChanged()
         return;
 
     if (m_selectedObject) {
-        m_selectedObject->removeEventFilter(this);
+        if (!m_itemMap.contains(m_selectedObject)) // Otherwise we still need its events
+            m_selectedObject->removeEventFilter(this);
         if (auto w = qobject_cast<QWidget*>(m_selectedObject))
             w->update();
     }
@@ -291,8 +372,19 @@ void ObjectViewer::contextMenuEvent(QContextMenuEvent *ev)
 bool ObjectViewer::eventFilter(QObject *watched, QEvent *event)
 {
     auto widget = static_cast<QWidget*>(watched);
+    if (event->type() == QEvent::ChildAdded) {
+        onChildAdded(watched, static_cast<QChildEvent*>(event)->child());
+        return false;
+    }
+
+    if (event->type() == QEvent::ChildRemoved) {
+        remove(static_cast<QChildEvent*>(event)->child());
+        return false;
+    }
+
     if (event->type() == QEvent::Show || event->type() == QEvent::Hide) {
-        updateItemAppearence(m_itemMap.value(watched));
+        if (QStandardItem *item = m_itemMap.value(watched))
+            updateItemAppearence(item);
         return false;
     }
 
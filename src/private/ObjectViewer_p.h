@@ -34,6 +34,7 @@
 #include <QPointer>
 #include <QObject>
 #include <QMenu>
+#include <QTimer>
 
 QT_BEGIN_NAMESPACE
 class QStandardItem;
@@ -55,8 +56,17 @@ private:
     void toggleVisible();
     void dumpWindows();
     QString nameForObj(QObject *o) const;
+    bool shouldShow(QObject *) const;
     void add(QObject *obj, QStandardItem *parent);
     void remove(QObject *obj);
+
+    ///@brief Removes @p item's objects from m_itemMap and stops watching them. Doesn't touch the model.
+    void forget_recursive(QStandardItem *item);
+
+    ///@brief Adds the items for the children of @p item's object, the first time it's expanded
+    void populate(QStandardItem *item);
+    void onChildAdded(QObject *parent, QObject *child);
+    void addPendingChildren();
     void onSelectionChanged();
     void printProperties(QObject *) const;
     QObject* selectedObject() const;
@@ -79,6 +89,10 @@ private:
     bool m_ignoreToolBars = true;
     QHash<QObject*, QStandardItem*> m_itemMap;
 
+    // ChildAdded arrives while the child is still being constructed, so it's only added later
+    QVector<QPointer<QObject>> m_pendingChildren;
+    QTimer m_pendingChildrenTimer;
+
 protected:
     void contextMenuEvent(QContextMenuEvent *event) override;
     bool eventFilter(QObject *watched, QEvent *event) override;
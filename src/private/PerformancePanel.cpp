@@ -0,0 +1,270 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Debug widget showing the performance counters, the last operation timings and which parts
+ * of each layout relayout the most.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "PerformancePanel_p.h"
+#include "Config.h"
+#include "DockRegistry_p.h"
+#include "FloatingWindow_p.h"
+#include "MainWindowBase.h"
+#include "multisplitter/Item_p.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
+
+#include <QCheckBox>
+#include <QFontDatabase>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+using namespace KDDockWidgets;
+using namespace KDDockWidgets::Debug;
+
+static const int s_maxTimings = 100;
+static const int s_refreshIntervalMs = 500;
+
+static QString memoryLine(const char *name, const MemoryCategory &category)
+{
+    return QStringLiteral("%1%2 (%3 KiB)\n").arg(QString::fromLatin1(name), -25)
+                                            .arg(category.count).arg(category.bytes / 1024);
+}
+
+static quint64 maxRelayouts_recursive(const Layouting::ItemContainer *container)
+{
+    quint64 result = container->numRelayouts();
+    for (const Layouting::Item *child : container->childItems()) {
+        if (auto c = qobject_cast<const Layouting::ItemContainer*>(child))
+            result = std::max(result, maxRelayouts_recursive(c));
+    }
+
+    return result;
+}
+
+PerformancePanel::TimingRecorder::TimingRecorder(PerformancePanel *panel)
+    : m_panel(panel)
+{
+    m_clock.start();
+}
+
+void PerformancePanel::TimingRecorder::beginEvent(const char *category, const char *name)
+{
+    if (qstrcmp(category, "drag") == 0)
+        m_stateBeginTimes.push_back(m_clock.nsecsElapsed());
+    else
+        m_beginTimes.push_back(m_clock.nsecsElapsed());
+
+    if (m_previous)
+        m_previous->beginEvent(category, name);
+}
+
+void PerformancePanel::TimingRecorder::endEvent(const char *category, const char *name)
+{
+    QVector<qint64> &beginTimes = qstrcmp(category, "drag") == 0 ? m_stateBeginTimes : m_beginTimes;
+
+    // Empty if recording started in the middle of the operation
+    if (!beginTimes.isEmpty()) {
+        const qint64 usecs = (m_clock.nsecsElapsed() - beginTimes.takeLast()) / 1000;
+        if (&beginTimes == &m_stateBeginTimes || beginTimes.isEmpty()) // Only the outer-most operations
+            m_panel->addTiming(name, usecs);
+    }
+
+    if (m_previous)
+        m_previous->endEvent(category, name);
+}
+
+PerformancePanel::PerformancePanel(QWidget *parent)
+    : QWidget(parent)
+    , m_recorder(this)
+{
+    auto layout = new QVBoxLayout(this);
+
+    m_countersLabel.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    m_countersLabel.setTextInteractionFlags(Qt::TextSelectableByMouse);
+    layout->addWidget(&m_countersLabel);
+
+    auto hlay = new QHBoxLayout();
+    layout->addLayout(hlay);
+
+    auto button = new QPushButton(QStringLiteral("Reset counters"), this);
+    hlay->addWidget(button);
+    connect(button, &QPushButton::clicked, this, [this] {
+        Config::self().resetPerformanceCounters();
+        refreshCounters();
+    });
+
+    auto checkBox = new QCheckBox(QStringLiteral("Record timings"), this);
+    hlay->addWidget(checkBox);
+    connect(checkBox, &QCheckBox::toggled, this, [this] (bool checked) {
+        setRecordingTimings(checked);
+    });
+
+    button = new QPushButton(QStringLiteral("Refresh heat map"), this);
+    hlay->addWidget(button);
+    connect(button, &QPushButton::clicked, this, &PerformancePanel::refreshHeatMap);
+
+    m_timings.setReadOnly(true);
+    m_timings.setMaximumBlockCount(s_maxTimings);
+    m_timings.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    m_timings.setPlaceholderText(QStringLiteral("Check \"Record timings\" to see the last operations"));
+    layout->addWidget(&m_timings);
+
+    m_heatMap.setHeaderLabels({ QStringLiteral("Container"), QStringLiteral("Relayouts") });
+    m_heatMap.header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    layout->addWidget(&m_heatMap);
+
+    m_refreshTimer.setInterval(s_refreshIntervalMs);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &PerformancePanel::refreshCounters);
+}
+
+PerformancePanel::~PerformancePanel()
+{
+    setRecordingTimings(false);
+}
+
+void PerformancePanel::showEvent(QShowEvent *ev)
+{
+    QWidget::showEvent(ev);
+    refreshCounters();
+    refreshHeatMap();
+    m_refreshTimer.start(); // Stops by itself once hidden, see refreshCounters()
+}
+
+void PerformancePanel::refreshCounters()
+{
+    if (!isVisible()) {
+        m_refreshTimer.stop();
+        return;
+    }
+
+    const PerformanceCounters counters = Config::self().performanceCounters();
+    const DockRegistry *registry = DockRegistry::self();
+    const QString text = QStringLiteral(
+        "Relayouts:               %1\n"
+        "Item geometry changes:   %2\n"
+        "Widget geometry changes: %3\n"
+        "Separators created:      %4 (destroyed %5)\n"
+        "Frames created:          %6 (destroyed %7)\n"
+        "Drag hovers:             %8\n"
+        "Restores:                %9 (last %10 us, total %11 us)\n"
+        "Dock widgets:            %12\n"
+        "Frames:                  %13\n"
+        "Floating windows:        %14")
+        .arg(counters.relayouts)
+        .arg(counters.itemGeometryChanges)
+        .arg(counters.widgetGeometryChanges)
+        .arg(counters.separatorsCreated).arg(counters.separatorsDestroyed)
+        .arg(counters.framesCreated).arg(counters.framesDestroyed)
+        .arg(counters.dragHovers)
+        .arg(counters.restores).arg(counters.lastRestoreUsecs).arg(counters.totalRestoreUsecs)
+        .arg(registry->dockwidgets().size())
+        .arg(registry->frames().size())
+        .arg(registry->nestedwindows().size());
+
+    const MemoryUsage memory = Config::self().memoryUsage();
+    const QString memoryText = QStringLiteral("\n\nMemory, estimated:       %1 KiB\n").arg(memory.totalBytes() / 1024)
+        + memoryLine("  Frames:", memory.frames)
+        + memoryLine("  Title bars:", memory.titleBars)
+        + memoryLine("  Tab widgets:", memory.tabWidgets)
+        + memoryLine("  Items:", memory.items)
+        + memoryLine("  Separators:", memory.separators)
+        + memoryLine("  Floating windows:", memory.floatingWindows)
+        + memoryLine("  Placeholders:", memory.placeholders)
+        + memoryLine("  Indicators:", memory.indicators)
+        + memoryLine("  Actions:", memory.actions)
+        + memoryLine("  Pixmaps:", memory.pixmaps)
+        + QStringLiteral("  Pooled:                %1 frames, %2 floating windows")
+          .arg(memory.pooledFrames).arg(memory.pooledFloatingWindows);
+
+    m_countersLabel.setText(text + memoryText);
+}
+
+void PerformancePanel::refreshHeatMap()
+{
+    m_heatMap.clear();
+
+    const auto addLayout = [this] (const QString &name, MultiSplitterLayout *layout) {
+        const Layouting::ItemContainer *root = layout->rootItem();
+        auto item = new QTreeWidgetItem(&m_heatMap, { name });
+        addHeatMapItems(root, item, std::max<quint64>(1, maxRelayouts_recursive(root)));
+    };
+
+    const MainWindowBase::List mainWindows = DockRegistry::self()->mainwindows();
+    for (MainWindowBase *mainWindow : mainWindows)
+        addLayout(mainWindow->uniqueName(), mainWindow->multiSplitterLayout());
+
+    const QVector<FloatingWindow*> floatingWindows = DockRegistry::self()->nestedwindows();
+    for (FloatingWindow *floatingWindow : floatingWindows)
+        addLayout(QStringLiteral("FloatingWindow"), floatingWindow->multiSplitterLayout());
+
+    m_heatMap.expandAll();
+}
+
+void PerformancePanel::addHeatMapItems(const Layouting::ItemContainer *container,
+                                       QTreeWidgetItem *parent, quint64 maxRelayouts)
+{
+    const quint64 numRelayouts = container->numRelayouts();
+    const QString name = container->isRoot() ? QStringLiteral("root")
+                                             : (container->isVertical() ? QStringLiteral("vertical")
+                                                                        : QStringLiteral("horizontal"));
+
+    auto item = new QTreeWidgetItem(parent, { name, QString::number(numRelayouts) });
+
+    // White to red, relative to the container that relayouts the most in that layout
+    const int heat = int(255 * numRelayouts / maxRelayouts);
+    const QColor color(255, 255 - heat, 255 - heat);
+    item->setBackground(0, color);
+    item->setBackground(1, color);
+
+    for (const Layouting::Item *child : container->childItems()) {
+        if (auto c = qobject_cast<const Layouting::ItemContainer*>(child)) {
+            addHeatMapItems(c, item, maxRelayouts);
+        } else if (QWidget *widget = child->widget()) {
+            new QTreeWidgetItem(item, { widget->objectName() });
+        }
+    }
+}
+
+void PerformancePanel::setRecordingTimings(bool record)
+{
+    if (record == m_isRecording)
+        return;
+
+    m_isRecording = record;
+    if (record) {
+        m_recorder.m_previous = Layouting::Tracing::backend();
+        Layouting::Tracing::setBackend(&m_recorder);
+    } else if (Layouting::Tracing::backend() == &m_recorder) {
+        Layouting::Tracing::setBackend(m_recorder.m_previous);
+    }
+}
+
+void PerformancePanel::addTiming(const char *name, qint64 usecs)
+{
+    m_timings.appendPlainText(QStringLiteral("%1 us\t%2").arg(usecs, 8).arg(QString::fromLatin1(name)));
+}
@@ -0,0 +1,93 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Debug widget showing the performance counters, the last operation timings and which parts
+ * of each layout relayout the most.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_DOCKWIDGETS_PERFORMANCEPANEL_P_H
+#define KD_DOCKWIDGETS_PERFORMANCEPANEL_P_H
+
+#include "multisplitter/Tracing_p.h"
+
+#include <QElapsedTimer>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QWidget>
+
+namespace Layouting {
+class ItemContainer;
+}
+
+namespace KDDockWidgets {
+namespace Debug {
+
+class PerformancePanel : public QWidget //clazy:exclude=missing-qobject-macro
+{
+public:
+    explicit PerformancePanel(QWidget *parent = nullptr);
+    ~PerformancePanel() override;
+
+    void refreshCounters();
+    void refreshHeatMap();
+
+protected:
+    void showEvent(QShowEvent *) override;
+
+private:
+    ///@brief Records the duration of the outer-most operations, forwarding to any previous backend
+    class TimingRecorder : public Layouting::TraceBackend
+    {
+    public:
+        explicit TimingRecorder(PerformancePanel *panel);
+        void beginEvent(const char *category, const char *name) override;
+        void endEvent(const char *category, const char *name) override;
+
+        Layouting::TraceBackend *m_previous = nullptr;
+
+    private:
+        PerformancePanel *const m_panel;
+        QElapsedTimer m_clock;
+        QVector<qint64> m_beginTimes;
+        QVector<qint64> m_stateBeginTimes; // The drag states span other operations, kept apart
+    };
+
+    void setRecordingTimings(bool);
+    void addTiming(const char *name, qint64 usecs);
+    void addHeatMapItems(const Layouting::ItemContainer *, QTreeWidgetItem *parent, quint64 maxRelayouts);
+
+    QLabel m_countersLabel;
+    QPlainTextEdit m_timings;
+    QTreeWidget m_heatMap;
+    QTimer m_refreshTimer;
+    TimingRecorder m_recorder;
+    bool m_isRecording = false;
+};
+
+}
+}
+
+#endif
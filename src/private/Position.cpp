@@ -35,7 +35,7 @@ using namespace KDDockWidgets;
 
 Position::~Position()
 {
-    m_placeholders.clear();
+    removePlaceholders();
 }
 
 void Position::addPlaceholderItem(Layouting::Item *placeholder)
@@ -55,12 +55,8 @@ void Position::addPlaceholderItem(Layouting::Item *placeholder)
         removeNonMainWindowPlaceholders();
     }
 
-    // Make sure our list only contains valid placeholders. We save the result so we can disconnect from the lambda, since the Item might outlive LastPosition
-    QMetaObject::Connection connection = QObject::connect(placeholder, &QObject::destroyed, placeholder, [this, placeholder] {
-        removePlaceholder(placeholder);
-    });
-
-    m_placeholders.push_back(std::unique_ptr<ItemRef>(new ItemRef(connection, placeholder)));
+    // The item tells us when it's deleted, see onItemDestroyed(), so our list only contains valid placeholders
+    m_placeholders.push_back(std::unique_ptr<ItemRef>(new ItemRef(this, placeholder)));
 
     // NOTE: We use a list instead of simply two variables to keep the placeholders, because
     // a placeholder from a FloatingWindow might become a MainWindow one without we knowing,
@@ -100,27 +96,41 @@ bool Position::containsPlaceholder(Layouting::Item *item) const
 
 void Position::removePlaceholders()
 {
-    QScopedValueRollback<bool>(m_clearing, true);
-    m_placeholders.clear();
+    {
+        QScopedValueRollback<bool> clearing(m_clearing, true);
+        m_placeholders.clear();
+    }
+
+    removeDestroyedPlaceholders();
 }
 
 void Position::removePlaceholders(const MultiSplitter *ms)
 {
-    m_placeholders.erase(std::remove_if(m_placeholders.begin(), m_placeholders.end(), [ms] (const std::unique_ptr<ItemRef> &itemref) {
-                             return itemref->item->hostWidget() == ms;
-                         }), m_placeholders.end());
+    {
+        QScopedValueRollback<bool> clearing(m_clearing, true);
+        m_placeholders.erase(std::remove_if(m_placeholders.begin(), m_placeholders.end(), [ms] (const std::unique_ptr<ItemRef> &itemref) {
+                                 return !itemref->itemDestroyed && itemref->item->hostWidget() == ms;
+                             }), m_placeholders.end());
+    }
+
+    removeDestroyedPlaceholders();
 }
 
 void Position::removeNonMainWindowPlaceholders()
 {
-    auto it = m_placeholders.begin();
-    while (it != m_placeholders.end()) {
-        ItemRef *itemref = it->get();
-        if (!DockRegistry::self()->itemIsInMainWindow(itemref->item))
-            it = m_placeholders.erase(it);
-        else
-            ++it;
+    {
+        QScopedValueRollback<bool> clearing(m_clearing, true);
+        auto it = m_placeholders.begin();
+        while (it != m_placeholders.end()) {
+            ItemRef *itemref = it->get();
+            if (!itemref->itemDestroyed && !DockRegistry::self()->itemIsInMainWindow(itemref->item))
+                it = m_placeholders.erase(it);
+            else
+                ++it;
+        }
     }
+
+    removeDestroyedPlaceholders();
 }
 
 void Position::removePlaceholder(Layouting::Item *placeholder)
@@ -133,6 +143,25 @@ void Position::removePlaceholder(Layouting::Item *placeholder)
     }), m_placeholders.end());
 }
 
+void Position::onItemDestroyed(Layouting::Item *item)
+{
+    for (const auto &itemRef : m_placeholders) {
+        if (itemRef->item == item)
+            itemRef->itemDestroyed = true;
+    }
+
+    // Unref-ing one placeholder while clearing can delete another, erase it once done
+    if (!m_clearing)
+        removeDestroyedPlaceholders();
+}
+
+void Position::removeDestroyedPlaceholders()
+{
+    m_placeholders.erase(std::remove_if(m_placeholders.begin(), m_placeholders.end(), [] (const std::unique_ptr<ItemRef> &itemref) {
+                             return itemref->itemDestroyed;
+    }), m_placeholders.end());
+}
+
 void Position::deserialize(const LayoutSaver::Position &lp)
 {
     for (const auto &placeholder : qAsConst(lp.placeholders)) {
@@ -142,7 +171,11 @@ void Position::deserialize(const LayoutSaver::Position &lp)
             if (placeholder.indexOfFloatingWindow == -1) {
                 continue; // Skip
             } else {
-                FloatingWindow *fw = DockRegistry::self()->nestedwindows().at(placeholder.indexOfFloatingWindow);
+                FloatingWindow *fw = DockRegistry::self()->nestedWindowAt(placeholder.indexOfFloatingWindow);
+                if (!fw) {
+                    qWarning() << Q_FUNC_INFO << "Couldn't find floating window" << placeholder.indexOfFloatingWindow;
+                    continue;
+                }
                 layout = fw->multiSplitterLayout();
             }
         } else {
@@ -150,13 +183,11 @@ void Position::deserialize(const LayoutSaver::Position &lp)
             layout = mainWindow->multiSplitterLayout();
         }
 
-        const Layouting::Item::List &items = layout->items();
-        if (itemIndex < items.size()) {
-            Layouting::Item *item = items.at(itemIndex);
+        if (Layouting::Item *item = layout->itemAtIndex(itemIndex)) {
             addPlaceholderItem(item);
         } else {
             // Shouldn't happen, maybe even assert
-            qWarning() << Q_FUNC_INFO <<"Couldn't find item index" << itemIndex << "in" << items;
+            qWarning() << Q_FUNC_INFO <<"Couldn't find item index" << itemIndex << "in" << layout->items();
         }
 
     }
@@ -174,7 +205,7 @@ LayoutSaver::Position Position::serialize() const
 
         Layouting::Item *item = itemRef->item;
         MultiSplitterLayout *layout = DockRegistry::self()->layoutForItem(item);
-        const int itemIndex = layout->items().indexOf(item);
+        const int itemIndex = layout->indexOfItem(item);
 
         auto fw = layout->multiSplitter()->floatingWindow();
         auto mainWindow = layout->multiSplitter()->mainWindow();
@@ -182,7 +213,7 @@ LayoutSaver::Position Position::serialize() const
         p.isFloatingWindow = fw;
 
         if (p.isFloatingWindow) {
-            p.indexOfFloatingWindow = fw->beingDeleted() ? -1 : DockRegistry::self()->nestedwindows().indexOf(fw); // TODO: Remove once we stop using deleteLater with FloatingWindow. delete would be better
+            p.indexOfFloatingWindow = DockRegistry::self()->indexOfNestedWindow(fw); // -1 if emptied, it's unregistered
         } else {
             p.mainWindowUniqueName = mainWindow->uniqueName();
             Q_ASSERT(!p.mainWindowUniqueName.isEmpty());
@@ -198,18 +229,19 @@ LayoutSaver::Position Position::serialize() const
     return l;
 }
 
-ItemRef::ItemRef(const QMetaObject::Connection &conn, Layouting::Item *it)
+ItemRef::ItemRef(Layouting::ItemRefHolder *holder, Layouting::Item *it)
     : item(it)
-    , guard(it)
-    , connection(conn)
+    , m_holder(holder)
 {
+    item->addRefHolder(m_holder);
     item->ref();
 }
 
 ItemRef::~ItemRef()
 {
-    if (guard) {
-        QObject::disconnect(connection);
+    if (!itemDestroyed) {
+        // Before unref(), which might delete the item
+        item->removeRefHolder(m_holder);
         item->unref();
     }
 }
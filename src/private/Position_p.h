@@ -49,13 +49,13 @@ class MultiSplitter;
 // Just a RAII class so we don't forget to unref
 struct ItemRef
 {
-    ItemRef(const QMetaObject::Connection &conn, Layouting::Item *it);
+    ItemRef(Layouting::ItemRefHolder *holder, Layouting::Item *it);
     ~ItemRef();
 
     Layouting::Item *const item;
-    const QPointer<Layouting::Item> guard;
-    const QMetaObject::Connection connection;
+    bool itemDestroyed = false; // Set by the holder, when told by the item
 private:
+    Layouting::ItemRefHolder *const m_holder;
     Q_DISABLE_COPY(ItemRef)
 };
 
@@ -70,7 +70,7 @@ class Frame;
  * The DockWidget's position is saved when it's closed and restored when it's shown.
  * This class holds that position.
  */
-class DOCKS_EXPORT_FOR_UNIT_TESTS Position
+class DOCKS_EXPORT_FOR_UNIT_TESTS Position : public Layouting::ItemRefHolder
 {
     Q_DISABLE_COPY(Position)
 public:
@@ -78,6 +78,9 @@ public:
     Position() = default;
     ~Position();
 
+    // The placeholders tell us when they're deleted, so no per placeholder connection is needed
+    void onItemDestroyed(Layouting::Item *) override;
+
     void deserialize(const LayoutSaver::Position &);
     LayoutSaver::Position serialize() const;
 
@@ -126,6 +129,9 @@ public:
 private:
     friend inline QDebug operator<<(QDebug, const KDDockWidgets::Position::Ptr &);
 
+    ///@brief Removes the placeholders whose item was deleted while we were clearing
+    void removeDestroyedPlaceholders();
+
     // The last places where this dock widget was (or is), so it can be restored when setFloating(false) or show() is called.
     std::vector<std::unique_ptr<ItemRef>> m_placeholders;
     bool m_clearing = false; // to prevent re-entrancy
@@ -194,6 +200,10 @@ struct LastPositions
         return lastPosition->m_tabIndex;
     }
 
+    const std::vector<std::unique_ptr<ItemRef>> &placeholders() const {
+        return lastPosition->placeholders();
+    }
+
 private:
     QRect m_lastFloatingGeometry;
 
@@ -0,0 +1,218 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StartupProfiler_p.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEvent>
+#include <QSaveFile>
+#include <QWindow>
+
+#include <algorithm>
+
+using namespace KDDockWidgets;
+
+// Don't wait forever for windows that are never exposed, for example on minimized windows
+static const qint64 s_maxWaitForExposeUsecs = 30 * 1000 * 1000;
+
+static QString msecs(qint64 usecs)
+{
+    return QString::number(usecs / 1000.0, 'f', 1);
+}
+
+void StartupProfiler::startIfRequested()
+{
+    static bool s_started = false;
+    if (s_started)
+        return;
+
+    s_started = true;
+    const QString value = QString::fromLocal8Bit(qgetenv("KDDOCKWIDGETS_STARTUP_PROFILE"));
+    if (value.isEmpty() || value == QLatin1String("0"))
+        return;
+
+    new StartupProfiler(value == QLatin1String("1") ? QString() : value);
+}
+
+StartupProfiler::StartupProfiler(const QString &outputFile)
+    : QObject(qApp)
+    , m_outputFile(outputFile)
+    , m_previous(Layouting::Tracing::backend())
+{
+    m_clock.start();
+    Layouting::Tracing::setBackend(this);
+    qApp->installEventFilter(this);
+
+    // Only fires once the event loop is running
+    m_idleTimer.setSingleShot(true);
+    connect(&m_idleTimer, &QTimer::timeout, this, &StartupProfiler::checkIdle);
+    m_idleTimer.start(0);
+}
+
+int StartupProfiler::operationIndex(const char *category, const char *name)
+{
+    const QByteArray key = QByteArray(category) + ' ' + name;
+    auto it = m_operationIndexes.constFind(key);
+    if (it != m_operationIndexes.cend())
+        return *it;
+
+    Operation op;
+    op.name = '[' + QByteArray(category) + "] " + name;
+    m_operations.push_back(op);
+    m_operationIndexes.insert(key, m_operations.size() - 1);
+    return m_operations.size() - 1;
+}
+
+void StartupProfiler::beginEvent(const char *category, const char *name)
+{
+    if (!m_done) {
+        const int index = operationIndex(category, name);
+        Operation &op = m_operations[index];
+        const qint64 now = m_clock.nsecsElapsed() / 1000;
+        if (op.firstUsecs == -1)
+            op.firstUsecs = now;
+        op.depth++;
+        m_openEvents.push_back({ index, now });
+    }
+
+    if (m_previous)
+        m_previous->beginEvent(category, name);
+}
+
+void StartupProfiler::endEvent(const char *category, const char *name)
+{
+    // Empty if the operation started before we did
+    if (!m_done && !m_openEvents.isEmpty()) {
+        const OpenEvent event = m_openEvents.takeLast();
+        Operation &op = m_operations[event.operationIndex];
+        op.depth--;
+        if (op.depth == 0) {
+            const qint64 usecs = m_clock.nsecsElapsed() / 1000 - event.beginUsecs;
+            op.count++;
+            op.totalUsecs += usecs;
+            op.maxUsecs = qMax(op.maxUsecs, usecs);
+        }
+    }
+
+    if (m_previous)
+        m_previous->endEvent(category, name);
+}
+
+bool StartupProfiler::eventFilter(QObject *watched, QEvent *event)
+{
+    if ((event->type() != QEvent::Show && event->type() != QEvent::Expose) || !watched->isWindowType())
+        return false;
+
+    auto window = static_cast<QWindow*>(watched);
+    if (window->parent())
+        return false;
+
+    int index = m_windowIndexes.value(window, -1);
+    if (index == -1) {
+        WindowTimes times;
+        times.name = window->objectName();
+        if (times.name.isEmpty())
+            times.name = window->title();
+        if (times.name.isEmpty())
+            times.name = QString::fromLatin1(window->metaObject()->className());
+
+        m_windows.push_back(times);
+        index = m_windows.size() - 1;
+        m_windowIndexes.insert(window, index);
+        connect(window, &QObject::destroyed, this, [this, window] {
+            m_windowIndexes.remove(window);
+        });
+    }
+
+    WindowTimes &times = m_windows[index];
+    const qint64 now = m_clock.nsecsElapsed() / 1000;
+    if (event->type() == QEvent::Show) {
+        if (times.shownUsecs == -1)
+            times.shownUsecs = now;
+    } else if (times.exposedUsecs == -1 && window->isExposed()) {
+        times.exposedUsecs = now;
+    }
+
+    return false;
+}
+
+void StartupProfiler::checkIdle()
+{
+    const bool waitingForExpose = std::any_of(m_windows.cbegin(), m_windows.cend(), [] (const WindowTimes &times) {
+        return times.shownUsecs != -1 && times.exposedUsecs == -1;
+    });
+
+    if (waitingForExpose && m_clock.nsecsElapsed() / 1000 < s_maxWaitForExposeUsecs) {
+        m_idleTimer.start(10);
+        return;
+    }
+
+    writeSummary();
+}
+
+void StartupProfiler::writeSummary()
+{
+    m_done = true;
+    qApp->removeEventFilter(this);
+    // Other backends might be forwarding to us, so we stay alive, just not recording anymore
+    if (Layouting::Tracing::backend() == this)
+        Layouting::Tracing::setBackend(m_previous);
+
+    QStringList lines;
+    lines << QStringLiteral("KDDockWidgets startup profile, idle after %1 ms").arg(msecs(m_clock.nsecsElapsed() / 1000));
+
+    QVector<Operation> operations = m_operations;
+    std::stable_sort(operations.begin(), operations.end(), [] (const Operation &op1, const Operation &op2) {
+        return op1.totalUsecs > op2.totalUsecs;
+    });
+
+    lines << QStringLiteral("Operations, by total time:");
+    for (const Operation &op : qAsConst(operations)) {
+        lines << QStringLiteral("  %1: %2 ms in %3 calls, max %4 ms, first at %5 ms")
+                 .arg(QString::fromLatin1(op.name), msecs(op.totalUsecs)).arg(op.count)
+                 .arg(msecs(op.maxUsecs), msecs(op.firstUsecs));
+    }
+
+    lines << QStringLiteral("Windows:");
+    for (const WindowTimes &times : qAsConst(m_windows)) {
+        const QString shown = times.shownUsecs == -1 ? QStringLiteral("-") : msecs(times.shownUsecs);
+        const QString exposed = times.exposedUsecs == -1 ? QStringLiteral("-") : msecs(times.exposedUsecs);
+        const QString latency = times.shownUsecs == -1 || times.exposedUsecs == -1 ? QStringLiteral("-")
+                                                                                    : msecs(times.exposedUsecs - times.shownUsecs);
+        lines << QStringLiteral("  %1: shown at %2 ms, exposed at %3 ms (%4 ms later)").arg(times.name, shown, exposed, latency);
+    }
+
+    if (m_outputFile.isEmpty()) {
+        for (const QString &line : qAsConst(lines))
+            qInfo().noquote() << line; // Not silenced by QT_NO_DEBUG_OUTPUT, it was asked for
+        return;
+    }
+
+    QSaveFile file(m_outputFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << Q_FUNC_INFO << "Failed to open" << m_outputFile << file.errorString();
+        return;
+    }
+
+    file.write(lines.join(QLatin1Char('\n')).toUtf8() + '\n');
+    if (!file.commit())
+        qWarning() << Q_FUNC_INFO << "Failed to write" << m_outputFile << file.errorString();
+}
@@ -0,0 +1,111 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Measures the framework's share of the application startup.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_DOCKWIDGETS_STARTUPPROFILER_P_H
+#define KD_DOCKWIDGETS_STARTUPPROFILER_P_H
+
+#include "multisplitter/Tracing_p.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QWindow;
+QT_END_NAMESPACE
+
+namespace KDDockWidgets {
+
+/**
+ * @brief Records how long the traced operations took until the application first went idle.
+ *
+ * Enabled with the KDDOCKWIDGETS_STARTUP_PROFILE environment variable. It starts when the
+ * DockRegistry is created, which is when the first main window or dock widget is, and records
+ * the dock widget construction, the factory calls, the layouting, the layout restore phases and
+ * when each top-level window was first shown and exposed.
+ *
+ * The summary is written once the event loop is idle and every shown window was exposed.
+ * It goes to stderr with KDDOCKWIDGETS_STARTUP_PROFILE=1, otherwise to the file it names.
+ */
+class StartupProfiler : public QObject
+                      , public Layouting::TraceBackend
+{
+    Q_OBJECT
+public:
+    ///@brief Starts profiling if KDDOCKWIDGETS_STARTUP_PROFILE is set. Only the first call does anything.
+    static void startIfRequested();
+
+    void beginEvent(const char *category, const char *name) override;
+    void endEvent(const char *category, const char *name) override;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    explicit StartupProfiler(const QString &outputFile);
+    void checkIdle();
+    void writeSummary();
+
+    struct Operation {
+        QByteArray name;
+        int count = 0;
+        qint64 totalUsecs = 0; ///< Recursive calls are only counted once
+        qint64 maxUsecs = 0;
+        qint64 firstUsecs = -1; ///< When it first started, since profiling started
+        int depth = 0;
+    };
+
+    struct OpenEvent {
+        int operationIndex;
+        qint64 beginUsecs;
+    };
+
+    struct WindowTimes {
+        QString name;
+        qint64 shownUsecs = -1;
+        qint64 exposedUsecs = -1;
+    };
+
+    int operationIndex(const char *category, const char *name);
+
+    const QString m_outputFile;
+    QElapsedTimer m_clock;
+    QTimer m_idleTimer;
+    Layouting::TraceBackend *const m_previous;
+    QVector<Operation> m_operations; // In the order they first ran
+    QHash<QByteArray, int> m_operationIndexes;
+    QVector<OpenEvent> m_openEvents;
+    QVector<WindowTimes> m_windows;
+    QHash<QWindow*, int> m_windowIndexes;
+    bool m_done = false;
+};
+
+}
+
+#endif
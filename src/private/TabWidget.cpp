@@ -35,6 +35,8 @@
 #include "Utils_p.h"
 #include "Config.h"
 #include "FrameworkWidgetFactory.h"
+#include "FloatingWindowPool_p.h"
+#include "FramePool_p.h"
 
 #ifdef QT_WIDGETS_LIB
 # include <QTabWidget>
@@ -64,6 +66,16 @@ DockWidgetBase *TabBar::dockWidgetAt(QPoint localPos) const
     return dockWidgetAt(tabAt(localPos));
 }
 
+FloatingWindow *TabWidget::detachIntoFloatingWindow(DockWidgetBase *dockWidget)
+{
+    removeDockWidget(dockWidget);
+
+    auto newFrame = FramePool::self()->frame();
+    newFrame->addWidget(dockWidget);
+
+    return FloatingWindowPool::self()->floatingWindowFor(newFrame);
+}
+
 std::unique_ptr<WindowBeingDragged> TabBar::makeWindow()
 {
     auto dock = m_lastPressedDockWidget;
@@ -93,6 +105,23 @@ std::unique_ptr<WindowBeingDragged> TabBar::makeWindow()
     if (!dock)
         return {};
 
+    if (WindowBeingDragged::usesPreview()) {
+        // The tab is only detached when the drag ends
+        QRect r = dock->geometry();
+        r.moveTopLeft(m_thisWidget->mapToGlobal(QPoint(0, 0)));
+
+        TabWidget *tabWidget = m_tabWidget;
+        QPointer<QWidgetOrQuick> tabWidgetGuard = m_tabWidget->asWidget();
+        QPointer<DockWidgetBase> dockWidget = dock;
+        auto detach = [tabWidget, tabWidgetGuard, dockWidget]() -> FloatingWindow* {
+            if (!tabWidgetGuard || !dockWidget)
+                return nullptr;
+            return tabWidget->detachIntoFloatingWindow(dockWidget);
+        };
+
+        return std::unique_ptr<WindowBeingDragged>(new WindowBeingDragged(dock, r, detach, this));
+    }
+
     FloatingWindow *floatingWindow = detachTab(dock);
 
     auto draggable = KDDockWidgets::usesNativeTitleBar() ? static_cast<Draggable*>(floatingWindow)
@@ -103,15 +132,12 @@ std::unique_ptr<WindowBeingDragged> TabBar::makeWindow()
 FloatingWindow * TabBar::detachTab(DockWidgetBase *dockWidget)
 {
     QRect r = dockWidget->geometry();
-    m_tabWidget->removeDockWidget(dockWidget);
-
-    auto newFrame = Config::self().frameworkWidgetFactory()->createFrame();
     const QPoint globalPoint = m_thisWidget->mapToGlobal(QPoint(0, 0));
-    newFrame->addWidget(dockWidget);
+
+    auto floatingWindow = m_tabWidget->detachIntoFloatingWindow(dockWidget);
 
     // We're potentially already dead at this point, as frames with 0 tabs auto-destruct. Don't access members from this point.
 
-    auto floatingWindow = Config::self().frameworkWidgetFactory()->createFloatingWindow(newFrame);
     r.moveTopLeft(globalPoint);
     floatingWindow->setGeometry(r);
     floatingWindow->show();
@@ -185,15 +211,12 @@ void TabWidget::insertDockWidget(DockWidgetBase *dock, int index)
     setCurrentDockWidget(index);
 
     if (oldFrame && oldFrame->beingDeletedLater()) {
-        // give it a push and delete it immediately.
-        // Having too many deleteLater() puts us in an inconsistent state. For example if LayoutSaver::saveState()
-        // would to be called while the Frame hadn't been deleted yet it would count with that frame unless hacks.
-        // Also the unit-tests are full of waitForDeleted() due to deleteLater.
-
-        // Ideally we would just remove the deleteLater from frame.cpp, but QTabWidget::insertTab()
-        // would crash, as it accesses the old tab-widget we're stealing from
+        // give it a push and delete it immediately, QTabWidget::insertTab() is done with the
+        // old tab-widget we're stealing from. It already left its layout and was unregistered,
+        // see Frame::scheduleDeleteLater(), this just frees it sooner.
 
-        delete oldFrame;
+        if (!FramePool::self()->recycle(oldFrame))
+            delete oldFrame;
     }
 }
 
@@ -229,7 +252,18 @@ std::unique_ptr<WindowBeingDragged> TabWidget::makeWindow()
 
     const QPoint globalPoint = m_thisWidget->mapToGlobal(QPoint(0, 0));
 
-    auto floatingWindow = Config::self().frameworkWidgetFactory()->createFloatingWindow(m_frame);
+    if (WindowBeingDragged::usesPreview()) {
+        // The frame is only detached when the drag ends
+        r.moveTopLeft(globalPoint);
+        QPointer<Frame> frame = m_frame;
+        auto detach = [frame]() -> FloatingWindow* {
+            return frame ? FloatingWindowPool::self()->floatingWindowFor(frame) : nullptr;
+        };
+
+        return std::unique_ptr<WindowBeingDragged>(new WindowBeingDragged(m_frame, r, detach, this));
+    }
+
+    auto floatingWindow = FloatingWindowPool::self()->floatingWindowFor(m_frame);
     r.moveTopLeft(globalPoint);
     floatingWindow->setGeometry(r);
     floatingWindow->show();
@@ -254,3 +288,8 @@ void TabWidget::onTabRemoved()
 {
     m_frame->onDockWidgetCountChanged();
 }
+
+void TabWidget::onTabMoved()
+{
+    m_frame->onDockWidgetsReordered();
+}
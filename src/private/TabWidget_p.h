@@ -128,6 +128,9 @@ public:
 
     virtual void insertDockWidget(int index, DockWidgetBase *, const QIcon&, const QString &title) = 0;
 
+    ///@brief Moves the tab at @p from to @p to, without removing it. The current tab stays current.
+    virtual void moveDockWidget(int from, int to) = 0;
+
     virtual void setTabBarAutoHide(bool) = 0;
 
     /**
@@ -149,6 +152,9 @@ public:
      */
     virtual void detachTab(DockWidgetBase *dockWidget) = 0;
 
+    ///@brief Moves @p dockWidget out of this TabWidget and into a new FloatingWindow, which isn't shown yet
+    FloatingWindow *detachIntoFloatingWindow(DockWidgetBase *dockWidget);
+
     /**
      * @brief inserts @p dockwidget into the TabWidget, at @p index
      * @param dockwidget the dockwidget to insert
@@ -182,6 +188,7 @@ public:
 protected:
     void onTabInserted();
     void onTabRemoved();
+    void onTabMoved();
 
 private:
     Frame *const m_frame;
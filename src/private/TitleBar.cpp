@@ -26,6 +26,7 @@
 #include "WindowBeingDragged_p.h"
 #include "Utils_p.h"
 #include "FrameworkWidgetFactory.h"
+#include "FloatingWindowPool_p.h"
 
 #include <QHBoxLayout>
 #include <QLabel>
@@ -107,6 +108,9 @@ void TitleBar::setTitle(const QString &title)
 
 void TitleBar::setIcon(const QIcon &icon)
 {
+    if (icon.cacheKey() == m_icon.cacheKey())
+        return;
+
     m_icon = icon;
     Q_EMIT iconChanged();
 }
@@ -143,7 +147,17 @@ std::unique_ptr<WindowBeingDragged> TitleBar::makeWindow()
     qCDebug(hovering) << "TitleBar::makeWindow original geometry" << r;
     r.moveTopLeft(m_frame->mapToGlobal(QPoint(0, 0)));
 
-    auto floatingWindow = Config::self().frameworkWidgetFactory()->createFloatingWindow(m_frame);
+    if (WindowBeingDragged::usesPreview()) {
+        // The frame is only detached when the drag ends
+        QPointer<Frame> frame = m_frame;
+        auto detach = [frame]() -> FloatingWindow* {
+            return frame ? FloatingWindowPool::self()->floatingWindowFor(frame) : nullptr;
+        };
+
+        return std::unique_ptr<WindowBeingDragged>(new WindowBeingDragged(m_frame, r, detach, this));
+    }
+
+    auto floatingWindow = FloatingWindowPool::self()->floatingWindowFor(m_frame);
     floatingWindow->setGeometry(r);
     floatingWindow->show();
     qCDebug(hovering) << "TitleBar::makeWindow setting geometry" << r << "actual=" << floatingWindow->geometry();
@@ -59,6 +59,10 @@ inline bool usesNativeDraggingAndResizing()
 
 inline bool windowManagerHasTranslucency()
 {
+    // Translucent windows are expensive to send over the network, even when supported
+    if (Config::self().flags() & Config::Flag_LowBandwidth)
+        return false;
+
 #ifdef QT_X11EXTRAS_LIB
     if (qApp->platformName() == QLatin1String("xcb"))
         return QX11Info::isCompositingManagerRunning();
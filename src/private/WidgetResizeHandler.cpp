@@ -22,6 +22,8 @@
 #include "FloatingWindow_p.h"
 #include "TitleBar_p.h"
 #include "DragController_p.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
+#include "multisplitter/Item_p.h"
 #include "Config.h"
 
 #include <QEvent>
@@ -32,6 +34,7 @@
 #include <QScreen>
 #include <QWindow>
 #include <QAbstractButton>
+#include <QRubberBand>
 
 #if defined(Q_OS_WIN)
 # include <Windowsx.h>
@@ -49,11 +52,15 @@ bool WidgetResizeHandler::s_disableAllHandlers = false;
 WidgetResizeHandler::WidgetResizeHandler(QWidget *target)
     : QObject(target)
 {
+    mPendingPointerMoveTimer.setSingleShot(true);
+    mPendingPointerMoveTimer.setInterval(0);
+    connect(&mPendingPointerMoveTimer, &QTimer::timeout, this, &WidgetResizeHandler::applyPendingPointerMove);
     setTarget(target);
 }
 
 WidgetResizeHandler::~WidgetResizeHandler()
 {
+    delete mLazyResizeRubberBand;
 }
 
 bool WidgetResizeHandler::eventFilter(QObject *o, QEvent *e)
@@ -66,7 +73,17 @@ bool WidgetResizeHandler::eventFilter(QObject *o, QEvent *e)
         return false;
     }
 
+    if (Config::self().flags() & Config::Flag_TouchAndPenInput) {
+        const Layouting::PointerEvent pointerEvent = Layouting::PointerEvent::fromEvent(e);
+        if (pointerEvent.phase != Layouting::PointerEvent::Phase_None)
+            return handlePointerEvent(e, pointerEvent);
+    }
+
     switch (e->type()) {
+    case QEvent::ChildAdded:
+        // New children need the arrow cursor too, or they'd inherit the resize one
+        mShownCursorValid = false;
+        break;
     case QEvent::MouseButtonPress: {
         if (mTarget->isMaximized())
             break;
@@ -80,11 +97,15 @@ bool WidgetResizeHandler::eventFilter(QObject *o, QEvent *e)
         if (!widgetRect.contains(cursorPoint))
             return false;
         if (mouseEvent->button() == Qt::LeftButton) {
+            if (startSystemResize(cursorPos))
+                return true;
             mResizeWidget = true;
+            freezeContent();
         }
 
         mNewPosition = mouseEvent->globalPos();
         mCursorPos = cursorPos;
+        mLazyGeometry = mTarget->geometry();
         return true;
     }
     case QEvent::MouseButtonRelease: {
@@ -93,6 +114,8 @@ bool WidgetResizeHandler::eventFilter(QObject *o, QEvent *e)
         auto mouseEvent = static_cast<QMouseEvent *>(e);
         if (mouseEvent->button() == Qt::LeftButton) {
             mResizeWidget = false;
+            applyLazyGeometry();
+            thawContent();
             mTarget->releaseMouse();
             mTarget->releaseKeyboard();
             return true;
@@ -104,9 +127,11 @@ bool WidgetResizeHandler::eventFilter(QObject *o, QEvent *e)
             break;
         auto mouseEvent = static_cast<QMouseEvent *>(e);
         mResizeWidget = mResizeWidget && (mouseEvent->buttons() & Qt::LeftButton);
+        if (!mResizeWidget)
+            thawContent(); // Someone ate our release event
         const bool state = mResizeWidget;
         mResizeWidget = ((o == mTarget) && mResizeWidget);
-        mouseMoveEvent(mouseEvent);
+        mouseMoveEvent(mouseEvent->globalPos());
         mResizeWidget = state;
         return true;
     }
@@ -116,15 +141,81 @@ bool WidgetResizeHandler::eventFilter(QObject *o, QEvent *e)
     return false;
 }
 
-void WidgetResizeHandler::mouseMoveEvent(QMouseEvent *e)
+bool WidgetResizeHandler::handlePointerEvent(QEvent *e, const Layouting::PointerEvent &pointerEvent)
+{
+    const QPoint globalPos = pointerEvent.globalPos.toPoint();
+    switch (pointerEvent.phase) {
+    case Layouting::PointerEvent::Phase_Press: {
+        if (mTarget->isMaximized())
+            return false;
+
+        // Not accepted outside of the edges, so the children get mouse events synthesized from it
+        const CursorPosition cursorPos = cursorPosition(globalPos);
+        if (cursorPos == CursorPosition::Undefined)
+            return false;
+
+        e->accept();
+        if (startSystemResize(cursorPos))
+            return true;
+
+        mResizeWidget = true;
+        mPointerResize = true;
+        freezeContent();
+        mNewPosition = globalPos;
+        mCursorPos = cursorPos;
+        mLazyGeometry = mTarget->geometry();
+        mMotionPredictor.reset();
+        mMotionPredictor.addSample(pointerEvent.globalPos, pointerEvent.timestamp);
+        return true;
+    }
+    case Layouting::PointerEvent::Phase_Move:
+        if (!mPointerResize)
+            return false;
+
+        mMotionPredictor.addSample(pointerEvent.globalPos, pointerEvent.timestamp);
+        mPendingPointerPosition = globalPos;
+        if (!mPendingPointerMoveTimer.isActive())
+            mPendingPointerMoveTimer.start();
+        e->accept();
+        return true;
+    case Layouting::PointerEvent::Phase_Release:
+    case Layouting::PointerEvent::Phase_Cancel:
+        if (!mPointerResize)
+            return false;
+
+        mPendingPointerMoveTimer.stop();
+        if (pointerEvent.phase == Layouting::PointerEvent::Phase_Release)
+            mouseMoveEvent(globalPos); // Where the pointer really is, not where it was predicted to go
+
+        mResizeWidget = false;
+        mPointerResize = false;
+        applyLazyGeometry();
+        thawContent();
+        e->accept();
+        return true;
+    case Layouting::PointerEvent::Phase_None:
+        break;
+    }
+
+    return false;
+}
+
+void WidgetResizeHandler::applyPendingPointerMove()
+{
+    if (mPointerResize)
+        mouseMoveEvent(mMotionPredictor.predicted(mPendingPointerPosition));
+}
+
+void WidgetResizeHandler::mouseMoveEvent(QPoint globalPos)
 {
-    const QPoint globalPos = e->globalPos();
     if (!mResizeWidget) {
         updateCursor(cursorPosition(globalPos));
         return;
     }
 
-    const QRect oldGeometry = mTarget->geometry();
+    // With lazy resize only the outline follows the mouse, so resize relative to it
+    const bool lazy = Config::self().flags() & Config::Flag_LazyResize;
+    const QRect oldGeometry = lazy ? mLazyGeometry : mTarget->geometry();
     QRect newGeometry = oldGeometry;
 
     {
@@ -137,8 +228,8 @@ void WidgetResizeHandler::mouseMoveEvent(QMouseEvent *e)
         case CursorPosition::Left:
         case CursorPosition::BottomLeft: {
             deltaWidth = oldGeometry.left() - globalPos.x();
-            newWidth = qBound(minWidth, mTarget->width() + deltaWidth, maxWidth);
-            deltaWidth = newWidth - mTarget->width();
+            newWidth = qBound(minWidth, oldGeometry.width() + deltaWidth, maxWidth);
+            deltaWidth = newWidth - oldGeometry.width();
             if (deltaWidth != 0) {
                 newGeometry.setLeft(newGeometry.left() - deltaWidth);
             }
@@ -150,8 +241,8 @@ void WidgetResizeHandler::mouseMoveEvent(QMouseEvent *e)
         case CursorPosition::Right:
         case CursorPosition::BottomRight: {
             deltaWidth = globalPos.x() - newGeometry.right();
-            newWidth = qBound(minWidth, mTarget->width() + deltaWidth, maxWidth);
-            deltaWidth = newWidth - mTarget->width();
+            newWidth = qBound(minWidth, oldGeometry.width() + deltaWidth, maxWidth);
+            deltaWidth = newWidth - oldGeometry.width();
             if (deltaWidth != 0) {
                 newGeometry.setRight(oldGeometry.right() + deltaWidth);
             }
@@ -172,8 +263,8 @@ void WidgetResizeHandler::mouseMoveEvent(QMouseEvent *e)
         case CursorPosition::Top:
         case CursorPosition::TopRight: {
             deltaHeight = oldGeometry.top() - globalPos.y();
-            newHeight = qBound(minHeight, mTarget->height() + deltaHeight, maxHeight);
-            deltaHeight = newHeight - mTarget->height();
+            newHeight = qBound(minHeight, oldGeometry.height() + deltaHeight, maxHeight);
+            deltaHeight = newHeight - oldGeometry.height();
             if (deltaHeight != 0) {
                 newGeometry.setTop(newGeometry.top() - deltaHeight);
             }
@@ -185,8 +276,8 @@ void WidgetResizeHandler::mouseMoveEvent(QMouseEvent *e)
         case CursorPosition::Bottom:
         case CursorPosition::BottomRight: {
             deltaHeight = globalPos.y() - newGeometry.bottom();
-            newHeight = qBound(minHeight, mTarget->height() + deltaHeight, maxHeight);
-            deltaHeight = newHeight - mTarget->height();
+            newHeight = qBound(minHeight, oldGeometry.height() + deltaHeight, maxHeight);
+            deltaHeight = newHeight - oldGeometry.height();
             if (deltaHeight != 0) {
                 newGeometry.setBottom(oldGeometry.bottom() + deltaHeight);
             }
@@ -197,10 +288,100 @@ void WidgetResizeHandler::mouseMoveEvent(QMouseEvent *e)
         }
     }
 
-    if (newGeometry != mTarget->geometry())
+    if (lazy) {
+        setLazyGeometry(newGeometry);
+    } else if (newGeometry != mTarget->geometry()) {
         mTarget->setGeometry(newGeometry);
+    }
 }
 
+void WidgetResizeHandler::setLazyGeometry(QRect geometry)
+{
+    if (!mLazyResizeRubberBand)
+        mLazyResizeRubberBand = new QRubberBand(QRubberBand::Rectangle);
+
+    mLazyGeometry = geometry;
+    mLazyResizeRubberBand->setGeometry(geometry);
+    mLazyResizeRubberBand->show();
+}
+
+void WidgetResizeHandler::applyLazyGeometry()
+{
+    if (!mLazyResizeRubberBand || !mLazyResizeRubberBand->isVisible())
+        return;
+
+    // The layout inside is only resized this once
+    mLazyResizeRubberBand->hide();
+    if (mLazyGeometry != mTarget->geometry())
+        mTarget->setGeometry(mLazyGeometry);
+}
+
+void WidgetResizeHandler::freezeContent()
+{
+    const Config::Flags flags = Config::self().flags();
+    if (mContentFrozen || !(flags & Config::Flag_SnapshotResize) || (flags & Config::Flag_LazyResize))
+        return;
+
+    if (auto fw = qobject_cast<FloatingWindow*>(mTarget)) {
+        mContentFrozen = true;
+        fw->multiSplitterLayout()->rootItem()->freezeGuests_recursive();
+    }
+}
+
+void WidgetResizeHandler::thawContent()
+{
+    if (!mContentFrozen)
+        return;
+
+    // The real content is only resized now, once
+    mContentFrozen = false;
+    if (auto fw = qobject_cast<FloatingWindow*>(mTarget))
+        fw->multiSplitterLayout()->rootItem()->thawGuests_recursive();
+}
+
+bool WidgetResizeHandler::startSystemResize(CursorPosition cursorPos)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    if (!(Config::self().flags() & Config::Flag_SystemMoveResize) || !mTarget->windowHandle())
+        return false;
+
+    Qt::Edges edges;
+    switch (cursorPos) {
+    case CursorPosition::Left:
+        edges = Qt::LeftEdge;
+        break;
+    case CursorPosition::Right:
+        edges = Qt::RightEdge;
+        break;
+    case CursorPosition::Top:
+        edges = Qt::TopEdge;
+        break;
+    case CursorPosition::Bottom:
+        edges = Qt::BottomEdge;
+        break;
+    case CursorPosition::TopLeft:
+        edges = Qt::TopEdge | Qt::LeftEdge;
+        break;
+    case CursorPosition::TopRight:
+        edges = Qt::TopEdge | Qt::RightEdge;
+        break;
+    case CursorPosition::BottomLeft:
+        edges = Qt::BottomEdge | Qt::LeftEdge;
+        break;
+    case CursorPosition::BottomRight:
+        edges = Qt::BottomEdge | Qt::RightEdge;
+        break;
+    case CursorPosition::Undefined:
+        return false;
+    }
+
+    // The window manager resizes the window, we just get the resize events
+    return mTarget->windowHandle()->startSystemResize(edges);
+#else
+    Q_UNUSED(cursorPos);
+    return false;
+#endif
+}
 
 #ifdef Q_OS_WIN
 
@@ -319,7 +500,10 @@ void WidgetResizeHandler::setTarget(QWidget *w)
 {
     if (w) {
         mTarget = w;
+        mShownCursorValid = false;
         mTarget->setMouseTracking(true);
+        if (Config::self().flags() & Config::Flag_TouchAndPenInput)
+            mTarget->setAttribute(Qt::WA_AcceptTouchEvents);
         mTarget->installEventFilter(this);
     } else {
         qWarning() << "Target widget is null!";
@@ -328,6 +512,13 @@ void WidgetResizeHandler::setTarget(QWidget *w)
 
 void WidgetResizeHandler::updateCursor(CursorPosition m)
 {
+    // Called for each hover move, but the cursor only changes when crossing into another zone
+    if (mShownCursorValid && m == mShownCursorPos)
+        return;
+
+    mShownCursorValid = true;
+    mShownCursorPos = m;
+
     //Need for updating cursor when we change child widget
     const QObjectList children = mTarget->children();
     for (int i = 0, total = children.size(); i < total; ++i) {
@@ -367,6 +558,12 @@ WidgetResizeHandler::CursorPosition WidgetResizeHandler::cursorPosition(QPoint g
 
     QPoint pos = mTarget->mapFromGlobal(globalPos);
 
+    // Most moves are over the inside, skip the edge tests for those
+    const int margin = widgetResizeHandlerMargin;
+    if (pos.x() > margin && pos.y() > margin &&
+        pos.x() < mTarget->width() - margin && pos.y() < mTarget->height() - margin)
+        return CursorPosition::Undefined;
+
     if (pos.y() <= widgetResizeHandlerMargin && pos.x() <= widgetResizeHandlerMargin) {
         return CursorPosition::TopLeft;
     } else if (pos.y() >= mTarget->height() - widgetResizeHandlerMargin && pos.x() >= mTarget->width() - widgetResizeHandlerMargin) {
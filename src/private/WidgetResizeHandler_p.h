@@ -21,12 +21,15 @@
 #ifndef KD_WIDGET_RESIZE_HANDLER_P_H
 #define KD_WIDGET_RESIZE_HANDLER_P_H
 
+#include "multisplitter/PointerInput_p.h"
+
 #include <QWidget>
 #include <QPoint>
 #include <QDebug>
+#include <QTimer>
 
 QT_BEGIN_NAMESPACE
-class QMouseEvent;
+class QRubberBand;
 QT_END_NAMESPACE
 
 namespace KDDockWidgets {
@@ -61,13 +64,39 @@ private:
         Bottom,
         Undefined
     };
-    void mouseMoveEvent(QMouseEvent *e);
+    void mouseMoveEvent(QPoint globalPos);
+
+    ///@brief For Flag_TouchAndPenInput: Resizes from touch and tablet events, at most once per event loop iteration
+    bool handlePointerEvent(QEvent *, const Layouting::PointerEvent &);
+    void applyPendingPointerMove();
+
+    ///@brief Lets the window manager do the resize, if Flag_SystemMoveResize is set and supported
+    bool startSystemResize(CursorPosition);
+
+    ///@brief For Flag_LazyResize: Moves the outline to @p geometry, the target is only resized on release
+    void setLazyGeometry(QRect geometry);
+    void applyLazyGeometry();
+
+    ///@brief For Flag_SnapshotResize: Replaces the target's dock widgets by snapshots until thawContent()
+    void freezeContent();
+    void thawContent();
     void updateCursor(CursorPosition m);
     CursorPosition cursorPosition(QPoint) const;
     QWidget *mTarget = nullptr;
     CursorPosition mCursorPos = CursorPosition::Undefined;
+    CursorPosition mShownCursorPos = CursorPosition::Undefined; ///< What updateCursor() last showed
+    bool mShownCursorValid = false; ///< False until updateCursor() runs, or if a child was added since
     QPoint mNewPosition;
     bool mResizeWidget = false;
+    QRect mLazyGeometry;
+    QRubberBand *mLazyResizeRubberBand = nullptr;
+    bool mContentFrozen = false;
+
+    // For Flag_TouchAndPenInput. Only the latest position per event loop iteration is applied
+    bool mPointerResize = false;
+    QPoint mPendingPointerPosition;
+    QTimer mPendingPointerMoveTimer;
+    Layouting::MotionPredictor mMotionPredictor;
 };
 
 }
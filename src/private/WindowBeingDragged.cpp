@@ -21,9 +21,68 @@
 #include "WindowBeingDragged_p.h"
 #include "DragController_p.h"
 #include "Logging_p.h"
+#include "Frame_p.h"
+#include "DockWidgetBase.h"
+#include "Config.h"
+#include "Utils_p.h"
+
+#include <QWindow>
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+# include <QPainter>
+# include <QPixmap>
+# include <QRegion>
+#endif
 
 using namespace KDDockWidgets;
 
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+namespace {
+///@brief The translucent pixmap that follows the mouse with Config::Flag_DragWithPreview.
+///With Config::Flag_LowBandwidth it's an opaque outline instead, masked so only its border is repainted.
+class DragPreview : public QWidget // clazy:exclude=missing-qobject-macro
+{
+public:
+    explicit DragPreview(QWidget *source)
+        : QWidget(nullptr, Qt::Tool | Qt::FramelessWindowHint | Qt::BypassWindowManagerHint)
+        , m_outline(Config::self().flags() & Config::Flag_LowBandwidth)
+        , m_pixmap(m_outline ? QPixmap() : source->grab())
+    {
+        if (!m_outline)
+            setAttribute(Qt::WA_TranslucentBackground);
+        setAttribute(Qt::WA_TransparentForMouseEvents);
+        setAttribute(Qt::WA_ShowWithoutActivating);
+        setObjectName(QStringLiteral("_docks_DragPreview"));
+    }
+
+protected:
+    void paintEvent(QPaintEvent *) override
+    {
+        QPainter p(this);
+        if (m_outline) {
+            p.fillRect(rect(), palette().color(QPalette::Highlight));
+        } else {
+            p.setOpacity(0.6);
+            p.drawPixmap(rect(), m_pixmap);
+        }
+    }
+
+    void resizeEvent(QResizeEvent *ev) override
+    {
+        QWidget::resizeEvent(ev);
+        if (m_outline) {
+            const int thickness = 3;
+            setMask(QRegion(rect()).subtracted(rect().adjusted(thickness, thickness, -thickness, -thickness)));
+        }
+    }
+
+private:
+    const bool m_outline;
+    const QPixmap m_pixmap;
+};
+}
+#endif
+
 WindowBeingDragged::WindowBeingDragged(FloatingWindow *fw, Draggable *draggable)
     : m_floatingWindow(fw)
     , m_draggable(draggable->asWidget())
@@ -31,16 +90,133 @@ WindowBeingDragged::WindowBeingDragged(FloatingWindow *fw, Draggable *draggable)
     init();
 }
 
+WindowBeingDragged::WindowBeingDragged(QWidgetOrQuick *source, QRect geometry,
+                                       const DetachFunc &detach, Draggable *draggable)
+    : m_draggable(draggable->asWidget())
+    , m_previewSource(source)
+    , m_detachFunc(detach)
+{
+    Q_ASSERT(usesPreview());
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    m_preview = new DragPreview(source);
+    m_preview->setGeometry(geometry);
+    m_preview->show();
+#else
+    Q_UNUSED(geometry);
+#endif
+    init();
+}
+
 WindowBeingDragged::~WindowBeingDragged()
 {
     grabMouse(false);
+    delete m_preview;
 }
 
 void WindowBeingDragged::init()
 {
-    Q_ASSERT(m_floatingWindow);
+    Q_ASSERT(m_floatingWindow || m_preview);
     grabMouse(true);
-    m_floatingWindow->raise();
+    topLevel()->raise();
+}
+
+bool WindowBeingDragged::usesPreview()
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    // With native title bars the OS moves the window, so there's always a real one
+    return (Config::self().flags() & Config::Flag_DragWithPreview) && !usesNativeTitleBar();
+#else
+    return false;
+#endif
+}
+
+bool WindowBeingDragged::isPreview() const
+{
+    return !m_floatingWindow && m_preview;
+}
+
+bool WindowBeingDragged::isValid() const
+{
+    return m_floatingWindow || (isPreview() && m_previewSource);
+}
+
+QWidgetOrQuick *WindowBeingDragged::draggedWidget() const
+{
+    if (isPreview())
+        return m_previewSource;
+
+    return m_floatingWindow;
+}
+
+QWidgetOrQuick *WindowBeingDragged::topLevel() const
+{
+    if (isPreview())
+        return m_preview;
+
+    return m_floatingWindow;
+}
+
+QString WindowBeingDragged::affinityName() const
+{
+    if (m_floatingWindow)
+        return m_floatingWindow->affinityName();
+
+    if (auto frame = qobject_cast<Frame *>(m_previewSource))
+        return frame->affinityName();
+
+    if (auto dw = qobject_cast<DockWidgetBase *>(m_previewSource))
+        return dw->affinityName();
+
+    return QString();
+}
+
+bool WindowBeingDragged::anyNonDockable() const
+{
+    if (m_floatingWindow)
+        return m_floatingWindow->anyNonDockable();
+
+    if (auto frame = qobject_cast<Frame *>(m_previewSource))
+        return frame->anyNonDockable();
+
+    if (auto dw = qobject_cast<DockWidgetBase *>(m_previewSource))
+        return dw->options() & DockWidgetBase::Option_NotDockable;
+
+    return false;
+}
+
+void WindowBeingDragged::setPosition(QPoint globalPos)
+{
+    if (isPreview()) {
+        m_preview->move(globalPos.x(), globalPos.y());
+    } else if (m_floatingWindow) {
+        m_floatingWindow->windowHandle()->setPosition(globalPos);
+    }
+}
+
+FloatingWindow *WindowBeingDragged::materialize()
+{
+    if (!isPreview())
+        return m_floatingWindow;
+
+    const QRect geometry = m_preview->geometry();
+    delete m_preview;
+    m_preview = nullptr;
+
+    // The draggable might get reparented into the new window
+    grabMouse(false);
+    m_draggable = nullptr;
+
+    const DetachFunc detach = m_detachFunc;
+    m_detachFunc = nullptr;
+    if (!m_previewSource || !detach)
+        return nullptr;
+
+    m_floatingWindow = detach();
+    if (m_floatingWindow)
+        m_floatingWindow->setGeometry(geometry);
+
+    qCDebug(hovering) << "WindowBeingDragged::materialize" << m_previewSource << m_floatingWindow;
+    return m_floatingWindow;
 }
 
 void WindowBeingDragged::grabMouse(bool grab)
@@ -25,6 +25,9 @@
 #include "FloatingWindow_p.h"
 
 #include <QPointer>
+#include <QRect>
+
+#include <functional>
 
 namespace KDDockWidgets {
 
@@ -34,12 +37,55 @@ class Draggable;
 struct DOCKS_EXPORT_FOR_UNIT_TESTS WindowBeingDragged
 {
 public:
+    typedef std::function<FloatingWindow*()> DetachFunc;
+
     explicit WindowBeingDragged(FloatingWindow *fw, Draggable *draggable);
+
+    /**
+     * @brief Constructs a preview drag, see Config::Flag_DragWithPreview
+     *
+     * Instead of a FloatingWindow a translucent pixmap of @p source follows the mouse.
+     * @p source is the Frame or DockWidget being dragged and @p geometry the preview's initial
+     * global geometry. @p detach is only called when the drag ends, see materialize().
+     */
+    WindowBeingDragged(QWidgetOrQuick *source, QRect geometry, const DetachFunc &detach,
+                       Draggable *draggable);
+
     ~WindowBeingDragged();
     void init();
 
+    ///@brief Returns whether Config::Flag_DragWithPreview is set and supported
+    static bool usesPreview();
+
+    ///@brief Returns the FloatingWindow being dragged. nullptr while dragging a preview
     FloatingWindow *floatingWindow() const { return m_floatingWindow; }
 
+    ///@brief Returns true while dragging a preview instead of a real window
+    bool isPreview() const;
+
+    ///@brief Returns false if the window or preview source was deleted meanwhile
+    bool isValid() const;
+
+    ///@brief Returns the FloatingWindow or, while previewing, the Frame or DockWidget being dragged
+    QWidgetOrQuick *draggedWidget() const;
+
+    ///@brief Returns the top-level following the mouse. The FloatingWindow or the preview.
+    QWidgetOrQuick *topLevel() const;
+
+    QString affinityName() const;
+    bool anyNonDockable() const;
+
+    ///@brief Moves the FloatingWindow or preview to @p globalPos
+    void setPosition(QPoint globalPos);
+
+    /**
+     * @brief Detaches the preview source into a FloatingWindow, placed where the preview was
+     *
+     * The window isn't shown, so dropping it doesn't need to create a native window.
+     * Does nothing if not previewing. Returns floatingWindow().
+     */
+    FloatingWindow *materialize();
+
     ///@brief grabs or releases the mouse
     void grabMouse(bool grab);
 
@@ -47,6 +93,11 @@ private:
     Q_DISABLE_COPY(WindowBeingDragged)
     QPointer<FloatingWindow> m_floatingWindow;
     QPointer<QWidgetOrQuick> m_draggable;
+
+    // For Config::Flag_DragWithPreview
+    QPointer<QWidgetOrQuick> m_previewSource;
+    QWidgetOrQuick *m_preview = nullptr;
+    DetachFunc m_detachFunc;
 };
 }
 
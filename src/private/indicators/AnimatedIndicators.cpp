@@ -20,285 +20,43 @@
 
 #include "AnimatedIndicators_p.h"
 #include "DropArea_p.h"
+#include "Frame_p.h"
+#include "Logging_p.h"
 
+#include <QEasingCurve>
+#include <QGuiApplication>
 #include <QPainter>
 #include <QPainterPath>
-#include <QState>
-#include <QStateMachine>
+#include <QScreen>
+#include <QWindow>
 
 #define RUBBERBAND_LENGTH 11
 #define RUBBERBAND_SPACING 2
 #define INFLATED_RUBBERBAND_LENGTH 60
-#define CENTER_RUBBERBAND_LENGTH 200
-#define CENTER_RUBBERBAND_SIZE QSize(CENTER_RUBBERBAND_LENGTH, CENTER_RUBBERBAND_LENGTH)
-
-#define INFLATED_CENTER_RUBBERBAND_LENGTH 300
-#define INFLATED_CENTER_RUBBERBAND_SIZE QSize(INFLATED_CENTER_RUBBERBAND_LENGTH, INFLATED_CENTER_RUBBERBAND_LENGTH)
+#define INNER_RUBBERBAND_MARGIN (2 * RUBBERBAND_LENGTH) // So inner bands don't overlap the outter ones
+#define ANIMATION_DURATION 250
 
 using namespace KDDockWidgets;
 
-namespace KDDockWidgets {
-
-class AnimationStateBase : public QState
-{
-    Q_OBJECT
-public:
-    AnimationStateBase(AnimatedIndicators *qq, AnimatedRubberBand *band, QState *parent)
-        : QState(parent)
-        , rubberBand(band)
-        , q(qq)
-    {
-    }
-
-    ~AnimationStateBase() override;
-
-    AnimatedRubberBand *const rubberBand;
-    AnimatedIndicators *const q;
-};
-
-AnimationStateBase::~AnimationStateBase() {}
-
-class AnimationState_None : public AnimationStateBase
-{
-    // In this state no rubber band is shown
-    Q_OBJECT
-public:
-    explicit AnimationState_None(AnimatedIndicators *qq, AnimatedRubberBand *band, QState *parent)
-        : AnimationStateBase(qq, band, parent)
-    {
-    }
-
-    ~AnimationState_None() override;
-
-    void onEntry(QEvent *) override
-    {
-        rubberBand->hide();
-        Q_EMIT rubberBand->hidden();
-    }
-};
-
-AnimationState_None::~AnimationState_None() {}
-
-class AnimationState_AnimateShow : public AnimationStateBase
-{
-    // In this state we show the rubber bands and start animating them
-    Q_OBJECT
-public:
-    explicit AnimationState_AnimateShow(AnimatedIndicators *qq, AnimatedRubberBand *band, QState *parent)
-        : AnimationStateBase(qq, band, parent)
-    {
-    }
-
-    ~AnimationState_AnimateShow() override;
-
-    void onEntry(QEvent *) override
-    {
-        rubberBand->resetGeometry();
-        rubberBand->show();
-        rubberBand->animatedInitialShow();
-    }
-};
-
-AnimationState_AnimateShow::~AnimationState_AnimateShow() {}
-
-class AnimationState_ShowingRubberBands : public AnimationStateBase
-{
-    Q_OBJECT
-public:
-    explicit AnimationState_ShowingRubberBands(AnimatedIndicators *qq, AnimatedRubberBand *band, QState *parent)
-        : AnimationStateBase(qq, band, parent)
-    {
-    }
-
-    ~AnimationState_ShowingRubberBands() override;
-
-    void onEntry(QEvent *) override
-    {
-    }
-};
-
-AnimationState_ShowingRubberBands::~AnimationState_ShowingRubberBands() {}
-
-
-class AnimationState_AnimateHide : public AnimationStateBase
-{
-    Q_OBJECT
-public:
-    explicit AnimationState_AnimateHide(AnimatedIndicators *qq, AnimatedRubberBand *band, QState *parent)
-        : AnimationStateBase(qq, band, parent)
-    {
-    }
-    ~AnimationState_AnimateHide() override;
-    void onEntry(QEvent *) override
-    {
-        rubberBand->animatedHide();
-    }
-};
-
-AnimationState_AnimateHide::~AnimationState_AnimateHide() {}
-
-class AnimationState_AnimateInflate : public AnimationStateBase
-{
-    // In this state we show the rubber bands and start animating them
-    Q_OBJECT
-public:
-    explicit AnimationState_AnimateInflate(AnimatedIndicators *qq, AnimatedRubberBand *band, QState *parent)
-        : AnimationStateBase(qq, band, parent)
-    {
-    }
-
-    ~AnimationState_AnimateInflate() override;
-    void onEntry(QEvent *) override
-    {
-        rubberBand->animatedInflate();
-    }
-};
-
-AnimationState_AnimateInflate::~AnimationState_AnimateInflate() {}
-
-class AnimationState_Inflated : public AnimationStateBase
+AnimatedIndicators::AnimatedIndicators(DropArea *dropArea)
+    : DropIndicatorOverlayInterface(dropArea) // Is parented on the drop-area, not a toplevel.
 {
-    // In this state we show the rubber bands and start animating them
-    Q_OBJECT
-public:
-    explicit AnimationState_Inflated(AnimatedIndicators *qq, AnimatedRubberBand *band, QState *parent)
-        : AnimationStateBase(qq, band, parent)
-    {
-    }
-    ~AnimationState_Inflated() override;
-    void onEntry(QEvent *) override
-    {
-    }
-};
-
-AnimationState_Inflated::~AnimationState_Inflated() {}
+    setAttribute(Qt::WA_TransparentForMouseEvents);
 
-class AnimationState_AnimateDeflate : public AnimationStateBase
-{
-    Q_OBJECT
-public:
-    explicit AnimationState_AnimateDeflate(AnimatedIndicators *qq, AnimatedRubberBand *band, QState *parent)
-        : AnimationStateBase(qq, band, parent)
-    {
-    }
-    ~AnimationState_AnimateDeflate() override;
-    void onEntry(QEvent *) override
-    {
-        rubberBand->animatedDeflate();
-    }
-};
+    // Also the hit-testing order, the last band containing the cursor wins
+    const DropLocation locations[] = { DropLocation_OutterLeft, DropLocation_OutterTop, DropLocation_OutterRight,
+                                       DropLocation_OutterBottom, DropLocation_Center, DropLocation_Left,
+                                       DropLocation_Top, DropLocation_Right, DropLocation_Bottom };
 
-AnimationState_AnimateDeflate::~AnimationState_AnimateDeflate() {}
-
-}
-
-AnimatedRubberBand::AnimatedRubberBand(DropIndicatorOverlayInterface::DropLocation location, AnimatedIndicators *qq)
-    : QRubberBand(QRubberBand::Rectangle, qq)
-    , dropLocation(location)
-    , animation(this)
-    , q(qq)
-{
-    animation.setTargetObject(this);
-    animation.setDuration(500);
-    animation.setEasingCurve(QEasingCurve::OutBack);
-
-    auto stateMachine = new QStateMachine(this);
-    auto stateNone = new AnimationState_None(q, this, stateMachine);
-    auto stateAnimatedShow = new AnimationState_AnimateShow(q, this, stateMachine);
-    auto stateShowingRubberBand = new AnimationState_ShowingRubberBands(q, this, stateMachine);
-    auto stateAnimateHide = new AnimationState_AnimateHide(q, this, stateMachine);
-    auto stateAnimateInflate = new AnimationState_AnimateInflate(q, this, stateMachine);
-    auto stateAnimateInflated = new AnimationState_Inflated(q, this, stateMachine);
-    auto stateAnimateDeflate = new AnimationState_AnimateDeflate(q, this, stateMachine);
-
-    connect(q, &AnimatedIndicators::hoveredFrameChanged, this, &AnimatedRubberBand::onHoveredFrameChanged);
-
-    // -> animate show
-    stateNone->addTransition(q, &AnimatedIndicators::hovered, stateAnimatedShow);
-    stateAnimateHide->addTransition(q, &AnimatedIndicators::hovered, stateAnimatedShow);
-
-    // -> showing rubber band
-    stateAnimatedShow->addTransition(&animation, &QPropertyAnimation::finished, stateShowingRubberBand);
-    stateAnimateDeflate->addTransition(&animation, &QPropertyAnimation::finished, stateShowingRubberBand);
-
-    // -> animate hide
-    stateAnimatedShow->addTransition(q, &AnimatedIndicators::notHovered, stateAnimateHide);
-    stateShowingRubberBand->addTransition(q, &AnimatedIndicators::notHovered, stateAnimateHide);
-    stateAnimateInflate->addTransition(q, &AnimatedIndicators::notHovered, stateAnimateHide);
-    stateAnimateDeflate->addTransition(q, &AnimatedIndicators::notHovered, stateAnimateHide);
-    stateAnimateInflated->addTransition(q, &AnimatedIndicators::notHovered, stateAnimateHide);
-
-    // -> none
-    stateAnimateHide->addTransition(&animation, &QPropertyAnimation::finished, stateNone);
-
-    // -> animate inflate
-    stateAnimatedShow->addTransition(this, &AnimatedRubberBand::hovered, stateAnimateInflate);
-    stateShowingRubberBand->addTransition(this, &AnimatedRubberBand::hovered, stateAnimateInflate);
-    stateAnimateHide->addTransition(this, &AnimatedRubberBand::hovered, stateAnimateInflate);
-    stateNone->addTransition(this, &AnimatedRubberBand::hovered, stateAnimateInflate);
-
-    // -> inflated
-    stateAnimateInflate->addTransition(&animation, &QPropertyAnimation::finished, stateAnimateInflated);
-
-    // -> animate deflate
-    stateAnimateInflate->addTransition(this, &AnimatedRubberBand::notHovered, stateAnimateDeflate);
-    stateAnimateInflated->addTransition(this, &AnimatedRubberBand::notHovered, stateAnimateDeflate);
-
-
-    stateMachine->setInitialState(stateNone);
-    stateMachine->start();
-}
-
-bool AnimatedRubberBand::hover(QPoint globalPos)
-{
-    const bool containsMouse = rect().contains(mapFromGlobal(globalPos));
-    if (containsMouse) {
-        Q_EMIT hovered();
-        return true;
-    } else {
-        Q_EMIT notHovered();
-        return false;
-    }
-}
+    for (int i = 0; i < 9; ++i)
+        m_bands[i].location = locations[i];
 
-void AnimatedRubberBand::setLengthAnimated(const QVariant &value)
-{
-    animation.setStartValue(length());
-    animation.setEndValue(value);
-    animation.start();
+    m_animationTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_animationTimer, &QTimer::timeout, this, &AnimatedIndicators::onAnimationTick);
 }
 
-AnimatedIndicators::AnimatedIndicators(DropArea *dropArea)
-    : DropIndicatorOverlayInterface(dropArea)
-    , m_outterLeftRubberBand(new AnimatedOutterRubberBand(Qt::Vertical, DropIndicatorOverlayInterface::DropLocation_OutterLeft, this))
-    , m_outterRightRubberBand(new AnimatedOutterRubberBand(Qt::Vertical, DropIndicatorOverlayInterface::DropLocation_OutterRight, this))
-    , m_outterTopRubberBand(new AnimatedOutterRubberBand(Qt::Horizontal, DropIndicatorOverlayInterface::DropLocation_OutterTop, this))
-    , m_outterBottomRubberBand(new AnimatedOutterRubberBand(Qt::Horizontal, DropIndicatorOverlayInterface::DropLocation_OutterBottom, this))
-    , m_centerRubberBand(new AnimatedCenterRubberBand(this))
-    , m_innerLeftRubberBand(new AnimatedInnerRubberBand(Qt::Vertical, DropIndicatorOverlayInterface::DropLocation_Left, this))
-    , m_innerRightRubberBand(new AnimatedInnerRubberBand(Qt::Vertical, DropIndicatorOverlayInterface::DropLocation_Right, this))
-    , m_innerTopRubberBand(new AnimatedInnerRubberBand(Qt::Horizontal, DropIndicatorOverlayInterface::DropLocation_Top, this))
-    , m_innerBottomRubberBand(new AnimatedInnerRubberBand(Qt::Horizontal, DropIndicatorOverlayInterface::DropLocation_Bottom, this))
+AnimatedIndicators::~AnimatedIndicators()
 {
-    m_rubberBands << m_outterLeftRubberBand << m_outterRightRubberBand
-                  << m_outterTopRubberBand << m_outterBottomRubberBand
-                  << m_centerRubberBand << m_innerLeftRubberBand << m_innerRightRubberBand
-                  << m_innerTopRubberBand << m_innerBottomRubberBand;
-
-    for (auto rubberBand : qAsConst(m_rubberBands)) {
-        connect(rubberBand, &AnimatedRubberBand::positionChanged, this, &AnimatedIndicators::updateRubberBandPositions);
-        connect(rubberBand, &AnimatedRubberBand::hidden, this, [this] {
-            if (allRubberBandsAreHidden()) {
-                setVisible(false);
-            }
-        });
-    }
-
-    auto group = dropArea->multiSplitterLayout()->staticAnchorGroup();
-    m_outterLeftRubberBand->setAnchor(group.left);
-    m_outterRightRubberBand->setAnchor(group.right);
-    m_outterTopRubberBand->setAnchor(group.top);
-    m_outterBottomRubberBand->setAnchor(group.bottom);
 }
 
 DropIndicatorOverlayInterface::Type AnimatedIndicators::indicatorType() const
@@ -308,266 +66,220 @@ DropIndicatorOverlayInterface::Type AnimatedIndicators::indicatorType() const
 
 void AnimatedIndicators::hover(QPoint globalPos)
 {
-    setCurrentDropLocation(DropIndicatorOverlayInterface::DropLocation_None);
-    for (auto rubberBand : qAsConst(m_rubberBands)) {
-        if (rubberBand->hover(globalPos)) {
-            setCurrentDropLocation(rubberBand->dropLocation);
-        }
-    }
-}
+    const QPoint localPos = mapFromGlobal(globalPos);
 
-void AnimatedIndicators::updateVisibility()
-{
-    const bool visible = isHovered();
-
-    if (!isVisible() && visible) {
-        updateRubberBandPositions();
-        setVisible(true);
-    } // visibility is set to false when animation ends
+    DropLocation location = DropLocation_None;
+    for (const Band &band : m_bands) {
+        if (!bandIsAvailable(band.location))
+            continue;
 
-    if (visible) {
-        Q_EMIT hovered();
-    } else {
-        Q_EMIT notHovered();
+        // While still growing use the final size, so the band can be hovered right away
+        const qreal length = qMax(band.length, lengthFor(band.location, BandState_Shown));
+        if (rectForBand(band.location, length).contains(localPos))
+            location = band.location;
     }
-}
 
-void AnimatedIndicators::updateRubberBandPositions()
-{
-    for (auto rubberBand : qAsConst(m_rubberBands)) {
-        rubberBand->updatePosition();
+    if (location != currentDropLocation()) {
+        qCDebug(overlay) << "AnimatedIndicators::hover" << location;
+        setCurrentDropLocation(location);
+        updateTargets();
     }
 }
 
-bool AnimatedIndicators::allRubberBandsAreHidden() const
+QPoint AnimatedIndicators::posForIndicator(DropIndicatorOverlayInterface::DropLocation location) const
 {
-    for (auto rubberBand : m_rubberBands) {
-        if (rubberBand->isVisible())
-            return false;
-    }
-    return true;
+    const QRect r = rectForBand(location, lengthFor(location, BandState_Shown));
+    return mapToGlobal(r.center());
 }
 
-QPoint AnimatedIndicators::posForIndicator(DropIndicatorOverlayInterface::DropLocation) const
-{
-    // TODO: This is only used by unit-tests, and we're not testing AnimatedIndicators yet, only Classical.
-    return QPoint();
-}
-
-void AnimatedIndicators::onHoveredFrameChanged(Frame *frame)
+void AnimatedIndicators::updateVisibility()
 {
-    if (frame) {
-        Item *item = m_dropArea->multiSplitterLayout()->itemForFrame(frame);
-        AnchorGroup group = item->anchorGroup();
-        Q_ASSERT(group.isValid());
-
-        if (!group.bottom->isStatic())
-            m_innerBottomRubberBand->setAnchor(group.bottom);
-
-        if (!group.top->isStatic())
-            m_innerTopRubberBand->setAnchor(group.top);
-
-        if (!group.left->isStatic())
-            m_innerLeftRubberBand->setAnchor(group.left);
-
-        if (!group.right->isStatic())
-            m_innerRightRubberBand->setAnchor(group.right);
-
+    if (isHovered()) {
+        setVisible(true);
+        raise();
     } else {
-        m_innerBottomRubberBand->setAnchor(nullptr);
-        m_innerTopRubberBand->setAnchor(nullptr);
-        m_innerLeftRubberBand->setAnchor(nullptr);
-        m_innerRightRubberBand->setAnchor(nullptr);
-    }
-}
-
-AnimatedCenterRubberBand::AnimatedCenterRubberBand(AnimatedIndicators *parent)
-    : AnimatedRubberBand(DropIndicatorOverlayInterface::DropLocation_Center, parent)
-{
-    connect(q, &AnimatedIndicators::hoveredFrameChanged, this, [this] (Frame *f) {
-        hoveredFrame = f;
-    });
-    animation.setPropertyName("length"); // delayed, since the getters are virtual
-}
-
-void AnimatedCenterRubberBand::animatedInitialShow()
-{
-    setLength(CENTER_RUBBERBAND_SIZE);
-}
-
-void AnimatedCenterRubberBand::animatedInflate()
-{
-    setLengthAnimated(INFLATED_CENTER_RUBBERBAND_SIZE);
-}
+        setCurrentDropLocation(DropLocation_None);
+    } // visibility is set to false when the hide animation ends
 
-void AnimatedCenterRubberBand::animatedDeflate()
-{
-    setLengthAnimated(CENTER_RUBBERBAND_SIZE);
-}
-
-void AnimatedCenterRubberBand::animatedHide()
-{
-    // It's not animated.
-    resetGeometry();
-    hide();
-}
-
-void AnimatedCenterRubberBand::resetGeometry()
-{
-    setLength(CENTER_RUBBERBAND_SIZE);
+    updateTargets();
 }
 
-void AnimatedCenterRubberBand::onHoveredFrameChanged(Frame *frame)
+void AnimatedIndicators::onHoveredFrameChanged(Frame *)
 {
-    if (hoveredFrame != frame) {
-        hoveredFrame = frame;
-        recenter();
+    // The inner bands grow again on the new frame, instead of jumping there
+    for (Band &band : m_bands) {
+        if (!isOutterLocation(band.location))
+            band.length = 0;
     }
-}
 
-void AnimatedCenterRubberBand::setLength(const QVariant &v)
-{
-    resize(v.toSize());
-    recenter();
-}
-
-QVariant AnimatedCenterRubberBand::length() const
-{
-    return size();
-}
-
-void AnimatedCenterRubberBand::updatePosition()
-{
-    recenter();
-}
-
-void AnimatedCenterRubberBand::recenter()
-{
-    if (hoveredFrame) {
-        QRect geo = geometry();
-        geo.moveCenter(hoveredFrame->geometry().center());
-        setGeometry(geo);
-    }
+    update();
+    updateTargets();
 }
 
-AnimatedOutterRubberBand::AnimatedOutterRubberBand(Qt::Orientation orient,
-                                                   DropIndicatorOverlayInterface::DropLocation location,
-                                                   AnimatedIndicators *parent_)
-    : AnimatedRubberBand(location, parent_)
-    , orientation(orient)
+bool AnimatedIndicators::bandIsAvailable(DropIndicatorOverlayInterface::DropLocation location) const
 {
-    animation.setPropertyName("length"); // delayed, since the getters are virtual
-}
+    if (!isHovered())
+        return false;
 
-void AnimatedOutterRubberBand::animatedInitialShow()
-{
-    setLengthAnimated(RUBBERBAND_LENGTH);
-}
+    if (isOutterLocation(location))
+        return !m_hoveredFrame || !m_hoveredFrame->isTheOnlyFrame();
 
-void AnimatedOutterRubberBand::animatedInflate()
-{
-    setLengthAnimated(INFLATED_RUBBERBAND_LENGTH);
+    return m_hoveredFrame != nullptr;
 }
 
-void AnimatedOutterRubberBand::animatedDeflate()
+qreal AnimatedIndicators::lengthFor(DropIndicatorOverlayInterface::DropLocation location, BandState state) const
 {
-    setLengthAnimated(RUBBERBAND_LENGTH);
-}
+    if (state == BandState_Hidden)
+        return 0;
 
-void AnimatedOutterRubberBand::animatedHide()
-{
-    setLengthAnimated(0);
-}
+    if (location == DropLocation_Center) {
+        // Length is the side of the square in the middle of the frame
+        const QSize frameSize = m_hoveredFrame ? m_hoveredFrame->size() : size();
+        const int side = qMin(frameSize.width(), frameSize.height());
+        return state == BandState_Inflated ? side / 2 : side / 3;
+    }
 
-void AnimatedOutterRubberBand::resetGeometry()
-{
-    setLength(0);
-    updateAnchorOffset();
-}
+    return state == BandState_Inflated ? INFLATED_RUBBERBAND_LENGTH : RUBBERBAND_LENGTH;
+}
+
+QRect AnimatedIndicators::rectForBand(DropIndicatorOverlayInterface::DropLocation location, qreal length) const
+{
+    const int len = qRound(length);
+    const QRect area = isOutterLocation(location) ? rect()
+                                                  : (m_hoveredFrame ? m_hoveredFrame->geometry().adjusted(INNER_RUBBERBAND_MARGIN, INNER_RUBBERBAND_MARGIN,
+                                                                                                          -INNER_RUBBERBAND_MARGIN, -INNER_RUBBERBAND_MARGIN)
+                                                                    : QRect());
+    switch (location) {
+    case DropLocation_Left:
+    case DropLocation_OutterLeft:
+        return QRect(area.x(), area.y(), len, area.height());
+    case DropLocation_Top:
+    case DropLocation_OutterTop:
+        return QRect(area.x(), area.y(), area.width(), len);
+    case DropLocation_Right:
+    case DropLocation_OutterRight:
+        return QRect(area.right() - len + 1, area.y(), len, area.height());
+    case DropLocation_Bottom:
+    case DropLocation_OutterBottom:
+        return QRect(area.x(), area.bottom() - len + 1, area.width(), len);
+    case DropLocation_Center: {
+        if (!m_hoveredFrame)
+            return QRect();
+        QRect r(0, 0, len, len);
+        r.moveCenter(m_hoveredFrame->geometry().center());
+        return r;
+    }
+    case DropLocation_None:
+        break;
+    }
 
-void AnimatedOutterRubberBand::updatePosition()
-{
-    /*auto group = m_dropArea->staticAnchorGroup();
-    auto leftAnchorGeo = group.left->geometry();
-    auto rightAnchorGeo = group.right->geometry();
-    auto topAnchorGeo = group.top->geometry();
-    auto bottomAnchorGeo = group.bottom->geometry();
-
-    QRect newTopGeo = QRect(topAnchorGeo.x(), topAnchorGeo.bottom(), width(), m_outterTopRubberBand->height());
-    m_outterTopRubberBand->setGeometry(newTopGeo);
-    m_outterBottomRubberBand->setGeometry(bottomAnchorGeo.x(), bottomAnchorGeo.y() - m_outterBottomRubberBand->height() + RUBBERBAND_SPACING, width(), m_outterBottomRubberBand->height());
-    m_outterLeftRubberBand->setGeometry(leftAnchorGeo.right(), m_outterTopRubberBand->geometry().bottom() + RUBBERBAND_SPACING, m_outterLeftRubberBand->width(), height() - 2*RUBBERBAND_SPACING - m_outterBottomRubberBand->height() - m_outterTopRubberBand->height());
-    m_outterRightRubberBand->setGeometry(rightAnchorGeo.right() - m_outterRightRubberBand->width() + RUBBERBAND_SPACING, m_outterTopRubberBand->geometry().bottom() + RUBBERBAND_SPACING, m_outterRightRubberBand->width(), height() - 2*RUBBERBAND_SPACING - m_outterBottomRubberBand->height() - m_outterTopRubberBand->height());*/
+    return QRect();
 }
 
-QVariant AnimatedOutterRubberBand::length() const
+void AnimatedIndicators::updateTargets()
 {
-    return orientation == Qt::Vertical ? width() : height();
-}
+    bool changed = false;
+    for (Band &band : m_bands) {
+        BandState state = BandState_Hidden;
+        if (bandIsAvailable(band.location))
+            state = band.location == currentDropLocation() ? BandState_Inflated : BandState_Shown;
 
-void AnimatedOutterRubberBand::setLength(const QVariant &value)
-{
-    if (value != length()) {
-        if (orientation == Qt::Vertical) {
-            resize(value.toInt(), height());
-        } else {
-            resize(width(), value.toInt());
+        const qreal target = lengthFor(band.location, state);
+        if (!qFuzzyCompare(target + 1, band.targetLength + 1)) {
+            band.targetLength = target;
+            changed = true;
         }
-        Q_EMIT positionChanged(value.toInt());
-        updateAnchorOffset();
     }
-}
 
-void AnimatedOutterRubberBand::setAnchor(Anchor *a)
-{
-    if (a != anchor) {
-        this->anchor = a;
-        updateAnchorOffset();
+    if (!changed)
+        return;
+
+    // Restart from wherever the bands are now, so reversing mid-animation is smooth
+    for (Band &band : m_bands)
+        band.startLength = band.length;
+
+    // Don't tick faster than the display can show
+    QScreen *screen = window()->windowHandle() ? window()->windowHandle()->screen() : qApp->primaryScreen();
+    const qreal refreshRate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60;
+    m_animationTimer.setInterval(qMax(1, qRound(1000 / refreshRate)));
+    m_animationClock.start();
+    if (!m_animationTimer.isActive())
+        m_animationTimer.start();
+}
+
+void AnimatedIndicators::onAnimationTick()
+{
+    static const QEasingCurve easing(QEasingCurve::OutBack);
+    const qreal progress = qMin<qreal>(1, qreal(m_animationClock.elapsed()) / ANIMATION_DURATION);
+    const qreal eased = progress < 1 ? easing.valueForProgress(progress) : 1;
+
+    // Only repaint what the bands covered before and after this step
+    QRegion dirty;
+    bool anyVisible = false;
+    for (Band &band : m_bands) {
+        const qreal newLength = qMax<qreal>(0, band.startLength + (band.targetLength - band.startLength) * eased);
+        if (!qFuzzyCompare(newLength + 1, band.length + 1)) {
+            dirty += rectForBand(band.location, band.length);
+            dirty += rectForBand(band.location, newLength);
+            band.length = newLength;
+        }
+
+        anyVisible |= band.length > 0;
     }
-}
 
-void AnimatedOutterRubberBand::updateAnchorOffset()
-{
-    if (anchor) {
-        if (isVisible()) {
-            anchor->setPositionOffset(length().toInt());
-        } else {
-            anchor->setPositionOffset(0);
-        }
+    if (!dirty.isEmpty())
+        update(dirty);
+
+    if (progress >= 1) {
+        m_animationTimer.stop();
+        if (!anyVisible && !isHovered())
+            setVisible(false);
     }
 }
 
-void AnimatedOutterRubberBand::paintEvent(QPaintEvent *)
+void AnimatedIndicators::paintEvent(QPaintEvent *)
 {
     QPainter p(this);
-    const int t = length().toInt();
-    p.setOpacity(-(0.0007625272331 * t * t) + (0.06241830065 * t));
-    QPainterPath path;
+    p.setRenderHint(QPainter::Antialiasing);
     p.setPen(QPen(QColor(0xf6, 0x47, 0x6b, 0xae)));
 
-    QRectF r = rect();
-    if (orientation == Qt::Vertical) {
-        r = r.adjusted(0.5, 0.5, -RUBBERBAND_SPACING - 0.5, -0.5);
-    } else {
-        r = r.adjusted(0.5, 0.5, -0.5, -RUBBERBAND_SPACING - 0.5);
-    }
-
-    path.addRoundedRect(r, 3, 3);
-    p.fillPath(path, QColor(0x39, 0x34, 0x47, 0x6f));
-    p.setRenderHint(QPainter::Antialiasing);
-    p.drawPath(path);
-}
+    for (const Band &band : m_bands) {
+        if (band.length < 1)
+            continue;
 
-AnimatedInnerRubberBand::AnimatedInnerRubberBand(Qt::Orientation orient,
-                                                 DropIndicatorOverlayInterface::DropLocation location,
-                                                 AnimatedIndicators *parent_)
-    : AnimatedOutterRubberBand(orient, location, parent_)
-{
+        QRectF r = rectForBand(band.location, band.length);
+        qreal opacity = 0.8;
+        if (band.location != DropLocation_Center) {
+            const qreal t = band.length;
+            opacity = qBound<qreal>(0, -(0.0007625272331 * t * t) + (0.06241830065 * t), 1);
+        }
 
-}
+        switch (band.location) {
+        case DropLocation_Left:
+        case DropLocation_OutterLeft:
+            r = r.adjusted(0.5, 0.5, -RUBBERBAND_SPACING - 0.5, -0.5);
+            break;
+        case DropLocation_Right:
+        case DropLocation_OutterRight:
+            r = r.adjusted(RUBBERBAND_SPACING + 0.5, 0.5, -0.5, -0.5);
+            break;
+        case DropLocation_Top:
+        case DropLocation_OutterTop:
+            r = r.adjusted(0.5, 0.5, -0.5, -RUBBERBAND_SPACING - 0.5);
+            break;
+        case DropLocation_Bottom:
+        case DropLocation_OutterBottom:
+            r = r.adjusted(0.5, RUBBERBAND_SPACING + 0.5, -0.5, -0.5);
+            break;
+        default:
+            r = r.adjusted(0.5, 0.5, -0.5, -0.5);
+            break;
+        }
 
-AnimatedInnerRubberBand::~AnimatedInnerRubberBand()
-{
+        QPainterPath path;
+        path.addRoundedRect(r, 3, 3);
+        p.setOpacity(opacity);
+        p.fillPath(path, QColor(0x39, 0x34, 0x47, 0x6f));
+        p.drawPath(path);
+    }
 }
-
-#include <AnimatedIndicators.moc>
@@ -23,132 +23,66 @@
 
 #include "DropIndicatorOverlayInterface_p.h"
 
-#include <QRubberBand>
-#include <QList>
-#include <QPropertyAnimation>
+#include <QTimer>
+#include <QElapsedTimer>
 
 namespace KDDockWidgets {
 
-class Anchor;
-class AnimatedIndicators;
-
-class AnimatedRubberBand : public QRubberBand
-{
-    Q_OBJECT
-    Q_PROPERTY(QVariant length READ length WRITE setLength) // clazy:exclude=qproperty-without-notify
-public:
-    typedef QList<AnimatedRubberBand *> List;
-    explicit AnimatedRubberBand(DropIndicatorOverlayInterface::DropLocation, AnimatedIndicators *parent = nullptr);
-
-    virtual void animatedInitialShow() = 0;
-    virtual void animatedInflate() = 0;
-    virtual void animatedDeflate() = 0;
-    virtual void animatedHide() = 0;
-    virtual void resetGeometry() = 0;
-    virtual void onHoveredFrameChanged(Frame *) = 0;
-    virtual void setLength(const QVariant &) = 0;
-    virtual void updatePosition() = 0;
-    virtual QVariant length() const = 0;
-
-    bool hover(QPoint globalPos);
-Q_SIGNALS:
-    void animationFinished();
-    void hidden();
-    void hovered();
-    void notHovered();
-    void positionChanged(int);
-
-public:
-    void setLengthAnimated(const QVariant &value);
-    bool inflated = false;
-    const DropIndicatorOverlayInterface::DropLocation dropLocation;
-    QPropertyAnimation animation;
-    AnimatedIndicators *const q;
-    QPointer<Frame> hoveredFrame;
-};
-
-class AnimatedOutterRubberBand  : public AnimatedRubberBand
-{
-    Q_OBJECT
-public:
-    explicit AnimatedOutterRubberBand(Qt::Orientation orientation, DropIndicatorOverlayInterface::DropLocation, AnimatedIndicators *parent = nullptr);
-    void setAnchor(Anchor *);
-    QVariant length() const override;
-    void setLength(const QVariant &) override;
-    void updateAnchorOffset();
-
-    void animatedInitialShow() override;
-    void animatedInflate() override;
-    void animatedDeflate() override;
-    void animatedHide() override;
-    void resetGeometry() override;
-    void onHoveredFrameChanged(Frame *) override {}
-    void updatePosition() override;
-public:
-    void paintEvent(QPaintEvent *) override;
-    const Qt::Orientation orientation;
-    Anchor *anchor = nullptr;
-};
-
-class AnimatedInnerRubberBand : public AnimatedOutterRubberBand
-{
-    Q_OBJECT
-public:
-    explicit AnimatedInnerRubberBand(Qt::Orientation orientation,
-                                     DropIndicatorOverlayInterface::DropLocation location,
-                                     AnimatedIndicators *parent = nullptr);
-
-    ~AnimatedInnerRubberBand() override;
-};
-
-class AnimatedCenterRubberBand : public AnimatedRubberBand
-{
-    Q_OBJECT
-public:
-    explicit AnimatedCenterRubberBand(AnimatedIndicators *parent = nullptr);
-    void recenter();
-    void animatedInitialShow() override;
-    void animatedInflate() override;
-    void animatedDeflate() override;
-    void animatedHide() override;
-    void resetGeometry() override;
-    void onHoveredFrameChanged(Frame *) override;
-    void setLength(const QVariant &v) override;
-    QVariant length() const override;
-    void updatePosition() override;
-};
-
+/**
+ * @brief Drop indicators drawn as bands along the drop area's and the hovered frame's edges.
+ *
+ * The bands grow when the drag starts and inflate when hovered. Unlike ClassicIndicators there's no
+ * top-level window nor a widget per indicator: all bands are painted by this overlay, in a single
+ * paintEvent(), driven by a single timer that ticks at most once per display refresh.
+ */
 class AnimatedIndicators : public DropIndicatorOverlayInterface
 {
     Q_OBJECT
 public:
     explicit AnimatedIndicators(DropArea *dropArea);
+    ~AnimatedIndicators() override;
 
     Type indicatorType() const override;
     void hover(QPoint globalPos) override;
-    void updateVisibility() override;
-    void updateRubberBandPositions();
-    bool allRubberBandsAreHidden() const;
     QPoint posForIndicator(DropLocation) const override;
-Q_SIGNALS:
-    void hovered();
-    void notHovered();
-private:
-    friend class AnimationState_None;
-    friend class AnimationStateBase;
+
+protected:
+    void paintEvent(QPaintEvent *) override;
+    void updateVisibility() override;
     void onHoveredFrameChanged(Frame *) override;
-    AnimatedOutterRubberBand *const m_outterLeftRubberBand;
-    AnimatedOutterRubberBand *const m_outterRightRubberBand;
-    AnimatedOutterRubberBand *const m_outterTopRubberBand;
-    AnimatedOutterRubberBand *const m_outterBottomRubberBand;
-    AnimatedCenterRubberBand *const m_centerRubberBand;
-    AnimatedInnerRubberBand *const m_innerLeftRubberBand;
-    AnimatedInnerRubberBand *const m_innerRightRubberBand;
-    AnimatedInnerRubberBand *const m_innerTopRubberBand;
-    AnimatedInnerRubberBand *const m_innerBottomRubberBand;
-
-    AnimatedRubberBand::List m_rubberBands;
+
+private:
+    enum BandState {
+        BandState_Hidden = 0,
+        BandState_Shown,
+        BandState_Inflated
+    };
+
+    struct Band {
+        DropLocation location = DropLocation_None;
+        qreal length = 0; // Current length, in pixels, perpendicular to the edge
+        qreal startLength = 0; // Length when the current animation started
+        qreal targetLength = 0;
+    };
+
+    ///@brief Returns whether the band for @p location can be used with the current hovered frame
+    bool bandIsAvailable(DropLocation) const;
+
+    ///@brief The length the band for @p location has in @p state
+    qreal lengthFor(DropLocation, BandState) const;
+
+    ///@brief The rect the band for @p location occupies when it has length @p length. In local coordinates.
+    QRect rectForBand(DropLocation, qreal length) const;
+
+    ///@brief Recomputes each band's target length and starts animating towards them if any changed
+    void updateTargets();
+    void onAnimationTick();
+
+    Band m_bands[9]; // One per DropLocation, excluding DropLocation_None
+    QTimer m_animationTimer;
+    QElapsedTimer m_animationClock;
 };
+
 }
 
 #endif
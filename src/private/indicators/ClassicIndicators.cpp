@@ -20,13 +20,20 @@
 
 #include "ClassicIndicators_p.h"
 #include "DropArea_p.h"
+#include "DockRegistry_p.h"
 #include "DragController_p.h"
 #include "Frame_p.h"
 #include "Logging_p.h"
 #include "Utils_p.h"
+#include "Config.h"
 
+#include <QApplication>
+#include <QMap>
 #include <QPainter>
+#include <QScreen>
 #include <QRubberBand>
+#include <QStyle>
+#include <QStyleOptionRubberBand>
 
 #define INDICATOR_WIDTH 40
 #define OUTTER_INDICATOR_MARGIN 10
@@ -41,11 +48,7 @@ class IndicatorWindow;
 void Indicator::paintEvent(QPaintEvent *)
 {
     QPainter p(this);
-    if (m_hovered)
-        p.drawImage(rect(), m_imageActive, rect());
-    else
-        p.drawImage(rect(), m_image, rect());
-
+    p.drawPixmap(rect(), pixmaps(devicePixelRatioF()).at(pixmapIndex(m_dropLocation, m_hovered)));
 }
 
 void Indicator::setHovered(bool hovered)
@@ -53,6 +56,7 @@ void Indicator::setHovered(bool hovered)
     if (hovered != m_hovered) {
         m_hovered = hovered;
         update();
+        ClassicIndicators *q = m_indicatorWindow->classicIndicators;
         if (hovered) {
             q->setDropLocation(m_dropLocation);
         } else if (q->currentDropLocation() == m_dropLocation) {
@@ -61,13 +65,13 @@ void Indicator::setHovered(bool hovered)
     }
 }
 
-QString Indicator::iconName(bool active) const
+QString Indicator::iconName(ClassicIndicators::DropLocation location, bool active)
 {
     QString suffix = active ? QStringLiteral("_active")
                             : QString();
 
     QString name;
-    switch (m_dropLocation) {
+    switch (location) {
     case DropIndicatorOverlayInterface::DropLocation_Center:
         name = QStringLiteral("center");
         break;
@@ -102,25 +106,71 @@ QString Indicator::iconName(bool active) const
     return name + suffix;
 }
 
-QString Indicator::iconFileName(bool active) const
+QString Indicator::iconFileName(ClassicIndicators::DropLocation location, bool active)
 {
-    const QString name = iconName(active);
+    const QString name = iconName(location, active);
     return KDDockWidgets::windowManagerHasTranslucency() ? QStringLiteral(":/img/classic_indicators/%1.png").arg(name)
                                                          : QStringLiteral(":/img/classic_indicators/opaque/%1.png").arg(name);
 }
 
+int Indicator::pixmapIndex(ClassicIndicators::DropLocation location, bool active)
+{
+    return 2 * int(location) + (active ? 1 : 0);
+}
+
+// The opaque variants are used when there's no compositor, so that's part of the key too
+typedef QMap<QPair<qreal, bool>, QVector<QPixmap>> IndicatorPixmapCache;
+Q_GLOBAL_STATIC(IndicatorPixmapCache, s_pixmapCache)
+
+const QVector<QPixmap> &Indicator::pixmaps(qreal dpr)
+{
+    IndicatorPixmapCache &cache = *s_pixmapCache;
+    const QPair<qreal, bool> key(dpr, KDDockWidgets::windowManagerHasTranslucency());
+
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        const int lastLocation = DropIndicatorOverlayInterface::DropLocation_OutterBottom;
+        const int size = qRound(INDICATOR_WIDTH * dpr);
+        QVector<QPixmap> result(pixmapIndex(ClassicIndicators::DropLocation(lastLocation), true) + 1);
+        for (int i = DropIndicatorOverlayInterface::DropLocation_Left; i <= lastLocation; ++i) {
+            const auto location = ClassicIndicators::DropLocation(i);
+            for (bool active : { false, true }) {
+                QPixmap pixmap = QPixmap::fromImage(QImage(iconFileName(location, active)).scaled(size, size));
+                pixmap.setDevicePixelRatio(dpr);
+                result[pixmapIndex(location, active)] = pixmap;
+            }
+        }
+
+        it = cache.insert(key, result);
+    }
+
+    return *it;
+}
+
+void Indicator::preloadPixmaps()
+{
+    static bool s_preloaded = false;
+    if (s_preloaded)
+        return;
+
+    s_preloaded = true;
+    const QList<QScreen *> screens = qApp->screens();
+    for (QScreen *screen : screens)
+        pixmaps(screen->devicePixelRatio());
+}
+
 IndicatorWindow::IndicatorWindow(ClassicIndicators *classicIndicators_, QWidget *)
     : QWidget(nullptr, Qt::Tool | Qt::BypassWindowManagerHint)
     , classicIndicators(classicIndicators_)
-    , m_center(new Indicator(classicIndicators, this, DropIndicatorOverlayInterface::DropLocation_Center)) // Each indicator is not a top-level. Otherwise there's noticeable delay.
-    , m_left(new Indicator(classicIndicators, this, DropIndicatorOverlayInterface::DropLocation_Left))
-    , m_right(new Indicator(classicIndicators, this, DropIndicatorOverlayInterface::DropLocation_Right))
-    , m_bottom(new Indicator(classicIndicators, this, DropIndicatorOverlayInterface::DropLocation_Bottom))
-    , m_top(new Indicator(classicIndicators, this, DropIndicatorOverlayInterface::DropLocation_Top))
-    , m_outterLeft(new Indicator(classicIndicators, this, DropIndicatorOverlayInterface::DropLocation_OutterLeft))
-    , m_outterRight(new Indicator(classicIndicators, this, DropIndicatorOverlayInterface::DropLocation_OutterRight))
-    , m_outterBottom(new Indicator(classicIndicators, this, DropIndicatorOverlayInterface::DropLocation_OutterBottom))
-    , m_outterTop(new Indicator(classicIndicators, this, DropIndicatorOverlayInterface::DropLocation_OutterTop))
+    , m_center(new Indicator(this, DropIndicatorOverlayInterface::DropLocation_Center)) // Each indicator is not a top-level. Otherwise there's noticeable delay.
+    , m_left(new Indicator(this, DropIndicatorOverlayInterface::DropLocation_Left))
+    , m_right(new Indicator(this, DropIndicatorOverlayInterface::DropLocation_Right))
+    , m_bottom(new Indicator(this, DropIndicatorOverlayInterface::DropLocation_Bottom))
+    , m_top(new Indicator(this, DropIndicatorOverlayInterface::DropLocation_Top))
+    , m_outterLeft(new Indicator(this, DropIndicatorOverlayInterface::DropLocation_OutterLeft))
+    , m_outterRight(new Indicator(this, DropIndicatorOverlayInterface::DropLocation_OutterRight))
+    , m_outterBottom(new Indicator(this, DropIndicatorOverlayInterface::DropLocation_OutterBottom))
+    , m_outterTop(new Indicator(this, DropIndicatorOverlayInterface::DropLocation_OutterTop))
 {
     setWindowFlag(Qt::FramelessWindowHint, true);
     setAttribute(Qt::WA_TranslucentBackground);
@@ -132,10 +182,55 @@ IndicatorWindow::IndicatorWindow(ClassicIndicators *classicIndicators_, QWidget
     setObjectName(QStringLiteral("_docks_IndicatorWindow_Overlay"));
 }
 
+static IndicatorWindow *s_sharedIndicatorWindow = nullptr;
+static int s_sharedIndicatorWindowRefCount = 0;
+
+IndicatorWindow *IndicatorWindow::acquireShared(ClassicIndicators *classicIndicators)
+{
+    if (!s_sharedIndicatorWindow)
+        s_sharedIndicatorWindow = new IndicatorWindow(classicIndicators, /*parent=*/ nullptr);
+
+    s_sharedIndicatorWindowRefCount++;
+    return s_sharedIndicatorWindow;
+}
+
+void IndicatorWindow::releaseShared(ClassicIndicators *classicIndicators)
+{
+    Q_ASSERT(s_sharedIndicatorWindow && s_sharedIndicatorWindowRefCount > 0);
+    s_sharedIndicatorWindowRefCount--;
+
+    if (s_sharedIndicatorWindowRefCount == 0) {
+        delete s_sharedIndicatorWindow;
+        s_sharedIndicatorWindow = nullptr;
+    } else if (s_sharedIndicatorWindow->classicIndicators == classicIndicators) {
+        // Don't leave a dangling pointer behind, the next hovered drop area will retarget it
+        s_sharedIndicatorWindow->setVisible(false);
+        s_sharedIndicatorWindow->classicIndicators = nullptr;
+    }
+}
+
+void IndicatorWindow::setClassicIndicators(ClassicIndicators *classicIndicators_)
+{
+    if (classicIndicators == classicIndicators_)
+        return;
+
+    classicIndicators = classicIndicators_;
+    m_hoveredLocation = DropIndicatorOverlayInterface::DropLocation_None;
+    for (Indicator *indicator : qAsConst(m_indicators)) {
+        // Without going through setHovered(), as that would change the previous drop area's location
+        indicator->m_hovered = false;
+        indicator->update();
+    }
+
+    updatePosition();
+}
+
 bool IndicatorWindow::event(QEvent *e)
 {
-    if (e->type() == QEvent::Show) {
+    if (e->type() == QEvent::Show && classicIndicators) {
         updatePosition();
+    } else if (e->type() == QEvent::Hide) {
+        m_raisedFor = nullptr;
     }
 
     return QWidget::event(e);
@@ -169,13 +264,46 @@ Indicator *IndicatorWindow::indicatorForLocation(DropIndicatorOverlayInterface::
     return nullptr;
 }
 
+DropIndicatorOverlayInterface::DropLocation IndicatorWindow::locationForPos(QPoint localPos) const
+{
+    // Indicators don't overlap
+    for (int i = DropIndicatorOverlayInterface::DropLocation_Left; i <= DropIndicatorOverlayInterface::DropLocation_OutterBottom; ++i) {
+        if (m_hotZones[i].contains(localPos))
+            return DropIndicatorOverlayInterface::DropLocation(i);
+    }
+
+    return DropIndicatorOverlayInterface::DropLocation_None;
+}
+
+void IndicatorWindow::updateHotZones()
+{
+    for (Indicator *indicator : qAsConst(m_indicators))
+        m_hotZones[indicator->m_dropLocation] = indicator->isHidden() ? QRect() : indicator->geometry();
+}
+
 void IndicatorWindow::updateMask()
 {
+    // setMask() can be an expensive native call (shape extension on X11), skip it if nothing changed
+    Frame *hoveredFrame = classicIndicators ? classicIndicators->m_hoveredFrame : nullptr;
+    const QRect hoveredFrameGeometry = hoveredFrame ? hoveredFrame->geometry() : QRect();
+    int visibleIndicators = 0;
+    for (int i = 0; i < m_indicators.size(); ++i) {
+        if (!m_indicators.at(i)->isHidden()) // Not isVisible(), which also depends on this window being shown
+            visibleIndicators |= 1 << i;
+    }
+
+    if (visibleIndicators == m_maskVisibleIndicators && rect() == m_maskRect && hoveredFrameGeometry == m_maskHoveredFrameGeometry)
+        return;
+
+    m_maskVisibleIndicators = visibleIndicators;
+    m_maskRect = rect();
+    m_maskHoveredFrameGeometry = hoveredFrameGeometry;
+
     QRegion region;
 
     if (!KDDockWidgets::windowManagerHasTranslucency()) {
         for (Indicator *indicator : qAsConst(m_indicators)) {
-            if (indicator->isVisible())
+            if (!indicator->isHidden())
                 region = region.united(QRegion(indicator->geometry(), QRegion::Rectangle));
         }
     }
@@ -191,7 +319,7 @@ void IndicatorWindow::resizeEvent(QResizeEvent *ev)
 
 void IndicatorWindow::updateIndicatorVisibility(bool visible)
 {
-    Frame *hoveredFrame = classicIndicators->m_hoveredFrame;
+    Frame *hoveredFrame = classicIndicators ? classicIndicators->m_hoveredFrame : nullptr;
     const bool isTheOnlyFrame = hoveredFrame && hoveredFrame->isTheOnlyFrame();
 
     const bool innerShouldBeVisible = visible && hoveredFrame;
@@ -203,19 +331,31 @@ void IndicatorWindow::updateIndicatorVisibility(bool visible)
     for (Indicator *indicator : { m_outterTop, m_outterLeft, m_outterRight, m_outterBottom })
         indicator->setVisible(outterShouldBeVisible);
 
+    updateHotZones();
     updateMask();
 }
 
 void IndicatorWindow::hover(QPoint globalPos)
 {
-    for (Indicator *indicator : qAsConst(m_indicators)) {
-        if (indicator->isVisible())
-            indicator->setHovered(indicator->rect().contains(indicator->mapFromGlobal(globalPos)));
-    }
+    const DropIndicatorOverlayInterface::DropLocation location = isVisible() ? locationForPos(mapFromGlobal(globalPos))
+                                                                             : DropIndicatorOverlayInterface::DropLocation_None;
+    if (location == m_hoveredLocation)
+        return;
+
+    // Unhovered first, so the drop location ends up being the new one
+    if (Indicator *previous = indicatorForLocation(m_hoveredLocation))
+        previous->setHovered(false);
+
+    m_hoveredLocation = location;
+    if (Indicator *indicator = indicatorForLocation(location))
+        indicator->setHovered(true);
 }
 
 void IndicatorWindow::updatePosition()
 {
+    if (!classicIndicators)
+        return;
+
     QRect rect = classicIndicators->rect();
     QPoint pos = classicIndicators->mapToGlobal(QPoint(0, 0));
     rect.moveTo(pos);
@@ -232,7 +372,7 @@ void IndicatorWindow::updatePositions()
     m_outterBottom->move(r.center().x() - halfIndicatorWidth, r.y() + height() - indicatorWidth - OUTTER_INDICATOR_MARGIN);
     m_outterTop->move(r.center().x() - halfIndicatorWidth, r.y() + OUTTER_INDICATOR_MARGIN);
     m_outterRight->move(r.x() + width() - indicatorWidth - OUTTER_INDICATOR_MARGIN, r.center().y() - halfIndicatorWidth);
-    Frame *hoveredFrame = classicIndicators->m_hoveredFrame;
+    Frame *hoveredFrame = classicIndicators ? classicIndicators->m_hoveredFrame : nullptr;
     if (hoveredFrame) {
         QRect hoveredRect = hoveredFrame->geometry();
         m_center->move(r.topLeft() + hoveredRect.center() - QPoint(halfIndicatorWidth, halfIndicatorWidth));
@@ -241,32 +381,46 @@ void IndicatorWindow::updatePositions()
         m_bottom->move(m_center->pos() + QPoint(0, indicatorWidth + OUTTER_INDICATOR_MARGIN));
         m_left->move(m_center->pos() - QPoint(indicatorWidth + OUTTER_INDICATOR_MARGIN, 0));
     }
+
+    updateHotZones();
+    updateMask(); // The indicators moved
 }
 
-Indicator::Indicator(ClassicIndicators *classicIndicators, IndicatorWindow *parent, ClassicIndicators::DropLocation location)
+Indicator::Indicator(IndicatorWindow *parent, ClassicIndicators::DropLocation location)
     : QWidget(parent)
-    , q(classicIndicators)
+    , m_indicatorWindow(parent)
     , m_dropLocation(location)
 {
-    m_image = QImage(iconFileName(/*active=*/ false)).scaled(INDICATOR_WIDTH, INDICATOR_WIDTH);
-    m_imageActive = QImage(iconFileName(/*active=*/ true)).scaled(INDICATOR_WIDTH, INDICATOR_WIDTH);
-    setFixedSize(m_image.size());
+    setFixedSize(INDICATOR_WIDTH, INDICATOR_WIDTH);
     setVisible(true);
 }
 
 ClassicIndicators::ClassicIndicators(DropArea *dropArea)
     : DropIndicatorOverlayInterface(dropArea) // Is parented on the drop-area, not a toplevel.
-    , m_rubberBand(new QRubberBand(QRubberBand::Rectangle, rubberBandIsTopLevel() ? nullptr : dropArea))
-    , m_indicatorWindow(new IndicatorWindow(this, /*parent=*/ nullptr)) // Top-level so the indicators can appear above the window being dragged.
+    , m_rubberBand(Config::self().flags() & Config::Flag_PaintedRubberBand ? nullptr
+                                                                            : new QRubberBand(QRubberBand::Rectangle, rubberBandIsTopLevel() ? nullptr : dropArea))
+    , m_indicatorWindow(Config::self().flags() & Config::Flag_SharedIndicatorWindow ? IndicatorWindow::acquireShared(this)
+                                                                                     : new IndicatorWindow(this, /*parent=*/ nullptr)) // Top-level so the indicators can appear above the window being dragged.
+    , m_indicatorWindowIsShared(Config::self().flags() & Config::Flag_SharedIndicatorWindow)
 {
     setVisible(false);
-    if (rubberBandIsTopLevel())
-        m_rubberBand->setWindowOpacity(0.5);
+    if (m_rubberBand) {
+        if (rubberBandIsTopLevel())
+            m_rubberBand->setWindowOpacity(0.5);
+    } else {
+        // Only shown to paint the rubber band, the indicators are in their own window
+        setAttribute(Qt::WA_TransparentForMouseEvents);
+    }
+
+    Indicator::preloadPixmaps();
 }
 
 ClassicIndicators::~ClassicIndicators()
 {
-    delete m_indicatorWindow;
+    if (m_indicatorWindowIsShared)
+        IndicatorWindow::releaseShared(this);
+    else
+        delete m_indicatorWindow;
 }
 
 DropIndicatorOverlayInterface::Type ClassicIndicators::indicatorType() const
@@ -276,7 +430,28 @@ DropIndicatorOverlayInterface::Type ClassicIndicators::indicatorType() const
 
 void ClassicIndicators::hover(QPoint globalPos)
 {
-    m_indicatorWindow->hover(globalPos);
+    if (ownsIndicatorWindow())
+        m_indicatorWindow->hover(globalPos);
+}
+
+QWidget *ClassicIndicators::indicatorWindow() const
+{
+    return m_indicatorWindow;
+}
+
+QPair<int, quint64> ClassicIndicators::cachedPixmaps()
+{
+    QPair<int, quint64> result(0, 0);
+    for (const QVector<QPixmap> &pixmaps : qAsConst(*s_pixmapCache)) {
+        for (const QPixmap &pixmap : pixmaps) {
+            if (!pixmap.isNull()) {
+                result.first++;
+                result.second += quint64(pixmap.width()) * quint64(pixmap.height()) * quint64(pixmap.depth() / 8);
+            }
+        }
+    }
+
+    return result;
 }
 
 QPoint ClassicIndicators::posForIndicator(DropIndicatorOverlayInterface::DropLocation loc) const
@@ -288,14 +463,23 @@ QPoint ClassicIndicators::posForIndicator(DropIndicatorOverlayInterface::DropLoc
 void ClassicIndicators::updateVisibility()
 {
     if (isHovered()) {
+        m_indicatorWindow->setClassicIndicators(this);
         m_indicatorWindow->updatePositions();
         m_indicatorWindow->setVisible(true);
         m_indicatorWindow->updateIndicatorVisibility(true);
         raiseIndicators();
+        if (!m_rubberBand) {
+            setVisible(true);
+            raise();
+        }
     } else {
-        m_rubberBand->setVisible(false);
-        m_indicatorWindow->setVisible(false);
-        m_indicatorWindow->updateIndicatorVisibility(false);
+        hideRubberBand();
+        if (!m_rubberBand)
+            setVisible(false);
+        if (ownsIndicatorWindow()) { // Otherwise another drop area is already using the shared window
+            m_indicatorWindow->setVisible(false);
+            m_indicatorWindow->updateIndicatorVisibility(false);
+        }
     }
 }
 
@@ -312,12 +496,50 @@ void ClassicIndicators::hideEvent(QHideEvent *e)
 void ClassicIndicators::resizeEvent(QResizeEvent *ev)
 {
     QWidget::resizeEvent(ev);
-    m_indicatorWindow->resize(window()->size());
+    if (ownsIndicatorWindow())
+        m_indicatorWindow->resize(window()->size());
 }
 
-void ClassicIndicators::raiseIndicators()
+void ClassicIndicators::paintEvent(QPaintEvent *)
 {
-    m_indicatorWindow->raise();
+    if (m_paintedRubberBandRect.isNull())
+        return;
+
+    // What QRubberBand paints, just not in a widget of its own
+    QStyleOptionRubberBand option;
+    option.initFrom(this);
+    option.rect = m_paintedRubberBandRect;
+    option.shape = QRubberBand::Rectangle;
+    option.opaque = true;
+
+    QPainter p(this);
+    QStyleHintReturnMask mask;
+    if (style()->styleHint(QStyle::SH_RubberBand_Mask, &option, this, &mask))
+        p.setClipRegion(mask.region);
+
+    style()->drawControl(QStyle::CE_RubberBand, &option, &p, this);
+}
+
+bool ClassicIndicators::ownsIndicatorWindow() const
+{
+    return m_indicatorWindow->classicIndicators == this;
+}
+
+void ClassicIndicators::raiseIndicators(bool force)
+{
+    // Raising a top-level is a round trip to the window manager. The stacking only changes when
+    // the window is shown, retargeted to another drop area, when a new drag raises its window, or
+    // when other top-levels are shown or come to the front, which bumps topLevelsGeneration().
+    const int generation = DockRegistry::self()->topLevelsGeneration();
+    IndicatorWindow *w = m_indicatorWindow;
+    if (!force && w->m_raisedFor == this && w->m_raisedForWindowBeingDragged == m_windowBeingDragged
+        && w->m_raisedTopLevelsGeneration == generation)
+        return;
+
+    w->m_raisedFor = this;
+    w->m_raisedForWindowBeingDragged = m_windowBeingDragged;
+    w->m_raisedTopLevelsGeneration = generation;
+    w->raise();
 }
 
 KDDockWidgets::Location locationToMultisplitterLocation(ClassicIndicators::DropLocation location)
@@ -350,17 +572,12 @@ void ClassicIndicators::setDropLocation(ClassicIndicators::DropLocation location
     setCurrentDropLocation(location);
 
     if (location == DropLocation_None) {
-        m_rubberBand->setVisible(false);
+        hideRubberBand();
         return;
     }
 
     if (location == DropLocation_Center) {
-        m_rubberBand->setGeometry(geometryForRubberband(m_hoveredFrame ? m_hoveredFrame->geometry() : rect()));
-        m_rubberBand->setVisible(true);
-        if (rubberBandIsTopLevel()) {
-            m_rubberBand->raise();
-            raiseIndicators();
-        }
+        showRubberBand(m_hoveredFrame ? m_hoveredFrame->geometry() : rect());
         return;
     }
 
@@ -395,11 +612,39 @@ void ClassicIndicators::setDropLocation(ClassicIndicators::DropLocation location
     QRect rect = layout->rectForDrop(m_windowBeingDragged, multisplitterLocation,
                                      layout->itemForFrame(relativeToFrame));
 
-    m_rubberBand->setGeometry(geometryForRubberband(rect));
-    m_rubberBand->setVisible(true);
-    if (rubberBandIsTopLevel()) {
-        m_rubberBand->raise();
-        raiseIndicators();
+    showRubberBand(rect);
+}
+
+void ClassicIndicators::showRubberBand(QRect localRect)
+{
+    if (m_rubberBand) {
+        const bool wasHidden = m_rubberBand->isHidden();
+        m_rubberBand->setGeometry(geometryForRubberband(localRect));
+        m_rubberBand->setVisible(true);
+        if (rubberBandIsTopLevel() && wasHidden) {
+            // Moving it doesn't change the stacking, only showing it does
+            m_rubberBand->raise();
+            raiseIndicators(/*force=*/ true);
+        }
+        return;
+    }
+
+    // The overlay covers the drop area, see DropIndicatorOverlayInterface::setWindowBeingDragged()
+    localRect.translate(-pos());
+    if (localRect != m_paintedRubberBandRect) {
+        update(m_paintedRubberBandRect);
+        m_paintedRubberBandRect = localRect;
+        update(m_paintedRubberBandRect);
+    }
+}
+
+void ClassicIndicators::hideRubberBand()
+{
+    if (m_rubberBand) {
+        m_rubberBand->setVisible(false);
+    } else if (!m_paintedRubberBandRect.isNull()) {
+        update(m_paintedRubberBandRect);
+        m_paintedRubberBandRect = QRect();
     }
 }
 
@@ -23,6 +23,9 @@
 
 #include "DropIndicatorOverlayInterface_p.h"
 
+#include <QPixmap>
+#include <QVector>
+
 QT_BEGIN_NAMESPACE
 class QRubberBand;
 QT_END_NAMESPACE
@@ -41,21 +44,37 @@ public:
     Type indicatorType() const override;
     void hover(QPoint globalPos) override;
     QPoint posForIndicator(DropLocation) const override;
+    QWidget *indicatorWindow() const override;
+
+    ///@brief Returns the number of indicator pixmaps cached, for all device pixel ratios, and their bytes
+    static QPair<int, quint64> cachedPixmaps();
 protected:
     void showEvent(QShowEvent *) override;
     void hideEvent(QHideEvent *) override;
     void resizeEvent(QResizeEvent *) override;
+    void paintEvent(QPaintEvent *) override;
     void updateVisibility() override;
 private:
     friend class KDDockWidgets::Indicator;
     friend class KDDockWidgets::IndicatorWindow;
-    void raiseIndicators();
+    ///@brief Raises the indicator window, unless it's already above the windows shown since the last raise
+    ///@param force To raise it even then, for when this very drop area raised something above it
+    void raiseIndicators(bool force = false);
     void setDropLocation(DropLocation);
     QRect geometryForRubberband(QRect localRect) const;
     bool rubberBandIsTopLevel() const;
 
-    QRubberBand *const m_rubberBand;
+    ///@brief Shows the rubber band at @p localRect, in drop area coordinates
+    void showRubberBand(QRect localRect);
+    void hideRubberBand();
+
+    ///@brief Returns whether the indicator window is currently showing this drop area's indicators
+    bool ownsIndicatorWindow() const;
+
+    QRubberBand *const m_rubberBand; // nullptr with Flag_PaintedRubberBand
+    QRect m_paintedRubberBandRect; // With Flag_PaintedRubberBand. Null if hidden
     IndicatorWindow *const m_indicatorWindow;
+    const bool m_indicatorWindowIsShared;
 };
 
 class IndicatorWindow : public QWidget
@@ -65,6 +84,15 @@ public:
     explicit IndicatorWindow(ClassicIndicators *classicIndicators, QWidget * = nullptr);
     void hover(QPoint globalPos);
 
+    ///@brief Makes this window show the indicators of @p classicIndicators. Used with Flag_SharedIndicatorWindow
+    void setClassicIndicators(ClassicIndicators *classicIndicators);
+
+    ///@brief Returns the window shared by all ClassicIndicators, creating it if needed. Ref-counted.
+    static IndicatorWindow *acquireShared(ClassicIndicators *classicIndicators);
+
+    ///@brief Drops @p classicIndicators's reference to the shared window, deleting it after the last one
+    static void releaseShared(ClassicIndicators *classicIndicators);
+
     void updatePosition();
     void updatePositions();
     void updateIndicatorVisibility(bool visible);
@@ -73,11 +101,17 @@ public:
 
     Indicator *indicatorForLocation(DropIndicatorOverlayInterface::DropLocation loc) const;
 
+    ///@brief Returns the location whose indicator contains @p localPos, from the hot zone table
+    DropIndicatorOverlayInterface::DropLocation locationForPos(QPoint localPos) const;
+
+    ///@brief Refills the hot zone table, after the indicators moved or were shown or hidden
+    void updateHotZones();
+
     // When the compositor doesn't support translucency, we use a mask instead
     // Only happens on Linux
     void updateMask();
 
-    ClassicIndicators *const classicIndicators;
+    ClassicIndicators *classicIndicators;
     Indicator *const m_center;
     Indicator *const m_left;
     Indicator *const m_right;
@@ -88,6 +122,21 @@ public:
     Indicator *const m_outterBottom;
     Indicator *const m_outterTop;
     QVector<Indicator *> m_indicators;
+    DropIndicatorOverlayInterface::DropLocation m_hoveredLocation = DropIndicatorOverlayInterface::DropLocation_None;
+
+    // Each indicator's geometry, indexed by DropLocation. Null for the hidden ones.
+    // So hovering doesn't need to ask the indicator widgets.
+    QRect m_hotZones[DropIndicatorOverlayInterface::DropLocation_OutterBottom + 1];
+
+    // What the last raise() was for, see ClassicIndicators::raiseIndicators(). Reset on hide.
+    const ClassicIndicators *m_raisedFor = nullptr;
+    const QWidgetOrQuick *m_raisedForWindowBeingDragged = nullptr;
+    int m_raisedTopLevelsGeneration = -1;
+
+    // What the current mask was computed from, so updateMask() only calls setMask() when it changes
+    QRect m_maskRect;
+    QRect m_maskHoveredFrameGeometry;
+    int m_maskVisibleIndicators = -1;
 };
 
 class Indicator : public QWidget
@@ -95,16 +144,22 @@ class Indicator : public QWidget
     Q_OBJECT
 public:
     typedef QList<Indicator *> List;
-    explicit Indicator(ClassicIndicators *classicIndicators, IndicatorWindow *parent, ClassicIndicators::DropLocation location);
+    explicit Indicator(IndicatorWindow *parent, ClassicIndicators::DropLocation location);
     void paintEvent(QPaintEvent *) override;
 
     void setHovered(bool hovered);
-    QString iconName(bool active) const;
-    QString iconFileName(bool active) const;
+    static QString iconName(ClassicIndicators::DropLocation, bool active);
+    static QString iconFileName(ClassicIndicators::DropLocation, bool active);
+
+    ///@brief Returns the decoded images of all indicators for device pixel ratio @p dpr.
+    /// Indexed by pixmapIndex(). Decoded once per dpr and shared by all ClassicIndicators.
+    static const QVector<QPixmap> &pixmaps(qreal dpr);
+    static int pixmapIndex(ClassicIndicators::DropLocation, bool active);
 
-    QImage m_image;
-    QImage m_imageActive;
-    ClassicIndicators *const q;
+    ///@brief Decodes the images for the dprs of all screens, so the first drag doesn't have to
+    static void preloadPixmaps();
+
+    IndicatorWindow *const m_indicatorWindow;
     bool m_hovered = false;
     const ClassicIndicators::DropLocation m_dropLocation;
 };
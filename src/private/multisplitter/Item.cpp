@@ -20,23 +20,84 @@
 
 #include "Item_p.h"
 #include "Separator_p.h"
+#include "Tracing_p.h"
 
 #include <QEvent>
+#include <QLabel>
+#include <QMetaMethod>
 #include <QDebug>
+#include <QPointer>
 #include <QScopedValueRollback>
 #include <QTimer>
 #include <QGuiApplication>
 #include <QScreen>
+#include <QSemaphore>
+#include <QSet>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <limits>
 
 using namespace Layouting;
 
 int Layouting::Item::separatorThickness = 5;
+bool Layouting::Item::incrementalSanityChecks = qgetenv("KDDOCKWIDGETS_SANITY_CHECKS") == "incremental";
+#ifdef DOCKS_DEVELOPER_MODE
+bool Layouting::Item::sanityChecksEnabled = true;
+#else
+bool Layouting::Item::sanityChecksEnabled = qEnvironmentVariableIntValue("KDDOCKWIDGETS_SANITY_CHECKS") == 1 ||
+                                            Layouting::Item::incrementalSanityChecks;
+#endif
+bool Layouting::Item::usesCoalescedMinSizeUpdates = false;
+static int s_numInvariantViolations = 0;
 const QSize Layouting::Item::hardcodedMinimumSize = QSize(KDDOCKWIDGETS_MIN_WIDTH, KDDOCKWIDGETS_MIN_HEIGHT);
+quint64 Layouting::ItemContainer::s_structureGeneration = 1;
+int Layouting::ItemContainer::parallelLayoutThreshold = 256;
+
+// While a sub-tree is laid out on a worker, its items don't mark the ancestors at and above this one
+// dirty. The thread that forked already did, see applyGeometriesInParallel().
+static thread_local const ItemContainer *s_dirtyBoundary = nullptr;
+
+// Set while running a scheduled incremental check, so containers skip their unchanged children
+static bool s_checkingIncrementally = false;
+
+int Item::numInvariantViolations()
+{
+    return s_numInvariantViolations;
+}
+
+void Item::dumpLayoutOnError()
+{
+    s_numInvariantViolations++;
+    if (!sanityChecksEnabled)
+        return;
+
+    if (auto r = root())
+        r->dumpLayout();
+}
 
 ItemContainer *Item::root() const
 {
-    return m_parent ? m_parent->root()
-                    : const_cast<ItemContainer*>(qobject_cast<const ItemContainer*>(this));
+    // Cached, as MultiSplitterLayout uses it for every membership check
+    if (!m_rootValid) {
+        m_root = m_parent ? m_parent->root()
+                          : const_cast<ItemContainer*>(qobject_cast<const ItemContainer*>(this));
+        m_rootValid = true;
+    }
+
+    return m_root;
+}
+
+void Item::invalidateRoot_recursive()
+{
+    if (!m_rootValid)
+        return; // Nothing below us is valid either
+
+    m_rootValid = false;
+    if (auto c = asContainer()) {
+        for (Item *child : qAsConst(c->m_children))
+            child->invalidateRoot_recursive();
+    }
 }
 
 QRect Item::mapToRoot(QRect r) const
@@ -48,10 +109,7 @@ QRect Item::mapToRoot(QRect r) const
 
 QPoint Item::mapToRoot(QPoint p) const
 {
-    if (isRoot())
-        return p;
-
-    return p + parentContainer()->mapToRoot(pos());
+    return p + rootOffset();
 }
 
 int Item::mapToRoot(int p, Qt::Orientation o) const
@@ -63,13 +121,29 @@ int Item::mapToRoot(int p, Qt::Orientation o) const
 
 QPoint Item::mapFromRoot(QPoint p) const
 {
-    const Item *it = this;
-    while (it) {
-        p = p - it->pos();
-        it = it->parentContainer();
+    return p - rootOffset();
+}
+
+QPoint Item::rootOffset() const
+{
+    if (!m_rootOffsetValid) {
+        m_rootOffset = isRoot() ? QPoint() : m_parent->rootOffset() + pos();
+        m_rootOffsetValid = true;
     }
 
-    return p;
+    return m_rootOffset;
+}
+
+void Item::invalidateRootOffset_recursive()
+{
+    if (!m_rootOffsetValid)
+        return; // Nothing below us is valid either
+
+    m_rootOffsetValid = false;
+    if (auto c = asContainer()) {
+        for (Item *child : qAsConst(c->m_children))
+            child->invalidateRootOffset_recursive();
+    }
 }
 
 QRect Item::mapFromRoot(QRect r) const
@@ -100,16 +174,17 @@ void Item::setGuest(GuestInterface *guest)
     QWidget *newWidget = guest ? guest->asWidget() : nullptr;
     QWidget *oldWidget = widget();
 
-    if (oldWidget) {
-        oldWidget->removeEventFilter(this);
+    if (oldWidget)
         disconnect(oldWidget, nullptr, this, nullptr);
-    }
+
+    delete m_snapshot;
+    m_snapshot = nullptr;
 
     m_guest = guest;
+    ItemContainer::s_structureGeneration++;
 
     if (m_guest) {
         m_guest->setLayoutItem(this);
-        newWidget->installEventFilter(this);
         newWidget->setParent(m_hostWidget);
         setMinSize(widgetMinSize(newWidget));
         setMaxSize(newWidget->maximumSize());
@@ -124,6 +199,7 @@ void Item::setGuest(GuestInterface *guest)
             widgetGeo.setSize(widgetGeo.size().expandedTo(Item::hardcodedMinimumSize));
             setGeometry(mapFromRoot(widgetGeo));
         } else {
+            setDirty(DirtyFlag_Geometry);
             updateWidgetGeometries();
         }
     }
@@ -133,9 +209,47 @@ void Item::setGuest(GuestInterface *guest)
 
 void Item::updateWidgetGeometries()
 {
-    if (auto w = widget()) {
-        w->setGeometry(mapToRoot(rect()));
+    if (isInBatch())
+        return;
+
+    if (m_dirtyFlags & DirtyFlag_Guest) {
+        if (m_snapshot) {
+            // Frozen, the guest only gets its geometry in thawGuest()
+            m_snapshot->setGeometry(mapToRoot(rect()));
+        } else if (auto w = widget()) {
+            Tracing::counters().widgetGeometryChanges++;
+            w->setGeometry(mapToRoot(rect()));
+        }
     }
+
+    m_dirtyFlags = m_dirtyFlags & ~DirtyFlags(DirtyFlag_Geometry | DirtyFlag_Guest);
+}
+
+void Item::freezeGuest()
+{
+    QWidget *w = widget();
+    if (m_snapshot || !w || !isVisible() || !w->isVisible())
+        return;
+
+    auto snapshot = new QLabel(m_hostWidget);
+    snapshot->setObjectName(QStringLiteral("snapshot"));
+    snapshot->setScaledContents(true);
+    snapshot->setPixmap(w->grab());
+    snapshot->setGeometry(w->geometry());
+    snapshot->raise();
+    snapshot->show();
+    m_snapshot = snapshot;
+}
+
+void Item::thawGuest()
+{
+    if (!m_snapshot)
+        return;
+
+    delete m_snapshot;
+    m_snapshot = nullptr;
+    setDirty(DirtyFlag_Guest);
+    updateWidgetGeometries();
 }
 
 QVariantMap Item::toVariantMap() const
@@ -155,6 +269,7 @@ QVariantMap Item::toVariantMap() const
 void Item::fillFromVariantMap(const QVariantMap &map, const QHash<QString, GuestInterface *> &widgets)
 {
     m_sizingInfo.fromVariantMap(map[QStringLiteral("sizingInfo")].toMap());
+    invalidateRootOffset_recursive();
     m_isVisible = map[QStringLiteral("isVisible")].toBool();
     setObjectName(map[QStringLiteral("objectName")].toString());
 
@@ -197,6 +312,16 @@ int Item::refCount() const
     return m_refCount;
 }
 
+void Item::addRefHolder(ItemRefHolder *holder)
+{
+    m_refHolders.push_back(holder);
+}
+
+void Item::removeRefHolder(ItemRefHolder *holder)
+{
+    m_refHolders.removeOne(holder);
+}
+
 QWidget *Item::hostWidget() const
 {
     return m_hostWidget;
@@ -218,6 +343,43 @@ void Item::restore(GuestInterface *guest)
     }
 }
 
+bool Item::isInBatch() const
+{
+    const ItemContainer *r = root();
+    return r && r->m_batchDepth > 0;
+}
+
+Item::DirtyFlags Item::dirtyFlags() const
+{
+    return m_dirtyFlags;
+}
+
+void Item::setDirty(DirtyFlags flags)
+{
+    if (flags & DirtyFlag_Geometry)
+        flags |= DirtyFlag_Guest;
+
+    m_dirtyFlags |= flags | DirtyFlag_Unchecked;
+
+    // Let the ancestors know there's something to visit in this sub-tree
+    DirtyFlags ancestorFlags = DirtyFlags(DirtyFlag_Descendants | DirtyFlag_Unchecked);
+    if (flags & DirtyFlag_Guest)
+        ancestorFlags |= DirtyFlag_Guest;
+
+    for (ItemContainer *p = parentContainer(); p && p != s_dirtyBoundary; p = p->parentContainer())
+        p->m_dirtyFlags |= ancestorFlags;
+}
+
+void Item::setGeometryDirty_recursive()
+{
+    setDirty(DirtyFlag_Geometry);
+    if (auto c = asContainer()) {
+        c->m_dirtyFlags |= DirtyFlag_Descendants;
+        for (Item *child : qAsConst(c->m_children))
+            child->setGeometryDirty_recursive();
+    }
+}
+
 QVector<int> Item::pathFromRoot() const
 {
     // Returns the list of indexes to get to this item, starting from the root container
@@ -225,19 +387,14 @@ QVector<int> Item::pathFromRoot() const
     // [] would mean 'this' is the root item
     // [0] would mean the 1st child of root
 
-    QVector<int> path;
-    path.reserve(10); // random big number, good to bootstrap it
+    int depth = 0;
+    for (const Item *it = this; it->parentContainer(); it = it->parentContainer())
+        depth++;
 
-    const Item *it = this;
-    while (it) {
-        if (auto p = it->parentContainer()) {
-            const int index = p->m_children.indexOf(const_cast<Item*>(it));
-            path.prepend(index);
-            it = p;
-        } else {
-            break;
-        }
-    }
+    // Filled from the end, as we walk up
+    QVector<int> path(depth);
+    for (const Item *it = this; it->parentContainer(); it = it->parentContainer())
+        path[--depth] = it->parentContainer()->indexOfChild(it);
 
     return path;
 }
@@ -249,6 +406,7 @@ void Item::setHostWidget(QWidget *host)
         if (auto w = widget()) {
             w->setParent(host);
             w->setVisible(true);
+            setDirty(DirtyFlag_Geometry);
             updateWidgetGeometries();
         }
     }
@@ -268,6 +426,16 @@ QSize Item::missingSize() const
     return missing;
 }
 
+void Item::setFixedOnParentResize(bool is)
+{
+    m_sizingInfo.isFixedOnParentResize = is;
+}
+
+bool Item::isFixedOnParentResize() const
+{
+    return m_sizingInfo.isFixedOnParentResize;
+}
+
 bool Item::isBeingInserted() const
 {
     return m_sizingInfo.isBeingInserted;
@@ -279,6 +447,7 @@ void Item::setBeingInserted(bool is)
 
     // Trickle up the hierarchy too, as the parent might be hidden due to not having visible children
     if (auto parent = parentContainer()) {
+        parent->invalidateSizeCache();
         if (is) {
             if (!parent->hasVisibleChildren())
                 parent->setBeingInserted(true);
@@ -295,7 +464,9 @@ void Item::setParentContainer(ItemContainer *parent)
 
     if (m_parent) {
         disconnect(this, &Item::minSizeChanged, m_parent, &ItemContainer::onChildMinSizeChanged);
+        disconnect(this, &Item::maxSizeChanged, m_parent, &ItemContainer::onChildMaxSizeChanged);
         disconnect(this, &Item::visibleChanged, m_parent, &ItemContainer::onChildVisibleChanged);
+        m_parent->invalidateSizeCache();
         Q_EMIT visibleChanged(this, false);
     }
 
@@ -308,6 +479,8 @@ void Item::setParentContainer(ItemContainer *parent)
         }
     }
 
+    invalidateRootOffset_recursive();
+    invalidateRoot_recursive();
     m_parent = parent;
     connectParent(parent); // Reused by the ctor too
 
@@ -318,9 +491,12 @@ void Item::connectParent(ItemContainer *parent)
 {
     if (parent) {
         connect(this, &Item::minSizeChanged, parent, &ItemContainer::onChildMinSizeChanged);
+        connect(this, &Item::maxSizeChanged, parent, &ItemContainer::onChildMaxSizeChanged);
         connect(this, &Item::visibleChanged, parent, &ItemContainer::onChildVisibleChanged);
+        parent->invalidateSizeCache();
 
         setHostWidget(parent->hostWidget());
+        setGeometryDirty_recursive(); // We have a new position within root()
         updateWidgetGeometries();
 
         Q_EMIT visibleChanged(this, isVisible());
@@ -399,7 +575,7 @@ void Item::insertItem(Item *item, Location loc, DefaultSizeMode defaultSizeMode,
 
     if (m_parent->hasOrientationFor(loc)) {
         const bool locIsSide1 = locationIsSide1(loc);
-        int indexInParent = m_parent->childItems().indexOf(this);
+        int indexInParent = m_parent->indexOfChild(this);
         if (!locIsSide1)
             indexInParent++;
 
@@ -528,7 +704,10 @@ void Item::setIsVisible(bool is)
 
     if (is) {
         if (auto w = widget()) {
-            w->setGeometry(mapToRoot(rect()));
+            if (!isInBatch()) {
+                Tracing::counters().widgetGeometryChanges++;
+                w->setGeometry(mapToRoot(rect()));
+            }
             w->setVisible(true); // TODO: Only set visible when apply*() ?
         }
     }
@@ -547,6 +726,8 @@ bool Item::checkSanity()
     if (!root())
         return true;
 
+    Tracing::counters().itemsSanityChecked++;
+
     if (minSize().width() > width() || minSize().height() > height()) {
         root()->dumpLayout();
         qWarning() << Q_FUNC_INFO << "Size constraints not honoured" << this
@@ -599,6 +780,7 @@ void Item::setGeometry(QRect rect)
     QRect &m_geometry = m_sizingInfo.geometry;
 
     if (rect != m_geometry) {
+        Tracing::counters().itemGeometryChanges++;
         const QRect oldGeo = m_geometry;
 
         m_geometry = rect;
@@ -608,7 +790,7 @@ void Item::setGeometry(QRect rect)
             ItemContainer *c = asContainer();
             if (c) {
                 if (c->hasVisibleChildren()) {
-                    if (auto r = root()) r->dumpLayout();
+                    dumpLayoutOnError();
                     Q_ASSERT(false);
                 }
             } else {
@@ -618,26 +800,94 @@ void Item::setGeometry(QRect rect)
 
         const QSize minSz = minSize();
         if (rect.width() < minSz.width() || rect.height() < minSz.height()) {
-            if (auto r = root()) r->dumpLayout();
+            dumpLayoutOnError();
             qWarning() << Q_FUNC_INFO << this << "Constraints not honoured."
                        << "sz=" << rect.size() << "; min=" << minSz
                        << ": parent=" << parentContainer();
 
         }
 
-        Q_EMIT geometryChanged();
+        const bool xMoved = oldGeo.x() != x();
+        const bool yMoved = oldGeo.y() != y();
+        if (xMoved || yMoved)
+            invalidateRootOffset_recursive();
+
+        if (m_hasGeometryListeners) {
+            Q_EMIT geometryChanged();
+
+            if (xMoved)
+                Q_EMIT xChanged();
+            if (yMoved)
+                Q_EMIT yChanged();
+            if (oldGeo.width() != width())
+                Q_EMIT widthChanged();
+            if (oldGeo.height() != height())
+                Q_EMIT heightChanged();
+        }
+
+        if ((xMoved || yMoved) && isContainer() && !isRoot()) {
+            for (Item *child : qAsConst(asContainer()->m_children))
+                child->emitPositionChanged_recursive(xMoved, yMoved);
+        }
+
+        if (isContainer() && oldGeo.topLeft() != rect.topLeft()) {
+            // All our guests moved too
+            setGeometryDirty_recursive();
+        } else {
+            setDirty(DirtyFlag_Geometry);
+        }
+
+        updateWidgetGeometries();
+    }
+}
 
-        if (oldGeo.x() != x())
+void Item::emitPositionChanged_recursive(bool xMoved, bool yMoved)
+{
+    if (m_hasGeometryListeners) {
+        if (xMoved)
             Q_EMIT xChanged();
-        if (oldGeo.y() != y())
+        if (yMoved)
             Q_EMIT yChanged();
-        if (oldGeo.width() != width())
-            Q_EMIT widthChanged();
-        if (oldGeo.height() != height())
-            Q_EMIT heightChanged();
+    }
 
-        updateWidgetGeometries();
+    if (auto c = asContainer()) {
+        for (Item *child : qAsConst(c->m_children))
+            child->emitPositionChanged_recursive(xMoved, yMoved);
+    }
+}
+
+static bool isGeometrySignal(const QMetaMethod &signal)
+{
+    static const QMetaMethod geometrySignals[] = {
+        QMetaMethod::fromSignal(&Item::geometryChanged),
+        QMetaMethod::fromSignal(&Item::xChanged),
+        QMetaMethod::fromSignal(&Item::yChanged),
+        QMetaMethod::fromSignal(&Item::widthChanged),
+        QMetaMethod::fromSignal(&Item::heightChanged)
+    };
+
+    for (const QMetaMethod &method : geometrySignals) {
+        if (signal == method)
+            return true;
     }
+
+    return false;
+}
+
+void Item::connectNotify(const QMetaMethod &signal)
+{
+    if (isGeometrySignal(signal))
+        m_hasGeometryListeners = true;
+}
+
+void Item::disconnectNotify(const QMetaMethod &)
+{
+    // Also called with an invalid method when everything is disconnected, so just recompute
+    m_hasGeometryListeners = isSignalConnected(QMetaMethod::fromSignal(&Item::geometryChanged)) ||
+                             isSignalConnected(QMetaMethod::fromSignal(&Item::xChanged)) ||
+                             isSignalConnected(QMetaMethod::fromSignal(&Item::yChanged)) ||
+                             isSignalConnected(QMetaMethod::fromSignal(&Item::widthChanged)) ||
+                             isSignalConnected(QMetaMethod::fromSignal(&Item::heightChanged));
 }
 
 void Item::dumpLayout(int level)
@@ -689,20 +939,22 @@ Item::Item(bool isContainer, QWidget *hostWidget, ItemContainer *parent)
 
 Item::~Item()
 {
+    delete m_snapshot;
+    const QVector<ItemRefHolder*> holders = m_refHolders;
+    m_refHolders.clear();
+    for (ItemRefHolder *holder : holders)
+        holder->onItemDestroyed(this);
 }
 
-bool Item::eventFilter(QObject *widget, QEvent *e)
+void Item::onGuestParentChanged()
 {
-    if (e->type() != QEvent::ParentChange)
-        return false;
-
-    if (widget->parent() != hostWidget()) {
+    // Placeholders keep a reference to their former guest, but don't follow it anymore
+    QWidget *w = widget();
+    if (w && w->parent() != hostWidget()) {
         // Frame was detached into floating window. Turn into placeholder
         Q_ASSERT(isVisible());
         turnIntoPlaceholder();
     }
-
-    return false;
 }
 
 
@@ -741,7 +993,78 @@ void Item::onWidgetDestroyed()
     }
 }
 
+namespace {
+///@brief The items with a min size update queued, see Item::usesCoalescedMinSizeUpdates
+QVector<QPointer<Item>> &pendingMinSizeUpdates()
+{
+    static QVector<QPointer<Item>> items;
+    return items;
+}
+
+int itemDepth(const Item *item)
+{
+    int result = 0;
+    for (const Item *p = item->parentContainer(); p; p = p->parentContainer())
+        result++;
+    return result;
+}
+}
+
 void Item::onWidgetLayoutRequested()
+{
+    if (!usesCoalescedMinSizeUpdates) {
+        updateMinSizeFromWidget();
+        return;
+    }
+
+    // A guest rebuilding its contents sends many requests in a row, only the last state matters
+    if (m_minSizeUpdatePending)
+        return;
+
+    m_minSizeUpdatePending = true;
+    QVector<QPointer<Item>> &pending = pendingMinSizeUpdates();
+    if (pending.isEmpty())
+        QTimer::singleShot(0, &Item::applyPendingMinSizeUpdates);
+    pending.push_back(this);
+}
+
+void Item::applyPendingMinSizeUpdates()
+{
+    QVector<QPointer<Item>> pending;
+    pending.swap(pendingMinSizeUpdates());
+
+    // Bottom-up, so each container's constraints are recalculated once its children are final
+    QVector<QPair<int, Item*>> items;
+    items.reserve(pending.size());
+    for (Item *item : qAsConst(pending)) {
+        if (item) {
+            item->m_minSizeUpdatePending = false;
+            items.push_back({ itemDepth(item), item });
+        }
+    }
+
+    std::stable_sort(items.begin(), items.end(), [] (const QPair<int, Item*> &a, const QPair<int, Item*> &b) {
+        return a.first > b.first;
+    });
+
+    // One batch per layout, so the widgets, separators and the host's min size are updated once
+    QVector<ItemContainer*> roots;
+    for (const auto &pair : qAsConst(items)) {
+        ItemContainer *r = pair.second->root();
+        if (r && !roots.contains(r)) {
+            roots.push_back(r);
+            r->beginBatch();
+        }
+    }
+
+    for (const auto &pair : qAsConst(items))
+        pair.second->updateMinSizeFromWidget();
+
+    for (ItemContainer *r : qAsConst(roots))
+        r->commitBatch();
+}
+
+void Item::updateMinSizeFromWidget()
 {
     if (QWidget *w = widget()) {
         if (w->size() != size()) {
@@ -768,6 +1091,50 @@ int Item::visibleCount_recursive() const
     return isVisible() ? 1 : 0;
 }
 
+namespace {
+
+///@brief A container that's reused by every sizing pass, so they don't allocate once it has grown enough
+template <typename T>
+struct ScratchBuffer
+{
+    T buffer;
+    bool inUse = false;
+};
+
+///@brief Borrows a ScratchBuffer for the current scope.
+/// If it's already borrowed, because the sizing pass re-entered, a local container is used instead.
+template <typename T>
+class ScratchLease
+{
+public:
+    explicit ScratchLease(ScratchBuffer<T> &scratch)
+        : m_scratch(scratch.inUse ? nullptr : &scratch)
+    {
+        if (m_scratch) {
+            m_scratch->inUse = true;
+            m_scratch->buffer.clear(); // Keeps the capacity
+        }
+    }
+
+    ~ScratchLease()
+    {
+        if (m_scratch)
+            m_scratch->inUse = false;
+    }
+
+    T &operator*()
+    {
+        return m_scratch ? m_scratch->buffer : m_local;
+    }
+
+private:
+    Q_DISABLE_COPY(ScratchLease)
+    ScratchBuffer<T> *const m_scratch;
+    T m_local;
+};
+
+}
+
 struct ItemContainer::Private
 {
     Private(ItemContainer *q)
@@ -778,6 +1145,20 @@ struct ItemContainer::Private
     int defaultLengthFor(Item *item, DefaultSizeMode) const;
 
     ItemContainer *const q;
+
+    // Scratch storage for the sizing passes. It's per container and not per root, since child
+    // containers are resized while their parent's buffers are still being used.
+    ScratchBuffer<SizingInfo::List> m_sizes;
+    ScratchBuffer<SizingInfo::List> m_positionSizes; // positionItems() runs while m_sizes is borrowed
+    ScratchBuffer<Item::List> m_children;
+    ScratchBuffer<QVector<int>> m_availabilities;
+    ScratchBuffer<QVector<int>> m_squeezes;
+    ScratchBuffer<QVector<int>> m_donors;
+    ScratchBuffer<QVector<int>> m_boundEvents;
+    ScratchBuffer<QVector<int>> m_boundStates;
+    ScratchBuffer<QVector<int>> m_remainders;
+    ScratchBuffer<QVector<int>> m_order;
+    ScratchBuffer<QVector<int>> m_fixedBounds;
 };
 
 ItemContainer::ItemContainer(QWidget *hostWidget, ItemContainer *parent)
@@ -785,18 +1166,6 @@ ItemContainer::ItemContainer(QWidget *hostWidget, ItemContainer *parent)
     , d(new Private(this))
 {
     Q_ASSERT(parent);
-
-    connect(this, &Item::xChanged, this, [this] {
-        for (Item *item : qAsConst(m_children)) {
-            Q_EMIT item->xChanged();
-        }
-    });
-
-    connect(this, &Item::yChanged, this, [this] {
-        for (Item *item : qAsConst(m_children)) {
-            Q_EMIT item->yChanged();
-        }
-    });
 }
 
 ItemContainer::ItemContainer(QWidget *hostWidget)
@@ -819,6 +1188,12 @@ bool ItemContainer::checkSanity()
         return true;
     }
 
+    if (isInBatch() || isTearingDown()) {
+        // Separators and widgets are only updated when the batch is committed, and a layout
+        // being torn down is only consistent once cleared. Nothing to check yet.
+        return true;
+    }
+
     if (!Item::checkSanity())
         return false;
 
@@ -881,8 +1256,16 @@ bool ItemContainer::checkSanity()
             }
         }
 
+        // The checks above are cheap and done for every child, as they catch this container's own changes
+        if (s_checkingIncrementally && !(item->m_dirtyFlags & DirtyFlag_Unchecked))
+            continue;
+
         if (!item->checkSanity())
             return false;
+
+        // Containers clear their own flag, once all of their checks passed
+        if (!item->isContainer())
+            item->m_dirtyFlags = item->m_dirtyFlags & ~DirtyFlags(DirtyFlag_Unchecked);
     }
 
     const Item::List visibleChildren = this->visibleChildren();
@@ -996,17 +1379,29 @@ bool ItemContainer::checkSanity()
     }
 #endif
 
+    m_dirtyFlags = m_dirtyFlags & ~DirtyFlags(DirtyFlag_Unchecked);
     return true;
 }
 
 void ItemContainer::scheduleCheckSanity() const
 {
-    if (!m_checkSanityScheduled) {
+    // Dummy layouts have nothing to check, and might live in a thread without an event loop
+    if (!sanityChecksEnabled)
+        return;
+
+    if (!m_checkSanityScheduled && !isInBatch() && !isDummy()) {
         m_checkSanityScheduled = true;
-        QTimer::singleShot(0, root(), &ItemContainer::checkSanity);
+        QTimer::singleShot(0, root(), &ItemContainer::runScheduledCheckSanity);
     }
 }
 
+void ItemContainer::runScheduledCheckSanity()
+{
+    QScopedValueRollback<bool> incremental(s_checkingIncrementally, incrementalSanityChecks);
+    const bool sane = checkSanity();
+    Q_UNUSED(sane); // It already warned
+}
+
 bool ItemContainer::hasOrientation() const
 {
     return isVertical() || isHorizontal();
@@ -1029,8 +1424,16 @@ int ItemContainer::numVisibleChildren() const
 
 int ItemContainer::indexOfVisibleChild(const Item *item) const
 {
-    const Item::List items = visibleChildren();
-    return items.indexOf(const_cast<Item*>(item));
+    int index = 0;
+    for (Item *child : m_children) {
+        if (child->isVisible() && !child->isBeingInserted()) {
+            if (child == item)
+                return index;
+            ++index;
+        }
+    }
+
+    return -1;
 }
 
 const Item::List ItemContainer::childItems() const
@@ -1040,6 +1443,7 @@ const Item::List ItemContainer::childItems() const
 
 void ItemContainer::removeItem(Item *item, bool hardRemove)
 {
+    KDDW_TRACE_SCOPE("layout", "ItemContainer::removeItem");
     Q_ASSERT(!item->isRoot());
 
     if (!contains(item)) {
@@ -1048,16 +1452,22 @@ void ItemContainer::removeItem(Item *item, bool hardRemove)
         return;
     }
 
-    Item *side1Item = visibleNeighbourFor(item, Side1);
-    Item *side2Item = visibleNeighbourFor(item, Side2);
+    // Nothing but the tree itself is maintained while tearing down
+    const bool tearingDown = isTearingDown();
+    Item *side1Item = tearingDown ? nullptr : visibleNeighbourFor(item, Side1);
+    Item *side2Item = tearingDown ? nullptr : visibleNeighbourFor(item, Side2);
 
     const bool isContainer = item->isContainer();
     const bool wasVisible = !isContainer && item->isVisible();
 
     if (hardRemove) {
-        m_children.removeOne(item);
+        const int index = indexOfChild(item);
+        m_children.removeAt(index);
+        updateChildIndexes(index);
+        s_structureGeneration++;
+        invalidateSizeCache();
         delete item;
-        if (!isContainer)
+        if (!isContainer && !tearingDown)
             Q_EMIT root()->numItemsChanged();
     } else {
         item->setIsVisible(false);
@@ -1069,6 +1479,9 @@ void ItemContainer::removeItem(Item *item, bool hardRemove)
         }
     }
 
+    if (tearingDown)
+        return;
+
     if (wasVisible) {
         Q_EMIT root()->numVisibleItemsChanged(root()->numVisibleChildren());
     }
@@ -1109,7 +1522,7 @@ ItemContainer *ItemContainer::convertChildToContainer(Item *leaf)
 {
     QScopedValueRollback<bool> converting(m_convertingItemToContainer, true);
 
-    const int index = m_children.indexOf(leaf);
+    const int index = indexOfChild(leaf);
     Q_ASSERT(index != -1);
     auto container = new ItemContainer(hostWidget(), this);
     container->setParentContainer(nullptr);
@@ -1117,6 +1530,9 @@ ItemContainer *ItemContainer::convertChildToContainer(Item *leaf)
 
     insertItem(container, index, DefaultSizeMode::None);
     m_children.removeOne(leaf);
+    updateChildIndexes(index);
+    s_structureGeneration++;
+    invalidateSizeCache();
     container->setGeometry(leaf->geometry());
     container->insertItem(leaf, Location_OnTop, DefaultSizeMode::None);
     Q_EMIT itemsChanged();
@@ -1128,6 +1544,7 @@ ItemContainer *ItemContainer::convertChildToContainer(Item *leaf)
 void ItemContainer::insertItem(Item *item, Location loc, DefaultSizeMode defaultSizeMode,
                                AddingOption addingOption)
 {
+    KDDW_TRACE_SCOPE("layout", "ItemContainer::insertItem");
     Q_ASSERT(item != this);
     if (contains(item)) {
         qWarning() << Q_FUNC_INFO << "Item already exists";
@@ -1143,6 +1560,7 @@ void ItemContainer::insertItem(Item *item, Location loc, DefaultSizeMode default
         if (m_children.size() == 1) {
             // 2 items is the minimum to know which orientation we're layedout
             m_orientation = locOrientation;
+            invalidateSizeCache();
         }
 
         const int index = locationIsSide1(loc) ? 0 : m_children.size();
@@ -1154,6 +1572,8 @@ void ItemContainer::insertItem(Item *item, Location loc, DefaultSizeMode default
         container->setGeometry(rect());
         container->setChildren(m_children, m_orientation);
         m_children.clear();
+        s_structureGeneration++;
+        invalidateSizeCache();
         setOrientation(oppositeOrientation(m_orientation));
         insertItem(container, 0, DefaultSizeMode::None);
 
@@ -1170,6 +1590,9 @@ void ItemContainer::insertItem(Item *item, Location loc, DefaultSizeMode default
 
 void ItemContainer::onChildMinSizeChanged(Item *child)
 {
+    setDirty(DirtyFlag_Constraints);
+    invalidateSizeCache();
+
     if (m_convertingItemToContainer || m_isDeserializing || !child->isVisible()) {
         // Don't bother our parents, we're converting
         return;
@@ -1206,12 +1629,40 @@ void ItemContainer::updateSizeConstraints()
         }
     }
 
+    if (isRoot() && isInBatch()) {
+        // The host is told once, when the batch is committed
+        m_minSizeChangedInBatch = true;
+        return;
+    }
+
     // Our min-size changed, notify our parent, and so on until it reaches root()
     Q_EMIT minSizeChanged(this);
 }
 
+void ItemContainer::onChildMaxSizeChanged(Item *)
+{
+    setDirty(DirtyFlag_Constraints);
+    invalidateSizeCache();
+}
+
+void ItemContainer::invalidateSizeCache()
+{
+    // Our aggregated min/max depend on our children's, so our ancestors' are stale too.
+    for (ItemContainer *c = this; c; c = c->parentContainer()) {
+        c->m_minSizeCacheValid = false;
+        c->m_maxSizeCacheValid = false;
+        c->m_visibleChildrenCacheValid = false;
+    }
+
+    // So does the range the separator being dragged can move in
+    Separator::invalidateDragBounds();
+}
+
 void ItemContainer::onChildVisibleChanged(Item */*child*/, bool visible)
 {
+    setDirty(DirtyFlag_Visibility);
+    invalidateSizeCache();
+
     if (m_isDeserializing)
         return;
 
@@ -1227,9 +1678,8 @@ void ItemContainer::onChildVisibleChanged(Item */*child*/, bool visible)
 QRect ItemContainer::suggestedDropRect(const Item *item, const Item *relativeTo, Location loc) const
 {
     // Returns the drop rect. This is the geometry used by the rubber band when you hover over an indicator.
-    // It's calculated by copying the layout and inserting the item into the dummy/invisible copy
-    // The we see which geometry the item got. This way the returned geometry is always what the item will get
-    // if you drop it.
+    // It's calculated by simulating the insertion of the item, so the returned geometry is always
+    // what the item will get if you drop it.
     // One exception is if the window doesn't have enough space and it would grow. In this case
     // we fall back to something reasonable
 
@@ -1265,6 +1715,103 @@ QRect ItemContainer::suggestedDropRect(const Item *item, const Item *relativeTo,
     if (windowNeedsGrowing)
         return suggestedDropRectFallback(item, relativeTo, loc);
 
+    // Usually only the container receiving the item changes, which is cheap to simulate.
+    // When it would grow, squeezing its ancestors, the insertion is done on a copy of the layout.
+    const QRect simulated = simulatedDropRect(item, relativeTo, loc);
+    if (simulated.isValid())
+        return simulated;
+
+    return suggestedDropRectByCopy(item, relativeTo, loc);
+}
+
+QRect ItemContainer::simulatedDropRect(const Item *item, const Item *relativeTo, Location loc) const
+{
+    const Qt::Orientation orientation = orientationForLocation(loc);
+    const Qt::Orientation opposite = oppositeOrientation(orientation);
+    const bool locIsSide1 = locationIsSide1(loc);
+    const ItemContainer *container = relativeTo ? this : root();
+
+    // The container receiving the item, in root coordinates, and its visible children before the
+    // insertion. @p index is where the item goes among them.
+    QRect containerRect;
+    ScratchLease<SizingInfo::List> lease(d->m_sizes);
+    SizingInfo::List &sizes = *lease;
+    int index = 0;
+
+    if (container->hasOrientationFor(loc)) {
+        containerRect = container->mapToRoot(container->rect());
+        container->fillSizes(sizes);
+        const int indexInParent = relativeTo ? container->indexOfChild(relativeTo) + (locIsSide1 ? 0 : 1)
+                                             : (locIsSide1 ? 0 : container->m_children.size());
+        for (int i = 0; i < indexInParent; ++i) {
+            if (container->m_children.at(i)->isVisible())
+                index++;
+        }
+    } else {
+        // A new container would be created, so the item goes next to relativeTo, or next to
+        // all of root's children, which is the same as next to root
+        const Item *neighbour = relativeTo ? relativeTo : container;
+        containerRect = neighbour->mapToRoot(neighbour->rect());
+        if (neighbour->isVisible()) {
+            SizingInfo sizing = neighbour->m_sizingInfo;
+            sizing.minSize = neighbour->minSize();
+            sizes << sizing;
+        }
+        index = locIsSide1 ? 0 : sizes.size();
+    }
+
+    const int numNeighbours = sizes.size();
+    if (numNeighbours == 0) {
+        // Alone in root, occupies everything
+        return containerRect;
+    }
+
+    const int length = Layouting::length(containerRect.size(), orientation);
+    const int itemMin = item->minLength(orientation);
+    int minLength = itemMin + numNeighbours * Item::separatorThickness;
+    int available = -Item::separatorThickness;
+    for (const SizingInfo &sizing : qAsConst(sizes)) {
+        minLength += sizing.minLength(orientation);
+        available += sizing.availableLength(orientation);
+    }
+
+    const int oppositeLength = Layouting::length(containerRect.size(), opposite);
+    if (minLength > length || item->minLength(opposite) > oppositeLength)
+        return {};
+
+    // The length restoreChild() gives it, after insertItem() with DefaultSizeMode::FairButFloor
+    const int fairLength = (length - Item::separatorThickness * numNeighbours) / (numNeighbours + 1);
+    const int suggestedLength = qMax(itemMin, qMin(fairLength, item->length(orientation)));
+    const int newLength = qBound(itemMin, suggestedLength, available);
+
+    int pos = 0;
+    if (numNeighbours == 1) {
+        // The neighbour donates all of it, plus the separator
+        pos = index == 0 ? 0 : sizes.at(0).length(orientation) - newLength;
+    } else {
+        // Only a container with more than one child has an orientation already, it's the same as loc's then
+        Q_ASSERT(container->m_orientation == orientation);
+        SizingInfo sizing;
+        sizing.minSize = item->minSize();
+        sizing.maxSize = item->maxSize();
+        sizing.setLength(0, orientation);
+        sizes.insert(index, sizing);
+
+        // Doesn't touch the container, just the sizes
+        const_cast<ItemContainer*>(container)->growItem(index, sizes, newLength, GrowthStrategy::BothSidesEqually,
+                                                        NeighbourSqueezeStrategy::AllNeighbours, /*accountForNewSeparator=*/ true);
+        for (int i = 0; i < index; ++i)
+            pos += sizes.at(i).length(orientation) + Item::separatorThickness;
+    }
+
+    if (orientation == Qt::Vertical)
+        return QRect(containerRect.x(), containerRect.y() + pos, oppositeLength, newLength);
+
+    return QRect(containerRect.x() + pos, containerRect.y(), newLength, oppositeLength);
+}
+
+QRect ItemContainer::suggestedDropRectByCopy(const Item *item, const Item *relativeTo, Location loc) const
+{
     const QVariantMap rootSerialized = root()->toVariantMap();
     ItemContainer rootCopy(nullptr);
     rootCopy.fillFromVariantMap(rootSerialized, {});
@@ -1363,7 +1910,11 @@ QRect ItemContainer::suggestedDropRectFallback(const Item *item, const Item *rel
 
 void ItemContainer::positionItems()
 {
-    SizingInfo::List sizes = this->sizes();
+    Tracing::counters().relayouts++;
+    m_numRelayouts++;
+    ScratchLease<SizingInfo::List> lease(d->m_positionSizes);
+    SizingInfo::List &sizes = *lease;
+    fillSizes(sizes);
     positionItems(/*by-ref=*/sizes);
     applyPositions(sizes);
 
@@ -1383,12 +1934,13 @@ void ItemContainer::positionItems_recursive()
 
 void ItemContainer::applyPositions(const SizingInfo::List &sizes)
 {
-    const Item::List items = visibleChildren();
-    const int count = items.size();
-    Q_ASSERT(count == sizes.size());
-    for (int i = 0; i < count; ++i) {
-        Item *item = items.at(i);
-        const SizingInfo &sizing = sizes[i];
+    int i = 0;
+    for (Item *item : m_children) {
+        if (!item->isVisible() || item->isBeingInserted())
+            continue;
+
+        Q_ASSERT(i < sizes.size());
+        const SizingInfo &sizing = sizes[i++];
         if (sizing.isBeingInserted) {
             continue;
         }
@@ -1437,37 +1989,92 @@ void ItemContainer::clear()
         delete item;
     }
     m_children.clear();
+    s_structureGeneration++;
+    invalidateSizeCache();
     deleteSeparators();
+
+    if (m_isTearingDown) {
+        // Told once, instead of for each removed item
+        m_isTearingDown = false;
+        Q_EMIT numVisibleItemsChanged(0);
+        Q_EMIT numItemsChanged();
+    }
 }
 
-Item *ItemContainer::itemForWidget(const QWidget *w) const
+void ItemContainer::beginTeardown()
 {
-    for (Item *item : m_children) {
-        if (item->isContainer()) {
-            if (Item *result = item->asContainer()->itemForWidget(w))
-                return result;
-        } else if (item->widget() == w) {
-            return item;
-        }
-    }
+    root()->m_isTearingDown = true;
+}
 
-    return nullptr;
+bool ItemContainer::isTearingDown() const
+{
+    return root()->m_isTearingDown;
 }
 
-int ItemContainer::visibleCount_recursive() const
+void ItemContainer::beginBatch()
 {
-    int count = 0;
-    for (Item *item : m_children) {
-        count += item->visibleCount_recursive();
+    if (!isRoot()) {
+        root()->beginBatch();
+        return;
     }
 
-    return count;
+    m_batchDepth++;
 }
 
-int ItemContainer::count_recursive() const
+void ItemContainer::commitBatch()
 {
-    int count = 0;
-    for (Item *item : m_children) {
+    if (!isRoot()) {
+        root()->commitBatch();
+        return;
+    }
+
+    if (m_batchDepth == 0) {
+        qWarning() << Q_FUNC_INFO << "commitBatch() called without beginBatch()";
+        return;
+    }
+
+    m_batchDepth--;
+    if (m_batchDepth == 0) {
+        // Push everything that accumulated in the SizingInfo, once
+        updateSeparators_recursive();
+        updateWidgetGeometries();
+        scheduleCheckSanity();
+
+        if (m_minSizeChangedInBatch) {
+            m_minSizeChangedInBatch = false;
+            Q_EMIT minSizeChanged(this);
+        }
+    }
+}
+
+Item *ItemContainer::itemForWidget(const QWidget *w) const
+{
+    for (Item *item : m_children) {
+        if (item->isContainer()) {
+            if (Item *result = item->asContainer()->itemForWidget(w))
+                return result;
+        } else if (item->widget() == w) {
+            return item;
+        }
+    }
+
+    return nullptr;
+}
+
+int ItemContainer::visibleCount_recursive() const
+{
+    int count = 0;
+    for (Item *item : m_children) {
+        count += item->visibleCount_recursive();
+    }
+
+    return count;
+}
+
+int ItemContainer::count_recursive() const
+{
+    int count = 0;
+    for (Item *item : m_children) {
         if (auto c = item->asContainer()) {
             count += c->count_recursive();
         } else {
@@ -1480,12 +2087,27 @@ int ItemContainer::count_recursive() const
 
 Item *ItemContainer::itemAt(QPoint p) const
 {
-    for (Item *item : m_children) {
-        if (item->isVisible() && item->geometry().contains(p))
-            return item;
+    if (!m_visibleChildrenCacheValid) {
+        m_visibleChildrenCache.clear();
+        for (Item *item : m_children) {
+            if (item->isVisible())
+                m_visibleChildrenCache.push_back(item);
+        }
+        m_visibleChildrenCacheValid = true;
     }
 
-    return nullptr;
+    // Visible children are laid out one after the other, so we can binary search by position
+    const int pos = Layouting::pos(p, m_orientation);
+    auto it = std::upper_bound(m_visibleChildrenCache.cbegin(), m_visibleChildrenCache.cend(), pos,
+                               [this] (int value, Item *item) {
+        return value < item->pos(m_orientation);
+    });
+
+    if (it == m_visibleChildrenCache.cbegin())
+        return nullptr;
+
+    Item *item = *(--it);
+    return item->geometry().contains(p) ? item : nullptr;
 }
 
 Item *ItemContainer::itemAt_recursive(QPoint p) const
@@ -1519,7 +2141,17 @@ Item::List ItemContainer::items_recursive() const
 void ItemContainer::setHostWidget(QWidget *host)
 {
     Item::setHostWidget(host);
-    deleteSeparators_recursive();
+
+    // Transplanting a sub-tree into another layout keeps its separators, they just change host.
+    // Each container handles its own as we recurse below.
+    if (host) {
+        for (Separator *separator : qAsConst(m_separators))
+            separator->setHostWidget(host);
+    } else {
+        deleteSeparators();
+    }
+
+    setGeometryDirty_recursive(); // So all separators get repositioned below
     for (Item *item : qAsConst(m_children)) {
         item->setHostWidget(host);
     }
@@ -1558,6 +2190,9 @@ void ItemContainer::insertItem(Item *item, int index, DefaultSizeMode defaultSiz
     }
 
     m_children.insert(index, item);
+    updateChildIndexes(index);
+    s_structureGeneration++;
+    invalidateSizeCache();
     item->setParentContainer(this);
 
     Q_EMIT itemsChanged();
@@ -1598,6 +2233,12 @@ bool ItemContainer::hasOrientationFor(Location loc) const
 Item::List ItemContainer::visibleChildren(bool includeBeingInserted) const
 {
     Item::List items;
+    fillVisibleChildren(items, includeBeingInserted);
+    return items;
+}
+
+void ItemContainer::fillVisibleChildren(Item::List &items, bool includeBeingInserted) const
+{
     items.reserve(m_children.size());
     for (Item *item : m_children) {
         if (includeBeingInserted) {
@@ -1608,16 +2249,17 @@ Item::List ItemContainer::visibleChildren(bool includeBeingInserted) const
                 items << item;
         }
     }
-
-    return items;
 }
 
 int ItemContainer::usableLength() const
 {
-    const Item::List children = visibleChildren();
-    const int numVisibleChildren = children.size();
+    int numVisibleChildren = 0;
+    for (Item *item : m_children) {
+        if (item->isVisible() && !item->isBeingInserted())
+            numVisibleChildren++;
+    }
 
-    if (children.size() <= 1)
+    if (numVisibleChildren <= 1)
         return Layouting::length(size(), m_orientation);
 
     const int separatorWaste = separatorThickness * (numVisibleChildren - 1);
@@ -1631,7 +2273,23 @@ bool ItemContainer::hasSingleVisibleItem() const
 
 bool ItemContainer::contains(const Item *item) const
 {
-    return m_children.contains(const_cast<Item *>(item));
+    return indexOfChild(item) != -1;
+}
+
+int ItemContainer::indexOfChild(const Item *item) const
+{
+    // Checked, as items that left us or weren't added yet can still have an index
+    const int index = item ? item->m_indexInParent : -1;
+    if (index >= 0 && index < m_children.size() && m_children.at(index) == item)
+        return index;
+
+    return -1;
+}
+
+void ItemContainer::updateChildIndexes(int from)
+{
+    for (int i = qMax(0, from); i < m_children.size(); ++i)
+        m_children.at(i)->m_indexInParent = i;
 }
 
 bool ItemContainer::contains_recursive(const Item *item) const
@@ -1651,6 +2309,9 @@ bool ItemContainer::contains_recursive(const Item *item) const
 void ItemContainer::setChildren(const Item::List children, Qt::Orientation o)
 {
     m_children = children;
+    updateChildIndexes();
+    s_structureGeneration++;
+    invalidateSizeCache();
     for (Item *item : children)
         item->setParentContainer(this);
 
@@ -1661,12 +2322,16 @@ void ItemContainer::setOrientation(Qt::Orientation o)
 {
     if (o != m_orientation) {
         m_orientation = o;
+        invalidateSizeCache();
         updateSeparators_recursive();
     }
 }
 
 QSize ItemContainer::minSize() const
 {
+    if (m_minSizeCacheValid)
+        return m_cachedMinSize;
+
     int minW = 0;
     int minH = 0;
     int numVisible = 0;
@@ -1691,11 +2356,34 @@ QSize ItemContainer::minSize() const
             minW += separatorWaste;
     }
 
-    return QSize(minW, minH);
+    m_cachedMinSize = QSize(minW, minH);
+    m_minSizeCacheValid = true;
+    return m_cachedMinSize;
+}
+
+bool ItemContainer::isFixedOnParentResize() const
+{
+    if (Item::isFixedOnParentResize())
+        return true;
+
+    // Without the whole subtree being fixed, some child has to absorb the change
+    bool hasVisibleChildren = false;
+    for (Item *item : m_children) {
+        if (item->isVisible()) {
+            if (!item->isFixedOnParentResize())
+                return false;
+            hasVisibleChildren = true;
+        }
+    }
+
+    return hasVisibleChildren;
 }
 
 QSize ItemContainer::maxSize() const
 {
+    if (m_maxSizeCacheValid)
+        return m_cachedMaxSize;
+
     int maxW = 0;
     int maxH = 0;
 
@@ -1718,7 +2406,9 @@ QSize ItemContainer::maxSize() const
             maxW += separatorWaste;
     }
 
-    return { maxW, maxH };
+    m_cachedMaxSize = { maxW, maxH };
+    m_maxSizeCacheValid = true;
+    return m_cachedMaxSize;
 }
 
 void ItemContainer::resizeChildren(QSize oldSize, QSize newSize, SizingInfo::List &childSizes,
@@ -1728,7 +2418,6 @@ void ItemContainer::resizeChildren(QSize oldSize, QSize newSize, SizingInfo::Lis
     //on @p strategy.
     // The new sizes are applied to @p childSizes, which will be applied to the widgets when when we're done
 
-    const QVector<double> childPercentages = this->childPercentages();
     const int count = childSizes.count();
     const bool widthChanged = oldSize.width() != newSize.width();
     const bool heightChanged = oldSize.height() != newSize.height();
@@ -1739,26 +2428,20 @@ void ItemContainer::resizeChildren(QSize oldSize, QSize newSize, SizingInfo::Lis
         // In this strategy mode, each children will preserve its current relative size. So, if a child
         // is occupying 50% of this container, then it will still occupy that after the container resize
 
-        int remaining = totalNewLength;
-        for (int i = 0; i < count; ++i) {
-            const bool isLast = i == count - 1;
+        if (lengthChanged && !distributeKeepingFixedChildren(childSizes, totalNewLength))
+            distributeProportionally(childSizes, totalNewLength);
 
+        for (int i = 0; i < count; ++i) {
             SizingInfo &itemSize = childSizes[i];
-
-            const qreal childPercentage = childPercentages.at(i);
-            const int newItemLength = lengthChanged ? (isLast ? remaining
-                                                              : int(childPercentage * totalNewLength))
-                                                    : itemSize.length(m_orientation);
+            const int newItemLength = itemSize.length(m_orientation);
 
             if (newItemLength <= 0) {
-                root()->dumpLayout();
+                dumpLayoutOnError();
                 qWarning() << Q_FUNC_INFO << "Invalid resize newItemLength=" << newItemLength;
                 Q_ASSERT(false);
                 return;
             }
 
-            remaining = remaining - newItemLength;
-
             if (isVertical()) {
                 itemSize.geometry.setSize({ width(), newItemLength });
             } else {
@@ -1813,11 +2496,12 @@ void ItemContainer::resizeChildren(QSize oldSize, QSize newSize, SizingInfo::Lis
 
 void ItemContainer::setSize_recursive(QSize newSize, ChildrenResizeStrategy strategy)
 {
+    KDDW_TRACE_SCOPE("layout", "ItemContainer::setSize_recursive");
     QScopedValueRollback<bool> block(m_blockUpdatePercentages, true);
 
     const QSize minSize = this->minSize();
     if (newSize.width() < minSize.width() || newSize.height() < minSize.height()) {
-        root()->dumpLayout();
+        dumpLayoutOnError();
         qWarning() << Q_FUNC_INFO << "New size doesn't respect size constraints"
                    << "; new=" << newSize
                    << "; min=" << minSize
@@ -1829,10 +2513,13 @@ void ItemContainer::setSize_recursive(QSize newSize, ChildrenResizeStrategy stra
 
     const QSize oldSize = size();
     setSize(newSize);
+    if (isRoot())
+        Separator::invalidateDragBounds();
 
-    const Item::List children = visibleChildren();
-    const int count = children.size();
-    SizingInfo::List childSizes = sizes();
+    ScratchLease<SizingInfo::List> lease(d->m_sizes);
+    SizingInfo::List &childSizes = *lease;
+    fillSizes(childSizes);
+    const int count = childSizes.size();
 
     // #1 Since we changed size, also resize out children.
     // But apply them to our SizingInfo::List first before setting actual Item/QWidget geometries
@@ -1846,7 +2533,8 @@ void ItemContainer::setSize_recursive(QSize newSize, ChildrenResizeStrategy stra
     // the positions:
     positionItems(/*by-ref*/ childSizes);
 
-    // #2 Adjust sizes so that each item has at least Item::minSize.
+    // #2 Adjust sizes so that each item has at least Item::minSize. The Percentage strategy already
+    // honours them, this is for the separator move ones.
     for (int i = 0; i < count; ++i) {
         SizingInfo &size = childSizes[i];
         const int missing = size.missingLength(m_orientation);
@@ -1914,6 +2602,209 @@ void ItemContainer::dumpLayout(int level)
     }
 }
 
+void ItemContainer::distributeProportionally(SizingInfo::List &childSizes, int totalLength)
+{
+    // The shares are the exact lengths the percentages were computed from, so integer math is enough.
+    // Resizing back to a previous size gives the exact same lengths.
+    bool hasShares = true;
+    for (const SizingInfo &sizing : qAsConst(childSizes))
+        hasShares = hasShares && sizing.percentageLength > 0;
+
+    if (!hasShares) {
+        // Percentages weren't computed yet, use the current lengths
+        for (SizingInfo &sizing : childSizes)
+            sizing.percentageLength = qMax(1, sizing.length(m_orientation));
+    }
+
+    distributeWithinBounds(childSizes, totalLength, /*proportional=*/ true);
+}
+
+bool ItemContainer::distributeKeepingFixedChildren(SizingInfo::List &childSizes, int totalLength)
+{
+    const Qt::Orientation o = m_orientation;
+    int fixedLength = 0;
+    qint64 flexibleMin = 0;
+    qint64 flexibleMax = 0;
+    bool hasFixed = false;
+    for (const SizingInfo &sizing : qAsConst(childSizes)) {
+        if (sizing.isFixedOnParentResize) {
+            hasFixed = true;
+            fixedLength += sizing.length(o);
+        } else {
+            flexibleMin += sizing.minLength(o);
+            flexibleMax += qMax(sizing.minLength(o), sizing.maxLength(o));
+        }
+    }
+
+    const int flexibleLength = totalLength - fixedLength;
+    if (!hasFixed || flexibleLength < flexibleMin || flexibleLength > flexibleMax)
+        return false;
+
+    auto setLength = [o] (QSize &size, int length) {
+        if (o == Qt::Vertical)
+            size.setHeight(length);
+        else
+            size.setWidth(length);
+    };
+
+    // Pins the fixed children at their current length, so the water-filling only moves the others
+    ScratchLease<QVector<int>> boundsLease(d->m_fixedBounds);
+    QVector<int> &originalBounds = *boundsLease;
+    for (SizingInfo &sizing : childSizes) {
+        if (sizing.isFixedOnParentResize) {
+            const int length = sizing.length(o);
+            originalBounds << sizing.minLength(o) << sizing.maxLength(o);
+            setLength(sizing.minSize, length);
+            setLength(sizing.maxSize, length);
+        }
+    }
+
+    distributeProportionally(childSizes, totalLength);
+
+    int i = 0;
+    for (SizingInfo &sizing : childSizes) {
+        if (sizing.isFixedOnParentResize) {
+            setLength(sizing.minSize, originalBounds.at(i++));
+            setLength(sizing.maxSize, originalBounds.at(i++));
+        }
+    }
+
+    return true;
+}
+
+void ItemContainer::distributeWithinBounds(SizingInfo::List &sizes, int totalLength, bool proportional)
+{
+    // Water-filling: each item gets qBound(min, level * weight, max), for the level at which they add up
+    // to totalLength. That sum is piecewise linear in the level and only changes slope when an item reaches
+    // one of its bounds, so instead of clamping and redistributing until it settles, the 2n bounds are
+    // sorted by the level they're reached at and swept once, which finds the segment with the solution.
+    // Levels are compared as fractions, so there's no rounding until the very end, where the pixels
+    // that don't divide evenly go to the largest remainders, ties to the first item.
+    enum State { State_AtMin, State_Growing, State_AtMax };
+
+    const int count = sizes.count();
+    if (count == 0)
+        return;
+
+    const Qt::Orientation o = m_orientation;
+    auto weight = [&sizes, proportional] (int index) -> qint64 {
+        return proportional ? qMax(1, sizes.at(index).percentageLength) : 1;
+    };
+    auto minLength = [&sizes, o] (int index) {
+        return sizes.at(index).minLength(o);
+    };
+    auto maxLength = [&sizes, o] (int index) {
+        return qMax(sizes.at(index).minLength(o), sizes.at(index).maxLength(o));
+    };
+    // Event 2 * i is item i reaching its min, 2 * i + 1 its max
+    auto bound = [&minLength, &maxLength] (int event) -> qint64 {
+        return event % 2 == 0 ? minLength(event / 2) : maxLength(event / 2);
+    };
+
+    ScratchLease<QVector<int>> statesLease(d->m_boundStates);
+    QVector<int> &states = *statesLease;
+    states.reserve(count);
+
+    qint64 sumOfMin = 0;
+    qint64 sumOfMax = 0;
+    for (int i = 0; i < count; ++i) {
+        sumOfMin += minLength(i);
+        sumOfMax += maxLength(i);
+        states << State_AtMin;
+    }
+
+    qint64 fixedLength = sumOfMin; // The length of the items sitting at a bound
+    qint64 growingWeight = 0; // The weight of the others
+    if (totalLength <= sumOfMin) {
+        // Can't happen, as our min size is the sum of the children's. Nothing to share.
+        for (int i = 0; i < count; ++i)
+            sizes[i].setLength(minLength(i), o);
+        return;
+    } else if (totalLength >= sumOfMax) {
+        // Everyone is at max, the excess is shared proportionally, as the layout must be filled
+        fixedLength = sumOfMax;
+        for (int i = 0; i < count; ++i) {
+            states[i] = State_Growing;
+            growingWeight += weight(i);
+        }
+    } else {
+        ScratchLease<QVector<int>> eventsLease(d->m_boundEvents);
+        QVector<int> &events = *eventsLease;
+        events.reserve(2 * count);
+        for (int i = 0; i < 2 * count; ++i)
+            events << i;
+
+        std::sort(events.begin(), events.end(), [&bound, &weight] (int e1, int e2) {
+            // bound(e1) / weight(e1) < bound(e2) / weight(e2), ties by event so it's deterministic
+            const qint64 lhs = bound(e1) * weight(e2 / 2);
+            const qint64 rhs = bound(e2) * weight(e1 / 2);
+            return lhs != rhs ? lhs < rhs : e1 < e2;
+        });
+
+        for (int event : qAsConst(events)) {
+            const int index = event / 2;
+            const qint64 w = weight(index);
+            // At this event's level the total is fixedLength + level * growingWeight. Compared
+            // with totalLength, multiplied by the weight so it stays in integers.
+            if (fixedLength * w + bound(event) * growingWeight >= qint64(totalLength) * w)
+                break; // The solution is before this event, we have the final set of growing items
+
+            if (event % 2 == 0) {
+                states[index] = State_Growing;
+                fixedLength -= minLength(index);
+                growingWeight += w;
+            } else {
+                states[index] = State_AtMax;
+                fixedLength += maxLength(index);
+                growingWeight -= w;
+            }
+        }
+    }
+
+    // The growing ones share what the others left, which was bracketed so they stay within their bounds
+    ScratchLease<QVector<int>> remaindersLease(d->m_remainders);
+    QVector<int> &remainders = *remaindersLease;
+    ScratchLease<QVector<int>> orderLease(d->m_order);
+    QVector<int> &order = *orderLease;
+    remainders.reserve(count);
+    order.reserve(count);
+
+    const bool overflowing = totalLength >= sumOfMax;
+    const qint64 toShare = totalLength - fixedLength;
+    qint64 leftover = toShare;
+    for (int i = 0; i < count; ++i) {
+        int length = 0;
+        qint64 remainder = 0;
+        switch (states.at(i)) {
+        case State_AtMin:
+            length = minLength(i);
+            break;
+        case State_AtMax:
+            length = maxLength(i);
+            break;
+        case State_Growing: {
+            const qint64 scaled = toShare * weight(i);
+            length = int(scaled / growingWeight);
+            remainder = scaled % growingWeight;
+            leftover -= length;
+            if (overflowing)
+                length += maxLength(i);
+            order << i;
+            break;
+        }
+        }
+        sizes[i].setLength(length, o);
+        remainders << int(qMin<qint64>(remainder, std::numeric_limits<int>::max()));
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&remainders] (int a, int b) {
+        return remainders.at(a) > remainders.at(b);
+    });
+
+    for (int i = 0; i < leftover && i < order.size(); ++i)
+        sizes[order.at(i)].incrementLength(1, o);
+}
+
 void ItemContainer::updateChildPercentages()
 {
     if (m_blockUpdatePercentages)
@@ -1922,16 +2813,18 @@ void ItemContainer::updateChildPercentages()
     const int usable = usableLength();
     for (Item *item : qAsConst(m_children)) {
         if (item->isVisible() && !item->isBeingInserted()) {
+            item->m_sizingInfo.percentageLength = item->length(m_orientation);
             item->m_sizingInfo.percentageWithinParent = (1.0 * item->length(m_orientation)) / usable;
             auto p = item->m_sizingInfo.percentageWithinParent;
             if (qFuzzyIsNull(p) || p > 1.0) {
-                root()->dumpLayout();
+                dumpLayoutOnError();
                 qWarning() << Q_FUNC_INFO << "Invalid percentage" << p << this
                            << "; item=" << item
                            << "; item.length=" << item->length(m_orientation);
             }
         } else {
             item->m_sizingInfo.percentageWithinParent = 0.0;
+            item->m_sizingInfo.percentageLength = 0;
         }
     }
 }
@@ -1948,14 +2841,18 @@ void ItemContainer::updateChildPercentages_recursive()
 QVector<double> ItemContainer::childPercentages() const
 {
     QVector<double> percentages;
+    fillChildPercentages(percentages);
+    return percentages;
+}
+
+void ItemContainer::fillChildPercentages(QVector<double> &percentages) const
+{
     percentages.reserve(m_children.size());
 
     for (Item *item : m_children) {
         if (item->isVisible() && !item->isBeingInserted())
             percentages << item->m_sizingInfo.percentageWithinParent;
     }
-
-    return percentages;
 }
 
 void ItemContainer::restoreChild(Item *item, NeighbourSqueezeStrategy neighbourSqueezeStrategy)
@@ -2006,10 +2903,117 @@ void ItemContainer::restoreChild(Item *item, NeighbourSqueezeStrategy neighbourS
     updateSeparators_recursive();
 }
 
+void ItemContainer::restoreChildren(const Item::List &items)
+{
+    Q_ASSERT(isRoot());
+
+    // Find what gets restored, before anything changes. A hidden container comes back with the
+    // first of its children, with the same size, like in restoreChild()
+    QSet<Item*> restored;
+    QSet<ItemContainer*> affected;
+    for (Item *item : items) {
+        Q_ASSERT(item->root() == this);
+        Item *child = item;
+        ItemContainer *c = item->parentContainer();
+        while (c && !restored.contains(child) && !child->isVisible()) {
+            restored.insert(child);
+            affected.insert(c);
+            if (c->isVisible() || c->isRoot() || restored.contains(c))
+                break;
+
+            c->setSize(child->size());
+            child = c;
+            c = c->parentContainer();
+        }
+    }
+
+    if (restored.isEmpty())
+        return;
+
+    // The ancestors too, as they might need to grow to honour the new min sizes
+    QSet<ItemContainer*> seen;
+    QVector<ItemContainer*> containers;
+    for (ItemContainer *c : qAsConst(affected)) {
+        for (ItemContainer *it = c; it && !seen.contains(it); it = it->parentContainer()) {
+            seen.insert(it);
+            containers.push_back(it);
+        }
+    }
+
+    beginBatch();
+
+    // Marked as being inserted, so the resize below leaves them alone, but their min sizes already count
+    for (Item *item : qAsConst(restored)) {
+        item->setBeingInserted(true);
+        if (!item->isContainer())
+            item->setIsVisible(true);
+    }
+
+    for (ItemContainer *c : qAsConst(containers))
+        c->invalidateSizeCache();
+
+    // Make sure we're big enough to respect all item's min-sizes
+    updateSizeConstraints();
+
+    // Parents first, so each container already has its final size when its children are laid out
+    auto depth = [] (const Item *item) {
+        int result = 0;
+        while ((item = item->parentContainer()))
+            result++;
+        return result;
+    };
+    std::stable_sort(containers.begin(), containers.end(), [&depth] (ItemContainer *c1, ItemContainer *c2) {
+        return depth(c1) < depth(c2);
+    });
+
+    for (ItemContainer *c : qAsConst(containers)) {
+        for (Item *child : qAsConst(c->m_children)) {
+            if (restored.contains(child))
+                child->setBeingInserted(false);
+        }
+
+        const Qt::Orientation o = c->m_orientation;
+        const int usable = c->usableLength();
+        ScratchLease<SizingInfo::List> lease(c->d->m_sizes);
+        SizingInfo::List &sizes = *lease;
+        c->fillSizes(sizes);
+
+        int i = 0;
+        for (Item *child : qAsConst(c->m_children)) {
+            if (!child->isVisible() || child->isBeingInserted())
+                continue;
+
+            SizingInfo &sizing = sizes[i++];
+            const int length = restored.contains(child) ? qBound(sizing.minLength(o), sizing.length(o), usable)
+                                                        : sizing.length(o);
+            sizing.percentageLength = qMax(1, length);
+        }
+
+        if (!c->distributeKeepingFixedChildren(sizes, usable))
+            c->distributeProportionally(sizes, usable);
+        c->positionItems(/*by-ref=*/sizes);
+        c->applyGeometries(sizes);
+    }
+
+    commitBatch();
+}
+
 void ItemContainer::updateWidgetGeometries()
 {
-    for (Item *item : qAsConst(m_children))
-        item->updateWidgetGeometries();
+    if (isInBatch())
+        return;
+
+    if (!(m_dirtyFlags & DirtyFlag_Guest)) {
+        // No guest widget in this sub-tree needs updating
+        return;
+    }
+
+    for (Item *item : qAsConst(m_children)) {
+        if (item->m_dirtyFlags & DirtyFlag_Guest)
+            item->updateWidgetGeometries();
+    }
+
+    m_dirtyFlags = m_dirtyFlags & ~DirtyFlags(DirtyFlag_Guest);
 }
 
 int ItemContainer::oppositeLength() const
@@ -2018,25 +3022,53 @@ int ItemContainer::oppositeLength() const
                         : height();
 }
 
+void ItemContainer::freezeGuests_recursive()
+{
+    for (Item *item : qAsConst(m_children)) {
+        if (auto c = item->asContainer())
+            c->freezeGuests_recursive();
+        else
+            item->freezeGuest();
+    }
+
+    // The snapshots were raised, but the separators between them must stay on top. Guests
+    // keeping their old, bigger, geometry would cover them otherwise.
+    for (Separator *separator : qAsConst(m_separators)) {
+        if (separator->isVisible())
+            separator->raise();
+    }
+}
+
+void ItemContainer::thawGuests_recursive()
+{
+    for (Item *item : qAsConst(m_children)) {
+        if (auto c = item->asContainer())
+            c->thawGuests_recursive();
+        else
+            item->thawGuest();
+    }
+}
+
 void ItemContainer::requestSeparatorMove(Separator *separator, int delta)
 {
+    KDDW_TRACE_SCOPE("layout", "ItemContainer::requestSeparatorMove");
     const int separatorIndex = m_separators.indexOf(separator);
     if (separatorIndex == -1) {
         // Doesn't happen
         qWarning() << Q_FUNC_INFO << "Unknown separator" << separator << this;
-        root()->dumpLayout();
+        dumpLayoutOnError();
         return;
     }
 
     if (delta == 0)
         return;
 
-    const int min = minPosForSeparator_global(separator);
+    const int min = separator->minPosition();
     const int pos = separator->position();
-    const int max = maxPosForSeparator_global(separator);
+    const int max = separator->maxPosition();
 
     if (pos + delta < min || pos + delta > max) {
-        root()->dumpLayout();
+        dumpLayoutOnError();
         qWarning() << "Separator would have gone out of bounds"
                    << "; separators=" << separator
                    << "; min=" << min << "; pos=" << pos
@@ -2045,12 +3077,14 @@ void ItemContainer::requestSeparatorMove(Separator *separator, int delta)
     }
 
     const Side moveDirection = delta < 0 ? Side1 : Side2;
-    const Item::List children = visibleChildren();
+    ScratchLease<Item::List> childrenLease(d->m_children);
+    Item::List &children = *childrenLease;
+    fillVisibleChildren(children);
     if (children.size() <= separatorIndex) {
         // Doesn't happen
         qWarning() << Q_FUNC_INFO << "Not enough children for separator index" << separator
                    << this << separatorIndex;
-        root()->dumpLayout();
+        dumpLayoutOnError();
         return;
     }
 
@@ -2153,7 +3187,10 @@ void ItemContainer::requestEqualSize(Separator *separator)
 
 void ItemContainer::layoutEqually()
 {
-    SizingInfo::List childSizes = sizes();
+    KDDW_TRACE_SCOPE("layout", "ItemContainer::layoutEqually");
+    ScratchLease<SizingInfo::List> lease(d->m_sizes);
+    SizingInfo::List &childSizes = *lease;
+    fillSizes(childSizes);
     if (!childSizes.isEmpty()) {
         layoutEqually(childSizes);
         applyGeometries(childSizes);
@@ -2162,56 +3199,8 @@ void ItemContainer::layoutEqually()
 
 void ItemContainer::layoutEqually(SizingInfo::List &sizes)
 {
-    const int numItems = sizes.count();
-    QVector<int> satisfiedIndexes;
-    satisfiedIndexes.reserve(numItems);
-
-    int lengthToGive = length() - (m_separators.size() * Item::separatorThickness);
-
-    // clear the sizes before we start distributing
-    for (SizingInfo &size : sizes)
-         size.setLength(0, m_orientation);
-
-    while (satisfiedIndexes.count() < sizes.count()) {
-        const int remainingItems = sizes.count() - satisfiedIndexes.count();
-        int suggestedToGive = qMax(1, lengthToGive / remainingItems);
-        const int oldLengthToGive = lengthToGive;
-
-        for (int i = 0; i < numItems; ++i) {
-            if (satisfiedIndexes.contains(i))
-                continue;
-
-            SizingInfo &size = sizes[i];
-            if (size.availableToGrow(m_orientation) <= 0) {
-                // Was already satisfied from the beginning
-                satisfiedIndexes.push_back(i);
-                continue;
-            }
-
-            const int newItemLenght = qBound(size.minLength(m_orientation),
-                                             size.length(m_orientation) + suggestedToGive,
-                                             size.maxLength(m_orientation));
-            const int toGive = newItemLenght - size.length(m_orientation);
-
-            if (toGive == 0) {
-                Q_ASSERT(false);
-                satisfiedIndexes.push_back(i);
-            } else {
-                lengthToGive -= toGive;
-                size.incrementLength(toGive, m_orientation);
-                if (size.availableToGrow(m_orientation) <= 0) {
-                    satisfiedIndexes.push_back(i);
-                }
-                if (lengthToGive == 0)
-                    return;
-            }
-        }
-
-        if (oldLengthToGive == lengthToGive) {
-            // Nothing happened, we can't satisfy more items, due to min/max constraints
-            return;
-        }
-    }
+    const int lengthToGive = length() - (m_separators.size() * Item::separatorThickness);
+    distributeWithinBounds(sizes, lengthToGive, /*proportional=*/ false);
 }
 
 void ItemContainer::layoutEqually_recursive()
@@ -2228,7 +3217,7 @@ void ItemContainer::layoutEqually_recursive()
 Item *ItemContainer::visibleNeighbourFor(const Item *item, Side side) const
 {
     // Item might not be visible, so use m_children instead of visibleChildren()
-    const int index = m_children.indexOf(const_cast<Item*>(item));
+    const int index = indexOfChild(item);
 
     if (side == Side1) {
         for (int i = index - 1; i >= 0; i--) {
@@ -2365,7 +3354,7 @@ int ItemContainer::availableOnSide(const Item *child, Side side) const
 
     const int available = length - min;
     if (available < 0) {
-        root()->dumpLayout();
+        dumpLayoutOnError();
         Q_ASSERT(false);
     }
     return available;
@@ -2480,7 +3469,7 @@ void ItemContainer::growItem(int index, SizingInfo::List &sizes, int missing,
         int available2 = side2Length.available();
 
         if (toSteal > available1 + available2) {
-            root()->dumpLayout();
+            dumpLayoutOnError();
             Q_ASSERT(false);
         }
 
@@ -2524,9 +3513,10 @@ void ItemContainer::growItem(Item *item, int amount, GrowthStrategy growthStrate
                              bool accountForNewSeparator,
                              ChildrenResizeStrategy childResizeStrategy)
 {
-    const Item::List items = visibleChildren();
-    const int index = items.indexOf(item);
-    SizingInfo::List sizes = this->sizes();
+    const int index = indexOfVisibleChild(item);
+    ScratchLease<SizingInfo::List> lease(d->m_sizes);
+    SizingInfo::List &sizes = *lease;
+    fillSizes(sizes);
 
     growItem(index, /*by-ref=*/sizes, amount, growthStrategy, neighbourSqueezeStrategy, accountForNewSeparator);
 
@@ -2535,84 +3525,229 @@ void ItemContainer::growItem(Item *item, int amount, GrowthStrategy growthStrate
 
 void ItemContainer::applyGeometries(const SizingInfo::List &sizes, ChildrenResizeStrategy strategy)
 {
-    const Item::List items = visibleChildren();
-    const int count = items.size();
-    Q_ASSERT(count == sizes.size());
-
-    for (int i = 0; i < count; ++i) {
-        Item *item = items.at(i);
-        item->setSize_recursive(sizes[i].geometry.size(), strategy);
+    if (!applyGeometriesInParallel(sizes, strategy)) {
+        int i = 0;
+        for (Item *item : m_children) {
+            if (item->isVisible() && !item->isBeingInserted()) {
+                Q_ASSERT(i < sizes.size());
+                item->setSize_recursive(sizes[i++].geometry.size(), strategy);
+            }
+        }
+        Q_ASSERT(i == sizes.size());
     }
 
     positionItems();
 }
 
+namespace {
+
+///@brief Returns whether @p container has at least @p count leaf items, without counting further
+bool hasAtLeastItems(const ItemContainer *container, int &count)
+{
+    for (Item *item : container->m_children) {
+        if (auto c = item->asContainer()) {
+            if (hasAtLeastItems(c, count))
+                return true;
+        } else if (--count <= 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool isBigSubTree(const Item *item)
+{
+    int count = ItemContainer::parallelLayoutThreshold;
+    auto c = item->asContainer();
+    return c && hasAtLeastItems(c, count);
+}
+
+///@brief Resizes one sub-tree, on a worker or on the thread that forked
+class SubTreeResize : public QRunnable
+{
+public:
+    SubTreeResize(Item *item, QSize size, ChildrenResizeStrategy strategy,
+                  const ItemContainer *parent, QSemaphore *done)
+        : m_item(item)
+        , m_size(size)
+        , m_strategy(strategy)
+        , m_parent(parent)
+        , m_done(done)
+    {
+        setAutoDelete(false);
+    }
+
+    void run() override
+    {
+        const ItemContainer *const oldBoundary = s_dirtyBoundary;
+        Counters *const oldCounters = Tracing::threadCounters();
+        s_dirtyBoundary = m_parent;
+        Tracing::setThreadCounters(&m_counters);
+        m_item->setSize_recursive(m_size, m_strategy);
+        Tracing::setThreadCounters(oldCounters);
+        s_dirtyBoundary = oldBoundary;
+        m_done->release();
+    }
+
+    Counters m_counters;
+
+private:
+    Q_DISABLE_COPY(SubTreeResize)
+    Item *const m_item;
+    const QSize m_size;
+    const ChildrenResizeStrategy m_strategy;
+    const ItemContainer *const m_parent;
+    QSemaphore *const m_done;
+};
+
+}
+
+bool ItemContainer::applyGeometriesInParallel(const SizingInfo::List &sizes, ChildrenResizeStrategy strategy)
+{
+    // Only the math is thread safe. Not setting widget geometries, separators or the trace backends.
+    if (parallelLayoutThreshold <= 0 || !isDummy() || Tracing::backend() || sizes.size() < 2)
+        return false;
+
+    QVector<Item*> items;
+    QVector<bool> isBig;
+    items.reserve(sizes.size());
+    isBig.reserve(sizes.size());
+    int numBig = 0;
+    for (Item *item : qAsConst(m_children)) {
+        if (item->isVisible() && !item->isBeingInserted()) {
+            items.append(item);
+            isBig.append(isBigSubTree(item));
+            if (isBig.last())
+                numBig++;
+        }
+    }
+    Q_ASSERT(items.size() == sizes.size());
+
+    if (numBig < 2)
+        return false;
+
+    // What the workers read from above them must not be lazily filled while they run
+    root();
+    const DirtyFlags ancestorFlags = DirtyFlags(DirtyFlag_Descendants | DirtyFlag_Guest | DirtyFlag_Unchecked);
+    for (ItemContainer *p = this; p && p != s_dirtyBoundary; p = p->parentContainer())
+        p->m_dirtyFlags |= ancestorFlags;
+
+    // The big sub-trees go to idle workers, if any. Whatever isn't picked up is done here, so
+    // nested forks never wait for a worker that's itself waiting.
+    QSemaphore done;
+    QVector<SubTreeResize*> tasks;
+    tasks.reserve(items.size());
+    QThreadPool *pool = QThreadPool::globalInstance();
+    for (int i = 0; i < items.size(); ++i) {
+        auto task = new SubTreeResize(items.at(i), sizes.at(i).geometry.size(), strategy, this, &done);
+        tasks.append(task);
+        if (!isBig.at(i) || !pool->tryStart(task))
+            task->run();
+    }
+
+    done.acquire(tasks.size());
+
+    for (SubTreeResize *task : qAsConst(tasks))
+        Tracing::counters() += task->m_counters;
+    qDeleteAll(tasks);
+
+    return true;
+}
+
 SizingInfo::List ItemContainer::sizes(bool ignoreBeingInserted) const
 {
-    const Item::List children = visibleChildren(ignoreBeingInserted);
     SizingInfo::List result;
-    result.reserve(children.count());
-    for (Item *item : children) {
+    fillSizes(result, ignoreBeingInserted);
+    return result;
+}
+
+void ItemContainer::fillSizes(SizingInfo::List &result, bool ignoreBeingInserted) const
+{
+    result.reserve(m_children.count());
+    for (Item *item : m_children) {
+        const bool included = ignoreBeingInserted ? (item->isVisible() || item->isBeingInserted())
+                                                  : (item->isVisible() && !item->isBeingInserted());
+        if (!included)
+            continue;
+
         if (item->isContainer())
             item->m_sizingInfo.minSize = item->minSize();
         result << item->m_sizingInfo;
+        if (item->isContainer())
+            result.last().isFixedOnParentResize = item->isFixedOnParentResize();
     }
-
-    return result;
 }
 
-QVector<int> ItemContainer::calculateSqueezes(SizingInfo::List::ConstIterator begin,
-                                              SizingInfo::List::ConstIterator end, int needed,
-                                              NeighbourSqueezeStrategy strategy, bool reversed) const
+void ItemContainer::calculateSqueezes(SizingInfo::List::ConstIterator begin,
+                                      SizingInfo::List::ConstIterator end, int needed,
+                                      NeighbourSqueezeStrategy strategy, QVector<int> &squeezes,
+                                      bool reversed) const
 {
-    QVector<int> availabilities;
+    ScratchLease<QVector<int>> availabilitiesLease(d->m_availabilities);
+    QVector<int> &availabilities = *availabilitiesLease;
+    availabilities.reserve(int(end - begin));
     for (auto it = begin; it < end; ++it) {
         availabilities << it->availableLength(m_orientation);
     }
 
     const int count = availabilities.count();
 
-    QVector<int> squeezes(count, 0);
+    squeezes.fill(0, count);
     int missing = needed;
 
+    // Plain pointers, so the loops below don't go through QVector's detach checks
+    int *const available = availabilities.data();
+    int *const squeezed = squeezes.data();
+
     if (strategy == NeighbourSqueezeStrategy::AllNeighbours) {
-        while (missing > 0) {
-            const int numDonors = std::count_if(availabilities.cbegin(), availabilities.cend(), [] (int num) {
-                return num > 0;
-            });
+        // Each round takes an equal share from every neighbour that still has length to give.
+        // Exhausted neighbours are dropped from the donor list, so later rounds only visit the ones left,
+        // in the same order as before.
+        ScratchLease<QVector<int>> donorsLease(d->m_donors);
+        QVector<int> &donorList = *donorsLease;
+        donorList.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            if (available[i] > 0)
+                donorList << i;
+        }
 
+        int *const donors = donorList.data();
+        int numDonors = donorList.size();
+        while (missing > 0) {
             if (numDonors == 0) {
-                root()->dumpLayout();
+                dumpLayoutOnError();
                 Q_ASSERT(false);
-                return {};
+                squeezes.clear();
+                return;
             }
 
             int toTake = missing / numDonors;
             if (toTake == 0)
                 toTake = missing;
 
-            for (int i = 0; i < count; ++i) {
-                const int available = availabilities.at(i);
-                if (available == 0)
-                    continue;
-                const int took = qMin(missing, qMin(toTake, available));
-                availabilities[i] -= took;
+            int numRemainingDonors = 0;
+            for (int j = 0; j < numDonors; ++j) {
+                const int i = donors[j];
+                const int took = qMin(missing, qMin(toTake, available[i]));
+                available[i] -= took;
                 missing -= took;
-                squeezes[i] += took;
+                squeezed[i] += took;
                 if (missing == 0)
                     break;
+                if (available[i] > 0)
+                    donors[numRemainingDonors++] = i;
             }
+
+            numDonors = numRemainingDonors;
         }
     } else if (strategy == NeighbourSqueezeStrategy::ImmediateNeighboursFirst) {
         for (int i = 0; i < count; i++) {
             const int index = reversed ? count - 1 - i : i;
 
-            const int available = availabilities.at(index);
-            if (available > 0) {
-                const int took = qMin(missing, available);
-                missing -= took;
-                squeezes[index] += took;
-            }
+            const int took = qMin(missing, available[index]);
+            missing -= took;
+            squeezed[index] += took;
 
             if (missing == 0)
                 break;
@@ -2624,8 +3759,6 @@ QVector<int> ItemContainer::calculateSqueezes(SizingInfo::List::ConstIterator be
         qWarning() << Q_FUNC_INFO << "Missing is negative" << missing
                    << squeezes;
     }
-
-    return squeezes;
 }
 
 void ItemContainer::shrinkNeighbours(int index, SizingInfo::List &sizes, int side1Amount,
@@ -2638,7 +3771,9 @@ void ItemContainer::shrinkNeighbours(int index, SizingInfo::List &sizes, int sid
         auto begin = sizes.cbegin();
         auto end = sizes.cbegin() + index;
         const bool reversed = strategy == NeighbourSqueezeStrategy::ImmediateNeighboursFirst;
-        const QVector<int> squeezes = calculateSqueezes(begin, end, side1Amount, strategy, reversed);
+        ScratchLease<QVector<int>> squeezesLease(d->m_squeezes);
+        QVector<int> &squeezes = *squeezesLease;
+        calculateSqueezes(begin, end, side1Amount, strategy, /*by-ref=*/squeezes, reversed);
         for (int i = 0; i < squeezes.size(); ++i) {
             const int squeeze = squeezes.at(i);
             SizingInfo &sizing = sizes[i];
@@ -2651,7 +3786,9 @@ void ItemContainer::shrinkNeighbours(int index, SizingInfo::List &sizes, int sid
         auto begin = sizes.cbegin() + index + 1;
         auto end = sizes.cend();
 
-        const QVector<int> squeezes = calculateSqueezes(begin, end, side2Amount, strategy);
+        ScratchLease<QVector<int>> squeezesLease(d->m_squeezes);
+        QVector<int> &squeezes = *squeezesLease;
+        calculateSqueezes(begin, end, side2Amount, strategy, /*by-ref=*/squeezes);
         for (int i = 0; i < squeezes.size(); ++i) {
             const int squeeze = squeezes.at(i);
             SizingInfo &sizing = sizes[i + index + 1];
@@ -2684,6 +3821,12 @@ void ItemContainer::updateSeparators()
     if (!hostWidget())
         return;
 
+    if (isInBatch()) {
+        // Separators are only created and positioned when the batch is committed
+        updateChildPercentages();
+        return;
+    }
+
     const QVector<int> positions = requiredSeparatorPositions();
     const int requiredNumSeparators = positions.size();
 
@@ -2691,24 +3834,30 @@ void ItemContainer::updateSeparators()
     if (numSeparatorsChanged) {
         // Instead of just creating N missing ones at the end of the list, let's minimize separators
         // having their position changed, to minimize flicker
+        // Both lists are sorted by position, so a single merge pass finds the ones to keep.
         Separator::List newSeparators;
         newSeparators.reserve(requiredNumSeparators);
 
+        int existingIndex = 0;
+        const int numExisting = m_separators.size();
         for (int position : positions) {
-            Separator *separator = separatorAt(position);
-            if (separator) {
+            // Skip the ones before this position, nothing needs them anymore
+            while (existingIndex < numExisting && m_separators.at(existingIndex)->position() < position)
+                Separator::recycle(m_separators.at(existingIndex++));
+
+            if (existingIndex < numExisting && m_separators.at(existingIndex)->position() == position) {
                 // Already existing, reuse
-                newSeparators.push_back(separator);
-                m_separators.removeOne(separator);
+                newSeparators.push_back(m_separators.at(existingIndex++));
             } else {
-                separator = Separator::createSeparator(hostWidget());
+                Separator *separator = Separator::createSeparator(hostWidget());
                 separator->init(this, m_orientation);
                 newSeparators.push_back(separator);
             }
         }
 
-        // delete what remained, which is unused
-        deleteSeparators();
+        // Recycle what remained, which is unused. Toggling a dock widget will want them back.
+        while (existingIndex < numExisting)
+            Separator::recycle(m_separators.at(existingIndex++));
 
         m_separators = newSeparators;
     }
@@ -2724,6 +3873,10 @@ void ItemContainer::updateSeparators()
     }
 
     updateChildPercentages();
+
+    // Our separators are up to date. Guest geometries are tracked separately by DirtyFlag_Guest.
+    m_dirtyFlags = m_dirtyFlags & ~DirtyFlags(DirtyFlag_Geometry | DirtyFlag_Constraints |
+                                              DirtyFlag_Visibility | DirtyFlag_Descendants);
 }
 
 void ItemContainer::deleteSeparators()
@@ -2747,22 +3900,16 @@ void ItemContainer::updateSeparators_recursive()
 {
     updateSeparators();
 
-    // recurse into the children:
+    // recurse into the children, skipping the sub-trees that didn't change since the last visit
+    const DirtyFlags layoutFlags = DirtyFlag_Geometry | DirtyFlag_Constraints |
+                                   DirtyFlag_Visibility | DirtyFlag_Descendants;
     const Item::List items = visibleChildren();
     for (Item *item : items) {
-        if (auto c = item->asContainer())
-            c->updateSeparators_recursive();
-    }
-}
-
-Separator *ItemContainer::separatorAt(int p) const
-{
-    for (Separator *separator : m_separators) {
-        if (separator->position() == p)
-            return separator;
+        if (auto c = item->asContainer()) {
+            if (c->m_dirtyFlags & layoutFlags)
+                c->updateSeparators_recursive();
+        }
     }
-
-    return nullptr;
 }
 
 bool ItemContainer::isVertical() const
@@ -2849,8 +3996,12 @@ void ItemContainer::fillFromVariantMap(const QVariantMap &map,
                                   : new Item(hostWidget(), this);
         child->fillFromVariantMap(childMap, widgets);
         m_children.push_back(child);
+        child->m_indexInParent = m_children.size() - 1;
     }
 
+    s_structureGeneration++;
+    invalidateSizeCache();
+
     if (isRoot()) {
         updateChildPercentages_recursive();
         if (hostWidget()) {
@@ -2858,8 +4009,12 @@ void ItemContainer::fillFromVariantMap(const QVariantMap &map,
             updateWidgets_recursive();
         }
 
-        relayoutIfNeeded();
-        positionItems_recursive();
+        // Restoring with the same constraints, on the same machine, is the common case. The stored
+        // geometries are then final already, only a layout that doesn't fit needs to be fixed up.
+        if (!isTiledExactly()) {
+            relayoutIfNeeded();
+            positionItems_recursive();
+        }
 
         Q_EMIT minSizeChanged(this);
 #ifdef DOCKS_DEVELOPER_MODE
@@ -2869,6 +4024,36 @@ void ItemContainer::fillFromVariantMap(const QVariantMap &map,
     }
 }
 
+void ItemContainer::restoreGeometries_recursive(const QVariantMap &map)
+{
+    if (isRoot()) {
+        SizingInfo sizing;
+        sizing.fromVariantMap(map[QStringLiteral("sizingInfo")].toMap());
+        setGeometry(sizing.geometry);
+    }
+
+    const QVariantList childrenV = map[QStringLiteral("children")].toList();
+    if (childrenV.size() != m_children.size()) {
+        qWarning() << Q_FUNC_INFO << "Different structure" << childrenV.size() << m_children.size();
+        return;
+    }
+
+    for (int i = 0; i < m_children.size(); ++i) {
+        const QVariantMap childMap = childrenV.at(i).toMap();
+        Item *child = m_children.at(i);
+        SizingInfo sizing;
+        sizing.fromVariantMap(childMap[QStringLiteral("sizingInfo")].toMap());
+        child->setGeometry(sizing.geometry);
+        if (auto c = child->asContainer())
+            c->restoreGeometries_recursive(childMap);
+    }
+
+    if (isRoot()) {
+        updateChildPercentages_recursive();
+        positionItems_recursive();
+    }
+}
+
 bool ItemContainer::isDummy() const
 {
     return hostWidget() == nullptr;
@@ -2888,11 +4073,18 @@ bool ItemContainer::test_suggestedRect()
             for (Location loc : { Location_OnTop, Location_OnLeft, Location_OnRight, Location_OnBottom}) {
                 const QRect rect = suggestedDropRect(itemToDrop, relativeTo, loc);
                 rects.insert(loc, rect);
+                const QRect simulated = simulatedDropRect(itemToDrop, relativeTo, loc);
+                if (simulated.isValid() && simulated != suggestedDropRectByCopy(itemToDrop, relativeTo, loc)) {
+                    dumpLayoutOnError();
+                    qWarning() << Q_FUNC_INFO << "Simulated drop rect differs from the real one" << simulated
+                               << suggestedDropRectByCopy(itemToDrop, relativeTo, loc) << "; loc=" << loc;
+                    return false;
+                }
                 if (rect.isEmpty()) {
                     qWarning() << Q_FUNC_INFO << "Empty rect";
                     return false;
                 } else if (!root()->rect().contains(rect)) {
-                    root()->dumpLayout();
+                    dumpLayoutOnError();
                     qWarning() << Q_FUNC_INFO << "Suggested rect is out of bounds" << rect
                                << "; loc=" << loc << "; relativeTo=" << relativeTo;
                     return false;
@@ -2900,7 +4092,7 @@ bool ItemContainer::test_suggestedRect()
             }
             if (rects.value(Location_OnBottom).y() <= rects.value(Location_OnTop).y() ||
                 rects.value(Location_OnRight).x() <= rects.value(Location_OnLeft).x()) {
-                root()->dumpLayout();
+                dumpLayoutOnError();
                 qWarning() << Q_FUNC_INFO << "Invalid suggested rects" << rects
                            << this << "; relativeTo=" << relativeTo;
                 return false;
@@ -2948,6 +4140,33 @@ bool ItemContainer::isOverflowing() const
     return contentsLength > length();
 }
 
+bool ItemContainer::isTiledExactly() const
+{
+    if (!missingSize().isNull())
+        return false;
+
+    const Qt::Orientation oppositeOrientation = Layouting::oppositeOrientation(m_orientation);
+    const int oppositeLength = Layouting::length(size(), oppositeOrientation);
+    int nextPos = 0;
+    for (Item *item : m_children) {
+        if (!item->isVisible())
+            continue;
+
+        if (item->pos(m_orientation) != nextPos || item->pos(oppositeOrientation) != 0 ||
+            item->length(oppositeOrientation) != oppositeLength || !item->missingSize().isNull())
+            return false;
+
+        if (auto c = item->asContainer()) {
+            if (!c->isTiledExactly())
+                return false;
+        }
+
+        nextPos += item->length(m_orientation) + Item::separatorThickness;
+    }
+
+    return nextPos == 0 || nextPos - Item::separatorThickness == length();
+}
+
 void ItemContainer::relayoutIfNeeded()
 {
     // Checks all the child containers if they have the correct min-size, recursively.
@@ -2983,7 +4202,7 @@ const Item *ItemContainer::itemFromPath(const QVector<int> &path) const
         const bool isLast = i == path.size() - 1;
         if (index < 0 || index >= container->m_children.size()) {
             // Doesn't happen
-            root()->dumpLayout();
+            dumpLayoutOnError();
             qWarning() << Q_FUNC_INFO << "Invalid index" << index
                        << this << path << isRoot();
             return nullptr;
@@ -3010,7 +4229,7 @@ Separator *ItemContainer::neighbourSeparator(const Item *item, Side side, Qt::Or
     if (itemIndex == -1) {
         qWarning() << Q_FUNC_INFO << "Item not found" << item
                    << this;
-        root()->dumpLayout();
+        dumpLayoutOnError();
         return nullptr;
     }
 
@@ -3054,7 +4273,10 @@ void ItemContainer::updateWidgets_recursive()
         } else {
             if (item->isVisible()) {
                 if (QWidget *widget = item->widget()) {
-                    widget->setGeometry(mapToRoot(item->geometry()));
+                    if (!isInBatch()) { // Otherwise commitBatch() sets the final geometry
+                        Tracing::counters().widgetGeometryChanges++;
+                        widget->setGeometry(mapToRoot(item->geometry()));
+                    }
                     widget->setVisible(true);
                 } else {
                     qWarning() << Q_FUNC_INFO << "visible item doesn't have a guest"
@@ -3071,6 +4293,8 @@ QVariantMap SizingInfo::toVariantMap() const
     result[QStringLiteral("geometry")] = rectToMap(geometry);
     result[QStringLiteral("minSize")] = sizeToMap(minSize);
     result[QStringLiteral("maxSize")] = sizeToMap(maxSize);
+    if (isFixedOnParentResize)
+        result[QStringLiteral("isFixedOnParentResize")] = true;
     return result;
 }
 
@@ -3080,6 +4304,7 @@ void SizingInfo::fromVariantMap(const QVariantMap &map)
     geometry = mapToRect(map[QStringLiteral("geometry")].toMap());
     minSize = mapToSize(map[QStringLiteral("minSize")].toMap());
     maxSize = mapToSize(map[QStringLiteral("maxSize")].toMap());
+    isFixedOnParentResize = map.value(QStringLiteral("isFixedOnParentResize")).toBool();
 }
 
 int ItemContainer::Private::defaultLengthFor(Item *item, DefaultSizeMode mode) const
@@ -219,9 +219,12 @@ struct SizingInfo {
     QSize minSize = QSize(KDDOCKWIDGETS_MIN_WIDTH, KDDOCKWIDGETS_MIN_HEIGHT);
     QSize maxSize = QSize(KDDOCKWIDGETS_MAX_WIDTH, KDDOCKWIDGETS_MAX_HEIGHT); // TODO: Not supported yet
     double percentageWithinParent = 0.0;
+    int percentageLength = 0; // The exact length percentageWithinParent was computed from
     bool isBeingInserted = false;
+    bool isFixedOnParentResize = false; // See Item::setFixedOnParentResize()
 };
 
+///@brief The widget an Item lays out. Guests call Item::onGuestParentChanged() when reparented.
 class GuestInterface
 {
 public:
@@ -232,6 +235,19 @@ private:
     Q_DISABLE_COPY(GuestInterface)
 };
 
+///@brief Holds references to items and is told when they're deleted, without any QPointer or connection.
+///@sa Item::addRefHolder()
+class ItemRefHolder
+{
+public:
+    ItemRefHolder() = default;
+    virtual void onItemDestroyed(Item *) = 0;
+protected:
+    ~ItemRefHolder() = default;
+private:
+    Q_DISABLE_COPY(ItemRefHolder)
+};
+
 class Item : public QObject
 {
     Q_OBJECT
@@ -268,6 +284,20 @@ public:
         None, ///< Don't do any sizing
     };
 
+    ///@brief Tracks what changed in an item since it was last visited, so relayouts can skip
+    ///the sub-trees which didn't change
+    enum DirtyFlag {
+        DirtyFlag_None = 0,
+        DirtyFlag_Geometry = 1, ///< The item's geometry changed, or one of its ancestors moved
+        DirtyFlag_Constraints = 2, ///< The min/max size of a child changed. Only set on containers
+        DirtyFlag_Visibility = 4, ///< A child was shown or hidden. Only set on containers
+        DirtyFlag_Descendants = 8, ///< Some item in this sub-tree is dirty. Only set on containers
+        DirtyFlag_Guest = 16, ///< The guest widget, or any guest in this sub-tree, needs its geometry updated
+        DirtyFlag_Unchecked = 32, ///< Something in this sub-tree changed since checkSanity() last passed on it
+        DirtyFlag_All = DirtyFlag_Geometry | DirtyFlag_Constraints | DirtyFlag_Visibility | DirtyFlag_Descendants | DirtyFlag_Guest
+    };
+    Q_DECLARE_FLAGS(DirtyFlags, DirtyFlag)
+
     explicit Item(QWidget *hostWidget, ItemContainer *parent = nullptr);
     ~Item() override;
 
@@ -284,6 +314,24 @@ public:
     static const QSize hardcodedMinimumSize;
     static int separatorThickness;
 
+    ///@brief Whether checkSanity() runs after each mutation and whether the layout is dumped when a warning fires.
+    ///It walks the whole tree, so it's on by default in developer builds only. Otherwise it's opt-in, by setting
+    ///it or by running with KDDOCKWIDGETS_SANITY_CHECKS=1.
+    static bool sanityChecksEnabled;
+
+    ///@brief If true, the checks scheduled after each mutation only visit the sub-trees which changed since
+    ///the last one passed, see DirtyFlag_Unchecked. Explicit checkSanity() calls, like the ones done when
+    ///saving and restoring, still check everything. Set by running with KDDOCKWIDGETS_SANITY_CHECKS=incremental,
+    ///which also enables sanityChecksEnabled.
+    static bool incrementalSanityChecks;
+
+    ///@brief Returns how many times a layout invariant was found broken. Cheap enough to be counted in release builds.
+    static int numInvariantViolations();
+
+    ///@brief If true, the min sizes the guest widgets request are applied once per event loop
+    ///iteration, deepest items first and in a single batch per layout, instead of on each request
+    static bool usesCoalescedMinSizeUpdates;
+
     int x() const;
     int y() const;
     int width() const;
@@ -298,6 +346,15 @@ public:
     ItemContainer *parentContainer() const;
     void setMinSize(QSize);
     void setMaxSize(QSize);
+
+    ///@brief When the parent container is resized, this item keeps its length and only the others
+    ///grow or shrink, as long as they can absorb the whole change. Minimizes how many items a window
+    ///resize touches, for fixed-size panels around a flexible central area
+    void setFixedOnParentResize(bool);
+
+    ///@brief Returns whether setFixedOnParentResize() was set. For containers, whether it's true
+    ///for each of their visible children
+    virtual bool isFixedOnParentResize() const;
     bool isPlaceholder() const;
     void setGeometry(QRect rect);
     ItemContainer *root() const;
@@ -320,19 +377,46 @@ public:
     void unref();
     int refCount() const;
 
+    ///@brief @p holder will be told when this item is deleted. Cost is linear in the number of holders
+    void addRefHolder(ItemRefHolder *holder);
+    void removeRefHolder(ItemRefHolder *holder);
+
     int minLength(Qt::Orientation) const;
 
     QWidget *hostWidget() const;
     void restore(GuestInterface *guest);
 
+    ///@brief Called by the guest when its parent changes, instead of an event filter on every guest.
+    ///If it left the host widget, for example into a floating window, this item becomes a placeholder.
+    void onGuestParentChanged();
+
+    ///@brief The indexes to get to this item from the root, one per level. Costs O(depth), see indexInParent()
     QVector<int> pathFromRoot() const;
 
+    ///@brief Returns whether the root container is inside a beginBatch()/commitBatch() block
+    bool isInBatch() const;
+
+    ///@brief Returns what changed in this item since it was last laid out
+    DirtyFlags dirtyFlags() const;
+
+    ///@brief Covers the guest widget with a snapshot of its current contents. Until thawGuest()
+    ///layout changes only move and scale the snapshot, the guest keeps its size and doesn't repaint.
+    void freezeGuest();
+
+    ///@brief Removes the snapshot and gives the guest its current geometry. See freezeGuest()
+    void thawGuest();
+
+    ///@brief Returns whether freezeGuest() was called and thawGuest() wasn't yet
+    bool isGuestFrozen() const { return m_snapshot != nullptr; }
+
     virtual QSize minSize() const;
     virtual QSize maxSize() const;
     virtual void setSize_recursive(QSize newSize, ChildrenResizeStrategy strategy = ChildrenResizeStrategy::Percentage);
     virtual bool isVisible(bool excludeBeingInserted = false) const;
     virtual void setGeometry_recursive(QRect rect);
     virtual void dumpLayout(int level = 0);
+    ///@brief To be called when an invariant is broken. Counts it, and dumps the layout if sanityChecksEnabled
+    void dumpLayoutOnError();
     virtual void setHostWidget(QWidget *);
     virtual QVariantMap toVariantMap() const;
     virtual void fillFromVariantMap(const QVariantMap &map, const QHash<QString, GuestInterface*> &widgets);
@@ -352,6 +436,8 @@ Q_SIGNALS:
 protected:
     friend class ::TestMultiSplitter;
     explicit Item(bool isContainer, QWidget *hostWidget, ItemContainer *parent);
+    void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
     void setParentContainer(ItemContainer *parent);
     void connectParent(ItemContainer *parent);
     Q_REQUIRED_RESULT virtual bool checkSanity();
@@ -370,6 +456,13 @@ protected:
     bool isBeingInserted() const;
     void setBeingInserted(bool);
 
+    ///@brief Marks this item with @p flags and lets its ancestors know they have a dirty descendant
+    void setDirty(DirtyFlags flags);
+
+    ///@brief Like setDirty(DirtyFlag_Geometry) but for the whole sub-tree. Used when the item
+    ///moved, as every guest widget it contains has a new root-relative geometry
+    void setGeometryDirty_recursive();
+
     SizingInfo m_sizingInfo;
     const bool m_isContainer;
     ItemContainer *m_parent = nullptr;
@@ -378,14 +471,45 @@ private Q_SLOTS:
 
 private:
     friend class ItemContainer;
+    ///@brief Sets the min size to the guest widget's
+    void updateMinSizeFromWidget();
+    ///@brief Applies the min size updates queued while usesCoalescedMinSizeUpdates is true
+    static void applyPendingMinSizeUpdates();
     void turnIntoPlaceholder();
-    bool eventFilter(QObject *o, QEvent *event) override;
     int m_refCount = 0;
+    bool m_minSizeUpdatePending = false;
+    QVector<ItemRefHolder*> m_refHolders;
     void updateObjectName();
     void onWidgetDestroyed();
+
+    ///@brief Emits xChanged()/yChanged() for this sub-tree, as its position relative to the root changed
+    void emitPositionChanged_recursive(bool xMoved, bool yMoved);
+
+    ///@brief Returns mapToRoot(QPoint(0, 0)). Cached until this item or one of its ancestors moves
+    QPoint rootOffset() const;
+
+    ///@brief Discards the cached root offsets of this sub-tree
+    void invalidateRootOffset_recursive();
+
+    ///@brief Discards the cached root() of this sub-tree
+    void invalidateRoot_recursive();
+
+    // Whether anyone, usually QML, is connected to the geometry signals. Most items have no
+    // listeners, so relayouts don't need to emit anything for them.
+    bool m_hasGeometryListeners = false;
     bool m_isVisible = false;
     QWidget *m_hostWidget = nullptr;
     GuestInterface *m_guest = nullptr;
+    QWidget *m_snapshot = nullptr; // See freezeGuest()
+    // Our index in m_parent->m_children, kept by ItemContainer::updateChildIndexes(). See indexOfChild()
+    int m_indexInParent = -1;
+    // See rootOffset(). If an item's offset isn't valid then neither are its descendants'
+    mutable QPoint m_rootOffset;
+    mutable bool m_rootOffsetValid = false;
+    // See root(). Same as above, only invalidated when an ancestor changes parent
+    mutable ItemContainer *m_root = nullptr;
+    mutable bool m_rootValid = false;
+    DirtyFlags m_dirtyFlags = DirtyFlag_All | DirtyFlag_Unchecked;
 };
 
 class ItemContainer : public Item {
@@ -436,20 +560,45 @@ public:
     void setOrientation(Qt::Orientation);
     QSize minSize() const override;
     QSize maxSize() const override;
+    bool isFixedOnParentResize() const override;
     void setSize_recursive(QSize newSize, ChildrenResizeStrategy strategy = ChildrenResizeStrategy::Percentage) override;
     int length() const;
     QRect rect() const;
     QVariantList items() const;
     void dumpLayout(int level = 0) override;
     void updateChildPercentages();
+    ///@brief Sets the lengths in @p childSizes so they add up to @p totalLength while keeping each
+    ///child's percentage, as far as their min and max lengths allow, using exact integer arithmetic
+    void distributeProportionally(SizingInfo::List &childSizes, int totalLength);
+    ///@brief Like distributeProportionally() but the children that are fixed on parent resize keep
+    ///their lengths. Returns false, without touching @p childSizes, if the others can't absorb the change
+    bool distributeKeepingFixedChildren(SizingInfo::List &childSizes, int totalLength);
+    ///@brief Sets the lengths in @p sizes so they add up to @p totalLength. Each length is within its
+    ///min and max and otherwise proportional to a weight: the percentageLength if @p proportional is
+    ///true, otherwise the same for all. Solved in a single pass, see the implementation.
+    void distributeWithinBounds(SizingInfo::List &sizes, int totalLength, bool proportional);
     void updateChildPercentages_recursive();
+
+    ///@brief Applies the geometries saved in @p map, by toVariantMap(), to this tree.
+    ///The tree must have the same structure as the saved one.
+    void restoreGeometries_recursive(const QVariantMap &map);
     void restoreChild(Item *,
                       NeighbourSqueezeStrategy neighbourSqueezeStrategy = NeighbourSqueezeStrategy::AllNeighbours);
+    ///@brief Restores several placeholders of this layout at once, which must already have their guests.
+    ///Unlike calling restoreChild() for each, every affected container shares out its length only once,
+    ///in proportion to the lengths its visible children have and the restored ones had before.
+    ///Call on the root container.
+    void restoreChildren(const Item::List &items);
     void updateWidgetGeometries() override;
     int oppositeLength() const;
 
     void requestSeparatorMove(Separator *separator, int delta);
     void requestEqualSize(Separator *separator);
+
+    ///@brief Calls freezeGuest() on every visible item of this sub-tree, for the duration of an interactive resize
+    void freezeGuests_recursive();
+    ///@brief The opposite of freezeGuests_recursive()
+    void thawGuests_recursive();
     void layoutEqually();
     void layoutEqually(SizingInfo::List &sizes);
     void layoutEqually_recursive();
@@ -487,18 +636,52 @@ public:
     int availableOnSide(const Item *child, Side) const;
     int availableOnSide_recursive(const Item *child, Side, Qt::Orientation orientation) const;
     void onChildMinSizeChanged(Item *child);
+    void onChildMaxSizeChanged(Item *child);
     void onChildVisibleChanged(Item *child, bool visible);
+
+    ///@brief Discards the cached minSize(), maxSize() and visible children of this container and of its ancestors
+    ///Needs to be called whenever the children, their visibility, or their constraints change.
+    void invalidateSizeCache();
     void updateSizeConstraints();
     SizingInfo::List sizes(bool ignoreBeingInserted = false) const;
-    QVector<int> calculateSqueezes(SizingInfo::List::ConstIterator begin,
-                                   SizingInfo::List::ConstIterator end, int needed,
-                                   NeighbourSqueezeStrategy, bool reversed = false) const;
+    ///@brief Like sizes(), but fills @p result instead, so sizing passes can reuse its capacity
+    void fillSizes(SizingInfo::List &result, bool ignoreBeingInserted = false) const;
+    ///@brief Like visibleChildren(), but fills @p result instead, so sizing passes can reuse its capacity
+    void fillVisibleChildren(Item::List &result, bool includeBeingInserted = false) const;
+    void calculateSqueezes(SizingInfo::List::ConstIterator begin,
+                           SizingInfo::List::ConstIterator end, int needed,
+                           NeighbourSqueezeStrategy, QVector<int> &squeezes,
+                           bool reversed = false) const;
     QRect suggestedDropRect(const Item *item, const Item *relativeTo, Location) const;
     QRect suggestedDropRectFallback(const Item *item, const Item *relativeTo, Location) const;
+    ///@brief Computes the suggestedDropRect() on SizingInfos alone, using only the container @p item
+    ///would go into. Returns a null rect if that container would need to grow, which resizes its ancestors.
+    QRect simulatedDropRect(const Item *item, const Item *relativeTo, Location) const;
+    ///@brief Computes the suggestedDropRect() by inserting @p item into a copy of the whole layout
+    QRect suggestedDropRectByCopy(const Item *item, const Item *relativeTo, Location) const;
     void positionItems();
     void positionItems_recursive();
     void positionItems(SizingInfo::List &sizes);
     void clear();
+
+    ///@brief Starts a batch of layout changes.
+    ///Until the matching commitBatch() only the SizingInfo of each item is updated. Guest widget
+    ///geometries and separators are only updated once, when the outer-most batch is committed.
+    ///Can be called on any container, it's forwarded to root().
+    void beginBatch();
+
+    ///@brief Ends a batch started with beginBatch()
+    void commitBatch();
+
+    ///@brief Starts tearing the layout down, for when clear() is about to discard it anyway.
+    ///Until clear(), removing items only takes them out of the tree: neighbours don't grow, empty
+    ///containers stay, nothing is laid out and no count signals are emitted.
+    ///Can be called on any container, it's forwarded to root().
+    void beginTeardown();
+
+    ///@brief Returns whether beginTeardown() was called and clear() wasn't yet
+    bool isTearingDown() const;
+
     Item* itemForWidget(const QWidget *w) const;
     int visibleCount_recursive() const override;
     int count_recursive() const;
@@ -527,7 +710,24 @@ public:
     QVariantMap toVariantMap() const override;
     void fillFromVariantMap(const QVariantMap &map, const QHash<QString, GuestInterface *> &widgets) override;
 
+    ///@brief Returns whether this layout has no host widget
+    ///Such layouts only do the geometry math, they don't have separators and don't
+    ///position any widgets. Useful to calculate layouts ahead of time.
     bool isDummy() const;
+
+    ///@brief Increases whenever children are added to, removed from or moved between any containers,
+    ///or when an item's guest changes. For caching what's derived from the item trees, like
+    ///MultiSplitterLayout's item indexes and frames.
+    static quint64 structureGeneration() { return s_structureGeneration; }
+
+    ///@brief The number of items from which the child sub-trees of a headless layout (see isDummy())
+    ///are resized on QThreadPool::globalInstance() workers, instead of one after the other.
+    ///They're independent once their sizes are fixed, so the result is the same. 0 disables it.
+    static int parallelLayoutThreshold;
+
+    ///@brief How many times this container positioned its children since it was created.
+    ///For finding which parts of a layout relayout the most.
+    quint64 numRelayouts() const { return m_numRelayouts; }
 #ifdef DOCKS_DEVELOPER_MODE
     bool test_suggestedRect();
 #endif
@@ -541,15 +741,31 @@ public:
     bool m_isResizing = false;
     bool m_blockUpdatePercentages = false;
     bool m_isDeserializing = false;
+    int m_batchDepth = 0;
+    bool m_isTearingDown = false; // Only set on root, see beginTeardown()
+    quint64 m_numRelayouts = 0;
     QVector<Layouting::Separator*> separators_recursive() const;
     QVector<Layouting::Separator*> separators() const;
     Qt::Orientation m_orientation = Qt::Vertical;
 private:
+    friend class Item; // For s_structureGeneration
     bool isOverflowing() const;
     void relayoutIfNeeded();
+    ///@brief Returns whether the children already tile this container, with no gaps or overlaps
+    ///and honouring their min sizes, recursively. Then a restored layout needs no relayout.
+    bool isTiledExactly() const;
     const Item *itemFromPath(const QVector<int> &path) const;
+    ///@brief Returns the index of @p item in m_children, or -1. Doesn't scan, each child knows its index
+    int indexOfChild(const Item *item) const;
+    ///@brief Updates the index each child knows it has, starting at @p from. Called whenever m_children changes
+    void updateChildIndexes(int from = 0);
     void resizeChildren(QSize oldSize, QSize newSize, SizingInfo::List &sizes, ChildrenResizeStrategy);
+    ///@brief applyGeometries() for the sub-trees of at least parallelLayoutThreshold items.
+    ///Returns false, doing nothing, if there aren't two of them or if the layout isn't headless.
+    bool applyGeometriesInParallel(const SizingInfo::List &sizes, ChildrenResizeStrategy);
     void scheduleCheckSanity() const;
+    ///@brief The check scheduled by scheduleCheckSanity(). Incremental if incrementalSanityChecks is set
+    void runScheduledCheckSanity();
     Separator *neighbourSeparator(const Item *item, Side, Qt::Orientation) const;
     Separator *neighbourSeparator_recursive(const Item *item, Side, Qt::Orientation) const;
     void updateWidgets_recursive();
@@ -557,10 +773,18 @@ private:
     QVector<int> requiredSeparatorPositions() const;
     void updateSeparators();
     void deleteSeparators();
-    Separator* separatorAt(int p) const;
     QVector<double> childPercentages() const;
+    void fillChildPercentages(QVector<double> &result) const;
     mutable bool m_checkSanityScheduled = false;
+    mutable QSize m_cachedMinSize;
+    mutable QSize m_cachedMaxSize;
+    mutable bool m_minSizeCacheValid = false;
+    mutable bool m_maxSizeCacheValid = false;
+    mutable Item::List m_visibleChildrenCache; // Sorted by position, used by itemAt()
+    mutable bool m_visibleChildrenCacheValid = false;
     QVector<Layouting::Separator*> m_separators;
+    static quint64 s_structureGeneration;
+    bool m_minSizeChangedInBatch = false;
     bool m_convertingItemToContainer = false;
 
     struct Private;
@@ -625,3 +849,5 @@ inline Side sideForLocation(Item::Location loc)
 }
 
 }
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(Layouting::Item::DirtyFlags)
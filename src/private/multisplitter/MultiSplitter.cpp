@@ -33,9 +33,19 @@
 #include "MainWindowBase.h"
 #include "FloatingWindow_p.h"
 #include "LayoutSaver.h"
+#include "Separator_p.h"
+#include "PointerInput_p.h"
 
 #include <QScopedValueRollback>
 
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+# include <QMouseEvent>
+# include <QPainter>
+# include <QPaintEvent>
+#else
+# include "quick/SeparatorsItemQuick_p.h"
+#endif
+
 using namespace KDDockWidgets;
 
 MultiSplitter::MultiSplitter(QWidgetOrQuick *parent)
@@ -52,6 +62,19 @@ MultiSplitter::MultiSplitter(QWidgetOrQuick *parent)
     });
 
     setMinimumSize(m_layout->minimumSize());
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (Layouting::Separator::usesHostPainting) {
+        setMouseTracking(true); // For the resize cursor
+        if (Layouting::Separator::usesNativeTouchInput)
+            setAttribute(Qt::WA_AcceptTouchEvents);
+    }
+#else
+    if (Layouting::Separator::usesHostPainting) {
+        m_separatorsItem = new SeparatorsItemQuick(m_layout, this);
+        m_separatorsItem->setSize(QSizeF(width(), height()));
+    }
+#endif
 }
 
 MultiSplitter::~MultiSplitter()
@@ -61,6 +84,10 @@ MultiSplitter::~MultiSplitter()
 void MultiSplitter::onLayoutRequest()
 {
     m_layout->updateSizeConstraints();
+#ifdef KDDOCKWIDGETS_QTQUICK
+    if (m_separatorsItem)
+        m_separatorsItem->update();
+#endif
 }
 
 bool MultiSplitter::onResize(QSize newSize)
@@ -70,17 +97,49 @@ bool MultiSplitter::onResize(QSize newSize)
 
     QScopedValueRollback<bool>(m_inResizeEvent, true); // to avoid re-entrancy
 
-    if (!LayoutSaver::restoreInProgress()) {
+    if (!LayoutSaver::restoreInProgress() && !m_resizeDeferred) {
         // don't resize anything while we're restoring the layout
         m_layout->setSize(newSize);
     }
 
+#ifdef KDDOCKWIDGETS_QTQUICK
+    if (m_separatorsItem) {
+        m_separatorsItem->setSize(newSize);
+        m_separatorsItem->update();
+    }
+#endif
+
     return false; // So QWidget::resizeEvent is called
 }
 
+void MultiSplitter::setResizeDeferred(bool deferred)
+{
+    if (deferred == m_resizeDeferred)
+        return;
+
+    m_resizeDeferred = deferred;
+    if (!deferred && !LayoutSaver::restoreInProgress() && m_layout->size() != size())
+        m_layout->setSize(size());
+}
+
+bool MultiSplitter::isResizeDeferred() const
+{
+    return m_resizeDeferred;
+}
+
 bool MultiSplitter::isInMainWindow() const
 {
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    // Called for every placeholder check, so cached. Invalidated when reparented, see event()
+    if (!m_isInMainWindowCached) {
+        m_isInMainWindow = mainWindow() != nullptr;
+        m_isInMainWindowCached = true;
+    }
+
+    return m_isInMainWindow;
+#else
     return mainWindow() != nullptr;
+#endif
 }
 
 MainWindowBase *MultiSplitter::mainWindow() const
@@ -98,3 +157,116 @@ FloatingWindow *MultiSplitter::floatingWindow() const
 {
     return qobject_cast<FloatingWindow*>(parentWidget());
 }
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+bool MultiSplitter::event(QEvent *ev)
+{
+    // The main window one is reparented into the central widget while being set up
+    if (ev->type() == QEvent::ParentChange)
+        m_isInMainWindowCached = false;
+
+    if (Layouting::Separator::usesHostPainting && Layouting::Separator::usesNativeTouchInput) {
+        const Layouting::PointerEvent pointerEvent = Layouting::PointerEvent::fromEvent(ev);
+        if (pointerEvent.phase == Layouting::PointerEvent::Phase_Press && !m_separatorBeingDragged) {
+            // Not accepted if there's no separator, so the children get mouse events synthesized from it
+            m_separatorBeingDragged = separatorAt(pointerEvent.pos.toPoint());
+            m_separatorDraggedByPointer = m_separatorBeingDragged != nullptr;
+        }
+
+        if (pointerEvent.phase != Layouting::PointerEvent::Phase_None && m_separatorDraggedByPointer) {
+            if (m_separatorBeingDragged)
+                m_separatorBeingDragged->onPointerEvent(pointerEvent, pointerEvent.pos.toPoint());
+
+            if (pointerEvent.phase == Layouting::PointerEvent::Phase_Release ||
+                pointerEvent.phase == Layouting::PointerEvent::Phase_Cancel) {
+                m_separatorBeingDragged = nullptr;
+                m_separatorDraggedByPointer = false;
+            }
+
+            ev->accept();
+            return true;
+        }
+    }
+
+    return QWidgetAdapter::event(ev);
+}
+
+Layouting::Separator *MultiSplitter::separatorAt(QPoint localPos) const
+{
+    if (!Layouting::Separator::usesHostPainting)
+        return nullptr;
+
+    const auto separators = m_layout->separators();
+    for (Layouting::Separator *separator : separators) {
+        if (separator->geometry().contains(localPos))
+            return separator;
+    }
+
+    return nullptr;
+}
+
+void MultiSplitter::paintEvent(QPaintEvent *ev)
+{
+    if (!Layouting::Separator::usesHostPainting)
+        return;
+
+    QPainter p(this);
+    const auto separators = m_layout->separators();
+    for (Layouting::Separator *separator : separators) {
+        if (ev->region().intersects(separator->geometry()))
+            separator->paintOnHost(&p);
+    }
+}
+
+void MultiSplitter::mousePressEvent(QMouseEvent *ev)
+{
+    if (ev->button() == Qt::LeftButton) {
+        if (Layouting::Separator *separator = separatorAt(ev->pos())) {
+            m_separatorBeingDragged = separator;
+            separator->onMousePressed();
+            return;
+        }
+    }
+
+    QWidgetAdapter::mousePressEvent(ev);
+}
+
+void MultiSplitter::mouseMoveEvent(QMouseEvent *ev)
+{
+    if (m_separatorBeingDragged) {
+        m_separatorBeingDragged->onMouseMoved(ev->pos(), ev->buttons());
+        return;
+    }
+
+    if (Layouting::Separator::usesHostPainting) {
+        Layouting::Separator *separator = separatorAt(ev->pos());
+        const Qt::CursorShape shape = separator ? (separator->isVertical() ? Qt::SizeVerCursor : Qt::SizeHorCursor)
+                                                : Qt::ArrowCursor;
+        if (cursor().shape() != shape)
+            setCursor(shape);
+    }
+
+    QWidgetAdapter::mouseMoveEvent(ev);
+}
+
+void MultiSplitter::mouseReleaseEvent(QMouseEvent *ev)
+{
+    if (m_separatorBeingDragged) {
+        m_separatorBeingDragged->onMouseReleased();
+        m_separatorBeingDragged = nullptr;
+        return;
+    }
+
+    QWidgetAdapter::mouseReleaseEvent(ev);
+}
+
+void MultiSplitter::mouseDoubleClickEvent(QMouseEvent *ev)
+{
+    if (Layouting::Separator *separator = separatorAt(ev->pos())) {
+        separator->onMouseDoubleClicked();
+        return;
+    }
+
+    QWidgetAdapter::mouseDoubleClickEvent(ev);
+}
+#endif
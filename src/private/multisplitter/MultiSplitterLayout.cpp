@@ -22,6 +22,7 @@
 #include "Logging_p.h"
 #include "MultiSplitter_p.h"
 #include "Frame_p.h"
+#include "FramePool_p.h"
 #include "DockWidgetBase.h"
 #include "Position_p.h"
 #include "DockRegistry_p.h"
@@ -118,6 +119,7 @@ void MultiSplitterLayout::addWidget(QWidgetOrQuick *w, Location location,
                                     Frame *relativeToWidget, DefaultSizeMode defaultSizeMode,
                                     AddingOption option)
 {
+    clearDropRectCache();
     auto frame = qobject_cast<Frame*>(w);
     qCDebug(addwidget) << Q_FUNC_INFO << w
                        << "; location=" << locationStr(location)
@@ -188,12 +190,14 @@ void MultiSplitterLayout::removeItem(Layouting::Item *item)
     if (!item)
         return;
 
+    clearDropRectCache();
     item->parentContainer()->removeItem(item);
 }
 
 bool MultiSplitterLayout::contains(const Layouting::Item *item) const
 {
-    return m_rootItem->contains_recursive(item);
+    // The root itself isn't one of our items
+    return item && item != m_rootItem && item->root() == m_rootItem;
 }
 
 bool MultiSplitterLayout::contains(const Frame *frame) const
@@ -248,7 +252,9 @@ Layouting::Item *MultiSplitterLayout::itemForFrame(const Frame *frame) const
     if (!frame)
         return nullptr;
 
-    return m_rootItem->itemForWidget(frame);
+    // The frame knows its item, but it might be in another layout, or a placeholder it left
+    Layouting::Item *item = frame->layoutItem();
+    return item && item->widget() == frame && contains(item) ? item : nullptr;
 }
 
 Frame::List MultiSplitterLayout::framesFrom(QWidgetOrQuick *frameOrMultiSplitter) const
@@ -264,23 +270,15 @@ Frame::List MultiSplitterLayout::framesFrom(QWidgetOrQuick *frameOrMultiSplitter
 
 Frame::List MultiSplitterLayout::frames() const
 {
-    const Layouting::Item::List items = m_rootItem->items_recursive();
-
-    Frame::List result;
-    result.reserve(items.size());
-
-    for (Layouting::Item *item : items) {
-        if (auto f = static_cast<Frame*>(item->widget()))
-            result.push_back(f);
-    }
-
-    return result;
+    ensureItems();
+    return m_frames;
 }
 
 void MultiSplitterLayout::restorePlaceholder(DockWidgetBase *dw, Layouting::Item *item, int tabIndex)
 {
+    clearDropRectCache();
     if (item->isPlaceholder()) {
-        Frame *newFrame = Config::self().frameworkWidgetFactory()->createFrame(multiSplitter());
+        Frame *newFrame = FramePool::self()->frame(multiSplitter());
         item->restore(newFrame);
     }
 
@@ -296,6 +294,42 @@ void MultiSplitterLayout::restorePlaceholder(DockWidgetBase *dw, Layouting::Item
     frame->setVisible(true);
 }
 
+void MultiSplitterLayout::restorePlaceholders(const QVector<DockWidgetBase*> &dockWidgets)
+{
+    clearDropRectCache();
+    beginBatch();
+    TitleBarVisibilityBatch titleBarBatch;
+
+    // All frames first, so the items are restored at once. Tabbed dock widgets share a placeholder.
+    Layouting::Item::List placeholders;
+    for (DockWidgetBase *dw : dockWidgets) {
+        Layouting::Item *item = dw->lastPositions().lastItem();
+        if (item->isPlaceholder() && !item->widget()) {
+            item->setGuest(FramePool::self()->frame(multiSplitter()));
+            placeholders.push_back(item);
+        }
+    }
+
+    m_rootItem->restoreChildren(placeholders);
+
+    for (DockWidgetBase *dw : dockWidgets) {
+        Layouting::Item *item = dw->lastPositions().lastItem();
+        auto frame = qobject_cast<Frame*>(item->widget());
+        Q_ASSERT(frame);
+
+        const int tabIndex = dw->lastPositions().lastTabIndex();
+        if (tabIndex != -1 && frame->dockWidgetCount() >= tabIndex) {
+            frame->insertWidget(dw, tabIndex);
+        } else {
+            frame->addWidget(dw);
+        }
+
+        frame->setVisible(true);
+    }
+
+    commitBatch();
+}
+
 void MultiSplitterLayout::layoutEqually()
 {
     layoutEqually(m_rootItem);
@@ -310,6 +344,16 @@ void MultiSplitterLayout::layoutEqually(Layouting::ItemContainer *container)
     }
 }
 
+void MultiSplitterLayout::beginBatch()
+{
+    m_rootItem->beginBatch();
+}
+
+void MultiSplitterLayout::commitBatch()
+{
+    m_rootItem->commitBatch();
+}
+
 bool MultiSplitterLayout::checkSanity() const
 {
     return m_rootItem->checkSanity();
@@ -356,6 +400,8 @@ void MultiSplitterLayout::setMinimumSize(QSize sz)
 
 void MultiSplitterLayout::setRootItem(Layouting::ItemContainer *root)
 {
+    clearDropRectCache();
+    m_indexedGeneration = 0;
     delete m_rootItem;
     m_rootItem = root;
     connect(m_rootItem, &Layouting::ItemContainer::numVisibleItemsChanged,
@@ -367,7 +413,54 @@ void MultiSplitterLayout::setRootItem(Layouting::ItemContainer *root)
 
 const Layouting::Item::List MultiSplitterLayout::items() const
 {
-    return m_rootItem->items_recursive();
+    ensureItems();
+    return m_items;
+}
+
+int MultiSplitterLayout::indexOfItem(const Layouting::Item *item) const
+{
+    ensureItemIndexes();
+    return m_itemIndexes.value(item, -1);
+}
+
+Layouting::Item *MultiSplitterLayout::itemAtIndex(int index) const
+{
+    ensureItemIndexes();
+    return index >= 0 && index < m_items.size() ? m_items.at(index) : nullptr;
+}
+
+void MultiSplitterLayout::ensureItems() const
+{
+    // The generation is global, so a change in another layout invalidates ours too, which is
+    // fine, it's only bumped by structural changes, not by resizes or separator moves
+    if (m_itemsGeneration == Layouting::ItemContainer::structureGeneration())
+        return;
+
+    m_items = m_rootItem->items_recursive();
+    Frame::List frames;
+    frames.reserve(m_items.size());
+    for (Layouting::Item *item : qAsConst(m_items)) {
+        if (auto f = static_cast<Frame*>(item->widget()))
+            frames.push_back(f);
+    }
+
+    m_frames = frames;
+    m_itemsGeneration = Layouting::ItemContainer::structureGeneration();
+}
+
+void MultiSplitterLayout::ensureItemIndexes() const
+{
+    // Saving and restoring don't interleave structural changes with the lookups
+    if (m_indexedGeneration == Layouting::ItemContainer::structureGeneration())
+        return;
+
+    ensureItems();
+    m_itemIndexes.clear();
+    m_itemIndexes.reserve(m_items.size());
+    for (int i = 0; i < m_items.size(); ++i)
+        m_itemIndexes.insert(m_items.at(i), i);
+
+    m_indexedGeneration = Layouting::ItemContainer::structureGeneration();
 }
 
 Layouting::ItemContainer *MultiSplitterLayout::rootItem() const
@@ -375,24 +468,60 @@ Layouting::ItemContainer *MultiSplitterLayout::rootItem() const
     return m_rootItem;
 }
 
+// One drag hovers a handful of items and locations, a hovered widget resizing adds a few more
+static const int s_maxCachedDropRects = 64;
+
 QRect MultiSplitterLayout::rectForDrop(const QWidgetOrQuick *widget, Location location,
                                        const Layouting::Item *relativeTo) const
 {
-    Layouting::Item item(nullptr);
-    item.setSize(widget->size());
-    item.setMinSize(Layouting::widgetMinSize(widget));
-    item.setMaxSize(widget->maximumSize());
-
     Layouting::ItemContainer *container = relativeTo ? relativeTo->parentContainer()
                                                      : m_rootItem;
 
-    return container->suggestedDropRect(&item, relativeTo, Layouting::Item::Location(location));
+    // Called on each mouse move while hovering, but the simulated insertion is expensive
+    const quint64 generation = Layouting::ItemContainer::structureGeneration();
+    if (m_dropRectGeneration != generation || m_dropRectCache.size() >= s_maxCachedDropRects) {
+        // Entries from before the structure changed can't match anymore
+        m_dropRectCache.clear();
+        m_dropRectGeneration = generation;
+    }
+
+    DropRectKey key;
+    key.relativeTo = relativeTo;
+    key.location = location;
+    key.size = widget->size();
+    key.minSize = Layouting::widgetMinSize(widget);
+    key.maxSize = widget->maximumSize();
+    key.containerGeometry = container->geometry();
+    key.relativeToGeometry = relativeTo ? relativeTo->geometry() : QRect();
+    key.containerChildCount = container->numChildren();
+
+    auto it = m_dropRectCache.constFind(key);
+    if (it != m_dropRectCache.cend())
+        return *it;
+
+    Layouting::Item item(nullptr);
+    item.setSize(key.size);
+    item.setMinSize(key.minSize);
+    item.setMaxSize(key.maxSize);
+
+    const QRect result = container->suggestedDropRect(&item, relativeTo, Layouting::Item::Location(location));
+    m_dropRectCache.insert(key, result);
+    return result;
+}
+
+void MultiSplitterLayout::clearDropRectCache()
+{
+    m_dropRectCache.clear();
 }
 
 bool MultiSplitterLayout::deserialize(const LayoutSaver::MultiSplitterLayout &l)
 {
     setRootItem(new Layouting::ItemContainer(m_multiSplitter));
 
+    // The tree is resized several times while restoring, but there's no point in moving the
+    // frames around until we know their final geometry
+    beginBatch();
+
     QHash<QString, Layouting::GuestInterface*> frames;
     for (const LayoutSaver::Frame &frame : qAsConst(l.frames)) {
         Frame *f = Frame::deserialize(frame);
@@ -405,9 +534,91 @@ bool MultiSplitterLayout::deserialize(const LayoutSaver::MultiSplitterLayout &l)
     updateSizeConstraints();
     m_rootItem->setSize_recursive(multiSplitter()->size());
 
+    commitBatch();
+
     return true;
 }
 
+static bool sameStructure(Layouting::Item *item, const QVariantMap &map,
+                          const QHash<QString, LayoutSaver::Frame> &frames)
+{
+    if (item->isContainer() != map.value(QStringLiteral("isContainer")).toBool())
+        return false;
+
+    if (auto container = item->asContainer()) {
+        const QVariantList childrenV = map.value(QStringLiteral("children")).toList();
+        const Layouting::Item::List children = container->childItems();
+        if (container->orientation() != Qt::Orientation(map.value(QStringLiteral("orientation")).toInt()) ||
+            children.size() != childrenV.size())
+            return false;
+
+        for (int i = 0; i < children.size(); ++i) {
+            if (!sameStructure(children.at(i), childrenV.at(i).toMap(), frames))
+                return false;
+        }
+
+        return true;
+    }
+
+    if (item->isVisible() != map.value(QStringLiteral("isVisible")).toBool())
+        return false;
+
+    // Frames are matched by their contents, as they might have been recreated since saving
+    auto frame = qobject_cast<Frame*>(item->widget());
+    const QString guestId = map.value(QStringLiteral("guestId")).toString();
+    if (guestId.isEmpty() || !frame)
+        return guestId.isEmpty() && !frame;
+
+    auto it = frames.constFind(guestId);
+    if (it == frames.cend() || frame->options() != FrameOptions(it->options))
+        return false;
+
+    const DockWidgetBase::List docks = frame->dockWidgets();
+    if (docks.size() != it->dockWidgets.size())
+        return false;
+
+    for (int i = 0; i < docks.size(); ++i) {
+        if (docks.at(i)->uniqueName() != it->dockWidgets.at(i)->uniqueName)
+            return false;
+    }
+
+    return true;
+}
+
+bool MultiSplitterLayout::hasSameStructure(const LayoutSaver::MultiSplitterLayout &l) const
+{
+    return sameStructure(m_rootItem, l.layout, l.frames);
+}
+
+static void restoreCurrentTabs(Layouting::Item *item, const QVariantMap &map,
+                               const QHash<QString, LayoutSaver::Frame> &frames)
+{
+    if (auto container = item->asContainer()) {
+        const QVariantList childrenV = map.value(QStringLiteral("children")).toList();
+        const Layouting::Item::List children = container->childItems();
+        for (int i = 0; i < children.size() && i < childrenV.size(); ++i)
+            restoreCurrentTabs(children.at(i), childrenV.at(i).toMap(), frames);
+    } else if (auto frame = qobject_cast<Frame*>(item->widget())) {
+        auto it = frames.constFind(map.value(QStringLiteral("guestId")).toString());
+        if (it != frames.cend())
+            frame->setCurrentTabIndex(it->currentTabIndex);
+    }
+}
+
+void MultiSplitterLayout::deserializeInPlace(const LayoutSaver::MultiSplitterLayout &l)
+{
+    // Frames only move once, when the batch is committed
+    beginBatch();
+
+    m_rootItem->restoreGeometries_recursive(l.layout);
+    restoreCurrentTabs(m_rootItem, l.layout, l.frames);
+
+    updateSizeConstraints();
+    m_rootItem->setSize_recursive(multiSplitter()->size());
+
+    commitBatch();
+}
+
 LayoutSaver::MultiSplitterLayout MultiSplitterLayout::serialize() const
 {
     LayoutSaver::MultiSplitterLayout l;
@@ -39,6 +39,7 @@
 #include "LayoutSaver_p.h"
 #include "QWidgetAdapter.h"
 
+#include <QHash>
 #include <QPointer>
 
 namespace Layouting {
@@ -134,9 +135,22 @@ public:
 
     /**
      * @brief The list of items in this layout.
+     * Kept until the layout structure changes, so it's shared instead of rebuilt on each call.
      */
     const QVector<Layouting::Item*> items() const;
 
+    /**
+     * @brief Returns the index of @p item in items(), or -1 if it's not in this layout.
+     * The indexes are cached until the item tree changes, so calling it for every placeholder
+     * when saving is linear overall.
+     */
+    int indexOfItem(const Layouting::Item *item) const;
+
+    /**
+     * @brief Returns the item at @p index in items(), or nullptr if out of range. See indexOfItem().
+     */
+    Layouting::Item *itemAtIndex(int index) const;
+
     /**
      * @brief Returns the root container item
      */
@@ -147,12 +161,28 @@ public:
      * The rect for the rubberband when dropping a widget at the specified location.
      * Excludes the Separator thickness, result is actually smaller than what needed. In other words,
      * the result will be exactly the same as the geometry the widget will get.
+     *
+     * Results are memoized until the layout changes, or until @ref clearDropRectCache() is called.
      */
     QRect rectForDrop(const QWidgetOrQuick *widget, KDDockWidgets::Location location, const Layouting::Item *relativeTo) const;
 
+    ///@brief Forgets the rects memoized by @ref rectForDrop(). Called when a drag enters or leaves.
+    void clearDropRectCache();
+
+#ifdef DOCKS_DEVELOPER_MODE
+    int dbg_numCachedDropRects() const { return m_dropRectCache.size(); }
+#endif
+
     bool deserialize(const LayoutSaver::MultiSplitterLayout &);
     LayoutSaver::MultiSplitterLayout serialize() const;
 
+    ///@brief Returns whether @p l has the same items, frames and tabs as this layout, ignoring geometries
+    bool hasSameStructure(const LayoutSaver::MultiSplitterLayout &l) const;
+
+    ///@brief Restores only the geometries and current tabs of @p l, which must have the same structure
+    ///as this layout. See hasSameStructure().
+    void deserializeInPlace(const LayoutSaver::MultiSplitterLayout &l);
+
     ///@brief returns the list of separators
     QVector<Layouting::Separator*> separators() const;
 
@@ -205,18 +235,35 @@ public:
 
     /**
      * @brief Returns a list of Frame objects contained in this layout
+     * Kept until the layout structure changes, like items().
      */
     QList<Frame*> frames() const;
 
     /// @brief restores the dockwidget @p dw to its previous position
     void restorePlaceholder(DockWidgetBase *dw, Layouting::Item *, int tabIndex);
 
+    /// @brief restores each dock widget of @p dockWidgets to its previous position, like restorePlaceholder().
+    /// The placeholders are restored together, so each container redistributes its space only once
+    void restorePlaceholders(const QVector<DockWidgetBase*> &dockWidgets);
+
     /// @brief See docs for MainWindowBase::layoutEqually()
     void layoutEqually();
 
     /// @brief overload that just resizes widgets within a sub-tree
     void layoutEqually(Layouting::ItemContainer *);
 
+    /**
+     * @brief Starts a layout transaction.
+     *
+     * Until the matching @ref commitBatch() adding or removing widgets only updates the item tree.
+     * Separators and Frame geometries are updated once, when the batch is committed.
+     * Useful when adding many dock widgets programmatically. Calls can be nested.
+     */
+    void beginBatch();
+
+    /// @brief Ends the transaction started by @ref beginBatch()
+    void commitBatch();
+
 Q_SIGNALS:
     void visibleWidgetCountChanged(int count);
 
@@ -276,6 +323,50 @@ private:
 
     MultiSplitter *const m_multiSplitter;
     Layouting::ItemContainer *m_rootItem = nullptr;
+
+    // Memoized rectForDrop() results. The geometries catch layout changes we weren't told about.
+    struct DropRectKey {
+        const Layouting::Item *relativeTo;
+        KDDockWidgets::Location location;
+        QSize size;
+        QSize minSize;
+        QSize maxSize;
+        QRect containerGeometry;
+        QRect relativeToGeometry;
+        int containerChildCount;
+
+        bool operator==(const DropRectKey &other) const
+        {
+            return relativeTo == other.relativeTo && location == other.location && size == other.size
+                   && minSize == other.minSize && maxSize == other.maxSize
+                   && containerGeometry == other.containerGeometry
+                   && relativeToGeometry == other.relativeToGeometry
+                   && containerChildCount == other.containerChildCount;
+        }
+
+        friend uint qHash(const DropRectKey &key, uint seed = 0)
+        {
+            const int values[] = { int(key.location), key.size.width(), key.size.height(),
+                                   key.minSize.width(), key.minSize.height(),
+                                   key.maxSize.width(), key.maxSize.height(),
+                                   key.containerGeometry.x(), key.containerGeometry.y(),
+                                   key.containerGeometry.width(), key.containerGeometry.height(),
+                                   key.relativeToGeometry.x(), key.relativeToGeometry.y(),
+                                   key.relativeToGeometry.width(), key.relativeToGeometry.height(),
+                                   key.containerChildCount };
+            return qHashBits(values, sizeof(values), seed) ^ qHash(key.relativeTo, seed);
+        }
+    };
+    mutable QHash<DropRectKey, QRect> m_dropRectCache;
+    mutable quint64 m_dropRectGeneration = 0; // Layouting::ItemContainer::structureGeneration()
+
+    void ensureItems() const;
+    void ensureItemIndexes() const;
+    mutable QVector<Layouting::Item*> m_items; // items(), as of m_itemsGeneration
+    mutable QList<Frame*> m_frames;
+    mutable quint64 m_itemsGeneration = 0;
+    mutable QHash<const Layouting::Item*, int> m_itemIndexes;
+    mutable quint64 m_indexedGeneration = 0;
 };
 
 }
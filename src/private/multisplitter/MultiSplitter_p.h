@@ -32,11 +32,18 @@
 #include "docks_export.h"
 #include "QWidgetAdapter.h"
 
+#include <QPointer>
+
+namespace Layouting {
+class Separator;
+}
+
 namespace KDDockWidgets {
 
 class MultiSplitterLayout;
 class MainWindowBase;
 class FloatingWindow;
+class SeparatorsItemQuick;
 
 /**
  * @brief A widget that supports an arbitrary number of splitters (called Separators) in any
@@ -54,12 +61,40 @@ public:
     bool isInMainWindow() const;
     MainWindowBase* mainWindow() const;
     FloatingWindow* floatingWindow() const;
+
+    /**
+     * @brief While deferred, resizing this widget doesn't resize the layout
+     * Undeferring resizes the layout once, to the current size. See DockRegistry::deferResizeForScreenChange()
+     */
+    void setResizeDeferred(bool deferred);
+    bool isResizeDeferred() const;
 protected:
     void onLayoutRequest() override;
     bool onResize(QSize newSize) override;
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    bool event(QEvent *) override;
+
+    // For Config::Flag_HostPaintedSeparators. The separators are hidden, we paint them and route their mouse events
+    void paintEvent(QPaintEvent *) override;
+    void mousePressEvent(QMouseEvent *) override;
+    void mouseMoveEvent(QMouseEvent *) override;
+    void mouseReleaseEvent(QMouseEvent *) override;
+    void mouseDoubleClickEvent(QMouseEvent *) override;
+#endif
     MultiSplitterLayout *const m_layout;
 private:
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    ///@brief Returns the separator at @p localPos, if host painting separators
+    Layouting::Separator *separatorAt(QPoint localPos) const;
+    QPointer<Layouting::Separator> m_separatorBeingDragged;
+    bool m_separatorDraggedByPointer = false; // By touch or pen, see Separator::usesNativeTouchInput
+    mutable bool m_isInMainWindowCached = false;
+    mutable bool m_isInMainWindow = false;
+#else
+    SeparatorsItemQuick *m_separatorsItem = nullptr; // For Config::Flag_HostPaintedSeparators
+#endif
     bool m_inResizeEvent = false;
+    bool m_resizeDeferred = false;
 };
 
 }
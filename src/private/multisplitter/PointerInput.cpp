@@ -0,0 +1,103 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PointerInput_p.h"
+
+#include <QTabletEvent>
+#include <QTouchEvent>
+
+using namespace Layouting;
+
+int MotionPredictor::predictionInterval = 0;
+
+PointerEvent PointerEvent::fromEvent(QEvent *e)
+{
+    PointerEvent result;
+    switch (e->type()) {
+    case QEvent::TouchBegin:
+    case QEvent::TouchUpdate:
+    case QEvent::TouchEnd:
+    case QEvent::TouchCancel: {
+        auto te = static_cast<QTouchEvent*>(e);
+        if (!te->touchPoints().isEmpty()) {
+            const QTouchEvent::TouchPoint &point = te->touchPoints().constFirst();
+            result.pos = point.pos();
+            result.globalPos = point.screenPos();
+        } else if (e->type() != QEvent::TouchCancel) {
+            return result;
+        }
+        result.timestamp = te->timestamp();
+        result.phase = e->type() == QEvent::TouchBegin ? Phase_Press
+                     : e->type() == QEvent::TouchUpdate ? Phase_Move
+                     : e->type() == QEvent::TouchEnd ? Phase_Release
+                                                     : Phase_Cancel;
+        break;
+    }
+    case QEvent::TabletPress:
+    case QEvent::TabletMove:
+    case QEvent::TabletRelease: {
+        auto te = static_cast<QTabletEvent*>(e);
+        // Pens hovering over the tablet send moves too, those are for the cursor only
+        if (e->type() == QEvent::TabletMove && !(te->buttons() & Qt::LeftButton))
+            return result;
+        if (e->type() != QEvent::TabletMove && te->button() != Qt::LeftButton)
+            return result;
+
+        result.pos = te->posF();
+        result.globalPos = te->globalPosF();
+        result.timestamp = te->timestamp();
+        result.phase = e->type() == QEvent::TabletPress ? Phase_Press
+                     : e->type() == QEvent::TabletMove ? Phase_Move
+                                                       : Phase_Release;
+        break;
+    }
+    default:
+        break;
+    }
+
+    return result;
+}
+
+void MotionPredictor::reset()
+{
+    m_velocity = QPointF();
+    m_numSamples = 0;
+}
+
+void MotionPredictor::addSample(QPointF globalPos, unsigned long timestamp)
+{
+    if (m_numSamples > 0 && timestamp > m_lastTimestamp) {
+        const QPointF velocity = (globalPos - m_lastPos) / double(timestamp - m_lastTimestamp);
+        // Smoothed, a single noisy sample shouldn't throw the prediction off
+        m_velocity = m_numSamples == 1 ? velocity : (m_velocity + velocity) / 2;
+    }
+
+    m_lastPos = globalPos;
+    m_lastTimestamp = timestamp;
+    m_numSamples++;
+}
+
+QPoint MotionPredictor::predicted(QPoint pos) const
+{
+    if (predictionInterval <= 0 || m_numSamples < 2)
+        return pos;
+
+    return pos + (m_velocity * predictionInterval).toPoint();
+}
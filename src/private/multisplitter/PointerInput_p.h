@@ -0,0 +1,87 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KD_DOCKWIDGETS_MULTISPLITTER_POINTERINPUT_P_H
+#define KD_DOCKWIDGETS_MULTISPLITTER_POINTERINPUT_P_H
+
+#include <QPointF>
+
+QT_BEGIN_NAMESPACE
+class QEvent;
+QT_END_NAMESPACE
+
+namespace Layouting {
+
+/**
+ * @brief A touch or pen event, reduced to what dragging needs.
+ *
+ * Touch screens and tablets send many more samples than mice do. Separators, dock widget drags
+ * and floating window resizes handle them natively, instead of through the synthesized mouse
+ * events, so they can compress them to one layout pass per event loop iteration.
+ */
+struct PointerEvent
+{
+    enum Phase {
+        Phase_None = 0, ///< Not a touch or tablet event
+        Phase_Press,
+        Phase_Move,
+        Phase_Release,
+        Phase_Cancel ///< The touch sequence was taken away, for example by the window manager
+    };
+
+    ///@brief Returns the event for @p e, with Phase_None if it's not a touch or tablet event.
+    ///Touch events only use their first touch point.
+    static PointerEvent fromEvent(QEvent *e);
+
+    Phase phase = Phase_None;
+    QPointF pos; ///< In the receiving widget's coordinates
+    QPointF globalPos;
+    unsigned long timestamp = 0; ///< In ms
+};
+
+/**
+ * @brief Extrapolates where the pointer will be, from the velocity of the latest samples.
+ *
+ * Layout passes lag behind the pointer by about a frame. For touch and pen drags, aiming where the
+ * finger will be by then hides some of it. See predictionInterval.
+ */
+class MotionPredictor
+{
+public:
+    ///@brief By how many ms to extrapolate. 0 by default, which disables prediction.
+    static int predictionInterval;
+
+    void reset();
+    void addSample(QPointF globalPos, unsigned long timestamp);
+
+    ///@brief Returns @p pos moved by predictionInterval ms along the current velocity.
+    ///Returns @p pos as is if there's less than two samples since reset().
+    QPoint predicted(QPoint pos) const;
+
+private:
+    QPointF m_lastPos;
+    QPointF m_velocity; // In pixels per ms
+    unsigned long m_lastTimestamp = 0;
+    int m_numSamples = 0;
+};
+
+}
+
+#endif
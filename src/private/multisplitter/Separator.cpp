@@ -21,10 +21,15 @@
 #include "Separator_p.h"
 #include "Logging_p.h" // TODO: Have our own
 #include "Item_p.h"
+#include "Tracing_p.h"
+#include "PointerInput_p.h"
 
 #include <QMouseEvent>
 #include <QRubberBand>
 #include <QApplication>
+#include <QTimer>
+#include <QHash>
+#include <QPointer>
 
 #ifdef Q_OS_WIN
 # include <windows.h>
@@ -35,7 +40,30 @@ using namespace Layouting;
 Separator* Separator::s_separatorBeingDragged = nullptr;
 
 static SeparatorFactoryFunc s_separatorFactoryFunc = nullptr;
+
+// Separators that aren't in use, per host. Enough to cover showing and hiding a few dock widgets.
+// Deleted with the application, while hosts, and their separators, can still be alive.
+typedef QHash<QWidget*, Separator::List> RecycledSeparators;
+static RecycledSeparators *s_recycledSeparators = nullptr;
+
+static RecycledSeparators &recycledSeparators()
+{
+    if (!s_recycledSeparators) {
+        s_recycledSeparators = new RecycledSeparators();
+        QObject::connect(qApp, &QObject::destroyed, [] {
+            delete s_recycledSeparators;
+            s_recycledSeparators = nullptr;
+        });
+    }
+
+    return *s_recycledSeparators;
+}
+static const int s_maxRecycledPerHost = 8;
 bool Separator::usesLazyResize = false;
+bool Separator::usesCoalescedMoves = false;
+bool Separator::usesHostPainting = false;
+bool Separator::usesSnapshotResize = false;
+bool Separator::usesNativeTouchInput = false;
 
 struct Separator::Private {
     // Only set when anchor is moved through mouse. Side1 if going towards left or top, Side2 otherwise.
@@ -47,16 +75,67 @@ struct Separator::Private {
     QRubberBand *lazyResizeRubberBand = nullptr;
     ItemContainer *parentContainer = nullptr;
     Layouting::Side lastMoveDirection = Side1;
+
+    // Only used with usesCoalescedMoves. The position the mouse moved to, which the layout
+    // didn't catch up with yet
+    int pendingPosition = 0;
+    bool hasPendingMove = false;
+    QTimer pendingMoveTimer;
+
+    // Only valid while being dragged, see minPosition()
+    int minPos = 0;
+    int maxPos = 0;
+    bool dragBoundsValid = false;
+
+    // Only used with usesNativeTouchInput. Whether the drag is from a touch screen or a pen
+    bool highFrequencyInput = false;
+    MotionPredictor predictor;
+
+    // The host whose pool this separator is in, if it was recycled
+    QWidget *recycledFor = nullptr;
+
+    // Only used with usesSnapshotResize. The layout whose guests were frozen when the drag started
+    QPointer<ItemContainer> frozenRoot;
+
+    void thawGuests()
+    {
+        if (frozenRoot)
+            frozenRoot->thawGuests_recursive();
+        frozenRoot = nullptr;
+    }
 };
 
 Separator::Separator(QWidget *hostWidget)
     : QWidget(hostWidget)
     , d(new Private())
 {
+    d->pendingMoveTimer.setSingleShot(true);
+    d->pendingMoveTimer.setInterval(0);
+    connect(&d->pendingMoveTimer, &QTimer::timeout, this, &Separator::applyPendingMove);
+    if (usesNativeTouchInput)
+        setAttribute(Qt::WA_AcceptTouchEvents);
+    Tracing::counters().separatorsCreated++;
 }
 
 Separator::~Separator()
 {
+    Tracing::counters().separatorsDestroyed++;
+    if (d->recycledFor) {
+        // Our host is being deleted, or the pool is being trimmed
+        if (s_recycledSeparators) {
+            auto it = s_recycledSeparators->find(d->recycledFor);
+            if (it != s_recycledSeparators->end()) {
+                it->removeOne(this);
+                if (it->isEmpty())
+                    s_recycledSeparators->erase(it);
+            }
+        }
+    } else if (usesHostPainting && hostWidget()) {
+        hostWidget()->update(QWidget::geometry());
+    }
+
+    // Deleted mid drag, or instead of being recycled. The guests mustn't stay frozen.
+    d->thawGuests();
     delete d;
     if (isBeingDragged())
         s_separatorBeingDragged = nullptr;
@@ -69,11 +148,14 @@ bool Separator::isVertical() const
 
 void Separator::move(int p)
 {
+    const QRect oldGeometry = QWidget::geometry();
     if (isVertical()) {
         QWidget::move(x(), p);
     } else {
         QWidget::move(p, y());
     }
+
+    updateHost(oldGeometry);
 }
 
 Qt::Orientation Separator::orientation() const
@@ -82,53 +164,75 @@ Qt::Orientation Separator::orientation() const
 }
 
 void Separator::mousePressEvent(QMouseEvent *)
+{
+    onMousePressed();
+}
+
+void Separator::onMousePressed()
 {
     s_separatorBeingDragged = this;
+    d->dragBoundsValid = false;
+    updateDragBounds();
 
     qCDebug(separators) << "Drag started";
 
     if (d->lazyResizeRubberBand) {
         setLazyPosition(position());
         d->lazyResizeRubberBand->show();
+    } else if (usesSnapshotResize && d->parentContainer) {
+        // The move can propagate to the ancestors, so the whole layout is frozen
+        d->frozenRoot = d->parentContainer->root();
+        d->frozenRoot->freezeGuests_recursive();
     }
 }
 
 void Separator::mouseMoveEvent(QMouseEvent *ev)
+{
+    onMouseMoved(mapToParent(ev->pos()), ev->buttons());
+}
+
+void Separator::onMouseMoved(QPoint hostPos, Qt::MouseButtons buttons)
 {
     if (!isBeingDragged())
         return;
 
-    if (!(qApp->mouseButtons() & Qt::LeftButton)) {
+    // The event's buttons, not QGuiApplication::mouseButtons(), which synthesized events don't update
+    if (!(buttons & Qt::LeftButton)) {
         qCDebug(separators) << Q_FUNC_INFO << "Ignoring spurious mouse event. Someone ate our ReleaseEvent";
         onMouseReleased();
         return;
     }
 
 #ifdef Q_OS_WIN
-    // Try harder, Qt can be wrong, if mixed with MFC
+    // Try harder, Qt can be wrong, if mixed with MFC. Touch and pens don't press the mouse buttons though.
     const bool mouseButtonIsReallyDown = (GetKeyState(VK_LBUTTON) & 0x8000) || (GetKeyState(VK_RBUTTON) & 0x8000);
-    if (!mouseButtonIsReallyDown) {
+    if (!mouseButtonIsReallyDown && !d->highFrequencyInput) {
         qCDebug(separators) << Q_FUNC_INFO << "Ignoring spurious mouse event. Someone ate our ReleaseEvent";
         onMouseReleased();
         return;
     }
 #endif
 
-    const int positionToGoTo = Layouting::pos(mapToParent(ev->pos()), d->orientation);
-    const int minPos = d->parentContainer->minPosForSeparator_global(this);
-    const int maxPos = d->parentContainer->maxPosForSeparator_global(this);
-
-    if (positionToGoTo < minPos || positionToGoTo > maxPos)
+    const int positionToGoTo = Layouting::pos(hostPos, d->orientation);
+    if (positionToGoTo < minPosition() || positionToGoTo > maxPosition())
         return;
 
     d->lastMoveDirection = positionToGoTo < position() ? Side1
                                                        : (positionToGoTo > position() ? Side2
                                                                                       : Side2); // Last case shouldn't happen though.
 
-    if (d->lazyResizeRubberBand)
+    if (d->lazyResizeRubberBand) {
         setLazyPosition(positionToGoTo);
-    else
+    } else if (usesCoalescedMoves || d->highFrequencyInput) {
+        // The separator follows the mouse right away, the layout catches up on the next event loop iteration
+        d->pendingPosition = positionToGoTo;
+        d->hasPendingMove = true;
+        move(positionToGoTo);
+        if (!d->pendingMoveTimer.isActive())
+            d->pendingMoveTimer.start();
+    } else {
         d->parentContainer->requestSeparatorMove(this, positionToGoTo - position());
+    }
 }
 
 void Separator::mouseReleaseEvent(QMouseEvent *)
@@ -136,7 +240,54 @@ void Separator::mouseReleaseEvent(QMouseEvent *)
     onMouseReleased();
 }
 
+bool Separator::event(QEvent *e)
+{
+    if (usesNativeTouchInput) {
+        const PointerEvent pointerEvent = PointerEvent::fromEvent(e);
+        if (pointerEvent.phase != PointerEvent::Phase_None) {
+            // Accepted, so Qt doesn't synthesize mouse events from it too
+            onPointerEvent(pointerEvent, mapToParent(pointerEvent.pos.toPoint()));
+            e->accept();
+            return true;
+        }
+    }
+
+    return QWidget::event(e);
+}
+
+void Separator::onPointerEvent(const PointerEvent &ev, QPoint hostPos)
+{
+    switch (ev.phase) {
+    case PointerEvent::Phase_Press:
+        d->highFrequencyInput = true;
+        d->predictor.reset();
+        d->predictor.addSample(ev.globalPos, ev.timestamp);
+        onMousePressed();
+        break;
+    case PointerEvent::Phase_Move:
+        d->predictor.addSample(ev.globalPos, ev.timestamp);
+        onMouseMoved(d->predictor.predicted(hostPos), Qt::LeftButton);
+        break;
+    case PointerEvent::Phase_Release:
+        // Ends where the pointer really is, not where it was predicted to go
+        d->predictor.reset();
+        onMouseMoved(hostPos, Qt::LeftButton);
+        onMouseReleased();
+        break;
+    case PointerEvent::Phase_Cancel:
+        onMouseReleased();
+        break;
+    case PointerEvent::Phase_None:
+        break;
+    }
+}
+
 void Separator::mouseDoubleClickEvent(QMouseEvent *)
+{
+    onMouseDoubleClicked();
+}
+
+void Separator::onMouseDoubleClicked()
 {
     // a double click means we'll resize the left and right neighbour so that they occupy
     // the same size (or top/bottom, depending on orientation).
@@ -150,18 +301,58 @@ void Separator::onMouseReleased()
         d->parentContainer->requestSeparatorMove(this, d->lazyPosition - position());
     }
 
+    d->pendingMoveTimer.stop();
+    applyPendingMove();
+    d->thawGuests();
+
     s_separatorBeingDragged = nullptr;
+    d->dragBoundsValid = false;
+    d->highFrequencyInput = false;
+}
+
+void Separator::applyPendingMove()
+{
+    if (!d->hasPendingMove)
+        return;
+
+    d->hasPendingMove = false;
+    d->parentContainer->requestSeparatorMove(this, d->pendingPosition - position());
+
+    // The layout might not have honoured the whole move, due to min-size constraints
+    if (QWidget::geometry() != d->geometry) {
+        const QRect oldGeometry = QWidget::geometry();
+        Tracing::counters().widgetGeometryChanges++;
+        QWidget::setGeometry(d->geometry);
+        updateHost(oldGeometry);
+    }
 }
 
 void Separator::setGeometry(QRect r)
 {
     if (r != d->geometry) {
+        const QRect oldGeometry = QWidget::geometry();
         d->geometry = r;
-        QWidget::setGeometry(r);
-        setVisible(true);
+        Tracing::counters().widgetGeometryChanges++;
+        QWidget::setGeometry(r); // Cheap while hidden, there's no native window nor events yet
+        setVisible(!usesHostPainting);
+        updateHost(oldGeometry);
     }
 }
 
+void Separator::updateHost(QRect oldGeometry)
+{
+    if (!usesHostPainting || !hostWidget())
+        return;
+
+    // Only repaint where the separator was and where it is now
+    hostWidget()->update(oldGeometry);
+    hostWidget()->update(QWidget::geometry());
+}
+
+void Separator::paintOnHost(QPainter *)
+{
+}
+
 int Separator::position() const
 {
     const QPoint topLeft = d->geometry.topLeft();
@@ -173,6 +364,55 @@ QWidget *Separator::hostWidget() const
     return parentWidget();
 }
 
+void Separator::setHostWidget(QWidget *host)
+{
+    QWidget *oldHost = hostWidget();
+    if (host == oldHost)
+        return;
+
+    if (usesHostPainting && oldHost)
+        oldHost->update(QWidget::geometry());
+
+    // Keeps the cheap setGeometry() path from skipping the first geometry on the new host
+    d->geometry = QRect();
+    d->dragBoundsValid = false;
+    setParent(host);
+    if (d->lazyResizeRubberBand)
+        d->lazyResizeRubberBand->setParent(host);
+    setVisible(!usesHostPainting);
+}
+
+int Separator::minPosition() const
+{
+    updateDragBounds();
+    return d->minPos;
+}
+
+int Separator::maxPosition() const
+{
+    updateDragBounds();
+    return d->maxPos;
+}
+
+void Separator::updateDragBounds() const
+{
+    if (d->dragBoundsValid && isBeingDragged())
+        return;
+
+    // Each computes availableOnSide_recursive() up the tree, they don't change while dragging though,
+    // as the available length shrinks on one side by the same amount the separator moved.
+    auto self = const_cast<Separator*>(this);
+    d->minPos = d->parentContainer->minPosForSeparator_global(self);
+    d->maxPos = d->parentContainer->maxPosForSeparator_global(self);
+    d->dragBoundsValid = isBeingDragged();
+}
+
+void Separator::invalidateDragBounds()
+{
+    if (s_separatorBeingDragged)
+        s_separatorBeingDragged->d->dragBoundsValid = false;
+}
+
 void Separator::init(ItemContainer *parentContainer, Qt::Orientation orientation)
 {
     if (!parentContainer) {
@@ -182,9 +422,13 @@ void Separator::init(ItemContainer *parentContainer, Qt::Orientation orientation
 
     d->parentContainer = parentContainer;
     d->orientation = orientation;
-    d->lazyResizeRubberBand = usesLazyResize ? new QRubberBand(QRubberBand::Line, hostWidget())
-                                            : nullptr;
-    setVisible(true);
+    if (usesLazyResize && !d->lazyResizeRubberBand) {
+        d->lazyResizeRubberBand = new QRubberBand(QRubberBand::Line, hostWidget());
+    } else if (!usesLazyResize) {
+        delete d->lazyResizeRubberBand;
+        d->lazyResizeRubberBand = nullptr;
+    }
+    setVisible(!usesHostPainting);
 }
 
 ItemContainer *Separator::parentContainer() const
@@ -220,12 +464,53 @@ void Separator::setSeparatorFactoryFunc(SeparatorFactoryFunc func)
 
 Separator* Separator::createSeparator(QWidget *host)
 {
+    RecycledSeparators &recycled = recycledSeparators();
+    auto it = recycled.find(host);
+    if (it != recycled.end()) {
+        Separator *separator = it->takeLast();
+        if (it->isEmpty())
+            recycled.erase(it);
+        separator->d->recycledFor = nullptr;
+        return separator;
+    }
+
     if (s_separatorFactoryFunc)
         return s_separatorFactoryFunc(host);
 
     return new Separator(host);
 }
 
+void Separator::recycle(Separator *separator)
+{
+    QWidget *host = separator->hostWidget();
+    RecycledSeparators &recycled = recycledSeparators();
+    Separator::List &pool = recycled[host];
+    if (!host || pool.size() >= s_maxRecycledPerHost) {
+        if (pool.isEmpty())
+            recycled.remove(host);
+        delete separator;
+        return;
+    }
+
+    if (separator->isBeingDragged())
+        s_separatorBeingDragged = nullptr;
+
+    Private *const d = separator->d;
+    const QRect oldGeometry = d->geometry;
+    d->thawGuests();
+    d->pendingMoveTimer.stop();
+    d->hasPendingMove = false;
+    d->dragBoundsValid = false;
+    d->parentContainer = nullptr;
+    d->geometry = QRect(); // So the next setGeometry() isn't skipped
+    d->recycledFor = host;
+    if (d->lazyResizeRubberBand)
+        d->lazyResizeRubberBand->hide();
+    separator->hide();
+    separator->updateHost(oldGeometry);
+    pool.push_back(separator);
+}
+
 void Separator::setLazyPosition(int pos)
 {
     if (d->lazyPosition != pos) {
@@ -27,12 +27,14 @@
 
 QT_BEGIN_NAMESPACE
 class QRubberBand;
+class QPainter;
 QT_END_NAMESPACE
 
 namespace Layouting {
 
 class ItemContainer;
 class Separator;
+struct PointerEvent;
 
 typedef Separator* (*SeparatorFactoryFunc)(QWidget *parent);
 
@@ -53,6 +55,19 @@ public:
     int position() const;
     QWidget *hostWidget() const;
 
+    ///@brief Moves this separator to @p host, for when its layout is transplanted into another one.
+    ///The layout repositions it afterwards.
+    void setHostWidget(QWidget *host);
+
+    ///@brief The minimum and maximum positions this separator can be dragged to.
+    ///They're cached while the separator is being dragged, since they only change when constraints do.
+    int minPosition() const;
+    int maxPosition() const;
+
+    ///@brief Discards the bounds cached for the separator being dragged, if any.
+    ///Called by the layout whenever min/max sizes, visibility or the items themselves change.
+    static void invalidateDragBounds();
+
     void init(Layouting::ItemContainer*, Qt::Orientation orientation);
 
     ItemContainer *parentContainer() const;
@@ -60,19 +75,56 @@ public:
     ///@brief Returns whether we're dragging a separator. Can be useful for the app to stop other work while we're not in the final size
     static bool isResizing();
     static void setSeparatorFactoryFunc(SeparatorFactoryFunc);
+    ///@brief Returns a separator for @p host, reusing a recycled one if there's any
     static Separator* createSeparator(QWidget *host);
+
+    ///@brief Hides @p separator and keeps it for the next createSeparator() with the same host.
+    ///Deletes it instead if that host's pool is already full.
+    static void recycle(Separator *separator);
     static bool usesLazyResize;
 
+    ///@brief If true, separator drags are applied to the layout at most once per event loop iteration
+    static bool usesCoalescedMoves;
+
+    ///@brief If true, separators are never shown as widgets. The host widget paints them with
+    ///paintOnHost() and forwards its mouse events to the separator under the cursor.
+    static bool usesHostPainting;
+
+    ///@brief If true, the guests are replaced by snapshots while a separator is dragged, and are
+    ///only resized once, when the drag ends. Ignored with usesLazyResize
+    static bool usesSnapshotResize;
+
+    ///@brief If true, separators handle touch and tablet events themselves, instead of the mouse events Qt
+    ///synthesizes from them. Their moves are always coalesced, see usesCoalescedMoves, and can be
+    ///predicted, see MotionPredictor. Must be set before the separators are created.
+    static bool usesNativeTouchInput;
+
+    ///@brief Paints this separator at geometry(), with a painter on the host widget. Only used with usesHostPainting
+    virtual void paintOnHost(QPainter *);
+
+    ///@brief The mouse handling, for when the host widget received the mouse events. @p hostPos is in host coordinates
+    ///and @p buttons the ones the move event says are pressed
+    void onMousePressed();
+    void onMouseMoved(QPoint hostPos, Qt::MouseButtons buttons);
+    void onMouseReleased();
+    void onMouseDoubleClicked();
+
+    ///@brief Like the above, for touch and tablet events. Only used with usesNativeTouchInput
+    void onPointerEvent(const PointerEvent &, QPoint hostPos);
+
 protected:
     explicit Separator(QWidget *hostWidget);
     void mousePressEvent(QMouseEvent *) override;
     void mouseMoveEvent(QMouseEvent *) override;
     void mouseReleaseEvent(QMouseEvent *) override;
     void mouseDoubleClickEvent(QMouseEvent *) override;
+    bool event(QEvent *) override;
 private:
-    void onMouseReleased();
     void setLazyPosition(int);
+    void updateHost(QRect oldGeometry);
+    void applyPendingMove();
     bool isBeingDragged() const;
+    void updateDragBounds() const;
     static bool s_isResizing;
     static Separator* s_separatorBeingDragged;
     struct Private;
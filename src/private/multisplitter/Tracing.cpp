@@ -0,0 +1,103 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Tracing_p.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+using namespace Layouting;
+
+TraceBackend *Tracing::s_backend = nullptr;
+Counters Tracing::s_counters;
+thread_local Counters *Tracing::s_threadCounters = nullptr;
+
+TraceBackend::~TraceBackend() = default;
+
+void Tracing::setBackend(TraceBackend *backend)
+{
+    s_backend = backend;
+}
+
+ChromeTraceBackend::ChromeTraceBackend(const QString &filename)
+    : m_filename(filename)
+{
+    m_clock.start();
+}
+
+ChromeTraceBackend::~ChromeTraceBackend()
+{
+    if (!m_saved)
+        save();
+}
+
+void ChromeTraceBackend::beginEvent(const char *category, const char *name)
+{
+    addEvent(category, name, 'B');
+}
+
+void ChromeTraceBackend::endEvent(const char *category, const char *name)
+{
+    addEvent(category, name, 'E');
+}
+
+void ChromeTraceBackend::addEvent(const char *category, const char *name, char phase)
+{
+    m_events.push_back({ category, name, phase, m_clock.nsecsElapsed() / 1000 });
+    m_saved = false;
+}
+
+bool ChromeTraceBackend::save()
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    for (const Event &event : qAsConst(m_events)) {
+        QJsonObject e;
+        e.insert(QStringLiteral("cat"), QString::fromLatin1(event.category));
+        e.insert(QStringLiteral("name"), QString::fromLatin1(event.name));
+        e.insert(QStringLiteral("ph"), QString(QLatin1Char(event.phase)));
+        e.insert(QStringLiteral("ts"), event.usecs);
+        e.insert(QStringLiteral("pid"), pid);
+        e.insert(QStringLiteral("tid"), 1); // Only the GUI thread is traced
+        events.append(e);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("traceEvents"), events);
+
+    QSaveFile f(m_filename);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << Q_FUNC_INFO << "Failed to open" << m_filename << f.errorString();
+        return false;
+    }
+
+    f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!f.commit()) {
+        qWarning() << Q_FUNC_INFO << "Failed to write" << m_filename << f.errorString();
+        return false;
+    }
+
+    m_saved = true;
+    return true;
+}
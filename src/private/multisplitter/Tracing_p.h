@@ -0,0 +1,155 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KD_DOCKWIDGETS_MULTISPLITTER_TRACING_P_H
+#define KD_DOCKWIDGETS_MULTISPLITTER_TRACING_P_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+namespace Layouting {
+
+/**
+ * @brief Receives begin/end events for the framework's expensive operations.
+ *
+ * Events nest, an end event always matches the most recent begin event. @p category and @p name
+ * are string literals, backends can store the pointers.
+ * Only called from the GUI thread.
+ */
+class TraceBackend
+{
+public:
+    virtual ~TraceBackend();
+    virtual void beginEvent(const char *category, const char *name) = 0;
+    virtual void endEvent(const char *category, const char *name) = 0;
+};
+
+///@brief Records the events in memory and writes them in Chrome's trace event format, which
+///chrome://tracing and Perfetto can open
+class ChromeTraceBackend : public TraceBackend
+{
+public:
+    explicit ChromeTraceBackend(const QString &filename);
+
+    ///@brief Saves the events not saved yet
+    ~ChromeTraceBackend() override;
+
+    void beginEvent(const char *category, const char *name) override;
+    void endEvent(const char *category, const char *name) override;
+
+    ///@brief Writes all events recorded so far to the file. Returns false on error.
+    bool save();
+
+private:
+    Q_DISABLE_COPY(ChromeTraceBackend)
+    struct Event {
+        const char *category;
+        const char *name;
+        char phase;
+        qint64 usecs;
+    };
+
+    void addEvent(const char *category, const char *name, char phase);
+
+    const QString m_filename;
+    QElapsedTimer m_clock;
+    QVector<Event> m_events;
+    bool m_saved = true;
+};
+
+///@brief Process-wide counters of the layouting work, see Config::performanceCounters()
+struct Counters
+{
+    quint64 relayouts = 0; ///< Containers positioning their children
+    quint64 itemGeometryChanges = 0; ///< Item::setGeometry() calls that changed the geometry
+    quint64 widgetGeometryChanges = 0; ///< setGeometry() calls issued to guest and separator widgets
+    quint64 separatorsCreated = 0;
+    quint64 separatorsDestroyed = 0;
+    quint64 itemsSanityChecked = 0; ///< Items visited by checkSanity()
+
+    Counters &operator+=(const Counters &other)
+    {
+        relayouts += other.relayouts;
+        itemGeometryChanges += other.itemGeometryChanges;
+        widgetGeometryChanges += other.widgetGeometryChanges;
+        separatorsCreated += other.separatorsCreated;
+        separatorsDestroyed += other.separatorsDestroyed;
+        itemsSanityChecked += other.itemsSanityChecked;
+        return *this;
+    }
+};
+
+class Tracing
+{
+public:
+    ///@brief The counters, written to by the layouting code. Always enabled, they're just increments.
+    ///Threads laying out sub-trees in parallel have their own, see setThreadCounters().
+    static Counters &counters() { return s_threadCounters ? *s_threadCounters : s_counters; }
+
+    ///@brief Makes counters() return @p counters on the calling thread. Pass nullptr to restore.
+    ///For worker threads, whose counters are added to the main ones once they're joined.
+    static void setThreadCounters(Counters *counters) { s_threadCounters = counters; }
+    static Counters *threadCounters() { return s_threadCounters; }
+
+    ///@brief The backend receiving the events, nullptr if tracing is disabled, which is the default
+    static TraceBackend *backend() { return s_backend; }
+
+    ///@brief Sets the backend. Ownership isn't transferred. Pass nullptr to disable tracing.
+    static void setBackend(TraceBackend *);
+
+private:
+    static TraceBackend *s_backend;
+    static Counters s_counters;
+    static thread_local Counters *s_threadCounters;
+};
+
+///@brief Emits a begin event now and its end event when going out of scope, if tracing is enabled
+class TraceScope
+{
+public:
+    TraceScope(const char *category, const char *name)
+        : m_backend(Tracing::backend())
+        , m_category(category)
+        , m_name(name)
+    {
+        if (m_backend)
+            m_backend->beginEvent(m_category, m_name);
+    }
+
+    ~TraceScope()
+    {
+        if (m_backend)
+            m_backend->endEvent(m_category, m_name);
+    }
+
+private:
+    Q_DISABLE_COPY(TraceScope)
+    TraceBackend *const m_backend;
+    const char *const m_category;
+    const char *const m_name;
+};
+
+}
+
+// One per scope
+#define KDDW_TRACE_SCOPE(category, name) Layouting::TraceScope kddw_traceScope(category, name)
+
+#endif
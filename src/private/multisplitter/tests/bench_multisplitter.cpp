@@ -0,0 +1,326 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Micro-benchmarks for the layouting engine alone, no dock widgets or frames involved.
+// Layouts are headless, without host widget, unless separators are needed.
+// For machine readable results run with "-csv" or "-o results.xml,xml".
+
+#include "Item_p.h"
+#include "Separator_p.h"
+
+#include <QtTest/QtTest>
+#include <QApplication>
+
+#include <cmath>
+#include <memory>
+
+using namespace Layouting;
+
+Q_DECLARE_METATYPE(Layouting::ChildrenResizeStrategy)
+
+namespace {
+
+enum class Shape {
+    Flat, ///< All items side by side in the root
+    Nested ///< A balanced tree, alternating the orientation at each level
+};
+
+///@brief A root big enough for @p numItems items, whichever the shape
+std::unique_ptr<ItemContainer> createRoot(int numItems, QWidget *hostWidget = nullptr)
+{
+    std::unique_ptr<ItemContainer> root(new ItemContainer(hostWidget));
+    const int length = qMax(1000, numItems * (Item::hardcodedMinimumSize.width() + 100));
+    root->setSize({ length, length });
+    return root;
+}
+
+Item::List populate(ItemContainer *root, int numItems, Shape shape,
+                    Item::Location location = Item::Location_OnRight)
+{
+    Item::List items;
+    items.reserve(numItems);
+
+    for (int i = 0; i < numItems; ++i) {
+        auto item = new Item(root->hostWidget());
+        if (shape == Shape::Flat || i == 0) {
+            root->insertItem(item, location);
+        } else {
+            const int depth = int(std::log2(i + 1));
+            items.at((i - 1) / 2)->insertItem(item, depth % 2 == 0 ? Item::Location_OnRight
+                                                                   : Item::Location_OnBottom);
+        }
+        items.push_back(item);
+    }
+
+    return items;
+}
+
+void addShapeRows()
+{
+    QTest::addColumn<int>("numItems");
+    QTest::addColumn<bool>("nested");
+
+    for (int numItems : { 10, 100, 500 }) {
+        QTest::newRow(QByteArray::number(numItems) + " flat") << numItems << false;
+        QTest::newRow(QByteArray::number(numItems) + " nested") << numItems << true;
+    }
+}
+
+}
+
+class BenchMultiSplitter : public QObject
+{
+    Q_OBJECT
+public Q_SLOTS:
+    void cleanupTestCase()
+    {
+        qDeleteAll(m_hostWidgets);
+    }
+
+private Q_SLOTS:
+    void benchInsertItem_data();
+    void benchInsertItem();
+    void benchRemoveItem_data() { addShapeRows(); }
+    void benchRemoveItem();
+    void benchRequestSeparatorMove_data();
+    void benchRequestSeparatorMove();
+    void benchSetSizeRecursive_data();
+    void benchSetSizeRecursive();
+    void benchLayoutEquallyRecursive_data() { addShapeRows(); }
+    void benchLayoutEquallyRecursive();
+    void benchSuggestedDropRect_data() { addShapeRows(); }
+    void benchSuggestedDropRect();
+    void benchToVariantMap_data() { addShapeRows(); }
+    void benchToVariantMap();
+    void benchFillFromVariantMap_data() { addShapeRows(); }
+    void benchFillFromVariantMap();
+
+private:
+    QWidget *createHostWidget()
+    {
+        // Not shown, separators only need a parent
+        auto host = new QWidget();
+        m_hostWidgets.push_back(host);
+        return host;
+    }
+
+    QVector<QWidget*> m_hostWidgets;
+};
+
+void BenchMultiSplitter::benchInsertItem_data()
+{
+    QTest::addColumn<int>("numItems");
+    QTest::addColumn<Item::Location>("location");
+
+    const QVector<QPair<const char*, Item::Location>> locations = {
+        { "left", Item::Location_OnLeft }, { "top", Item::Location_OnTop },
+        { "right", Item::Location_OnRight }, { "bottom", Item::Location_OnBottom }
+    };
+
+    for (int numItems : { 10, 100, 500 }) {
+        for (const auto &location : locations) {
+            QTest::newRow(QByteArray::number(numItems) + ' ' + location.first)
+                << numItems << location.second;
+        }
+    }
+}
+
+void BenchMultiSplitter::benchInsertItem()
+{
+    QFETCH(int, numItems);
+    QFETCH(Item::Location, location);
+
+    QBENCHMARK {
+        auto root = createRoot(numItems);
+        populate(root.get(), numItems, Shape::Flat, location);
+    }
+}
+
+void BenchMultiSplitter::benchRemoveItem()
+{
+    QFETCH(int, numItems);
+    QFETCH(bool, nested);
+
+    auto root = createRoot(numItems);
+    const Item::List items = populate(root.get(), numItems, nested ? Shape::Nested : Shape::Flat);
+    Item *item = items.at(numItems / 2);
+
+    // A soft removal, so the item can be restored for the next iteration
+    QBENCHMARK {
+        item->parentContainer()->removeItem(item, /*hardRemove=*/ false);
+        item->parentContainer()->restoreChild(item);
+    }
+
+    QVERIFY(item->isVisible());
+}
+
+void BenchMultiSplitter::benchRequestSeparatorMove_data()
+{
+    QTest::addColumn<int>("numItems");
+
+    for (int numItems : { 10, 50, 100, 200 })
+        QTest::newRow(QByteArray::number(numItems)) << numItems;
+}
+
+void BenchMultiSplitter::benchRequestSeparatorMove()
+{
+    QFETCH(int, numItems);
+
+    auto root = createRoot(numItems, createHostWidget());
+    populate(root.get(), numItems, Shape::Flat);
+    const QVector<Separator*> separators = root->separators();
+    QCOMPARE(separators.size(), numItems - 1);
+
+    // Enough to squeeze the whole chain of neighbours, and then back
+    Separator *separator = separators.first();
+    const int available = root->maxPosForSeparator_global(separator) - separator->position();
+    int delta = available / 2;
+    QVERIFY(delta > 0);
+
+    QBENCHMARK {
+        root->requestSeparatorMove(separator, delta);
+        delta = -delta;
+    }
+}
+
+void BenchMultiSplitter::benchSetSizeRecursive_data()
+{
+    QTest::addColumn<int>("numItems");
+    QTest::addColumn<bool>("nested");
+    QTest::addColumn<ChildrenResizeStrategy>("strategy");
+
+    const QVector<QPair<const char*, ChildrenResizeStrategy>> strategies = {
+        { "percentage", ChildrenResizeStrategy::Percentage },
+        { "side1", ChildrenResizeStrategy::Side1SeparatorMove },
+        { "side2", ChildrenResizeStrategy::Side2SeparatorMove }
+    };
+
+    for (int numItems : { 10, 100, 500 }) {
+        for (bool nested : { false, true }) {
+            for (const auto &strategy : strategies) {
+                QTest::newRow(QByteArray::number(numItems) + (nested ? " nested " : " flat ") + strategy.first)
+                    << numItems << nested << strategy.second;
+            }
+        }
+    }
+}
+
+void BenchMultiSplitter::benchSetSizeRecursive()
+{
+    QFETCH(int, numItems);
+    QFETCH(bool, nested);
+    QFETCH(ChildrenResizeStrategy, strategy);
+
+    auto root = createRoot(numItems);
+    populate(root.get(), numItems, nested ? Shape::Nested : Shape::Flat);
+    const QSize size = root->size();
+    bool grow = true;
+
+    QBENCHMARK {
+        root->setSize_recursive(grow ? size + QSize(100, 100) : size, strategy);
+        grow = !grow;
+    }
+}
+
+void BenchMultiSplitter::benchLayoutEquallyRecursive()
+{
+    QFETCH(int, numItems);
+    QFETCH(bool, nested);
+
+    auto root = createRoot(numItems);
+    populate(root.get(), numItems, nested ? Shape::Nested : Shape::Flat);
+
+    QBENCHMARK {
+        root->layoutEqually_recursive();
+    }
+}
+
+void BenchMultiSplitter::benchSuggestedDropRect()
+{
+    QFETCH(int, numItems);
+    QFETCH(bool, nested);
+
+    auto root = createRoot(numItems);
+    const Item::List items = populate(root.get(), numItems, nested ? Shape::Nested : Shape::Flat);
+    Item item(nullptr);
+    const Item *relativeTo = items.last();
+
+    QBENCHMARK {
+        for (Item::Location location : { Item::Location_OnLeft, Item::Location_OnTop,
+                                         Item::Location_OnRight, Item::Location_OnBottom }) {
+            QVERIFY(!root->suggestedDropRect(&item, relativeTo, location).isEmpty());
+            QVERIFY(!root->suggestedDropRect(&item, nullptr, location).isEmpty());
+        }
+    }
+}
+
+void BenchMultiSplitter::benchToVariantMap()
+{
+    QFETCH(int, numItems);
+    QFETCH(bool, nested);
+
+    auto root = createRoot(numItems);
+    populate(root.get(), numItems, nested ? Shape::Nested : Shape::Flat);
+    QVariantMap map;
+
+    QBENCHMARK {
+        map = root->toVariantMap();
+    }
+
+    QVERIFY(!map.isEmpty());
+}
+
+void BenchMultiSplitter::benchFillFromVariantMap()
+{
+    QFETCH(int, numItems);
+    QFETCH(bool, nested);
+
+    auto root = createRoot(numItems);
+    populate(root.get(), numItems, nested ? Shape::Nested : Shape::Flat);
+    const QVariantMap map = root->toVariantMap();
+
+    QBENCHMARK {
+        ItemContainer restored(nullptr);
+        restored.fillFromVariantMap(map, {});
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool qpaPassed = false;
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "-platform") == 0) {
+            qpaPassed = true;
+            break;
+        }
+    }
+
+    if (!qpaPassed) {
+        // Use offscreen by default as it's less annoying, doesn't create visible windows
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    BenchMultiSplitter bench;
+
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_multisplitter.moc"
@@ -20,10 +20,15 @@
 
 #include "Item_p.h"
 #include "Separator_p.h"
+#include "Tracing_p.h"
+#include "PointerInput_p.h"
 #include <QPainter>
+#include <QScopedValueRollback>
 
 #include <QtTest/QtTest>
 #include <memory.h>
+#include <algorithm>
+#include <numeric>
 
 
 // TODO: namespace
@@ -168,6 +173,36 @@ private Q_SLOTS:
     void tst_closeAndRestorePreservesPosition();
     void tst_minSizeChangedBeforeRestore();
     void tst_separatorMoveCrash();
+    void tst_batchInsert();
+    void tst_dirtyFlags();
+    void tst_minSizeCache();
+    void tst_itemAt();
+    void tst_headlessLayout();
+    void tst_geometrySignals();
+    void tst_scratchBuffersReused();
+    void tst_calculateSqueezes();
+    void tst_resizeKeepsExactProportions();
+    void tst_sanityChecksSwitch();
+    void tst_separatorDragBounds();
+    void tst_separatorsRecycled();
+    void tst_refHolders();
+    void tst_tracing();
+    void tst_coalescedMinSizeUpdates();
+    void tst_snapshotResize();
+    void tst_guestParentChanged();
+    void tst_cachedRootOffsets();
+    void tst_distributeWithinBounds();
+    void tst_pathFromRoot();
+    void tst_simulatedDropRect();
+    void tst_teardown();
+    void tst_cachedRoot();
+    void tst_fixedOnParentResize();
+    void tst_restoreChildren();
+    void tst_restoreChildrenKeepsFixed();
+    void tst_restoreExactSize();
+    void tst_parallelHeadlessLayout();
+    void tst_incrementalSanityChecks();
+    void tst_motionPredictor();
 };
 
 class MyHostWidget : public QWidget {
@@ -1510,6 +1545,1150 @@ void TestMultiSplitter::tst_separatorMoveCrash()
     c->requestSeparatorMove(separator, available5 + 10);
 }
 
+void TestMultiSplitter::tst_batchInsert()
+{
+    auto root = createRoot();
+    auto item1 = createItem();
+    auto item2 = createItem();
+    auto item3 = createItem();
+
+    root->beginBatch();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    item2->insertItem(item3, Item::Location_OnBottom);
+
+    // Nothing was pushed to the separators or widgets yet
+    QVERIFY(root->isInBatch());
+    QVERIFY(root->separators_recursive().isEmpty());
+    QVERIFY(item1->widget()->geometry() != item1->mapToRoot(item1->rect()));
+
+    root->commitBatch();
+    QVERIFY(!root->isInBatch());
+    QCOMPARE(root->separators_recursive().size(), 2);
+    QCOMPARE(item1->widget()->geometry(), item1->mapToRoot(item1->rect()));
+    QVERIFY(root->checkSanity());
+    QVERIFY(serializeDeserializeTest(root));
+}
+
+void TestMultiSplitter::tst_dirtyFlags()
+{
+    auto root = createRoot();
+    auto item1 = createItem();
+    auto item2 = createItem();
+    auto item3 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    item2->insertItem(item3, Item::Location_OnBottom);
+    QVERIFY(root->checkSanity());
+
+    // Every guest got its geometry, so nothing is left dirty
+    QVERIFY(!(item1->dirtyFlags() & Item::DirtyFlag_Guest));
+    QVERIFY(!(item2->dirtyFlags() & Item::DirtyFlag_Guest));
+    QVERIFY(!(item3->dirtyFlags() & Item::DirtyFlag_Guest));
+
+    // Moving the container moves its guests too, even though their local geometry didn't change
+    auto separator = root->separators().at(0);
+    root->requestSeparatorMove(separator, -50);
+    QCOMPARE(item2->widget()->geometry(), item2->mapToRoot(item2->rect()));
+    QCOMPARE(item3->widget()->geometry(), item3->mapToRoot(item3->rect()));
+    QVERIFY(!(item3->dirtyFlags() & Item::DirtyFlag_Guest));
+    QVERIFY(root->checkSanity());
+
+    // Resizing only in the container's orientation leaves item1 intact
+    const QRect oldGeo1 = item1->widget()->geometry();
+    root->setSize_recursive(root->size() + QSize(0, 100));
+    QCOMPARE(item1->widget()->geometry(), item1->mapToRoot(item1->rect()));
+    QVERIFY(oldGeo1 != item1->widget()->geometry());
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_minSizeCache()
+{
+    auto root = createRoot();
+    auto item1 = createItem(QSize(100, 100));
+    auto item2 = createItem(QSize(100, 100));
+    auto item3 = createItem(QSize(100, 100));
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    item2->insertItem(item3, Item::Location_OnBottom);
+    auto container2 = item2->parentContainer();
+    QCOMPARE(root->minSize(), QSize(200 + st, 200 + st));
+
+    // Changing a nested item's constraints invalidates all the way up
+    item3->setMinSize(QSize(300, 100));
+    QCOMPARE(container2->minSize(), QSize(300, 200 + st));
+    QCOMPARE(root->minSize(), QSize(400 + st, 200 + st));
+
+    // Hidden items don't count
+    root->removeItem(item3, /*hardRemove=*/ false);
+    QCOMPARE(container2->minSize(), QSize(100, 100));
+    QCOMPARE(root->minSize(), QSize(200 + st, 100));
+
+    root->removeItem(item1);
+    QCOMPARE(root->minSize(), QSize(100, 100));
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_itemAt()
+{
+    auto root = createRoot();
+    auto item1 = createItem();
+    auto item2 = createItem();
+    auto item3 = createItem();
+    auto item4 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    root->insertItem(item3, Item::Location_OnRight);
+    item2->insertItem(item4, Item::Location_OnBottom);
+
+    const Item::List items = { item1, item2, item3, item4 };
+    for (Item *item : items) {
+        const QRect geo = item->mapToRoot(item->rect());
+        QCOMPARE(root->itemAt_recursive(geo.center()), item);
+        QCOMPARE(root->itemAt_recursive(geo.topLeft()), item);
+        QCOMPARE(root->itemAt_recursive(geo.bottomRight()), item);
+    }
+
+    // Separators aren't items
+    const QRect geo1 = item1->mapToRoot(item1->rect());
+    QVERIFY(!root->itemAt_recursive(QPoint(geo1.right() + 1, geo1.center().y())));
+
+    // Hidden items are skipped, their neighbours grow into their space
+    root->removeItem(item2, /*hardRemove=*/ false);
+    QCOMPARE(root->itemAt_recursive(item4->mapToRoot(item4->rect()).topLeft()), item4);
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_headlessLayout()
+{
+    // A layout without host widget only does the geometry math
+    auto root = new ItemContainer(nullptr);
+    root->setSize({ 1000, 1000 });
+    QVERIFY(root->isDummy());
+
+    auto item1 = new Item(nullptr);
+    auto item2 = new Item(nullptr);
+    auto item3 = new Item(nullptr);
+    item1->m_sizingInfo.minSize = {100, 100};
+    item2->m_sizingInfo.minSize = {100, 100};
+    item3->m_sizingInfo.minSize = {100, 100};
+
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    item2->insertItem(item3, Item::Location_OnBottom);
+
+    QVERIFY(root->separators_recursive().isEmpty());
+    QCOMPARE(item1->width() + st + item2->parentContainer()->width(), root->width());
+    QCOMPARE(item2->height() + st + item3->height(), root->height());
+    QCOMPARE(item3->mapToRoot(item3->rect()).bottomRight(), root->rect().bottomRight());
+
+    root->setSize_recursive({ 500, 500 });
+    QCOMPARE(item1->width() + st + item2->parentContainer()->width(), 500);
+    QCOMPARE(item2->height() + st + item3->height(), 500);
+    delete root;
+}
+
+void TestMultiSplitter::tst_geometrySignals()
+{
+    auto root = createRoot();
+    auto item1 = createItem();
+    auto item2 = createItem();
+    auto item3 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    item2->insertItem(item3, Item::Location_OnBottom);
+    ItemContainer *container = item2->parentContainer();
+
+    // Only items someone listens to emit
+    QVERIFY(!item1->m_hasGeometryListeners);
+    {
+        QSignalSpy spy(item3, &Item::xChanged);
+        QVERIFY(item3->m_hasGeometryListeners);
+
+        // item3 doesn't move inside its container, but the container moves relative to the root
+        const int oldContainerX = container->x();
+        root->requestSeparatorMove(root->separators().constFirst(), 50);
+        QVERIFY(container->x() != oldContainerX);
+        QCOMPARE(spy.count(), 1);
+    }
+
+    QVERIFY(!item3->m_hasGeometryListeners);
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_scratchBuffersReused()
+{
+    // Sizing passes reuse the same buffers, check that repeated passes still give the same results
+    auto root = createRoot();
+    auto item1 = createItem();
+    auto item2 = createItem();
+    auto item3 = createItem();
+    auto item4 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    root->insertItem(item3, Item::Location_OnRight);
+    item3->insertItem(item4, Item::Location_OnBottom);
+    root->layoutEqually_recursive();
+    QVERIFY(root->checkSanity());
+
+    const QRect geo1 = item1->geometry();
+    const QRect geo2 = item2->geometry();
+    const QRect geo4 = item4->geometry();
+    Separator *separator = root->separators().constFirst();
+
+    for (int i = 0; i < 5; ++i) {
+        root->requestSeparatorMove(separator, 30);
+        QCOMPARE(item1->width(), geo1.width() + 30);
+        QCOMPARE(item2->width(), geo2.width() - 30);
+        root->requestSeparatorMove(separator, -30);
+        QCOMPARE(item1->geometry(), geo1);
+        QCOMPARE(item2->geometry(), geo2);
+        QVERIFY(root->checkSanity());
+    }
+
+    // Resizing the root resizes the nested container too
+    const QSize oldSize = root->size();
+    root->setSize_recursive(oldSize + QSize(100, 100));
+    QVERIFY(root->checkSanity());
+    root->setSize_recursive(oldSize);
+    root->layoutEqually_recursive();
+    QCOMPARE(item1->geometry(), geo1);
+    QCOMPARE(item4->geometry(), geo4);
+    QVERIFY(root->checkSanity());
+}
+
+// The straightforward version of ItemContainer::calculateSqueezes(), which must give the same results
+static QVector<int> referenceSqueezes(QVector<int> availabilities, int missing,
+                                      NeighbourSqueezeStrategy strategy, bool reversed)
+{
+    const int count = availabilities.count();
+    QVector<int> squeezes(count, 0);
+    if (strategy == NeighbourSqueezeStrategy::AllNeighbours) {
+        while (missing > 0) {
+            const int numDonors = std::count_if(availabilities.cbegin(), availabilities.cend(), [] (int num) {
+                return num > 0;
+            });
+
+            int toTake = missing / numDonors;
+            if (toTake == 0)
+                toTake = missing;
+
+            for (int i = 0; i < count; ++i) {
+                const int available = availabilities.at(i);
+                if (available == 0)
+                    continue;
+                const int took = qMin(missing, qMin(toTake, available));
+                availabilities[i] -= took;
+                missing -= took;
+                squeezes[i] += took;
+                if (missing == 0)
+                    break;
+            }
+        }
+    } else {
+        for (int i = 0; i < count && missing > 0; i++) {
+            const int index = reversed ? count - 1 - i : i;
+            const int took = qMin(missing, availabilities.at(index));
+            missing -= took;
+            squeezes[index] += took;
+        }
+    }
+
+    return squeezes;
+}
+
+void TestMultiSplitter::tst_calculateSqueezes()
+{
+    auto root = createRoot();
+    quint32 seed = 42; // Deterministic, so failures can be reproduced
+    auto random = [&seed] (int max) {
+        seed = seed * 1103515245 + 12345;
+        return int((seed >> 16) % quint32(max));
+    };
+
+    for (int run = 0; run < 500; ++run) {
+        const int count = 1 + random(60);
+        SizingInfo::List sizes;
+        QVector<int> availabilities;
+        for (int i = 0; i < count; ++i) {
+            SizingInfo sizing;
+            sizing.minSize = QSize(10 + random(100), 10);
+            sizing.geometry = QRect(0, 0, sizing.minSize.width() + (random(4) == 0 ? 0 : random(300)), 10);
+            availabilities << sizing.availableLength(Qt::Horizontal);
+            sizes << sizing;
+        }
+
+        const int totalAvailable = std::accumulate(availabilities.cbegin(), availabilities.cend(), 0);
+        if (totalAvailable == 0)
+            continue;
+
+        const int needed = 1 + random(totalAvailable);
+        for (auto strategy : { NeighbourSqueezeStrategy::AllNeighbours, NeighbourSqueezeStrategy::ImmediateNeighboursFirst }) {
+            for (bool reversed : { false, true }) {
+                QVector<int> squeezes;
+                root->calculateSqueezes(sizes.cbegin(), sizes.cend(), needed, strategy, squeezes, reversed);
+                QCOMPARE(squeezes, referenceSqueezes(availabilities, needed, strategy, reversed));
+                QCOMPARE(std::accumulate(squeezes.cbegin(), squeezes.cend(), 0), needed);
+            }
+        }
+    }
+
+    // A wide strip, as found in dashboards
+    Item::List items;
+    for (int i = 0; i < 40; ++i) {
+        auto item = createItem(QSize(10, 10));
+        root->insertItem(item, Item::Location_OnRight);
+        items << item;
+    }
+    QVERIFY(root->checkSanity());
+
+    Separator *separator = root->separators().at(20);
+    root->requestSeparatorMove(separator, -(separator->position() - root->minPosForSeparator_global(separator)));
+    QVERIFY(root->checkSanity());
+    root->requestSeparatorMove(separator, root->maxPosForSeparator_global(separator) - separator->position());
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_resizeKeepsExactProportions()
+{
+    auto root = createRoot();
+    auto item1 = createItem(QSize(10, 10));
+    auto item2 = createItem(QSize(10, 10));
+    auto item3 = createItem(QSize(10, 10));
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    root->insertItem(item3, Item::Location_OnRight);
+    root->requestSeparatorMove(root->separators().constFirst(), -77);
+    QVERIFY(root->checkSanity());
+
+    const QSize originalSize = root->size();
+    const QRect geo1 = item1->geometry();
+    const QRect geo2 = item2->geometry();
+    const QRect geo3 = item3->geometry();
+
+    // Odd sizes, so there's always some rounding to do
+    for (int width : { 997, 431, 1303, 777 }) {
+        root->setSize_recursive(QSize(width, originalSize.height()));
+        QCOMPARE(item1->width() + item2->width() + item3->width() + 2 * st, width);
+        QVERIFY(root->checkSanity());
+    }
+
+    // Going back to the original size gives back the exact same lengths
+    root->setSize_recursive(originalSize);
+    QCOMPARE(item1->geometry(), geo1);
+    QCOMPARE(item2->geometry(), geo2);
+    QCOMPARE(item3->geometry(), geo3);
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_sanityChecksSwitch()
+{
+    QScopedValueRollback<bool> enabled(Item::sanityChecksEnabled, false);
+    auto root = createRoot();
+    auto item1 = createItem();
+    auto item2 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+
+    // Nothing gets scheduled when sanity checks are off
+    QVERIFY(!root->m_checkSanityScheduled);
+
+    // Broken invariants are still counted
+    const int violations = Item::numInvariantViolations();
+    Separator *separator = root->separators().constFirst();
+    s_expectedWarning = QStringLiteral("Separator would have gone out of bounds");
+    root->requestSeparatorMove(separator, 5000);
+    s_expectedWarning.clear();
+    QCOMPARE(Item::numInvariantViolations(), violations + 1);
+
+    // And explicit checks still work
+    QVERIFY(root->checkSanity());
+
+    Item::sanityChecksEnabled = true;
+    auto item3 = createItem();
+    root->insertItem(item3, Item::Location_OnRight);
+    QVERIFY(root->m_checkSanityScheduled);
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_separatorDragBounds()
+{
+    auto root = createRoot();
+    auto item1 = createItem(QSize(100, 100));
+    auto item2 = createItem(QSize(100, 100));
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    Separator *separator = root->separators().constFirst();
+
+    separator->onMousePressed();
+    QVERIFY(Separator::isResizing());
+    QCOMPARE(separator->minPosition(), root->minPosForSeparator_global(separator));
+    QCOMPARE(separator->maxPosition(), root->maxPosForSeparator_global(separator));
+
+    // The bounds don't change while dragging
+    const int minPos = separator->minPosition();
+    const int maxPos = separator->maxPosition();
+    root->requestSeparatorMove(separator, -50);
+    QCOMPARE(separator->minPosition(), minPos);
+    QCOMPARE(separator->maxPosition(), maxPos);
+    QCOMPARE(root->minPosForSeparator_global(separator), minPos);
+    QCOMPARE(root->maxPosForSeparator_global(separator), maxPos);
+
+    // Unless constraints do
+    item1->setMinSize(QSize(200, 100));
+    QCOMPARE(separator->minPosition(), root->minPosForSeparator_global(separator));
+    QVERIFY(separator->minPosition() > minPos);
+
+    separator->onMouseReleased();
+    QVERIFY(!Separator::isResizing());
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_separatorsRecycled()
+{
+    auto root = createRoot();
+    auto item1 = createItem();
+    auto item2 = createItem();
+    auto item3 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    root->insertItem(item3, Item::Location_OnRight);
+    QCOMPARE(root->separators().size(), 2);
+    const Separator::List originalSeparators = root->separators();
+
+    // Toggling an item reuses the separator widgets instead of creating new ones
+    auto guest2 = item2->guest();
+    for (int i = 0; i < 3; ++i) {
+        item2->turnIntoPlaceholder();
+        QCOMPARE(root->separators().size(), 1);
+        QVERIFY(root->checkSanity());
+
+        item2->restore(guest2);
+        QCOMPARE(root->separators().size(), 2);
+        for (Separator *separator : root->separators()) {
+            QVERIFY(originalSeparators.contains(separator));
+            QCOMPARE(separator->parentContainer(), root.get());
+        }
+        QVERIFY(root->checkSanity());
+    }
+}
+
+void TestMultiSplitter::tst_refHolders()
+{
+    struct Holder : public ItemRefHolder
+    {
+        void onItemDestroyed(Item *item) override { destroyed.push_back(item); }
+        Item::List destroyed;
+    };
+
+    auto root = createRoot();
+    auto item1 = createItem();
+    auto item2 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+
+    Holder holder1;
+    Holder holder2;
+    item1->addRefHolder(&holder1);
+    item1->addRefHolder(&holder2);
+    item2->addRefHolder(&holder1);
+    item2->removeRefHolder(&holder1);
+
+    root->removeItem(item2);
+    QVERIFY(holder1.destroyed.isEmpty());
+
+    root->removeItem(item1);
+    QCOMPARE(holder1.destroyed, Item::List({ item1 }));
+    QCOMPARE(holder2.destroyed, Item::List({ item1 }));
+}
+
+void TestMultiSplitter::tst_tracing()
+{
+    struct Backend : public TraceBackend
+    {
+        void beginEvent(const char *, const char *name) override { events << QByteArray("B ") + name; }
+        void endEvent(const char *, const char *name) override { events << QByteArray("E ") + name; }
+        QByteArrayList events;
+    };
+
+    auto root = createRoot();
+    auto item1 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft); // Not traced
+
+    Backend backend;
+    Tracing::setBackend(&backend);
+    auto item2 = createItem();
+    root->insertItem(item2, Item::Location_OnRight);
+    Tracing::setBackend(nullptr);
+    root->layoutEqually(); // Not traced
+
+    QVERIFY(!backend.events.isEmpty());
+    QCOMPARE(backend.events.constFirst(), QByteArray("B ItemContainer::insertItem"));
+    QCOMPARE(backend.events.constLast(), QByteArray("E ItemContainer::insertItem"));
+
+    // Every end event matches the last begin event
+    QByteArrayList stack;
+    for (const QByteArray &event : qAsConst(backend.events)) {
+        if (event.startsWith('B')) {
+            stack.push_back(event.mid(2));
+        } else {
+            QVERIFY(!stack.isEmpty());
+            QCOMPARE(stack.takeLast(), event.mid(2));
+        }
+    }
+    QVERIFY(stack.isEmpty());
+}
+
+void TestMultiSplitter::tst_coalescedMinSizeUpdates()
+{
+    QScopedValueRollback<bool> coalesce(Item::usesCoalescedMinSizeUpdates, true);
+
+    auto root = createRoot();
+    auto item1 = createItem(QSize(100, 100));
+    auto item2 = createItem(QSize(100, 100));
+    auto item3 = createItem(QSize(100, 100));
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    item2->insertItem(item3, Item::Location_OnBottom);
+    QCOMPARE(root->minSize(), QSize(200 + st, 200 + st));
+
+    QSignalSpy spy(root.get(), &Item::minSizeChanged);
+    auto guest1 = qobject_cast<GuestWidget*>(item1->widget());
+    auto guest3 = qobject_cast<GuestWidget*>(item3->widget());
+
+    // A guest rebuilding its contents, nothing is applied until the event loop runs
+    guest3->setMinSize(QSize(200, 100));
+    guest3->setMinSize(QSize(300, 100));
+    guest1->setMinSize(QSize(150, 100));
+    QCOMPARE(item3->minSize(), QSize(100, 100));
+    QCOMPARE(root->minSize(), QSize(200 + st, 200 + st));
+    QCOMPARE(spy.count(), 0);
+
+    QTRY_COMPARE(item3->minSize(), QSize(300, 100));
+    QCOMPARE(item1->minSize(), QSize(150, 100));
+    QCOMPARE(root->minSize(), QSize(450 + st, 200 + st));
+
+    // The host only hears about it once
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(!root->isInBatch());
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_snapshotResize()
+{
+    QScopedValueRollback<bool> snapshots(Separator::usesSnapshotResize, true);
+
+    auto root = createRoot();
+    auto item1 = createItem(QSize(100, 100));
+    auto item2 = createItem(QSize(100, 100));
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    Separator *separator = root->separators().constFirst();
+    const QRect oldGeo1 = item1->widget()->geometry();
+
+    separator->onMousePressed();
+    QVERIFY(item1->isGuestFrozen());
+    QVERIFY(item2->isGuestFrozen());
+
+    // Only the snapshots follow the layout
+    root->requestSeparatorMove(separator, -50);
+    QCOMPARE(item1->widget()->geometry(), oldGeo1);
+    QVERIFY(item1->mapToRoot(item1->rect()) != oldGeo1);
+    const QList<QWidget*> snapshotWidgets = root->hostWidget()->findChildren<QWidget*>(QStringLiteral("snapshot"));
+    QCOMPARE(snapshotWidgets.size(), 2);
+    QVERIFY(std::any_of(snapshotWidgets.cbegin(), snapshotWidgets.cend(), [item1] (QWidget *snapshot) {
+        return snapshot->geometry() == item1->mapToRoot(item1->rect());
+    }));
+
+    // And the guests are resized once, on release
+    separator->onMouseReleased();
+    QVERIFY(!item1->isGuestFrozen());
+    QVERIFY(!item2->isGuestFrozen());
+    QCOMPARE(item1->widget()->geometry(), item1->mapToRoot(item1->rect()));
+    QCOMPARE(item2->widget()->geometry(), item2->mapToRoot(item2->rect()));
+    QVERIFY(root->hostWidget()->findChildren<QWidget*>(QStringLiteral("snapshot")).isEmpty());
+    QVERIFY(root->checkSanity());
+
+    // Deleting the separator mid drag thaws them too
+    separator->onMousePressed();
+    QVERIFY(item1->isGuestFrozen());
+    root->deleteSeparators_recursive();
+    QVERIFY(!item1->isGuestFrozen());
+    QVERIFY(!item2->isGuestFrozen());
+    QVERIFY(root->hostWidget()->findChildren<QWidget*>(QStringLiteral("snapshot")).isEmpty());
+    root->updateSeparators_recursive();
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_guestParentChanged()
+{
+    auto root = createRoot();
+    auto item1 = createItem();
+    auto item2 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    QWidget *guest = item1->widget();
+    QCOMPARE(guest->parentWidget(), root->hostWidget());
+
+    // Staying in the host is a no-op
+    item1->onGuestParentChanged();
+    QVERIFY(item1->isVisible());
+
+    // Leaving it turns the item into a placeholder, the guest is what tells the item
+    QWidget otherHost;
+    guest->setParent(&otherHost);
+    QVERIFY(item1->isVisible());
+    item1->onGuestParentChanged();
+    QVERIFY(!item1->isVisible());
+    QVERIFY(!item1->widget());
+    QCOMPARE(root->visibleCount_recursive(), 1);
+
+    // Placeholders don't follow their former guest
+    item1->onGuestParentChanged();
+    QVERIFY(!item1->isVisible());
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_cachedRootOffsets()
+{
+    auto root = createRoot();
+    Item *item1 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    auto root2 = createRoot();
+    Item *item21 = createItem();
+    Item *item22 = createItem();
+    root2->insertItem(item21, Item::Location_OnTop);
+    root2->insertItem(item22, Item::Location_OnBottom);
+    root->insertItem(root2.release(), Item::Location_OnRight);
+    QVERIFY(root->checkSanity());
+
+    auto uncachedOffset = [] (const Item *item) {
+        QPoint offset;
+        for (; !item->isRoot(); item = item->parentContainer())
+            offset += item->pos();
+        return offset;
+    };
+
+    auto verifyOffsets = [&] {
+        for (Item *item : { item1, item21, item22 }) {
+            QCOMPARE(item->mapToRoot(QPoint(0, 0)), uncachedOffset(item));
+            QCOMPARE(item->mapFromRoot(item->mapToRoot(QPoint(5, 5))), QPoint(5, 5));
+        }
+    };
+
+    verifyOffsets();
+
+    // Moving an ancestor moves its whole sub-tree
+    Separator *separator = root->separators().constFirst();
+    root->requestSeparatorMove(separator, 50);
+    verifyOffsets();
+
+    // So does inserting before it
+    Item *item0 = createItem();
+    root->insertItem(item0, Item::Location_OnLeft);
+    verifyOffsets();
+
+    // And reparenting
+    item22->insertItem(createItem(), Item::Location_OnRight);
+    verifyOffsets();
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_distributeWithinBounds()
+{
+    {
+        // Max sizes are honoured and the rest is shared equally, the odd pixel going to the first item
+        auto root = createRoot();
+        Item::List items;
+        for (int i = 0; i < 4; ++i) {
+            items << createItem();
+            root->insertItem(items.last(), Item::Location_OnRight);
+        }
+
+        items.at(1)->setMaxSize({ 100, 1000 });
+        items.at(2)->setMaxSize({ 150, 1000 });
+        root->layoutEqually();
+        QVERIFY(root->checkSanity());
+
+        const int rest = root->width() - 3 * st - 100 - 150;
+        QCOMPARE(items.at(1)->width(), 100);
+        QCOMPARE(items.at(2)->width(), 150);
+        QCOMPARE(items.at(0)->width(), rest - rest / 2);
+        QCOMPARE(items.at(3)->width(), rest / 2);
+    }
+
+    {
+        // Min sizes too, in a single pass even when the first item would take everything
+        auto root = createRoot();
+        Item *item1 = createItem(QSize(600, 100));
+        Item *item2 = createItem();
+        Item *item3 = createItem();
+        root->insertItem(item1, Item::Location_OnRight);
+        root->insertItem(item2, Item::Location_OnRight);
+        root->insertItem(item3, Item::Location_OnRight);
+        root->layoutEqually();
+        QVERIFY(root->checkSanity());
+
+        const int rest = root->width() - 2 * st - 600;
+        QCOMPARE(item1->width(), 600);
+        QCOMPARE(item2->width(), rest - rest / 2);
+        QCOMPARE(item3->width(), rest / 2);
+
+        // Resizing by percentage keeps the min size, without squeezing anyone afterwards
+        const QSize oldSize = root->size();
+        root->setSize_recursive(oldSize - QSize(100, 0));
+        QVERIFY(root->checkSanity());
+        QCOMPARE(item1->width(), 600);
+        QCOMPARE(item2->width() + item3->width(), rest - 100);
+        QVERIFY(qAbs(item2->width() - item3->width()) <= 1);
+    }
+}
+
+void TestMultiSplitter::tst_pathFromRoot()
+{
+    auto root = createRoot();
+    Item *item1 = createItem();
+    Item *item2 = createItem();
+    Item *item3 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    item2->insertItem(item3, Item::Location_OnBottom);
+
+    auto scannedPath = [] (const Item *item) {
+        QVector<int> path;
+        for (; !item->isRoot(); item = item->parentContainer())
+            path.prepend(item->parentContainer()->childItems().indexOf(const_cast<Item*>(item)));
+        return path;
+    };
+
+    auto verifyPaths = [&] (const Item::List &items) {
+        for (Item *item : items) {
+            QCOMPARE(item->pathFromRoot(), scannedPath(item));
+            QVERIFY(item->parentContainer()->contains(item));
+        }
+    };
+
+    QVERIFY(root->pathFromRoot().isEmpty());
+    QCOMPARE(item3->pathFromRoot(), QVector<int>({ 1, 1 }));
+    verifyPaths({ item1, item2, item3 });
+
+    // Inserting before shifts the indexes after it
+    Item *item0 = createItem();
+    root->insertItem(item0, Item::Location_OnLeft);
+    QCOMPARE(item3->pathFromRoot(), QVector<int>({ 2, 1 }));
+    verifyPaths({ item0, item1, item2, item3 });
+
+    // And removing shifts them back
+    root->removeItem(item0);
+    QCOMPARE(item3->pathFromRoot(), QVector<int>({ 1, 1 }));
+    verifyPaths({ item1, item2, item3 });
+
+    // Items only belong to their own container
+    QVERIFY(!root->contains(item3));
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_simulatedDropRect()
+{
+    auto root = createRoot();
+    Item *item1 = createItem();
+    Item *item2 = createItem();
+    Item *item3 = createItem();
+    Item *item4 = createItem();
+    Item *hidden = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    root->insertItem(hidden, Item::Location_OnRight);
+    item2->insertItem(item3, Item::Location_OnBottom);
+    item3->insertItem(item4, Item::Location_OnRight);
+    root->removeItem(hidden, /*hardRemove=*/ false);
+
+    const QVector<Item::Location> locations = { Item::Location_OnLeft, Item::Location_OnTop,
+                                                Item::Location_OnRight, Item::Location_OnBottom };
+    Item itemToDrop(nullptr);
+    itemToDrop.setSize(QSize(300, 300));
+    itemToDrop.setMinSize(QSize(100, 100));
+
+    // Whether it's inserted among siblings, into a new container or next to all of root:
+    // always the geometry the item would get on a copy of the layout
+    int numSimulated = 0;
+    for (Item::Location loc : locations) {
+        for (Item *relativeTo : root->items_recursive()) {
+            if (relativeTo->isContainer() || !relativeTo->isVisible())
+                continue;
+
+            ItemContainer *container = relativeTo->parentContainer();
+            const QRect simulated = container->simulatedDropRect(&itemToDrop, relativeTo, loc);
+            QVERIFY(simulated.isValid());
+            QCOMPARE(simulated, container->suggestedDropRectByCopy(&itemToDrop, relativeTo, loc));
+            QCOMPARE(container->suggestedDropRect(&itemToDrop, relativeTo, loc), simulated);
+            numSimulated++;
+        }
+
+        QCOMPARE(root->simulatedDropRect(&itemToDrop, nullptr, loc), root->suggestedDropRectByCopy(&itemToDrop, nullptr, loc));
+    }
+    QCOMPARE(numSimulated, 4 * 4);
+
+    // Too big for item4's container, which would need to take space from item1
+    Item bigItem(nullptr);
+    bigItem.setSize(QSize(600, 600));
+    bigItem.setMinSize(QSize(600, 100));
+    ItemContainer *container = item4->parentContainer();
+    QVERIFY(!container->simulatedDropRect(&bigItem, item4, Item::Location_OnTop).isValid());
+    QCOMPARE(container->suggestedDropRect(&bigItem, item4, Item::Location_OnTop),
+             container->suggestedDropRectByCopy(&bigItem, item4, Item::Location_OnTop));
+
+    // Empty root
+    auto emptyRoot = createRoot();
+    QCOMPARE(emptyRoot->suggestedDropRect(&itemToDrop, nullptr, Item::Location_OnLeft), emptyRoot->rect());
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_teardown()
+{
+    auto root = createRoot();
+    Item *item1 = createItem();
+    Item *item2 = createItem();
+    Item *item3 = createItem();
+    Item *item4 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    item2->insertItem(item3, Item::Location_OnBottom);
+    item3->insertItem(item4, Item::Location_OnRight);
+
+    int numCountChanges = 0;
+    connect(root.get(), &ItemContainer::numVisibleItemsChanged, this, [&numCountChanges] { numCountChanges++; });
+    connect(root.get(), &ItemContainer::numItemsChanged, this, [&numCountChanges] { numCountChanges++; });
+
+    const quint64 relayouts = Tracing::counters().relayouts;
+    const QRect item1Geometry = item1->geometry();
+    const int numSeparators = root->separators_recursive().size();
+    ItemContainer *container = item4->parentContainer();
+
+    item2->parentContainer()->beginTeardown();
+    QVERIFY(root->isTearingDown());
+
+    // Removing only updates the tree: no neighbour grows, no container goes away
+    root->removeItem(item2, /*hardRemove=*/ false);
+    root->removeItem(item3);
+    root->removeItem(item4);
+    QCOMPARE(Tracing::counters().relayouts, relayouts);
+    QCOMPARE(item1->geometry(), item1Geometry);
+    QCOMPARE(root->separators_recursive().size(), numSeparators);
+    QVERIFY(container->isEmpty());
+    QVERIFY(root->contains(item1));
+    QCOMPARE(numCountChanges, 0);
+    QVERIFY(root->checkSanity());
+
+    // Clearing ends it, the counts are told once
+    root->clear();
+    QVERIFY(!root->isTearingDown());
+    QCOMPARE(numCountChanges, 2);
+    QCOMPARE(root->numChildren(), 0);
+
+    // And the layout is usable again
+    Item *item5 = createItem();
+    root->insertItem(item5, Item::Location_OnLeft);
+    QVERIFY(item5->isVisible());
+    QCOMPARE(item5->geometry(), root->rect());
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_cachedRoot()
+{
+    auto root = createRoot();
+    auto root2 = createRoot();
+    Item *item1 = createItem();
+    Item *item21 = createItem();
+    Item *item22 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root2->insertItem(item21, Item::Location_OnTop);
+    QCOMPARE(item1->root(), root.get());
+    QCOMPARE(item21->root(), root2.get());
+
+    // Nesting an item into a new container keeps the root
+    item21->insertItem(item22, Item::Location_OnRight);
+    QCOMPARE(item22->root(), root2.get());
+    QCOMPARE(item21->root(), root2.get());
+
+    // Inserting a root into another changes it for the whole sub-tree
+    root->insertItem(root2.get(), Item::Location_OnRight);
+    ItemContainer *oldRoot2 = root2.release();
+    for (Item *item : { item1, item21, item22, static_cast<Item*>(oldRoot2) })
+        QCOMPARE(item->root(), root.get());
+
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_fixedOnParentResize()
+{
+    auto root = createRoot();
+    Item *left = createItem();
+    Item *center = createItem();
+    Item *right = createItem();
+    root->insertItem(left, Item::Location_OnLeft);
+    root->insertItem(center, Item::Location_OnRight);
+    root->insertItem(right, Item::Location_OnRight);
+    left->setFixedOnParentResize(true);
+    right->setFixedOnParentResize(true);
+    const int leftWidth = left->width();
+    const int rightWidth = right->width();
+    const int centerWidth = center->width();
+
+    // Only the central item absorbs the resize
+    root->setSize_recursive(root->size() + QSize(200, 50));
+    QCOMPARE(left->width(), leftWidth);
+    QCOMPARE(right->width(), rightWidth);
+    QCOMPARE(center->width(), centerWidth + 200);
+    QCOMPARE(left->height(), root->height());
+    QVERIFY(root->checkSanity());
+
+    // Unless it can't, then they all shrink
+    const QSize minSize = root->minSize();
+    root->setSize_recursive(minSize);
+    QCOMPARE(left->width(), left->minSize().width());
+    QCOMPARE(center->width(), center->minSize().width());
+    QVERIFY(root->checkSanity());
+
+    // A container is fixed if all of its children are
+    auto root2 = createRoot();
+    Item *bottom1 = createItem();
+    Item *bottom2 = createItem();
+    Item *top = createItem();
+    root2->insertItem(top, Item::Location_OnTop);
+    root2->insertItem(bottom1, Item::Location_OnBottom);
+    bottom1->insertItem(bottom2, Item::Location_OnRight);
+    ItemContainer *bottomContainer = bottom1->parentContainer();
+    QVERIFY(bottomContainer != root2.get());
+    bottom1->setFixedOnParentResize(true);
+    QVERIFY(!bottomContainer->isFixedOnParentResize());
+    bottom2->setFixedOnParentResize(true);
+    QVERIFY(bottomContainer->isFixedOnParentResize());
+
+    const int bottomHeight = bottomContainer->height();
+    root2->setSize_recursive(root2->size() + QSize(0, 100));
+    QCOMPARE(bottomContainer->height(), bottomHeight);
+    QCOMPARE(bottom1->height(), bottomHeight);
+    QVERIFY(root2->checkSanity());
+
+    // And it's saved with the layout
+    SizingInfo restored;
+    restored.fromVariantMap(bottom1->m_sizingInfo.toVariantMap());
+    QVERIFY(restored.isFixedOnParentResize);
+    QVERIFY(serializeDeserializeTest(root2));
+}
+
+void TestMultiSplitter::tst_restoreChildren()
+{
+    auto root = createRoot();
+    Item *item1 = createItem();
+    Item *item2 = createItem();
+    Item *item3 = createItem();
+    Item *item4 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    item2->insertItem(item3, Item::Location_OnBottom);
+    root->insertItem(item4, Item::Location_OnRight);
+    ItemContainer *container = item3->parentContainer();
+    QVERIFY(container != root.get());
+    const int width4 = item4->width();
+
+    item2->turnIntoPlaceholder();
+    item3->turnIntoPlaceholder();
+    item4->turnIntoPlaceholder();
+    QVERIFY(!container->isVisible());
+    QCOMPARE(item1->width(), root->width());
+
+    // Restores the hidden container too, and restoring the same item twice is harmless
+    root->restoreChildren({ item4, item2, item3, item3 });
+    QVERIFY(item2->isVisible());
+    QVERIFY(item3->isVisible());
+    QVERIFY(item4->isVisible());
+    QVERIFY(container->isVisible());
+    QCOMPARE(root->numVisibleChildren(), 3);
+    QCOMPARE(container->numVisibleChildren(), 2);
+    QVERIFY(item1->x() < container->x());
+    QVERIFY(container->x() < item4->x());
+    QVERIFY(item2->y() < item3->y());
+    QCOMPARE(item2->width(), container->width());
+    QCOMPARE(item4->height(), root->height());
+    // Shared in proportion to the lengths they had, item1 had all of it
+    QVERIFY(item1->width() > item4->width());
+    QVERIFY(item4->width() <= width4);
+    QVERIFY(root->checkSanity());
+
+    // Already visible items are left untouched
+    const QRect geo1 = item1->geometry();
+    root->restoreChildren({ item1 });
+    QCOMPARE(item1->geometry(), geo1);
+    QVERIFY(serializeDeserializeTest(root));
+}
+
+void TestMultiSplitter::tst_restoreChildrenKeepsFixed()
+{
+    auto root = createRoot();
+    Item *left = createItem();
+    Item *center = createItem();
+    Item *right = createItem();
+    root->insertItem(left, Item::Location_OnLeft);
+    root->insertItem(center, Item::Location_OnRight);
+    root->insertItem(right, Item::Location_OnRight);
+    left->setFixedOnParentResize(true);
+
+    right->turnIntoPlaceholder();
+    const int leftWidth = left->width();
+
+    // The fixed sibling keeps its width, the flexible ones make room
+    root->restoreChildren({ right });
+    QVERIFY(right->isVisible());
+    QCOMPARE(left->width(), leftWidth);
+    QCOMPARE(left->width() + center->width() + right->width() + 2 * st, root->width());
+    QVERIFY(root->checkSanity());
+}
+
+void TestMultiSplitter::tst_restoreExactSize()
+{
+    auto root = createRoot();
+    Item *item1 = createItem();
+    Item *item2 = createItem();
+    Item *item3 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    item2->insertItem(item3, Item::Location_OnBottom);
+    const QVariantMap serialized = root->toVariantMap();
+
+    QHash<QString, GuestInterface*> widgets;
+    const Item::List originalItems = root->items_recursive();
+    for (Item *item : originalItems)
+        if (auto w = static_cast<GuestWidget*>(item->widget()))
+            widgets.insert(QString::number(qint64(w)), w);
+
+    // Already tiled at the saved size, so the stored geometries are used as they are
+    const quint64 relayouts = Tracing::counters().relayouts;
+    ItemContainer root2(root->hostWidget());
+    root2.fillFromVariantMap(serialized, widgets);
+    QCOMPARE(Tracing::counters().relayouts, relayouts);
+    QCOMPARE(root2.size(), root->size());
+    const Item::List restoredItems = root2.items_recursive();
+    QCOMPARE(restoredItems.size(), originalItems.size());
+    for (int i = 0; i < restoredItems.size(); ++i)
+        QCOMPARE(restoredItems.at(i)->geometry(), originalItems.at(i)->geometry());
+    QVERIFY(root2.checkSanity());
+}
+
+void TestMultiSplitter::tst_parallelHeadlessLayout()
+{
+    // Columns of stacked items, each column big enough to be resized on a worker
+    auto createHeadless = [] {
+        auto root = new ItemContainer(nullptr);
+        root->setSize({ 2000, 1000 });
+        for (int column = 0; column < 4; ++column) {
+            auto first = new Item(nullptr);
+            first->m_sizingInfo.minSize = { 50, 50 };
+            root->insertItem(first, Item::Location_OnRight);
+            for (int row = 1; row < 6; ++row) {
+                auto item = new Item(nullptr);
+                item->m_sizingInfo.minSize = { 50, 50 };
+                if (row == 1)
+                    first->insertItem(item, Item::Location_OnBottom);
+                else
+                    first->parentContainer()->insertItem(item, Item::Location_OnBottom);
+            }
+        }
+        return root;
+    };
+
+    QScopedValueRollback<int> threshold(ItemContainer::parallelLayoutThreshold, 0);
+    ItemContainer *serial = createHeadless();
+    ItemContainer *parallel = createHeadless();
+
+    const quint64 serialStart = Tracing::counters().relayouts;
+    serial->setSize_recursive({ 1200, 700 });
+    serial->setSize_recursive({ 1900, 900 });
+    const quint64 serialRelayouts = Tracing::counters().relayouts - serialStart;
+
+    ItemContainer::parallelLayoutThreshold = 4;
+    const quint64 parallelStart = Tracing::counters().relayouts;
+    parallel->setSize_recursive({ 1200, 700 });
+    parallel->setSize_recursive({ 1900, 900 });
+
+    // Same result, and the workers' counters aren't lost
+    QCOMPARE(Tracing::counters().relayouts - parallelStart, serialRelayouts);
+    const Item::List serialItems = serial->items_recursive();
+    const Item::List parallelItems = parallel->items_recursive();
+    QCOMPARE(parallelItems.size(), serialItems.size());
+    for (int i = 0; i < serialItems.size(); ++i)
+        QCOMPARE(parallelItems.at(i)->mapToRoot(parallelItems.at(i)->rect()),
+                 serialItems.at(i)->mapToRoot(serialItems.at(i)->rect()));
+
+    delete serial;
+    delete parallel;
+}
+
+void TestMultiSplitter::tst_incrementalSanityChecks()
+{
+    QScopedValueRollback<bool> incremental(Item::incrementalSanityChecks, true);
+    auto root = createRoot();
+    auto item1 = createItem();
+    auto item2 = createItem();
+    auto item3 = createItem();
+    auto item4 = createItem();
+    root->insertItem(item1, Item::Location_OnLeft);
+    root->insertItem(item2, Item::Location_OnRight);
+    item1->insertItem(item3, Item::Location_OnBottom);
+    item2->insertItem(item4, Item::Location_OnBottom);
+    ItemContainer *left = item1->parentContainer();
+    ItemContainer *right = item2->parentContainer();
+    QVERIFY(left != right);
+
+    // An explicit check visits everything: the 3 containers and the 4 items
+    quint64 checked = Tracing::counters().itemsSanityChecked;
+    QVERIFY(root->checkSanity());
+    QCOMPARE(Tracing::counters().itemsSanityChecked - checked, quint64(7));
+    QVERIFY(!(right->dirtyFlags() & Item::DirtyFlag_Unchecked));
+
+    // Only the left column changes
+    left->requestSeparatorMove(left->separators().constFirst(), 10);
+    QVERIFY(item1->dirtyFlags() & Item::DirtyFlag_Unchecked);
+    QVERIFY(root->dirtyFlags() & Item::DirtyFlag_Unchecked);
+    QVERIFY(!(right->dirtyFlags() & Item::DirtyFlag_Unchecked));
+
+    // The scheduled check skips the right column
+    checked = Tracing::counters().itemsSanityChecked;
+    root->runScheduledCheckSanity();
+    QCOMPARE(Tracing::counters().itemsSanityChecked - checked, quint64(4));
+    QVERIFY(!(root->dirtyFlags() & Item::DirtyFlag_Unchecked));
+    QVERIFY(!(item3->dirtyFlags() & Item::DirtyFlag_Unchecked));
+
+    // Explicit ones are still full
+    checked = Tracing::counters().itemsSanityChecked;
+    QVERIFY(root->checkSanity());
+    QCOMPARE(Tracing::counters().itemsSanityChecked - checked, quint64(7));
+}
+
+void TestMultiSplitter::tst_motionPredictor()
+{
+    QScopedValueRollback<int> interval(MotionPredictor::predictionInterval, 0);
+    MotionPredictor predictor;
+    predictor.addSample({ 100, 100 }, 1000);
+    predictor.addSample({ 110, 100 }, 1010);
+
+    // Disabled by default
+    QCOMPARE(predictor.predicted({ 110, 100 }), QPoint(110, 100));
+
+    // 1 pixel per ms
+    MotionPredictor::predictionInterval = 20;
+    QCOMPARE(predictor.predicted({ 110, 100 }), QPoint(130, 100));
+    predictor.addSample({ 120, 110 }, 1020);
+    QCOMPARE(predictor.predicted({ 120, 110 }), QPoint(140, 120));
+
+    // Needs two samples again
+    predictor.reset();
+    QCOMPARE(predictor.predicted({ 120, 110 }), QPoint(120, 110));
+    predictor.addSample({ 120, 110 }, 1030);
+    QCOMPARE(predictor.predicted({ 120, 110 }), QPoint(120, 110));
+}
+
 int main(int argc, char *argv[])
 {
     bool qpaPassed = false;
@@ -23,22 +23,66 @@
 #include "Utils_p.h"
 #include "DropArea_p.h"
 #include "TitleBar_p.h"
+#include "QuickWindowPool_p.h"
+
+#include <QQuickWindow>
 
 using namespace KDDockWidgets;
 
 FloatingWindowQuick::FloatingWindowQuick(QWidgetOrQuick *parent)
     : FloatingWindow(parent)
 {
-    init();
+    init(parent);
 }
 
 FloatingWindowQuick::FloatingWindowQuick(Frame *frame, QWidgetOrQuick *parent)
     : FloatingWindow(frame, parent)
 {
-    init();
+    init(parent);
+}
+
+FloatingWindowQuick::~FloatingWindowQuick()
+{
+    if (m_quickWindow) {
+        QQuickItem::setParentItem(nullptr);
+        QuickWindowPool::self()->release(m_quickWindow);
+    }
 }
 
+QQuickWindow *FloatingWindowQuick::quickWindow() const
+{
+    return m_quickWindow;
+}
+
+void FloatingWindowQuick::init(QWidgetOrQuick *parent)
+{
+    // A pooled window already has its native window, and its context and scene graph if it was shown before
+    m_quickWindow = QuickWindowPool::self()->acquire();
+    m_quickWindow->setTransientParent(parent ? parent->QQuickItem::window() : nullptr);
+    QQuickItem::setParentItem(m_quickWindow->contentItem());
+    setPosition(QPointF(0, 0));
+
+    // The item fills the window, whichever is resized
+    if (size().isEmpty())
+        syncGeometry();
+    else
+        m_quickWindow->resize(size());
+
+    connect(m_quickWindow, &QQuickWindow::widthChanged, this, &FloatingWindowQuick::syncGeometry);
+    connect(m_quickWindow, &QQuickWindow::heightChanged, this, &FloatingWindowQuick::syncGeometry);
+    connect(this, &QQuickItem::widthChanged, m_quickWindow, [this] {
+        m_quickWindow->resize(size());
+    });
+    connect(this, &QQuickItem::heightChanged, m_quickWindow, [this] {
+        m_quickWindow->resize(size());
+    });
+    connect(this, &QQuickItem::visibleChanged, m_quickWindow, [this] {
+        m_quickWindow->setVisible(isVisible());
+    });
+}
 
-void FloatingWindowQuick::init()
+void FloatingWindowQuick::syncGeometry()
 {
+    if (m_quickWindow->size() != size())
+        setSize(m_quickWindow->size());
 }
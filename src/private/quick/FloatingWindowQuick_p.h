@@ -23,6 +23,12 @@
 
 #include "FloatingWindow_p.h"
 
+#include <QPointer>
+
+QT_BEGIN_NAMESPACE
+class QQuickWindow;
+QT_END_NAMESPACE
+
 namespace KDDockWidgets {
 
 class DOCKS_EXPORT FloatingWindowQuick : public FloatingWindow
@@ -31,9 +37,15 @@ class DOCKS_EXPORT FloatingWindowQuick : public FloatingWindow
 public:
     explicit FloatingWindowQuick(QWidgetOrQuick *parent = nullptr);
     explicit FloatingWindowQuick(Frame *frame, QWidgetOrQuick *parent = nullptr);
+    ~FloatingWindowQuick() override;
+
+    ///@brief Returns the window hosting this floating window, from QuickWindowPool
+    QQuickWindow *quickWindow() const;
 
 private:
-    void init();
+    void init(QWidgetOrQuick *parent);
+    void syncGeometry();
+    QPointer<QQuickWindow> m_quickWindow;
     Q_DISABLE_COPY(FloatingWindowQuick)
 };
 
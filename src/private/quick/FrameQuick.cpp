@@ -26,7 +26,7 @@
  */
 
 #include "FrameQuick_p.h"
-#include "Config.h"
+#include "QmlComponentCache_p.h"
 
 #include <QDebug>
 
@@ -36,11 +36,7 @@ FrameQuick::FrameQuick(QWidgetAdapter *parent, Options options)
     : Frame(parent, options)
 {
     qDebug() << Q_FUNC_INFO << "Created frame";
-    auto component = new QQmlComponent(Config::self().qmlEngine(),
-                                       QUrl(QStringLiteral("qrc:/kddockwidgets/quick/qml/Frame.qml")));
-
-    auto item = static_cast<QQuickItem*>(component->create());
-    item->setProperty("frameCpp", QVariant::fromValue(this));
-    item->setParentItem(this);
-    item->setParent(this);
+    // Incubated asynchronously while restoring, so the property is set as an initial property
+    QmlComponentCache::create(QUrl(QStringLiteral("qrc:/kddockwidgets/quick/qml/Frame.qml")), this,
+                              { { QStringLiteral("frameCpp"), QVariant::fromValue(this) } });
 }
@@ -0,0 +1,235 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "QmlComponentCache_p.h"
+#include "Config.h"
+#include "LayoutSaver.h"
+
+#include <QDebug>
+#include <QPointer>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QQmlIncubator>
+#include <QQuickItem>
+#include <QTimer>
+
+using namespace KDDockWidgets;
+
+static int s_incubationBudget = 5;
+
+static void setInitialProperties(QObject *object, const QVariantMap &properties)
+{
+    for (auto it = properties.cbegin(), end = properties.cend(); it != end; ++it)
+        object->setProperty(it.key().toUtf8().constData(), it.value());
+}
+
+class QmlComponentCache::Incubator : public QQmlIncubator
+{
+public:
+    Incubator(QmlComponentCache *cache, QQuickItem *parent, const QVariantMap &initialProperties)
+        : QQmlIncubator(QQmlIncubator::Asynchronous)
+        , m_cache(cache)
+        , m_parent(parent)
+        , m_initialProperties(initialProperties)
+    {
+    }
+
+protected:
+    void setInitialState(QObject *object) override
+    {
+        setInitialProperties(object, m_initialProperties);
+    }
+
+    void statusChanged(Status status) override
+    {
+        if (status == Ready) {
+            auto item = qobject_cast<QQuickItem*>(object());
+            if (item && m_parent) {
+                item->setParentItem(m_parent);
+                item->setParent(m_parent);
+            } else {
+                // Parent was deleted meanwhile
+                delete object();
+            }
+        } else if (status == Error) {
+            qWarning() << Q_FUNC_INFO << "Failed to incubate" << errors();
+        }
+
+        if (status == Ready || status == Error) {
+            // Not deleted from within its own callback
+            QmlComponentCache *cache = m_cache;
+            QTimer::singleShot(0, cache, [cache, this] { cache->onIncubatorDone(this); });
+        }
+    }
+
+private:
+    QmlComponentCache *const m_cache;
+    const QPointer<QQuickItem> m_parent;
+    const QVariantMap m_initialProperties;
+};
+
+///@brief Incubates for a bounded time per event loop iteration. Only used if the engine has no controller.
+class QmlComponentCache::IncubationController : public QObject, public QQmlIncubationController
+{
+public:
+    IncubationController()
+    {
+        m_timer.setInterval(0);
+        connect(&m_timer, &QTimer::timeout, this, [this] {
+            incubateFor(s_incubationBudget);
+        });
+    }
+
+protected:
+    void incubatingObjectCountChanged(int count) override
+    {
+        if (count > 0)
+            m_timer.start();
+        else
+            m_timer.stop();
+    }
+
+private:
+    QTimer m_timer;
+};
+
+QmlComponentCache::QmlComponentCache(QQmlEngine *engine)
+    : QObject(engine)
+    , m_engine(engine)
+{
+    setObjectName(QStringLiteral("KDDockWidgets::QmlComponentCache"));
+}
+
+QmlComponentCache::~QmlComponentCache()
+{
+    m_incubators.clear();
+    if (m_incubationController && m_engine->incubationController() == m_incubationController.get())
+        m_engine->setIncubationController(nullptr);
+}
+
+QmlComponentCache *QmlComponentCache::forEngine(QQmlEngine *engine)
+{
+    if (!engine) {
+        qWarning() << Q_FUNC_INFO << "No QML engine. Call Config::setQmlEngine() first";
+        return nullptr;
+    }
+
+    if (auto cache = engine->findChild<QmlComponentCache*>(QString(), Qt::FindDirectChildrenOnly))
+        return cache;
+
+    return new QmlComponentCache(engine);
+}
+
+void QmlComponentCache::preload()
+{
+    component(QUrl(QStringLiteral("qrc:/kddockwidgets/quick/qml/Separator.qml")));
+    component(QUrl(QStringLiteral("qrc:/kddockwidgets/quick/qml/Frame.qml")));
+    component(QUrl(QStringLiteral("qrc:/kddockwidgets/quick/qml/TitleBar.qml")));
+}
+
+QQmlComponent *QmlComponentCache::component(const QUrl &url)
+{
+    QQmlComponent *&component = m_components[url];
+    if (!component) {
+        component = new QQmlComponent(m_engine, url, this);
+        if (component->isError())
+            qWarning() << Q_FUNC_INFO << "Failed to load" << url << component->errors();
+    }
+
+    return component;
+}
+
+QQuickItem *QmlComponentCache::createItem(const QUrl &url, QQuickItem *parent, const QVariantMap &initialProperties)
+{
+    QQmlComponent *c = component(url);
+    if (c->isError())
+        return nullptr;
+
+    if (LayoutSaver::restoreInProgress()) {
+        // Restoring creates many frames and separators at once, don't block the render loop meanwhile
+        if (!m_engine->incubationController()) {
+            m_incubationController.reset(new IncubationController());
+            m_engine->setIncubationController(m_incubationController.get());
+        }
+
+        m_incubators.emplace_back(new Incubator(this, parent, initialProperties));
+        c->create(*m_incubators.back());
+        return nullptr;
+    }
+
+    QObject *object = c->beginCreate(m_engine->rootContext());
+    auto item = qobject_cast<QQuickItem*>(object);
+    if (!item) {
+        qWarning() << Q_FUNC_INFO << "Failed to create" << url << c->errors();
+        delete object;
+        return nullptr;
+    }
+
+    setInitialProperties(item, initialProperties);
+    item->setParentItem(parent);
+    item->setParent(parent);
+    c->completeCreate();
+    return item;
+}
+
+QQuickItem *QmlComponentCache::create(const QUrl &url, QQuickItem *parent, const QVariantMap &initialProperties)
+{
+    QmlComponentCache *cache = forEngine(Config::self().qmlEngine());
+    return cache ? cache->createItem(url, parent, initialProperties) : nullptr;
+}
+
+int QmlComponentCache::numIncubating() const
+{
+    int count = 0;
+    for (const auto &incubator : m_incubators) {
+        if (incubator->isLoading())
+            count++;
+    }
+
+    return count;
+}
+
+void QmlComponentCache::flushIncubations()
+{
+    for (const auto &incubator : m_incubators) {
+        if (incubator->isLoading())
+            incubator->forceCompletion();
+    }
+}
+
+void QmlComponentCache::onIncubatorDone(Incubator *incubator)
+{
+    for (auto it = m_incubators.begin(); it != m_incubators.end(); ++it) {
+        if (it->get() == incubator) {
+            m_incubators.erase(it);
+            return;
+        }
+    }
+}
+
+void QmlComponentCache::setIncubationBudget(int ms)
+{
+    s_incubationBudget = qMax(1, ms);
+}
+
+int QmlComponentCache::incubationBudget()
+{
+    return s_incubationBudget;
+}
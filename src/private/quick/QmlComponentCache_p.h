@@ -0,0 +1,107 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief The QML components of the QtQuick frontend, compiled once per engine.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_QMLCOMPONENTCACHE_P_H
+#define KD_QMLCOMPONENTCACHE_P_H
+
+#include <QHash>
+#include <QObject>
+#include <QUrl>
+#include <QVariantMap>
+
+#include <memory>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+class QQmlComponent;
+class QQmlEngine;
+class QQmlIncubator;
+class QQuickItem;
+QT_END_NAMESPACE
+
+namespace KDDockWidgets {
+
+/**
+ * @brief Creates each QML component once and shares it between all items using it.
+ *
+ * Lives as a child of its QQmlEngine, so the components are deleted with the engine.
+ * Loaded from qrc, so pre-compiled QML is used when built with the Qt Quick Compiler.
+ *
+ * While a layout is being restored items are incubated asynchronously, so restoring a big layout
+ * doesn't block the render loop. They're parented once ready. The engine's incubation controller
+ * decides how much time is spent per frame, QQuickWindow's by default. If the engine has none,
+ * a timer based one incubating for incubationBudget() ms per event loop iteration is installed.
+ */
+class QmlComponentCache : public QObject
+{
+    Q_OBJECT
+public:
+    ///@brief Returns the cache of @p engine, creating it if needed
+    static QmlComponentCache *forEngine(QQmlEngine *engine);
+
+    ///@brief Compiles the components used by separators, frames and title bars already
+    void preload();
+
+    ///@brief Returns the component for @p url, compiling it on first use
+    QQmlComponent *component(const QUrl &url);
+
+    /**
+     * @brief Instantiates the component for @p url as a child of @p parent
+     * @p initialProperties are set before the item is completed.
+     * Returns nullptr if the QML had errors, or if the item is being incubated asynchronously,
+     * which is the case while a layout is being restored.
+     */
+    QQuickItem *createItem(const QUrl &url, QQuickItem *parent, const QVariantMap &initialProperties = {});
+
+    ///@brief Shortcut for forEngine(Config::self().qmlEngine())->createItem(...)
+    static QQuickItem *create(const QUrl &url, QQuickItem *parent, const QVariantMap &initialProperties = {});
+
+    ///@brief Returns how many items are still being incubated
+    int numIncubating() const;
+
+    ///@brief Incubates everything pending right away, blocking
+    void flushIncubations();
+
+    ///@brief Sets how many ms the fallback incubation controller spends per event loop iteration
+    static void setIncubationBudget(int ms);
+    static int incubationBudget();
+
+private:
+    explicit QmlComponentCache(QQmlEngine *engine);
+    ~QmlComponentCache() override;
+    class Incubator;
+    class IncubationController;
+    void onIncubatorDone(Incubator *);
+    QQmlEngine *const m_engine;
+    QHash<QUrl, QQmlComponent*> m_components;
+    std::vector<std::unique_ptr<Incubator>> m_incubators;
+    std::unique_ptr<IncubationController> m_incubationController;
+};
+
+}
+
+#endif
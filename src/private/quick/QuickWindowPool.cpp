@@ -0,0 +1,156 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "QuickWindowPool_p.h"
+#include "Config.h"
+#include "DragController_p.h"
+#include "Logging_p.h"
+#include "Utils_p.h"
+
+#include <QGuiApplication>
+#include <QQuickItem>
+#include <QQuickWindow>
+
+using namespace KDDockWidgets;
+
+// How long to wait before trying to refill again, if a drag is in progress
+static const int s_refillRetryInterval = 200;
+
+QuickWindowPool::QuickWindowPool(QObject *parent)
+    : QObject(parent)
+{
+    m_refillTimer.setSingleShot(true);
+    m_refillTimer.setInterval(0);
+    connect(&m_refillTimer, &QTimer::timeout, this, &QuickWindowPool::refill);
+
+    // By the time the application is destroyed, the windows can't be deleted safely anymore
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &QuickWindowPool::clear);
+}
+
+QuickWindowPool *QuickWindowPool::self()
+{
+    // A child of the application, so it and its timer don't outlive it
+    static QPointer<QuickWindowPool> s_pool;
+    if (!s_pool)
+        s_pool = new QuickWindowPool(qApp);
+
+    return s_pool;
+}
+
+QQuickWindow *QuickWindowPool::acquire()
+{
+    if (capacity() > 0)
+        scheduleRefill();
+
+    while (!m_windows.isEmpty()) {
+        if (QQuickWindow *window = m_windows.takeLast()) {
+            qCDebug(creation) << Q_FUNC_INFO << "Reusing" << window;
+            return window;
+        }
+    }
+
+    return createWindow();
+}
+
+void QuickWindowPool::release(QQuickWindow *window)
+{
+    if (!window)
+        return;
+
+    window->hide();
+    if (m_windows.size() >= capacity() || !window->contentItem()->childItems().isEmpty()) {
+        window->deleteLater();
+        return;
+    }
+
+    qCDebug(creation) << Q_FUNC_INFO << window;
+    m_windows.push_back(window);
+}
+
+void QuickWindowPool::scheduleRefill()
+{
+    if (!m_refillTimer.isActive())
+        m_refillTimer.start(0);
+}
+
+int QuickWindowPool::count() const
+{
+    int result = 0;
+    for (const QPointer<QQuickWindow> &window : m_windows) {
+        if (window)
+            result++;
+    }
+
+    return result;
+}
+
+void QuickWindowPool::clear()
+{
+    m_refillTimer.stop();
+    const QVector<QPointer<QQuickWindow>> windows = m_windows;
+    m_windows.clear();
+    for (const QPointer<QQuickWindow> &window : windows)
+        delete window.data();
+}
+
+void QuickWindowPool::refill()
+{
+    m_windows.removeAll(nullptr);
+
+    while (m_windows.size() > capacity())
+        delete m_windows.takeLast();
+
+    if (m_windows.size() == capacity())
+        return;
+
+    if (DragController::instance()->isDragging()) {
+        // Creating windows and contexts now would make the drag stutter
+        m_refillTimer.start(s_refillRetryInterval);
+        return;
+    }
+
+    static bool s_warned = false;
+    if (!s_warned && !QCoreApplication::testAttribute(Qt::AA_ShareOpenGLContexts)) {
+        s_warned = true;
+        qWarning() << Q_FUNC_INFO << "Qt::AA_ShareOpenGLContexts isn't set, the floating windows won't share GPU resources";
+    }
+
+    while (m_windows.size() < capacity()) {
+        QQuickWindow *window = createWindow();
+        window->create(); // The native window, the context and scene graph follow on the first show
+        m_windows.push_back(window);
+    }
+}
+
+int QuickWindowPool::capacity() const
+{
+    return Config::self().floatingWindowPoolSize();
+}
+
+QQuickWindow *QuickWindowPool::createWindow() const
+{
+    auto window = new QQuickWindow();
+    window->setFlags(KDDockWidgets::usesNativeDraggingAndResizing() ? Qt::Window : Qt::Tool);
+
+    // Hiding would otherwise release them, and showing again would pay for them again
+    window->setPersistentOpenGLContext(true);
+    window->setPersistentSceneGraph(true);
+    return window;
+}
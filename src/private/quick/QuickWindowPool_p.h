@@ -0,0 +1,89 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief The QQuickWindows hosting the floating windows of the QtQuick frontend.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_QUICKWINDOWPOOL_P_H
+#define KD_QUICKWINDOWPOOL_P_H
+
+#include "docks_export.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QQuickWindow;
+QT_END_NAMESPACE
+
+namespace KDDockWidgets {
+
+/**
+ * @brief Keeps a few hidden QQuickWindows around, so floating a dock widget doesn't need to create
+ * a window, its OpenGL context and its scene graph. See Config::setFloatingWindowPoolSize().
+ *
+ * The windows keep their context and scene graph while hidden, so reusing one skips the slow first
+ * frame too. With Qt::AA_ShareOpenGLContexts set before the QGuiApplication is created, all the
+ * contexts are shared with the global one, so textures uploaded through it aren't duplicated per
+ * window. The glyph caches and texture atlases are per scene graph render context, which the
+ * "basic" render loop (QSG_RENDER_LOOP=basic) shares between all windows.
+ *
+ * The pool is a child of the application, and deletes its windows on QCoreApplication::aboutToQuit().
+ */
+class DOCKS_EXPORT_FOR_UNIT_TESTS QuickWindowPool : public QObject
+{
+    Q_OBJECT
+public:
+    static QuickWindowPool *self();
+
+    ///@brief Returns a window for a floating window. Reuses a pooled one if possible.
+    QQuickWindow *acquire();
+
+    ///@brief Called once @p window hosts nothing anymore. It's either hidden and taken back into
+    /// the pool or deleted.
+    void release(QQuickWindow *window);
+
+    ///@brief Creates or deletes pooled windows until the pool matches Config::floatingWindowPoolSize()
+    void scheduleRefill();
+
+    ///@brief Returns the number of windows currently in the pool
+    int count() const;
+
+    ///@brief Deletes the pooled windows. Until the next scheduleRefill().
+    void clear();
+
+private:
+    explicit QuickWindowPool(QObject *parent);
+    void refill();
+    int capacity() const;
+    QQuickWindow *createWindow() const;
+    QVector<QPointer<QQuickWindow>> m_windows;
+    QTimer m_refillTimer;
+};
+
+}
+
+#endif
@@ -21,21 +21,16 @@
 #include "SeparatorQuick_p.h"
 #include "multisplitter/MultiSplitterLayout_p.h"
 #include "multisplitter/Anchor_p.h"
+#include "multisplitter/Separator_p.h"
 #include "Logging_p.h"
-#include "Config.h"
-
-#include <QQmlComponent>
+#include "QmlComponentCache_p.h"
 
 using namespace KDDockWidgets;
 
 SeparatorQuick::SeparatorQuick(KDDockWidgets::Anchor *anchor, QWidgetAdapter *parent)
     : Separator(anchor, parent)
 {
-    auto component = new QQmlComponent(Config::self().qmlEngine(),
-                                       QUrl(QStringLiteral("qrc:/kddockwidgets/quick/qml/Separator.qml")));
-
-
-    auto separatorItem = static_cast<QQuickItem*>(component->create());
-    separatorItem->setParentItem(this);
-    separatorItem->setParent(this);
+    // Otherwise SeparatorsItemQuick draws all of them
+    if (!Layouting::Separator::usesHostPainting)
+        QmlComponentCache::create(QUrl(QStringLiteral("qrc:/kddockwidgets/quick/qml/Separator.qml")), this);
 }
@@ -0,0 +1,203 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SeparatorsItemQuick_p.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
+#include "multisplitter/Separator_p.h"
+
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QSGSimpleRectNode>
+
+using namespace KDDockWidgets;
+
+namespace {
+
+// The first child of the root node draws the separators, the second the rubber band
+class SeparatorsNode : public QSGGeometryNode
+{
+public:
+    SeparatorsNode()
+        : m_geometry(QSGGeometry::defaultAttributes_Point2D(), 0)
+    {
+        m_geometry.setDrawingMode(QSGGeometry::DrawTriangles);
+        setGeometry(&m_geometry);
+        setMaterial(&m_material);
+    }
+
+    void setRects(const QVector<QRect> &rects, const QColor &color)
+    {
+        // Two triangles per separator, all in one draw call
+        m_geometry.allocate(rects.size() * 6);
+        QSGGeometry::Point2D *v = m_geometry.vertexDataAsPoint2D();
+        for (const QRect &r : rects) {
+            const float left = r.x();
+            const float top = r.y();
+            const float right = r.x() + r.width();
+            const float bottom = r.y() + r.height();
+            (v++)->set(left, top);
+            (v++)->set(right, top);
+            (v++)->set(left, bottom);
+            (v++)->set(right, top);
+            (v++)->set(right, bottom);
+            (v++)->set(left, bottom);
+        }
+
+        if (m_material.color() != color) {
+            m_material.setColor(color);
+            markDirty(DirtyMaterial);
+        }
+
+        markDirty(DirtyGeometry);
+    }
+
+private:
+    QSGGeometry m_geometry;
+    QSGFlatColorMaterial m_material;
+};
+
+}
+
+SeparatorsItemQuick::SeparatorsItemQuick(MultiSplitterLayout *layout, QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_layout(layout)
+{
+    setFlag(ItemHasContents);
+    setAcceptedMouseButtons(Qt::LeftButton);
+    setAcceptHoverEvents(true); // For the resize cursor
+    setZ(1000); // Above the frames
+}
+
+QColor SeparatorsItemQuick::separatorColor() const
+{
+    return m_separatorColor;
+}
+
+void SeparatorsItemQuick::setSeparatorColor(const QColor &color)
+{
+    if (m_separatorColor != color) {
+        m_separatorColor = color;
+        update();
+        Q_EMIT separatorColorChanged();
+    }
+}
+
+void SeparatorsItemQuick::setRubberBand(QRect rect)
+{
+    if (m_rubberBand != rect) {
+        m_rubberBand = rect;
+        update();
+    }
+}
+
+Layouting::Separator *SeparatorsItemQuick::separatorAt(QPoint localPos) const
+{
+    const auto separators = m_layout->separators();
+    for (Layouting::Separator *separator : separators) {
+        if (separator->geometry().contains(localPos))
+            return separator;
+    }
+
+    return nullptr;
+}
+
+QSGNode *SeparatorsItemQuick::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    // The GUI thread is blocked while this runs, so the layout can be read
+    QSGNode *root = oldNode;
+    if (!root) {
+        root = new QSGNode();
+        root->appendChildNode(new SeparatorsNode());
+    }
+
+    QVector<QRect> rects;
+    const auto separators = m_layout->separators();
+    rects.reserve(separators.size());
+    for (Layouting::Separator *separator : separators)
+        rects.push_back(separator->geometry());
+
+    static_cast<SeparatorsNode*>(root->firstChild())->setRects(rects, m_separatorColor);
+
+    auto rubberBand = static_cast<QSGSimpleRectNode*>(root->firstChild()->nextSibling());
+    if (m_rubberBand.isNull()) {
+        delete rubberBand;
+    } else {
+        if (!rubberBand) {
+            rubberBand = new QSGSimpleRectNode();
+            rubberBand->setColor(QColor(0, 0, 255, 60));
+            root->appendChildNode(rubberBand);
+        }
+
+        rubberBand->setRect(m_rubberBand);
+    }
+
+    return root;
+}
+
+void SeparatorsItemQuick::mousePressEvent(QMouseEvent *ev)
+{
+    if (Layouting::Separator *separator = separatorAt(ev->pos())) {
+        m_separatorBeingDragged = separator;
+        separator->onMousePressed();
+        return;
+    }
+
+    ev->ignore(); // For the items below
+}
+
+void SeparatorsItemQuick::mouseMoveEvent(QMouseEvent *ev)
+{
+    if (m_separatorBeingDragged) {
+        m_separatorBeingDragged->onMouseMoved(ev->pos(), ev->buttons());
+        update();
+    } else {
+        ev->ignore();
+    }
+}
+
+void SeparatorsItemQuick::mouseReleaseEvent(QMouseEvent *ev)
+{
+    if (m_separatorBeingDragged) {
+        m_separatorBeingDragged->onMouseReleased();
+        m_separatorBeingDragged = nullptr;
+        update();
+    } else {
+        ev->ignore();
+    }
+}
+
+void SeparatorsItemQuick::mouseDoubleClickEvent(QMouseEvent *ev)
+{
+    if (Layouting::Separator *separator = separatorAt(ev->pos())) {
+        separator->onMouseDoubleClicked();
+        update();
+    } else {
+        ev->ignore();
+    }
+}
+
+void SeparatorsItemQuick::hoverMoveEvent(QHoverEvent *ev)
+{
+    Layouting::Separator *separator = separatorAt(ev->pos());
+    const Qt::CursorShape shape = separator ? (separator->isVertical() ? Qt::SizeVerCursor : Qt::SizeHorCursor)
+                                            : Qt::ArrowCursor;
+    if (cursor().shape() != shape)
+        setCursor(shape);
+}
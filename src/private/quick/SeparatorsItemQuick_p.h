@@ -0,0 +1,87 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief A QtQuick item drawing all separators of a layout with the scene graph.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_SEPARATORSITEMQUICK_P_H
+#define KD_SEPARATORSITEMQUICK_P_H
+
+#include <QColor>
+#include <QPointer>
+#include <QQuickItem>
+
+namespace Layouting {
+class Separator;
+}
+
+namespace KDDockWidgets {
+
+class MultiSplitterLayout;
+
+/**
+ * @brief Draws all separators of a MultiSplitter, and optionally a rubber band, as batched
+ * scene graph geometry. Used with Config::Flag_HostPaintedSeparators.
+ *
+ * Instead of an item hierarchy per separator there's one item per layout, covering it. The
+ * separators are hit-tested here and receive their mouse events from this item. Events elsewhere
+ * are ignored, so they reach the items below.
+ */
+class SeparatorsItemQuick : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QColor separatorColor READ separatorColor WRITE setSeparatorColor NOTIFY separatorColorChanged)
+public:
+    explicit SeparatorsItemQuick(MultiSplitterLayout *layout, QQuickItem *parent);
+
+    QColor separatorColor() const;
+    void setSeparatorColor(const QColor &);
+
+    ///@brief Shows a rubber band at @p rect, in local coordinates. Null hides it.
+    void setRubberBand(QRect rect);
+
+    ///@brief Returns the separator at @p localPos, if any
+    Layouting::Separator *separatorAt(QPoint localPos) const;
+
+Q_SIGNALS:
+    void separatorColorChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *, UpdatePaintNodeData *) override;
+    void mousePressEvent(QMouseEvent *) override;
+    void mouseMoveEvent(QMouseEvent *) override;
+    void mouseReleaseEvent(QMouseEvent *) override;
+    void mouseDoubleClickEvent(QMouseEvent *) override;
+    void hoverMoveEvent(QHoverEvent *) override;
+
+private:
+    MultiSplitterLayout *const m_layout;
+    QPointer<Layouting::Separator> m_separatorBeingDragged;
+    QColor m_separatorColor = Qt::lightGray;
+    QRect m_rubberBand;
+};
+
+}
+
+#endif
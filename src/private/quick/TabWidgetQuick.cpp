@@ -78,6 +78,10 @@ void TabWidgetQuick::insertDockWidget(int , DockWidgetBase *,
 
 }
 
+void TabWidgetQuick::moveDockWidget(int, int)
+{
+}
+
 void TabWidgetQuick::setTabBarAutoHide(bool)
 {
 }
@@ -49,6 +49,7 @@ protected:
     bool isPositionDraggable(QPoint p) const override;
     void setCurrentDockWidget(int index) override;
     void insertDockWidget(int index, DockWidgetBase *, const QIcon&, const QString &title) override;
+    void moveDockWidget(int from, int to) override;
     void setTabBarAutoHide(bool) override;
     void detachTab(DockWidgetBase *dockWidget) override;
 
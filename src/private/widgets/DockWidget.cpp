@@ -22,6 +22,7 @@
 
 #include <QCloseEvent>
 #include <QVBoxLayout>
+#include <QWindow>
 
 /**
  * @file
@@ -42,7 +43,58 @@ public:
         layout->setContentsMargins(0, 0, 0, 0);
     }
 
+    ///@brief Puts @p w into contentHolder, creating it on first use. See Option_StableContentWindow
+    void addToContentHolder(DockWidget *q, QWidget *w)
+    {
+        if (!contentHolder) {
+            // A top-level which is never reparented, so its native window, backing store and
+            // GL contexts survive docking. Only its QWindow is embedded, via a lightweight container
+            // which is what moves between frames and windows.
+            contentHolder = new QWidget();
+            contentHolder->setObjectName(QStringLiteral("contentHolder"));
+            auto holderLayout = new QVBoxLayout(contentHolder);
+            holderLayout->setSpacing(0);
+            holderLayout->setContentsMargins(0, 0, 0, 0);
+            contentHolder->winId();
+
+            contentContainer = QWidget::createWindowContainer(contentHolder->windowHandle(), q);
+            contentContainer->setObjectName(QStringLiteral("contentContainer"));
+            layout->addWidget(contentContainer);
+            // The QWindow has a parent now, so this doesn't create a top-level. It's only exposed
+            // while the container is visible.
+            contentHolder->show();
+        }
+
+        contentHolder->layout()->addWidget(w);
+    }
+
+    ///@brief Moves the hosted widget in or out of contentHolder, after Option_StableContentWindow changed
+    void updateContentHolder(DockWidget *q)
+    {
+        const bool wantsHolder = q->options() & Option_StableContentWindow;
+        if (wantsHolder == (contentHolder != nullptr))
+            return;
+
+        QWidget *w = q->widget();
+        if (wantsHolder) {
+            if (w)
+                addToContentHolder(q, w);
+            return;
+        }
+
+        if (w)
+            layout->addWidget(w);
+
+        // The container would delete the holder's QWindow, which belongs to the holder
+        delete contentHolder;
+        contentHolder = nullptr;
+        delete contentContainer;
+        contentContainer = nullptr;
+    }
+
     QVBoxLayout *const layout;
+    QWidget *contentHolder = nullptr;
+    QWidget *contentContainer = nullptr;
 };
 
 DockWidget::DockWidget(const QString &name, Options options)
@@ -50,12 +102,24 @@ DockWidget::DockWidget(const QString &name, Options options)
     , d(new Private(this))
 {
     connect(this, &DockWidgetBase::widgetChanged, this, [this] (QWidget *w) {
-        d->layout->addWidget(w);
+        if (!w) // nullptr when unloaded, see setWidgetFactory()
+            return;
+
+        if (this->options() & Option_StableContentWindow)
+            d->addToContentHolder(this, w);
+        else
+            d->layout->addWidget(w);
+    });
+
+    connect(this, &DockWidgetBase::optionsChanged, this, [this] {
+        d->updateContentHolder(this);
     });
 }
 
 DockWidget::~DockWidget()
 {
+    // Not our child, deletes the hosted widget too
+    delete d->contentHolder;
     delete d;
 }
 
@@ -23,6 +23,8 @@
 #include "Utils_p.h"
 #include "DropArea_p.h"
 #include "TitleBar_p.h"
+#include "DockRegistry_p.h"
+#include "Config.h"
 
 #include <QApplication>
 #include <QPainter>
@@ -54,14 +56,38 @@ void FloatingWindowWidget::paintEvent(QPaintEvent *)
 
 bool FloatingWindowWidget::event(QEvent *ev)
 {
-    if (ev->type() == QEvent::WindowStateChange)
+    if (ev->type() == QEvent::WindowStateChange) {
         Q_EMIT windowStateChanged(static_cast<QWindowStateChangeEvent*>(ev));
+    } else if (ev->type() == QEvent::Show) {
+        m_releaseTimer.stop();
+    } else if (ev->type() == QEvent::Hide && !ev->spontaneous()) {
+        // Spontaneous hides are minimizations, which keep their resources
+        const int delay = Config::self().hiddenFloatingWindowReleaseDelay();
+        if (delay >= 0)
+            m_releaseTimer.start(delay);
+    }
 
     return FloatingWindow::event(ev);
 }
 
+void FloatingWindowWidget::releaseNativeResources()
+{
+    if (isVisible() || beingDeleted() || !testAttribute(Qt::WA_WState_Created))
+        return;
+
+    // Pooled windows are unregistered, and are hidden precisely to keep their native window ready
+    if (!DockRegistry::self()->nestedwindows().contains(this))
+        return;
+
+    qCDebug(hiding) << Q_FUNC_INFO << "Releasing the native window of" << this;
+    destroy(/*destroyWindow=*/ true, /*destroySubWindows=*/ true);
+}
+
 void FloatingWindowWidget::init()
 {
+    m_releaseTimer.setSingleShot(true);
+    connect(&m_releaseTimer, &QTimer::timeout, this, &FloatingWindowWidget::releaseNativeResources);
+
     m_vlayout->setSpacing(0);
     m_vlayout->setContentsMargins(0, 0, 0, 0);
     m_vlayout->addWidget(m_titleBar);
@@ -23,6 +23,8 @@
 
 #include "FloatingWindow_p.h"
 
+#include <QTimer>
+
 QT_BEGIN_NAMESPACE
 class QVBoxLayout;
 QT_END_NAMESPACE
@@ -41,8 +43,11 @@ protected:
     bool event(QEvent *ev) override;
 private:
     void init();
+    ///@brief Destroys the native window and backing store, if still hidden. See Config::setHiddenFloatingWindowReleaseDelay()
+    void releaseNativeResources();
     Q_DISABLE_COPY(FloatingWindowWidget)
     QVBoxLayout *const m_vlayout;
+    QTimer m_releaseTimer;
 };
 
 }
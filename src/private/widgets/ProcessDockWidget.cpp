@@ -0,0 +1,210 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ProcessDockWidget.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QLabel>
+#include <QProcess>
+#include <QVBoxLayout>
+#include <QWindow>
+
+/**
+ * @file
+ * @brief A dock widget whose content runs in a separate process.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+using namespace KDDockWidgets;
+
+// The line announceWindow() writes to stdout, followed by the window id
+static const char s_announcePrefix[] = "KDDockWidgets-embed ";
+
+class ProcessDockWidget::Private
+{
+public:
+    Private(ProcessDockWidget *qq, const QString &program_, const QStringList &arguments_)
+        : q(qq)
+        , program(program_)
+        , arguments(arguments_)
+        , host(new QWidget())
+        , message(new QLabel(host))
+        , process(new QProcess(qq))
+    {
+        auto layout = new QVBoxLayout(host);
+        layout->setSpacing(0);
+        layout->setContentsMargins(0, 0, 0, 0);
+        message->setAlignment(Qt::AlignCenter);
+        message->setWordWrap(true);
+        layout->addWidget(message);
+
+        // stdout is for announceWindow(), the rest of the output goes to ours
+        process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        QObject::connect(process, &QProcess::readyReadStandardOutput, qq, [this] { readOutput(); });
+        QObject::connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                         qq, [this] (int exitCode, QProcess::ExitStatus status) { onFinished(exitCode, status); });
+        QObject::connect(process, &QProcess::errorOccurred, qq, [this] (QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart)
+                showMessage(tr("Failed to start %1").arg(this->program));
+        });
+    }
+
+    void start()
+    {
+        started = true;
+        showMessage(tr("Starting %1...").arg(program));
+        process->start(program, arguments);
+    }
+
+    void readOutput()
+    {
+        while (process->canReadLine()) {
+            const QByteArray line = process->readLine().trimmed();
+            if (!line.startsWith(s_announcePrefix))
+                continue;
+
+            bool ok = false;
+            const WId id = WId(line.mid(int(sizeof(s_announcePrefix)) - 1).toULongLong(&ok));
+            if (ok && id) {
+                embed(id);
+            } else {
+                qWarning() << Q_FUNC_INFO << "Invalid window id from" << program << line;
+            }
+        }
+    }
+
+    void embed(WId id)
+    {
+        unembed();
+
+        QWindow *window = QWindow::fromWinId(id);
+        if (!window) {
+            qWarning() << Q_FUNC_INFO << "Can't embed the window of" << program;
+            return;
+        }
+
+        container = QWidget::createWindowContainer(window, host);
+        container->setObjectName(QStringLiteral("processContainer"));
+        host->layout()->addWidget(container);
+        message->hide();
+        Q_EMIT q->embedded();
+    }
+
+    void unembed()
+    {
+        // Takes the foreign QWindow along, which leaves the native window alone
+        delete container;
+        container = nullptr;
+    }
+
+    void onFinished(int exitCode, QProcess::ExitStatus status)
+    {
+        unembed();
+        showMessage(status == QProcess::CrashExit ? tr("%1 crashed").arg(program)
+                                                  : tr("%1 exited with code %2").arg(program).arg(exitCode));
+    }
+
+    void showMessage(const QString &text)
+    {
+        message->setText(text);
+        message->show();
+    }
+
+    ProcessDockWidget *const q;
+    const QString program;
+    const QStringList arguments;
+    QWidget *const host;
+    QLabel *const message;
+    QProcess *const process;
+    QWidget *container = nullptr;
+    bool started = false;
+};
+
+ProcessDockWidget::ProcessDockWidget(const QString &uniqueName, const QString &program,
+                                     const QStringList &arguments, Options options)
+    : DockWidget(uniqueName, options)
+    , d(new Private(this, program, arguments))
+{
+    setWidget(d->host);
+
+    // Processes of dock widgets that are restored closed are only started if they're ever opened
+    connect(this, &DockWidgetBase::shown, this, [this] {
+        if (!d->started)
+            d->start();
+    });
+}
+
+ProcessDockWidget::~ProcessDockWidget()
+{
+    d->process->disconnect(this);
+    d->unembed();
+    if (d->process->state() != QProcess::NotRunning) {
+        // A hung panel mustn't hang us too
+        d->process->terminate();
+        if (!d->process->waitForFinished(500))
+            d->process->kill();
+    }
+
+    delete d;
+}
+
+QProcess *ProcessDockWidget::process() const
+{
+    return d->process;
+}
+
+bool ProcessDockWidget::isEmbedded() const
+{
+    return d->container != nullptr;
+}
+
+void ProcessDockWidget::restart()
+{
+    if (d->process->state() != QProcess::NotRunning)
+        return;
+
+    if (isVisible()) {
+        d->start();
+    } else {
+        d->started = false;
+    }
+}
+
+void ProcessDockWidget::announceWindow(QWindow *window)
+{
+    if (!window) {
+        qWarning() << Q_FUNC_INFO << "Null window";
+        return;
+    }
+
+    QFile out;
+    if (!out.open(stdout, QIODevice::WriteOnly)) {
+        qWarning() << Q_FUNC_INFO << "Can't write to stdout";
+        return;
+    }
+
+    QByteArray line(s_announcePrefix);
+    line += QByteArray::number(quint64(window->winId()));
+    line += '\n';
+    out.write(line);
+    out.flush();
+}
@@ -35,10 +35,19 @@ SeparatorWidget::SeparatorWidget(QWidget *parent)
 void SeparatorWidget::paintEvent(QPaintEvent *)
 {
     QPainter p(this);
+    paint(&p, rect());
+}
 
+void SeparatorWidget::paintOnHost(QPainter *p)
+{
+    paint(p, geometry());
+}
+
+void SeparatorWidget::paint(QPainter *p, QRect rect)
+{
     QStyleOption opt;
     opt.palette = palette();
-    opt.rect = rect();
+    opt.rect = rect;
     opt.state = QStyle::State_None;
     if (!isVertical())
         opt.state |= QStyle::State_Horizontal;
@@ -46,7 +55,7 @@ void SeparatorWidget::paintEvent(QPaintEvent *)
     if (isEnabled())
         opt.state |= QStyle::State_Enabled;
 
-    parentWidget()->style()->drawControl(QStyle::CE_Splitter, &opt, &p, this);
+    parentWidget()->style()->drawControl(QStyle::CE_Splitter, &opt, p, this);
 }
 
 void SeparatorWidget::enterEvent(QEvent *)
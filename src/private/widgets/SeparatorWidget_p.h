@@ -35,11 +35,15 @@ class DOCKS_EXPORT SeparatorWidget : public Layouting::Separator
     Q_OBJECT
 public:
     explicit SeparatorWidget(QWidget *parent = nullptr);
+    void paintOnHost(QPainter *) override;
 
 protected:
     void paintEvent(QPaintEvent *) override;
     void enterEvent(QEvent *) override;
     void leaveEvent(QEvent *) override;
+
+private:
+    void paint(QPainter *, QRect);
 };
 
 }
@@ -31,6 +31,7 @@
 
 #include <QMouseEvent>
 #include <QApplication>
+#include <QEvent>
 #include <QProxyStyle>
 
 namespace KDDockWidgets {
@@ -104,6 +105,40 @@ void TabBarWidget::mouseMoveEvent(QMouseEvent *e)
     }
 }
 
+QSize TabBarWidget::tabSizeHint(int index) const
+{
+    if (!(Config::self().flags() & Config::Flag_ScalableTabs))
+        return QTabBar::tabSizeHint(index);
+
+    const SizeHintKey key = { tabText(index), tabIcon(index).cacheKey(), iconSize(), shape(), elideMode() };
+    auto it = m_sizeHintCache.constFind(key);
+    if (it != m_sizeHintCache.cend())
+        return *it;
+
+    // Don't keep the sizes of long gone tabs around
+    if (m_sizeHintCache.size() > 2 * count() + 16)
+        m_sizeHintCache.clear();
+
+    const QSize size = QTabBar::tabSizeHint(index);
+    m_sizeHintCache.insert(key, size);
+    return size;
+}
+
+void TabBarWidget::changeEvent(QEvent *ev)
+{
+    switch (ev->type()) {
+    case QEvent::FontChange:
+    case QEvent::StyleChange:
+    case QEvent::LanguageChange:
+        m_sizeHintCache.clear();
+        break;
+    default:
+        break;
+    }
+
+    QTabBar::changeEvent(ev);
+}
+
 bool TabBarWidget::dragCanStart(QPoint pressPos, QPoint pos) const
 {
     // Here we allow the user to re-order tabs instead of dragging them off.
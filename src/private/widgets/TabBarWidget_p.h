@@ -31,6 +31,7 @@
 
 #include "../TabWidget_p.h"
 
+#include <QHash>
 #include <QTabBar>
 
 QT_BEGIN_NAMESPACE
@@ -54,6 +55,35 @@ protected:
     void mousePressEvent(QMouseEvent *) override;
     void mouseMoveEvent(QMouseEvent *e) override;
 
+    ///@brief With Config::Flag_ScalableTabs the size of each distinct tab is only measured once.
+    ///QTabBar asks for every tab's size hint whenever a single tab is inserted or removed.
+    QSize tabSizeHint(int index) const override;
+    void changeEvent(QEvent *) override;
+
+private:
+    // What QTabBar::tabSizeHint() depends on, besides the font and the style. QTabBar's setters
+    // aren't virtual, so they're part of the key instead of clearing the cache.
+    struct SizeHintKey {
+        QString text;
+        qint64 iconCacheKey;
+        QSize iconSize;
+        QTabBar::Shape shape;
+        Qt::TextElideMode elideMode;
+
+        bool operator==(const SizeHintKey &other) const
+        {
+            return text == other.text && iconCacheKey == other.iconCacheKey && iconSize == other.iconSize
+                   && shape == other.shape && elideMode == other.elideMode;
+        }
+
+        friend uint qHash(const SizeHintKey &key, uint seed = 0)
+        {
+            return qHash(key.text, seed) ^ qHash(key.iconCacheKey, seed)
+                   ^ qHash((key.iconSize.width() << 16) ^ key.iconSize.height(), seed)
+                   ^ qHash((int(key.shape) << 8) | int(key.elideMode), seed);
+        }
+    };
+    mutable QHash<SizeHintKey, QSize> m_sizeHintCache;
 };
 }
 
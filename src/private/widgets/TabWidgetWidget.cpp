@@ -30,8 +30,101 @@
 #include "Config.h"
 #include "FrameworkWidgetFactory.h"
 
+#include <QFrame>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QListView>
+#include <QSortFilterProxyModel>
+#include <QTabBar>
+#include <QStringListModel>
+#include <QToolButton>
+#include <QVBoxLayout>
+
 using namespace KDDockWidgets;
 
+namespace {
+///@brief The popup listing all tabs of a TabWidgetWidget, filtered by what's typed. See Config::Flag_ScalableTabs
+class TabListPopup : public QFrame // clazy:exclude=missing-qobject-macro
+{
+public:
+    explicit TabListPopup(TabWidgetWidget *tabWidget)
+        : QFrame(tabWidget, Qt::Popup)
+        , m_tabWidget(tabWidget)
+        , m_lineEdit(new QLineEdit(this))
+        , m_view(new QListView(this))
+    {
+        setObjectName(QStringLiteral("_docks_TabListPopup"));
+        setAttribute(Qt::WA_DeleteOnClose);
+        setFrameStyle(QFrame::StyledPanel);
+
+        // The titles are only collected now, so the tab bar itself doesn't maintain any model
+        QStringList titles;
+        titles.reserve(tabWidget->count());
+        for (int i = 0; i < tabWidget->count(); ++i)
+            titles << tabWidget->tabText(i);
+
+        m_model.setStringList(titles);
+        m_proxy.setSourceModel(&m_model);
+        m_proxy.setFilterCaseSensitivity(Qt::CaseInsensitive);
+        m_view->setModel(&m_proxy);
+        m_view->setUniformItemSizes(true); // So it doesn't measure every row
+        m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        m_view->setCurrentIndex(m_proxy.mapFromSource(m_model.index(tabWidget->currentIndex())));
+
+        m_lineEdit->setPlaceholderText(tr("Search"));
+        m_lineEdit->setClearButtonEnabled(true);
+        m_lineEdit->installEventFilter(this);
+
+        auto layout = new QVBoxLayout(this);
+        layout->setContentsMargins(2, 2, 2, 2);
+        layout->setSpacing(2);
+        layout->addWidget(m_lineEdit);
+        layout->addWidget(m_view);
+
+        connect(m_lineEdit, &QLineEdit::textChanged, this, [this] (const QString &text) {
+            m_proxy.setFilterFixedString(text);
+            if (!m_view->currentIndex().isValid())
+                m_view->setCurrentIndex(m_proxy.index(0, 0));
+        });
+        connect(m_lineEdit, &QLineEdit::returnPressed, this, [this] {
+            activate(m_view->currentIndex());
+        });
+        connect(m_view, &QListView::activated, this, &TabListPopup::activate);
+        connect(m_view, &QListView::clicked, this, &TabListPopup::activate);
+    }
+
+protected:
+    bool eventFilter(QObject *o, QEvent *ev) override
+    {
+        // Up and down browse the list while typing
+        if (o == m_lineEdit && ev->type() == QEvent::KeyPress) {
+            const int key = static_cast<QKeyEvent*>(ev)->key();
+            if (key == Qt::Key_Up || key == Qt::Key_Down || key == Qt::Key_PageUp || key == Qt::Key_PageDown) {
+                QCoreApplication::sendEvent(m_view, ev);
+                return true;
+            }
+        }
+
+        return QFrame::eventFilter(o, ev);
+    }
+
+private:
+    void activate(const QModelIndex &proxyIndex)
+    {
+        const QModelIndex index = m_proxy.mapToSource(proxyIndex);
+        if (index.isValid() && index.row() < m_tabWidget->count())
+            m_tabWidget->setCurrentIndex(index.row());
+        close();
+    }
+
+    TabWidgetWidget *const m_tabWidget;
+    QLineEdit *const m_lineEdit;
+    QListView *const m_view;
+    QStringListModel m_model;
+    QSortFilterProxyModel m_proxy;
+};
+}
+
 TabWidgetWidget::TabWidgetWidget(Frame *parent)
     : QTabWidget(parent)
     , TabWidget(this, parent)
@@ -39,6 +132,7 @@ TabWidgetWidget::TabWidgetWidget(Frame *parent)
 {
     setTabBar(static_cast<QTabBar*>(m_tabBar->asWidget()));
     setTabsClosable(Config::self().flags() & Config::Flag_TabsHaveCloseButton);
+    connect(QTabWidget::tabBar(), &QTabBar::tabMoved, this, [this] { onTabMoved(); });
 
     // In case tabs closable is set by the factory, a tabClosedRequested() is emitted when the user presses [x]
     connect(this, &QTabWidget::tabCloseRequested, this, [this] (int index) {
@@ -53,6 +147,18 @@ TabWidgetWidget::TabWidgetWidget(Frame *parent)
         }
     });
 
+    if (Config::self().flags() & Config::Flag_ScalableTabs) {
+        // The tabs that don't fit are scrolled, this lists them all
+        QTabWidget::tabBar()->setUsesScrollButtons(true);
+        m_tabListButton = new QToolButton(this);
+        m_tabListButton->setObjectName(QStringLiteral("_docks_TabListButton"));
+        m_tabListButton->setArrowType(Qt::DownArrow);
+        m_tabListButton->setAutoRaise(true);
+        m_tabListButton->setToolTip(tr("All tabs"));
+        connect(m_tabListButton, &QToolButton::clicked, this, &TabWidgetWidget::showTabList);
+        setCornerWidget(m_tabListButton, Qt::TopRightCorner);
+        updateTabListButton();
+    }
 }
 
 TabBar *TabWidgetWidget::tabBar() const
@@ -75,6 +181,26 @@ int TabWidgetWidget::indexOfDockWidget(DockWidgetBase *dw) const
     return indexOf(dw);
 }
 
+void TabWidgetWidget::showTabList()
+{
+    if (!m_tabListButton || count() == 0)
+        return;
+
+    auto popup = new TabListPopup(this);
+    const int width = qMax(200, m_tabListButton->width());
+    popup->resize(width, 300);
+    const QPoint bottomRight = m_tabListButton->mapToGlobal(m_tabListButton->rect().bottomRight());
+    popup->move(bottomRight.x() - width + 1, bottomRight.y() + 1);
+    popup->show();
+}
+
+void TabWidgetWidget::updateTabListButton()
+{
+    // Only useful when there's something to choose from, like the tab bar itself
+    if (m_tabListButton)
+        m_tabListButton->setVisible(count() > 1);
+}
+
 void TabWidgetWidget::paintEvent(QPaintEvent *p)
 {
     // When count is 1 we want to use the same background as a regular QWidget
@@ -86,11 +212,13 @@ void TabWidgetWidget::paintEvent(QPaintEvent *p)
 void TabWidgetWidget::tabInserted(int)
 {
     onTabInserted();
+    updateTabListButton();
 }
 
 void TabWidgetWidget::tabRemoved(int)
 {
     onTabRemoved();
+    updateTabListButton();
 }
 
 bool TabWidgetWidget::isPositionDraggable(QPoint p) const
@@ -105,6 +233,9 @@ bool TabWidgetWidget::isPositionDraggable(QPoint p) const
 
 void TabWidgetWidget::setCurrentDockWidget(int index)
 {
+    // Background tabs are already resized lazily: QStackedLayout only resizes the current page,
+    // and the others only get their resize event once shown, so they don't relayout while the
+    // frame is resized.
     setCurrentIndex(index);
 }
 
@@ -114,6 +245,12 @@ void TabWidgetWidget::insertDockWidget(int index, DockWidgetBase *dw,
     insertTab(index, dw, icon, title);
 }
 
+void TabWidgetWidget::moveDockWidget(int from, int to)
+{
+    // Like a drag of the tab, QTabWidget follows with its stack. Emits tabMoved().
+    QTabWidget::tabBar()->moveTab(from, to);
+}
+
 void TabWidgetWidget::setTabBarAutoHide(bool b)
 {
     QTabWidget::setTabBarAutoHide(b);
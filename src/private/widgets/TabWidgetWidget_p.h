@@ -31,6 +31,10 @@
 #include "../TabWidget_p.h"
 #include <QTabWidget>
 
+QT_BEGIN_NAMESPACE
+class QToolButton;
+QT_END_NAMESPACE
+
 namespace KDDockWidgets {
 
 class Frame;
@@ -47,6 +51,12 @@ public:
     int numDockWidgets() const override;
     void removeDockWidget(DockWidgetBase *) override;
     int indexOfDockWidget(DockWidgetBase *) const override;
+
+    ///@brief The button listing all tabs, with Config::Flag_ScalableTabs. nullptr otherwise
+    QToolButton *tabListButton() const { return m_tabListButton; }
+
+    ///@brief Shows the searchable list of all tabs, below tabListButton()
+    void showTabList();
 protected:
     void paintEvent(QPaintEvent *) override;
     void tabInserted(int index) override;
@@ -54,6 +64,7 @@ protected:
     bool isPositionDraggable(QPoint p) const override;
     void setCurrentDockWidget(int index) override;
     void insertDockWidget(int index, DockWidgetBase *, const QIcon&, const QString &title) override;
+    void moveDockWidget(int from, int to) override;
     void setTabBarAutoHide(bool) override;
     void detachTab(DockWidgetBase *dockWidget) override;
 
@@ -63,7 +74,9 @@ protected:
 
 private:
     Q_DISABLE_COPY(TabWidgetWidget)
+    void updateTabListButton();
     TabBar *const m_tabBar;
+    QToolButton *m_tabListButton = nullptr;
 };
 }
 
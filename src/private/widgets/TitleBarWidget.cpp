@@ -58,6 +58,26 @@ void TitleBarWidget::init()
     m_layout->setContentsMargins(2, 2, 2, 2);
     m_layout->setSpacing(2);
 
+    connect(this, &TitleBar::titleChanged, this, [this] {
+        update();
+    });
+
+    connect(this, &TitleBar::iconChanged, this, [this] {
+        if (icon().isNull()) {
+            m_dockWidgetIcon->setPixmap(QPixmap());
+        } else {
+            const QPixmap pix = icon().pixmap(QSize(28,28));
+            m_dockWidgetIcon->setPixmap(pix);
+        }
+        update();
+    });
+}
+
+void TitleBarWidget::ensureButtons()
+{
+    if (m_closeButton)
+        return;
+
     m_maximizeButton = TitleBarWidget::createButton(this, style()->standardIcon(QStyle::SP_TitleBarMaxButton));
     m_floatButton = TitleBarWidget::createButton(this, style()->standardIcon(QStyle::SP_TitleBarNormalButton));
     m_closeButton = TitleBarWidget::createButton(this, style()->standardIcon(QStyle::SP_TitleBarCloseButton));
@@ -72,20 +92,6 @@ void TitleBarWidget::init()
     updateCloseButton();
     updateFloatButton();
     updateMaximizeButton();
-
-    connect(this, &TitleBar::titleChanged, this, [this] {
-        update();
-    });
-
-    connect(this, &TitleBar::iconChanged, this, [this] {
-        if (icon().isNull()) {
-            m_dockWidgetIcon->setPixmap(QPixmap());
-        } else {
-            const QPixmap pix = icon().pixmap(QSize(28,28));
-            m_dockWidgetIcon->setPixmap(pix);
-        }
-        update();
-    });
 }
 
 QRect TitleBarWidget::iconRect() const
@@ -99,6 +105,9 @@ QRect TitleBarWidget::iconRect() const
 
 int TitleBarWidget::buttonAreaWidth() const
 {
+    if (!m_closeButton)
+        return 0;
+
     if (m_floatButton->isVisible())
         return width() - m_floatButton->x();
     else
@@ -109,6 +118,8 @@ TitleBarWidget::~TitleBarWidget()
 {
     // To avoid a crash
     for (auto button : { m_floatButton, m_maximizeButton, m_closeButton }) {
+        if (!button)
+            continue;
         button->setParent(nullptr);
         button->deleteLater();
     }
@@ -122,9 +133,16 @@ void TitleBarWidget::mouseDoubleClickEvent(QMouseEvent *e)
 
 QWidget *TitleBarWidget::closeButton() const
 {
+    const_cast<TitleBarWidget*>(this)->ensureButtons();
     return m_closeButton;
 }
 
+void TitleBarWidget::showEvent(QShowEvent *e)
+{
+    ensureButtons();
+    TitleBar::showEvent(e);
+}
+
 void TitleBarWidget::paintEvent(QPaintEvent *)
 {
     QPainter p(this);
@@ -139,11 +157,17 @@ void TitleBarWidget::paintEvent(QPaintEvent *)
 
 void TitleBarWidget::updateFloatButton()
 {
+    if (!m_floatButton)
+        return; // Updated when created
+
     m_floatButton->setVisible(supportsFloatingButton());
 }
 
 void TitleBarWidget::updateCloseButton()
 {
+    if (!m_closeButton)
+        return;
+
     const bool anyNonClosable = frame() ? frame()->anyNonClosable()
                                         : (floatingWindow() ? floatingWindow()->anyNonClosable()
                                                             : false);
@@ -154,6 +178,9 @@ void TitleBarWidget::updateCloseButton()
 
 void TitleBarWidget::updateMaximizeButton()
 {
+    if (!m_maximizeButton)
+        return;
+
     if (auto fw = floatingWindow()) {
         m_maximizeButton->setIcon(style()->standardIcon(fw->isMaximized() ? QStyle::SP_TitleBarNormalButton
                                                                           : QStyle::SP_TitleBarMaxButton));
@@ -166,21 +193,25 @@ void TitleBarWidget::updateMaximizeButton()
 
 bool TitleBarWidget::isCloseButtonVisible() const
 {
+    const_cast<TitleBarWidget*>(this)->ensureButtons();
     return m_closeButton->isVisible();
 }
 
 bool TitleBarWidget::isCloseButtonEnabled() const
 {
+    const_cast<TitleBarWidget*>(this)->ensureButtons();
     return m_closeButton->isEnabled();
 }
 
 bool TitleBarWidget::isFloatButtonVisible() const
 {
+    const_cast<TitleBarWidget*>(this)->ensureButtons();
     return m_floatButton->isVisible();
 }
 
 bool TitleBarWidget::isFloatButtonEnabled() const
 {
+    const_cast<TitleBarWidget*>(this)->ensureButtons();
     return m_floatButton->isEnabled();
 }
 
@@ -49,13 +49,15 @@ public:
     explicit TitleBarWidget(FloatingWindow *parent);
     ~TitleBarWidget() override;
 
-    ///@brief getter for the close button
+    ///@brief getter for the close button. The buttons are only created when the title bar is first
+    ///shown, so this creates them if needed
     QWidget* closeButton() const;
 
     static QAbstractButton* createButton(QWidget *parent, const QIcon &icon);
 
 protected:
     void paintEvent(QPaintEvent *) override;
+    void showEvent(QShowEvent *) override;
     void mouseDoubleClickEvent(QMouseEvent *) override;
     void updateFloatButton() override;
     void updateCloseButton() override;
@@ -69,6 +71,9 @@ protected:
 
 private:
     void init();
+    ///@brief Creates the buttons, if not created yet. Most title bars are never shown, for example
+    ///the ones hidden by Flag_HideTitleBarWhenTabsVisible or in background tabs of nested windows
+    void ensureButtons();
     int buttonAreaWidth() const;
 
     QRect iconRect() const;
@@ -0,0 +1,175 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "InteractionDriver.h"
+#include "Testing.h"
+#include "utils.h"
+#include "FloatingWindow_p.h"
+#include "TitleBar_p.h"
+#include "multisplitter/Separator_p.h"
+#include "private/widgets/FrameWidget_p.h"
+#include "private/widgets/TabWidgetWidget_p.h"
+
+#include <QCoreApplication>
+#include <QCursor>
+#include <QDebug>
+#include <QMouseEvent>
+#include <QPointer>
+#include <QThread>
+#include <QWidget>
+
+#include <algorithm>
+
+using namespace KDDockWidgets;
+using namespace KDDockWidgets::Tests;
+
+// clazy:excludeall=ctor-missing-parent-argument,missing-qobject-macro,range-loop,missing-typeinfo,detaching-member,function-args-by-ref,non-pod-global-static,reserve-candidates
+
+qint64 InteractionStats::maxUsecs() const
+{
+    return latenciesUsecs.isEmpty() ? 0 : *std::max_element(latenciesUsecs.cbegin(), latenciesUsecs.cend());
+}
+
+qint64 InteractionStats::percentileUsecs(int percent) const
+{
+    if (latenciesUsecs.isEmpty())
+        return 0;
+
+    QVector<qint64> sorted = latenciesUsecs;
+    std::sort(sorted.begin(), sorted.end());
+    return Testing::percentile(sorted, percent);
+}
+
+InteractionDriver::InteractionDriver(int eventsPerSecond, int pixelsPerEvent)
+    : m_intervalUsecs(1000000 / qMax(1, eventsPerSecond))
+    , m_pixelsPerEvent(qMax(1, pixelsPerEvent))
+{
+    m_clock.start();
+}
+
+InteractionStats InteractionDriver::dragTitleBar(QWidget *draggable, const QVector<QPoint> &globalWaypoints)
+{
+    QVector<QPoint> waypoints = globalWaypoints;
+    waypoints.prepend(draggable->mapToGlobal(QPoint(10, 10)));
+    return replay(draggable, waypoints);
+}
+
+InteractionStats InteractionDriver::detachTab(Frame *frame, int index, QPoint globalDest)
+{
+    auto frameW = static_cast<FrameWidget*>(frame);
+    QWidget *draggable = frameW->hasSingleDockWidget() ? static_cast<QWidget*>(frameW->titleBar())
+                                                       : frameW->tabBar();
+    return replay(draggable, { dragPointForWidget(frame, index), globalDest });
+}
+
+InteractionStats InteractionDriver::sweepSeparator(Layouting::Separator *separator, int delta)
+{
+    // The separator's position follows the cursor, so pressing on its origin doesn't make it jump
+    const QPoint start = separator->mapToGlobal(QPoint(0, 0));
+    const QPoint offset = separator->isVertical() ? QPoint(0, delta) : QPoint(delta, 0);
+    return replay(separator, { start, start + offset, start });
+}
+
+InteractionStats InteractionDriver::resizeFloatingWindow(FloatingWindow *fw, QPoint delta)
+{
+    // The last pixel, as the edges follow the cursor, so the window grows by exactly delta
+    const QPoint corner = fw->mapToGlobal(QPoint(fw->width() - 1, fw->height() - 1));
+    return replay(fw, { corner, corner + delta });
+}
+
+InteractionStats InteractionDriver::replay(QWidget *receiver, const QVector<QPoint> &globalWaypoints)
+{
+    InteractionStats stats;
+    const QVector<QPoint> points = trajectory(globalWaypoints);
+    if (points.isEmpty())
+        return stats;
+
+    QPointer<QWidget> receiverP = receiver;
+    m_nextEventUsecs = m_clock.nsecsElapsed() / 1000;
+    sendMouseEvent(receiver, QEvent::MouseButtonPress, points.first(), stats);
+
+    for (int i = 1; i < points.size(); ++i) {
+        waitForNextEvent();
+        if (!receiverP) {
+            qWarning() << Q_FUNC_INFO << "Receiver was deleted";
+            return stats;
+        }
+
+        sendMouseEvent(receiver, QEvent::MouseMove, points.at(i), stats);
+    }
+
+    waitForNextEvent();
+    if (receiverP)
+        sendMouseEvent(receiver, QEvent::MouseButtonRelease, points.last(), stats);
+
+    return stats;
+}
+
+QVector<QPoint> InteractionDriver::trajectory(const QVector<QPoint> &globalWaypoints) const
+{
+    // Straight lines between the waypoints, at most m_pixelsPerEvent apart along each axis
+    QVector<QPoint> points;
+    if (globalWaypoints.isEmpty())
+        return points;
+
+    points.push_back(globalWaypoints.first());
+    for (int i = 1; i < globalWaypoints.size(); ++i) {
+        const QPoint from = globalWaypoints.at(i - 1);
+        const QPoint delta = globalWaypoints.at(i) - from;
+        const int distance = qMax(qAbs(delta.x()), qAbs(delta.y()));
+        const int steps = qMax(1, (distance + m_pixelsPerEvent - 1) / m_pixelsPerEvent);
+        for (int step = 1; step <= steps; ++step)
+            points.push_back(from + QPoint(qRound(delta.x() * step / double(steps)), qRound(delta.y() * step / double(steps))));
+    }
+
+    return points;
+}
+
+void InteractionDriver::sendMouseEvent(QWidget *receiver, QEvent::Type type, QPoint globalPos, InteractionStats &stats)
+{
+    const Qt::MouseButton button = type == QEvent::MouseMove ? Qt::NoButton : Qt::LeftButton;
+    const Qt::MouseButtons buttons = type == QEvent::MouseButtonRelease ? Qt::NoButton : Qt::LeftButton;
+
+    QCursor::setPos(globalPos); // Since some code uses QCursor::pos()
+    QMouseEvent ev(type, receiver->mapFromGlobal(globalPos), receiver->window()->mapFromGlobal(globalPos), globalPos,
+                   button, buttons, Qt::NoModifier);
+
+    QElapsedTimer timer;
+    timer.start();
+    QCoreApplication::sendEvent(receiver, &ev);
+    // Includes what the event deferred, like relayouts, moves and repaints. Not the deferred deletes.
+    QCoreApplication::sendPostedEvents();
+    stats.latenciesUsecs.push_back(timer.nsecsElapsed() / 1000);
+}
+
+void InteractionDriver::waitForNextEvent()
+{
+    // A slow event delays the following ones instead of them being sent in a burst to catch up
+    const qint64 now = m_clock.nsecsElapsed() / 1000;
+    m_nextEventUsecs = qMax(m_nextEventUsecs + m_intervalUsecs, now);
+
+    qint64 remaining = m_nextEventUsecs - now;
+    while (remaining > 0) {
+        QCoreApplication::processEvents();
+        remaining = m_nextEventUsecs - m_clock.nsecsElapsed() / 1000;
+        if (remaining > 0)
+            QThread::usleep(qMin<qint64>(remaining, 1000));
+    }
+}
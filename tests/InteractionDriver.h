@@ -0,0 +1,100 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KDDOCKWIDGETS_TESTS_INTERACTIONDRIVER_H
+#define KDDOCKWIDGETS_TESTS_INTERACTIONDRIVER_H
+
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QPoint>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QWidget;
+QT_END_NAMESPACE
+
+namespace Layouting {
+class Separator;
+}
+
+namespace KDDockWidgets {
+
+class Frame;
+class FloatingWindow;
+
+namespace Tests {
+
+///@brief How long each of the replayed mouse events took to be processed
+struct InteractionStats
+{
+    int count() const { return latenciesUsecs.size(); }
+    qint64 maxUsecs() const;
+
+    ///@brief Returns the latency which @p percent percent of the events didn't exceed
+    qint64 percentileUsecs(int percent) const;
+
+    QVector<qint64> latenciesUsecs; // In the order the events were sent
+};
+
+/**
+ * @brief Replays mouse interactions along fixed trajectories and at a fixed rate.
+ *
+ * Unlike drag() and moveMouseTo(), which are only meant for correctness, the same interaction
+ * always sends the same events, at the same positions and with the same spacing in time, so the
+ * latencies are comparable between runs. They go through the same code paths as real input:
+ * DragController for title bars and tabs, Separator and WidgetResizeHandler.
+ *
+ * Each event's latency is the time it took to be delivered plus the time to process what it
+ * posted, like deferred relayouts and repaints.
+ */
+class InteractionDriver
+{
+public:
+    explicit InteractionDriver(int eventsPerSecond = 120, int pixelsPerEvent = 4);
+
+    ///@brief Drags @p draggable, a title bar or tab bar, through @p globalWaypoints and drops it at the last one
+    InteractionStats dragTitleBar(QWidget *draggable, const QVector<QPoint> &globalWaypoints);
+
+    ///@brief Drags tab @p index out of @p frame and drops it at @p globalDest, as a floating window
+    InteractionStats detachTab(Frame *frame, int index, QPoint globalDest);
+
+    ///@brief Drags @p separator by @p delta pixels and then back to where it was
+    InteractionStats sweepSeparator(Layouting::Separator *separator, int delta);
+
+    ///@brief Resizes @p fw by dragging its bottom-right corner by @p delta
+    InteractionStats resizeFloatingWindow(FloatingWindow *fw, QPoint delta);
+
+private:
+    ///@brief Presses on the first point, moves through the others and releases on the last one
+    InteractionStats replay(QWidget *receiver, const QVector<QPoint> &globalWaypoints);
+    QVector<QPoint> trajectory(const QVector<QPoint> &globalWaypoints) const;
+    void sendMouseEvent(QWidget *receiver, QEvent::Type type, QPoint globalPos, InteractionStats &stats);
+    void waitForNextEvent();
+
+    const qint64 m_intervalUsecs;
+    const int m_pixelsPerEvent;
+    QElapsedTimer m_clock;
+    qint64 m_nextEventUsecs = 0;
+};
+
+}
+}
+
+#endif
@@ -132,6 +132,14 @@ bool Testing::waitForResize(QWidget *w, int timeout)
 
 HostedWidget::~HostedWidget() {}
 
+qint64 Testing::percentile(const QVector<qint64> &sortedSamples, int percent)
+{
+    if (sortedSamples.isEmpty())
+        return 0;
+
+    return sortedSamples.at((sortedSamples.size() - 1) * percent / 100);
+}
+
 void Testing::installFatalMessageHandler()
 {
     s_original = qInstallMessageHandler(fatalWarningsMessageHandler);
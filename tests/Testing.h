@@ -112,6 +112,9 @@ namespace Testing {
     void installFatalMessageHandler();
     void setExpectedWarning(const QString &);
 
+    ///@brief Returns the sample @p percent percent of @p sortedSamples don't exceed. 0 if there are none.
+    qint64 percentile(const QVector<qint64> &sortedSamples, int percent);
+
     bool waitForEvent(QWidget *w, QEvent::Type type, int timeout = 2000);
     bool waitForDeleted(QObject *o, int timeout = 2000);
     bool waitForResize(QWidget *w, int timeout = 2000);
@@ -0,0 +1,227 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Replays drags and resizes with InteractionDriver and reports how long each mouse event took
+// to be processed: the 95th percentile as the result, the median and maximum in the log.
+// The layouts are the same for each run, so the numbers can be compared between builds.
+// For machine readable results run with "-csv" or "-o results.xml,xml".
+
+#include "DockWidgetBase.h"
+#include "DockRegistry_p.h"
+#include "FloatingWindow_p.h"
+#include "Frame_p.h"
+#include "MainWindow.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
+#include "multisplitter/Separator_p.h"
+#include "multisplitter/Item_p.h"
+#include "InteractionDriver.h"
+#include "utils.h"
+#include "examples/dockwidgets/BalancedTree.h"
+
+#include <QtTest/QtTest>
+#include <QApplication>
+#include <QPointer>
+
+#include <memory>
+
+using namespace KDDockWidgets;
+using namespace KDDockWidgets::Tests;
+
+namespace {
+
+// More than this and the leaves would be smaller than the frames' minimum sizes
+static const int s_maxDockedFrames = 40;
+static const int s_tabsPerFrame = 8;
+
+struct DockedLayout
+{
+    ~DockedLayout()
+    {
+        // Deleting a floating window deletes its dock widgets too
+        const QVector<FloatingWindow*> floatingWindows = DockRegistry::self()->nestedwindows();
+        qDeleteAll(floatingWindows);
+        for (DockWidgetBase *dock : qAsConst(docks))
+            delete dock;
+    }
+
+    std::unique_ptr<KDDockWidgets::MainWindow> mainWindow;
+    QVector<QPointer<DockWidgetBase>> docks;
+    DockWidgetBase::List frameDocks; // The first dock widget of each docked frame
+};
+
+/**
+ * Creates a main window with @p numDocks dock widgets, as tabs of frames nested in a balanced
+ * tree of containers. The frames that don't fit are tabbed into the existing ones.
+ */
+std::unique_ptr<DockedLayout> createDockedLayout(int numDocks)
+{
+    std::unique_ptr<DockedLayout> layout(new DockedLayout());
+    layout->mainWindow = createMainWindow(QSize(1920, 1080), MainWindowOption_None, QStringLiteral("interaction"));
+    layout->mainWindow->move(0, 0);
+
+    DockWidgetBase *currentFrameDock = nullptr;
+    for (int i = 0; i < numDocks; ++i) {
+        DockWidgetBase *dock = createDockWidget(QStringLiteral("dock-%1").arg(i), new QWidget(), {}, /*show=*/ false);
+        layout->docks.push_back(dock);
+        DockWidgetBase::List &frameDocks = layout->frameDocks;
+
+        if (currentFrameDock && i % s_tabsPerFrame != 0) {
+            currentFrameDock->addDockWidgetAsTab(dock);
+        } else if (frameDocks.size() < s_maxDockedFrames) {
+            addBalancedGroup(layout->mainWindow.get(), dock, frameDocks);
+            currentFrameDock = dock;
+        } else {
+            currentFrameDock = frameDocks.at(i % frameDocks.size());
+            currentFrameDock->addDockWidgetAsTab(dock);
+        }
+    }
+
+    return layout;
+}
+
+void report(const InteractionStats &stats)
+{
+    qDebug().noquote() << QStringLiteral("%1 events, median %2 us, p95 %3 us, max %4 us")
+                          .arg(stats.count()).arg(stats.percentileUsecs(50))
+                          .arg(stats.percentileUsecs(95)).arg(stats.maxUsecs());
+    QTest::setBenchmarkResult(stats.percentileUsecs(95) / 1000.0, QTest::WalltimeMilliseconds);
+}
+
+}
+
+class BenchInteraction : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void benchDragTitleBar_data() { addRows(); }
+    void benchDragTitleBar();
+    void benchDetachTab_data() { addRows(); }
+    void benchDetachTab();
+    void benchSeparatorSweep_data() { addRows(); }
+    void benchSeparatorSweep();
+    void benchResizeFloatingWindow_data() { addRows(); }
+    void benchResizeFloatingWindow();
+
+private:
+    void addRows()
+    {
+        QTest::addColumn<int>("numDocks");
+
+        for (int numDocks : { 40, 320, 1000 })
+            QTest::newRow(QByteArray::number(numDocks)) << numDocks;
+    }
+};
+
+void BenchInteraction::benchDragTitleBar()
+{
+    QFETCH(int, numDocks);
+
+    auto layout = createDockedLayout(numDocks);
+    DockWidgetBase *dock = layout->frameDocks.last();
+    MainWindow *mainWindow = layout->mainWindow.get();
+
+    // Across the main window, over the drop areas of every column, and dropped outside of it
+    const QPoint left = mainWindow->mapToGlobal(QPoint(20, mainWindow->height() / 2));
+    const QPoint right = mainWindow->mapToGlobal(QPoint(mainWindow->width() - 20, mainWindow->height() / 2));
+    const QPoint outside = right + QPoint(200, 0);
+
+    InteractionDriver driver;
+    report(driver.dragTitleBar(draggableFor(dock), { left, right, outside }));
+
+    // With its tabs
+    QVERIFY(qobject_cast<FloatingWindow*>(dock->window()));
+}
+
+void BenchInteraction::benchDetachTab()
+{
+    QFETCH(int, numDocks);
+
+    auto layout = createDockedLayout(numDocks);
+    DockWidgetBase *dock = layout->frameDocks.first();
+    Frame *frame = dock->frame();
+    QVERIFY(frame->dockWidgetCount() > 1);
+
+    MainWindow *mainWindow = layout->mainWindow.get();
+    const QPoint outside = mainWindow->mapToGlobal(QPoint(mainWindow->width() + 200, mainWindow->height() / 2));
+
+    InteractionDriver driver;
+    report(driver.detachTab(frame, frame->dockWidgetCount() - 1, outside));
+}
+
+void BenchInteraction::benchSeparatorSweep()
+{
+    QFETCH(int, numDocks);
+
+    auto layout = createDockedLayout(numDocks);
+    Layouting::ItemContainer *root = layout->mainWindow->multiSplitterLayout()->rootItem();
+    const QVector<Layouting::Separator*> separators = root->separators();
+    QVERIFY(!separators.isEmpty());
+
+    // The root separator, as it resizes the biggest sub-trees
+    Layouting::Separator *separator = separators.first();
+    const int originalPos = separator->position();
+
+    InteractionDriver driver;
+    report(driver.sweepSeparator(separator, 200));
+
+    QCOMPARE(separator->position(), originalPos);
+}
+
+void BenchInteraction::benchResizeFloatingWindow()
+{
+    if (KDDockWidgets::usesNativeDraggingAndResizing())
+        QSKIP("The window manager resizes the floating windows");
+
+    QFETCH(int, numDocks);
+
+    auto layout = createDockedLayout(numDocks);
+
+    // Makes a floating window with a nested layout of its own
+    const int numFloatingFrames = qMin(8, layout->frameDocks.size() - 1);
+    DockWidgetBase *floatingDock = layout->frameDocks.at(0);
+    floatingDock->setFloating(true);
+    for (int i = 1; i <= numFloatingFrames; ++i)
+        floatingDock->addDockWidgetToContainingWindow(layout->frameDocks.at(i), i % 2 ? Location_OnRight : Location_OnBottom);
+
+    QPointer<FloatingWindow> fw = floatingDock->floatingWindow();
+    QVERIFY(fw);
+    fw->setGeometry(QRect(100, 100, 800, 600));
+    const QSize originalSize = fw->size();
+
+    InteractionDriver driver;
+    report(driver.resizeFloatingWindow(fw, QPoint(200, 150)));
+
+    QCOMPARE(fw->size(), originalSize + QSize(200, 150));
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qpaPassedAsArgument(argc, argv)) {
+        // Use offscreen by default as it's less annoying, doesn't create visible windows
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    BenchInteraction bench;
+
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_interaction.moc"
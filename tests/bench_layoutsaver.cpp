@@ -0,0 +1,219 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Benchmarks for LayoutSaver, on synthetic layouts of increasing size.
+// For machine readable results run with "-csv" or "-o results.xml,xml".
+
+#include "DockWidgetBase.h"
+#include "DockRegistry_p.h"
+#include "MainWindow.h"
+#include "LayoutSaver.h"
+#include "LayoutSaver_p.h"
+#include "utils.h"
+
+#include <QtTest/QtTest>
+#include <QApplication>
+#include <QPointer>
+
+#include <cmath>
+#include <memory>
+
+using namespace KDDockWidgets;
+using namespace KDDockWidgets::Tests;
+
+namespace {
+
+// More than this and the leaves would be smaller than the frames' minimum sizes
+static const int s_maxDockedFrames = 40;
+static const int s_maxFloatingWindows = 20;
+static const int s_tabsPerFrame = 8;
+
+struct SyntheticLayout
+{
+    ~SyntheticLayout()
+    {
+        // Deleting a floating window deletes its dock widgets too
+        const QVector<FloatingWindow*> floatingWindows = DockRegistry::self()->nestedwindows();
+        qDeleteAll(floatingWindows);
+        for (DockWidgetBase *dock : qAsConst(docks))
+            delete dock;
+    }
+
+    std::unique_ptr<KDDockWidgets::MainWindow> mainWindow;
+    QVector<QPointer<DockWidgetBase>> docks;
+};
+
+/**
+ * Docks @p numDocks dock widgets into a main window, as tabs of frames nested in a balanced tree
+ * of containers. The frames that don't fit become floating windows. Every 5th dock widget is
+ * then closed, so there's placeholder history to save too.
+ */
+std::unique_ptr<SyntheticLayout> createSyntheticLayout(int numDocks)
+{
+    std::unique_ptr<SyntheticLayout> layout(new SyntheticLayout());
+    layout->mainWindow = createMainWindow(QSize(1920, 1080), MainWindowOption_None, QStringLiteral("bench"));
+
+    DockWidgetBase::List frameDocks; // The first dock widget of each docked frame
+    DockWidgetBase *currentFrameDock = nullptr;
+    int numFloating = 0;
+
+    for (int i = 0; i < numDocks; ++i) {
+        auto dock = createDockWidget(QStringLiteral("dock-%1").arg(i), new QWidget(), {}, /*show=*/ false);
+        layout->docks.push_back(dock);
+
+        if (currentFrameDock && i % s_tabsPerFrame != 0) {
+            currentFrameDock->addDockWidgetAsTab(dock);
+        } else if (frameDocks.size() < s_maxDockedFrames) {
+            const int index = frameDocks.size();
+            const int depth = int(std::log2(index + 1));
+            DockWidgetBase *relativeTo = index == 0 ? nullptr : frameDocks.at((index - 1) / 2);
+            layout->mainWindow->addDockWidget(dock, depth % 2 == 0 ? Location_OnRight : Location_OnBottom, relativeTo);
+            frameDocks.push_back(dock);
+            currentFrameDock = dock;
+        } else if (numFloating < s_maxFloatingWindows) {
+            dock->show();
+            numFloating++;
+            currentFrameDock = dock;
+        } else {
+            frameDocks.at(i % frameDocks.size())->addDockWidgetAsTab(dock);
+        }
+    }
+
+    for (int i = 0; i < numDocks; i += 5)
+        layout->docks.at(i)->close();
+
+    return layout;
+}
+
+LayoutSaver::Format formatFromName(const QString &name)
+{
+    return name == QLatin1String("binary") ? LayoutSaver::Format::Binary
+                                           : LayoutSaver::Format::Json;
+}
+
+}
+
+class BenchLayoutSaver : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void benchSerialize_data() { addRows(); }
+    void benchSerialize();
+    void benchParse_data() { addRows(); }
+    void benchParse();
+    void benchRestore_data() { addRows(); }
+    void benchRestore();
+    void benchParsedMemory_data() { addRows(); }
+    void benchParsedMemory();
+
+private:
+    void addRows()
+    {
+        QTest::addColumn<int>("numDocks");
+        QTest::addColumn<QString>("format");
+
+        for (int numDocks : { 10, 100, 500, 2000 }) {
+            for (const char *format : { "json", "binary" }) {
+                QTest::newRow(QByteArray::number(numDocks) + ' ' + format)
+                    << numDocks << QString::fromLatin1(format);
+            }
+        }
+    }
+};
+
+void BenchLayoutSaver::benchSerialize()
+{
+    QFETCH(int, numDocks);
+    QFETCH(QString, format);
+
+    auto layout = createSyntheticLayout(numDocks);
+    LayoutSaver saver;
+    QByteArray data;
+    QBENCHMARK {
+        data = saver.serializeLayout(formatFromName(format));
+    }
+
+    QVERIFY(!data.isEmpty());
+}
+
+void BenchLayoutSaver::benchParse()
+{
+    QFETCH(int, numDocks);
+    QFETCH(QString, format);
+
+    auto layout = createSyntheticLayout(numDocks);
+    const QByteArray data = LayoutSaver().serializeLayout(formatFromName(format));
+
+    // Just the parsing, without touching any widget
+    QBENCHMARK {
+        LayoutSaver::Layout parsed;
+        const bool ok = LayoutSaver::Layout::isBinary(data) ? parsed.fromBinary(data)
+                                                            : parsed.fromJson(data);
+        QVERIFY(ok);
+    }
+}
+
+void BenchLayoutSaver::benchRestore()
+{
+    QFETCH(int, numDocks);
+    QFETCH(QString, format);
+
+    auto layout = createSyntheticLayout(numDocks);
+    LayoutSaver saver;
+    const QByteArray data = saver.serializeLayout(formatFromName(format));
+
+    QBENCHMARK {
+        QVERIFY(saver.restoreLayout(data));
+    }
+}
+
+void BenchLayoutSaver::benchParsedMemory()
+{
+#ifdef Q_OS_LINUX
+    QFETCH(int, numDocks);
+    QFETCH(QString, format);
+
+    auto layout = createSyntheticLayout(numDocks);
+    const QByteArray data = LayoutSaver().serializeLayout(formatFromName(format));
+
+    // Approximate, the allocator might reuse memory it already had
+    const qint64 before = residentMemory();
+    LayoutSaver::Layout parsed;
+    QVERIFY(LayoutSaver::Layout::isBinary(data) ? parsed.fromBinary(data) : parsed.fromJson(data));
+    QTest::setBenchmarkResult(residentMemory() - before, QTest::BytesAllocated);
+#else
+    QSKIP("Only supported on Linux");
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qpaPassedAsArgument(argc, argv)) {
+        // Use offscreen by default as it's less annoying, doesn't create visible windows
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    BenchLayoutSaver bench;
+
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_layoutsaver.moc"
@@ -0,0 +1,299 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Stress benchmarks, measuring how the common operations scale with the number of dock widgets.
+// Each operation is timed on a layout with 100, 500, 1000 and 2000 dock widgets, spread over
+// nested containers, tabs and floating windows.
+// For machine readable results run with "-csv" or "-o results.xml,xml".
+
+#include "DockWidgetBase.h"
+#include "DockRegistry_p.h"
+#include "FloatingWindow_p.h"
+#include "MainWindow.h"
+#include "LayoutSaver.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
+#include "multisplitter/Separator_p.h"
+#include "multisplitter/Item_p.h"
+#include "utils.h"
+
+#include <QtTest/QtTest>
+#include <QApplication>
+#include <QPointer>
+
+#include <cmath>
+#include <memory>
+
+using namespace KDDockWidgets;
+using namespace KDDockWidgets::Tests;
+
+namespace {
+
+// More than this and the leaves would be smaller than the frames' minimum sizes
+static const int s_maxDockedFrames = 40;
+static const int s_tabsPerFrame = 8;
+// One in each this many frames is a floating window
+static const int s_framesPerFloatingWindow = 3;
+
+struct StressLayout
+{
+    ~StressLayout()
+    {
+        // Deleting a floating window deletes its dock widgets too
+        const QVector<FloatingWindow*> floatingWindows = DockRegistry::self()->nestedwindows();
+        qDeleteAll(floatingWindows);
+        for (DockWidgetBase *dock : qAsConst(docks))
+            delete dock;
+    }
+
+    std::unique_ptr<KDDockWidgets::MainWindow> mainWindow;
+    QVector<QPointer<DockWidgetBase>> docks;
+    DockWidgetBase::List frameDocks; // The first dock widget of each docked frame
+};
+
+/**
+ * Creates a main window and @p numDocks dock widgets, without docking them. See populate().
+ */
+std::unique_ptr<StressLayout> createStressLayout(int numDocks)
+{
+    std::unique_ptr<StressLayout> layout(new StressLayout());
+    layout->mainWindow = createMainWindow(QSize(1920, 1080), MainWindowOption_None, QStringLiteral("stress"));
+
+    layout->docks.reserve(numDocks);
+    for (int i = 0; i < numDocks; ++i)
+        layout->docks.push_back(createDockWidget(QStringLiteral("dock-%1").arg(i), new QWidget(), {}, /*show=*/ false));
+
+    return layout;
+}
+
+/**
+ * Docks the dock widgets of @p layout as tabs of frames nested in a balanced tree of containers.
+ * One in each s_framesPerFloatingWindow frames becomes a floating window instead, and the frames
+ * that don't fit in the main window are tabbed into the existing ones.
+ */
+void populate(StressLayout *layout)
+{
+    DockWidgetBase *currentFrameDock = nullptr;
+    const int numDocks = layout->docks.size();
+
+    for (int i = 0; i < numDocks; ++i) {
+        DockWidgetBase *dock = layout->docks.at(i);
+        DockWidgetBase::List &frameDocks = layout->frameDocks;
+
+        if (currentFrameDock && i % s_tabsPerFrame != 0) {
+            currentFrameDock->addDockWidgetAsTab(dock);
+        } else if ((i / s_tabsPerFrame) % s_framesPerFloatingWindow == 1) {
+            dock->show();
+            currentFrameDock = dock;
+        } else if (frameDocks.size() < s_maxDockedFrames) {
+            const int index = frameDocks.size();
+            const int depth = int(std::log2(index + 1));
+            DockWidgetBase *relativeTo = index == 0 ? nullptr : frameDocks.at((index - 1) / 2);
+            layout->mainWindow->addDockWidget(dock, depth % 2 == 0 ? Location_OnRight : Location_OnBottom, relativeTo);
+            frameDocks.push_back(dock);
+            currentFrameDock = dock;
+        } else {
+            currentFrameDock = frameDocks.at(i % frameDocks.size());
+            currentFrameDock->addDockWidgetAsTab(dock);
+        }
+    }
+}
+
+std::unique_ptr<StressLayout> createPopulatedStressLayout(int numDocks)
+{
+    auto layout = createStressLayout(numDocks);
+    populate(layout.get());
+    return layout;
+}
+
+///@brief Frames and floating windows are deleted later, don't let them pile up between iterations
+void deletePendingObjects()
+{
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+}
+
+}
+
+class BenchScaling : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void benchAdd_data() { addRows(); }
+    void benchAdd();
+    void benchTab_data() { addRows(); }
+    void benchTab();
+    void benchMove_data() { addRows(); }
+    void benchMove();
+    void benchClose_data() { addRows(); }
+    void benchClose();
+    void benchRestore_data() { addRows(); }
+    void benchRestore();
+    void benchSeparatorDrag_data() { addRows(); }
+    void benchSeparatorDrag();
+    void benchResizeMainWindow_data() { addRows(); }
+    void benchResizeMainWindow();
+    void benchMemory_data() { addRows(); }
+    void benchMemory();
+
+private:
+    void addRows()
+    {
+        QTest::addColumn<int>("numDocks");
+
+        for (int numDocks : { 100, 500, 1000, 2000 })
+            QTest::newRow(QByteArray::number(numDocks)) << numDocks;
+    }
+};
+
+void BenchScaling::benchAdd()
+{
+    QFETCH(int, numDocks);
+
+    // Docking them all is the operation, so it can only be done once per layout
+    auto layout = createStressLayout(numDocks);
+    QBENCHMARK_ONCE {
+        populate(layout.get());
+    }
+
+    QVERIFY(!layout->frameDocks.isEmpty());
+}
+
+void BenchScaling::benchTab()
+{
+    QFETCH(int, numDocks);
+
+    auto layout = createPopulatedStressLayout(numDocks);
+    DockWidgetBase *target = layout->frameDocks.last();
+
+    QBENCHMARK {
+        auto dock = createDockWidget(QStringLiteral("extra"), new QWidget(), {}, /*show=*/ false);
+        target->addDockWidgetAsTab(dock);
+        delete dock;
+    }
+}
+
+void BenchScaling::benchMove()
+{
+    QFETCH(int, numDocks);
+
+    auto layout = createPopulatedStressLayout(numDocks);
+    DockWidgetBase *dock = layout->frameDocks.last();
+
+    // Undocks it into a floating window and docks it back, to its previous position
+    QBENCHMARK {
+        dock->setFloating(true);
+        dock->setFloating(false);
+        deletePendingObjects();
+    }
+
+    QVERIFY(!dock->isFloating());
+}
+
+void BenchScaling::benchClose()
+{
+    QFETCH(int, numDocks);
+
+    auto layout = createPopulatedStressLayout(numDocks);
+    DockWidgetBase *dock = layout->frameDocks.last();
+
+    // Closing and showing, which restores it to its placeholder
+    QBENCHMARK {
+        dock->close();
+        deletePendingObjects();
+        dock->show();
+    }
+
+    QVERIFY(dock->isVisible());
+}
+
+void BenchScaling::benchRestore()
+{
+    QFETCH(int, numDocks);
+
+    auto layout = createPopulatedStressLayout(numDocks);
+    LayoutSaver saver;
+    const QByteArray data = saver.serializeLayout();
+
+    QBENCHMARK {
+        QVERIFY(saver.restoreLayout(data));
+        deletePendingObjects();
+    }
+}
+
+void BenchScaling::benchSeparatorDrag()
+{
+    QFETCH(int, numDocks);
+
+    auto layout = createPopulatedStressLayout(numDocks);
+    Layouting::ItemContainer *root = layout->mainWindow->multiSplitterLayout()->rootItem();
+    const QVector<Layouting::Separator*> separators = root->separators();
+    QVERIFY(!separators.isEmpty());
+
+    // The root separator, as it resizes the biggest sub-trees. Back and forth so it doesn't hit the bounds.
+    Layouting::Separator *separator = separators.first();
+    int delta = 10;
+    QBENCHMARK {
+        root->requestSeparatorMove(separator, delta);
+        delta = -delta;
+    }
+}
+
+void BenchScaling::benchResizeMainWindow()
+{
+    QFETCH(int, numDocks);
+
+    auto layout = createPopulatedStressLayout(numDocks);
+    MainWindow *mainWindow = layout->mainWindow.get();
+    const QSize size = mainWindow->size();
+    bool grow = true;
+
+    QBENCHMARK {
+        mainWindow->resize(grow ? size + QSize(50, 50) : size);
+        grow = !grow;
+    }
+}
+
+void BenchScaling::benchMemory()
+{
+#ifdef Q_OS_LINUX
+    QFETCH(int, numDocks);
+
+    // Approximate, the allocator might reuse memory it already had
+    const qint64 before = residentMemory();
+    auto layout = createPopulatedStressLayout(numDocks);
+    QTest::setBenchmarkResult(residentMemory() - before, QTest::BytesAllocated);
+#else
+    QSKIP("Only supported on Linux");
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qpaPassedAsArgument(argc, argv)) {
+        // Use offscreen by default as it's less annoying, doesn't create visible windows
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    BenchScaling bench;
+
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_scaling.moc"
@@ -0,0 +1,211 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// We don't care about performance related checks in the tests
+// clazy:excludeall=ctor-missing-parent-argument,missing-qobject-macro,range-loop,missing-typeinfo,detaching-member,function-args-by-ref,non-pod-global-static,reserve-candidates,qstring-allocations
+
+#include "Driver.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QTimer>
+
+using namespace KDDockWidgets::Testing;
+
+// A worker running longer than this is probably stuck in the layout engine
+static const int s_workerTimeoutMs = 10 * 60 * 1000;
+
+// Minimizing is sequential, each step is a process running the candidate test case
+static const int s_maxMinimizationRuns = 300;
+
+static QVariantMap readTestCase(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return {};
+
+    return QJsonDocument::fromJson(file.readAll()).toVariant().toMap();
+}
+
+static bool writeTestCase(const QVariantMap &test, const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    file.write(QJsonDocument::fromVariant(test).toJson());
+    return true;
+}
+
+Driver::Driver(const Config &config)
+    : m_config(config)
+{
+}
+
+int Driver::run()
+{
+    qDebug().noquote() << QStringLiteral("Running %1 workers in parallel, starting at seed %2")
+                          .arg(m_config.numJobs).arg(m_config.firstSeed);
+
+    m_clock.start();
+    startWorkers();
+    if (m_numRunning > 0)
+        qApp->exec();
+
+    if (m_config.minimize) {
+        for (const QString &failedCase : qAsConst(m_failedCases))
+            minimize(failedCase);
+    }
+
+    qDebug().noquote() << QStringLiteral("%1 workers ran, %2 failed").arg(m_numStarted).arg(m_numFailed);
+    for (const QString &failedCase : qAsConst(m_failedCases))
+        qDebug().noquote() << "    " << failedCase;
+
+    return m_numFailed;
+}
+
+bool Driver::hasBudget() const
+{
+    if (m_config.durationSecs > 0)
+        return m_clock.elapsed() < m_config.durationSecs * 1000;
+
+    return m_numStarted < m_config.numRuns;
+}
+
+void Driver::startWorkers()
+{
+    while (m_numRunning < m_config.numJobs && hasBudget()) {
+        const quint32 seed = m_config.firstSeed + quint32(m_numStarted);
+        m_numStarted++;
+        m_numRunning++;
+
+        auto process = new QProcess();
+        process->setStandardOutputFile(QProcess::nullDevice());
+        process->setStandardErrorFile(logFileForSeed(seed)); // Kept only if it fails
+
+        auto timeout = new QTimer(process);
+        timeout->setSingleShot(true);
+        QObject::connect(timeout, &QTimer::timeout, process, &QProcess::kill);
+
+        QObject::connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                         [this, process, seed] (int exitCode, QProcess::ExitStatus status) {
+            process->deleteLater();
+            onWorkerFinished(seed, status != QProcess::NormalExit || exitCode != 0);
+        });
+        QObject::connect(process, &QProcess::errorOccurred, [this, process, seed] (QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                process->deleteLater();
+                onWorkerFinished(seed, true);
+            }
+        });
+
+        process->start(QCoreApplication::applicationFilePath(),
+                       { QStringLiteral("--seed"), QString::number(seed),
+                         QStringLiteral("--dump-file"), dumpFileForSeed(seed) });
+        timeout->start(s_workerTimeoutMs);
+    }
+}
+
+void Driver::onWorkerFinished(quint32 seed, bool failed)
+{
+    m_numRunning--;
+
+    if (failed) {
+        m_numFailed++;
+        const QString dumpFile = dumpFileForSeed(seed);
+        if (QFile::exists(dumpFile)) {
+            m_failedCases << dumpFile;
+            qDebug().noquote() << "Worker with seed" << seed << "failed, see" << dumpFile << "and" << logFileForSeed(seed);
+        } else {
+            // Killed or crashed before the fatal handler could dump
+            qDebug().noquote() << "Worker with seed" << seed << "failed without test case, see" << logFileForSeed(seed);
+        }
+    } else {
+        QFile::remove(logFileForSeed(seed));
+    }
+
+    startWorkers();
+    if (m_numRunning == 0)
+        qApp->quit();
+}
+
+void Driver::minimize(const QString &jsonFile)
+{
+    QVariantMap test = readTestCase(jsonFile);
+    QVariantList operations = test.value(QStringLiteral("operations")).toList();
+    const int originalSize = operations.size();
+    const QString candidateFile = QString(jsonFile).replace(QStringLiteral(".json"), QStringLiteral("_candidate.json"));
+
+    // Removes chunks of decreasing size, keeping each removal that still reproduces the failure
+    int numRuns = 0;
+    for (int chunk = operations.size() / 2; chunk >= 1 && numRuns < s_maxMinimizationRuns; chunk /= 2) {
+        int i = 0;
+        while (i < operations.size() && numRuns < s_maxMinimizationRuns) {
+            QVariantList candidate = operations;
+            candidate.erase(candidate.begin() + i, candidate.begin() + qMin(i + chunk, candidate.size()));
+            test.insert(QStringLiteral("operations"), candidate);
+            numRuns++;
+
+            if (stillFails(test, candidateFile))
+                operations = candidate;
+            else
+                i += chunk;
+        }
+    }
+
+    QFile::remove(candidateFile);
+    test.insert(QStringLiteral("operations"), operations);
+    const QString minimizedFile = QString(jsonFile).replace(QStringLiteral(".json"), QStringLiteral("_minimized.json"));
+    if (writeTestCase(test, minimizedFile)) {
+        qDebug().noquote() << QStringLiteral("Minimized %1 from %2 to %3 operations, in %4 runs: %5")
+                              .arg(jsonFile).arg(originalSize).arg(operations.size()).arg(numRuns).arg(minimizedFile);
+    }
+}
+
+bool Driver::stillFails(const QVariantMap &test, const QString &candidateFile) const
+{
+    if (!writeTestCase(test, candidateFile))
+        return false;
+
+    QProcess process;
+    process.setStandardOutputFile(QProcess::nullDevice());
+    process.setStandardErrorFile(QProcess::nullDevice());
+    process.start(QCoreApplication::applicationFilePath(), { candidateFile });
+    if (!process.waitForFinished(s_workerTimeoutMs)) {
+        process.kill();
+        process.waitForFinished();
+        return false; // Hanging is a different failure, don't minimize towards it
+    }
+
+    return process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0;
+}
+
+QString Driver::dumpFileForSeed(quint32 seed)
+{
+    return QStringLiteral("fuzzer_dump_%1.json").arg(seed);
+}
+
+QString Driver::logFileForSeed(quint32 seed)
+{
+    return QStringLiteral("fuzzer_%1.log").arg(seed);
+}
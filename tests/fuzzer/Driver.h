@@ -0,0 +1,77 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// We don't care about performance related checks in the tests
+// clazy:excludeall=ctor-missing-parent-argument,missing-qobject-macro,range-loop,missing-typeinfo,detaching-member,function-args-by-ref,non-pod-global-static,reserve-candidates,qstring-allocations
+
+#ifndef KDDOCKWIDGETS_FUZZER_DRIVER_H
+#define KDDOCKWIDGETS_FUZZER_DRIVER_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+namespace KDDockWidgets {
+namespace Testing {
+
+///@brief Runs fuzzer worker processes in parallel, each with its own seed, then minimizes the
+///test cases that failed.
+class Driver
+{
+public:
+    struct Config
+    {
+        int numJobs; ///< How many workers run at the same time
+        int numRuns; ///< How many workers to run in total, if durationSecs is 0
+        int durationSecs; ///< Keeps starting workers until this many seconds have passed
+        quint32 firstSeed;
+        bool minimize;
+    };
+
+    explicit Driver(const Config &config);
+
+    ///@brief Runs until the budget is used up. Returns the number of failing workers.
+    int run();
+
+private:
+    bool hasBudget() const;
+    void startWorkers();
+    void onWorkerFinished(quint32 seed, bool failed);
+
+    ///@brief Removes operations from the test case while it still fails, see stillFails()
+    void minimize(const QString &jsonFile);
+    bool stillFails(const QVariantMap &test, const QString &candidateFile) const;
+
+    static QString dumpFileForSeed(quint32 seed);
+    static QString logFileForSeed(quint32 seed);
+
+    const Config m_config;
+    QElapsedTimer m_clock;
+    int m_numStarted = 0;
+    int m_numRunning = 0;
+    QStringList m_failedCases;
+    int m_numFailed = 0;
+};
+
+}
+}
+
+#endif
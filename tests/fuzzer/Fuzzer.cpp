@@ -25,12 +25,18 @@
 #include "DockRegistry_p.h"
 #include "DockWidget.h"
 #include "MainWindow.h"
+#include "Config.h"
 
+#include <QElapsedTimer>
 #include <QJsonDocument>
 
 #include <QString>
 #include <QTest>
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
 using namespace KDDockWidgets;
 using namespace KDDockWidgets::Testing;
 using namespace KDDockWidgets::Testing::Operations;
@@ -101,7 +107,11 @@ void Fuzzer::runTest(const Test &test)
             qDebug() << "Running the bad guy:";
         }
 #endif
-        op->execute();
+        if (m_options & Option_Timed)
+            executeTimed(op);
+        else
+            op->execute();
+
         if (op->hasParams())
             qDebug() << "Ran" << op->description() << index;
         QTest::qWait(m_operationDelayMS);
@@ -367,7 +377,7 @@ void Fuzzer::onFatal()
 {
     if (m_dumpJsonOnFailure) {
         // Tests failed! Let's dump
-        m_currentTest.dumpToJsonFile("fuzzer_dump.json");
+        m_currentTest.dumpToJsonFile(m_dumpFileName);
     }
 
     if (!m_currentJsonFile.isEmpty()) {
@@ -380,6 +390,16 @@ void Fuzzer::setDelayBetweenOperations(int delay)
     m_operationDelayMS = delay;
 }
 
+void Fuzzer::setSeed(quint32 seed)
+{
+    m_randomEngine.seed(seed);
+}
+
+void Fuzzer::setDumpFileName(const QString &filename)
+{
+    m_dumpFileName = filename;
+}
+
 QByteArray Fuzzer::lastSavedLayout() const
 {
     return m_lastSavedLayout;
@@ -390,6 +410,88 @@ void Fuzzer::setLastSavedLayout(const QByteArray &serialized)
     m_lastSavedLayout = serialized;
 }
 
+void Fuzzer::executeTimed(const OperationBase::Ptr &op)
+{
+    const int layoutSize = DockRegistry::self()->frames().size();
+    const PerformanceCounters before = Config::self().performanceCounters();
+    QElapsedTimer timer;
+    timer.start();
+
+    op->execute();
+
+    const qint64 usecs = timer.nsecsElapsed() / 1000;
+    const PerformanceCounters after = Config::self().performanceCounters();
+    m_timings.push_back({ op->type(), usecs, after.relayouts - before.relayouts,
+                          after.widgetGeometryChanges - before.widgetGeometryChanges, layoutSize });
+}
+
+///@brief Returns the exponent k of the best fit of usecs = c * layoutSize^k. 1 means linear.
+///Returns 0 if there aren't enough samples.
+static double growthExponent(const QVector<Fuzzer::OperationTiming> &timings)
+{
+    double sumX = 0, sumY = 0, sumXY = 0, sumXX = 0;
+    int n = 0;
+    int minSize = INT_MAX;
+    int maxSize = 0;
+    for (const Fuzzer::OperationTiming &timing : timings) {
+        if (timing.layoutSize <= 0 || timing.usecs <= 0)
+            continue;
+
+        const double x = std::log(timing.layoutSize);
+        const double y = std::log(double(timing.usecs));
+        sumX += x;
+        sumY += y;
+        sumXY += x * y;
+        sumXX += x * x;
+        minSize = std::min(minSize, timing.layoutSize);
+        maxSize = std::max(maxSize, timing.layoutSize);
+        n++;
+    }
+
+    // Needs the layout to have grown for the fit to mean anything
+    const double denominator = n * sumXX - sumX * sumX;
+    if (n < 10 || maxSize < 2 * minSize || denominator <= 0)
+        return 0;
+
+    return (n * sumXY - sumX * sumY) / denominator;
+}
+
+void Fuzzer::reportTimings() const
+{
+    const QMetaEnum metaEnum = QMetaEnum::fromType<OperationType>();
+    qDebug().noquote() << "\nOperation                     count    p50(us)    p90(us)    p99(us)    max(us) relayouts growth";
+
+    for (int type = OperationType_None + 1; type < OperationType_Count; ++type) {
+        QVector<OperationTiming> timings;
+        QVector<qint64> usecs;
+        quint64 relayouts = 0;
+        for (const OperationTiming &timing : m_timings) {
+            if (timing.type == type) {
+                timings.push_back(timing);
+                usecs.push_back(timing.usecs);
+                relayouts += timing.relayouts;
+            }
+        }
+
+        if (timings.isEmpty())
+            continue;
+
+        std::sort(usecs.begin(), usecs.end());
+        const double exponent = growthExponent(timings);
+        const QString name = QString::fromLatin1(metaEnum.valueToKey(type)).remove(QStringLiteral("OperationType_"));
+        qDebug().noquote() << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8%9")
+                              .arg(name, -26)
+                              .arg(timings.size(), 8)
+                              .arg(Testing::percentile(usecs, 50), 10)
+                              .arg(Testing::percentile(usecs, 90), 10)
+                              .arg(Testing::percentile(usecs, 99), 10)
+                              .arg(usecs.last(), 10)
+                              .arg(double(relayouts) / timings.size(), 9, 'f', 1)
+                              .arg(exponent, 6, 'f', 2)
+                              .arg(exponent > 1.5 ? QStringLiteral(" SUPERLINEAR") : QString());
+    }
+}
+
 void Fuzzer::Test::dumpToJsonFile(const QString &filename) const
 {
     const QVariantMap map = toVariantMap();
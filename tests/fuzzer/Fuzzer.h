@@ -73,10 +73,21 @@ public:
     enum Option {
         Option_None = 0,
         Option_NoQuit = 1, ///< Don't quit when the tests finish. So we can debug in gammaray
-        Option_SkipLast = 2 ///< Don't execute the last test. Useful when the last one is the failing one and we want to inspect the state prior to crash
+        Option_SkipLast = 2, ///< Don't execute the last test. Useful when the last one is the failing one and we want to inspect the state prior to crash
+        Option_Timed = 4 ///< Records the duration and counters of each operation, see reportTimings()
     };
     Q_DECLARE_FLAGS(Options, Option)
 
+    ///@brief The cost of an operation executed with Option_Timed
+    struct OperationTiming
+    {
+        Operations::OperationType type;
+        qint64 usecs;
+        quint64 relayouts;
+        quint64 widgetGeometryChanges;
+        int layoutSize; ///< Number of frames before the operation ran
+    };
+
     struct FuzzerConfig
     {
         int numTests;
@@ -267,18 +278,32 @@ public:
     void onFatal() override;
     void setDelayBetweenOperations(int delay);
 
+    ///@brief Seeds the random operations, so a run can be reproduced. Random by default.
+    void setSeed(quint32 seed);
+
+    ///@brief Where the failing test is dumped, "fuzzer_dump.json" by default
+    void setDumpFileName(const QString &filename);
+
     QByteArray lastSavedLayout() const;
     void setLastSavedLayout(const QByteArray &serialized);
 
+    ///@brief Prints the percentiles of each operation type's durations, and flags the operation
+    ///types whose duration grows superlinearly with the layout size. Only for Option_Timed.
+    void reportTimings() const;
+
 private:
+    void executeTimed(const Operations::OperationBase::Ptr &);
+
     std::random_device m_randomDevice;
     std::mt19937 m_randomEngine;
     Fuzzer::Test m_currentTest;
     QString m_currentJsonFile;
     const bool m_dumpJsonOnFailure;
+    QString m_dumpFileName = QStringLiteral("fuzzer_dump.json");
     int m_operationDelayMS = 50;
     const Options m_options;
     QByteArray m_lastSavedLayout;
+    QVector<OperationTiming> m_timings;
 };
 
 }
@@ -22,6 +22,7 @@
 // clazy:excludeall=ctor-missing-parent-argument,missing-qobject-macro,range-loop,missing-typeinfo,detaching-member,function-args-by-ref,non-pod-global-static,reserve-candidates,qstring-allocations
 
 #include "Fuzzer.h"
+#include "Driver.h"
 #include "DockRegistry_p.h"
 #include "../utils.h"
 
@@ -31,6 +32,7 @@
 #include <QDebug>
 #include <QFile>
 #include <iostream>
+#include <random>
 
 using namespace KDDockWidgets;
 using namespace KDDockWidgets::Testing;
@@ -60,6 +62,27 @@ int main(int argc, char **argv)
     QCommandLineOption skipLastOption("a", QCoreApplication::translate("main", "Skips the last test (presumably failing)"));
     parser.addOption(skipLastOption);
 
+    QCommandLineOption timedOption("t", QCoreApplication::translate("main", "Timed mode. Records the duration and counters of each operation and prints percentiles per operation type at the end"));
+    parser.addOption(timedOption);
+
+    QCommandLineOption jobsOption("j", QCoreApplication::translate("main", "Runs <jobs> worker processes in parallel, each with its own seed, and minimizes the failing test cases"), "jobs");
+    parser.addOption(jobsOption);
+
+    QCommandLineOption runsOption("runs", QCoreApplication::translate("main", "With -j, how many workers to run in total. Defaults to <jobs>"), "runs");
+    parser.addOption(runsOption);
+
+    QCommandLineOption durationOption("duration", QCoreApplication::translate("main", "With -j, keeps starting workers until <seconds> have passed, instead of --runs"), "seconds");
+    parser.addOption(durationOption);
+
+    QCommandLineOption noMinimizeOption("no-minimize", QCoreApplication::translate("main", "With -j, doesn't minimize the failing test cases"));
+    parser.addOption(noMinimizeOption);
+
+    QCommandLineOption seedOption("seed", QCoreApplication::translate("main", "Seed for the random operations. With -j, the seed of the first worker"), "seed");
+    parser.addOption(seedOption);
+
+    QCommandLineOption dumpFileOption("dump-file", QCoreApplication::translate("main", "Where to dump the failing test, instead of fuzzer_dump.json"), "file");
+    parser.addOption(dumpFileOption);
+
     QCommandLineOption noQuitOption("n", QCoreApplication::translate("main", "Don't quit at the end, keep event loop running for debugging"));
     parser.addOption(noQuitOption);
 
@@ -70,6 +93,20 @@ int main(int argc, char **argv)
     const bool forceDumpJson = parser.isSet(forceDumpJsonOption);
 
     const QStringList filesToLoad = parser.positionalArguments();
+    const quint32 seed = parser.isSet(seedOption) ? parser.value(seedOption).toUInt()
+                                                  : std::random_device()();
+
+    if (parser.isSet(jobsOption)) {
+        Driver::Config config;
+        config.numJobs = qMax(1, parser.value(jobsOption).toInt());
+        config.numRuns = parser.isSet(runsOption) ? parser.value(runsOption).toInt() : config.numJobs;
+        config.durationSecs = parser.value(durationOption).toInt();
+        config.firstSeed = seed;
+        config.minimize = !parser.isSet(noMinimizeOption);
+
+        Driver driver(config);
+        return driver.run() == 0 ? 0 : 1;
+    }
     const bool dumpToJsonOnFatal = forceDumpJson || filesToLoad.isEmpty();
 
 
@@ -80,9 +117,18 @@ int main(int argc, char **argv)
     if (parser.isSet(noQuitOption))
         options |= Fuzzer::Option_NoQuit;
 
+    if (parser.isSet(timedOption))
+        options |= Fuzzer::Option_Timed;
+
     const bool loops = parser.isSet(loopOption);
 
     Fuzzer fuzzer(dumpToJsonOnFatal, options);
+    fuzzer.setSeed(seed);
+    if (filesToLoad.isEmpty())
+        qDebug() << "Seed:" << seed; // So the run can be reproduced with --seed
+    if (parser.isSet(dumpFileOption))
+        fuzzer.setDumpFileName(parser.value(dumpFileOption));
+
     if (slowDown)
         fuzzer.setDelayBetweenOperations(1000);
 
@@ -102,6 +148,9 @@ int main(int argc, char **argv)
             fuzzer.fuzz(filesToLoad);
         }
 
+        if (options & Fuzzer::Option_Timed)
+            fuzzer.reportTimings();
+
         if (!(options & Fuzzer::Option_NoQuit)) {
             // if noQuit is true we keep the app running so it can be debugged
             app.quit();
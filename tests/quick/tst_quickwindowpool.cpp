@@ -0,0 +1,108 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// clazy:excludeall=ctor-missing-parent-argument,missing-qobject-macro,non-pod-global-static
+
+#include "Config.h"
+#include "quick/QuickWindowPool_p.h"
+
+#include <QtTest/QtTest>
+#include <QGuiApplication>
+#include <QPointer>
+#include <QQuickWindow>
+
+using namespace KDDockWidgets;
+
+class TestQuickWindowPool : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void tst_refill();
+    void tst_clear();
+};
+
+void TestQuickWindowPool::tst_refill()
+{
+    QuickWindowPool *pool = QuickWindowPool::self();
+
+    // Tied to the application's lifetime, which a function static wouldn't be
+    QCOMPARE(pool->parent(), qApp);
+
+    Config::self().setFloatingWindowPoolSize(2);
+    QTRY_COMPARE(pool->count(), 2);
+
+    QPointer<QQuickWindow> window = pool->acquire();
+    QVERIFY(window);
+    QTRY_COMPARE(pool->count(), 2); // Refilled
+
+    // The pool is full already
+    pool->release(window);
+    QTRY_VERIFY(!window);
+    QCOMPARE(pool->count(), 2);
+
+    Config::self().setFloatingWindowPoolSize(0);
+    QTRY_COMPARE(pool->count(), 0);
+}
+
+void TestQuickWindowPool::tst_clear()
+{
+    // What happens on QCoreApplication::aboutToQuit()
+    QuickWindowPool *pool = QuickWindowPool::self();
+    Config::self().setFloatingWindowPoolSize(2);
+    QTRY_COMPARE(pool->count(), 2);
+
+    QPointer<QQuickWindow> window1 = pool->acquire();
+    QPointer<QQuickWindow> window2 = pool->acquire();
+    pool->release(window1);
+    pool->release(window2);
+    QCOMPARE(pool->count(), 2);
+
+    pool->clear();
+    QVERIFY(!window1);
+    QVERIFY(!window2);
+    QCOMPARE(pool->count(), 0);
+
+    Config::self().setFloatingWindowPoolSize(0);
+}
+
+int main(int argc, char *argv[])
+{
+    bool qpaPassed = false;
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "-platform") == 0) {
+            qpaPassed = true;
+            break;
+        }
+    }
+
+    if (!qpaPassed) {
+        // Use offscreen by default as it's less annoying, doesn't create visible windows
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    // Otherwise the pool warns that the windows won't share GPU resources
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+    QGuiApplication app(argc, argv);
+    TestQuickWindowPool test;
+
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_quickwindowpool.moc"
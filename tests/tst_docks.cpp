@@ -27,19 +27,27 @@
 #include "DockRegistry_p.h"
 #include "Frame_p.h"
 #include "private/widgets/FrameWidget_p.h"
+#include "private/widgets/TabWidgetWidget_p.h"
 #include "DropArea_p.h"
 #include "TitleBar_p.h"
 #include "WindowBeingDragged_p.h"
+#include "DragController_p.h"
+#include "FloatingWindowPool_p.h"
+#include "FramePool_p.h"
 #include "Utils_p.h"
 #include "LayoutSaver.h"
 #include "LayoutSaver_p.h"
+#include "LayoutStore.h"
 #include "TabWidget_p.h"
 #include "multisplitter/MultiSplitter_p.h"
+#include "multisplitter/Tracing_p.h"
 #include "Position_p.h"
 #include "utils.h"
 #include "FrameworkWidgetFactory.h"
 #include "DropAreaWithCentralFrame_p.h"
 #include "Testing.h"
+#include "InteractionDriver.h"
+#include "ProcessDockWidget.h"
 
 #include <QtTest/QtTest>
 #include <QPainter>
@@ -48,10 +56,16 @@
 #include <QAction>
 #include <QTime>
 #include <QPushButton>
+#include <QRubberBand>
 #include <QTextEdit>
 #include <QVBoxLayout>
 #include <QToolButton>
+#include <QLineEdit>
 #include <QStyleFactory>
+#include <QThread>
+#include <QLabel>
+#include <QProcess>
+#include <QWindow>
 
 #ifdef Q_OS_WIN
 # include <Windows.h>
@@ -184,8 +198,14 @@ struct EnsureTopLevelsDeleted
 
         // Other cleanup, since we use this class everywhere
         Config::self().setDockWidgetFactoryFunc(nullptr);
+        Config::self().setAsyncDockWidgetFactoryFunc(nullptr);
+        Config::self().setLayoutLocked(false);
+        Config::self().setPointerPredictionInterval(0);
         Config::self().setFlags(m_originalFlags);
         Config::self().setSeparatorThickness(m_originalSeparatorThickness);
+        Config::self().setFloatingWindowPoolSize(0);
+        Config::self().setFramePoolSize(0);
+        DefaultWidgetFactory::s_dropIndicatorType = DropIndicatorType::Classic;
     }
 
     QWidgetList topLevels() const
@@ -235,6 +255,70 @@ private Q_SLOTS:
     void tst_dockDockWidgetNested();
     void tst_dockFloatingWindowNested();
     void tst_dockWindowWithTwoSideBySideFramesIntoCenter();
+    void tst_coalesceDragMoves();
+    void tst_dragTimings();
+    void tst_dragWithPreview();
+    void tst_floatingWindowPool();
+    void tst_sharedIndicatorWindow();
+    void tst_animatedIndicators();
+    void tst_paintedRubberBand();
+    void tst_indicatorWindowRaises();
+    void tst_widgetFactory();
+    void tst_widgetFactoryUnloadWhenClosed();
+    void tst_suspendHiddenContent();
+    void tst_framePool();
+    void tst_framePoolReconnects();
+    void tst_setInitialGeometry();
+    void tst_itemIndexes();
+    void tst_stableContentWindow();
+    void tst_lowBandwidth();
+    void tst_scalableTabs();
+    void tst_releaseHiddenFloatingWindow();
+    void tst_addDockWidgets();
+    void tst_coalescedTitleUpdates();
+    void tst_systemMoveResize();
+    void tst_lazyResizeFloatingWindow();
+    void tst_hostPaintedSeparators();
+    void tst_perspectives();
+    void tst_layoutSnapshots();
+    void tst_restoreInPlace();
+    void tst_autoSave();
+    void tst_autoSaveJournal();
+    void tst_renderThumbnail();
+    void tst_restoredDockWidgets();
+    void tst_fastShutdown();
+    void tst_backgroundTabsNotResized();
+    void tst_resizeHandlerCursor();
+    void tst_coalescedScreenChangeResize();
+    void tst_interactionDriver();
+    void tst_fixedOnParentResize();
+    void tst_titleBarVisibilityBatch();
+    void tst_showDockWidgets();
+    void tst_setDockWidgetsFloating();
+    void tst_registryWatchesOnlyOwnWindows();
+    void tst_emptiedFramesAreDeletedDeterministically();
+    void tst_skipUnchangedRestore();
+    void tst_normalizedLayoutFormat();
+    void tst_dockingStateSnapshot();
+    void tst_moveTab();
+    void tst_memoryUsage();
+    void tst_asyncDockWidgetFactory();
+    void tst_processDockWidget();
+    void tst_lockedLayout();
+    void tst_penSeparatorDrag();
+    void tst_deferOffscreenFloatingWindows();
+    void tst_deferOffscreenFloatingWindowsPerAffinity();
+    void tst_progressiveRestore();
+    void tst_screenVariants();
+    void tst_restoreShowsOnce();
+    void tst_serializeUnchangedWindows();
+    void tst_layoutStore();
+    void tst_itemIsInMainWindowFollowsDocking();
+    void tst_closedDockWidgetsTracked();
+    void tst_topLevelsCache();
+    void tst_affinityPartitions();
+    void tst_searchDockWidgets();
+    void tst_performanceCounters();
     void tst_dockWindowWithTwoSideBySideFramesIntoLeft();
     void tst_dockWindowWithTwoSideBySideFramesIntoRight();
     void tst_posAfterLeftDetach();
@@ -253,6 +337,8 @@ private Q_SLOTS:
     void tst_addToSmallMainWindow6();
     void tst_fairResizeAfterRemoveWidget();
     void tst_notClosable();
+    void tst_aggregatedOptions();
+    void tst_sharedDockWidgetAndFrameLists();
     void tst_maximizeAndRestore();
     void tst_propagateResize2();
 
@@ -274,6 +360,7 @@ private Q_SLOTS:
     void tst_setAstCurrentTab();
     void tst_closeShowWhenNoCentralFrame();
     void tst_placeholderDisappearsOnReadd();
+    void tst_addMultiSplitterKeepsSeparators();
     void tst_placeholdersAreRemovedProperly();
     void tst_embeddedMainWindow();
     void tst_toggleMiddleDockCrash(); // tests some crash I got
@@ -304,6 +391,8 @@ private Q_SLOTS:
     void tst_positionWhenShown();
     void tst_restoreEmpty();
     void tst_restoreSimplest();
+    void tst_restoreBinary();
+    void tst_restoreCompressed();
     void tst_restoreSimple();
     void tst_restoreNestedAndTabbed();
     void tst_restoreCentralFrame();
@@ -318,6 +407,7 @@ private Q_SLOTS:
     void tst_restoreEmbeddedMainWindow();
     void tst_restoreWithDockFactory();
     void tst_restoreResizesLayout();
+    void tst_restoreRelativeScalesOnce();
     void tst_invalidLayoutAfterRestore();
     void tst_invalidJSON_data();
     void tst_invalidJSON();
@@ -326,10 +416,12 @@ private Q_SLOTS:
     void tst_resizeWindow();
     void tst_resizeWindow2();
     void tst_rectForDropCrash();
+    void tst_rectForDropCache();
 
     void tst_tabBarWithHiddenTitleBar_data();
     void tst_tabBarWithHiddenTitleBar();
     void tst_toggleDockWidgetWithHiddenTitleBar();
+    void tst_lazyActionsAndTitleBarButtons();
     void tst_dragByTabBar_data();
     void tst_dragByTabBar();
     void tst_dragBySingleTab();
@@ -824,6 +916,2429 @@ void TestDocks::tst_dockWindowWithTwoSideBySideFramesIntoCenter()
     delete fw2;
 }
 
+void TestDocks::tst_coalesceDragMoves()
+{
+    // Tests that a drag still drops at the right place when mouse moves are coalesced
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_CoalesceDragMoves);
+
+    auto fw = createFloatingWindow();
+    auto fw2 = createFloatingWindow();
+    fw2->move(fw->x() + fw->width() + 100, fw->y());
+
+    dragFloatingWindowTo(fw, fw2->geometry().center());
+    QVERIFY(fw2->dropArea()->checkSanity());
+
+    QCOMPARE(fw2->frames().size(), 1);
+    QCOMPARE(fw2->frames().constFirst()->dockWidgetCount(), 2);
+    QVERIFY(Testing::waitForDeleted(fw));
+    delete fw2;
+}
+
+void TestDocks::tst_dragTimings()
+{
+    EnsureTopLevelsDeleted e;
+    DragController *dc = DragController::instance();
+    dc->setTimingEnabled(true);
+
+    auto fw = createFloatingWindow();
+    auto fw2 = createFloatingWindow();
+    fw2->move(fw->x() + fw->width() + 100, fw->y());
+
+    QSignalSpy spy(dc, &DragController::dragTimingsAvailable);
+    dragFloatingWindowTo(fw, fw2->geometry().center());
+    QVERIFY(spy.count() == 1 || spy.wait());
+
+    const DragController::DragTimings timings = dc->lastDragTimings();
+    QCOMPARE(timings.size(), int(DragController::DragPhase_Count));
+    QVERIFY(timings.at(DragController::DragPhase_DropAreaUnderCursor).samples > 0);
+    QVERIFY(timings.at(DragController::DragPhase_Hover).samples > 0);
+    QCOMPARE(timings.at(DragController::DragPhase_Drop).samples, 1);
+
+    const DragController::PhaseTiming &hover = timings.at(DragController::DragPhase_Hover);
+    QVERIFY(hover.p50 <= hover.p99);
+    QVERIFY(hover.p99 <= hover.max);
+
+    dc->setTimingEnabled(false);
+    QVERIFY(Testing::waitForDeleted(fw));
+    delete fw2;
+}
+
+void TestDocks::tst_dragWithPreview()
+{
+    EnsureTopLevelsDeleted e;
+    if (KDDockWidgets::usesNativeTitleBar())
+        return; // Previews aren't used with native title bars
+
+    Config::self().setFlags(Config::self().flags() | Config::Flag_DragWithPreview);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", Qt::green);
+    auto dock2 = createDockWidget("dock2", Qt::red);
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    QVERIFY(!dock2->isFloating());
+
+    TitleBar *titleBar2 = dock2->frame()->titleBar();
+    const QPoint dest = m->geometry().bottomRight() + QPoint(100, 100);
+    drag(titleBar2, titleBar2->mapToGlobal(QPoint(5, 5)), dest, ButtonAction_Press);
+
+    // Only the preview moves, nothing was detached yet
+    QVERIFY(!dock2->isFloating());
+    QCOMPARE(m->multiSplitterLayout()->count(), 2);
+
+    // Released over empty space, so now it's detached
+    releaseOn(dest, titleBar2);
+    QVERIFY(dock2->isFloating());
+    QVERIFY(dock2->window()->isVisible());
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+
+    delete dock2->window();
+}
+
+void TestDocks::tst_floatingWindowPool()
+{
+    EnsureTopLevelsDeleted e;
+    FloatingWindowPool *pool = FloatingWindowPool::self();
+    QCOMPARE(pool->parent(), qApp); // Doesn't outlive it
+    Config::self().setFloatingWindowPoolSize(1);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    QTRY_COMPARE(pool->count(), 1); // Filled once there's a main window to parent to
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    QCOMPARE(pool->count(), 0); // Was taken
+    QPointer<FloatingWindow> fw1 = dock1->floatingWindow();
+    QVERIFY(fw1);
+    QCOMPARE(fw1->parentWidget(), m.get());
+    QVERIFY(DockRegistry::self()->nestedwindows().contains(fw1));
+
+    QTRY_COMPARE(pool->count(), 1); // Refilled
+
+    // Docking deletes the emptied window, as the pool is already full
+    m->addDockWidget(dock1, Location_OnLeft);
+    QVERIFY(Testing::waitForDeleted(fw1));
+    QCOMPARE(pool->count(), 1);
+
+    m.reset();
+    QCOMPARE(pool->count(), 0); // Pooled windows are children of the main window
+}
+
+void TestDocks::tst_sharedIndicatorWindow()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_SharedIndicatorWindow);
+
+    auto indicatorWindowCount = [] {
+        int count = 0;
+        for (QWidget *w : qApp->topLevelWidgets()) {
+            if (w->objectName() == QLatin1String("_docks_IndicatorWindow_Overlay"))
+                count++;
+        }
+        return count;
+    };
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    QCOMPARE(indicatorWindowCount(), 1); // Instead of one per drop area
+
+    // Dragging from one drop area to another still works, the window is just retargeted
+    QPointer<FloatingWindow> fw1 = dock1->floatingWindow();
+    dragFloatingWindowTo(dock2->floatingWindow(), m->dropArea(), DropIndicatorOverlayInterface::DropLocation_Left);
+    dragFloatingWindowTo(fw1, m->dropArea(), DropIndicatorOverlayInterface::DropLocation_Right);
+    QCOMPARE(m->multiSplitterLayout()->count(), 2);
+
+    delete dock1;
+    delete dock2;
+    m.reset();
+    QCOMPARE(indicatorWindowCount(), 0); // Deleted with the last drop area
+}
+
+void TestDocks::tst_animatedIndicators()
+{
+    EnsureTopLevelsDeleted e;
+    DefaultWidgetFactory::s_dropIndicatorType = DropIndicatorType::Animated;
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    QCOMPARE(m->dropArea()->dropIndicatorOverlay()->indicatorType(), DropIndicatorOverlayInterface::TypeAnimated);
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    dragFloatingWindowTo(dock2->floatingWindow(), m->dropArea(), DropIndicatorOverlayInterface::DropLocation_Right);
+    QCOMPARE(m->multiSplitterLayout()->count(), 2);
+    QVERIFY(dock2->frame()->x() > dock1->frame()->x());
+
+    delete dock1;
+    delete dock2;
+}
+
+void TestDocks::tst_paintedRubberBand()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_PaintedRubberBand);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    DropArea *dropArea = m->dropArea();
+    DropIndicatorOverlayInterface *overlay = dropArea->dropIndicatorOverlay();
+    QCOMPARE(overlay->indicatorType(), DropIndicatorOverlayInterface::TypeClassic);
+    QVERIFY(!dropArea->findChild<QRubberBand*>());
+
+    // The overlay itself paints it, so it's only shown while hovering
+    FloatingWindow *fw = dock2->floatingWindow();
+    dropArea->hover(fw, dock1->frame()->mapToGlobal(dock1->frame()->rect().center()));
+    QVERIFY(overlay->isVisible());
+    dropArea->hover(fw, overlay->posForIndicator(DropIndicatorOverlayInterface::DropLocation_Right));
+    QCOMPARE(overlay->currentDropLocation(), DropIndicatorOverlayInterface::DropLocation_Right);
+    dropArea->removeHover();
+    QVERIFY(!overlay->isVisible());
+
+    dragFloatingWindowTo(fw, dropArea, DropIndicatorOverlayInterface::DropLocation_Right);
+    QCOMPARE(m->multiSplitterLayout()->count(), 2);
+    QVERIFY(dock2->frame()->x() > dock1->frame()->x());
+
+    delete dock1;
+    delete dock2;
+}
+
+void TestDocks::tst_indicatorWindowRaises()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock3, Location_OnRight);
+
+    // QWidget::raise() sends ZOrderChange
+    struct RaiseCounter : public QObject
+    {
+        bool eventFilter(QObject *, QEvent *ev) override
+        {
+            if (ev->type() == QEvent::ZOrderChange)
+                count++;
+            return false;
+        }
+
+        int count = 0;
+    } counter;
+
+    const QWidgetList topLevels = qApp->topLevelWidgets();
+    for (QWidget *w : topLevels) {
+        if (w->objectName() == QLatin1String("_docks_IndicatorWindow_Overlay"))
+            w->installEventFilter(&counter);
+    }
+
+    DropArea *dropArea = m->dropArea();
+    FloatingWindow *fw = dock2->floatingWindow();
+    auto centerOf = [] (DockWidgetBase *dock) {
+        return dock->frame()->mapToGlobal(dock->frame()->rect().center());
+    };
+
+    // Raised when shown
+    dropArea->hover(fw, centerOf(dock1));
+    const int raisesWhenShown = counter.count;
+    QVERIFY(raisesWhenShown > 0);
+
+    // But not for hovering other frames of the same drop area
+    dropArea->hover(fw, centerOf(dock3));
+    dropArea->hover(fw, centerOf(dock1) + QPoint(5, 5));
+    dropArea->hover(fw, centerOf(dock3));
+    QCOMPARE(counter.count, raisesWhenShown);
+
+    // Another top-level shown on top might cover it
+    auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+    dropArea->hover(fw, centerOf(dock1));
+    QCOMPARE(counter.count, raisesWhenShown + 1);
+
+    // Hidden and shown again
+    dropArea->removeHover();
+    dropArea->hover(fw, centerOf(dock1));
+    QVERIFY(counter.count > raisesWhenShown + 1);
+    dropArea->removeHover();
+
+    for (QWidget *w : topLevels)
+        w->removeEventFilter(&counter);
+    delete dock1;
+    delete dock2;
+    delete dock3;
+    delete dock4;
+}
+
+void TestDocks::tst_widgetFactory()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    int created = 0;
+    auto dock2 = new DockWidget("dock2");
+    dock2->setWidgetFactory([&created] {
+        created++;
+        return new QPushButton("two");
+    }, /*unloadAfterMs=*/ 0);
+
+    // In a background tab it's not created yet
+    dock1->addDockWidgetAsTab(dock2);
+    dock1->setAsCurrentTab();
+    QVERIFY(!dock2->isVisible());
+    QVERIFY(!dock2->widget());
+    QCOMPARE(created, 0);
+
+    // Created once it becomes current
+    dock2->setAsCurrentTab();
+    QVERIFY(dock2->widget());
+    QCOMPARE(created, 1);
+    QCOMPARE(DockRegistry::self()->dockWidgetForGuest(dock2->widget()), dock2);
+
+    // Deleted after being hidden, and created again when shown
+    QPointer<QWidget> guest = dock2->widget();
+    dock2->close();
+    QVERIFY(Testing::waitForDeleted(guest));
+    QVERIFY(!dock2->widget());
+
+    dock2->show();
+    QTRY_VERIFY(dock2->widget());
+    QCOMPARE(created, 2);
+
+    delete dock2;
+}
+
+void TestDocks::tst_widgetFactoryUnloadWhenClosed()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    int created = 0;
+    auto dock2 = new DockWidget("dock2");
+    dock2->setWidgetFactory([&created] {
+        created++;
+        return new QPushButton("two");
+    }, /*unloadAfterMs=*/ 0, DockWidgetBase::UnloadPolicy_WhenClosed);
+    dock1->addDockWidgetAsTab(dock2);
+    dock2->setAsCurrentTab();
+    QCOMPARE(created, 1);
+
+    // A background tab keeps its widget
+    QPointer<QWidget> guest = dock2->widget();
+    dock1->setAsCurrentTab();
+    QVERIFY(!dock2->isVisible());
+    QTest::qWait(50);
+    QVERIFY(guest);
+
+    // Closing deletes it, but the dock widget still knows where it was
+    dock2->close();
+    QVERIFY(Testing::waitForDeleted(guest));
+    QVERIFY(!dock2->widget());
+    QVERIFY(dock2->lastPositions().isValid());
+
+    dock2->show();
+    QTRY_VERIFY(dock2->widget());
+    QCOMPARE(created, 2);
+    QCOMPARE(dock2->frame(), dock1->frame());
+
+    delete dock2;
+}
+
+void TestDocks::tst_suspendHiddenContent()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_SuspendHiddenContent);
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    QTRY_VERIFY(dock1->isVisibleToUser());
+
+    QTimer timer;
+    timer.start(1000);
+    dock1->addUpdateSource(&timer);
+
+    QSignalSpy spy(dock1, &DockWidgetBase::visibleToUserChanged);
+    dock1->addDockWidgetAsTab(dock2);
+    dock2->setAsCurrentTab();
+    QVERIFY(!dock1->isVisibleToUser());
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(!dock1->widget()->updatesEnabled());
+    QVERIFY(!timer.isActive());
+
+    dock1->setAsCurrentTab();
+    QTRY_VERIFY(dock1->isVisibleToUser());
+    QVERIFY(dock1->widget()->updatesEnabled());
+    QVERIFY(timer.isActive());
+
+    // Updates the widget disabled itself stay disabled
+    dock1->widget()->setUpdatesEnabled(false);
+    dock2->setAsCurrentTab();
+    QVERIFY(!dock1->isVisibleToUser());
+    dock1->setAsCurrentTab();
+    QTRY_VERIFY(dock1->isVisibleToUser());
+    QVERIFY(!dock1->widget()->updatesEnabled());
+    dock1->widget()->setUpdatesEnabled(true);
+
+    // Minimizing the window also counts as hidden
+    dock1->window()->showMinimized();
+    QTRY_VERIFY(!dock1->isVisibleToUser());
+    QVERIFY(!timer.isActive());
+
+    delete dock1->window();
+}
+
+void TestDocks::tst_framePool()
+{
+    EnsureTopLevelsDeleted e;
+    FramePool *pool = FramePool::self();
+    Config::self().setFramePoolSize(1);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    QPointer<Frame> frame1 = dock1->frame();
+
+    // The emptied frame is kept instead of deleted
+    dock1->setFloating(true);
+    QTRY_COMPARE(pool->count(), 1);
+    QVERIFY(frame1);
+    QVERIFY(!frame1->isVisible());
+    QVERIFY(!frame1->parent());
+    QVERIFY(!DockRegistry::self()->frames().contains(frame1));
+    QCOMPARE(m->multiSplitterLayout()->placeholderCount(), 1);
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+
+    // And reused by the next dock widget that needs a frame
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock3, Location_OnTop);
+    QCOMPARE(dock3->frame(), frame1.data());
+    QVERIFY(DockRegistry::self()->frames().contains(frame1));
+    QVERIFY(frame1->isVisible());
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+
+    // Restoring to the placeholder works as before
+    dock1->setFloating(false);
+    QCOMPARE(dock1->window(), m.get());
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+
+    Config::self().setFramePoolSize(0);
+    QCOMPARE(pool->count(), 0);
+}
+
+void TestDocks::tst_framePoolReconnects()
+{
+    EnsureTopLevelsDeleted e;
+    FramePool *pool = FramePool::self();
+    Config::self().setFramePoolSize(1);
+
+    Frame *frame = pool->frame();
+    for (int i = 0; i < 2; ++i) {
+        QVERIFY(pool->recycle(frame));
+        QCOMPARE(pool->frame(), frame);
+    }
+
+    // Each signal is still only handled once
+    QSignalSpy spy(DockRegistry::self(), &DockRegistry::layoutChanged);
+    Q_EMIT frame->numDockWidgetsChanged();
+    Q_EMIT frame->currentDockWidgetChanged(nullptr);
+    Q_EMIT frame->dockWidgetsReordered();
+    QCOMPARE(spy.count(), 3);
+
+    delete frame;
+    Config::self().setFramePoolSize(0);
+}
+
+void TestDocks::tst_setInitialGeometry()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = std::unique_ptr<MainWindow>(new MainWindow(QStringLiteral("m1"), MainWindowOption_None));
+    m->setInitialGeometry(QRect(100, 100, 1000, 800));
+
+    // The layout has its final size before being shown
+    QVERIFY(!m->isVisible());
+    const QSize layoutSize = m->multiSplitterLayout()->size();
+    QCOMPARE(layoutSize, m->dropArea()->size());
+    QVERIFY(layoutSize.width() > 900 && layoutSize.width() <= 1000);
+    QVERIFY(layoutSize.height() > 700 && layoutSize.height() <= 800);
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"), {}, /*show=*/ false);
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"), {}, /*show=*/ false);
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    const QRect frameGeometry = dock2->frame()->geometry();
+
+    // So showing doesn't resize it
+    m->show();
+    QVERIFY(QTest::qWaitForWindowExposed(m->windowHandle()));
+    QCOMPARE(m->geometry(), QRect(100, 100, 1000, 800));
+    QCOMPARE(m->multiSplitterLayout()->size(), layoutSize);
+    QCOMPARE(dock2->frame()->geometry(), frameGeometry);
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+}
+
+void TestDocks::tst_itemIndexes()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnBottom, dock2);
+
+    auto checkIndexes = [layout] {
+        const Layouting::Item::List items = layout->items();
+        for (int i = 0; i < items.size(); ++i) {
+            if (layout->indexOfItem(items.at(i)) != i || layout->itemAtIndex(i) != items.at(i))
+                return false;
+        }
+        return !layout->itemAtIndex(items.size()) && !layout->itemAtIndex(-1);
+    };
+
+    QVERIFY(checkIndexes());
+
+    // Structural changes are picked up, placeholders included
+    dock1->close();
+    auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+    m->addDockWidget(dock4, Location_OnLeft);
+    QVERIFY(checkIndexes());
+    QCOMPARE(layout->indexOfItem(layout->itemForFrame(dock4->frame())), 0);
+
+    // Items of other layouts aren't found
+    dock2->setFloating(true);
+    QVERIFY(checkIndexes());
+    QCOMPARE(layout->indexOfItem(dock2->floatingWindow()->multiSplitterLayout()->items().first()), -1);
+
+    // And the saved placeholders still point to the right items
+    const QByteArray saved = LayoutSaver().serializeLayout();
+    LayoutSaver restorer;
+    QVERIFY(restorer.restoreLayout(saved));
+    dock1->show();
+    QCOMPARE(dock1->window(), m.get());
+    QVERIFY(layout->checkSanity());
+
+    delete dock2->window();
+}
+
+void TestDocks::tst_stableContentWindow()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto guest = new QPushButton("one");
+    auto dock1 = createDockWidget("dock1", guest, DockWidgetBase::Option_StableContentWindow);
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    QWidget *holder = guest->window();
+    QVERIFY(holder != dock1->window());
+    QVERIFY(holder->windowHandle());
+    QPointer<QWindow> holderWindow = holder->windowHandle();
+
+    // Docking, tabbing, and floating only move the container, the guest keeps its native window
+    m->addDockWidget(dock1, Location_OnLeft);
+    QCOMPARE(guest->window(), holder);
+    QCOMPARE(dock1->window(), m.get());
+    QCOMPARE(holderWindow->parent(), m->windowHandle());
+
+    dock2->addDockWidgetAsTab(dock1);
+    QCOMPARE(guest->window(), holder);
+
+    dock1->setFloating(true);
+    QCOMPARE(guest->window(), holder);
+    QCOMPARE(holder->windowHandle(), holderWindow.data());
+
+    m->addDockWidget(dock1, Location_OnRight);
+    QCOMPARE(guest->window(), holder);
+    QCOMPARE(holder->windowHandle(), holderWindow.data());
+
+    // Also when set later, and when unset
+    QWidget *guest2 = dock2->widget();
+    dock2->setOptions(DockWidgetBase::Option_StableContentWindow);
+    QPointer<QWidget> holder2 = guest2->window();
+    QVERIFY(holder2 != dock2->window());
+    QVERIFY(holder2->windowHandle());
+    dock2->setOptions(DockWidgetBase::Options());
+    QVERIFY(!holder2);
+    QCOMPARE(guest2->parentWidget(), static_cast<QWidget*>(dock2));
+    QVERIFY(!dock2->findChild<QWidget*>(QStringLiteral("contentContainer")));
+
+    // The guest is still deleted with its dock widget
+    QPointer<QWidget> guestPtr = guest;
+    delete dock1;
+    QVERIFY(!guestPtr);
+    QVERIFY(!holderWindow);
+    delete dock2;
+}
+
+void TestDocks::tst_lowBandwidth()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_LowBandwidth);
+
+    // The profile turns on the flags it relies on, and reaches the layouting engine
+    const Config::Flags flags = Config::self().flags();
+    QVERIFY(flags & Config::Flag_LazyResize);
+    QVERIFY(flags & Config::Flag_DragWithPreview);
+    QVERIFY(flags & Config::Flag_CoalesceDragMoves);
+    QVERIFY(Layouting::Separator::usesLazyResize);
+    QVERIFY(!windowManagerHasTranslucency());
+
+    // The detection can be overridden
+    qputenv("KDDOCKWIDGETS_LOW_BANDWIDTH", "1");
+    QVERIFY(Config::isRemoteDesktopSession());
+    qputenv("KDDOCKWIDGETS_LOW_BANDWIDTH", "0");
+    QVERIFY(!Config::isRemoteDesktopSession());
+    qunsetenv("KDDOCKWIDGETS_LOW_BANDWIDTH");
+}
+
+void TestDocks::tst_scalableTabs()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_ScalableTabs);
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    auto tabWidget = dynamic_cast<TabWidgetWidget*>(dock1->frame()->tabWidget());
+    QVERIFY(tabWidget);
+    QVERIFY(tabWidget->tabListButton());
+    QVERIFY(!tabWidget->tabListButton()->isVisible());
+
+    for (int i = 2; i <= 50; ++i) {
+        auto dock = createDockWidget(QStringLiteral("dock%1").arg(i), new QPushButton(QStringLiteral("%1").arg(i)));
+        dock1->addDockWidgetAsTab(dock);
+    }
+    QCOMPARE(tabWidget->count(), 50);
+    QVERIFY(tabWidget->tabListButton()->isVisible());
+
+    // Typing filters the list, enter picks the first match
+    tabWidget->showTabList();
+    auto popup = tabWidget->findChild<QFrame*>(QStringLiteral("_docks_TabListPopup"));
+    QVERIFY(popup);
+    auto lineEdit = popup->findChild<QLineEdit*>();
+    QVERIFY(lineEdit);
+    QTest::keyClicks(lineEdit, QStringLiteral("dock42"));
+    QTest::keyClick(lineEdit, Qt::Key_Return);
+    QCOMPARE(tabWidget->tabText(tabWidget->currentIndex()), QStringLiteral("dock42"));
+    QTRY_VERIFY(!tabWidget->findChild<QFrame*>(QStringLiteral("_docks_TabListPopup")));
+
+    // The measured sizes aren't reused for another tab shape
+    QTabBar *tabBar = tabWidget->tabBar();
+    const QRect northRect = tabBar->tabRect(0);
+    QVERIFY(northRect.width() > northRect.height());
+    tabBar->setShape(QTabBar::RoundedWest);
+    const QRect westRect = tabBar->tabRect(0);
+    QVERIFY(westRect.height() > westRect.width());
+    tabBar->setShape(QTabBar::RoundedNorth);
+    QCOMPARE(tabBar->tabRect(0).size(), northRect.size());
+}
+
+void TestDocks::tst_releaseHiddenFloatingWindow()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setHiddenFloatingWindowReleaseDelay(0);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    QPointer<FloatingWindow> fw = dock1->floatingWindow();
+    QVERIFY(fw->windowHandle());
+    const QRect geometry = fw->geometry();
+
+    fw->hide();
+    QTRY_VERIFY(!fw->windowHandle());
+    QVERIFY(fw);
+    QCOMPARE(dock1->floatingWindow(), fw.data());
+
+    // Created again on show, with the same content and geometry
+    fw->show();
+    QVERIFY(fw->windowHandle());
+    QVERIFY(dock1->isVisible());
+    QCOMPARE(fw->geometry(), geometry);
+
+    // Disabled, the native window is kept
+    Config::self().setHiddenFloatingWindowReleaseDelay(-1);
+    fw->hide();
+    QTest::qWait(50);
+    QVERIFY(fw->windowHandle());
+
+    delete fw;
+}
+
+void TestDocks::tst_addDockWidgets()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+
+    QVector<MainWindowBase::DockWidgetEntry> entries(4);
+    entries[0].dockWidget = dock1;
+    entries[0].location = Location_OnLeft;
+    entries[1].dockWidget = dock2;
+    entries[1].location = Location_OnRight;
+    entries[2].dockWidget = dock3;
+    entries[2].location = Location_OnBottom;
+    entries[2].relativeTo = dock2;
+    entries[3].dockWidget = dock4;
+    entries[3].tabbedWith = dock1;
+
+    m->addDockWidgets(entries, /*equally=*/ true);
+
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    QCOMPARE(layout->count(), 3);
+    QCOMPARE(dock4->frame(), dock1->frame());
+    QCOMPARE(dock3->window(), m.get());
+    QVERIFY(dock1->frame()->x() < dock2->frame()->x());
+    QVERIFY(dock2->frame()->y() < dock3->frame()->y());
+    QCOMPARE(dock1->frame()->height(), layout->rootItem()->height());
+    QVERIFY(layout->checkSanity());
+}
+
+void TestDocks::tst_coalescedTitleUpdates()
+{
+    EnsureTopLevelsDeleted e;
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    TitleBar *titleBar = dock1->frame()->titleBar();
+    QSignalSpy spy(titleBar, &TitleBar::titleChanged);
+
+    dock1->setTitle(QStringLiteral("rows: 1"));
+    dock1->setTitle(QStringLiteral("rows: 2"));
+    dock1->setTitle(QStringLiteral("rows: 3"));
+    QCOMPARE(spy.count(), 0);
+
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(titleBar->title(), QStringLiteral("rows: 3"));
+    QCOMPARE(dock1->floatingWindow()->titleBar()->title(), QStringLiteral("rows: 3"));
+
+    delete dock1->window();
+}
+
+void TestDocks::tst_systemMoveResize()
+{
+    // Where the platform can't move windows itself, dragging falls back to setting the position
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_SystemMoveResize);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    QPointer<FloatingWindow> fw1 = dock1->floatingWindow();
+    dragFloatingWindowTo(fw1, m->dropArea(), DropIndicatorOverlayInterface::DropLocation_Left);
+    QCOMPARE(dock1->window(), m.get());
+    QVERIFY(Testing::waitForDeleted(fw1));
+    QVERIFY(!DragController::instance()->isDragging());
+}
+
+void TestDocks::tst_lazyResizeFloatingWindow()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_LazyResize);
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    FloatingWindow *fw = dock1->floatingWindow();
+    const QSize originalSize = fw->size();
+
+    const QPoint corner = fw->mapToGlobal(QPoint(fw->width() - 2, fw->height() - 2));
+    const QPoint dest = corner + QPoint(50, 40);
+    pressOn(corner, fw);
+    QCursor::setPos(dest);
+    QMouseEvent ev(QEvent::MouseMove, fw->mapFromGlobal(dest), dest, Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    qApp->sendEvent(fw, &ev);
+
+    // Only the outline follows the mouse
+    QCOMPARE(fw->size(), originalSize);
+
+    releaseOn(dest, fw);
+    QCOMPARE(fw->size(), originalSize + QSize(50, 40));
+
+    delete fw;
+}
+
+void TestDocks::tst_hostPaintedSeparators()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_HostPaintedSeparators);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    QCOMPARE(layout->separators().size(), 1);
+    Layouting::Separator *separator = layout->separators().constFirst();
+    QVERIFY(!separator->isVisible());
+    QVERIFY(layout->checkSanity());
+
+    separator->parentContainer()->requestSeparatorMove(separator, 100);
+    QVERIFY(dock1->frame()->width() > dock2->frame()->width());
+
+    // The host receives the mouse events and routes them to the separator under the cursor
+    const QPoint separatorCenter = m->dropArea()->mapToGlobal(separator->geometry().center());
+    doubleClickOn(separatorCenter, m->dropArea());
+    QVERIFY(qAbs(dock1->frame()->width() - dock2->frame()->width()) <= 1);
+    QVERIFY(layout->checkSanity());
+}
+
+void TestDocks::tst_perspectives()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    LayoutSaver saver;
+    QVERIFY(saver.savePerspective(QStringLiteral("docked")));
+
+    dock2->setFloating(true);
+    QVERIFY(dock2->isFloating());
+    QVERIFY(saver.savePerspective(QStringLiteral("floating")));
+    QCOMPARE(LayoutSaver::perspectives().size(), 2);
+
+    // Flip between them a few times, each keeps its own state
+    for (int i = 0; i < 3; ++i) {
+        QVERIFY(saver.restorePerspective(QStringLiteral("docked")));
+        QVERIFY(!dock2->isFloating());
+        QCOMPARE(dock2->window(), m.get());
+        QCOMPARE(m->multiSplitterLayout()->count(), 2);
+        QVERIFY(m->multiSplitterLayout()->checkSanity());
+
+        QVERIFY(saver.restorePerspective(QStringLiteral("floating")));
+        QVERIFY(dock2->isFloating());
+        QCOMPARE(m->multiSplitterLayout()->count(), 1);
+        QVERIFY(m->multiSplitterLayout()->checkSanity());
+    }
+
+    {
+        SetExpectedWarning sew("No perspective called");
+        QVERIFY(!saver.restorePerspective(QStringLiteral("unknown")));
+    }
+
+    LayoutSaver::removePerspective(QStringLiteral("docked"));
+    LayoutSaver::removePerspective(QStringLiteral("floating"));
+    QVERIFY(LayoutSaver::perspectives().isEmpty());
+    delete dock2->window();
+}
+
+void TestDocks::tst_layoutSnapshots()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnRight);
+
+    LayoutSaver saver;
+    QVERIFY(LayoutSaver::Snapshot().isNull());
+    const LayoutSaver::Snapshot initial = saver.takeSnapshot();
+    QVERIFY(!initial.isNull());
+    const int width1 = dock1->frame()->width();
+
+    // A separator move, restored in place
+    Layouting::Separator *separator = m->multiSplitterLayout()->separators().constFirst();
+    separator->parentContainer()->requestSeparatorMove(separator, 100);
+    QVERIFY(dock1->frame()->width() != width1);
+    const LayoutSaver::Snapshot moved = saver.takeSnapshot();
+    const int movedWidth1 = dock1->frame()->width();
+
+    dock3->close();
+    const LayoutSaver::Snapshot closed = saver.takeSnapshot();
+    QCOMPARE(m->multiSplitterLayout()->count(), 2);
+
+    // Undo, in order
+    QVERIFY(saver.restoreSnapshot(moved));
+    QVERIFY(dock3->isVisible());
+    QCOMPARE(m->multiSplitterLayout()->count(), 3);
+    QPointer<Frame> frame1 = dock1->frame();
+    QCOMPARE(frame1->width(), movedWidth1);
+
+    QVERIFY(saver.restoreSnapshot(initial));
+    QCOMPARE(dock1->frame(), frame1.data());
+    QCOMPARE(dock1->frame()->width(), width1);
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+
+    // Redo
+    QVERIFY(saver.restoreSnapshot(moved));
+    QCOMPARE(dock1->frame()->width(), movedWidth1);
+    QVERIFY(saver.restoreSnapshot(closed));
+    QVERIFY(!dock3->isVisible());
+    QCOMPARE(m->multiSplitterLayout()->count(), 2);
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+
+    // Snapshots taken after restoring one are valid too
+    const LayoutSaver::Snapshot again = saver.takeSnapshot();
+    QVERIFY(saver.restoreSnapshot(initial));
+    QVERIFY(dock3->isVisible());
+    QVERIFY(saver.restoreSnapshot(again));
+    QVERIFY(!dock3->isVisible());
+
+    SetExpectedWarning sew("Null snapshot");
+    QVERIFY(!saver.restoreSnapshot(LayoutSaver::Snapshot()));
+}
+
+void TestDocks::tst_restoreInPlace()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    dock2->addDockWidgetAsTab(dock3);
+
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    QPointer<Frame> frame1 = dock1->frame();
+    QPointer<Frame> frame2 = dock2->frame();
+    const int width1 = frame1->width();
+    const int currentTab = frame2->currentTabIndex();
+
+    LayoutSaver saver(RestoreOption_InPlace);
+    const QByteArray saved = saver.serializeLayout();
+
+    Layouting::Separator *separator = layout->separators().constFirst();
+    separator->parentContainer()->requestSeparatorMove(separator, 100);
+    frame2->setCurrentTabIndex(currentTab == 0 ? 1 : 0);
+    QVERIFY(frame1->width() != width1);
+
+    // Same structure, the frames are kept and only geometries and tabs change
+    QVERIFY(saver.restoreLayout(saved));
+    QCOMPARE(dock1->frame(), frame1.data());
+    QCOMPARE(dock2->frame(), frame2.data());
+    QCOMPARE(frame1->width(), width1);
+    QCOMPARE(frame2->currentTabIndex(), currentTab);
+    QVERIFY(layout->checkSanity());
+
+    // Different structure, falls back to a full restore
+    dock3->setFloating(true);
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(!dock3->isFloating());
+    QCOMPARE(dock3->frame(), dock2->frame());
+    QCOMPARE(layout->count(), 2);
+    QVERIFY(layout->checkSanity());
+
+    // A main window the layout doesn't mention is cleared, like a full restore does
+    auto m2 = createMainWindow(QSize(800, 500), MainWindowOption_None, "m2");
+    auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+    m2->addDockWidget(dock4, Location_OnLeft);
+    frame1 = dock1->frame();
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(!dock4->isOpen());
+    QVERIFY(dock1->frame() != frame1.data());
+    QVERIFY(layout->checkSanity());
+    delete dock4;
+}
+
+void TestDocks::tst_autoSave()
+{
+    EnsureTopLevelsDeleted e;
+    const QString filename = QStringLiteral("autosave.json");
+    QFile::remove(filename);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    // Long delay, so nothing is written until flushed
+    LayoutSaver::setAutoSaveFile(filename, LayoutSaver::Format::Json, 100000);
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock2, Location_OnRight);
+    QVERIFY(!QFile::exists(filename));
+
+    LayoutSaver::flushAutoSave();
+    QVERIFY(QFile::exists(filename));
+
+    dock2->setFloating(true);
+    LayoutSaver saver;
+    QVERIFY(saver.restoreFromFile(filename));
+    QVERIFY(!dock2->isFloating());
+    QCOMPARE(m->multiSplitterLayout()->count(), 2);
+
+    LayoutSaver::setAutoSaveFile(QString());
+    QFile::remove(filename);
+}
+
+void TestDocks::tst_autoSaveJournal()
+{
+    EnsureTopLevelsDeleted e;
+    const QString filename = QStringLiteral("autosave.journal");
+    QFile::remove(filename);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    // Starts with a snapshot
+    LayoutSaver::setAutoSaveJournal(filename);
+    LayoutSaver::flushAutoSave();
+    QFile f(filename);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    const QByteArray snapshot = f.readAll();
+    f.close();
+    QCOMPARE(snapshot.count('\n'), 2);
+
+    // Then only appends
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock2, Location_OnRight);
+    LayoutSaver::flushAutoSave();
+    dock1->close();
+    LayoutSaver::flushAutoSave();
+
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    const QByteArray journal = f.readAll();
+    f.close();
+    QVERIFY(journal.startsWith(snapshot));
+    QCOMPARE(journal.count('\n'), 4);
+
+    // Replaying it gives the journaled layout back
+    LayoutSaver::setAutoSaveJournal(QString());
+    dock1->show();
+    dock2->setFloating(true);
+    LayoutSaver saver;
+    QVERIFY(saver.restoreFromFile(filename));
+    QVERIFY(!dock1->isOpen());
+    QVERIFY(!dock2->isFloating());
+    QCOMPARE(m->multiSplitterLayout()->visibleCount(), 1);
+
+    // A record cut short by a crash is ignored
+    QVERIFY(saver.restoreLayout(journal.left(journal.size() - 5)));
+    QVERIFY(dock1->isOpen());
+    QCOMPARE(m->multiSplitterLayout()->visibleCount(), 2);
+
+    QFile::remove(filename);
+}
+
+void TestDocks::tst_renderThumbnail()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    dock2->addDockWidgetAsTab(dock3);
+    auto dock4 = createDockWidget("dock4", new QPushButton("four")); // Floating
+
+    LayoutSaver saver;
+    const QByteArray json = saver.serializeLayout();
+    const QByteArray binary = saver.serializeLayout(LayoutSaver::Format::CompressedBinary);
+    const QSize size(200, 120);
+
+    const QImage thumbnail = LayoutSaver::renderThumbnail(json, size);
+    QCOMPARE(thumbnail.size(), size);
+    QImage empty(size, thumbnail.format());
+    empty.fill(Qt::transparent);
+    QVERIFY(thumbnail != empty);
+    QCOMPARE(LayoutSaver::renderThumbnail(json, size), thumbnail); // From the cache
+    QCOMPARE(LayoutSaver::renderThumbnail(json, QSize(100, 60)).size(), QSize(100, 60));
+
+    // Binary layouts give the same result
+    QCOMPARE(LayoutSaver::renderThumbnail(binary, size), thumbnail);
+
+    // Works off the GUI thread, even as dock widgets are deleted
+    struct ThumbnailThread : public QThread
+    {
+        void run() override { image = LayoutSaver::renderThumbnail(data, QSize(300, 300)); }
+        QByteArray data;
+        QImage image;
+    };
+
+    ThumbnailThread thread;
+    thread.data = binary;
+    thread.start();
+    delete dock4->window();
+    QVERIFY(thread.wait());
+    QCOMPARE(thread.image.size(), QSize(300, 300));
+
+    SetExpectedWarning sew("Failed to parse layout");
+    QVERIFY(LayoutSaver::renderThumbnail("garbage", size).isNull());
+}
+
+void TestDocks::tst_restoredDockWidgets()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    QVERIFY(saver.restoredDockWidgets().isEmpty());
+
+    // Only the ones in the layout, and each once
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    QVERIFY(saver.restoreLayout(saved));
+    DockWidgetBase::List restored = saver.restoredDockWidgets();
+    QCOMPARE(restored.size(), 2);
+    QVERIFY(restored.contains(dock1));
+    QVERIFY(restored.contains(dock2));
+
+    // Shared by all savers, as it's about the last restore
+    QCOMPARE(LayoutSaver().restoredDockWidgets(), restored);
+
+    // Deleted ones aren't returned
+    delete dock2;
+    QCOMPARE(saver.restoredDockWidgets(), DockWidgetBase::List({ dock1 }));
+
+    // Each restore starts over
+    QVERIFY(saver.restoreLayout(QByteArray()));
+    QVERIFY(saver.restoredDockWidgets().isEmpty());
+    delete dock3;
+}
+
+void TestDocks::tst_fastShutdown()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_FastShutdown);
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    QPointer<FloatingWindow> fw = dock3->floatingWindow();
+    QVERIFY(fw);
+
+    DockRegistry *registry = DockRegistry::self();
+    registry->beginShutdown();
+    QVERIFY(registry->isShuttingDown());
+    QVERIFY(m->multiSplitterLayout()->rootItem()->isTearingDown());
+
+    QSignalSpy spy(registry, &DockRegistry::layoutChanged);
+    Config::self().resetPerformanceCounters();
+    QPointer<Frame> frame1 = dock1->frame();
+    delete dock1;
+    QVERIFY(frame1); // Not scheduled for deletion, it goes with the main window
+    delete dock2;
+    m.reset();
+    QCOMPARE(Config::self().performanceCounters().relayouts, 0u);
+
+    delete fw;
+    QCOMPARE(spy.count(), 0);
+}
+
+void TestDocks::tst_backgroundTabsNotResized()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    dock2->addDockWidgetAsTab(dock3);
+
+    dock3->setAsCurrentTab();
+    QVERIFY(!dock2->isVisible());
+
+    struct ResizeCounter : public QObject
+    {
+        bool eventFilter(QObject *, QEvent *ev) override
+        {
+            if (ev->type() == QEvent::Resize)
+                count++;
+            return false;
+        }
+
+        int count = 0;
+    } counter;
+
+    dock2->installEventFilter(&counter);
+    Layouting::Separator *separator = m->multiSplitterLayout()->separators().constFirst();
+    separator->parentContainer()->requestSeparatorMove(separator, 50);
+    separator->parentContainer()->requestSeparatorMove(separator, -100);
+    QCOMPARE(counter.count, 0);
+
+    // Catches up once it's the current tab
+    dock2->setAsCurrentTab();
+    QTRY_COMPARE(dock2->size(), dock3->size());
+    QVERIFY(counter.count > 0);
+    dock2->removeEventFilter(&counter);
+}
+
+void TestDocks::tst_resizeHandlerCursor()
+{
+    EnsureTopLevelsDeleted e;
+    if (KDDockWidgets::usesNativeDraggingAndResizing())
+        QSKIP("The window manager resizes the floating windows");
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    QPointer<FloatingWindow> fw = dock1->floatingWindow();
+    QVERIFY(fw);
+
+    auto hover = [&fw] (QPoint localPos) {
+        QMouseEvent ev(QEvent::MouseMove, localPos, fw->mapToGlobal(localPos), Qt::NoButton, Qt::NoButton, Qt::NoModifier);
+        QCoreApplication::sendEvent(fw, &ev);
+    };
+
+    const QPoint leftEdge(1, fw->height() / 2);
+    hover(leftEdge);
+    QCOMPARE(fw->cursor().shape(), Qt::SizeHorCursor);
+
+    // Moving within the same zone doesn't touch the cursors
+    fw->setCursor(Qt::WaitCursor);
+    hover(leftEdge + QPoint(1, 10));
+    QCOMPARE(fw->cursor().shape(), Qt::WaitCursor);
+
+    hover(fw->rect().center());
+    QCOMPARE(fw->cursor().shape(), Qt::ArrowCursor);
+    hover(QPoint(fw->width() - 2, fw->height() - 2));
+    QCOMPARE(fw->cursor().shape(), Qt::SizeFDiagCursor);
+
+    delete fw;
+}
+
+void TestDocks::tst_coalescedScreenChangeResize()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    MultiSplitter *multiSplitter = layout->multiSplitter();
+    const QSize originalSize = layout->size();
+
+    // As if the window moved to another screen, it's then resized a few times
+    QEvent ev(QEvent::ScreenChangeInternal);
+    qApp->sendEvent(multiSplitter, &ev);
+    QVERIFY(multiSplitter->isResizeDeferred());
+
+    m->resize(m->size() + QSize(100, 100));
+    m->resize(m->size() + QSize(20, 20));
+    QCOMPARE(layout->size(), originalSize);
+
+    // Relaid out once, with the final size
+    QTRY_VERIFY(!multiSplitter->isResizeDeferred());
+    QTRY_COMPARE(layout->size(), multiSplitter->size());
+    QVERIFY(layout->size() != originalSize);
+    QVERIFY(layout->checkSanity());
+}
+
+void TestDocks::tst_interactionDriver()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    Layouting::Separator *separator = m->multiSplitterLayout()->separators().constFirst();
+    const int originalPos = separator->position();
+    InteractionDriver driver(/*eventsPerSecond=*/ 500, /*pixelsPerEvent=*/ 4);
+
+    // A press, 10 moves there and 10 back, and a release
+    InteractionStats stats = driver.sweepSeparator(separator, 40);
+    QCOMPARE(stats.count(), 22);
+    QCOMPARE(separator->position(), originalPos);
+    QVERIFY(stats.percentileUsecs(50) <= stats.percentileUsecs(95));
+    QVERIFY(stats.percentileUsecs(95) <= stats.maxUsecs());
+
+    // The same interaction sends the same events
+    QCOMPARE(driver.sweepSeparator(separator, 40).count(), stats.count());
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+
+    if (KDDockWidgets::usesNativeDraggingAndResizing())
+        QSKIP("The window manager resizes the floating windows");
+
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    QPointer<FloatingWindow> fw = dock3->floatingWindow();
+    QVERIFY(fw);
+    const QSize originalSize = fw->size();
+    stats = driver.resizeFloatingWindow(fw, QPoint(40, 20));
+    QCOMPARE(stats.count(), 12);
+    QCOMPARE(fw->size(), originalSize + QSize(40, 20));
+
+    delete fw;
+}
+
+void TestDocks::tst_fixedOnParentResize()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"), DockWidgetBase::Option_FixedOnParentResize);
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnRight);
+    Frame *frame1 = dock1->frame();
+    Frame *frame2 = dock2->frame();
+    QVERIFY(frame1->layoutItem()->isFixedOnParentResize());
+    QVERIFY(!frame2->layoutItem()->isFixedOnParentResize());
+
+    // The fixed panel keeps its width, the other two share the change
+    const int width1 = frame1->width();
+    const int width2 = frame2->width();
+    m->resize(m->size() + QSize(200, 0));
+    Testing::waitForResize(m.get());
+    QCOMPARE(frame1->width(), width1);
+    QVERIFY(frame2->width() > width2);
+
+    // Changing the options updates the frame, one tab having it is enough
+    dock1->setOptions(DockWidgetBase::Option_None);
+    QVERIFY(!frame1->layoutItem()->isFixedOnParentResize());
+    dock2->setOptions(DockWidgetBase::Option_FixedOnParentResize);
+    auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+    dock2->addDockWidgetAsTab(dock4);
+    QVERIFY(frame2->layoutItem()->isFixedOnParentResize());
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+}
+
+void TestDocks::tst_titleBarVisibilityBatch()
+{
+    EnsureTopLevelsDeleted e;
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"), {}, /*show=*/ false);
+    QPointer<FloatingWindow> fw = dock1->floatingWindow();
+    Frame *frame1 = dock1->frame();
+
+    // A single frame uses the floating window's title bar
+    QVERIFY(fw->titleBar()->isVisible());
+    QVERIFY(!frame1->titleBar()->isVisible());
+
+    {
+        TitleBarVisibilityBatch batch;
+        dock1->addDockWidgetToContainingWindow(dock2, Location_OnRight);
+        QVERIFY(!frame1->titleBar()->isVisible());
+    }
+
+    // Nested frames each show their own, once the batch ends
+    QVERIFY(frame1->titleBar()->isVisible());
+    QVERIFY(dock2->frame()->titleBar()->isVisible());
+    QVERIFY(fw->titleBar()->isVisible());
+
+    delete fw;
+}
+
+void TestDocks::tst_showDockWidgets()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(1000, 800), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+    auto dock5 = createDockWidget("dock5", new QPushButton("five"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnBottom, dock2);
+    dock3->addDockWidgetAsTab(dock4);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    QCOMPARE(layout->visibleCount(), 3);
+
+    dock2->close();
+    dock3->close();
+    dock4->close();
+    dock5->close();
+    QCOMPARE(layout->visibleCount(), 1);
+    QCOMPARE(layout->placeholderCount(), 2);
+
+    // The docked ones go back to their placeholders in one go, the other one floats again
+    DockWidgetBase::showDockWidgets({ dock2, dock3, dock4, dock5 });
+    QCOMPARE(layout->visibleCount(), 3);
+    QCOMPARE(layout->placeholderCount(), 0);
+    QCOMPARE(dock2->window(), m.get());
+    QCOMPARE(dock3->window(), m.get());
+    QCOMPARE(dock3->frame(), dock4->frame());
+    QVERIFY(dock2->isOpen());
+    QVERIFY(dock4->isOpen());
+    QVERIFY(dock5->isFloating());
+    QVERIFY(dock5->isVisible());
+    QVERIFY(dock2->frame()->y() < dock3->frame()->y());
+    QVERIFY(dock1->frame()->x() < dock2->frame()->x());
+    QVERIFY(layout->checkSanity());
+
+    delete dock5->window();
+}
+
+void TestDocks::tst_setDockWidgetsFloating()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(1000, 800), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnBottom, dock2);
+    dock3->addDockWidgetAsTab(dock4);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    const QPoint dock2Pos = dock2->frame()->mapToGlobal(QPoint(0, 0));
+
+    const DockWidgetBase::List docks = { dock2, dock3, dock4 };
+    DockWidgetBase::setDockWidgetsFloating(docks, true);
+    for (DockWidgetBase *dock : docks) {
+        QVERIFY(dock->isFloating());
+        QVERIFY(dock->window()->isVisible());
+    }
+    QVERIFY(dock3->window() != dock4->window());
+    QCOMPARE(dock2->window()->geometry().topLeft(), dock2Pos); // Where it was docked
+    QCOMPARE(layout->visibleCount(), 1);
+    QVERIFY(layout->checkSanity());
+
+    // And back to where they were
+    DockWidgetBase::setDockWidgetsFloating(docks, false);
+    for (DockWidgetBase *dock : docks) {
+        QVERIFY(!dock->isFloating());
+        QCOMPARE(dock->window(), m.get());
+    }
+    QCOMPARE(dock3->frame(), dock4->frame());
+    QCOMPARE(layout->visibleCount(), 3);
+    QCOMPARE(layout->placeholderCount(), 0);
+    QVERIFY(layout->checkSanity());
+}
+
+void TestDocks::tst_registryWatchesOnlyOwnWindows()
+{
+    EnsureTopLevelsDeleted e;
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    QWidget *fw = dock1->window();
+    QWidget other;
+    other.resize(100, 100);
+    other.show();
+    QSignalSpy spy(DockRegistry::self(), &DockRegistry::layoutChanged);
+
+    // Sent directly, so no other events are processed meanwhile. An application-wide event filter
+    // would see them all.
+    const quint64 filteredBefore = Config::self().performanceCounters().eventsFiltered;
+    QResizeEvent resizeEvent(QSize(200, 200), other.size());
+    QCoreApplication::sendEvent(&other, &resizeEvent);
+    QMoveEvent moveEvent(QPoint(10, 10), other.pos());
+    QCoreApplication::sendEvent(&other, &moveEvent);
+    QEvent enterEvent(QEvent::Enter);
+    QCoreApplication::sendEvent(&other, &enterEvent);
+    QCOMPARE(Config::self().performanceCounters().eventsFiltered, filteredBefore);
+    QCOMPARE(spy.count(), 0);
+
+    fw->resize(fw->size() + QSize(10, 10));
+    QVERIFY(Config::self().performanceCounters().eventsFiltered > filteredBefore);
+    QVERIFY(spy.count() > 0);
+
+    delete fw;
+}
+
+void TestDocks::tst_emptiedFramesAreDeletedDeterministically()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(1000, 800), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnBottom, dock2);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+
+    const DockWidgetBase::List docks = { dock2, dock3 };
+    DockWidgetBase::setDockWidgetsFloating(docks, true);
+    QPointer<QWidget> fw2 = dock2->window();
+    QPointer<QWidget> fw3 = dock3->window();
+    QPointer<Frame> frame2 = dock2->frame();
+    QCOMPARE(DockRegistry::self()->nestedwindows().size(), 2);
+
+    // Gone as soon as the call returns, no event loop turn needed
+    DockWidgetBase::setDockWidgetsFloating(docks, false);
+    QVERIFY(!fw2);
+    QVERIFY(!fw3);
+    QVERIFY(!frame2);
+    QVERIFY(DockRegistry::self()->nestedwindows().isEmpty());
+    QCOMPARE(Frame::dbg_numFrames(), 3);
+    QCOMPARE(DockRegistry::self()->frames().size(), 3);
+
+    // Closing leaves the layout right away too, only the deletion waits for the event loop
+    QPointer<Frame> frame1 = dock1->frame();
+    dock1->close();
+    QVERIFY(frame1);
+    QVERIFY(!DockRegistry::self()->frames().contains(frame1));
+    QCOMPARE(layout->visibleCount(), 2);
+    QVERIFY(layout->checkSanity());
+    QVERIFY(Testing::waitForDeleted(frame1));
+
+    delete dock1;
+}
+
+void TestDocks::tst_skipUnchangedRestore()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    LayoutSaver saver(RestoreOption_SkipIfUnchanged);
+    const QByteArray saved = saver.serializeLayout(LayoutSaver::Format::Binary);
+    const QByteArray hash = saver.layoutHash();
+    QVERIFY(!hash.isEmpty());
+    QCOMPARE(saver.layoutHash(LayoutSaver::Format::CompressedBinary), hash);
+    QVERIFY(saver.layoutHash(LayoutSaver::Format::Json) != hash);
+
+    // Cheap to call often, the unchanged layouts aren't checked again
+    const quint64 checked = Layouting::Tracing::counters().itemsSanityChecked;
+    QCOMPARE(saver.layoutHash(), hash);
+    QCOMPARE(Layouting::Tracing::counters().itemsSanityChecked, checked);
+
+    // Identical, nothing to do
+    Config::self().resetPerformanceCounters();
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(saver.restoreLayout(LayoutSaver::Layout::compressed(saved)));
+    QCOMPARE(Config::self().performanceCounters().restores, 0u);
+
+    // The hash follows the layout changes
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock2, Location_OnRight);
+    QVERIFY(saver.layoutHash() != hash);
+    QVERIFY(saver.restoreLayout(saved));
+    QCOMPARE(Config::self().performanceCounters().restores, 1u);
+    QVERIFY(!dock2->isVisible());
+    QVERIFY(dock1->isVisible());
+
+    // Without the option it's always restored
+    LayoutSaver eagerSaver;
+    QVERIFY(eagerSaver.restoreLayout(eagerSaver.serializeLayout()));
+    QCOMPARE(Config::self().performanceCounters().restores, 2u);
+
+    delete dock1;
+    delete dock2;
+}
+
+void TestDocks::tst_normalizedLayoutFormat()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None, "normalizedMainWindow");
+    auto dock1 = createDockWidget("normalizedDock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("normalizedDock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    dock1->close(); // So there's a placeholder naming the main window too
+
+    // Each name is only written once, in the string table
+    LayoutSaver saver;
+    const QByteArray json = saver.serializeLayout(LayoutSaver::Format::Json);
+    QCOMPARE(json.count("\"normalizedDock1\""), 1);
+    QCOMPARE(json.count("\"normalizedMainWindow\""), 1);
+    const QVariantMap map = QJsonDocument::fromJson(json).toVariant().toMap();
+    QVERIFY(map.contains(QStringLiteral("strings")));
+    QCOMPARE(map.value(QStringLiteral("serializationVersion")).toInt(), KDDOCKWIDGETS_SERIALIZATION_VERSION);
+
+    const QByteArray binary = saver.serializeLayout(LayoutSaver::Format::Binary);
+
+    // Both read back into the same layout
+    LayoutSaver::Layout fromJson;
+    QVERIFY(fromJson.fromJson(json));
+    LayoutSaver::Layout fromBinary;
+    QVERIFY(fromBinary.fromBinary(binary));
+    QCOMPARE(fromJson.toVariantMap(), fromBinary.toVariantMap());
+    QVERIFY(fromJson.isValid());
+
+    QVERIFY(saver.restoreLayout(json));
+    QVERIFY(!dock1->isOpen());
+    QVERIFY(dock2->isOpen());
+    QVERIFY(saver.restoreLayout(binary));
+    QVERIFY(dock2->isOpen());
+
+    // Layouts saved before the string table still load
+    QVariantMap old = fromJson.toVariantMap();
+    old.insert(QStringLiteral("serializationVersion"), KDDOCKWIDGETS_MIN_SERIALIZATION_VERSION);
+    QVERIFY(saver.restoreLayout(QJsonDocument::fromVariant(old).toJson()));
+    QVERIFY(dock2->isOpen());
+    QVERIFY(!dock1->isOpen());
+
+    delete dock1;
+    delete dock2;
+}
+
+void TestDocks::tst_dockingStateSnapshot()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    dock1->addDockWidgetAsTab(dock2);
+    QVERIFY(dock3->isFloating());
+
+    // Published on the next event loop turn
+    const std::shared_ptr<const DockingState> before = Config::dockingState();
+    QTest::qWait(0);
+    const std::shared_ptr<const DockingState> state = Config::dockingState();
+    QVERIFY(state != before);
+    QCOMPARE(state->frames.size(), 2);
+
+    auto dockState = [state] (const QString &name) {
+        for (const DockingState::DockWidgetState &dockState : state->dockWidgets) {
+            if (dockState.uniqueName == name)
+                return dockState;
+        }
+        return DockingState::DockWidgetState();
+    };
+
+    const DockingState::DockWidgetState state1 = dockState(QStringLiteral("dock1"));
+    const DockingState::DockWidgetState state2 = dockState(QStringLiteral("dock2"));
+    const DockingState::DockWidgetState state3 = dockState(QStringLiteral("dock3"));
+    QVERIFY(state1.isOpen && state2.isOpen && state3.isOpen);
+    QCOMPARE(state1.frameIndex, state2.frameIndex);
+    QVERIFY(state1.frameIndex != state3.frameIndex);
+    QCOMPARE(state1.tabIndex, 0);
+    QCOMPARE(state2.tabIndex, 1);
+    QVERIFY(state3.isFloating);
+    QVERIFY(!state1.isFloating);
+    QCOMPARE(state1.geometry, QRect(dock1->frame()->mapToGlobal(QPoint(0, 0)), dock1->frame()->size()));
+    QCOMPARE(state->frames.at(state1.frameIndex).dockWidgets,
+             QStringList() << QStringLiteral("dock1") << QStringLiteral("dock2"));
+
+    // Snapshots held elsewhere aren't modified, and can be read from other threads
+    struct ReaderThread : public QThread
+    {
+        void run() override
+        {
+            for (int i = 0; i < 1000; ++i) {
+                const std::shared_ptr<const DockingState> state = Config::dockingState();
+                for (const DockingState::DockWidgetState &dockState : state->dockWidgets) {
+                    if (dockState.isOpen)
+                        openCount++;
+                }
+            }
+        }
+        int openCount = 0;
+    };
+
+    ReaderThread thread;
+    thread.start();
+    dock2->close();
+    QTest::qWait(0);
+    delete dock3->window();
+    QTest::qWait(0);
+    QVERIFY(thread.wait());
+    QVERIFY(thread.openCount > 0);
+
+    QVERIFY(dockState(QStringLiteral("dock2")).isOpen);
+    const std::shared_ptr<const DockingState> after = Config::dockingState();
+    QCOMPARE(after->frames.size(), 1);
+    for (const DockingState::DockWidgetState &dockState : after->dockWidgets) {
+        if (dockState.uniqueName == QLatin1String("dock2")) {
+            QVERIFY(!dockState.isOpen);
+            QCOMPARE(dockState.frameIndex, -1);
+        }
+    }
+
+    // Deleting the registry publishes an empty state, without waiting for the event loop
+    delete dock1;
+    delete dock2;
+    m.reset();
+    const std::shared_ptr<const DockingState> empty = Config::dockingState();
+    QVERIFY(empty->frames.isEmpty());
+    QVERIFY(empty->dockWidgets.isEmpty());
+    QVERIFY(empty->layoutGeneration > after->layoutGeneration);
+}
+
+void TestDocks::tst_moveTab()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    dock1->addDockWidgetAsTab(dock2);
+    dock1->addDockWidgetAsTab(dock3);
+    Frame *frame = dock1->frame();
+    frame->tabWidget()->setCurrentDockWidget(dock2);
+    QCOMPARE(dock3->tabIndex(), 2);
+
+    QSignalSpy countSpy(frame, &Frame::numDockWidgetsChanged);
+    QSignalSpy reorderSpy(frame, &Frame::dockWidgetsReordered);
+    QSignalSpy layoutSpy(DockRegistry::self(), &DockRegistry::layoutChanged);
+    QWidget *parentBefore = dock3->parentWidget();
+    const QRect geometryBefore = frame->geometry();
+
+    dock3->setTabIndex(0);
+    QCOMPARE(frame->dockWidgets(), QVector<DockWidgetBase*>({ dock3, dock1, dock2 }));
+    QCOMPARE(dock3->tabIndex(), 0);
+    QCOMPARE(dock2->tabIndex(), 2);
+    QCOMPARE(frame->currentDockWidget(), dock2);
+    QCOMPARE(dock3->parentWidget(), parentBefore);
+    QCOMPARE(frame->geometry(), geometryBefore);
+    QCOMPARE(countSpy.count(), 0);
+    QCOMPARE(reorderSpy.count(), 1);
+    QVERIFY(layoutSpy.count() > 0);
+
+    // Out of range goes to the end, and inserting what's already there moves it
+    dock3->setTabIndex(10);
+    QCOMPARE(frame->dockWidgets(), QVector<DockWidgetBase*>({ dock1, dock2, dock3 }));
+    frame->insertWidget(dock2, 0);
+    QCOMPARE(frame->dockWidgets(), QVector<DockWidgetBase*>({ dock2, dock1, dock3 }));
+    QCOMPARE(countSpy.count(), 0);
+
+    // Saved and restored in the new order
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    dock1->setTabIndex(0);
+    QVERIFY(saver.restoreLayout(saved));
+    QCOMPARE(dock2->frame()->dockWidgets(), QVector<DockWidgetBase*>({ dock2, dock1, dock3 }));
+}
+
+void TestDocks::tst_memoryUsage()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    const DockRegistry *registry = DockRegistry::self();
+    const MemoryUsage before = Config::self().memoryUsage();
+    QCOMPARE(before.frames.count, quint64(registry->frames().size()) + before.pooledFrames);
+    QCOMPARE(before.tabWidgets.count, before.frames.count);
+    QCOMPARE(before.actions.count, quint64(0)); // Created on demand, which measuring doesn't do
+    QVERIFY(before.items.count >= 3); // The root and the two frames
+    QVERIFY(before.separators.count >= 1);
+    QVERIFY(before.frames.bytes > sizeof(Frame));
+    QVERIFY(before.totalBytes() > 0);
+
+    // Floating goes to a floating window and leaves a placeholder behind
+    dock2->setFloating(true);
+    const MemoryUsage after = Config::self().memoryUsage();
+    QCOMPARE(after.floatingWindows.count, before.floatingWindows.count + 1);
+    QVERIFY(after.placeholders.count > before.placeholders.count);
+
+    // Each main window only reports its own, with the floating windows parented to it
+    auto m2 = createMainWindow(QSize(800, 500), MainWindowOption_None, "m2");
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m2->addDockWidget(dock3, Location_OnLeft);
+    dock3->toggleAction();
+    const MemoryUsage total = Config::self().memoryUsage();
+    QCOMPARE(total.actions.count, quint64(1));
+    const MemoryUsage usage2 = Config::self().memoryUsage(m2.get());
+    QCOMPARE(usage2.frames.count, quint64(1));
+    QCOMPARE(usage2.actions.count, quint64(1));
+    QCOMPARE(usage2.floatingWindows.count, quint64(0));
+    const MemoryUsage usage1 = Config::self().memoryUsage(m.get());
+    QCOMPARE(usage1.floatingWindows.count, quint64(dock2->window()->parentWidget() == m.get() ? 1 : 0));
+    QVERIFY(usage1.totalBytes() < total.totalBytes());
+    QVERIFY(usage2.totalBytes() < total.totalBytes());
+}
+
+void TestDocks::tst_asyncDockWidgetFactory()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    dock1->addDockWidgetAsTab(dock2);
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    delete dock2;
+
+    // Completed by the test, as the application would once its data is there
+    static QFutureInterface<DockWidgetContentFunc> s_loading;
+    s_loading = QFutureInterface<DockWidgetContentFunc>();
+    AsyncDockWidgetFactoryFunc func = [] (const QString &) {
+        s_loading.reportStarted();
+        return s_loading.future();
+    };
+    Config::self().setAsyncDockWidgetFactoryFunc(func);
+
+    // The placeholder is restored into its tab without waiting
+    QVERIFY(saver.restoreLayout(saved));
+    DockWidgetBase *placeholder = DockRegistry::self()->dockByName("dock2");
+    QVERIFY(placeholder);
+    QVERIFY(placeholder->isLoadingContent());
+    QCOMPARE(placeholder->frame(), dock1->frame());
+    QCOMPARE(placeholder->tabIndex(), 1);
+    QWidget *loadingWidget = placeholder->widget();
+    QVERIFY(loadingWidget);
+
+    DockWidgetContentFunc contentFunc = [] (DockWidgetBase *dw) -> QWidget* {
+        dw->setTitle("loaded");
+        return new QPushButton("two");
+    };
+    s_loading.reportResult(contentFunc);
+    s_loading.reportFinished();
+
+    QTRY_VERIFY(!placeholder->isLoadingContent());
+    QVERIFY(qobject_cast<QPushButton*>(placeholder->widget()));
+    QCOMPARE(placeholder->title(), QString("loaded"));
+    QCOMPARE(placeholder->frame(), dock1->frame());
+    QCOMPARE(placeholder->tabIndex(), 1);
+}
+
+void TestDocks::tst_processDockWidget()
+{
+    EnsureTopLevelsDeleted e;
+
+    // We're the child process too, see main(). Embedding needs a platform with foreign windows.
+    const QString platform = qApp->platformName();
+    const bool canEmbed = platform != QLatin1String("offscreen") && platform != QLatin1String("minimal")
+                          && !platform.startsWith(QLatin1String("wayland"));
+    QStringList arguments = { QStringLiteral("--process-panel-child") };
+    if (!canEmbed)
+        arguments << QStringLiteral("--no-announce");
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    auto dock2 = new ProcessDockWidget(QStringLiteral("process1"), QCoreApplication::applicationFilePath(), arguments);
+    QProcess *process = dock2->process();
+    auto message = dock2->widget()->findChild<QLabel*>();
+    QVERIFY(message);
+
+    // Started once shown
+    QCOMPARE(process->state(), QProcess::NotRunning);
+    m->addDockWidget(dock2, Location_OnRight);
+    QVERIFY(process->waitForStarted());
+    if (canEmbed) {
+        QTRY_VERIFY_WITH_TIMEOUT(dock2->isEmbedded(), 10000);
+        QVERIFY(!message->isVisible());
+    }
+
+    // Floating and docking it again moves the embedded window along
+    dock2->setFloating(true);
+    QCOMPARE(process->state(), QProcess::Running);
+    QCOMPARE(dock2->isEmbedded(), canEmbed);
+    dock2->setFloating(false);
+    QVERIFY(dock2->frame()->x() > dock1->frame()->x());
+    QCOMPARE(dock2->isEmbedded(), canEmbed);
+
+    // A crash leaves a message in its place, and the dock widget where it was
+    process->kill();
+    QVERIFY(process->waitForFinished());
+    QVERIFY(!dock2->isEmbedded());
+    QVERIFY(message->isVisible());
+    QVERIFY(message->text().contains(QLatin1String("crashed")));
+    QVERIFY(dock2->isOpen());
+    QVERIFY(dock2->frame()->x() > dock1->frame()->x());
+
+    dock2->restart();
+    QVERIFY(process->waitForStarted());
+    if (canEmbed)
+        QTRY_VERIFY_WITH_TIMEOUT(dock2->isEmbedded(), 10000);
+
+    // Restoring keeps the same process
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    const qint64 pid = process->processId();
+    dock2->close();
+    QVERIFY(!dock2->isOpen());
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(dock2->isOpen());
+    QVERIFY(dock2->frame()->x() > dock1->frame()->x());
+    QCOMPARE(process->state(), QProcess::Running);
+    QCOMPARE(process->processId(), pid);
+    QCOMPARE(dock2->isEmbedded(), canEmbed);
+
+    delete dock2; // Terminates it
+    delete dock1;
+}
+
+void TestDocks::tst_lockedLayout()
+{
+    EnsureTopLevelsDeleted e;
+    auto m1 = createMainWindow(QSize(800, 500), MainWindowOption_LockedLayout, "m1");
+    auto m2 = createMainWindow(QSize(800, 500), MainWindowOption_None, "m2");
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m1->addDockWidget(dock1, Location_OnLeft);
+    m2->addDockWidget(dock2, Location_OnLeft);
+
+    // Locked at construction, nothing was created for dragging
+    QVERIFY(m1->isLayoutLocked());
+    QVERIFY(!m1->dropArea()->dropIndicatorOverlay());
+    QVERIFY(!m2->isLayoutLocked());
+    QVERIFY(m2->dropArea()->dropIndicatorOverlay());
+
+    // Unlocked at runtime, for editing
+    m1->setLayoutLocked(false);
+    QVERIFY(m1->dropArea()->dropIndicatorOverlay());
+    m1->setLayoutLocked(true);
+    QVERIFY(!m1->dropArea()->dropIndicatorOverlay());
+    m1->setLayoutLocked(false);
+
+    // Globally, floating windows included
+    dock2->setFloating(true);
+    auto fw = qobject_cast<FloatingWindow*>(dock2->window());
+    QVERIFY(fw);
+    QVERIFY(fw->dropArea()->dropIndicatorOverlay());
+    const bool hasResizeHandler = fw->widgetResizeHandler() != nullptr;
+    Config::self().setLayoutLocked(true);
+    QVERIFY(m2->isLayoutLocked());
+    QVERIFY(!m2->dropArea()->dropIndicatorOverlay());
+    QVERIFY(!fw->dropArea()->dropIndicatorOverlay());
+    QVERIFY(!fw->widgetResizeHandler());
+
+    // Still laid out programmatically
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m2->addDockWidget(dock3, Location_OnRight);
+    QVERIFY(m2->multiSplitterLayout()->checkSanity());
+
+    Config::self().setLayoutLocked(false);
+    QVERIFY(!m2->isLayoutLocked());
+    QVERIFY(m2->dropArea()->dropIndicatorOverlay());
+    QVERIFY(fw->dropArea()->dropIndicatorOverlay());
+    QCOMPARE(fw->widgetResizeHandler() != nullptr, hasResizeHandler);
+
+    // Floating windows follow the main window they're parented to
+    m1->setLayoutLocked(true);
+    QCOMPARE(fw->dropArea()->dropIndicatorOverlay() == nullptr, fw->parentWidget() == m1.get());
+}
+
+void TestDocks::tst_penSeparatorDrag()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_TouchAndPenInput);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    Layouting::Separator *separator = m->multiSplitterLayout()->separators().constFirst();
+    QVERIFY(separator->testAttribute(Qt::WA_AcceptTouchEvents));
+    // The separator would jump to the pen otherwise, which is tested elsewhere
+    const QPoint start = separator->geometry().topLeft();
+    const int width1 = dock1->frame()->width();
+
+    // hostPos is in the drop area's coordinates, like the separator's geometry
+    auto sendPen = [separator] (QEvent::Type type, QPoint hostPos, Qt::MouseButtons buttons) {
+        const QPoint localPos = separator->mapFromParent(hostPos);
+        QTabletEvent ev(type, localPos, separator->mapToGlobal(localPos), QTabletEvent::Stylus,
+                        QTabletEvent::Pen, 0.5, 0, 0, 0, 0, 0, Qt::NoModifier, 1, Qt::LeftButton, buttons);
+        QApplication::sendEvent(separator, &ev);
+        return ev.isAccepted();
+    };
+
+    QVERIFY(sendPen(QEvent::TabletPress, start, Qt::LeftButton));
+    for (int i = 1; i <= 3; ++i)
+        QVERIFY(sendPen(QEvent::TabletMove, start + QPoint(10 * i, 0), Qt::LeftButton));
+
+    // The separator follows the pen, the layout only catches up once
+    QCOMPARE(separator->x(), start.x() + 30);
+    QCOMPARE(dock1->frame()->width(), width1);
+
+    QVERIFY(sendPen(QEvent::TabletRelease, start + QPoint(30, 0), Qt::NoButton));
+    QCOMPARE(dock1->frame()->width(), width1 + 30);
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+}
+
+void TestDocks::tst_deferOffscreenFloatingWindows()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    dock2->window()->move(QPoint(50000, 50000)); // On a screen that isn't connected
+
+    LayoutSaver saver(RestoreOption_DeferOffscreenFloatingWindows);
+    const QByteArray saved = saver.serializeLayout();
+
+    QVERIFY(saver.restoreLayout(saved));
+    QCOMPARE(LayoutSaver::numDeferredFloatingWindows(), 1);
+    QVERIFY(!dock2->isVisible());
+    QVERIFY(dock1->isVisible());
+
+    // Saving keeps the deferred window
+    const QByteArray savedAgain = saver.serializeLayout();
+    LayoutSaver eagerSaver;
+    QVERIFY(eagerSaver.restoreLayout(savedAgain));
+    QCOMPARE(LayoutSaver::numDeferredFloatingWindows(), 0);
+    QVERIFY(dock2->isFloating());
+    QVERIFY(dock2->isVisible());
+
+    // Showing a dock widget restores its window, within reach
+    QVERIFY(saver.restoreLayout(saved));
+    QCOMPARE(LayoutSaver::numDeferredFloatingWindows(), 1);
+    dock2->show();
+    QCOMPARE(LayoutSaver::numDeferredFloatingWindows(), 0);
+    QVERIFY(dock2->isFloating());
+    QVERIFY(dock2->isVisible());
+    QVERIFY(qApp->primaryScreen()->geometry().intersects(dock2->window()->geometry()));
+
+    delete dock2->window();
+}
+
+void TestDocks::tst_deferOffscreenFloatingWindowsPerAffinity()
+{
+    EnsureTopLevelsDeleted e;
+    auto m1 = createMainWindow(QSize(800, 500), MainWindowOption_None, "m1");
+    m1->setAffinityName("a1");
+    auto m2 = createMainWindow(QSize(800, 500), MainWindowOption_None, "m2");
+    m2->setAffinityName("a2");
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"), {}, /*show=*/ false);
+    dock1->setAffinityName("a1");
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"), {}, /*show=*/ false);
+    dock2->setAffinityName("a2");
+    dock1->show();
+    dock2->show();
+    dock1->window()->move(QPoint(50000, 50000)); // On a screen that isn't connected
+    dock2->window()->move(QPoint(50000, 50000));
+
+    LayoutSaver saver(RestoreOption_DeferOffscreenFloatingWindows);
+    const QByteArray saved = saver.serializeLayout();
+
+    LayoutSaver saver1(RestoreOption_DeferOffscreenFloatingWindows);
+    saver1.setAffinityNames({ "a1" });
+    LayoutSaver saver2(RestoreOption_DeferOffscreenFloatingWindows);
+    saver2.setAffinityNames({ "a2" });
+    QVERIFY(saver1.restoreLayout(saved));
+    QCOMPARE(LayoutSaver::numDeferredFloatingWindows(), 1);
+    QVERIFY(!dock1->isVisible());
+    QVERIFY(dock2->isVisible());
+
+    // Restoring the other affinity keeps the first one's deferred window
+    QVERIFY(saver2.restoreLayout(saved));
+    QCOMPARE(LayoutSaver::numDeferredFloatingWindows(), 2);
+    QVERIFY(!dock2->isVisible());
+
+    // And restoring the first one again replaces only its own
+    QVERIFY(saver1.restoreLayout(saved));
+    QCOMPARE(LayoutSaver::numDeferredFloatingWindows(), 2);
+
+    dock1->show();
+    QCOMPARE(LayoutSaver::numDeferredFloatingWindows(), 1);
+    QVERIFY(dock1->isFloating());
+    dock2->show();
+    QCOMPARE(LayoutSaver::numDeferredFloatingWindows(), 0);
+    QVERIFY(dock2->isFloating());
+
+    delete dock1->window();
+    delete dock2->window();
+}
+
+void TestDocks::tst_progressiveRestore()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock4, Location_OnRight);
+    dock4->close(); // Keeps its placeholder in the main window
+    dock3->window()->move(QPoint(50000, 50000)); // Off the primary screen
+
+    int numFinished = 0;
+    LayoutSaver saver(RestoreOption_Progressive);
+    saver.setRestoreFinishedCallback([&numFinished] { numFinished++; });
+    const QByteArray saved = saver.serializeLayout();
+
+    // The main window and the floating window on the primary screen are restored right away
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(LayoutSaver::progressiveRestoreInProgress());
+    QCOMPARE(numFinished, 0);
+    QVERIFY(dock1->isVisible());
+    QVERIFY(dock2->isFloating());
+    QVERIFY(dock2->isVisible());
+    QVERIFY(!dock3->isVisible());
+
+    // The rest follows from the event loop
+    QTRY_VERIFY(!LayoutSaver::progressiveRestoreInProgress());
+    QCOMPARE(numFinished, 1);
+    QVERIFY(dock3->isFloating());
+    QVERIFY(dock3->isVisible());
+    QVERIFY(!dock4->isVisible());
+    dock4->show();
+    QCOMPARE(dock4->window(), m.get());
+    dock4->close();
+
+    // Saving finishes what's pending first, so it's not lost
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(LayoutSaver::progressiveRestoreInProgress());
+    const QByteArray savedAgain = saver.serializeLayout();
+    QVERIFY(!LayoutSaver::progressiveRestoreInProgress());
+    QCOMPARE(numFinished, 2);
+    QVERIFY(dock3->isVisible());
+
+    // A restore replaces a pending one, which then doesn't finish
+    QVERIFY(saver.restoreLayout(savedAgain));
+    LayoutSaver eagerSaver;
+    QVERIFY(eagerSaver.restoreLayout(saved));
+    QVERIFY(!LayoutSaver::progressiveRestoreInProgress());
+    QTest::qWait(50);
+    QCOMPARE(numFinished, 2);
+    QVERIFY(dock3->isVisible());
+
+    delete dock2->window();
+    delete dock3->window();
+}
+
+void TestDocks::tst_screenVariants()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    const QString key = LayoutSaver::screenConfigurationKey();
+    QVERIFY(!key.isEmpty());
+    QCOMPARE(LayoutSaver::screenConfigurationKey(), key);
+
+    LayoutSaver saver;
+    QVERIFY(!saver.restoreScreenVariant());
+    QVERIFY(saver.saveScreenVariant());
+
+    dock1->setFloating(true);
+    QVERIFY(saver.restoreScreenVariant());
+    QVERIFY(!dock1->isFloating());
+    QCOMPARE(dock1->window(), m.get());
+
+    // Nothing changes while following, unless a screen does
+    LayoutSaver::setFollowScreenChanges(true);
+    dock1->setFloating(true);
+    QTest::qWait(50);
+    QVERIFY(dock1->isFloating());
+
+    // A new configuration starts with the layout the previous one had
+    LayoutSaver::dbg_setScreenConfigurationKey("config2");
+    QTest::qWait(50);
+    QVERIFY(dock1->isFloating());
+    dock1->setFloating(false);
+    QCOMPARE(dock1->window(), m.get());
+
+    // Switching back restores the layout each one was left with
+    LayoutSaver::dbg_setScreenConfigurationKey(QString());
+    QTRY_VERIFY(dock1->isFloating());
+    LayoutSaver::dbg_setScreenConfigurationKey("config2");
+    QTRY_VERIFY(!dock1->isFloating());
+    QCOMPARE(dock1->window(), m.get());
+
+    LayoutSaver::setFollowScreenChanges(false);
+    LayoutSaver::dbg_setScreenConfigurationKey(QString());
+    LayoutSaver::clearScreenVariants();
+    QVERIFY(!saver.restoreScreenVariant());
+
+    delete dock1;
+}
+
+void TestDocks::tst_restoreShowsOnce()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    const QRect savedGeometry = m->geometry();
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+
+    struct ShowRecorder : public QObject
+    {
+        bool eventFilter(QObject *watched, QEvent *ev) override
+        {
+            if (ev->type() == QEvent::Show) {
+                auto w = static_cast<QWidget*>(watched);
+                shows.push_back(w->geometry());
+            }
+            return false;
+        }
+
+        QVector<QRect> shows;
+    } recorder;
+
+    m->hide();
+    m->resize(400, 300);
+    dock2->close();
+    m->installEventFilter(&recorder);
+
+    QVERIFY(saver.restoreLayout(saved));
+    m->removeEventFilter(&recorder);
+
+    // Shown once, already at its final geometry
+    QCOMPARE(recorder.shows.size(), 1);
+    QCOMPARE(recorder.shows.constFirst(), savedGeometry);
+    QVERIFY(m->updatesEnabled());
+
+    // Windows which had their updates disabled already keep them disabled
+    dock2->close();
+    m->setUpdatesEnabled(false);
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(dock2->isVisible());
+    QVERIFY(!m->updatesEnabled());
+    m->setUpdatesEnabled(true);
+}
+
+void TestDocks::tst_serializeUnchangedWindows()
+{
+    // Tests that windows whose serialization is reused still save their latest changes
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    QCOMPARE(saver.serializeLayout(), saved);
+
+    auto parse = [&saver] {
+        LayoutSaver::Layout layout;
+        layout.fromJson(saver.serializeLayout());
+        return layout;
+    };
+
+    QWidget *floatingWindow = dock2->window();
+    floatingWindow->move(floatingWindow->pos() + QPoint(20, 20));
+    LayoutSaver::Layout layout = parse();
+    QCOMPARE(layout.floatingWindows.size(), 1);
+    QCOMPARE(layout.floatingWindows.constFirst().geometry, floatingWindow->geometry());
+
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"), {}, /*show=*/ false);
+    dock1->addDockWidgetAsTab(dock3);
+    layout = parse();
+    QCOMPARE(layout.mainWindows.size(), 1);
+    QCOMPARE(layout.mainWindows.constFirst().multiSplitterLayout.frames.size(), 1);
+    QCOMPARE(layout.mainWindows.constFirst().multiSplitterLayout.frames.constBegin()->dockWidgets.size(), 2);
+}
+
+void TestDocks::tst_itemIsInMainWindowFollowsDocking()
+{
+    // The window kind is cached by the host, check it's still right when the item changes host
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    QVERIFY(DockRegistry::self()->itemIsInMainWindow(dock1->frame()->layoutItem()));
+
+    auto fw = createFloatingWindow();
+    auto dock2 = fw->frames().constFirst()->dockWidgets().constFirst();
+    Layouting::Item *item = dock2->frame()->layoutItem();
+    QVERIFY(!DockRegistry::self()->itemIsInMainWindow(item));
+
+    m->dropArea()->drop(fw, Location_OnRight, nullptr);
+    QVERIFY(DockRegistry::self()->itemIsInMainWindow(dock2->frame()->layoutItem()));
+    QVERIFY(Testing::waitForDeleted(fw));
+}
+
+void TestDocks::tst_closedDockWidgetsTracked()
+{
+    EnsureTopLevelsDeleted e;
+    auto isClosed = [] (DockWidgetBase *dw) {
+        return DockRegistry::self()->closedDockwidgets().contains(dw);
+    };
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"), {}, /*show=*/ false);
+    QVERIFY(isClosed(dock1));
+
+    m->addDockWidget(dock1, Location_OnLeft);
+    QVERIFY(!isClosed(dock1));
+
+    dock1->close();
+    QVERIFY(!dock1->parent());
+    QVERIFY(isClosed(dock1));
+
+    // Floating
+    dock1->show();
+    QVERIFY(!isClosed(dock1));
+
+    dock1->close();
+    QVERIFY(isClosed(dock1));
+
+    delete dock1;
+    QVERIFY(DockRegistry::self()->closedDockwidgets().isEmpty());
+}
+
+void TestDocks::tst_topLevelsCache()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto fw = createFloatingWindow();
+    DockRegistry *registry = DockRegistry::self();
+    QCOMPARE(registry->topLevels(), QVector<QWidget*>({ fw, m.get() }));
+    QCOMPARE(registry->topLevels(/*excludeFloatingDocks=*/ true), QVector<QWidget*>({ m.get() }));
+
+    // Cached until a window is shown or hidden
+    const int generation = registry->topLevelsGeneration();
+    QCOMPARE(registry->topLevels().constData(), registry->topLevels().constData());
+    fw->hide();
+    QVERIFY(registry->topLevelsGeneration() != generation);
+    QCOMPARE(registry->topLevels(), QVector<QWidget*>({ m.get() }));
+
+    fw->show();
+    QCOMPARE(registry->topLevels(), QVector<QWidget*>({ fw, m.get() }));
+    delete fw;
+    QCOMPARE(registry->topLevels(), QVector<QWidget*>({ m.get() }));
+}
+
+void TestDocks::tst_performanceCounters()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    Config::self().resetPerformanceCounters();
+    QCOMPARE(Config::self().performanceCounters().relayouts, 0u);
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    PerformanceCounters counters = Config::self().performanceCounters();
+    QCOMPARE(counters.framesCreated, 1u);
+    QVERIFY(counters.relayouts > 0);
+    QVERIFY(counters.itemGeometryChanges > 0);
+    QVERIFY(counters.widgetGeometryChanges > 0);
+    QCOMPARE(counters.restores, 0u);
+    QVERIFY(m->multiSplitterLayout()->rootItem()->numRelayouts() > 0);
+
+    LayoutSaver saver;
+    QVERIFY(saver.restoreLayout(saver.serializeLayout()));
+    counters = Config::self().performanceCounters();
+    QCOMPARE(counters.restores, 1u);
+    QVERIFY(counters.totalRestoreUsecs >= counters.lastRestoreUsecs);
+
+    Config::self().resetPerformanceCounters();
+    counters = Config::self().performanceCounters();
+    QCOMPARE(counters.framesCreated, 0u);
+    QCOMPARE(counters.restores, 0u);
+    delete dock1;
+}
+
+void TestDocks::tst_affinityPartitions()
+{
+    EnsureTopLevelsDeleted e;
+    DockRegistry *registry = DockRegistry::self();
+    auto m1 = createMainWindow(QSize(800, 500), MainWindowOption_None, "m1");
+    m1->setAffinityName("a1");
+    auto m2 = createMainWindow(QSize(800, 500), MainWindowOption_None, "m2");
+    m2->setAffinityName("a2");
+    QCOMPARE(registry->mainWindowsWithAffinity("a1"), MainWindowBase::List({ m1.get() }));
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"), {}, /*show=*/ false);
+    QCOMPARE(registry->dockWidgetsWithAffinity(QString()), DockWidgetBase::List({ dock1 }));
+    dock1->setAffinityName("a1");
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"), {}, /*show=*/ false);
+    dock2->setAffinityName("a2");
+    QVERIFY(registry->dockWidgetsWithAffinity(QString()).isEmpty());
+    QCOMPARE(registry->dockWidgetsWithAffinity("a1"), DockWidgetBase::List({ dock1 }));
+
+    m1->addDockWidget(dock1, Location_OnLeft);
+    m2->addDockWidget(dock2, Location_OnLeft);
+
+    // Only the a1 partition is cleared
+    registry->clear({ "a1" });
+    QVERIFY(!dock1->isVisible());
+    QVERIFY(dock2->isVisible());
+
+    LayoutSaver saver;
+    saver.setAffinityNames({ "a2" });
+    LayoutSaver::Layout layout;
+    QVERIFY(layout.fromJson(saver.serializeLayout()));
+    QCOMPARE(layout.allDockWidgets.size(), 1);
+    QCOMPARE(layout.allDockWidgets.constFirst()->uniqueName, QStringLiteral("dock2"));
+
+    delete dock1;
+    QVERIFY(registry->dockWidgetsWithAffinity("a1").isEmpty());
+    delete dock2;
+}
+
+void TestDocks::tst_searchDockWidgets()
+{
+    EnsureTopLevelsDeleted e;
+    DockRegistry *registry = DockRegistry::self();
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("console", new QPushButton("one"));
+    dock1->setTitle("Output");
+    auto dock2 = createDockWidget("project-tree", new QPushButton("two"));
+    dock2->setTitle("Project");
+    auto dock3 = createDockWidget("outline", new QPushButton("three"), {}, /*show=*/ false);
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    // By name or by title, ignoring case, closed ones included, in registration order
+    QCOMPARE(registry->searchDockWidgets("CONSOLE"), DockWidgetBase::List({ dock1 }));
+    QCOMPARE(registry->searchDockWidgets("out"), DockWidgetBase::List({ dock1, dock3 }));
+    QCOMPARE(registry->searchDockWidgets("ou"), DockWidgetBase::List({ dock1, dock3 }));
+    QCOMPARE(registry->searchDockWidgets("o", 2), DockWidgetBase::List({ dock1, dock2 }));
+    QCOMPARE(registry->searchDockWidgets(QString()).size(), 3);
+    QVERIFY(registry->searchDockWidgets("tree-").isEmpty());
+    QVERIFY(registry->searchDockWidgets("ject-tr").contains(dock2));
+
+    // Doesn't match across the name and the title
+    QVERIFY(registry->searchDockWidgets("consoleoutput").isEmpty());
+
+    // Title changes are indexed, without changing the order
+    dock1->setTitle("Terminal");
+    QVERIFY(registry->searchDockWidgets("output").isEmpty());
+    QCOMPARE(registry->searchDockWidgets("TERM"), DockWidgetBase::List({ dock1 }));
+    dock3->setTitle("Terminal outline");
+    QCOMPARE(registry->searchDockWidgets("terminal"), DockWidgetBase::List({ dock1, dock3 }));
+
+    delete dock1;
+    QCOMPARE(registry->searchDockWidgets("terminal"), DockWidgetBase::List({ dock3 }));
+    delete dock3;
+    QVERIFY(registry->searchDockWidgets("terminal").isEmpty());
+    delete dock2;
+}
+
+void TestDocks::tst_layoutStore()
+{
+    EnsureTopLevelsDeleted e;
+    const QString filename = QStringLiteral("layouts.kdds");
+    QFile::remove(filename);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    m->setAffinityName("a1");
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    dock1->setAffinityName("a1");
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    {
+        LayoutStore store(filename);
+        QVERIFY(store.open());
+        QVERIFY(store.layoutNames().isEmpty());
+
+        LayoutSaver saver;
+        QVERIFY(saver.saveToStore(store, "docked"));
+        dock1->setFloating(true);
+        QVERIFY(saver.saveToStore(store, "floating", LayoutSaver::Format::Json));
+        QVERIFY(store.commit());
+    }
+
+    LayoutStore store(filename);
+    QVERIFY(store.open());
+    QCOMPARE(store.layoutNames(), QStringList({ "docked", "floating" }));
+    QCOMPARE(store.affinityNames("docked"), QStringList({ "a1" }));
+
+    LayoutSaver saver;
+    QVERIFY(saver.restoreFromStore(store, "docked"));
+    QVERIFY(!dock1->isFloating());
+    QVERIFY(saver.restoreFromStore(store, "floating"));
+    QVERIFY(dock1->isFloating());
+
+    // Removing keeps the others readable
+    store.remove("docked");
+    QVERIFY(store.commit());
+    QCOMPARE(store.layoutNames(), QStringList({ "floating" }));
+    QVERIFY(saver.restoreFromStore(store, "floating"));
+
+    {
+        SetExpectedWarning sew("No layout called");
+        QVERIFY(!saver.restoreFromStore(store, "docked"));
+    }
+
+    QFile::remove(filename);
+}
+
 void TestDocks::tst_dockWindowWithTwoSideBySideFramesIntoLeft()
 {
     EnsureTopLevelsDeleted e;
@@ -1144,6 +3659,69 @@ void TestDocks::tst_restoreSimplest()
    QVERIFY(layout->checkSanity());
 }
 
+void TestDocks::tst_restoreBinary()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    const QRect geo1 = dock1->frameGeometry();
+    const QRect geo2 = dock2->frameGeometry();
+
+    LayoutSaver saver;
+    const QByteArray data = saver.serializeLayout(LayoutSaver::Format::Binary);
+    QVERIFY(!data.isEmpty());
+    QVERIFY(!data.startsWith('{'));
+
+    dock2->close();
+    QVERIFY(saver.restoreLayout(data));
+    QVERIFY(layout->checkSanity());
+    QVERIFY(dock2->isVisible());
+    QCOMPARE(dock1->frameGeometry(), geo1);
+    QCOMPARE(dock2->frameGeometry(), geo2);
+
+    // Corrupt data is refused
+    SetExpectedWarning sew("Failed to parse binary data");
+    QVERIFY(!saver.restoreLayout(data.left(8)));
+}
+
+void TestDocks::tst_restoreCompressed()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    auto dock3 = createDockWidget("three", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnBottom);
+    const QRect geo2 = dock2->frameGeometry();
+
+    LayoutSaver saver;
+    const QByteArray data = saver.serializeLayout(LayoutSaver::Format::CompressedBinary);
+    QVERIFY(!data.isEmpty());
+    QVERIFY(data.size() < saver.serializeLayout(LayoutSaver::Format::Binary).size());
+
+    dock2->close();
+    QVERIFY(saver.restoreLayout(data));
+    QVERIFY(layout->checkSanity());
+    QVERIFY(dock2->isVisible());
+    QCOMPARE(dock2->frameGeometry(), geo2);
+
+    // JSON can be compressed too
+    const QByteArray json = saver.serializeLayout(LayoutSaver::Format::Json);
+    dock2->close();
+    QVERIFY(saver.restoreLayout(LayoutSaver::Layout::compressed(json)));
+    QVERIFY(dock2->isVisible());
+
+    SetExpectedWarning sew("Failed to uncompress data");
+    QVERIFY(!saver.restoreLayout(data.left(6)));
+}
+
 void TestDocks::tst_restoreSimple()
 {
     EnsureTopLevelsDeleted e;
@@ -1918,6 +4496,78 @@ void TestDocks::tst_notClosable()
     }
 }
 
+void TestDocks::tst_aggregatedOptions()
+{
+    EnsureTopLevelsDeleted e;
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    dock1->addDockWidgetAsTab(dock2);
+    Frame *frame = dock1->frame();
+    FloatingWindow *fw = dock1->floatingWindow();
+    QVERIFY(!frame->anyNonClosable());
+    QVERIFY(!fw->anyNonClosable());
+
+    dock2->setOptions(DockWidgetBase::Option_NotClosable);
+    QVERIFY(frame->anyNonClosable());
+    QVERIFY(fw->anyNonClosable());
+
+    // Follows the dock widget when it leaves the frame
+    dock2->setFloating(true);
+    QVERIFY(!frame->anyNonClosable());
+    QVERIFY(!fw->anyNonClosable());
+    QVERIFY(dock2->frame()->anyNonClosable());
+
+    // The frames come from the layout, the guest's children aren't visited
+    auto guest = new QWidget();
+    Config::self().frameworkWidgetFactory()->createFrame(guest);
+    auto dock3 = createDockWidget("dock3", guest, DockWidgetBase::Option_NotDockable);
+    FloatingWindow *fw3 = dock3->floatingWindow();
+    QCOMPARE(fw3->frames(), Frame::List({ dock3->frame() }));
+    QVERIFY(fw3->anyNonDockable());
+    QVERIFY(!fw->anyNonDockable());
+
+    delete fw;
+    delete dock2->window();
+    delete fw3;
+}
+
+void TestDocks::tst_sharedDockWidgetAndFrameLists()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    dock1->addDockWidgetAsTab(dock2);
+    m->addDockWidget(dock3, Location_OnRight);
+    Frame *frame1 = dock1->frame();
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+
+    // Unchanged lists are shared, not rebuilt
+    QCOMPARE(frame1->dockWidgets(), DockWidgetBase::List({ dock1, dock2 }));
+    QVERIFY(frame1->dockWidgets().isSharedWith(frame1->dockWidgets()));
+    QCOMPARE(layout->frames(), Frame::List({ frame1, dock3->frame() }));
+    QVERIFY(layout->items().isSharedWith(layout->items()));
+
+    // Reordering tabs
+    QTabBar *tabBar = static_cast<FrameWidget*>(frame1)->tabBar();
+    tabBar->moveTab(0, 1);
+    QCOMPARE(frame1->dockWidgets(), DockWidgetBase::List({ dock2, dock1 }));
+
+    // A placeholder is an item, but not a frame
+    dock3->close();
+    QCOMPARE(layout->frames(), Frame::List({ frame1 }));
+    QCOMPARE(layout->items().size(), 2);
+
+    dock3->show();
+    QCOMPARE(layout->frames(), Frame::List({ frame1, dock3->frame() }));
+
+    dock2->setFloating(true);
+    QCOMPARE(frame1->dockWidgets(), DockWidgetBase::List({ dock1 }));
+    delete dock2->window();
+}
+
 void TestDocks::tst_maximizeAndRestore()
 {
     EnsureTopLevelsDeleted e;
@@ -2723,6 +5373,46 @@ void TestDocks::tst_placeholderDisappearsOnReadd()
     QVERIFY(Testing::waitForDeleted(fw));
 }
 
+void TestDocks::tst_addMultiSplitterKeepsSeparators()
+{
+    // Docking a floating window with several frames transplants its layout instead of rebuilding it
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    auto dock0 = createDockWidget("0", new QPushButton("0"));
+    m->addDockWidget(dock0, Location_OnLeft);
+
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    auto dock3 = createDockWidget("3", new QPushButton("3"));
+    dock1->morphIntoFloatingWindow();
+    dock1->addDockWidgetToContainingWindow(dock2, Location_OnRight);
+    dock2->addDockWidgetToContainingWindow(dock3, Location_OnBottom, dock2);
+    auto fw = dock1->floatingWindow();
+    QVERIFY(fw);
+
+    QVector<QPointer<Layouting::Separator>> separators;
+    for (Layouting::Separator *separator : fw->dropArea()->multiSplitterLayout()->separators())
+        separators.push_back(separator);
+    QCOMPARE(separators.size(), 2);
+    QPointer<Frame> frame2 = dock2->frame();
+
+    layout->addMultiSplitter(fw->dropArea(), Location_OnRight);
+    QVERIFY(layout->checkSanity());
+    QCOMPARE(layout->count(), 4);
+    QCOMPARE(dock2->frame(), frame2.data());
+
+    const QVector<Layouting::Separator*> layoutSeparators = layout->separators();
+    QCOMPARE(layoutSeparators.size(), 3);
+    for (const QPointer<Layouting::Separator> &separator : qAsConst(separators)) {
+        QVERIFY(separator);
+        QCOMPARE(separator->hostWidget(), layout->multiSplitter());
+        QVERIFY(layoutSeparators.contains(separator.data()));
+    }
+
+    QVERIFY(Testing::waitForDeleted(fw));
+}
+
 void TestDocks::tst_placeholdersAreRemovedProperly()
 {
     EnsureTopLevelsDeleted e;
@@ -3632,6 +6322,39 @@ void TestDocks::tst_toggleDockWidgetWithHiddenTitleBar()
     QVERIFY(!d1->frame()->titleBar()->isVisible());
 }
 
+void TestDocks::tst_lazyActionsAndTitleBarButtons()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(KDDockWidgets::Config::Flag_HideTitleBarWhenTabsVisible | KDDockWidgets::Config::Flag_AlwaysShowTabs);
+    auto m = createMainWindow();
+    auto d1 = createDockWidget("1", new QTextEdit());
+    m->addDockWidget(d1, Location_OnTop);
+
+    // Nobody asked for the actions yet, nor showed the title bar
+    QVERIFY(d1->findChildren<QAction*>(QString(), Qt::FindDirectChildrenOnly).isEmpty());
+    QVERIFY(d1->isOpen());
+    TitleBar *titleBar = d1->frame()->titleBar();
+    QVERIFY(!titleBar->isVisible());
+    QVERIFY(titleBar->findChildren<QAbstractButton*>().isEmpty());
+
+    // They're created with the current state
+    QAction *toggleAction = d1->toggleAction();
+    QVERIFY(toggleAction->isChecked());
+    QCOMPARE(toggleAction->text(), d1->title());
+    QCOMPARE(d1->toggleAction(), toggleAction);
+    QVERIFY(!d1->floatAction()->isChecked());
+    QVERIFY(titleBar->isCloseButtonEnabled());
+    QCOMPARE(titleBar->findChildren<QAbstractButton*>().size(), 3);
+
+    // And kept up to date
+    d1->setFloating(true);
+    QVERIFY(d1->floatAction()->isChecked());
+    d1->close();
+    QVERIFY(!toggleAction->isChecked());
+    QVERIFY(!d1->isOpen());
+    delete d1;
+}
+
 void TestDocks::tst_dragByTabBar_data()
 {
     QTest::addColumn<bool>("documentMode");
@@ -3991,6 +6714,47 @@ void TestDocks::tst_rectForDropCrash()
     delete m->window();
 }
 
+void TestDocks::tst_rectForDropCache()
+{
+    // Memoized results must be the same as freshly computed ones, also after the layout changes
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto d1 = createDockWidget("1", new QPushButton("1"));
+    auto d2 = createDockWidget("2", new QPushButton("2"));
+    auto d3 = createDockWidget("3", new QPushButton("3"));
+
+    m->addDockWidget(d1, Location_OnLeft);
+    Item *item1 = layout->itemForFrame(d1->frame());
+
+    const QRect rect = layout->rectForDrop(d3, Location_OnRight, item1);
+    QCOMPARE(layout->rectForDrop(d3, Location_OnRight, item1), rect);
+    layout->clearDropRectCache();
+    QCOMPARE(layout->rectForDrop(d3, Location_OnRight, item1), rect);
+
+    m->addDockWidget(d2, Location_OnRight);
+    const QRect rectAfterAdding = layout->rectForDrop(d3, Location_OnRight, item1);
+    QVERIFY(rectAfterAdding != rect);
+    layout->clearDropRectCache();
+    QCOMPARE(layout->rectForDrop(d3, Location_OnRight, item1), rectAfterAdding);
+
+    // Bounded, even when the dragged widget keeps changing size
+    for (int i = 0; i < 200; ++i) {
+        d3->resize(QSize(100 + i, 100));
+        layout->rectForDrop(d3, Location_OnRight, item1);
+    }
+    QVERIFY(layout->dbg_numCachedDropRects() <= 64);
+
+    // And forgotten when the structure changes
+    layout->rectForDrop(d3, Location_OnRight, item1);
+    QVERIFY(layout->dbg_numCachedDropRects() > 0);
+    d2->close();
+    layout->rectForDrop(d3, Location_OnRight, item1);
+    QCOMPARE(layout->dbg_numCachedDropRects(), 1);
+
+    delete d3;
+}
+
 void TestDocks::tst_availableSizeWithPlaceholders()
 {
     // Tests MultiSplitterLayout::available() with and without placeholders. The result should be the same.
@@ -4840,6 +7604,31 @@ void TestDocks::tst_restoreResizesLayout()
     QVERIFY(layout->checkSanity());
 }
 
+void TestDocks::tst_restoreRelativeScalesOnce()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(500, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    dock2->window()->setGeometry(QRect(100, 100, 300, 200));
+
+    LayoutSaver saver;
+    QVERIFY(saver.savePerspective(QStringLiteral("relative")));
+    m->resize(1000, 1000);
+
+    // Scaling is applied while restoring, the saved layout isn't modified. So restoring again gives the same result
+    LayoutSaver restorer(RestoreOption_RelativeToMainWindow);
+    QVERIFY(restorer.restorePerspective(QStringLiteral("relative")));
+    const QRect geometry = dock2->window()->geometry();
+    QVERIFY(restorer.restorePerspective(QStringLiteral("relative")));
+    QCOMPARE(dock2->window()->geometry(), geometry);
+    QCOMPARE(m->dropArea()->size(), m->multiSplitterLayout()->rootItem()->size());
+
+    LayoutSaver::removePerspective(QStringLiteral("relative"));
+    delete dock2->window();
+}
+
 void TestDocks::tst_resizeWindow_data()
 {
     QTest::addColumn<bool>("doASaveRestore");
@@ -5201,8 +7990,29 @@ void TestDocks::tst_lastFloatingPositionIsRestored()
     delete dock1->window();
 }
 
+// The content of the ProcessDockWidget in tst_processDockWidget
+static int runProcessPanelChild(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    const bool announce = !app.arguments().contains(QStringLiteral("--no-announce"));
+    QWidget panel;
+    panel.resize(200, 200);
+    if (announce) {
+        panel.winId();
+        ProcessDockWidget::announceWindow(panel.windowHandle());
+    }
+    panel.show();
+
+    return app.exec();
+}
+
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--process-panel-child") == 0)
+            return runProcessPanelChild(argc, argv);
+    }
+
     if (!qpaPassedAsArgument(argc, argv)) {
         // Use offscreen by default as it's less annoying, doesn't create visible windows
         qputenv("QT_QPA_PLATFORM", "offscreen");
@@ -29,9 +29,14 @@
 #include <QWidget>
 #include <QPointer>
 #include <QVector>
+#include <QFile>
 
 #include <memory>
 
+#ifdef Q_OS_LINUX
+# include <unistd.h>
+#endif
+
 // clazy:excludeall=ctor-missing-parent-argument,missing-qobject-macro,range-loop,missing-typeinfo,detaching-member,function-args-by-ref,non-pod-global-static,reserve-candidates
 
 namespace KDDockWidgets {
@@ -125,6 +130,19 @@ inline bool qpaPassedAsArgument(int argc, char *argv[])
     return false;
 }
 
+#ifdef Q_OS_LINUX
+///@brief Returns the resident set size of this process, in bytes. 0 if unknown.
+inline qint64 residentMemory()
+{
+    QFile f(QStringLiteral("/proc/self/statm"));
+    if (!f.open(QIODevice::ReadOnly))
+        return 0;
+
+    const QList<QByteArray> fields = f.readAll().split(' ');
+    return fields.size() > 1 ? fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) : 0;
+}
+#endif
+
 }
 
 Q_DECLARE_METATYPE(KDDockWidgets::Tests::DockDescriptor)